@@ -181,9 +181,9 @@ namespace BuildXL.Processes.Tracing
         /// </summary>
         void LogAppleSandboxPolicyGenerated(global::BuildXL.Utilities.Instrumentation.Common.LoggingContext context, long pipSemiStableHash, string pipDescription, string policyFilePath);
         /// <summary>
-        /// (Verbose) - [{1}] Maximum detours heap size for process in the pip is {maxDetoursHeapSizeInBytes} bytes. The processName '{processName}'. The processId is: {processId}. The manifestSize in bytes is: {manifestSizeInBytes}. The finalDetoursHeapSize in bytes is: {finalDetoursHeapSizeInBytes}. The allocatedPoolEntries is: {allocatedPoolEntries}. The maxHandleMapEntries is: {maxHandleMapEntries}. The handleMapEntries is: {handleMapEntries}.
+        /// (Verbose) - [{1}] Maximum detours heap size for process in the pip is {maxDetoursHeapSizeInBytes} bytes. The processName '{processName}'. The processId is: {processId}. The manifestSize in bytes is: {manifestSizeInBytes}. The finalDetoursHeapSize in bytes is: {finalDetoursHeapSizeInBytes}. The maxHandleMapEntries is: {maxHandleMapEntries}. The handleMapEntries is: {handleMapEntries}.
         /// </summary>
-        void LogDetoursMaxHeapSize(global::BuildXL.Utilities.Instrumentation.Common.LoggingContext context, long pipSemiStableHash, string pipDescription, ulong maxDetoursHeapSizeInBytes, string processName, uint processId, uint manifestSizeInBytes, ulong finalDetoursHeapSizeInBytes, uint allocatedPoolEntries, ulong maxHandleMapEntries, ulong handleMapEntries);
+        void LogDetoursMaxHeapSize(global::BuildXL.Utilities.Instrumentation.Common.LoggingContext context, long pipSemiStableHash, string pipDescription, ulong maxDetoursHeapSizeInBytes, string processName, uint processId, uint manifestSizeInBytes, ulong finalDetoursHeapSizeInBytes, ulong maxHandleMapEntries, ulong handleMapEntries);
         /// <summary>
         /// (Error) - [{1}] Detoured process emitted failure information that could not be transmitted back to {ShortProductName}. Diagnostic file content: {2}
         /// </summary>
@@ -824,11 +824,11 @@ namespace BuildXL.Processes.Tracing
         }
 
         /// <summary>
-        /// Verbose DX2928: [{1}] Maximum detours heap size for process in the pip is {maxDetoursHeapSizeInBytes} bytes. The processName '{processName}'. The processId is: {processId}. The manifestSize in bytes is: {manifestSizeInBytes}. The finalDetoursHeapSize in bytes is: {finalDetoursHeapSizeInBytes}. The allocatedPoolEntries is: {allocatedPoolEntries}. The maxHandleMapEntries is: {maxHandleMapEntries}. The handleMapEntries is: {handleMapEntries}.
+        /// Verbose DX2928: [{1}] Maximum detours heap size for process in the pip is {maxDetoursHeapSizeInBytes} bytes. The processName '{processName}'. The processId is: {processId}. The manifestSize in bytes is: {manifestSizeInBytes}. The finalDetoursHeapSize in bytes is: {finalDetoursHeapSizeInBytes}. The maxHandleMapEntries is: {maxHandleMapEntries}. The handleMapEntries is: {handleMapEntries}.
         /// </summary>
-        public void LogDetoursMaxHeapSize(global::BuildXL.Utilities.Instrumentation.Common.LoggingContext context, long pipSemiStableHash, string pipDescription, ulong maxDetoursHeapSizeInBytes, string processName, uint processId, uint manifestSizeInBytes, ulong finalDetoursHeapSizeInBytes, uint allocatedPoolEntries, ulong maxHandleMapEntries, ulong handleMapEntries)
+        public void LogDetoursMaxHeapSize(global::BuildXL.Utilities.Instrumentation.Common.LoggingContext context, long pipSemiStableHash, string pipDescription, ulong maxDetoursHeapSizeInBytes, string processName, uint processId, uint manifestSizeInBytes, ulong finalDetoursHeapSizeInBytes, ulong maxHandleMapEntries, ulong handleMapEntries)
         {
-            m_logger.LogDetoursMaxHeapSize(context, pipSemiStableHash, pipDescription, maxDetoursHeapSizeInBytes, processName, processId, manifestSizeInBytes, finalDetoursHeapSizeInBytes, allocatedPoolEntries, maxHandleMapEntries, handleMapEntries);
+            m_logger.LogDetoursMaxHeapSize(context, pipSemiStableHash, pipDescription, maxDetoursHeapSizeInBytes, processName, processId, manifestSizeInBytes, finalDetoursHeapSizeInBytes, maxHandleMapEntries, handleMapEntries);
         }
 
         /// <summary>
@@ -2697,28 +2697,28 @@ namespace BuildXL.Processes.Tracing
             /// <summary>
             /// Logging implementation
             /// </summary>
-            public override void LogDetoursMaxHeapSize(global::BuildXL.Utilities.Instrumentation.Common.LoggingContext context, long pipSemiStableHash, string pipDescription, ulong maxDetoursHeapSizeInBytes, string processName, uint processId, uint manifestSizeInBytes, ulong finalDetoursHeapSizeInBytes, uint allocatedPoolEntries, ulong maxHandleMapEntries, ulong handleMapEntries)
+            public override void LogDetoursMaxHeapSize(global::BuildXL.Utilities.Instrumentation.Common.LoggingContext context, long pipSemiStableHash, string pipDescription, ulong maxDetoursHeapSizeInBytes, string processName, uint processId, uint manifestSizeInBytes, ulong finalDetoursHeapSizeInBytes, ulong maxHandleMapEntries, ulong handleMapEntries)
             {
                 if (context.IsAsyncLoggingEnabled)
                 {
-                    EnqueueLogAction(context, 2928, () => LogDetoursMaxHeapSize_Core(context, pipSemiStableHash, pipDescription, maxDetoursHeapSizeInBytes, processName, processId, manifestSizeInBytes, finalDetoursHeapSizeInBytes, allocatedPoolEntries, maxHandleMapEntries, handleMapEntries));
+                    EnqueueLogAction(context, 2928, () => LogDetoursMaxHeapSize_Core(context, pipSemiStableHash, pipDescription, maxDetoursHeapSizeInBytes, processName, processId, manifestSizeInBytes, finalDetoursHeapSizeInBytes, maxHandleMapEntries, handleMapEntries));
                 }
                 else
                 {
-                    LogDetoursMaxHeapSize_Core(context, pipSemiStableHash, pipDescription, maxDetoursHeapSizeInBytes, processName, processId, manifestSizeInBytes, finalDetoursHeapSizeInBytes, allocatedPoolEntries, maxHandleMapEntries, handleMapEntries);
+                    LogDetoursMaxHeapSize_Core(context, pipSemiStableHash, pipDescription, maxDetoursHeapSizeInBytes, processName, processId, manifestSizeInBytes, finalDetoursHeapSizeInBytes, maxHandleMapEntries, handleMapEntries);
                 }
             }
 
-            private void LogDetoursMaxHeapSize_Core(global::BuildXL.Utilities.Instrumentation.Common.LoggingContext context, long pipSemiStableHash, string pipDescription, ulong maxDetoursHeapSizeInBytes, string processName, uint processId, uint manifestSizeInBytes, ulong finalDetoursHeapSizeInBytes, uint allocatedPoolEntries, ulong maxHandleMapEntries, ulong handleMapEntries)
+            private void LogDetoursMaxHeapSize_Core(global::BuildXL.Utilities.Instrumentation.Common.LoggingContext context, long pipSemiStableHash, string pipDescription, ulong maxDetoursHeapSizeInBytes, string processName, uint processId, uint manifestSizeInBytes, ulong finalDetoursHeapSizeInBytes, ulong maxHandleMapEntries, ulong handleMapEntries)
             {
                 if (BuildXL.Processes.Tracing.ETWLogger.Log.IsEnabled(EventLevel.Verbose, (EventKeywords)268435456))
                 {
-                    BuildXL.Processes.Tracing.ETWLogger.Log.LogDetoursMaxHeapSize(context.Session.RelatedActivityId, pipSemiStableHash, pipDescription, maxDetoursHeapSizeInBytes, processName, processId, manifestSizeInBytes, finalDetoursHeapSizeInBytes, allocatedPoolEntries, maxHandleMapEntries, handleMapEntries);
+                    BuildXL.Processes.Tracing.ETWLogger.Log.LogDetoursMaxHeapSize(context.Session.RelatedActivityId, pipSemiStableHash, pipDescription, maxDetoursHeapSizeInBytes, processName, processId, manifestSizeInBytes, finalDetoursHeapSizeInBytes, maxHandleMapEntries, handleMapEntries);
                 }
 
                 if (InspectMessageEnabled)
                 {
-                    InspectMessage(2928, EventLevel.Verbose, string.Format(System.Globalization.CultureInfo.InvariantCulture, "[{1}] Maximum detours heap size for process in the pip is {2} bytes. The processName '{3}'. The processId is: {4}. The manifestSize in bytes is: {5}. The finalDetoursHeapSize in bytes is: {6}. The allocatedPoolEntries is: {7}. The maxHandleMapEntries is: {8}. The handleMapEntries is: {9}.", pipSemiStableHash, pipDescription, maxDetoursHeapSizeInBytes, processName, processId, manifestSizeInBytes, finalDetoursHeapSizeInBytes, allocatedPoolEntries, maxHandleMapEntries, handleMapEntries, pipSemiStableHash, pipDescription, maxDetoursHeapSizeInBytes, processName, processId, manifestSizeInBytes, finalDetoursHeapSizeInBytes, allocatedPoolEntries, maxHandleMapEntries, handleMapEntries), null);
+                    InspectMessage(2928, EventLevel.Verbose, string.Format(System.Globalization.CultureInfo.InvariantCulture, "[{1}] Maximum detours heap size for process in the pip is {2} bytes. The processName '{3}'. The processId is: {4}. The manifestSize in bytes is: {5}. The finalDetoursHeapSize in bytes is: {6}. The maxHandleMapEntries is: {7}. The handleMapEntries is: {8}.", pipSemiStableHash, pipDescription, maxDetoursHeapSizeInBytes, processName, processId, manifestSizeInBytes, finalDetoursHeapSizeInBytes, maxHandleMapEntries, handleMapEntries, pipSemiStableHash, pipDescription, maxDetoursHeapSizeInBytes, processName, processId, manifestSizeInBytes, finalDetoursHeapSizeInBytes, maxHandleMapEntries, handleMapEntries), null);
                 }
             }
 
@@ -5896,10 +5896,10 @@ namespace BuildXL.Processes.Tracing
         /// <summary>
         /// LogDetoursMaxHeapSize
         /// </summary>
-        [Event(2928, Level = EventLevel.Verbose, Keywords = (EventKeywords)268435456, Task = (EventTask)9, Message = "[{1}] Maximum detours heap size for process in the pip is {2} bytes. The processName '{3}'. The processId is: {4}. The manifestSize in bytes is: {5}. The finalDetoursHeapSize in bytes is: {6}. The allocatedPoolEntries is: {7}. The maxHandleMapEntries is: {8}. The handleMapEntries is: {9}.")]
-        public unsafe void LogDetoursMaxHeapSize(Guid relatedActivityId, long pipSemiStableHash, string pipDescription, ulong maxDetoursHeapSizeInBytes, string processName, uint processId, uint manifestSizeInBytes, ulong finalDetoursHeapSizeInBytes, uint allocatedPoolEntries, ulong maxHandleMapEntries, ulong handleMapEntries)
+        [Event(2928, Level = EventLevel.Verbose, Keywords = (EventKeywords)268435456, Task = (EventTask)9, Message = "[{1}] Maximum detours heap size for process in the pip is {2} bytes. The processName '{3}'. The processId is: {4}. The manifestSize in bytes is: {5}. The finalDetoursHeapSize in bytes is: {6}. The maxHandleMapEntries is: {7}. The handleMapEntries is: {8}.")]
+        public unsafe void LogDetoursMaxHeapSize(Guid relatedActivityId, long pipSemiStableHash, string pipDescription, ulong maxDetoursHeapSizeInBytes, string processName, uint processId, uint manifestSizeInBytes, ulong finalDetoursHeapSizeInBytes, ulong maxHandleMapEntries, ulong handleMapEntries)
         {
-            EventSource.EventData* data = stackalloc EventSource.EventData[10];
+            EventSource.EventData* data = stackalloc EventSource.EventData[9];
             data[0].DataPointer = (IntPtr)(&pipSemiStableHash);
             data[0].Size = sizeof(long);
             pipDescription = pipDescription ?? String.Empty;
@@ -5920,13 +5920,11 @@ namespace BuildXL.Processes.Tracing
                     data[5].Size = sizeof(uint);
                     data[6].DataPointer = (IntPtr)(&finalDetoursHeapSizeInBytes);
                     data[6].Size = sizeof(ulong);
-                    data[7].DataPointer = (IntPtr)(&allocatedPoolEntries);
-                    data[7].Size = sizeof(uint);
-                    data[8].DataPointer = (IntPtr)(&maxHandleMapEntries);
+                    data[7].DataPointer = (IntPtr)(&maxHandleMapEntries);
+                    data[7].Size = sizeof(ulong);
+                    data[8].DataPointer = (IntPtr)(&handleMapEntries);
                     data[8].Size = sizeof(ulong);
-                    data[9].DataPointer = (IntPtr)(&handleMapEntries);
-                    data[9].Size = sizeof(ulong);
-                    WriteEventWithRelatedActivityIdCore(2928, &relatedActivityId, 10, data);
+                    WriteEventWithRelatedActivityIdCore(2928, &relatedActivityId, 9, data);
                 }
             }
         }
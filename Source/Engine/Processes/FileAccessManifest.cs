@@ -4,6 +4,7 @@
 using System;
 using System.Collections.Generic;
 using System.Diagnostics.CodeAnalysis;
+using System.Buffers.Binary;
 using System.Diagnostics.ContractsLight;
 using System.Globalization;
 using System.IO;
@@ -87,8 +88,6 @@ namespace BuildXL.Processes
             IgnoreNonCreateFileReparsePoints = false;
             IgnoreSetFileInformationByHandle = false;
             NormalizeReadTimestamps = true;
-            UseLargeNtClosePreallocatedList = false;
-            UseExtraThreadToDrainNtClose = true;
             LogProcessData = false;
             LogProcessDetouringStatus = false;
             HardExitOnErrorInDetours = false;
@@ -107,6 +106,7 @@ namespace BuildXL.Processes
             UnconditionallyEnableLinuxPTraceSandbox = false;
             IgnoreDeviceIoControlGetReparsePoint = true;
             IgnoreGetFinalPathNameByHandle = true;
+            ValidateManifestTree = false;
         }
 
         private bool GetFlag(FileAccessManifestFlag flag) => (m_fileAccessManifestFlag & flag) != 0;
@@ -379,21 +379,25 @@ namespace BuildXL.Processes
         }
 
         /// <summary>
-        /// Whether BuildXL will use larger NtClose preallocated list.
+        /// Previously used to make the sandbox preallocate a larger list of handles for NtClose. The handle overlays no longer use such a list,
+        /// so this setting is ignored.
         /// </summary>
+        [Obsolete("Deprecated")]
         public bool UseLargeNtClosePreallocatedList
         {
-            get => GetFlag(FileAccessManifestFlag.UseLargeNtClosePreallocatedList);
-            set => SetFlag(FileAccessManifestFlag.UseLargeNtClosePreallocatedList, value);
+            get;
+            set;
         }
 
         /// <summary>
-        /// Whether BuildXL will use extra thread to drain NtClose handle List or clean the cache directly.
+        /// Previously used to make the sandbox drain the handles closed by NtClose on an extra thread. The handle overlays are released
+        /// directly on close, so this setting is ignored.
         /// </summary>
+        [Obsolete("Deprecated")]
         public bool UseExtraThreadToDrainNtClose
         {
-            get => GetFlag(FileAccessManifestFlag.UseExtraThreadToDrainNtClose);
-            set => SetFlag(FileAccessManifestFlag.UseExtraThreadToDrainNtClose, value);
+            get;
+            set;
         }
 
         /// <summary>
@@ -541,6 +545,19 @@ namespace BuildXL.Processes
             set => SetExtraFlag(FileAccessManifestExtraFlag.IgnoreDeviceIoControlGetReparsePoint, value);
         }
 
+        /// <summary>
+        /// When enabled, the sandbox walks the whole manifest tree when parsing the manifest, checking that every record lies within the tree.
+        /// </summary>
+        /// <remarks>
+        /// The tree is always checked against its checksum, which detects corruption at a fraction of the cost of the walk.
+        /// This is meant for investigating suspected manifest corruption.
+        /// </remarks>
+        public bool ValidateManifestTree
+        {
+            get => GetExtraFlag(FileAccessManifestExtraFlag.ValidateManifestTree);
+            set => SetExtraFlag(FileAccessManifestExtraFlag.ValidateManifestTree, value);
+        }
+
         /// <summary>
         /// A location for a file where Detours to log failure messages.
         /// </summary>
@@ -779,6 +796,7 @@ namespace BuildXL.Processes
             public const uint ExtraFlags                    = 0xF1A6B10D;
             public const uint ReportBlock                   = 0xFEEDF00D; // feed food.
             public const uint DllBlock                      = 0xD11B10CC;
+            public const uint ManifestTreeChecksum          = 0xC4EC5001;
 
             public static void EnsureRead(BinaryReader reader, uint checkCode)
             {
@@ -1092,18 +1110,51 @@ namespace BuildXL.Processes
             }
         }
 
-        private void WriteManifestTreeBlock(BinaryWriter writer)
+        /// <summary>
+        /// Writes the manifest tree, returning the number of records it consists of.
+        /// </summary>
+        private uint WriteManifestTreeBlock(BinaryWriter writer)
         {
             if (m_sealedManifestTreeBlock is not null)
             {
                 writer.Write(m_sealedManifestTreeBlock);
+                return Node.CountSerializedRecords(m_sealedManifestTreeBlock);
             }
             else
             {
-                m_rootNode.InternalSerialize(default(NormalizedPathString), writer);
+                return m_rootNode.InternalSerialize(default(NormalizedPathString), writer);
             }
         }
 
+        // CODESYNC: DataTypes.h :: ManifestTreeChecksum
+        // Writes the manifest tree preceded by its record count, size and xxHash64 checksum, which the sandbox checks before using the tree.
+        // The checksum block is written first and patched once the tree is written.
+        private void WriteManifestTreeChecksumAndTreeBlocks(BinaryWriter writer, MemoryStream stream)
+        {
+#if DEBUG
+            writer.Write(CheckedCode.ManifestTreeChecksum);
+#endif
+            long checksumPosition = stream.Position;
+            writer.Write(0U); // Record count
+            writer.Write(0U); // Tree size
+            writer.Write(0UL); // Checksum
+
+            long treeStart = stream.Position;
+            uint recordCount = WriteManifestTreeBlock(writer);
+            writer.Flush();
+            long treeEnd = stream.Position;
+
+            var tree = new ReadOnlySpan<byte>(stream.GetBuffer(), checked((int)treeStart), checked((int)(treeEnd - treeStart)));
+            ulong checksum = XxHash64.Compute(tree);
+
+            stream.Position = checksumPosition;
+            writer.Write(recordCount);
+            writer.Write((uint)tree.Length);
+            writer.Write(checksum);
+            writer.Flush();
+            stream.Position = treeEnd;
+        }
+
         /// <summary>
         /// Creates, as an Unicode encoded byte array, an expanded textual representation of the manifest, as consumed by the
         /// native detour implementation
@@ -1133,7 +1184,29 @@ namespace BuildXL.Processes
                 WriteReportBlock(writer, setup);
                 WriteDllBlock(writer, setup);
                 WriteSubstituteProcessShimBlock(writer);
-                WriteManifestTreeBlock(writer);
+                WriteManifestTreeChecksumAndTreeBlocks(writer, stream);
+
+                return new ArraySegment<byte>(stream.GetBuffer(), 0, (int)stream.Position);
+            }
+        }
+
+        /// <summary>
+        /// Creates the payload that replaces the manifest of a running, long-lived sandboxed process reused for this manifest's pip:
+        /// the flags, the pip id and the manifest tree. Everything else (report channel, translations, substitute process execution...)
+        /// stays as set up by the manifest the process was started with.
+        /// </summary>
+        /// <remarks>
+        /// CODESYNC: Public/Src/Sandbox/Windows/DetoursServices/DetoursServices.cpp :: SwapFileAccessManifest
+        /// </remarks>
+        public ArraySegment<byte> GetSwapPayloadBytes(MemoryStream stream)
+        {
+            stream.Position = 0;
+            using (var writer = new BinaryWriter(stream, Encoding.Unicode, true))
+            {
+                WriteFlagsBlock(writer, m_fileAccessManifestFlag);
+                WriteExtraFlagsBlock(writer, m_fileAccessManifestExtraFlag);
+                WritePipId(writer, PipId);
+                WriteManifestTreeChecksumAndTreeBlocks(writer, stream);
 
                 return new ArraySegment<byte>(stream.GetBuffer(), 0, (int)stream.Position);
             }
@@ -1294,8 +1367,7 @@ namespace BuildXL.Processes
             NormalizeReadTimestamps = 0x800,
             IgnoreZwRenameFileInformation = 0x1000,
             IgnoreSetFileInformationByHandle = 0x2000,
-            UseLargeNtClosePreallocatedList = 0x4000,
-            UseExtraThreadToDrainNtClose = 0x8000,
+            // 0x4000 and 0x8000 are reserved: they were UseLargeNtClosePreallocatedList and UseExtraThreadToDrainNtClose, and must not be reused.
             DisableDetours = 0x10000,
             LogProcessData = 0x20000,
             IgnoreGetFinalPathNameByHandle = 0x40000,
@@ -1325,6 +1397,7 @@ namespace BuildXL.Processes
             AlwaysRemoteInjectDetoursFrom32BitProcess = 0x10,
             UnconditionallyEnableLinuxPTraceSandbox = 0x20,
             IgnoreDeviceIoControlGetReparsePoint = 0x40,
+            ValidateManifestTree = 0x80,
         }
 
         private readonly struct FileAccessScope
@@ -1812,7 +1885,10 @@ namespace BuildXL.Processes
                 }
             }
 
-            public void InternalSerialize(NormalizedPathString normalizedFragment, BinaryWriter writer)
+            /// <summary>
+            /// Serializes this node and its descendants, returning the number of records written.
+            /// </summary>
+            public uint InternalSerialize(NormalizedPathString normalizedFragment, BinaryWriter writer)
             {
                 // always finalize when serializing -- note that this prevents adding additional scopes as before
                 if (!IsPolicyFinalized)
@@ -1833,6 +1909,7 @@ namespace BuildXL.Processes
                     writer.Write((ulong)ExpectedUsn.Value);
 
                     var childCount = (uint)(m_children is null ? 0 : m_children.Count);
+                    uint recordCount = 1;
 
                     // The children will be added to a hash-table.
                     // As it is known that hash-table performance starts to degrade with load factors > 0.7,
@@ -1888,7 +1965,7 @@ namespace BuildXL.Processes
                             var offset = checked((uint)(writer.BaseStream.Position - start));
                             Contract.Assume((offset & (uint)FileAccessBucketOffsetFlag.ChainMask) == 0);
                             offsets[index] = offset;
-                            child.Value.InternalSerialize(child.Key, writer);
+                            recordCount += child.Value.InternalSerialize(child.Key, writer);
                         }
 
                         long endPosition = writer.BaseStream.Position;
@@ -1900,9 +1977,44 @@ namespace BuildXL.Processes
 
                         writer.BaseStream.Seek(endPosition, SeekOrigin.Begin);
                     }
+
+                    return recordCount;
                 }
             }
 
+            /// <summary>
+            /// Counts the records of a tree serialized by <see cref="InternalSerialize"/>.
+            /// </summary>
+            public static uint CountSerializedRecords(byte[] tree)
+            {
+#if DEBUG
+                const int BucketCountOffset = 28; // Tag, hash, cone and node policies, path id, expected USN.
+#else
+                const int BucketCountOffset = 24; // Hash, cone and node policies, path id, expected USN.
+#endif
+                uint recordCount = 0;
+                var pending = new Stack<int>();
+                pending.Push(0);
+                while (pending.Count > 0)
+                {
+                    int recordStart = pending.Pop();
+                    recordCount++;
+
+                    var record = new ReadOnlySpan<byte>(tree, recordStart, tree.Length - recordStart);
+                    uint bucketCount = BinaryPrimitives.ReadUInt32LittleEndian(record.Slice(BucketCountOffset));
+                    for (int i = 0; i < bucketCount; i++)
+                    {
+                        uint offset = BinaryPrimitives.ReadUInt32LittleEndian(record.Slice(BucketCountOffset + sizeof(uint) * (i + 1)));
+                        if (offset != 0)
+                        {
+                            pending.Push(recordStart + (int)(offset & ~(uint)FileAccessBucketOffsetFlag.ChainMask));
+                        }
+                    }
+                }
+
+                return recordCount;
+            }
+
             public void Serialize(BinaryWriter writer)
             {
                 // always finalize when serializing -- note that this prevents adding additional scopes as before
@@ -2156,5 +2268,105 @@ namespace BuildXL.Processes
                 }
             }
         }
+
+        /// <summary>
+        /// xxHash64 (https://github.com/Cyan4973/xxHash), used to checksum the manifest tree.
+        /// </summary>
+        /// <remarks>
+        /// CODESYNC: Public/Src/Sandbox/Windows/DetoursServices/XxHash64.h
+        /// Both implementations must produce the same value for the same bytes.
+        /// </remarks>
+        internal static class XxHash64
+        {
+            private const ulong Prime1 = 0x9E3779B185EBCA87UL;
+            private const ulong Prime2 = 0xC2B2AE3D27D4EB4FUL;
+            private const ulong Prime3 = 0x165667B19E3779F9UL;
+            private const ulong Prime4 = 0x85EBCA77C2B2AE63UL;
+            private const ulong Prime5 = 0x27D4EB2F165667C5UL;
+
+            public static ulong Compute(ReadOnlySpan<byte> data, ulong seed = 0)
+            {
+                unchecked
+                {
+                    int position = 0;
+                    ulong hash;
+
+                    if (data.Length >= 32)
+                    {
+                        ulong v1 = seed + Prime1 + Prime2;
+                        ulong v2 = seed + Prime2;
+                        ulong v3 = seed;
+                        ulong v4 = seed - Prime1;
+
+                        do
+                        {
+                            v1 = Round(v1, BinaryPrimitives.ReadUInt64LittleEndian(data.Slice(position)));
+                            v2 = Round(v2, BinaryPrimitives.ReadUInt64LittleEndian(data.Slice(position + 8)));
+                            v3 = Round(v3, BinaryPrimitives.ReadUInt64LittleEndian(data.Slice(position + 16)));
+                            v4 = Round(v4, BinaryPrimitives.ReadUInt64LittleEndian(data.Slice(position + 24)));
+                            position += 32;
+                        } while (position <= data.Length - 32);
+
+                        hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+                        hash = MergeRound(hash, v1);
+                        hash = MergeRound(hash, v2);
+                        hash = MergeRound(hash, v3);
+                        hash = MergeRound(hash, v4);
+                    }
+                    else
+                    {
+                        hash = seed + Prime5;
+                    }
+
+                    hash += (ulong)data.Length;
+
+                    for (; position + 8 <= data.Length; position += 8)
+                    {
+                        hash ^= Round(0, BinaryPrimitives.ReadUInt64LittleEndian(data.Slice(position)));
+                        hash = RotateLeft(hash, 27) * Prime1 + Prime4;
+                    }
+
+                    if (position + 4 <= data.Length)
+                    {
+                        hash ^= BinaryPrimitives.ReadUInt32LittleEndian(data.Slice(position)) * Prime1;
+                        hash = RotateLeft(hash, 23) * Prime2 + Prime3;
+                        position += 4;
+                    }
+
+                    for (; position < data.Length; position++)
+                    {
+                        hash ^= data[position] * Prime5;
+                        hash = RotateLeft(hash, 11) * Prime1;
+                    }
+
+                    hash ^= hash >> 33;
+                    hash *= Prime2;
+                    hash ^= hash >> 29;
+                    hash *= Prime3;
+                    hash ^= hash >> 32;
+                    return hash;
+                }
+            }
+
+            private static ulong RotateLeft(ulong value, int bits) => (value << bits) | (value >> (64 - bits));
+
+            private static ulong Round(ulong accumulator, ulong input)
+            {
+                unchecked
+                {
+                    accumulator += input * Prime2;
+                    return RotateLeft(accumulator, 31) * Prime1;
+                }
+            }
+
+            private static ulong MergeRound(ulong accumulator, ulong value)
+            {
+                unchecked
+                {
+                    accumulator ^= Round(0, value);
+                    return accumulator * Prime1 + Prime4;
+                }
+            }
+        }
     }
 }
@@ -154,6 +154,62 @@ namespace BuildXL.Processes
             out string? enumeratePattern,
             out string? processArgs,
             out string? errorMessage)
+        {
+            var memory = line.AsMemory();
+            return TryParse(
+                ref memory,
+                out processId,
+                out parentProcessId,
+                out id,
+                out correlationId,
+                out operation,
+                out requestedAccess,
+                out status,
+                out explicitlyReported,
+                out error,
+                out rawError,
+                out usn,
+                out desiredAccess,
+                out shareMode,
+                out creationDisposition,
+                out flagsAndAttributes,
+                out openedFileOrDirectoryAttributes,
+                out absolutePath,
+                out path,
+                out enumeratePattern,
+                out processArgs,
+                out errorMessage);
+        }
+
+        /// <summary>
+        /// Parses the characters of a file access report line, e.g., a slice of the buffer of a pipe reader
+        /// </summary>
+        /// <remarks>
+        /// The parent process id is always set to zero for Windows. For Linux we send out the ppid for making up for some potential missing process start events
+        /// </remarks>
+        public static bool TryParse(
+            ref ReadOnlyMemory<char> line,
+            out uint processId,
+            out uint parentProcessId,
+            out uint id,
+            out uint correlationId,
+            out ReportedFileOperation operation,
+            out RequestedAccess requestedAccess,
+            out FileAccessStatus status,
+            out bool explicitlyReported,
+            out uint error,
+            out uint rawError,
+            out Usn usn,
+            out DesiredAccess desiredAccess,
+            out ShareMode shareMode,
+            out CreationDisposition creationDisposition,
+            out FlagsAndAttributes flagsAndAttributes,
+            out FlagsAndAttributes openedFileOrDirectoryAttributes,
+            out AbsolutePath absolutePath,
+            out string? path,
+            out string? enumeratePattern,
+            out string? processArgs,
+            out string? errorMessage)
         {
             // TODO: Task 138817: Refactor passing and parsing of report data from native to managed code
 
@@ -176,22 +232,18 @@ namespace BuildXL.Processes
             errorMessage = string.Empty;
 
             const int MinItemsCount = 16;
-#if NET5_0_OR_GREATER
-            var i = line.IndexOf(':', StringComparison.Ordinal);
-#else
-            var i = line.IndexOf(':');
-#endif
+            var i = line.Span.IndexOf(':');
             var index = 0;
 
             if (i == -1)
             {
-                errorMessage = $"Unexpected message format. Can't find ':' in message '{line}'.";
+                errorMessage = $"Unexpected message format. Can't find ':' in message '{line.ToString()}'.";
                 return false;
             }
 
-            SpanSplitEnumerator<char> items = line.AsSpan(i + 1).Split('|');
+            SpanSplitEnumerator<char> items = line.Span.Slice(i + 1).Split('|');
 
-            if (!TryGetOperation(line.AsMemory(start: 0, length: i), out operation))
+            if (!TryGetOperation(line.Slice(start: 0, length: i), out operation))
             {
                 // We could consider the report line malformed in this case; but in practice it is easy to forget to update this parser
                 // after adding a new call. So let's be conservative about throwing the line out so long as we can parse the important bits to follow.
@@ -300,7 +352,7 @@ namespace BuildXL.Processes
 #endif
             }
 
-            void tryGetErrorMessage(string line, ReportedFileOperation operation, int itemsLength, out string? errorMessage)
+            static void tryGetErrorMessage(ReadOnlyMemory<char> line, ReportedFileOperation operation, int itemsLength, out string? errorMessage)
             {
                 // Make sure the formatting happens only if the condition is false.
                 if (itemsLength < MinItemsCount)
@@ -310,14 +362,14 @@ namespace BuildXL.Processes
                     // Command line arguments are only reported when the reported file operation is Process
                     if (operation == ReportedFileOperation.Process)
                     {
-                        errorMessage = I($"Unexpected message items (potentially due to pipe corruption) for {operation.ToString()} operation. Message '{line}'. Expected >= {MinItemsCount} items, Received {itemsLength} items");
+                        errorMessage = I($"Unexpected message items (potentially due to pipe corruption) for {operation.ToString()} operation. Message '{line.ToString()}'. Expected >= {MinItemsCount} items, Received {itemsLength} items");
                     }
                     else
                     {
                         // An ill behaved tool can try to do GetFileAttribute on a file with '|' char. This will result in a failure of the API, but we get a report for the access.
                         // Allow that by handling such case.
                         // In Office build there is a call to GetFileAttribute with a small xml document as a file name.
-                        errorMessage = I($"Unexpected message items (potentially due to pipe corruption) for {operation.ToString()} operation. Message '{line}'. Expected >= {MinItemsCount} items, Received {itemsLength} items");
+                        errorMessage = I($"Unexpected message items (potentially due to pipe corruption) for {operation.ToString()} operation. Message '{line.ToString()}'. Expected >= {MinItemsCount} items, Received {itemsLength} items");
                     }
                 }
                 else
@@ -2,7 +2,6 @@
 // Licensed under the MIT License.
 
 using System;
-using System.Collections.Generic;
 using System.Diagnostics.ContractsLight;
 using System.Runtime.InteropServices;
 using System.Text;
@@ -18,13 +17,16 @@ namespace BuildXL.Processes.Internal
 {
     internal delegate bool StreamDataReceived(string data);
 
+    /// <summary>
+    /// Reads lines from a pipe through overlapped reads, and delivers the lines of each read at once, as slices of its pooled buffers
+    /// (see <see cref="StreamLinesReceived"/>).
+    /// </summary>
     internal sealed unsafe class AsyncPipeReader : IAsyncPipeReader, IIOCompletionTarget
     {
         private readonly object m_lock = new ();
         private State m_state = State.Initialized;
 
-        private Queue<string> m_messageQueue = new ();
-        private readonly StreamDataReceived m_userCallBack;
+        private readonly StreamLinesReceived m_linesReceived;
         private readonly DebugReporter m_debugPipeReporter;
         private bool m_bLastCarriageReturn;
 
@@ -39,8 +41,19 @@ namespace BuildXL.Processes.Internal
         private readonly PooledObjectWrapper<char[]> m_pooledCharBufferWrapper;
         private char[] CharBuffer => m_pooledCharBufferWrapper.Instance;
         private readonly Decoder m_decoder;
-        private readonly PooledObjectWrapper<StringBuilder> m_pooledStringBuilderWrapper;
-        private StringBuilder StringBuilderInstace => m_pooledStringBuilderWrapper.Instance;
+
+        /// <summary>
+        /// The start of a line that continues in the next read. Pooled, unless it outgrew the pooled buffer.
+        /// </summary>
+        private readonly PooledObjectWrapper<char[]> m_pooledPartialLineWrapper;
+        private char[] m_partialLine;
+        private int m_partialLineLength;
+
+        /// <summary>
+        /// The lines of the current read, delivered at once.
+        /// </summary>
+        private ReadOnlyMemory<char>[] m_lines = new ReadOnlyMemory<char>[16];
+        private int m_lineCount;
 
         private TaskCompletionSource<bool> m_completion;
 
@@ -89,6 +102,23 @@ namespace BuildXL.Processes.Internal
             int bufferSize,
             int numOfRetriesOnCancel = 0,
             DebugReporter debugPipeReporter = null)
+            : this(file, StreamDataReceivedAdapter.Create(callback), encoding, bufferSize, numOfRetriesOnCancel, debugPipeReporter)
+        {
+        }
+
+        /// <summary>
+        /// Creates a new AsyncStreamReader for the given stream, which delivers the lines of each read to <paramref name="callback"/> at once.
+        /// </summary>
+        /// <remarks>
+        /// See <see cref="AsyncPipeReader(IAsyncFile, StreamDataReceived, Encoding, int, int, DebugReporter)"/>.
+        /// </remarks>
+        public AsyncPipeReader(
+            IAsyncFile file,
+            StreamLinesReceived callback,
+            Encoding encoding,
+            int bufferSize,
+            int numOfRetriesOnCancel = 0,
+            DebugReporter debugPipeReporter = null)
         {
             Contract.Requires(file != null);
             Contract.Requires(file.CanRead);
@@ -96,7 +126,7 @@ namespace BuildXL.Processes.Internal
             Contract.Requires(encoding != null);
             Contract.Requires(bufferSize > 128);
             m_file = file;
-            m_userCallBack = callback;
+            m_linesReceived = callback;
             m_decoder = encoding.GetDecoder();
             m_pooledByteBufferWrapper = Pools.GetByteArray(bufferSize);
             m_byteBufferSize = bufferSize;
@@ -105,9 +135,8 @@ namespace BuildXL.Processes.Internal
 
             var maxCharsPerBuffer = encoding.GetMaxCharCount(bufferSize);
             m_pooledCharBufferWrapper = Pools.GetCharArray(maxCharsPerBuffer);
-            m_pooledStringBuilderWrapper = Pools.GetStringBuilder();
-            StringBuilderInstace.Clear();
-            StringBuilderInstace.EnsureCapacity(maxCharsPerBuffer * 2);
+            m_pooledPartialLineWrapper = Pools.GetCharArray(maxCharsPerBuffer);
+            m_partialLine = m_pooledPartialLineWrapper.Instance;
 
             m_numRetriesOnCancel = numOfRetriesOnCancel;
             m_debugPipeReporter = debugPipeReporter;
@@ -151,7 +180,7 @@ namespace BuildXL.Processes.Internal
 
             m_pooledCharBufferWrapper.Dispose();
             m_pooledByteBufferWrapper.Dispose();
-            m_pooledStringBuilderWrapper.Dispose();
+            m_pooledPartialLineWrapper.Dispose();
         }
 
         private void OnStopped()
@@ -266,15 +295,11 @@ namespace BuildXL.Processes.Internal
             if (byteLen == 0)
             {
                 // We're at EOF, we won't call this function again from here on.
-                lock (m_lock)
+                m_lineCount = 0;
+                if (m_partialLineLength != 0)
                 {
-                    if (StringBuilderInstace.Length != 0)
-                    {
-                        m_messageQueue.Enqueue(StringBuilderInstace.ToString());
-                        StringBuilderInstace.Length = 0;
-                    }
-
-                    m_messageQueue.Enqueue(null);
+                    AddLine(new ReadOnlyMemory<char>(m_partialLine, 0, m_partialLineLength));
+                    m_partialLineLength = 0;
                 }
 
                 try
@@ -282,7 +307,7 @@ namespace BuildXL.Processes.Internal
                     // UserCallback could throw, but we should still signal EOF
                     try
                     {
-                        FlushMessageQueue();
+                        DeliverLines(isEndOfStream: true);
                     }
 #pragma warning disable ERP022 // Unobserved exception in generic exception handler
                     catch
@@ -301,7 +326,6 @@ namespace BuildXL.Processes.Internal
                         OnStopped();
                     }
 
-                    m_messageQueue = null;
                     SignalCompletion(reachedEof: true);
                 }
             }
@@ -353,49 +377,44 @@ namespace BuildXL.Processes.Internal
 
         private void GetLinesFromCharBuffers(int len)
         {
+            char[] chars = CharBuffer;
+            m_lineCount = 0;
+
             // skip a beginning '\n' character of new block if last block ended with '\r'
-            var i = m_bLastCarriageReturn && len > 0 && CharBuffer[0] == '\n' ? 1 : 0;
+            var i = m_bLastCarriageReturn && len > 0 && chars[0] == '\n' ? 1 : 0;
             m_bLastCarriageReturn = false;
 
             while (i < len)
             {
                 // Note the following common line feed chars:
                 // \n - UNIX   \r\n - DOS   \r - Mac
-                var eolPosition = Array.FindIndex(CharBuffer, i, len - i, c => c == '\r' || c == '\n');
-                if (eolPosition == -1)
+                var eolOffset = chars.AsSpan(i, len - i).IndexOfAny('\r', '\n');
+                if (eolOffset == -1)
                 {
-                    // The line end was not found, remember the buffer to use next
-                    StringBuilderInstace.Append(CharBuffer, i, len - i);
+                    // The line end was not found; the rest is kept once the lines are delivered
                     break;
                 }
 
-                if (StringBuilderInstace.Length > 0)
+                var eolPosition = i + eolOffset;
+                if (m_partialLineLength > 0)
                 {
                     // If there is a remainder from the previous buffer, put them together
-                    StringBuilderInstace.Append(CharBuffer, i, eolPosition - i);
-                    lock (m_lock)
-                    {
-                        m_messageQueue.Enqueue(StringBuilderInstace.ToString());
-                    }
-
-                    StringBuilderInstace.Clear();
+                    AppendToPartialLine(chars, i, eolPosition - i);
+                    AddLine(new ReadOnlyMemory<char>(m_partialLine, 0, m_partialLineLength));
+                    m_partialLineLength = 0;
                 }
                 else
                 {
-                    // Use the newly found string
-                    lock (m_lock)
-                    {
-                        m_messageQueue.Enqueue(new string(CharBuffer, i, eolPosition - i));
-                    }
+                    AddLine(new ReadOnlyMemory<char>(chars, i, eolPosition - i));
                 }
 
                 i = eolPosition + 1;
 
                 // If the last character of the buffer is a CR, remember to skip LF at the start of next buffer
                 // or remember that we saw it if this is the last character of the buffer
-                if (CharBuffer[eolPosition] == '\r')
+                if (chars[eolPosition] == '\r')
                 {
-                    if (i < len && CharBuffer[i] == '\n')
+                    if (i < len && chars[i] == '\n')
                     {
                         i++;
                     }
@@ -406,40 +425,56 @@ namespace BuildXL.Processes.Internal
                 }
             }
 
-            FlushMessageQueue();
+            DeliverLines(isEndOfStream: false);
+
+            // Only now, as the first line delivered may have been the partial line
+            if (i < len)
+            {
+                AppendToPartialLine(chars, i, len - i);
+            }
         }
 
-        private void FlushMessageQueue()
+        private void AddLine(ReadOnlyMemory<char> line)
         {
-            while (true)
+            if (m_lineCount == m_lines.Length)
             {
-                // When we call BeginReadLine, we also need to flush the queue
-                // So there could be a race between the ReadBuffer and BeginReadLine
-                // We need to take lock before DeQueue.
-                lock (m_lock)
-                {
-                    var state = m_state;
-                    if (state == State.Stopped || state == State.Stopping)
-                    {
-                        // May have switched to stopping/stopped state after entering this method.
-                        // In that case, don't flush message queue and just return
-                        return;
-                    }
+                Array.Resize(ref m_lines, m_lines.Length * 2);
+            }
 
-                    if (m_messageQueue.Count == 0)
-                    {
-                        return;
-                    }
+            m_lines[m_lineCount++] = line;
+        }
 
-                    string s = m_messageQueue.Dequeue();
-                    bool? ret = m_userCallBack?.Invoke(s);
-                    if (ret.HasValue && !ret.Value)
-                    {
-                        // This allows for the callback to indicate an error state and break the
-                        // processing loop.
-                        // Error encountered. Stop processing.
-                        break;
-                    }
+        private void AppendToPartialLine(char[] chars, int start, int count)
+        {
+            if (m_partialLineLength + count > m_partialLine.Length)
+            {
+                var partialLine = new char[Math.Max(m_partialLineLength + count, m_partialLine.Length * 2)];
+                Array.Copy(m_partialLine, partialLine, m_partialLineLength);
+                m_partialLine = partialLine;
+            }
+
+            Array.Copy(chars, start, m_partialLine, m_partialLineLength, count);
+            m_partialLineLength += count;
+        }
+
+        private void DeliverLines(bool isEndOfStream)
+        {
+            // When we call BeginReadLine, we also need to deliver the lines
+            // So there could be a race between the ReadBuffer and BeginReadLine
+            // We need to take lock before delivering.
+            lock (m_lock)
+            {
+                var state = m_state;
+                if (state == State.Stopped || state == State.Stopping)
+                {
+                    // May have switched to stopping/stopped state after entering this method.
+                    // In that case, don't deliver the lines and just return
+                    return;
+                }
+
+                if (m_lineCount > 0 || isEndOfStream)
+                {
+                    m_linesReceived?.Invoke(new ReadOnlySpan<ReadOnlyMemory<char>>(m_lines, 0, m_lineCount), isEndOfStream);
                 }
             }
         }
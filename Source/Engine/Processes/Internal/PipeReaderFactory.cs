@@ -70,6 +70,43 @@ namespace BuildXL.Processes
             return new StreamAsyncPipeReader(pipeStream, callback, encoding, bufferSize);
         }
 
+        /// <summary>
+        /// Creates a managed pipe reader that delivers lines in batches.
+        /// </summary>
+        /// <remarks>
+        /// Only PipelineAsyncPipeReader delivers the lines of a read at once; StreamAsyncPipeReader reads line by line, so each of its lines is
+        /// a batch of its own.
+        /// </remarks>
+        internal static IAsyncPipeReader CreateManagedPipeReader(
+            NamedPipeServerStream pipeStream,
+            StreamLinesReceived callback,
+            Encoding encoding,
+            int bufferSize,
+            Kind? overrideKind = default)
+        {
+            Kind kind = overrideKind ?? GetKind();
+
+            if (kind == Kind.Pipeline)
+            {
+#if NET6_0_OR_GREATER
+                return new PipelineAsyncPipeReader(pipeStream, callback, encoding);
+#endif
+            }
+
+            // Fall back to use StreamReader based one.
+            var lines = new ReadOnlyMemory<char>[1];
+            return new StreamAsyncPipeReader(
+                pipeStream,
+                line =>
+                {
+                    lines[0] = line.AsMemory();
+                    callback?.Invoke(new ReadOnlySpan<ReadOnlyMemory<char>>(lines, 0, line == null ? 0 : 1), isEndOfStream: line == null);
+                    return true;
+                },
+                encoding,
+                bufferSize);
+        }
+
         /// <summary>
         /// Gets kind of pipe reader to be created.
         /// </summary>
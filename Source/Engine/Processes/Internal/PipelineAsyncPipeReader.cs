@@ -5,7 +5,6 @@
 
 using System;
 using System.Buffers;
-using System.Collections.Generic;
 using System.IO.Pipelines;
 using System.IO.Pipes;
 using System.Text;
@@ -17,16 +16,29 @@ namespace BuildXL.Processes.Internal
     /// <summary>
     /// Pipeline based pipe reader.
     /// </summary>
+    /// <remarks>
+    /// The complete lines of each read are decoded into one character buffer, and delivered at once as slices of it
+    /// (see <see cref="StreamLinesReceived"/>).
+    /// </remarks>
     internal sealed class PipelineAsyncPipeReader : IAsyncPipeReader
     {
+        private const int InitialCharBufferSize = 16 * 1024;
+
         private readonly Encoding m_encoding;
-        private readonly StreamDataReceived m_userCallBack;
+        private readonly StreamLinesReceived m_linesReceived;
         private readonly NamedPipeServerStream m_pipeStream;
         private readonly PipeReader m_reader;
-        private readonly Queue<string> m_messageQueue = new ();
         private readonly byte[] m_newLineBytes;
         private Task m_completionTask = Task.CompletedTask;
 
+        /// <summary>
+        /// The decoded lines; <see cref="m_lines"/> are slices of it.
+        /// </summary>
+        private char[] m_chars = new char[InitialCharBufferSize];
+        private int m_charCount;
+        private ReadOnlyMemory<char>[] m_lines = new ReadOnlyMemory<char>[16];
+        private int m_lineCount;
+
         /// <summary>
         /// Constructor.
         /// </summary>
@@ -34,9 +46,20 @@ namespace BuildXL.Processes.Internal
             NamedPipeServerStream pipeStream,
             StreamDataReceived callback,
             Encoding encoding)
+            : this(pipeStream, StreamDataReceivedAdapter.Create(callback), encoding)
+        {
+        }
+
+        /// <summary>
+        /// Constructor for a reader that delivers the lines of each read at once.
+        /// </summary>
+        public PipelineAsyncPipeReader(
+            NamedPipeServerStream pipeStream,
+            StreamLinesReceived callback,
+            Encoding encoding)
         {
             m_pipeStream = pipeStream;
-            m_userCallBack = callback;
+            m_linesReceived = callback;
             m_encoding = encoding;
             m_reader = PipeReader.Create(pipeStream);
 
@@ -64,7 +87,7 @@ namespace BuildXL.Processes.Internal
 
                         if (TryParseLines(ref buffer))
                         {
-                            FlushMessages();
+                            FlushLines(isEndOfStream: false);
                         }
 
                         if (readResult.IsCompleted)
@@ -90,7 +113,7 @@ namespace BuildXL.Processes.Internal
             finally
             {
                 await m_reader.CompleteAsync();
-                FlushMessages();
+                FlushLines(isEndOfStream: true);
             }
         }
 
@@ -106,26 +129,47 @@ namespace BuildXL.Processes.Internal
                 }
 
                 buffer = buffer.Slice(reader.Position);
-                string message = m_encoding.GetString(line);
-                m_messageQueue.Enqueue(message);
+                AddLine(line);
             }
 
-            return m_messageQueue.Count > 0;
+            return m_lineCount > 0;
         }
 
-        private string GetRemainingMessages(ref ReadOnlySequence<byte> buffer) => buffer.IsEmpty ? null : m_encoding.GetString(buffer);
-
-        private void FlushMessages()
+        private void AddLine(in ReadOnlySequence<byte> line)
         {
-            while (m_messageQueue.Count > 0)
+            int maxCharCount = m_encoding.GetMaxCharCount(checked((int)line.Length));
+            if (m_charCount + maxCharCount > m_chars.Length)
             {
-                string message = m_messageQueue.Dequeue();
-                bool? result = m_userCallBack?.Invoke(message);
-                if (result == false)
+                // The lines so far are slices of the buffer, so deliver them before reusing it
+                FlushLines(isEndOfStream: false);
+
+                if (maxCharCount > m_chars.Length)
                 {
-                    break;
+                    m_chars = new char[Math.Max(maxCharCount, m_chars.Length * 2)];
                 }
             }
+
+            int charCount = m_encoding.GetChars(line, m_chars.AsSpan(m_charCount));
+            if (m_lineCount == m_lines.Length)
+            {
+                Array.Resize(ref m_lines, m_lines.Length * 2);
+            }
+
+            m_lines[m_lineCount++] = new ReadOnlyMemory<char>(m_chars, m_charCount, charCount);
+            m_charCount += charCount;
+        }
+
+        private string GetRemainingMessages(ref ReadOnlySequence<byte> buffer) => buffer.IsEmpty ? null : m_encoding.GetString(buffer);
+
+        private void FlushLines(bool isEndOfStream)
+        {
+            if (m_lineCount > 0 || isEndOfStream)
+            {
+                m_linesReceived?.Invoke(new ReadOnlySpan<ReadOnlyMemory<char>>(m_lines, 0, m_lineCount), isEndOfStream);
+            }
+
+            m_lineCount = 0;
+            m_charCount = 0;
         }
 
         /// <inheritdoc/>
@@ -0,0 +1,95 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Generic;
+
+namespace BuildXL.Processes.Internal
+{
+    /// <summary>
+    /// Callback for the lines a pipe reader decoded from one read, without the line terminators.
+    /// </summary>
+    /// <remarks>
+    /// The lines are slices of the pooled buffers of the reader, so no string is allocated for them. They are only valid during the call;
+    /// a consumer that keeps a line must copy it (e.g., with ToString).
+    /// </remarks>
+    /// <param name="lines">The lines, in the order they were written to the pipe</param>
+    /// <param name="isEndOfStream">Whether the pipe was closed; the last call, whose <paramref name="lines"/> holds any unterminated last line (or none, for readers that fail the read on one)</param>
+    internal delegate void StreamLinesReceived(ReadOnlySpan<ReadOnlyMemory<char>> lines, bool isEndOfStream);
+
+    /// <summary>
+    /// Delivers the lines of a <see cref="StreamLinesReceived"/> pipe reader one by one, as strings, to a <see cref="StreamDataReceived"/> callback.
+    /// </summary>
+    /// <remarks>
+    /// Keeps the semantics of the per-line readers: the end of the stream is delivered as a null line, and when the callback returns false,
+    /// it gets the lines that are left, in order, with the lines of the next read.
+    /// </remarks>
+    internal sealed class StreamDataReceivedAdapter
+    {
+        private readonly StreamDataReceived m_callback;
+
+        /// <summary>
+        /// Lines left when the callback returned false.
+        /// </summary>
+        private Queue<string> m_pendingLines;
+
+        /// <nodoc />
+        public StreamDataReceivedAdapter(StreamDataReceived callback)
+        {
+            m_callback = callback;
+        }
+
+        /// <summary>
+        /// Creates a <see cref="StreamLinesReceived"/> callback for <paramref name="callback"/>, or null when <paramref name="callback"/> is null.
+        /// </summary>
+        public static StreamLinesReceived Create(StreamDataReceived callback) => callback == null ? null : new StreamDataReceivedAdapter(callback).OnLinesReceived;
+
+        /// <nodoc />
+        public void OnLinesReceived(ReadOnlySpan<ReadOnlyMemory<char>> lines, bool isEndOfStream)
+        {
+            int next = 0;
+            if (m_pendingLines == null || FlushPendingLines())
+            {
+                bool refused = false;
+                for (; next < lines.Length && !refused; next++)
+                {
+                    refused = !m_callback(lines[next].ToString());
+                }
+
+                // Even the end of the stream waits when the last line is refused
+                if (!refused && isEndOfStream)
+                {
+                    m_callback(null);
+                    return;
+                }
+            }
+
+            if (next < lines.Length || isEndOfStream)
+            {
+                m_pendingLines ??= new Queue<string>();
+                for (; next < lines.Length; next++)
+                {
+                    m_pendingLines.Enqueue(lines[next].ToString());
+                }
+
+                if (isEndOfStream)
+                {
+                    m_pendingLines.Enqueue(null);
+                }
+            }
+        }
+
+        private bool FlushPendingLines()
+        {
+            while (m_pendingLines.Count > 0)
+            {
+                if (!m_callback(m_pendingLines.Dequeue()))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+    }
+}
@@ -0,0 +1,172 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Threading;
+using BuildXL.Interop.Linux;
+
+#nullable enable
+
+namespace BuildXL.Processes
+{
+    /// <summary>
+    /// A cgroup v2 leaf holding the process tree of one pip, used to sample the resource usage of the whole tree at once.
+    /// </summary>
+    /// <remarks>
+    /// Leaves are created under a root cgroup that is delegated to BuildXL (see <see cref="SandboxedProcessResourceMonitoringConfig.CgroupRoot"/>).
+    /// The root must have the 'memory' and 'io' controllers available and must not contain processes itself, so that they can be enabled for the leaves.
+    /// </remarks>
+    internal sealed class PipCgroup : IDisposable
+    {
+        private static readonly string[] s_controllers = new[] { "cpu", "memory", "io" };
+        private static readonly string[] s_requiredControllers = new[] { "memory", "io" };
+
+        // Whether each root seen so far can hold pip cgroups. Checked once per root.
+        private static readonly ConcurrentDictionary<string, bool> s_usableRoots = new ConcurrentDictionary<string, bool>();
+
+        // Leaves that could not be removed yet because processes were still exiting. Removal is retried whenever a leaf is created.
+        private static readonly ConcurrentQueue<string> s_pendingRemovals = new ConcurrentQueue<string>();
+
+        private static readonly int s_currentProcessId = System.Diagnostics.Process.GetCurrentProcess().Id;
+
+        private static long s_lastId;
+
+        private readonly string m_path;
+        private readonly byte[] m_buffer = new byte[Cgroup.UsageBufferSize];
+        private Cgroup.Usage m_usage;
+        private bool m_hasUsage;
+
+        private PipCgroup(string path)
+        {
+            m_path = path;
+        }
+
+        /// <summary>
+        /// Creates a leaf under <paramref name="root"/>, or returns null if cgroups can't be used there, in which case the caller samples procfs instead.
+        /// </summary>
+        public static PipCgroup? TryCreate(string root)
+        {
+            if (!s_usableRoots.GetOrAdd(root, IsUsableRoot))
+            {
+                return null;
+            }
+
+            RetryPendingRemovals();
+
+            // The pid of this process keeps the names unique across concurrent builds sharing the root
+            var path = Path.Combine(root, $"bxl{s_currentProcessId}-{Interlocked.Increment(ref s_lastId)}");
+            try
+            {
+                Directory.CreateDirectory(path);
+            }
+            catch (Exception e) when (e is IOException || e is UnauthorizedAccessException)
+            {
+                return null;
+            }
+
+            return new PipCgroup(path);
+        }
+
+        private static bool IsUsableRoot(string root)
+        {
+            if (!Cgroup.IsCgroup2Directory(root))
+            {
+                return false;
+            }
+
+            var enabled = Cgroup.EnableControllers(root, s_controllers);
+            return s_requiredControllers.All(controller => enabled.Contains(controller));
+        }
+
+        /// <summary>
+        /// Moves the process tree rooted at <paramref name="rootPid"/> into the cgroup. Returns false if the root process could not be moved.
+        /// </summary>
+        /// <remarks>
+        /// The root process is moved first, so that processes it forks from then on start in the cgroup. Children it forked before it was moved
+        /// are then looked up once and moved as well.
+        /// </remarks>
+        public bool TryAddProcessTree(int rootPid)
+        {
+            if (!Cgroup.TryMoveProcess(m_path, rootPid))
+            {
+                return false;
+            }
+
+            var pending = new Stack<int>(Interop.Unix.Process.GetChildProcesses(rootPid));
+            while (pending.Count > 0)
+            {
+                int pid = pending.Pop();
+
+                // A child may be gone by now, in which case its usage stays charged to the cgroup of this process
+                Cgroup.TryMoveProcess(m_path, pid);
+                foreach (var child in Interop.Unix.Process.GetChildProcesses(pid))
+                {
+                    pending.Push(child);
+                }
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Samples the counters of the cgroup. Returns the last successful sample if the cgroup can't be read anymore, or false if there is none.
+        /// </summary>
+        public bool TrySample(out Cgroup.Usage usage)
+        {
+            lock (m_buffer)
+            {
+                if (Cgroup.TryReadUsage(m_path, m_buffer, ref m_usage))
+                {
+                    m_hasUsage = true;
+                }
+
+                usage = m_usage;
+                return m_hasUsage;
+            }
+        }
+
+        /// <summary>
+        /// Removes the cgroup. If processes are still exiting, removal is retried the next time a cgroup is created.
+        /// </summary>
+        public void Dispose()
+        {
+            if (!TryRemove(m_path))
+            {
+                s_pendingRemovals.Enqueue(m_path);
+            }
+        }
+
+        private static void RetryPendingRemovals()
+        {
+            for (int count = s_pendingRemovals.Count; count > 0 && s_pendingRemovals.TryDequeue(out var path); count--)
+            {
+                if (!TryRemove(path))
+                {
+                    s_pendingRemovals.Enqueue(path);
+                }
+            }
+        }
+
+        private static bool TryRemove(string path)
+        {
+            try
+            {
+                // A cgroup directory is removed with rmdir even though it lists files. This fails while processes are left in it.
+                Directory.Delete(path, recursive: false);
+                return true;
+            }
+            catch (DirectoryNotFoundException)
+            {
+                return true;
+            }
+            catch (Exception e) when (e is IOException || e is UnauthorizedAccessException)
+            {
+                return false;
+            }
+        }
+    }
+}
@@ -0,0 +1,190 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Concurrent;
+using System.Threading;
+using BuildXL.Interop.Linux;
+using BuildXL.Utilities.Core;
+using Microsoft.Win32.SafeHandles;
+
+namespace BuildXL.Processes
+{
+    /// <summary>
+    /// Notifies when arbitrary processes (not necessarily children of this one) exit, using pidfds watched by a single epoll thread.
+    /// </summary>
+    /// <remarks>
+    /// Used by the Linux sandbox to learn about the exit of processes whose exit reports may never arrive (e.g. processes that crash),
+    /// without polling whether they are still alive.
+    /// </remarks>
+    internal sealed class ProcessExitWatcher
+    {
+        /// <nodoc/>
+        internal enum WatchResult
+        {
+            /// <summary>The callback will be invoked when the process exits, unless the watch is removed first.</summary>
+            Watching,
+
+            /// <summary>The process does not exist anymore. The callback is not invoked.</summary>
+            AlreadyExited,
+
+            /// <summary>The exit of the process can't be watched (e.g. the kernel does not support pidfds). The callback is not invoked.</summary>
+            Unsupported,
+        }
+
+        private const int MaxEventsPerWait = 64;
+
+        private static readonly Lazy<ProcessExitWatcher> s_instance = new Lazy<ProcessExitWatcher>(() => new ProcessExitWatcher(), LazyThreadSafetyMode.ExecutionAndPublication);
+
+        /// <nodoc/>
+        public static ProcessExitWatcher Instance => s_instance.Value;
+
+        private readonly SafeFileHandle m_epoll;
+        private readonly ConcurrentDictionary<ulong, WatchedProcess> m_watches = new ConcurrentDictionary<ulong, WatchedProcess>();
+        private readonly Epoll.EpollEvent[] m_events = new Epoll.EpollEvent[MaxEventsPerWait];
+        private long m_lastWatchId;
+
+        // Set once exits can't be watched anymore. Nothing is watched from then on.
+        private volatile bool m_broken;
+
+        private sealed class WatchedProcess
+        {
+            internal readonly int ProcessId;
+            internal readonly SafeFileHandle Pidfd;
+            internal readonly Action<int, ulong, bool> OnExit;
+
+            internal WatchedProcess(int processId, SafeFileHandle pidfd, Action<int, ulong, bool> onExit)
+            {
+                ProcessId = processId;
+                Pidfd = pidfd;
+                OnExit = onExit;
+            }
+        }
+
+        private ProcessExitWatcher()
+        {
+            m_epoll = Epoll.Create();
+            if (m_epoll.IsInvalid)
+            {
+                m_broken = true;
+                return;
+            }
+
+            new Thread(Run)
+            {
+                Name = "ProcessExitWatcher",
+                IsBackground = true,
+            }.Start();
+        }
+
+        /// <summary>
+        /// Starts watching the exit of process <paramref name="pid"/>.
+        /// </summary>
+        /// <remarks>
+        /// When the result is <see cref="WatchResult.Watching"/>, <paramref name="onExit"/> is invoked once from the watcher thread with the pid,
+        /// <paramref name="watchId"/> and true when the process exits, unless <see cref="Unwatch(ulong)"/> is called first. It is invoked with false
+        /// instead if the watcher breaks down before the process exits, in which case the caller has to find out about the exit some other way.
+        /// </remarks>
+        public WatchResult Watch(int pid, Action<int, ulong, bool> onExit, out ulong watchId)
+        {
+            watchId = 0;
+            if (m_broken)
+            {
+                return WatchResult.Unsupported;
+            }
+
+            int error = Pidfd.Open(pid, out var pidfd);
+            if (error == Pidfd.ESRCH)
+            {
+                return WatchResult.AlreadyExited;
+            }
+
+            if (error != 0)
+            {
+                if (error == Pidfd.ENOSYS)
+                {
+                    // No point in trying again
+                    m_broken = true;
+                }
+
+                return WatchResult.Unsupported;
+            }
+
+            watchId = (ulong)Interlocked.Increment(ref m_lastWatchId);
+
+            // Add to the map first: an exited process is reported right away.
+            m_watches[watchId] = new WatchedProcess(pid, pidfd, onExit);
+            if (Epoll.Add(m_epoll, pidfd, Epoll.Events.EPOLLIN, watchId) != 0)
+            {
+                m_watches.TryRemove(watchId, out _);
+                pidfd.Dispose();
+                watchId = 0;
+                return WatchResult.Unsupported;
+            }
+
+            return WatchResult.Watching;
+        }
+
+        /// <summary>
+        /// Stops watching. Does nothing if the exit was already reported.
+        /// </summary>
+        public void Unwatch(ulong watchId)
+        {
+            if (m_watches.TryRemove(watchId, out var watch))
+            {
+                Release(watch);
+            }
+        }
+
+        private void Release(WatchedProcess watch)
+        {
+            Analysis.IgnoreResult(Epoll.Remove(m_epoll, watch.Pidfd));
+            watch.Pidfd.Dispose();
+        }
+
+        private void Run()
+        {
+            while (true)
+            {
+                int count = Epoll.Wait(m_epoll, m_events, timeoutMs: -1);
+                if (count < 0)
+                {
+                    // Only possible if the epoll instance itself is broken. Let the callers know that the processes watched so far are no
+                    // longer watched, so they can fall back to polling instead of waiting forever.
+                    m_broken = true;
+                    foreach (var id in m_watches.Keys)
+                    {
+                        ReportExit(id, exited: false);
+                    }
+
+                    return;
+                }
+
+                for (int i = 0; i < count; i++)
+                {
+                    ReportExit(m_events[i].Data, exited: true);
+                }
+            }
+        }
+
+        private void ReportExit(ulong watchId, bool exited)
+        {
+            // The watch may have been removed while the event was pending.
+            if (!m_watches.TryRemove(watchId, out var watch))
+            {
+                return;
+            }
+
+            Release(watch);
+
+            try
+            {
+                watch.OnExit(watch.ProcessId, watchId, exited);
+            }
+            catch (Exception)
+            {
+                Analysis.IgnoreException("Keep the watcher thread alive for the other watches");
+            }
+        }
+    }
+}
@@ -0,0 +1,396 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Threading;
+using BuildXL.Interop.Linux;
+using BuildXL.Utilities.Core;
+using static BuildXL.Interop.Unix.Process;
+
+#nullable enable
+
+namespace BuildXL.Processes
+{
+    /// <summary>
+    /// Samples the resource usage of the process trees of all the running pips from a single thread, using procfs.
+    /// </summary>
+    /// <remarks>
+    /// On each tick, the process table is built with one scan of /proc (one read of /proc/[pid]/stat per process), and the trees of all the pips
+    /// due for a sample are then read from it, so the cost of discovering children does not grow with the number of pips. Registrations with the
+    /// same interval are due on the same ticks. The files are read into a stack buffer and parsed in place, and the process entries (and names)
+    /// are reused from one tick to the next, so that sampling produces almost no garbage.
+    /// </remarks>
+    internal sealed class ProcessTreeResourceSampler
+    {
+        private static readonly Lazy<ProcessTreeResourceSampler> s_instance = new Lazy<ProcessTreeResourceSampler>(() => new ProcessTreeResourceSampler(), LazyThreadSafetyMode.ExecutionAndPublication);
+
+        /// <nodoc/>
+        public static ProcessTreeResourceSampler Instance => s_instance.Value;
+
+        /// <summary>
+        /// A periodic sample request, which stops when disposed.
+        /// </summary>
+        internal sealed class Registration : IDisposable
+        {
+            private readonly ProcessTreeResourceSampler m_sampler;
+
+            internal readonly int RootProcessId;
+            internal readonly long IntervalMs;
+            internal readonly Action<IReadOnlyList<ProcessResourceUsage>>? OnSample;
+            internal readonly Action? OnTick;
+            internal readonly List<ProcessResourceUsage> Snapshots = new List<ProcessResourceUsage>();
+
+            // Guarded by the sampler lock
+            internal long DueMs;
+
+            // Only accessed from the sampler thread. Tells the root process apart from a later process reusing its pid.
+            internal ulong RootStartTime;
+
+            // Guarded by locking the registration, which is held while the callbacks run
+            private bool m_disposed;
+
+            internal Registration(ProcessTreeResourceSampler sampler, int rootProcessId, TimeSpan interval, Action<IReadOnlyList<ProcessResourceUsage>>? onSample, Action? onTick)
+            {
+                m_sampler = sampler;
+                RootProcessId = rootProcessId;
+                IntervalMs = Math.Max(1, (long)interval.TotalMilliseconds);
+                OnSample = onSample;
+                OnTick = onTick;
+            }
+
+            internal void Invoke()
+            {
+                lock (this)
+                {
+                    if (m_disposed)
+                    {
+                        return;
+                    }
+
+                    try
+                    {
+                        if (OnSample != null)
+                        {
+                            OnSample(Snapshots);
+                        }
+                        else
+                        {
+                            OnTick!();
+                        }
+                    }
+                    catch (Exception)
+                    {
+                        Analysis.IgnoreException("Keep the sampler thread alive for the other registrations");
+                    }
+                }
+            }
+
+            /// <summary>
+            /// Stops sampling. Once this returns, the callback is not running and won't be invoked anymore.
+            /// </summary>
+            public void Dispose()
+            {
+                lock (this)
+                {
+                    m_disposed = true;
+                }
+
+                m_sampler.Unregister(this);
+            }
+        }
+
+        private sealed class ProcessEntry
+        {
+            // Process names (comm) are at most 15 bytes
+            private const int MaxNameLength = 16;
+
+            internal readonly int ProcessId;
+            internal int ParentProcessId;
+            internal ulong StartTime;
+            internal ulong UserTimeTicks;
+            internal ulong SystemTimeTicks;
+            internal long Generation;
+
+            // Children, linked through their NextSibling. Rebuilt on every scan.
+            internal ProcessEntry? FirstChild;
+            internal ProcessEntry? NextSibling;
+
+            private readonly byte[] m_nameBytes = new byte[MaxNameLength];
+            private int m_nameLength = -1;
+            private string m_name = string.Empty;
+
+            internal ProcessEntry(int processId)
+            {
+                ProcessId = processId;
+            }
+
+            /// <summary>
+            /// The name as a string, which is only created again when the process changes its name (exec).
+            /// </summary>
+            internal string Name => m_name;
+
+            internal void SetName(ReadOnlySpan<byte> name)
+            {
+                if (name.Length > MaxNameLength)
+                {
+                    name = name.Slice(0, MaxNameLength);
+                }
+
+                if (name.Length == m_nameLength && name.SequenceEqual(m_nameBytes.AsSpan(0, m_nameLength)))
+                {
+                    return;
+                }
+
+                name.CopyTo(m_nameBytes);
+                m_nameLength = name.Length;
+                m_name = System.Text.Encoding.UTF8.GetString(m_nameBytes, 0, m_nameLength);
+            }
+        }
+
+        private readonly object m_lock = new object();
+        private readonly List<Registration> m_registrations = new List<Registration>();
+        private readonly Stopwatch m_clock = Stopwatch.StartNew();
+
+        // Only accessed from the sampler thread
+        private readonly List<Registration> m_due = new List<Registration>();
+        private readonly Dictionary<int, ProcessEntry> m_processes = new Dictionary<int, ProcessEntry>();
+        private readonly List<int> m_processIds = new List<int>();
+        private readonly List<int> m_exitedProcessIds = new List<int>();
+        private readonly Stack<ProcessEntry> m_pending = new Stack<ProcessEntry>();
+        private long m_generation;
+
+        private ProcessTreeResourceSampler()
+        {
+            new Thread(Run)
+            {
+                Name = "ProcessTreeResourceSampler",
+                IsBackground = true,
+            }.Start();
+        }
+
+        /// <summary>
+        /// Samples the process tree rooted at <paramref name="rootProcessId"/> every <paramref name="interval"/>, passing the usage of each process
+        /// in the tree to <paramref name="onSample"/> (on the sampler thread). Sampling stops when the root process exits.
+        /// </summary>
+        /// <remarks>
+        /// The list passed to <paramref name="onSample"/> is reused by the next sample and must not be kept.
+        /// The registration is dropped by the first sample that finds the root process gone; disposing it afterwards is harmless.
+        /// </remarks>
+        public Registration RegisterProcessTree(int rootProcessId, TimeSpan interval, Action<IReadOnlyList<ProcessResourceUsage>> onSample)
+        {
+            return Register(new Registration(this, rootProcessId, interval, onSample, onTick: null));
+        }
+
+        /// <summary>
+        /// Invokes <paramref name="onTick"/> every <paramref name="interval"/> on the sampler thread, for samples that don't need the process table.
+        /// </summary>
+        public Registration RegisterCallback(TimeSpan interval, Action onTick)
+        {
+            return Register(new Registration(this, rootProcessId: -1, interval, onSample: null, onTick));
+        }
+
+        private Registration Register(Registration registration)
+        {
+            lock (m_lock)
+            {
+                registration.DueMs = NextDueMs(m_clock.ElapsedMilliseconds, registration.IntervalMs);
+                m_registrations.Add(registration);
+                Monitor.Pulse(m_lock);
+            }
+
+            return registration;
+        }
+
+        private void Unregister(Registration registration)
+        {
+            lock (m_lock)
+            {
+                m_registrations.Remove(registration);
+            }
+        }
+
+        // Due times are multiples of the interval, so that registrations with the same interval share the scans of /proc
+        private static long NextDueMs(long nowMs, long intervalMs) => (nowMs / intervalMs + 1) * intervalMs;
+
+        private void Run()
+        {
+            while (true)
+            {
+                lock (m_lock)
+                {
+                    while (!CollectDueRegistrations(out int waitMs))
+                    {
+                        Monitor.Wait(m_lock, waitMs);
+                    }
+                }
+
+                Sample();
+            }
+        }
+
+        /// <summary>
+        /// Fills <see cref="m_due"/> with the registrations due for a sample, or returns false with the time to wait until the next one is.
+        /// </summary>
+        private bool CollectDueRegistrations(out int waitMs)
+        {
+            m_due.Clear();
+
+            long nowMs = m_clock.ElapsedMilliseconds;
+            long nextDueMs = long.MaxValue;
+            foreach (var registration in m_registrations)
+            {
+                if (registration.DueMs <= nowMs)
+                {
+                    m_due.Add(registration);
+                    registration.DueMs = NextDueMs(nowMs, registration.IntervalMs);
+                }
+
+                nextDueMs = Math.Min(nextDueMs, registration.DueMs);
+            }
+
+            waitMs = nextDueMs == long.MaxValue ? Timeout.Infinite : (int)Math.Min(int.MaxValue, nextDueMs - nowMs);
+            return m_due.Count > 0;
+        }
+
+        private void Sample()
+        {
+            Span<byte> buffer = stackalloc byte[ProcFs.BufferSize];
+
+            bool scanned = false;
+            foreach (var registration in m_due)
+            {
+                if (registration.OnSample != null)
+                {
+                    if (!scanned)
+                    {
+                        ScanProcesses(buffer);
+                        scanned = true;
+                    }
+
+                    if (!CollectProcessTree(registration, buffer))
+                    {
+                        // The root process exited: nothing is left to sample, even if its owner only disposes the registration later
+                        Unregister(registration);
+                        continue;
+                    }
+                }
+
+                registration.Invoke();
+            }
+        }
+
+        /// <summary>
+        /// Updates the process table from /proc and links every process to its parent.
+        /// </summary>
+        private void ScanProcesses(Span<byte> buffer)
+        {
+            long generation = ++m_generation;
+
+            ProcFs.ListProcessIds(m_processIds);
+            foreach (int pid in m_processIds)
+            {
+                int length = ProcFs.ReadProcessFile(pid, ProcFs.ProcessFile.Stat, buffer);
+                if (length < 0 || !ProcFs.TryParseStat(buffer.Slice(0, length), out var stat, out var name))
+                {
+                    // Exited since /proc was listed
+                    continue;
+                }
+
+                if (!m_processes.TryGetValue(pid, out var entry) || entry.StartTime != stat.StartTimeTicks)
+                {
+                    entry = new ProcessEntry(pid);
+                    m_processes[pid] = entry;
+                }
+
+                entry.ParentProcessId = stat.ParentProcessId;
+                entry.StartTime = stat.StartTimeTicks;
+                entry.UserTimeTicks = stat.UserTimeTicks;
+                entry.SystemTimeTicks = stat.SystemTimeTicks;
+                entry.SetName(name);
+                entry.Generation = generation;
+                entry.FirstChild = null;
+                entry.NextSibling = null;
+            }
+
+            m_exitedProcessIds.Clear();
+            foreach (var entry in m_processes.Values)
+            {
+                if (entry.Generation != generation)
+                {
+                    m_exitedProcessIds.Add(entry.ProcessId);
+                }
+                else if (m_processes.TryGetValue(entry.ParentProcessId, out var parent) && parent != entry)
+                {
+                    entry.NextSibling = parent.FirstChild;
+                    parent.FirstChild = entry;
+                }
+            }
+
+            foreach (int pid in m_exitedProcessIds)
+            {
+                m_processes.Remove(pid);
+            }
+        }
+
+        /// <summary>
+        /// Fills the snapshots of <paramref name="registration"/> with the usage of the processes in its tree. Returns false if the root process is gone.
+        /// </summary>
+        private bool CollectProcessTree(Registration registration, Span<byte> buffer)
+        {
+            registration.Snapshots.Clear();
+
+            if (!m_processes.TryGetValue(registration.RootProcessId, out var root))
+            {
+                return false;
+            }
+
+            if (registration.RootStartTime == 0)
+            {
+                registration.RootStartTime = root.StartTime;
+            }
+            else if (registration.RootStartTime != root.StartTime)
+            {
+                // The pid now belongs to some other process
+                return false;
+            }
+
+            m_pending.Push(root);
+            while (m_pending.Count > 0)
+            {
+                var entry = m_pending.Pop();
+                for (var child = entry.FirstChild; child != null; child = child.NextSibling)
+                {
+                    m_pending.Push(child);
+                }
+
+                var usage = new ProcessResourceUsage()
+                {
+                    ProcessId = entry.ProcessId,
+                    Name = entry.Name,
+                    UserTimeMs = ProcFs.ClockTicksToMilliseconds(entry.UserTimeTicks),
+                    SystemTimeMs = ProcFs.ClockTicksToMilliseconds(entry.SystemTimeTicks),
+                };
+
+                // A process that exited since the scan is left out, so that its previous sample is kept instead
+                int length = ProcFs.ReadProcessFile(entry.ProcessId, ProcFs.ProcessFile.Io, buffer);
+                if (length < 0 || !ProcFs.TryParseIo(buffer.Slice(0, length), ref usage))
+                {
+                    continue;
+                }
+
+                length = ProcFs.ReadProcessFile(entry.ProcessId, ProcFs.ProcessFile.Status, buffer);
+                if (length < 0)
+                {
+                    continue;
+                }
+
+                ProcFs.ParseStatus(buffer.Slice(0, length), ref usage);
+                registration.Snapshots.Add(usage);
+            }
+
+            return true;
+        }
+    }
+}
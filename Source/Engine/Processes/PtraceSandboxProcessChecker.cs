@@ -8,15 +8,16 @@ namespace BuildXL.Processes
     /// <summary>
     /// Determines whether a Linux binary requires running under the ptrace sandbox.
     /// </summary>
+    /// <remarks>
+    /// Binaries are classified in-process by <see cref="ElfBinaryAnalyzer"/>, which reads their ELF headers and capabilities directly.
+    /// </remarks>
     public class PtraceSandboxProcessChecker
     {
-        private readonly UnixObjectFileDumpUtils m_dumpUtils;
-        private readonly UnixGetCapUtils m_getCapUtils;
+        private readonly ElfBinaryAnalyzer m_analyzer;
         
         private PtraceSandboxProcessChecker()
         {
-            m_dumpUtils = UnixObjectFileDumpUtils.CreateObjDump();
-            m_getCapUtils = UnixGetCapUtils.CreateGetCap();
+            m_analyzer = ElfBinaryAnalyzer.Instance;
         }
 
         /// <nodoc/>
@@ -25,20 +26,11 @@ namespace BuildXL.Processes
         /// <summary>
         /// Returns whether all the tools required to detect whether a binary requires the ptrace sandbox are installed in the system
         /// </summary>
+        /// <remarks>
+        /// Detection used to rely on objdump and getcap. It needs no external tools anymore, so this always succeeds.
+        /// </remarks>
         public static bool AreRequiredToolsInstalled(out string error)
         {
-            if (!UnixObjectFileDumpUtils.IsObjDumpInstalled.Value)
-            {
-                error = "The objdump utility is not installed on this machine. BuildXL uses this to detect processes that may not work properly with its sandbox. Please install it by running 'apt-get install binutils'.";
-                return false;
-            }
-
-            if (!UnixGetCapUtils.IsGetCapInstalled.Value)
-            {
-                error = "The getcap utility is not installed on this machine. BuildXL uses this to detect processes that may not work properly with its sandbox. Please install it by running 'apt-get install libcap-progs'.";
-                return false;
-            }
-
             error = string.Empty;
             return true;
         }
@@ -46,6 +38,6 @@ namespace BuildXL.Processes
         /// <summary>
         /// Returns whether the given binary requires ptrace
         /// </summary>
-        public bool BinaryRequiresPTraceSandbox(string binary) => m_dumpUtils.IsBinaryStaticallyLinked(binary) || m_getCapUtils.BinaryContainsCapabilities(binary);
+        public bool BinaryRequiresPTraceSandbox(string binary) => m_analyzer.TryAnalyze(binary, out var traits) && ElfBinaryAnalyzer.RequiresPTraceSandbox(traits);
     }
 }
@@ -0,0 +1,351 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Concurrent;
+using System.Diagnostics.ContractsLight;
+using System.Runtime.InteropServices;
+using System.Threading;
+using BuildXL.Interop.Linux;
+using BuildXL.Interop.Unix;
+using BuildXL.Utilities.Core;
+using Microsoft.Win32.SafeHandles;
+
+namespace BuildXL.Processes
+{
+    /// <summary>
+    /// Receives the length-prefixed messages read from a report FIFO by <see cref="ReportFifoReactor"/>.
+    /// </summary>
+    /// <remarks>
+    /// All the callbacks for a given FIFO are invoked from the same reactor thread, one at a time.
+    /// </remarks>
+    internal interface IReportFifoConsumer
+    {
+        /// <summary>
+        /// Returns a buffer of at least <paramref name="length"/> bytes for the message about to be read.
+        /// </summary>
+        PooledObjectWrapper<byte[]> GetMessageBuffer(int length);
+
+        /// <summary>
+        /// Takes ownership of a complete message of <paramref name="length"/> bytes. Returns false to stop receiving messages.
+        /// </summary>
+        bool OnMessage(PooledObjectWrapper<byte[]> message, int length);
+
+        /// <summary>
+        /// Handles a negative length, which the writers use as a sentinel rather than as a message. Returns false to stop receiving messages.
+        /// </summary>
+        bool OnSentinel(int sentinel);
+
+        /// <summary>
+        /// Invoked once the FIFO is no longer watched, so its read handle can be disposed.
+        /// <paramref name="failure"/> is null if the consumer asked to stop, and describes the failure otherwise.
+        /// </summary>
+        void OnStopped(string failure);
+    }
+
+    /// <summary>
+    /// Reads the report FIFOs of all the pips running under the Linux sandbox from a small, fixed set of threads.
+    /// </summary>
+    /// <remarks>
+    /// Instead of one thread per FIFO blocked in 'read', every FIFO is opened non-blocking and registered with the epoll instance
+    /// of one of the reactor threads. When a FIFO becomes readable its thread drains what is available in large chunks, reassembles the
+    /// length-prefixed messages (which may be split across reads) and hands them to the consumer of the FIFO. FIFOs are watched
+    /// level-triggered, and a thread reads a bounded amount from a FIFO before moving on to the next ready one, so a chatty pip can't
+    /// starve the others sharing the thread.
+    /// </remarks>
+    internal sealed class ReportFifoReactor
+    {
+        /// <summary>
+        /// Size of the chunks FIFOs are drained with. Matches the default capacity of a pipe.
+        /// </summary>
+        private const int ReadBufferSize = 64 * 1024;
+
+        /// <summary>
+        /// Maximum number of chunks read from a FIFO each time it is found ready.
+        /// </summary>
+        private const int MaxReadsPerEvent = 16;
+
+        private const int MaxEventsPerWait = 64;
+
+        private static readonly Lazy<ReportFifoReactor> s_instance = new Lazy<ReportFifoReactor>(() => new ReportFifoReactor(), LazyThreadSafetyMode.ExecutionAndPublication);
+
+        /// <nodoc/>
+        public static ReportFifoReactor Instance => s_instance.Value;
+
+        private readonly EventLoop[] m_loops;
+        private long m_lastRegistrationId;
+
+        private ReportFifoReactor()
+        {
+            // A thread comfortably keeps up with several pips, as most of the work happens on the processing blocks of each pip.
+            var threadCount = Math.Max(1, Math.Min(4, Environment.ProcessorCount / 16));
+            m_loops = new EventLoop[threadCount];
+            for (int i = 0; i < threadCount; i++)
+            {
+                m_loops[i] = new EventLoop(i);
+            }
+        }
+
+        /// <summary>
+        /// Starts reading from <paramref name="readHandle"/>, which must have been opened with <see cref="IO.OpenFlags.O_NONBLOCK"/>.
+        /// </summary>
+        /// <remarks>
+        /// The consumer is notified with <see cref="IReportFifoConsumer.OnStopped(string)"/> once reading stops, also when the
+        /// FIFO can't be registered. The read handle must stay open until then.
+        /// </remarks>
+        public void Register(SafeFileHandle readHandle, string fifoName, IReportFifoConsumer consumer)
+        {
+            Contract.Requires(readHandle != null && !readHandle.IsInvalid);
+
+            var id = (ulong)Interlocked.Increment(ref m_lastRegistrationId);
+            m_loops[id % (ulong)m_loops.Length].Register(new Registration(id, readHandle, fifoName, consumer));
+        }
+
+        /// <summary>
+        /// A FIFO being read, and the state of the message currently being reassembled.
+        /// </summary>
+        private sealed class Registration
+        {
+            internal readonly ulong Id;
+            internal readonly SafeFileHandle ReadHandle;
+            internal readonly string FifoName;
+            internal readonly IReportFifoConsumer Consumer;
+
+            private readonly byte[] m_lengthBytes = new byte[sizeof(int)];
+            private int m_lengthBytesRead;
+
+            private bool m_hasMessage;
+            private PooledObjectWrapper<byte[]> m_message;
+            private int m_messageLength;
+            private int m_messageBytesRead;
+
+            internal Registration(ulong id, SafeFileHandle readHandle, string fifoName, IReportFifoConsumer consumer)
+            {
+                Id = id;
+                ReadHandle = readHandle;
+                FifoName = fifoName;
+                Consumer = consumer;
+            }
+
+            /// <summary>
+            /// Feeds <paramref name="count"/> bytes read from the FIFO. Returns false once the consumer asked to stop, in which
+            /// case the bytes that follow are dropped.
+            /// </summary>
+            internal bool Consume(byte[] buffer, int count)
+            {
+                int offset = 0;
+                while (offset < count)
+                {
+                    if (!m_hasMessage)
+                    {
+                        int lengthBytes = Math.Min(m_lengthBytes.Length - m_lengthBytesRead, count - offset);
+                        Buffer.BlockCopy(buffer, offset, m_lengthBytes, m_lengthBytesRead, lengthBytes);
+                        offset += lengthBytes;
+                        m_lengthBytesRead += lengthBytes;
+
+                        if (m_lengthBytesRead < m_lengthBytes.Length)
+                        {
+                            break;
+                        }
+
+                        m_lengthBytesRead = 0;
+                        int length = BitConverter.ToInt32(m_lengthBytes, startIndex: 0);
+                        if (length < 0)
+                        {
+                            if (!Consumer.OnSentinel(length))
+                            {
+                                return false;
+                            }
+
+                            continue;
+                        }
+
+                        m_message = Consumer.GetMessageBuffer(length);
+                        m_hasMessage = true;
+                        m_messageLength = length;
+                        m_messageBytesRead = 0;
+                    }
+
+                    int messageBytes = Math.Min(m_messageLength - m_messageBytesRead, count - offset);
+                    Buffer.BlockCopy(buffer, offset, m_message.Instance, m_messageBytesRead, messageBytes);
+                    offset += messageBytes;
+                    m_messageBytesRead += messageBytes;
+
+                    if (m_messageBytesRead == m_messageLength)
+                    {
+                        m_hasMessage = false;
+                        if (!Consumer.OnMessage(m_message, m_messageLength))
+                        {
+                            return false;
+                        }
+                    }
+                }
+
+                return true;
+            }
+
+            /// <summary>
+            /// Releases the message that was being reassembled when reading stopped, if any.
+            /// </summary>
+            internal void ReleasePartialMessage()
+            {
+                if (m_hasMessage)
+                {
+                    m_hasMessage = false;
+                    m_message.Dispose();
+                }
+            }
+        }
+
+        /// <summary>
+        /// A reactor thread and the epoll instance watching the FIFOs assigned to it.
+        /// </summary>
+        private sealed class EventLoop
+        {
+            private readonly SafeFileHandle m_epoll;
+            private readonly ConcurrentDictionary<ulong, Registration> m_registrations = new ConcurrentDictionary<ulong, Registration>();
+            private readonly Epoll.EpollEvent[] m_events = new Epoll.EpollEvent[MaxEventsPerWait];
+
+            // Only used from the loop thread: messages are copied out of it before the next read.
+            private readonly byte[] m_readBuffer = new byte[ReadBufferSize];
+
+            private readonly Thread m_thread;
+
+            // Set if the loop can't wait for events anymore. FIFOs registered afterwards fail right away instead of never being read.
+            private volatile string m_failure;
+
+            internal EventLoop(int index)
+            {
+                m_epoll = Epoll.Create();
+                if (m_epoll.IsInvalid)
+                {
+                    m_failure = $"Creating the epoll instance for report FIFOs failed with errno {Marshal.GetLastWin32Error()}.";
+                    return;
+                }
+
+                m_thread = new Thread(Run)
+                {
+                    Name = $"ReportFifoReactor-{index}",
+                    IsBackground = true,
+                    Priority = ThreadPriority.Highest
+                };
+                m_thread.Start();
+            }
+
+            internal void Register(Registration registration)
+            {
+                // Add to the map first: the FIFO may become readable as soon as it is watched.
+                m_registrations[registration.Id] = registration;
+
+                string failure = m_failure;
+                if (failure == null)
+                {
+                    int error = Epoll.Add(m_epoll, registration.ReadHandle, Epoll.Events.EPOLLIN, registration.Id);
+                    if (error == 0)
+                    {
+                        return;
+                    }
+
+                    failure = $"Watching FIFO {registration.FifoName} for reports failed with errno {error}.";
+                }
+
+                if (m_registrations.TryRemove(registration.Id, out _))
+                {
+                    registration.Consumer.OnStopped(failure);
+                }
+            }
+
+            private void Run()
+            {
+                while (true)
+                {
+                    int count = Epoll.Wait(m_epoll, m_events, timeoutMs: -1);
+                    if (count < 0)
+                    {
+                        // Only possible if the epoll instance itself is broken. Fail the FIFOs being read rather than leaving their pips waiting forever.
+                        m_failure = $"Waiting for reports failed with errno {Marshal.GetLastWin32Error()}.";
+                        foreach (var registration in m_registrations.Values)
+                        {
+                            Stop(registration, m_failure);
+                        }
+
+                        return;
+                    }
+
+                    for (int i = 0; i < count; i++)
+                    {
+                        // The FIFO may have been stopped while handling a previous event of the same batch.
+                        if (m_registrations.TryGetValue(m_events[i].Data, out var registration))
+                        {
+                            Drain(registration);
+                        }
+                    }
+                }
+            }
+
+            private void Drain(Registration registration)
+            {
+                for (int reads = 0; reads < MaxReadsPerEvent; reads++)
+                {
+                    var numRead = IO.Read(registration.ReadHandle, m_readBuffer, 0, m_readBuffer.Length);
+                    if (numRead == 0) // EOF
+                    {
+                        // We don't expect EOF before the consumer saw the end of its reports: a write handle is kept open until then
+                        Stop(registration, "Exiting 'receive reports' loop on EOF without observing the end of reports sentinel value.");
+                        return;
+                    }
+
+                    if (numRead < 0)
+                    {
+                        int errno = Marshal.GetLastWin32Error();
+                        if (errno != Epoll.EAGAIN)
+                        {
+                            Stop(registration, $"Read from FIFO {registration.FifoName} failed with return value {numRead} (errno {errno}).");
+                        }
+
+                        // Otherwise the FIFO is drained. It will be reported again once more data arrives.
+                        return;
+                    }
+
+                    bool keepReading;
+                    try
+                    {
+                        keepReading = registration.Consume(m_readBuffer, numRead);
+                    }
+                    catch (Exception e)
+                    {
+                        Stop(registration, $"Could not process reports from FIFO {registration.FifoName}. Exception details: {e}");
+                        return;
+                    }
+
+                    if (!keepReading)
+                    {
+                        Stop(registration, failure: null);
+                        return;
+                    }
+
+                    // A short read means the FIFO was drained. Skip the read that would only find that out.
+                    if (numRead < m_readBuffer.Length)
+                    {
+                        return;
+                    }
+                }
+
+                // Data is still pending: level-triggered epoll reports the FIFO again after the other ready ones got their turn.
+            }
+
+            private void Stop(Registration registration, string failure)
+            {
+                if (!m_registrations.TryRemove(registration.Id, out _))
+                {
+                    return;
+                }
+
+                // Stop watching before the consumer disposes the read handle, as the descriptor may be reused right after.
+                Analysis.IgnoreResult(Epoll.Remove(m_epoll, registration.ReadHandle));
+                registration.ReleasePartialMessage();
+                registration.Consumer.OnStopped(failure);
+            }
+        }
+    }
+}
@@ -14,6 +14,7 @@ using System.Text;
 using System.Threading;
 using System.Threading.Tasks;
 using BuildXL.Interop;
+using BuildXL.Interop.Linux;
 using BuildXL.Interop.Unix;
 using BuildXL.Native.IO;
 using BuildXL.Utilities.Core;
@@ -67,23 +68,24 @@ namespace BuildXL.Processes
         internal sealed class Info : IDisposable
         {
             /// <summary>
-            /// Encapsulates both a background thread that is processing incoming messages, and an action block that is processing said messages.
+            /// Encapsulates the receiving end of a FIFO, served by the shared <see cref="ReportFifoReactor"/>, and an action block that is processing the incoming messages.
             /// </summary>
             /// <remarks>
             /// The intention is for report processors use the same backing <see cref="SandboxConnectionLinuxDetours.Info"/> to ultimately process the incoming messages 
             /// (using <see cref="Info.ProcessBytes(ValueTuple{ReportProcessor, PooledObjectWrapper{byte[]}, int})"/>), because all the messages are associated to the same sandbox,
-            /// but use different FIFOs (and thus consuming threads and processing action blocks). 
-            /// We expose a <see cref="JoinReceivingThread"/> method to join the receiving thread, the <see cref="Completion"/> property of the message-processing action block and 
+            /// but use different FIFOs (and thus different reactor registrations and processing action blocks). 
+            /// We expose a <see cref="WaitForReceivingToStop"/> method to wait until the FIFO is no longer read, the <see cref="Completion"/> property of the message-processing action block and 
             /// a <see cref="Complete"/> to stop receiving access reports.
             /// </remarks>
-            internal sealed class ReportProcessor
+            internal sealed class ReportProcessor : IReportFifoConsumer
             {
                 internal readonly Info Info;
-                private readonly Thread m_workerThread;
                 private readonly ActionBlockSlim<(ReportProcessor reportProcessor, PooledObjectWrapper<byte[]> wrapper, int length)> m_processingBlock;
                 private int m_completeAccessReportProcessingCounter;
                 private readonly string m_fifoName;
                 private readonly Lazy<SafeFileHandle> m_fifoWriteHandle;
+                private SafeFileHandle m_readHandle;
+                private readonly ManualResetEventSlim m_receivingStopped = new ManualResetEventSlim(initialState: false);
                 
                 // We use these two to synchronize sending a sentinel via the write handle and disposing the read handle. Trying to write to a FIFO with no read handles open
                 // produces an error (a broken pipe)
@@ -101,22 +103,58 @@ namespace BuildXL.Processes
                     m_fifoName = fifoName;
                     m_fifoWriteHandle = fifoHandle;
 
-                    m_workerThread = new Thread(() => StartReceivingAccessReports(m_fifoName, fifoHandle))
-                    {
-                        IsBackground = true,
-                        Priority = ThreadPriority.Highest
-                    };
-
                     m_processingBlock = ActionBlockSlim.Create<(ReportProcessor reportProcessor, PooledObjectWrapper<byte[]> wrapper, int length)>(degreeOfParallelism: 1,
                         Info.ProcessBytes,
-                        singleProducedConstrained: true, // Only m_workerThread posts to the action block
+                        singleProducedConstrained: true, // Only the reactor thread the FIFO is registered with posts to the action block
                         failFastOnUnhandledException: true
                     );
 
                     IsPrimaryFifoProcessor = m_fifoWriteHandle == info.m_lazyWriteHandle;
                 }
 
-                internal void Start() => m_workerThread.Start();
+                /// <summary>
+                /// Starts receiving access reports.
+                /// </summary>
+                /// <remarks>
+                /// The way we deal with the decision about when to stop reading messages from the FIFO deserves some details:
+                /// * Messages are read from the FIFO by the <see cref="ReportFifoReactor"/> and posted to an action block <see cref="m_processingBlock"/>, which processes them async.
+                /// * A write handle <see cref="m_lazyWriteHandle"/> is kept open to avoid reaching EOF if other writers (running tools) happen to close the FIFO
+                /// * The potential end of the receive loop is triggered by removing the last active process from <see cref="m_activeProcesses"/>. This
+                ///   can happen because the <see cref="ProcessExitWatcher"/> (or, when process exits can't be watched, the <see cref="m_activeProcessesChecker"/>)
+                ///   detected than an active process is no longer alive or because a process exited report is seen. When this case is reached a special message <see cref="NoActiveProcessesSentinel"/> is sent from this
+                ///   same loop. Sentinels are just special messages used for synchronization purposes.
+                /// * Sending <see cref="NoActiveProcessesSentinel"/> *may* result in ending this processing loop: when <see cref="NoActiveProcessesSentinel"/> is sent, 
+                ///   other messages may still be on the processing pipe of <see cref="m_processingBlock"/> (e.g. observe that the active process checker runs in a separate 
+                ///   thread, and the point in time when the sentinel is sent is not synchronized with the point in time when we processed all reports). When we get to 
+                ///   processing the sentinel and if 'start process' reports had arrived, we just ignore the sentinel and keep processing messages. We will eventually
+                ///   reach again 0 processes and the sentinel will be sent another time.
+                /// * If <see cref="NoActiveProcessesSentinel"/> arrives and we see 0 active processes, we can safely exit the loop. In this case we send another
+                ///   sentinel <see cref="EndOfReportsSentinel"/>. Instead of this we could just close <see cref="m_lazyWriteHandle"/> and let the receiving loop reach an EOF,
+                ///   but this proved to be slow in some cases (since it is likely depending on some GC process). So instead we send a sentinel. The loop can safely exit when we
+                ///   see this since no pending messages can be left to be processed (we saw the <see cref="NoActiveProcessesSentinel"/> on the other end of the pipe at the 
+                ///   same pipe there were 0 active processes).
+                /// * A note on the secondary FIFO: the processing loop for the secondary FIFO (used to communicate ptrace specific messages) goes through the same flow, with the 
+                ///   caveat that we only initiate the tear down process of the seconday FIFO once the decide to exit the primary FIFO via <see cref="EndOfReportsSentinel"/>. The reason
+                ///   is that we want the secondary FIFO to be alive throughout the lifetime of the first FIFO. 
+                /// </remarks>
+                internal void Start()
+                {
+                    // opening FIFO for reading. Non-blocking, so this does not wait for a writer to connect: the reactor only
+                    // sees the FIFO become readable once one did
+                    LogDebug($"Opening FIFO '{m_fifoName}' for reading");
+
+                    m_readHandle = IO.Open(m_fifoName, IO.OpenFlags.O_RDONLY | IO.OpenFlags.O_NONBLOCK, 0);
+                    if (m_readHandle.IsInvalid)
+                    {
+                        OnStopped($"Opening FIFO {m_fifoName} for reading failed.");
+                        return;
+                    }
+
+                    // make sure that m_lazyWriteHandle has been created (this doesn't block, as the FIFO has a reader now)
+                    Analysis.IgnoreResult(m_fifoWriteHandle.Value);
+
+                    ReportFifoReactor.Instance.Register(m_readHandle, m_fifoName, this);
+                }
 
                 internal void Complete()
                 {
@@ -144,155 +182,91 @@ namespace BuildXL.Processes
                 /// <nodoc />
                 internal Task Completion => m_processingBlock.Completion;
 
-                /// <nodoc />
-                internal void JoinReceivingThread() => m_workerThread.Join();
-
-                private static int Read(SafeFileHandle handle, byte[] buffer, int offset, int length)
-                {
-                    Contract.Requires(buffer.Length >= offset + length);
-                    int totalRead = 0;
-                    while (totalRead < length)
-                    {
-                        var numRead = IO.Read(handle, buffer, offset + totalRead, length - totalRead);
-                        if (numRead <= 0)
-                        {
-                            return numRead;
-                        }
-                        totalRead += numRead;
-                    }
-
-                    return totalRead;
-                }
+                /// <summary>
+                /// Blocks until the FIFO is no longer read.
+                /// </summary>
+                internal void WaitForReceivingToStop() => m_receivingStopped.Wait();
 
                 private void LogDebug(string s) => Info.Process.LogDebug(s);
 
                 private void LogError(string s) => Info.LogError(s);
 
-                /// <summary>
-                /// The method backing the <see cref="m_workerThread"/> thread.
-                /// </summary>
-                /// <remarks>
-                /// The way we deal with the decision about when to stop reading messages from the FIFO deserves some details:
-                /// * Messages are read from the FIFO and posted to an action block <see cref="m_processingBlock"/>, which processes them async.
-                /// * A write handle <see cref="m_lazyWriteHandle"/> is kept open to avoid reaching EOF if other writers (running tools) happen to close the FIFO
-                /// * The potential end of the receive loop is triggered by removing the last active process from <see cref="m_activeProcesses"/>. This
-                ///   can happen because the <see cref="m_activeProcessesChecker"/> detected than an active process is no longer alive or because 
-                ///   a process exited report is seen. When this case is reached a special message <see cref="NoActiveProcessesSentinel"/> is sent from this
-                ///   same loop. Sentinels are just special messages used for synchronization purposes.
-                /// * Sending <see cref="NoActiveProcessesSentinel"/> *may* result in ending this processing loop: when <see cref="NoActiveProcessesSentinel"/> is sent, 
-                ///   other messages may still be on the processing pipe of <see cref="m_processingBlock"/> (e.g. observe that the active process checker runs in a separate 
-                ///   thread, and the point in time when the sentinel is sent is not synchronized with the point in time when we processed all reports). When we get to 
-                ///   processing the sentinel and if 'start process' reports had arrived, we just ignore the sentinel and keep processing messages. We will eventually
-                ///   reach again 0 processes and the sentinel will be sent another time.
-                /// * If <see cref="NoActiveProcessesSentinel"/> arrives and we see 0 active processes, we can safely exit the loop. In this case we send another
-                ///   sentinel <see cref="EndOfReportsSentinel"/>. Instead of this we could just close <see cref="m_lazyWriteHandle"/> and let the receiving loop reach an EOF,
-                ///   but this proved to be slow in some cases (since it is likely depending on some GC process). So instead we send a sentinel. The loop can safely exit when we
-                ///   see this since no pending messages can be left to be processed (we saw the <see cref="NoActiveProcessesSentinel"/> on the other end of the pipe at the 
-                ///   same pipe there were 0 active processes).
-                /// * A note on the secondary FIFO: the processing loop for the secondary FIFO (used to communicate ptrace specific messages) goes through the same flow, with the 
-                ///   caveat that we only initiate the tear down process of the seconday FIFO once the decide to exit the primary FIFO via <see cref="EndOfReportsSentinel"/>. The reason
-                ///   is that we want the secondary FIFO to be alive throughout the lifetime of the first FIFO. 
-                /// </remarks>
-                private void StartReceivingAccessReports(string fifoName, Lazy<SafeFileHandle> fifoHandle)
-                {
-                    // opening FIFO for reading (blocks until there is at least one writer connected)
-                    LogDebug($"Opening FIFO '{fifoName}' for reading");
+                /// <inheritdoc />
+                PooledObjectWrapper<byte[]> IReportFifoConsumer.GetMessageBuffer(int length) => ByteArrayPool.GetInstance(length);
 
-                    var readHandle = IO.Open(fifoName, IO.OpenFlags.O_RDONLY, 0);
+                /// <inheritdoc />
+                bool IReportFifoConsumer.OnMessage(PooledObjectWrapper<byte[]> message, int length)
+                {
+                    // Add message to processing queue
                     try
                     {
-                        if (readHandle.IsInvalid)
-                        {
-                            LogError($"Opening FIFO {fifoName} for reading failed.");
-                            return;
-                        }
-
-                        // make sure that m_lazyWriteHandle has been created
-                        Analysis.IgnoreResult(fifoHandle.Value);
-
-                        byte[] messageLengthBytes = new byte[sizeof(int)];
-                        while (true)
-                        {
-                            // read length
-                            var numRead = Read(readHandle, messageLengthBytes, 0, messageLengthBytes.Length);
-                            if (numRead == 0) // EOF
-                            {
-                                // We don't expect EOF before reading the EndOfReportsSentinel (see below)
-                                LogError("Exiting 'receive reports' loop on EOF without observing the end of reports sentinel value.");
-                                break;
-                            }
+                        m_processingBlock.Post((this, message, length), throwOnFullOrComplete: true);
+                        return true;
+                    }
+                    catch (Exception e)
+                    {
+                        Analysis.IgnoreException("Will error and exit on LogError");
+                        LogError($"Could not post message to the processing block for {m_fifoName}. Exception details: {e}");
+                        message.Dispose();
+                        return false;
+                    }
+                }
 
-                            if (numRead < 0) // error
-                            {
-                                LogError($"Read from FIFO {fifoName} failed with return value {numRead}.");
-                                break;
-                            }
+                /// <inheritdoc />
+                bool IReportFifoConsumer.OnSentinel(int sentinel)
+                {
+                    // The process tree we know about so far has completed. We might still
+                    // have 'process start' reports to be processed, so we just send this sentinel and let the processing block decide.
+                    if (sentinel == NoActiveProcessesSentinel)
+                    {
+                        m_processingBlock.Post((this, ByteArrayPool.GetInstance(0), NoActiveProcessesSentinel), throwOnFullOrComplete: true);
+                        return true;
+                    }
 
-                            // decode length
-                            int messageLength = BitConverter.ToInt32(messageLengthBytes, startIndex: 0);
+                    // We processed all pending messages in the processing block and didn't see any active processes, we can exit the loop
+                    if (sentinel == EndOfReportsSentinel)
+                    {
+                        LogDebug($"End of reports sentinel arrived on FIFO {m_fifoName}. Exiting 'receive reports' loop.");
 
-                            // The process tree we know about so far has completed. We might still
-                            // have 'process start' reports to be processed, so we just send this sentinel and let the processing block decide.
-                            if (messageLength == NoActiveProcessesSentinel)
-                            {
-                                m_processingBlock.Post((this, ByteArrayPool.GetInstance(0), NoActiveProcessesSentinel), throwOnFullOrComplete: true);
-                                continue;
-                            }
+                        // The primary FIFO has no more reports. Terminate the secondary FIFO.
+                        if (IsPrimaryFifoProcessor && !string.IsNullOrEmpty(Info.SecondaryFifoPath))
+                        {
+                            // This runs on the reactor thread, so the write must not block (see WriteSentinel)
+                            Info.WriteSentinel(Info.m_lazySecondaryFifoWriteHandle, s_noActiveProcessesSentinelAsBytes);
 
-                            // We processed all pending messages in the processing block and didn't see any active processes, we can exit the loop
-                            if (messageLength == EndOfReportsSentinel)
-                            {
-                                LogDebug($"End of reports sentinel arrived on FIFO {fifoName}. Exiting 'receive reports' loop.");
+                            LogDebug("NoProcessesSentinel sent to secondary FIFO");
+                        }
 
-                                // The primary FIFO has no more reports. Terminate the secondary FIFO.
-                                if (IsPrimaryFifoProcessor && !string.IsNullOrEmpty(Info.SecondaryFifoPath))
-                                {
-                                    Info.WriteSentinel(Info.m_lazySecondaryFifoWriteHandle, s_noActiveProcessesSentinelAsBytes);
+                        return false;
+                    }
 
-                                    LogDebug("NoProcessesSentinel sent to secondary FIFO");
-                                }
+                    LogError($"Read from FIFO {m_fifoName} failed: invalid message length {sentinel}.");
+                    return false;
+                }
 
-                                break;
-                            }
+                /// <inheritdoc />
+                void IReportFifoConsumer.OnStopped(string failure) => OnStopped(failure);
 
-                            // read a message of that length
-                            PooledObjectWrapper<byte[]> messageBytes = ByteArrayPool.GetInstance(messageLength);
-                            numRead = Read(readHandle, messageBytes.Instance, 0, messageLength);
-                            if (numRead < messageLength)
-                            {
-                                LogError($"Read from FIFO {fifoName} failed: read only {numRead} out of {messageLength} bytes.");
-                                messageBytes.Dispose();
-                                break;
-                            }
+                private void OnStopped(string failure)
+                {
+                    if (failure != null)
+                    {
+                        LogError(failure);
+                    }
 
-                            // Add message to processing queue
-                            try
-                            {
-                                m_processingBlock.Post((this, messageBytes, messageLength), throwOnFullOrComplete: true);
-                            }
-                            catch (Exception e)
-                            {
-                                Analysis.IgnoreException("Will error and exit on LogError");
-                                LogError($"Could not post message to the processing block for {fifoName}. Exception details: {e}");
-                                break;
-                            }
-                        }
+                    LogDebug($"Completed receiving access reports for fifo '{m_fifoName}'");
 
-                        LogDebug($"Completed receiving access reports for fifo '{fifoName}'");
-                    }
-                    finally
+                    // Synchronize the disposal to make sure we don't try to send a sentinel (e.g. the active process checker seeing 0 processes)
+                    // while disposing the read handle
+                    lock (ReadHandleLock)
                     {
-                        // Synchronize the disposal to make sure we don't try to send a sentinel (e.g. the active process checker seeing 0 processes)
-                        // while disposing the read handle
-                        lock (ReadHandleLock)
-                        {
-                            LogDebug($"Disposing read handle for fifo '{fifoName}'");
-                            m_readHandleDisposed = true;
-                            readHandle.Dispose();
-                        }
+                        LogDebug($"Disposing read handle for fifo '{m_fifoName}'");
+                        m_readHandleDisposed = true;
+                        m_readHandle.Dispose();
                     }
 
                     CompleteAccessReportProcessing();
+                    m_receivingStopped.Set();
                 }
             }
 
@@ -344,13 +318,30 @@ namespace BuildXL.Processes
             /// </remarks>
             private bool m_ptraceRunnerWasRequestedForPip = false; 
 
+            /// <summary>
+            /// Polls for active processes that are no longer alive. Only used when the exit of some active process can't be watched
+            /// by the <see cref="ProcessExitWatcher"/> (e.g. the kernel does not support pidfds).
+            /// </summary>
             private readonly CancellableTimedAction m_activeProcessesChecker;
+
+            /// <summary>
+            /// Ids of the <see cref="ProcessExitWatcher"/> watches of the active processes, by pid.
+            /// </summary>
+            private readonly ConcurrentDictionary<int, ulong> m_exitWatches = new ConcurrentDictionary<int, ulong>();
+
+            // Whether the exit of some process could not be watched, so we have to poll for it with the active process checker
+            private bool m_exitTrackingIncomplete = false;
+
+            // Whether we are waiting for processes that outlived the root process (i.e., the point where the active process checker would be started was reached)
+            private bool m_waitingForOrphanProcesses = false;
+            private readonly object m_exitTrackingLock = new object();
             private readonly Lazy<SafeFileHandle> m_lazyWriteHandle;
             private readonly Lazy<SafeFileHandle> m_lazySecondaryFifoWriteHandle;
 
             private readonly ReportProcessor m_reportProcessor;
             private readonly ReportProcessor m_secondaryReportProcessor;
             private static readonly TimeSpan s_activeProcessesCheckerInterval = TimeSpan.FromSeconds(1);
+            private static readonly TimeSpan s_sentinelRetryDelay = TimeSpan.FromMilliseconds(10);
 
             // These are just the byte representations of the sentinel values, so we don't need to compute them over and over
             private static readonly byte[] s_noActiveProcessesSentinelAsBytes = BitConverter.GetBytes(NoActiveProcessesSentinel);
@@ -380,10 +371,10 @@ namespace BuildXL.Processes
                 // the 'read' syscall won't receive EOF until we close this writer
                 m_lazyWriteHandle = GetLazyWriteHandle(ReportsFifoPath);
 
-                // will start a background thread for reading from the FIFO
+                // will register the FIFO with the shared report reactor once started
                 m_reportProcessor = new ReportProcessor(this, ReportsFifoPath, m_lazyWriteHandle);
 
-                // Second thread for reading the secondary FIFO
+                // Second registration for reading the secondary FIFO
                 // The secondary pipe is used here to allow for messages that are higher priority (such as ptrace notifications)
                 // to be delivered back to the managed layer faster if the fifo used for file access reports is congested.
                 Task secondaryCompletion = Task.CompletedTask;
@@ -410,8 +401,9 @@ namespace BuildXL.Processes
             {
                 return new Lazy<SafeFileHandle>(() =>
                 {
+                    // Non-blocking, so that sentinels are never written while blocking the reactor thread or holding the read handle lock (see WriteSentinel)
                     LogDebug($"Opening FIFO '{path}' for writing");
-                    return IO.Open(path, IO.OpenFlags.O_WRONLY, 0);
+                    return IO.Open(path, IO.OpenFlags.O_WRONLY | IO.OpenFlags.O_NONBLOCK, 0);
                 });
             }
 
@@ -424,6 +416,114 @@ namespace BuildXL.Processes
                 m_secondaryReportProcessor?.Start();
             }
 
+            /// <summary>
+            /// Starts waiting for the processes that outlived the root process. Only polls for them if the exit of some of them is not watched.
+            /// </summary>
+            private void StartWaitingForOrphanProcesses()
+            {
+                bool poll;
+                lock (m_exitTrackingLock)
+                {
+                    m_waitingForOrphanProcesses = true;
+                    poll = m_exitTrackingIncomplete;
+                }
+
+                if (poll)
+                {
+                    // If the active process checker was started already, this call has no effect.
+                    m_activeProcessesChecker.Start();
+                    return;
+                }
+
+                // Exits are reported as they happen, so there is nothing to poll for. Breakaway processes are the only ones we stop waiting for while alive.
+                RemoveBreakawayProcesses();
+            }
+
+            /// <summary>
+            /// Falls back to polling for the processes whose exit is not watched.
+            /// </summary>
+            private void FallBackToPolling()
+            {
+                lock (m_exitTrackingLock)
+                {
+                    m_exitTrackingIncomplete = true;
+                    if (!m_waitingForOrphanProcesses)
+                    {
+                        // StartWaitingForOrphanProcesses will start polling
+                        return;
+                    }
+                }
+
+                m_activeProcessesChecker.Start();
+            }
+
+            /// <summary>
+            /// Whether processes that outlived the root process are waited for without polling, in which case breakaway processes need to be removed
+            /// as soon as they are known.
+            /// </summary>
+            private bool IsWaitingForOrphanProcessesWithoutPolling()
+            {
+                lock (m_exitTrackingLock)
+                {
+                    return m_waitingForOrphanProcesses && !m_exitTrackingIncomplete;
+                }
+            }
+
+            /// <summary>
+            /// Starts watching the exit of <paramref name="pid"/>, so it is removed as soon as it exits even if its exit report never arrives.
+            /// </summary>
+            private void WatchProcessExit(int pid)
+            {
+                switch (ProcessExitWatcher.Instance.Watch(pid, OnProcessExited, out var watchId))
+                {
+                    case ProcessExitWatcher.WatchResult.Watching:
+                        m_exitWatches[pid] = watchId;
+                        break;
+                    case ProcessExitWatcher.WatchResult.AlreadyExited:
+                        LogDebug($"WatchProcessExit({pid}) :: Process is not alive, removing.");
+                        RemovePid(pid);
+                        break;
+                    default:
+                        LogDebug($"WatchProcessExit({pid}) :: Process exit can't be watched. Falling back to polling.");
+                        FallBackToPolling();
+                        break;
+                }
+            }
+
+            private void OnProcessExited(int pid, ulong watchId, bool exited)
+            {
+                bool wasCurrentWatch = m_exitWatches.TryRemove(new KeyValuePair<int, ulong>(pid, watchId));
+
+                if (!exited)
+                {
+                    LogDebug($"OnProcessExited({pid}) :: Process exit is no longer watched. Falling back to polling.");
+                    FallBackToPolling();
+                    return;
+                }
+
+                // The pid may have been reused by a process started after this one was removed
+                if (!wasCurrentWatch && m_exitWatches.ContainsKey(pid))
+                {
+                    return;
+                }
+
+                LogDebug($"OnProcessExited({pid}) :: Process is not alive, removing.");
+                RemovePid(pid);
+            }
+
+            private void RemoveBreakawayProcesses()
+            {
+                foreach (var pid in m_activeProcesses.Keys)
+                {
+                    // We shouldn't wait for a breakaway process after the main root process exited.
+                    if (m_breakawayProcesses.TryGetValue(pid, out _))
+                    {
+                        LogDebug($"RemoveBreakawayProcesses. Process {pid} is a breakaway, removing.");
+                        RemovePid(pid);
+                    }
+                }
+            }
+
             private void CheckActiveProcesses()
             {
                 foreach (var pid in m_activeProcesses.Keys)
@@ -462,8 +562,23 @@ namespace BuildXL.Processes
                 }
 
                 m_activeProcessesChecker.Cancel();
+
+                foreach (var watchId in m_exitWatches.Values)
+                {
+                    ProcessExitWatcher.Instance.Unwatch(watchId);
+                }
+
+                m_exitWatches.Clear();
             }
 
+            /// <summary>
+            /// Writes a sentinel to a FIFO without blocking the calling thread.
+            /// </summary>
+            /// <remarks>
+            /// Sentinels are written from the shared reactor and exit watcher threads, which also drain the FIFOs of every pip, so a write blocked on a full
+            /// FIFO could never complete. The write handles are non-blocking instead: when the FIFO is full, the write is retried from the thread pool
+            /// once the reactor had some time to drain it. The sentinel is small enough to be written atomically, so it is either written whole or not at all.
+            /// </remarks>
             private void WriteSentinel(Lazy<SafeFileHandle> writeHandle, byte[] sentinelBytes)
             {
                 var reportProcessor = GetReportProcessorFor(writeHandle);
@@ -487,7 +602,15 @@ namespace BuildXL.Processes
                     var bytesWritten = Write(writeHandle.Value, sentinelBytes, 0, sentinelBytes.Length);
                     if (bytesWritten < 0) // error
                     {
-                        string win32Message = new Win32Exception(Marshal.GetLastWin32Error()).Message;
+                        int errno = Marshal.GetLastWin32Error();
+                        if (errno == Epoll.EAGAIN)
+                        {
+                            // The FIFO is full. Retry outside of the lock, so the read handle can still be disposed in the meantime.
+                            Task.Delay(s_sentinelRetryDelay).ContinueWith(_ => WriteSentinel(writeHandle, sentinelBytes));
+                            return;
+                        }
+
+                        string win32Message = new Win32Exception(errno).Message;
 
                         StackTrace stackTrace = new StackTrace();
 
@@ -532,6 +655,11 @@ namespace BuildXL.Processes
                 {
                     LogDebug($"AddPid({pid}) :: New process is reusing a breakaway pid presumably dead");
                 }
+
+                if (added)
+                {
+                    WatchProcessExit(pid);
+                }
             }
 
             /// <summary>
@@ -574,6 +702,11 @@ namespace BuildXL.Processes
                     }
                 }
 
+                if (removed && m_exitWatches.TryRemove(pid, out var watchId))
+                {
+                    ProcessExitWatcher.Instance.Unwatch(watchId);
+                }
+
                 if (removed && m_activeProcesses.IsEmpty)
                 {
                     LogDebug($"Removed {pid} and the active count is 0. Sending sentinel on primary FIFO");
@@ -586,17 +719,17 @@ namespace BuildXL.Processes
                 }
                 else if (removed && pid == Process.ProcessId)
                 {
-                    LogDebug($"Root process {pid} was removed. Starting the active process checker.");
+                    LogDebug($"Root process {pid} was removed. Waiting for the orphan processes.");
 
                     // We just removed the root process and there are still active processes left
-                    //   => start periodically checking if they are still alive, because we don't
-                    //      have a reliable mechanism for receiving those events straight from the
+                    //   => rely on their exits being watched, or else start periodically checking if they are still alive,
+                    //      because we don't have a reliable mechanism for receiving those events straight from the
                     //      child processes (e.g., if they crash, we might not hear about it)
                     //
                     // Observe also that we do have a reliable mechanism for detecting when the
                     // root process exits (even if it crashes): see NotifyRootProcessExited below,
                     // which is guaranteed to be called by SandboxedProcessUnix.
-                    m_activeProcessesChecker.Start();
+                    StartWaitingForOrphanProcesses();
                 }
             }
 
@@ -630,14 +763,14 @@ namespace BuildXL.Processes
                 Analysis.IgnoreResult(FileUtilities.TryDeleteFile(FamPath, retryOnFailure: false));
                 if (m_isInTestMode)
                 {
-                    // The worker thread should complete in all but most extreme cases.  One such extreme case
+                    // Receiving should stop in all but most extreme cases.  One such extreme case
                     // is when the underlying filesystems crashes or shuts down completely (which is possible,
                     // especially if that's a custom-implemented filesystem running in user space).  When that
-                    // happens, some write handled to the created FIFO may remain open, so the 'read' call in
-                    // 'StartReceivingAccessReports' may remain stuck forever.
-                    LogDebug("Waiting for the worker thread to complete");
-                    m_reportProcessor.JoinReceivingThread();
-                    m_secondaryReportProcessor?.JoinReceivingThread();
+                    // happens, some write handled to the created FIFO may remain open, so the FIFO may never
+                    // deliver the end of reports sentinel nor reach EOF.
+                    LogDebug("Waiting for the FIFOs to stop being read");
+                    m_reportProcessor.WaitForReceivingToStop();
+                    m_secondaryReportProcessor?.WaitForReceivingToStop();
                 }
             }
 
@@ -665,12 +798,11 @@ namespace BuildXL.Processes
                             LogDebug($"NoActiveProcessesSentinel received for fifo {item.processor.GetFifoName()} but {m_activeProcesses.Count} processes were detected. This means new start process reports arrived afterwards. The sentinel is ignored.");
 
                             // Observe that this is a case where at some point we reached 0 active processes but new process start events arrived afterwards
-                            // The root process has exited already (since we reached 0 processes), and we might be in a case where the active process checker
-                            // has not started (when the last process to exit before reaching 0 was the root process). Start it now to account for the orphan 
+                            // The root process has exited already (since we reached 0 processes), and we might be in a case where we are not waiting for orphan
+                            // processes yet (when the last process to exit before reaching 0 was the root process). Start now to account for the orphan 
                             // processes that started since then.
-                            // If the active process checker was started already, this call has no effect.
-                            LogDebug($"NoActiveProcessesSentinel was ignored. Starting the active process checker to account for newly added orphan processes.");
-                            m_activeProcessesChecker.Start();
+                            LogDebug($"NoActiveProcessesSentinel was ignored. Waiting for newly added orphan processes.");
+                            StartWaitingForOrphanProcesses();
                         }
 
                         return;
@@ -776,6 +908,12 @@ namespace BuildXL.Processes
                     {
                         LogDebug($"Received FileOperation.ProcessBreakaway for pid {report.ProcessId})");
                         m_breakawayProcesses[(int)report.ProcessId] = 0;
+
+                        // Without polling, nobody else would get to remove it
+                        if (IsWaitingForOrphanProcessesWithoutPolling())
+                        {
+                            RemoveBreakawayProcesses();
+                        }
                     }
 
                     // Let's check for linux-specific reports that we want to ignore
@@ -0,0 +1,24 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+namespace BuildXL.Processes
+{
+    /// <summary>
+    /// Format of the sandbox trace file (see <see cref="SandboxedProcessInfo.CreateSandboxTraceFile"/>).
+    /// </summary>
+    public enum SandboxTraceFormat : byte
+    {
+        /// <summary>
+        /// The UTF-8 text format, which pips may consume. It is converted from the binary trace when the pip completes.
+        /// </summary>
+        Text = 0,
+
+        /// <summary>
+        /// The compressed binary format the trace is streamed in while the pip runs, left as is when the pip completes.
+        /// </summary>
+        /// <remarks>
+        /// Use <see cref="SandboxedProcessTraceConverter"/> to produce the text format on demand.
+        /// </remarks>
+        Binary = 1,
+    }
+}
@@ -63,6 +63,7 @@ namespace BuildXL.Processes
         private readonly SandboxedProcessTraceBuilder? m_traceBuilder;
         private readonly SandboxedProcessReports m_reports;
         private IAsyncPipeReader? m_reportReader;
+        private bool m_reportProcessingStopped;
         private readonly SemaphoreSlim m_reportReaderSemaphore = TaskUtilities.CreateMutex();
         private Dictionary<uint, ReportedProcess>? m_survivingChildProcesses;
         private readonly uint m_timeoutMins;
@@ -122,7 +123,7 @@ namespace BuildXL.Processes
                     info.StandardErrorObserver);
 
             m_traceBuilder = info.CreateSandboxTraceFile
-                ? new SandboxedProcessTraceBuilder(info.FileStorage, info.PathTable)
+                ? new SandboxedProcessTraceBuilder(info.FileStorage, info.PathTable, info.SandboxTraceFormat)
                 : null;
 
             m_reports = new SandboxedProcessReports(
@@ -383,6 +384,8 @@ namespace BuildXL.Processes
             m_output.Dispose();
             m_error.Dispose();
 
+            m_traceBuilder?.Dispose();
+
             m_fileAccessManifestStreamWrapper.Dispose();
         }
 
@@ -507,13 +510,13 @@ namespace BuildXL.Processes
                     }
                 }
 
-                StreamDataReceived reportLineReceivedCallback = ReportLineReceived;
+                StreamLinesReceived reportLinesReceivedCallback = ReportLinesReceived;
 
                 if (useManagedPipeReader)
                 {
                     m_reportReader = PipeReaderFactory.CreateManagedPipeReader(
                         pipeStream,
-                        message => reportLineReceivedCallback(message),
+                        reportLinesReceivedCallback,
                         reportEncoding,
                         m_bufferSize);
                 }
@@ -526,7 +529,7 @@ namespace BuildXL.Processes
                         kind: FileKind.Pipe);
                     m_reportReader = new AsyncPipeReader(
                         reportFile,
-                        reportLineReceivedCallback,
+                        reportLinesReceivedCallback,
                         reportEncoding,
                         m_bufferSize,
                         numOfRetriesOnCancel: m_numRetriesPipeReadOnCancel,
@@ -540,13 +543,30 @@ namespace BuildXL.Processes
             Analysis.IgnoreResult(FeedStandardInputAsync(detouredProcess, m_standardInputReader, m_standardInputTcs));
         }
 
-        private bool ReportLineReceived(string data)
+        private void ReportLinesReceived(ReadOnlySpan<ReadOnlyMemory<char>> lines, bool isEndOfStream)
         {
-            SandboxedProcessFactory.Counters.IncrementCounter(SandboxedProcessFactory.SandboxedProcessCounters.AccessReportCount);
+            // A line that fails to be processed sets m_reports.MessageProcessingFailure, which fails the pip. Stop processing reports there,
+            // so that the failure describes the first bad line rather than whatever later report fails next
+            if (m_reportProcessingStopped)
+            {
+                return;
+            }
+
+            int processed = 0;
             using (SandboxedProcessFactory.Counters.StartStopwatch(SandboxedProcessFactory.SandboxedProcessCounters.HandleAccessReportDuration))
             {
-                return m_reports.ReportLineReceived(data);
+                foreach (var line in lines)
+                {
+                    processed++;
+                    if (!m_reports.ReportLineReceived(line))
+                    {
+                        m_reportProcessingStopped = true;
+                        break;
+                    }
+                }
             }
+
+            SandboxedProcessFactory.Counters.AddToCounter(SandboxedProcessFactory.SandboxedProcessCounters.AccessReportCount, processed);
         }
 
         private void DebugPipeConnection(string data) => m_reports.ReportLineReceived($"{(int)ReportType.DebugMessage},{data}");
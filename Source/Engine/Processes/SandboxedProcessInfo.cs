@@ -514,6 +514,11 @@ namespace BuildXL.Processes
         /// </summary>
         public bool CreateSandboxTraceFile { get; init; }
 
+        /// <summary>
+        /// Format of the sandbox trace file, when <see cref="CreateSandboxTraceFile"/> is set.
+        /// </summary>
+        public SandboxTraceFormat SandboxTraceFormat { get; init; }
+
         /// <summary>
         /// An optional externally-created and managed instance of <see cref="JobObject"/> or a derived class.
         /// The provided job object is neither closed nor terminated.
@@ -590,6 +595,7 @@ namespace BuildXL.Processes
                 writer.WriteNullableString(DetoursFailureFile);
                 writer.WriteNullableReadOnlyList(ExternalVmSandboxStaleFilesToClean, (w, s) => w.Write(s));
                 writer.Write(CreateSandboxTraceFile);
+                writer.Write((byte)SandboxTraceFormat);
                 writer.Write(ForceAddExecutionPermission);
 
                 // File access manifest should be serialized the last.
@@ -638,6 +644,7 @@ namespace BuildXL.Processes
                 var detoursFailureFile = reader.ReadNullableString();
                 var externalVmSandboxStaleFilesToClean = reader.ReadNullableReadOnlyList(r => r.ReadString());
                 var createSandboxTraceFile = reader.ReadBoolean();
+                var sandboxTraceFormat = (SandboxTraceFormat)reader.ReadByte();
                 bool forceAddExecutionPermission = reader.ReadBoolean();
 
                 var fam = reader.ReadNullable(r => FileAccessManifest.Deserialize(stream));
@@ -677,6 +684,7 @@ namespace BuildXL.Processes
                     ExternalVmSandboxStaleFilesToClean = externalVmSandboxStaleFilesToClean,
                     NumRetriesPipeReadOnCancel = numRetriesPipeReadOnCancel,
                     CreateSandboxTraceFile = createSandboxTraceFile,
+                    SandboxTraceFormat = sandboxTraceFormat,
                 };
             }
         }
@@ -215,9 +215,9 @@ namespace BuildXL.Processes
             return await ExceptionUtilities.HandleRecoverableIOException(
                 async () =>
                 {
-                    using (TextReader reader = CreateFileReader())
+                    using (TextReader reader = CreateFileReader(out long length))
                     {
-                        if (m_length < maxLength)
+                        if (length < maxLength)
                         {
                             return await reader.ReadToEndAsync();
                         }
@@ -307,13 +307,25 @@ namespace BuildXL.Processes
                 throw m_exception;
             }
 
-            return m_value != null ? new StringReader(m_value) : CreateFileReader();
+            return m_value != null ? new StringReader(m_value) : CreateFileReader(out _);
         }
 
+        /// <summary>
+        /// Creates a reader for the saved file, whose <paramref name="length"/> in bytes bounds the number of characters it reads.
+        /// </summary>
+        /// <remarks>
+        /// A binary sandbox trace (see <see cref="SandboxTraceFormat.Binary"/>) is read as its text format, so readers get the text
+        /// the <see cref="Encoding"/> of the output describes.
+        /// </remarks>
         [SuppressMessage("Microsoft.Reliability", "CA2000:Dispose objects before losing scope",
             Justification = "The StreamReader will dispose the stream.")]
-        private TextReader CreateFileReader()
+        private TextReader CreateFileReader(out long length)
         {
+            if (m_file == SandboxedProcessFile.Trace && SandboxedProcessTraceConverter.IsBinaryTrace(m_fileName))
+            {
+                return CreateConvertedTraceReader(out length);
+            }
+
             // This FileStream is not asynchronous due to an intermittant crash we see on some machines when using
             // an asynchronous stream here
             FileStream stream = FileUtilities.CreateFileStream(
@@ -321,7 +333,40 @@ namespace BuildXL.Processes
                 FileMode.Open,
                 FileAccess.Read,
                 FileShare.Read | FileShare.Delete);
+            length = m_length;
             return new StreamReader(stream);
         }
+
+        /// <summary>
+        /// Converts the binary trace file to the text format into a temporary file, which is deleted when the returned reader is closed.
+        /// </summary>
+        [SuppressMessage("Microsoft.Reliability", "CA2000:Dispose objects before losing scope",
+            Justification = "The StreamReader will dispose the stream.")]
+        private TextReader CreateConvertedTraceReader(out long length)
+        {
+            FileStream stream = FileUtilities.CreateFileStream(
+                Path.Combine(Path.GetTempPath(), Path.GetRandomFileName()),
+                FileMode.CreateNew,
+                FileAccess.ReadWrite,
+                FileShare.Delete,
+                FileOptions.DeleteOnClose);
+
+            try
+            {
+                using (var writer = new StreamWriter(stream, m_encoding, bufferSize: 64 * 1024, leaveOpen: true))
+                {
+                    SandboxedProcessTraceConverter.ConvertToText(m_fileName, writer);
+                }
+
+                length = stream.Length;
+                stream.Position = 0;
+                return new StreamReader(stream, m_encoding);
+            }
+            catch
+            {
+                stream.Dispose();
+                throw;
+            }
+        }
     }
 }
@@ -77,10 +77,10 @@ namespace BuildXL.Processes
         // CODESYNC: Public\Src\Sandbox\Windows\DetoursServices\FileAccessHelpers.h
         public const uint FileAccessNoId = 0;
 
-        private static readonly Dictionary<string, ReportType> s_reportTypes = Enum
+        private static readonly Dictionary<int, ReportType> s_reportTypes = Enum
             .GetValues(typeof(ReportType))
             .Cast<ReportType>()
-            .ToDictionary(reportType => ((int)reportType).ToString(), reportType => reportType);
+            .ToDictionary(reportType => (int)reportType, reportType => reportType);
 
         private readonly PathTable m_pathTable;
         private readonly ConcurrentDictionary<uint, ReportedProcess> m_activeProcesses = new();
@@ -317,7 +317,6 @@ namespace BuildXL.Processes
         /// Callback invoked when a new report item is received from the native monitoring code
         /// <returns>true if the processing should continue. Otherwise false, which should cause exiting of the processing of data.</returns>
         /// </summary>
-        [SuppressMessage("Microsoft.Naming", "CA2204:Literals should be spelled correctly")]
         public bool ReportLineReceived(string data)
         {
             if (data == null)
@@ -326,34 +325,62 @@ namespace BuildXL.Processes
                 return true;
             }
 
-            int splitIndex = data.IndexOf(',');
+            return ReportLineReceived(data.AsMemory());
+        }
+
+        /// <summary>
+        /// Callback invoked when a new report item is received from the native monitoring code, as a slice of the buffer of the pipe reader
+        /// (see <see cref="Internal.StreamLinesReceived"/>), which is only valid during the call.
+        /// <returns>true if the processing should continue. Otherwise false, which should cause exiting of the processing of data.</returns>
+        /// </summary>
+        [SuppressMessage("Microsoft.Naming", "CA2204:Literals should be spelled correctly")]
+        public bool ReportLineReceived(ReadOnlyMemory<char> line)
+        {
+            int splitIndex = line.Span.IndexOf(',');
 
             if (splitIndex <= 0)
             {
-                MessageProcessingFailure = CreateMessageProcessingFailure(data, "Unexpected message content. Comma expected.");
+                MessageProcessingFailure = CreateMessageProcessingFailure(line.ToString(), "Unexpected message content. Comma expected.");
                 return false;
             }
 
-            string reportTypeString = data.Substring(0, splitIndex);
+            ReadOnlySpan<char> reportTypeString = line.Span.Slice(0, splitIndex);
+
+            // A process reused across pips (see FileAccessManifest.GetSwapPayloadBytes) tags its reports with the pip they belong to,
+            // as "<report type>@<pip id in hex>".
+            // CODESYNC: Public/Src/Sandbox/Windows/DetoursServices/SendReport.cpp
+            long? reportPipId = null;
+            int pipIdTagIndex = reportTypeString.IndexOf('@');
+            if (pipIdTagIndex >= 0)
+            {
+                if (!TryParseHexPipId(reportTypeString.Slice(pipIdTagIndex + 1), out long taggedPipId))
+                {
+                    MessageProcessingFailure = CreateMessageProcessingFailure(line.ToString(), "Unexpected message content. Failed parsing the pip id tag.");
+                    return false;
+                }
+
+                reportPipId = taggedPipId;
+                reportTypeString = reportTypeString.Slice(0, pipIdTagIndex);
+            }
 
             ReportType reportType;
-            bool success = s_reportTypes.TryGetValue(reportTypeString, out reportType);
+            bool success = TryParseReportType(reportTypeString, out reportType);
             if (!success)
             {
-                MessageProcessingFailure = CreateMessageProcessingFailure(data, "Unexpected message content. Failed parsing the reportType.");
+                MessageProcessingFailure = CreateMessageProcessingFailure(line.ToString(), "Unexpected message content. Failed parsing the reportType.");
                 return false;
             }
 
             if (reportType <= ReportType.None || reportType >= ReportType.Max)
             {
-                MessageProcessingFailure = CreateMessageProcessingFailure(data, "Unexpected message content. ReportType out to range.");
+                MessageProcessingFailure = CreateMessageProcessingFailure(line.ToString(), "Unexpected message content. ReportType out to range.");
                 return false;
             }
 
-            data = data.Substring(splitIndex + 1);
+            ReadOnlyMemory<char> data = line.Slice(splitIndex + 1);
             if (data.Length <= 0)
             {
-                MessageProcessingFailure = CreateMessageProcessingFailure(data, "Unexpected message content. Data length must be bigger than 0.");
+                MessageProcessingFailure = CreateMessageProcessingFailure(data.ToString(), "Unexpected message content. Data length must be bigger than 0.");
                 return false;
             }
 
@@ -366,11 +393,17 @@ namespace BuildXL.Processes
                 }
                 catch (Exception ex)
                 {
-                    MessageProcessingFailure = CreateMessageProcessingFailure(data, I($"Wait error on semaphore for counting Detours messages: {ex.GetLogEventMessage()}."));
+                    MessageProcessingFailure = CreateMessageProcessingFailure(data.ToString(), I($"Wait error on semaphore for counting Detours messages: {ex.GetLogEventMessage()}."));
                     return false;
                 }
             }
 
+            if (reportPipId.HasValue && reportPipId.Value != m_manifest.PipId)
+            {
+                // Sent on behalf of another pip the process ran for, e.g. by an operation that was still running when the manifest was swapped.
+                return true;
+            }
+
             string errorMessage = string.Empty;
 
             switch (reportType)
@@ -378,7 +411,7 @@ namespace BuildXL.Processes
                 case ReportType.FileAccess:
                     if (!FileAccessReportLineReceived(ref data, FileAccessReportLine.TryParse, isAnAugmentedFileAccess: false, out errorMessage))
                     {
-                        MessageProcessingFailure = CreateMessageProcessingFailure(data, errorMessage);
+                        MessageProcessingFailure = CreateMessageProcessingFailure(data.ToString(), errorMessage);
                         return false;
                     }
 
@@ -387,28 +420,28 @@ namespace BuildXL.Processes
                 case ReportType.DebugMessage:
                     if (m_detoursEventListener != null && (m_detoursEventListener.GetMessageHandlingFlags() & MessageHandlingFlags.DebugMessageNotify) != 0)
                     {
-                        m_detoursEventListener.HandleDebugMessage(new DebugData { PipId = PipSemiStableHash, PipDescription = PipDescription, DebugMessage = data });
+                        m_detoursEventListener.HandleDebugMessage(new DebugData { PipId = PipSemiStableHash, PipDescription = PipDescription, DebugMessage = data.ToString() });
                     }
 
-                    Tracing.Logger.Log.LogDetoursDebugMessage(m_loggingContext, PipSemiStableHash, data);
+                    Tracing.Logger.Log.LogDetoursDebugMessage(m_loggingContext, PipSemiStableHash, data.ToString());
                     break;
 
                 case ReportType.WindowsCall:
                     throw new NotImplementedException(I($"{ReportType.WindowsCall} report type is not supported."));
 
                 case ReportType.ProcessData:
-                    if (!ProcessDataReportLineReceived(data, out errorMessage))
+                    if (!ProcessDataReportLineReceived(data.ToString(), out errorMessage))
                     {
-                        MessageProcessingFailure = CreateMessageProcessingFailure(data, errorMessage);
+                        MessageProcessingFailure = CreateMessageProcessingFailure(data.ToString(), errorMessage);
                         return false;
                     }
 
                     break;
 
                 case ReportType.ProcessDetouringStatus:
-                    if (!ProcessDetouringStatusReceived(data, out errorMessage))
+                    if (!ProcessDetouringStatusReceived(data.ToString(), out errorMessage))
                     {
-                        MessageProcessingFailure = CreateMessageProcessingFailure(data, errorMessage);
+                        MessageProcessingFailure = CreateMessageProcessingFailure(data.ToString(), errorMessage);
                         return false;
                     }
 
@@ -417,7 +450,7 @@ namespace BuildXL.Processes
                 case ReportType.AugmentedFileAccess:
                     if (!FileAccessReportLineReceived(ref data, TryParseAugmentedFileAccess, isAnAugmentedFileAccess: true, out errorMessage))
                     {
-                        MessageProcessingFailure = CreateMessageProcessingFailure(data, errorMessage);
+                        MessageProcessingFailure = CreateMessageProcessingFailure(data.ToString(), errorMessage);
                         return false;
                     }
 
@@ -431,6 +464,42 @@ namespace BuildXL.Processes
             return true;
         }
 
+        /// <summary>
+        /// Parses the decimal value of a <see cref="ReportType"/>, as formatted by the sandbox.
+        /// </summary>
+        private static bool TryParseReportType(ReadOnlySpan<char> value, out ReportType reportType)
+        {
+            reportType = ReportType.None;
+
+            // No leading zeros, like the formatted values
+            if (value.Length == 0 || value.Length > 9 || (value[0] == '0' && value.Length > 1))
+            {
+                return false;
+            }
+
+            int number = 0;
+            foreach (char c in value)
+            {
+                if (c < '0' || c > '9')
+                {
+                    return false;
+                }
+
+                number = number * 10 + (c - '0');
+            }
+
+            return s_reportTypes.TryGetValue(number, out reportType);
+        }
+
+        private static bool TryParseHexPipId(ReadOnlySpan<char> value, out long pipId)
+        {
+#if NETCOREAPP
+            return long.TryParse(value, NumberStyles.AllowHexSpecifier, CultureInfo.InvariantCulture, out pipId);
+#else
+            return long.TryParse(value.ToString(), NumberStyles.AllowHexSpecifier, CultureInfo.InvariantCulture, out pipId);
+#endif
+        }
+
         private static Failure<string> CreateMessageProcessingFailure(string message) => new Failure<string>(I($"Error message: {message}"));
         private static Failure<string> CreateMessageProcessingFailure(string rawData, string message) => CreateMessageProcessingFailure(I($"{message} | Raw data: {rawData}"));
 
@@ -623,7 +692,6 @@ namespace BuildXL.Processes
                 out var detoursMaxMemHeapSizeInBytes,
                 out var manifestSizeInBytes,
                 out var finalDetoursHeapSizeInBytes,
-                out var allocatedPoolEntries,
                 out var maxHandleMapEntries,
                 out var handleMapEntries,
                 out errorMessage))
@@ -640,7 +708,6 @@ namespace BuildXL.Processes
                 processId,
                 manifestSizeInBytes,
                 finalDetoursHeapSizeInBytes,
-                allocatedPoolEntries,
                 maxHandleMapEntries,
                 handleMapEntries);
 
@@ -696,7 +763,7 @@ namespace BuildXL.Processes
         }
 
         private bool TryParseAugmentedFileAccess(
-            ref string data,
+            ref ReadOnlyMemory<char> data,
             out uint processId,
             out uint parentProcessId,
             out uint id,
@@ -1267,7 +1334,6 @@ namespace BuildXL.Processes
                 out ulong detoursMaxHeapSizeInBytes,
                 out uint manifestSizeInBytes,
                 out ulong finalDetoursHeapSizeInBytes,
-                out uint allocatedPoolEntries,
                 out ulong maxHandleMapEntries,
                 out ulong handleMapEntries,
                 out string errorMessage)
@@ -1286,11 +1352,10 @@ namespace BuildXL.Processes
 
                 manifestSizeInBytes = 0;
                 finalDetoursHeapSizeInBytes = 0L;
-                allocatedPoolEntries = 0;
                 maxHandleMapEntries = 0L;
                 handleMapEntries = 0L;
 
-                const int NumberOfEntriesInMessage = 24;
+                const int NumberOfEntriesInMessage = 23;
 
                 var items = line.Split('|');
 
@@ -1328,9 +1393,8 @@ namespace BuildXL.Processes
                     ulong.TryParse(items[18], NumberStyles.None, CultureInfo.InvariantCulture, out detoursMaxHeapSizeInBytes) &&
                     uint.TryParse(items[19], NumberStyles.None, CultureInfo.InvariantCulture, out manifestSizeInBytes) &&
                     ulong.TryParse(items[20], NumberStyles.None, CultureInfo.InvariantCulture, out finalDetoursHeapSizeInBytes) &&
-                    uint.TryParse(items[21], NumberStyles.None, CultureInfo.InvariantCulture, out allocatedPoolEntries) &&
-                    ulong.TryParse(items[22], NumberStyles.None, CultureInfo.InvariantCulture, out maxHandleMapEntries) &&
-                    ulong.TryParse(items[23], NumberStyles.None, CultureInfo.InvariantCulture, out handleMapEntries))
+                    ulong.TryParse(items[21], NumberStyles.None, CultureInfo.InvariantCulture, out maxHandleMapEntries) &&
+                    ulong.TryParse(items[22], NumberStyles.None, CultureInfo.InvariantCulture, out handleMapEntries))
                 {
                     long fileTime = creationHighDateTime;
                     fileTime = fileTime << 32;
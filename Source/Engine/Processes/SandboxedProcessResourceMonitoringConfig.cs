@@ -4,6 +4,8 @@
 using System;
 using BuildXL.Utilities.Core;
 
+#nullable enable
+
 namespace BuildXL.Processes
 {
     /// <summary>
@@ -22,11 +24,22 @@ namespace BuildXL.Processes
         /// </summary>
         public TimeSpan RefreshInterval { get; }
 
+        /// <summary>
+        /// Linux only: a cgroup v2 directory delegated to BuildXL, under which each sandboxed process tree gets its own cgroup so that
+        /// its resource usage is read from the cgroup counters instead of from procfs for every process of the tree.
+        /// </summary>
+        /// <remarks>
+        /// The directory must have the 'memory' and 'io' controllers available and must not contain processes itself.
+        /// When it is null, or the cgroup can't be used, the process tree is sampled through procfs.
+        /// </remarks>
+        public string? CgroupRoot { get; }
+
         /// <nodoc />
-        public SandboxedProcessResourceMonitoringConfig(bool enabled, TimeSpan refreshInterval)
+        public SandboxedProcessResourceMonitoringConfig(bool enabled, TimeSpan refreshInterval, string? cgroupRoot = null)
         {
             MonitoringEnabled = enabled;
             RefreshInterval = refreshInterval;
+            CgroupRoot = cgroupRoot;
         }
     }
 }
@@ -26,20 +26,36 @@ namespace BuildXL.Processes
     ///     2. Create a tool to read and parse the trace file, and let customers use that tool to consume the trace file.
     ///        Then ensure that the customer use the same version of the tool and the BuildXL in their builds.
     ///        This way, BuildXL developers can change the format of the trace file without breaking the builds.
+    ///
+    /// Operations are not kept in memory: they are streamed as they are reported to a compact binary trace (see <see cref="SandboxedProcessTraceWriter"/>).
+    /// With <see cref="SandboxTraceFormat.Text"/>, the binary trace is a temporary file converted to the text format by <see cref="Freeze"/>;
+    /// with <see cref="SandboxTraceFormat.Binary"/>, it is the trace file, and <see cref="SandboxedProcessTraceConverter"/> produces the text format on demand.
+    /// A builder that is disposed without being frozen (e.g., the process failed to start) closes the binary trace and deletes it.
     /// </remarks>
-    internal sealed class SandboxedProcessTraceBuilder
+    internal sealed class SandboxedProcessTraceBuilder : IDisposable
     {
-        private const byte Version = 1;
-
-        private static readonly ObjectPool<HashSet<ReportedFileOperation>> s_reportedFileOperationSetPool = Pools.CreateSetPool<ReportedFileOperation>();
-
-        private static readonly ObjectPool<HashSet<RequestedAccess>> s_requestedAccessSetPool = Pools.CreateSetPool<RequestedAccess>();
+        /// <summary>
+        /// Version of the text format.
+        /// </summary>
+        internal const byte Version = 1;
 
         private readonly ISandboxedProcessFileStorage m_fileStorage;
 
         private readonly PathTable m_pathTable;
 
-        private readonly List<Operation> m_operations = [];
+        private readonly SandboxTraceFormat m_format;
+
+        /// <summary>
+        /// The binary trace: the trace file itself with <see cref="SandboxTraceFormat.Binary"/>, or a temporary file next to it.
+        /// </summary>
+        private readonly string m_binaryTraceFile;
+
+        private readonly SandboxedProcessTraceWriter m_writer;
+
+        /// <summary>
+        /// Paths whose string has been written to the binary trace.
+        /// </summary>
+        private readonly HashSet<AbsolutePath> m_writtenPaths = new HashSet<AbsolutePath>();
 
         private readonly List<ReportedProcess> m_reportedProcesses = [];
 
@@ -50,7 +66,7 @@ namespace BuildXL.Processes
         /// <summary>
         /// Number of recorded operations.
         /// </summary>
-        public int OperationCount => m_operations.Count;
+        public int OperationCount => (int)m_fileAccessCounter;
 
         /// <summary>
         /// Number of reported processes.
@@ -60,18 +76,27 @@ namespace BuildXL.Processes
         /// <summary>
         /// Constructor.
         /// </summary>
-        public SandboxedProcessTraceBuilder(ISandboxedProcessFileStorage fileStorage, PathTable pathTable)
+        public SandboxedProcessTraceBuilder(ISandboxedProcessFileStorage fileStorage, PathTable pathTable, SandboxTraceFormat format = SandboxTraceFormat.Text)
         {
             Contract.Requires(!string.IsNullOrEmpty(fileStorage.GetFileName(SandboxedProcessFile.Trace)));
             Contract.Requires(pathTable != null);
 
             m_fileStorage = fileStorage;
             m_pathTable = pathTable;
+            m_format = format;
+
+            string file = fileStorage.GetFileName(SandboxedProcessFile.Trace);
+            m_binaryTraceFile = format == SandboxTraceFormat.Binary ? file : file + ".bin";
+            m_writer = new SandboxedProcessTraceWriter(m_binaryTraceFile, compress: format == SandboxTraceFormat.Binary);
         }
 
         /// <summary>
         /// Freezes the trace and returns the output.
         /// </summary>
+        /// <remarks>
+        /// With <see cref="SandboxTraceFormat.Binary"/>, the output is the binary trace file; its readers (<see cref="SandboxedProcessOutput.CreateReader"/>,
+        /// <see cref="SandboxedProcessOutput.ReadValueAsync()"/>) get the UTF-8 text format, converted as they read it.
+        /// </remarks>
         public SandboxedProcessOutput Freeze()
         {
             string file = m_fileStorage.GetFileName(SandboxedProcessFile.Trace);
@@ -79,6 +104,12 @@ namespace BuildXL.Processes
 
             try
             {
+                if (m_format == SandboxTraceFormat.Binary)
+                {
+                    CompleteBinaryTrace();
+                    return new SandboxedProcessOutput(new FileInfo(file).Length, null, file, encoding, m_fileStorage, SandboxedProcessFile.Trace, null);
+                }
+
                 FileUtilities.CreateDirectory(Path.GetDirectoryName(file));
                 using FileStream stream = FileUtilities.CreateReplacementFile(
                     file,
@@ -87,6 +118,7 @@ namespace BuildXL.Processes
                 using var writer = new StreamWriter(stream, encoding);
 
                 WriteToStream(writer);
+                writer.Flush();
 
                 return new SandboxedProcessOutput(stream.Length, null, file, encoding, m_fileStorage, SandboxedProcessFile.Trace, null);
             }
@@ -101,6 +133,27 @@ namespace BuildXL.Processes
                     SandboxedProcessFile.Trace,
                     new BuildXLException("An exception occurred while saving a trace file", innerException: ex));
             }
+            finally
+            {
+                if (m_format == SandboxTraceFormat.Text)
+                {
+                    FileUtilities.TryDeleteFile(m_binaryTraceFile, retryOnFailure: false);
+                }
+            }
+        }
+
+        /// <inheritdoc />
+        public void Dispose()
+        {
+            if (Interlocked.CompareExchange(ref m_fileHasBeenSaved, 1, 0) != 0)
+            {
+                // Frozen: the writer is closed already
+                return;
+            }
+
+            // An incomplete binary trace can't be read, whichever the format
+            m_writer.Dispose();
+            FileUtilities.TryDeleteFile(m_binaryTraceFile, retryOnFailure: false);
         }
 
         /// <summary>
@@ -118,12 +171,17 @@ namespace BuildXL.Processes
             bool isAnAugmentedFileAccess,
             string enumeratePattern)
         {
-            if (SkipOperation(operation))
+            if (SkipOperation(operation) || Volatile.Read(ref m_fileHasBeenSaved) != 0)
             {
                 return;
             }
 
-            m_operations.Add(new Operation
+            if (m_writtenPaths.Add(path))
+            {
+                m_writer.WritePath(path, path.ToString(m_pathTable));
+            }
+
+            m_writer.WriteOperation(new Operation
             {
                 Id = m_fileAccessCounter++,
                 ProcessId = processId,
@@ -264,7 +322,7 @@ namespace BuildXL.Processes
         }
 
         /// <summary>
-        /// Writes the trace to a stream.
+        /// Writes the trace to a stream, in the text format.
         /// </summary>
         /// <remarks>Changing the format may break existing customers' builds; see class remarks for details.</remarks>
         public void WriteToStream(StreamWriter writer)
@@ -290,90 +348,44 @@ namespace BuildXL.Processes
             //          Count
             //          Operation.Id = Operation
 
-            Contract.Assert(Interlocked.CompareExchange(ref m_fileHasBeenSaved, 1, 0) == 0, "Trace file should be saved at most once.");
-
-            using var pooledSb = Pools.GetStringBuilder();
-            using var pooledAbsolutePathSet = Pools.GetAbsolutePathSet();
-            using var pooledReportedFileOperationSet = s_reportedFileOperationSetPool.GetInstance();
-            using var pooledRequestedAccessSet = s_requestedAccessSetPool.GetInstance();
-            var sb = pooledSb.Instance;
-            var absolutePaths = pooledAbsolutePathSet.Instance;
-            var reportedFileOperations = pooledReportedFileOperationSet.Instance;
-            var requestedAccesses = pooledRequestedAccessSet.Instance;
-
-            writer.WriteLine(Version);
-
-            foreach (var operation in m_operations)
-            {
-                absolutePaths.Add(operation.Path);
-                reportedFileOperations.Add(operation.FileOperation);
-                requestedAccesses.Add(operation.RequestedAccess);
-            }
-
-            writer.WriteLine(reportedFileOperations.Count);
-            foreach (var fileOperation in reportedFileOperations)
-            {
-                writer.WriteLine($"{(byte)fileOperation}={fileOperation}");
-            }
-
-            writer.WriteLine(requestedAccesses.Count);
-            foreach (var requestedAccess in requestedAccesses)
-            {
-                writer.WriteLine($"{(byte)requestedAccess}={requestedAccess:G}");
-            }
-
-            writer.WriteLine(m_reportedProcesses.Count);
-            foreach (var process in m_reportedProcesses)
-            {
-                formatReportedProcess(process, sb);
-#if NETCOREAPP
-                writer.WriteLine(sb);
-#else
-                writer.WriteLine(sb.ToString());
-#endif
-                sb.Clear();
-            }
-
-            writer.WriteLine(absolutePaths.Count);
-            foreach (var absolutePath in absolutePaths.OrderBy(x => x.RawValue))
-            {
-                writer.WriteLine($"{absolutePath.RawValue}={absolutePath.ToString(m_pathTable)}");
-            }
+            CompleteBinaryTrace();
+            SandboxedProcessTraceConverter.ConvertToText(m_binaryTraceFile, writer);
+        }
 
-            // Paths block is deprecated
-            // This count number is added to maintain compatibility with the existing format.
-            writer.WriteLine(0);
+        private void CompleteBinaryTrace()
+        {
+            Contract.Assert(Interlocked.CompareExchange(ref m_fileHasBeenSaved, 1, 0) == 0, "Trace file should be saved at most once.");
 
-            writer.WriteLine(m_operations.Count);
-            foreach (var operation in m_operations)
+            using (m_writer)
             {
-                formatOperation(operation, sb);
-#if NETCOREAPP3_0_OR_GREATER
-                writer.WriteLine(sb);
-#else
-                writer.WriteLine(sb.ToString());
-#endif
-                sb.Clear();
+                m_writer.Complete(m_reportedProcesses);
             }
+        }
 
+        internal static void FormatReportedProcess(
+            uint processId,
+            string path,
+            uint parentProcessId,
+            long creationTimeUtcTicks,
+            long exitTimeUtcTicks,
+            uint exitCode,
+            string processArgs,
+            StringBuilder sb)
+        {
+            // PID, "path", ParentPID, startTimeUtcTicks, endTimeUtcTicks
+            // CommandLineArgs
+            sb.Append($"{processId},\"{path}\",{parentProcessId},");
+            sb.AppendLine($"{creationTimeUtcTicks},{exitTimeUtcTicks},{exitCode}");
+            sb.Append(processArgs);
+        }
 
-            static void formatReportedProcess(ReportedProcess process, StringBuilder sb)
-            {
-                // PID, "path", ParentPID, startTimeUtcTicks, endTimeUtcTicks
-                // CommandLineArgs
-                sb.Append($"{process.ProcessId},\"{process.Path}\",{process.ParentProcessId},");
-                sb.AppendLine($"{process.CreationTime.ToUniversalTime().Ticks},{process.ExitTime.ToUniversalTime().Ticks},{process.ExitCode}");
-                sb.Append(process.ProcessArgs);
-            }
-
-            static void formatOperation(Operation operation, StringBuilder sb)
-            {
-                // id, PID, Path,, FileOperation, RequestedAccess, Error, IsAnAugmentedFileAccess, EnumeratePattern
-                // Note that there is an empty field between Path and FileOperation to maintain compatibility with the existing format.
-                sb.Append($"{operation.Id},{operation.ProcessId},");
-                sb.Append($"{operation.Path.RawValue},,");
-                sb.Append($"{(byte)operation.FileOperation},{(byte)operation.RequestedAccess},{operation.Error},{(operation.IsAnAugmentedFileAccess ? 1 : 0)},{operation.EnumeratePattern}");
-            }
+        internal static void FormatOperation(in Operation operation, StringBuilder sb)
+        {
+            // id, PID, Path,, FileOperation, RequestedAccess, Error, IsAnAugmentedFileAccess, EnumeratePattern
+            // Note that there is an empty field between Path and FileOperation to maintain compatibility with the existing format.
+            sb.Append($"{operation.Id},{operation.ProcessId},");
+            sb.Append($"{operation.Path.RawValue},,");
+            sb.Append($"{(byte)operation.FileOperation},{(byte)operation.RequestedAccess},{operation.Error},{(operation.IsAnAugmentedFileAccess ? 1 : 0)},{operation.EnumeratePattern}");
         }
 
         internal readonly struct Operation
@@ -0,0 +1,341 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.IO.Compression;
+using System.Linq;
+using System.Text;
+using BuildXL.Utilities.Core;
+using static BuildXL.Processes.SandboxedProcessTraceWriter;
+
+namespace BuildXL.Processes
+{
+    /// <summary>
+    /// Converts binary trace files (see <see cref="SandboxedProcessTraceWriter"/>) to the text format of <see cref="SandboxedProcessTraceBuilder"/>.
+    /// </summary>
+    /// <remarks>
+    /// The text format lists the operation kinds, processes and paths before the operations, so the binary trace is read twice: once for those,
+    /// and once to write the operations. Only the distinct paths are held in memory, never the operations.
+    /// </remarks>
+    internal static class SandboxedProcessTraceConverter
+    {
+        /// <summary>
+        /// Whether <paramref name="file"/> is a binary trace file.
+        /// </summary>
+        public static bool IsBinaryTrace(string file)
+        {
+            using var stream = new FileStream(file, FileMode.Open, FileAccess.Read, FileShare.Read | FileShare.Delete);
+            var header = new byte[Magic.Length + 1];
+            int read = 0;
+            int count;
+            while (read < header.Length && (count = stream.Read(header, read, header.Length - read)) > 0)
+            {
+                read += count;
+            }
+
+            return read == header.Length && header.Take(Magic.Length).SequenceEqual(Magic);
+        }
+
+        /// <summary>
+        /// Writes the text format of the binary trace <paramref name="binaryTraceFile"/> to <paramref name="writer"/>.
+        /// </summary>
+        /// <exception cref="BuildXLException">The binary trace is malformed.</exception>
+        public static void ConvertToText(string binaryTraceFile, TextWriter writer)
+        {
+            // First pass: everything but the operations
+            var paths = new Dictionary<int, string>();
+            var reportedFileOperations = new List<ReportedFileOperation>();
+            var reportedFileOperationSet = new HashSet<ReportedFileOperation>();
+            var requestedAccesses = new List<RequestedAccess>();
+            var requestedAccessSet = new HashSet<RequestedAccess>();
+            var processLines = new List<string>();
+            int operationCount = 0;
+
+            using (var reader = new RecordReader(binaryTraceFile))
+            {
+                RecordKind kind;
+                while ((kind = reader.ReadKind()) != RecordKind.End)
+                {
+                    switch (kind)
+                    {
+                        case RecordKind.Path:
+                            int rawValue = (int)reader.ReadVarUInt();
+                            paths[rawValue] = reader.ReadString();
+                            break;
+                        case RecordKind.Operation:
+                            reader.SkipOperation(out var fileOperation, out var requestedAccess);
+                            if (reportedFileOperationSet.Add(fileOperation))
+                            {
+                                reportedFileOperations.Add(fileOperation);
+                            }
+
+                            if (requestedAccessSet.Add(requestedAccess))
+                            {
+                                requestedAccesses.Add(requestedAccess);
+                            }
+
+                            operationCount++;
+                            break;
+                        case RecordKind.Process:
+                            processLines.Add(reader.ReadProcessLines());
+                            break;
+                        default:
+                            throw new BuildXLException($"Unexpected record kind {(byte)kind} in binary trace file '{binaryTraceFile}'");
+                    }
+                }
+            }
+
+            // The text format; see SandboxedProcessTraceBuilder.WriteToStream
+            writer.WriteLine(SandboxedProcessTraceBuilder.Version);
+
+            writer.WriteLine(reportedFileOperations.Count);
+            foreach (var fileOperation in reportedFileOperations)
+            {
+                writer.WriteLine($"{(byte)fileOperation}={fileOperation}");
+            }
+
+            writer.WriteLine(requestedAccesses.Count);
+            foreach (var requestedAccess in requestedAccesses)
+            {
+                writer.WriteLine($"{(byte)requestedAccess}={requestedAccess:G}");
+            }
+
+            writer.WriteLine(processLines.Count);
+            foreach (var processLine in processLines)
+            {
+                writer.WriteLine(processLine);
+            }
+
+            writer.WriteLine(paths.Count);
+            foreach (var path in paths.OrderBy(p => p.Key))
+            {
+                writer.WriteLine($"{path.Key}={path.Value}");
+            }
+
+            // Paths block is deprecated
+            writer.WriteLine(0);
+
+            writer.WriteLine(operationCount);
+
+            // Second pass: the operations
+            using (var reader = new RecordReader(binaryTraceFile))
+            {
+                var sb = new StringBuilder();
+                RecordKind kind;
+                while ((kind = reader.ReadKind()) != RecordKind.End)
+                {
+                    switch (kind)
+                    {
+                        case RecordKind.Path:
+                            reader.ReadVarUInt();
+                            reader.SkipString();
+                            break;
+                        case RecordKind.Operation:
+                            SandboxedProcessTraceBuilder.FormatOperation(reader.ReadOperation(), sb);
+#if NETCOREAPP3_0_OR_GREATER
+                            writer.WriteLine(sb);
+#else
+                            writer.WriteLine(sb.ToString());
+#endif
+                            sb.Clear();
+                            break;
+                        case RecordKind.Process:
+                            reader.ReadProcessLines();
+                            break;
+                    }
+                }
+            }
+        }
+
+        /// <summary>
+        /// Reads the records of a binary trace file.
+        /// </summary>
+        private sealed class RecordReader : IDisposable
+        {
+            private static readonly Encoding s_encoding = new UTF8Encoding(encoderShouldEmitUTF8Identifier: false);
+
+            private readonly string m_fileName;
+            private readonly FileStream m_file;
+            private readonly Stream m_stream;
+            private readonly byte[] m_buffer = new byte[64 * 1024];
+            private int m_position;
+            private int m_length;
+            private byte[] m_stringBuffer = new byte[1024];
+            private uint m_lastOperationId;
+
+            public RecordReader(string fileName)
+            {
+                m_fileName = fileName;
+                m_file = new FileStream(fileName, FileMode.Open, FileAccess.Read, FileShare.Read | FileShare.Delete, bufferSize: 4096);
+
+                var header = new byte[Magic.Length + 2];
+                if (m_file.Read(header, 0, header.Length) != header.Length || !header.Take(Magic.Length).SequenceEqual(Magic))
+                {
+                    m_file.Dispose();
+                    throw new BuildXLException($"'{fileName}' is not a binary trace file");
+                }
+
+                if (header[Magic.Length] != FormatVersion)
+                {
+                    m_file.Dispose();
+                    throw new BuildXLException($"Unsupported version {header[Magic.Length]} of binary trace file '{fileName}'");
+                }
+
+                var flags = (FileFlags)header[Magic.Length + 1];
+                m_stream = (flags & FileFlags.Compressed) != 0 ? new DeflateStream(m_file, CompressionMode.Decompress) : m_file;
+            }
+
+            public RecordKind ReadKind() => (RecordKind)ReadByte();
+
+            public SandboxedProcessTraceBuilder.Operation ReadOperation()
+            {
+                uint id = unchecked(m_lastOperationId + (uint)ReadVarUInt());
+                m_lastOperationId = id;
+
+                uint processId = (uint)ReadVarUInt();
+                var path = new AbsolutePath((int)ReadVarUInt());
+                var fileOperation = (ReportedFileOperation)ReadByte();
+                var requestedAccess = (RequestedAccess)ReadByte();
+                uint error = (uint)ReadVarUInt();
+                var flags = (OperationFlags)ReadByte();
+                string enumeratePattern = (flags & OperationFlags.HasEnumeratePattern) != 0 ? ReadString() : null;
+
+                return new SandboxedProcessTraceBuilder.Operation
+                {
+                    Id = id,
+                    ProcessId = processId,
+                    Path = path,
+                    FileOperation = fileOperation,
+                    RequestedAccess = requestedAccess,
+                    Error = error,
+                    IsAnAugmentedFileAccess = (flags & OperationFlags.IsAnAugmentedFileAccess) != 0,
+                    EnumeratePattern = enumeratePattern,
+                };
+            }
+
+            /// <summary>
+            /// Skips an operation, but for its kind and access.
+            /// </summary>
+            public void SkipOperation(out ReportedFileOperation fileOperation, out RequestedAccess requestedAccess)
+            {
+                ReadVarUInt();
+                ReadVarUInt();
+                ReadVarUInt();
+                fileOperation = (ReportedFileOperation)ReadByte();
+                requestedAccess = (RequestedAccess)ReadByte();
+                ReadVarUInt();
+                if (((OperationFlags)ReadByte() & OperationFlags.HasEnumeratePattern) != 0)
+                {
+                    SkipString();
+                }
+            }
+
+            /// <summary>
+            /// Reads a process, formatted as its two lines of the text format.
+            /// </summary>
+            public string ReadProcessLines()
+            {
+                uint processId = (uint)ReadVarUInt();
+                string path = ReadString();
+                uint parentProcessId = (uint)ReadVarUInt();
+                long creationTime = (long)ReadVarUInt();
+                long exitTime = (long)ReadVarUInt();
+                uint exitCode = (uint)ReadVarUInt();
+                string args = ReadString();
+
+                var sb = new StringBuilder();
+                SandboxedProcessTraceBuilder.FormatReportedProcess(processId, path, parentProcessId, creationTime, exitTime, exitCode, args, sb);
+                return sb.ToString();
+            }
+
+            public ulong ReadVarUInt()
+            {
+                byte first = ReadByte();
+                if (first < 0x80)
+                {
+                    return first;
+                }
+
+                ulong value = (ulong)(first & 0x7F);
+                for (int shift = 7; shift < 64; shift += 7)
+                {
+                    byte b = ReadByte();
+                    value |= (ulong)(b & 0x7F) << shift;
+                    if (b < 0x80)
+                    {
+                        return value;
+                    }
+                }
+
+                throw new BuildXLException($"Malformed integer in binary trace file '{m_fileName}'");
+            }
+
+            public string ReadString()
+            {
+                int byteCount = (int)ReadVarUInt();
+                if (byteCount > m_stringBuffer.Length)
+                {
+                    m_stringBuffer = new byte[byteCount];
+                }
+
+                for (int read = 0; read < byteCount;)
+                {
+                    int count = Math.Min(byteCount - read, Fill());
+                    Buffer.BlockCopy(m_buffer, m_position, m_stringBuffer, read, count);
+                    m_position += count;
+                    read += count;
+                }
+
+                return s_encoding.GetString(m_stringBuffer, 0, byteCount);
+            }
+
+            public void SkipString()
+            {
+                for (int remaining = (int)ReadVarUInt(); remaining > 0;)
+                {
+                    int count = Math.Min(remaining, Fill());
+                    m_position += count;
+                    remaining -= count;
+                }
+            }
+
+            private byte ReadByte()
+            {
+                if (m_position == m_length)
+                {
+                    Fill();
+                }
+
+                return m_buffer[m_position++];
+            }
+
+            /// <summary>
+            /// Returns the number of buffered bytes, reading more when none are left.
+            /// </summary>
+            private int Fill()
+            {
+                if (m_position == m_length)
+                {
+                    m_position = 0;
+                    m_length = m_stream.Read(m_buffer, 0, m_buffer.Length);
+                    if (m_length == 0)
+                    {
+                        throw UnexpectedEnd();
+                    }
+                }
+
+                return m_length - m_position;
+            }
+
+            private BuildXLException UnexpectedEnd() => new BuildXLException($"Binary trace file '{m_fileName}' ends unexpectedly");
+
+            public void Dispose()
+            {
+                m_stream.Dispose();
+                m_file.Dispose();
+            }
+        }
+    }
+}
@@ -0,0 +1,349 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.IO;
+using System.IO.Compression;
+using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
+using BuildXL.Native.IO;
+using BuildXL.Utilities.Core;
+
+namespace BuildXL.Processes
+{
+    /// <summary>
+    /// Streams the observations of <see cref="SandboxedProcessTraceBuilder"/> to a binary trace file as they are reported.
+    /// </summary>
+    /// <remarks>
+    /// Records are encoded into fixed-size chunks on the reporting thread and queued for compression into the file, which runs on a thread-pool
+    /// thread while chunks are queued. So the memory used by a trace is a few chunks whatever the number of observations, and no thread is held
+    /// by a trace that is idle or abandoned. When the compressor falls behind, the reporting thread waits for it rather than queuing more chunks.
+    ///
+    /// Binary format:
+    ///     Magic ("BXLT"), version and <see cref="FileFlags"/>, uncompressed
+    ///     Sequence of records (deflate-compressed with <see cref="FileFlags.Compressed"/>), each starting with a <see cref="RecordKind"/>
+    ///         Path:       RawValue, string                    (before the first operation on the path)
+    ///         Operation:  Id delta from the previous operation, PID, path RawValue, (byte)FileOperation, (byte)RequestedAccess,
+    ///                     Error, flags (1: augmented, 2: has an enumerate pattern), [enumerate pattern]
+    ///         Process:    PID, path, parent PID, creation and exit times (UTC ticks), exit code, arguments   (when the trace is completed)
+    ///         End
+    /// Integers are unsigned LEB128 varints, and strings are a varint byte count followed by UTF-8 bytes.
+    /// </remarks>
+    internal sealed class SandboxedProcessTraceWriter : IDisposable
+    {
+        /// <summary>
+        /// First bytes of a binary trace file.
+        /// </summary>
+        internal static readonly byte[] Magic = { (byte)'B', (byte)'X', (byte)'L', (byte)'T' };
+
+        /// <summary>
+        /// Version of the binary format, written after <see cref="Magic"/>.
+        /// </summary>
+        internal const byte FormatVersion = 1;
+
+        /// <nodoc />
+        [Flags]
+        internal enum FileFlags : byte
+        {
+            None = 0,
+            Compressed = 1,
+        }
+
+        /// <nodoc />
+        internal enum RecordKind : byte
+        {
+            End = 0,
+            Path = 1,
+            Operation = 2,
+            Process = 3,
+        }
+
+        /// <nodoc />
+        [Flags]
+        internal enum OperationFlags : byte
+        {
+            None = 0,
+            IsAnAugmentedFileAccess = 1,
+            HasEnumeratePattern = 2,
+        }
+
+        private const int ChunkSize = 64 * 1024;
+        private const int MaxQueuedChunks = 4;
+
+        /// <summary>
+        /// Largest encoding of a varint.
+        /// </summary>
+        private const int MaxVarIntLength = 10;
+
+        private static readonly Encoding s_encoding = new UTF8Encoding(encoderShouldEmitUTF8Identifier: false);
+
+        private readonly string m_fileName;
+        private readonly bool m_compress;
+        private readonly BlockingCollection<(byte[] chunk, int length)> m_chunks = new BlockingCollection<(byte[], int)>(MaxQueuedChunks);
+        private readonly ConcurrentBag<byte[]> m_freeChunks = new ConcurrentBag<byte[]>();
+
+        private FileStream m_file;
+        private Stream m_compressor;
+        private Task m_compressorTask;
+        private int m_compressorRunning;
+
+        private byte[] m_chunk;
+        private int m_length;
+        private uint m_lastOperationId;
+        private bool m_completed;
+
+        /// <summary>
+        /// First failure to create or write the file; later records are dropped, and the failure is thrown by <see cref="Complete"/>.
+        /// </summary>
+        private Exception m_failure;
+
+        /// <summary>
+        /// Creates a writer for <paramref name="fileName"/>, which is only created once the first record is written.
+        /// </summary>
+        /// <param name="fileName">The binary trace file</param>
+        /// <param name="compress">Whether to compress the records; not worth it for a file that is only read once, right away</param>
+        public SandboxedProcessTraceWriter(string fileName, bool compress)
+        {
+            m_fileName = fileName;
+            m_compress = compress;
+        }
+
+        /// <summary>
+        /// Writes the string of <paramref name="path"/>, which must precede the first operation on it.
+        /// </summary>
+        public void WritePath(AbsolutePath path, string pathString)
+        {
+            int byteCount = s_encoding.GetByteCount(pathString);
+            EnsureCapacity(1 + MaxVarIntLength * 2 + byteCount);
+
+            WriteByte((byte)RecordKind.Path);
+            WriteVarUInt((uint)path.RawValue);
+            WriteString(pathString, byteCount);
+        }
+
+        /// <summary>
+        /// Writes <paramref name="operation"/>. Operations must be written in increasing <see cref="SandboxedProcessTraceBuilder.Operation.Id"/> order.
+        /// </summary>
+        public void WriteOperation(in SandboxedProcessTraceBuilder.Operation operation)
+        {
+            var flags = (operation.IsAnAugmentedFileAccess ? OperationFlags.IsAnAugmentedFileAccess : OperationFlags.None)
+                | (operation.EnumeratePattern != null ? OperationFlags.HasEnumeratePattern : OperationFlags.None);
+            int patternByteCount = operation.EnumeratePattern != null ? s_encoding.GetByteCount(operation.EnumeratePattern) : 0;
+            EnsureCapacity(4 + MaxVarIntLength * 5 + patternByteCount);
+
+            WriteByte((byte)RecordKind.Operation);
+            WriteVarUInt(unchecked(operation.Id - m_lastOperationId));
+            WriteVarUInt(operation.ProcessId);
+            WriteVarUInt((uint)operation.Path.RawValue);
+            WriteByte((byte)operation.FileOperation);
+            WriteByte((byte)operation.RequestedAccess);
+            WriteVarUInt(operation.Error);
+            WriteByte((byte)flags);
+            if (operation.EnumeratePattern != null)
+            {
+                WriteString(operation.EnumeratePattern, patternByteCount);
+            }
+
+            m_lastOperationId = operation.Id;
+        }
+
+        /// <summary>
+        /// Writes <paramref name="processes"/> and the end of the trace, and waits for the file to be written.
+        /// </summary>
+        /// <exception cref="BuildXLException">The file could not be written.</exception>
+        public void Complete(IReadOnlyList<ReportedProcess> processes)
+        {
+            foreach (var process in processes)
+            {
+                int pathByteCount = s_encoding.GetByteCount(process.Path ?? string.Empty);
+                int argsByteCount = s_encoding.GetByteCount(process.ProcessArgs ?? string.Empty);
+                EnsureCapacity(1 + MaxVarIntLength * 8 + pathByteCount + argsByteCount);
+
+                WriteByte((byte)RecordKind.Process);
+                WriteVarUInt(process.ProcessId);
+                WriteString(process.Path ?? string.Empty, pathByteCount);
+                WriteVarUInt(process.ParentProcessId);
+                WriteVarUInt((ulong)process.CreationTime.ToUniversalTime().Ticks);
+                WriteVarUInt((ulong)process.ExitTime.ToUniversalTime().Ticks);
+                WriteVarUInt(process.ExitCode);
+                WriteString(process.ProcessArgs ?? string.Empty, argsByteCount);
+            }
+
+            EnsureCapacity(1);
+            WriteByte((byte)RecordKind.End);
+
+            Stop();
+
+            if (m_failure != null)
+            {
+                throw new BuildXLException("Failed to write the binary trace file " + m_fileName, m_failure);
+            }
+        }
+
+        /// <inheritdoc />
+        public void Dispose()
+        {
+            if (!m_completed)
+            {
+                m_chunk = null;
+                Stop();
+            }
+        }
+
+        /// <summary>
+        /// Hands the current chunk to the compressor, waits for it to finish, and closes the file.
+        /// </summary>
+        private void Stop()
+        {
+            m_completed = true;
+            QueueChunk();
+
+            // The last compressor started drains all the chunks queued before it
+            m_compressorTask?.Wait();
+
+            try
+            {
+                if (m_compressor != m_file)
+                {
+                    m_compressor?.Dispose();
+                }
+
+                m_file?.Dispose();
+            }
+            catch (Exception ex) when (m_failure == null)
+            {
+                m_failure = ex;
+            }
+
+            m_chunks.Dispose();
+        }
+
+        /// <summary>
+        /// Makes room for <paramref name="byteCount"/> bytes in the current chunk.
+        /// </summary>
+        private void EnsureCapacity(int byteCount)
+        {
+            if (m_chunk != null && m_length + byteCount <= m_chunk.Length)
+            {
+                return;
+            }
+
+            QueueChunk();
+
+            if (m_file == null && m_failure == null)
+            {
+                Open();
+            }
+
+            // Records larger than a chunk (e.g., very long command lines) get a chunk of their own
+            m_chunk = byteCount > ChunkSize
+                ? new byte[byteCount]
+                : m_freeChunks.TryTake(out var chunk) ? chunk : new byte[ChunkSize];
+            m_length = 0;
+        }
+
+        private void QueueChunk()
+        {
+            if (m_chunk == null || m_length == 0)
+            {
+                return;
+            }
+
+            if (m_compressor != null)
+            {
+                // Blocks while MaxQueuedChunks chunks are waiting for the compressor
+                m_chunks.Add((m_chunk, m_length));
+
+                if (Interlocked.CompareExchange(ref m_compressorRunning, 1, 0) == 0)
+                {
+                    m_compressorTask = Task.Run(CompressChunks);
+                }
+            }
+
+            m_chunk = null;
+            m_length = 0;
+        }
+
+        private void Open()
+        {
+            try
+            {
+                FileUtilities.CreateDirectory(Path.GetDirectoryName(m_fileName));
+                m_file = FileUtilities.CreateReplacementFile(m_fileName, FileShare.Read | FileShare.Delete, openAsync: false);
+                m_file.Write(Magic, 0, Magic.Length);
+                m_file.WriteByte(FormatVersion);
+                m_file.WriteByte((byte)(m_compress ? FileFlags.Compressed : FileFlags.None));
+                m_compressor = m_compress ? new DeflateStream(m_file, CompressionLevel.Fastest, leaveOpen: true) : m_file;
+            }
+            catch (Exception ex)
+            {
+                m_compressor = null;
+                m_file?.Dispose();
+                m_file = null;
+                m_failure = ex;
+            }
+        }
+
+        private void CompressChunks()
+        {
+            while (true)
+            {
+                while (m_chunks.TryTake(out var item))
+                {
+                    Compress(item.chunk, item.length);
+                }
+
+                Volatile.Write(ref m_compressorRunning, 0);
+
+                // A chunk queued after the queue was found empty, but before the flag was cleared, started no compressor
+                if (m_chunks.Count == 0 || Interlocked.CompareExchange(ref m_compressorRunning, 1, 0) != 0)
+                {
+                    return;
+                }
+            }
+        }
+
+        private void Compress(byte[] chunk, int length)
+        {
+            if (m_failure == null)
+            {
+                try
+                {
+                    m_compressor.Write(chunk, 0, length);
+                }
+                catch (Exception ex)
+                {
+                    // Keep draining the queue so the reporting thread never blocks on a failed trace
+                    m_failure = ex;
+                }
+            }
+
+            if (chunk.Length == ChunkSize)
+            {
+                m_freeChunks.Add(chunk);
+            }
+        }
+
+        private void WriteByte(byte value) => m_chunk[m_length++] = value;
+
+        private void WriteVarUInt(ulong value)
+        {
+            while (value >= 0x80)
+            {
+                m_chunk[m_length++] = (byte)(value | 0x80);
+                value >>= 7;
+            }
+
+            m_chunk[m_length++] = (byte)value;
+        }
+
+        private void WriteString(string value, int byteCount)
+        {
+            WriteVarUInt((uint)byteCount);
+            m_length += s_encoding.GetBytes(value, 0, value.Length, m_chunk, m_length);
+        }
+    }
+}
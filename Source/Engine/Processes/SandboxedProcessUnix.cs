@@ -111,10 +111,15 @@ namespace BuildXL.Processes
         private readonly ActionBlockSlim<SandboxReportLinux> m_pendingReports;
         private readonly SandboxedProcessTraceBuilder? m_traceBuilder;
 
-        private readonly CancellableTimedAction? m_perfCollector;
+        private readonly TimeSpan m_perfSamplingInterval;
+        private ProcessTreeResourceSampler.Registration? m_perfSampler;
 
         private readonly ReadWriteLock m_snapshotRwl = ReadWriteLock.Create();
-        private readonly Dictionary<string, Process.ProcessResourceUsage>? m_processResourceUsage;
+        private readonly Dictionary<(int processId, string name), Process.ProcessResourceUsage>? m_processResourceUsage;
+
+        // When set, the process tree is accounted through its own cgroup instead of procfs (see SandboxedProcessResourceMonitoringConfig.CgroupRoot)
+        private readonly string? m_cgroupRoot;
+        private PipCgroup? m_cgroup;
 
         private IEnumerable<ReportedProcess>? m_survivingChildProcesses;
 
@@ -202,6 +207,8 @@ namespace BuildXL.Processes
 
         private const double NanosecondsToMillisecondsFactor = 1000000d;
 
+        private static TimeSpan MicrosecondsToTimeSpan(ulong microseconds) => TimeSpan.FromTicks((long)microseconds * (TimeSpan.TicksPerMillisecond / 1000));
+
         /// <inheritdoc />
         public override int GetLastMessageCount() => m_reports.GetLastMessageCount();
 
@@ -224,15 +231,13 @@ namespace BuildXL.Processes
             if (info.MonitoringConfig is not null && info.MonitoringConfig.MonitoringEnabled)
             {
                 m_processResourceUsage = new(capacity: 20);
-
-                m_perfCollector = new CancellableTimedAction(
-                    callback: UpdatePerfCounters,
-                    intervalMs: (int)info.MonitoringConfig.RefreshInterval.TotalMilliseconds);
+                m_cgroupRoot = OperatingSystemHelper.IsLinuxOS ? info.MonitoringConfig.CgroupRoot : null;
+                m_perfSamplingInterval = info.MonitoringConfig.RefreshInterval;
             }
 
             // We cannot create a trace file if we are ignoring file accesses.
             m_traceBuilder = info.CreateSandboxTraceFile
-               ? new SandboxedProcessTraceBuilder(info.FileStorage, info.PathTable)
+               ? new SandboxedProcessTraceBuilder(info.FileStorage, info.PathTable, info.SandboxTraceFormat)
                : null;
 
             m_reports = new SandboxedProcessReports(
@@ -265,31 +270,43 @@ namespace BuildXL.Processes
             ProcessStarted += (pid) => OnProcessStartedAsync(info).GetAwaiter().GetResult();
         }
 
-        private void UpdatePerfCounters()
+        /// <summary>
+        /// Starts sampling the resource usage of the process tree, from the builder-wide <see cref="ProcessTreeResourceSampler"/>.
+        /// </summary>
+        /// <remarks>
+        /// Full process tree observation is currently only supported on Linux based systems. macOS support will be added later.
+        /// </remarks>
+        private void StartPerfSampling()
         {
-            // TODO: Full process tree observation is currently only supported on Linux based systems. macOS support will be added later.
-            if (Process.HasExited || !OperatingSystemHelper.IsLinuxOS)
+            var cgroup = m_cgroup;
+            if (cgroup != null)
+            {
+                // The cgroup counters cover the whole tree. Sampling them periodically only matters for the memory peak.
+                m_perfSampler = ProcessTreeResourceSampler.Instance.RegisterCallback(m_perfSamplingInterval, () => cgroup.TrySample(out _));
+            }
+            else
+            {
+                m_perfSampler = ProcessTreeResourceSampler.Instance.RegisterProcessTree(ProcessId, m_perfSamplingInterval, UpdatePerfCounters);
+            }
+        }
+
+        private void UpdatePerfCounters(IReadOnlyList<Process.ProcessResourceUsage> snapshots)
+        {
+            if (Process.HasExited)
             {
                 return;
             }
 
-            var snapshots = Interop.Unix.Process.GetResourceUsageForProcessTree(ProcessId);
             using (m_snapshotRwl.AcquireWriteLock())
             {
                 foreach (var snapshot in snapshots)
                 {
-                    if (snapshot.HasValue)
-                    {
-                        // We use a combination of pid and process name as lookup key, this allows to have resource tracking
-                        // working when a process image gets substituted (exec) or when pids get reused (unlikely). If reuse
-                        // should happen, the only loophole would be if the process would have the same name as the intially
-                        // tracked one, in which case the code below would overwrite the resource usage data.
-                        var update = snapshot.Value;
-                        var key = $"{update.ProcessId}-{update.Name}";
-
-                        // Remove and replace the snapshot value to reflect changes of processes that are potentially being snapshotted several times
-                        m_processResourceUsage![key] = update;
-                    }
+                    // We use a combination of pid and process name as lookup key, this allows to have resource tracking
+                    // working when a process image gets substituted (exec) or when pids get reused (unlikely). If reuse
+                    // should happen, the only loophole would be if the process would have the same name as the intially
+                    // tracked one, in which case the code below would overwrite the resource usage data.
+                    // Remove and replace the snapshot value to reflect changes of processes that are potentially being snapshotted several times
+                    m_processResourceUsage![(snapshot.ProcessId, snapshot.Name)] = snapshot;
                 }
             }
         }
@@ -349,7 +366,15 @@ namespace BuildXL.Processes
         {
             if (OperatingSystemHelper.IsLinuxOS)
             {
-                m_perfCollector?.Start();
+                if (m_cgroupRoot != null)
+                {
+                    StartCgroupAccounting(m_cgroupRoot);
+                }
+
+                if (m_processResourceUsage != null)
+                {
+                    StartPerfSampling();
+                }
             }
 
             string? processStdinFileName = await FlushStandardInputToFileIfNeededAsync(info);
@@ -381,6 +406,28 @@ namespace BuildXL.Processes
             }
         }
 
+        /// <summary>
+        /// Moves the process tree into a cgroup of its own, falling back to sampling procfs if that is not possible.
+        /// </summary>
+        private void StartCgroupAccounting(string cgroupRoot)
+        {
+            var cgroup = PipCgroup.TryCreate(cgroupRoot);
+            if (cgroup == null)
+            {
+                LogDebug($"Cgroup root '{cgroupRoot}' can't be used, sampling resource usage through procfs");
+                return;
+            }
+
+            if (!cgroup.TryAddProcessTree(ProcessId))
+            {
+                LogDebug($"Process {ProcessId} could not be moved into a cgroup under '{cgroupRoot}', sampling resource usage through procfs");
+                cgroup.Dispose();
+                return;
+            }
+
+            m_cgroup = cgroup;
+        }
+
         /// <inheritdoc />
         protected override IEnumerable<ReportedProcess>? GetSurvivingChildProcesses()
         {
@@ -458,9 +505,7 @@ namespace BuildXL.Processes
         /// <inheritdoc />
         public override void Dispose()
         {
-            m_perfCollector?.Cancel();
-            m_perfCollector?.Join();
-            m_perfCollector?.Dispose();
+            m_perfSampler?.Dispose();
             m_timeoutTaskCancelationSource.Cancel();
 
             if (!Killed)
@@ -470,6 +515,8 @@ namespace BuildXL.Processes
                 KillAllChildProcesses();
             }
 
+            m_cgroup?.Dispose();
+
             // If ptrace runners have not finished yet, then do that now
             // Completing the task below will make us kill any leftover PTraceRunner processes
             KillActivePTraceRunners();
@@ -477,6 +524,8 @@ namespace BuildXL.Processes
             m_pathCache.Clear();
 
             base.Dispose();
+
+            m_traceBuilder?.Dispose();
         }
 
         /// <summary>
@@ -609,6 +658,12 @@ namespace BuildXL.Processes
             {
                 return base.GetCpuTimes();
             }
+            else if (m_cgroup != null && m_cgroup.TrySample(out var usage))
+            {
+                return new CpuTimes(
+                        user: MicrosecondsToTimeSpan(usage.UserTimeUs),
+                        system: MicrosecondsToTimeSpan(usage.SystemTimeUs));
+            }
             else
             {
                 using var _ = m_snapshotRwl.AcquireReadLock();
@@ -625,6 +680,26 @@ namespace BuildXL.Processes
             {
                 return base.GetJobAccountingInfo();
             }
+            else if (m_cgroup != null && m_cgroup.TrySample(out var usage))
+            {
+                // The counters are read when asked for, so they are exact even for the processes that exited since the last sample.
+                // The process count is the cumulative one from the process start reports: the cgroup only knows how many processes are alive at once.
+                int processCount = m_reports.Processes.Count;
+                return new JobObject.AccountingInformation
+                {
+                    IO = new IOCounters(new IO_COUNTERS()
+                    {
+                        ReadOperationCount = usage.ReadOps,
+                        ReadTransferCount = usage.ReadBytes,
+                        WriteOperationCount = usage.WriteOps,
+                        WriteTransferCount = usage.WriteBytes,
+                    }),
+                    MemoryCounters = ProcessMemoryCounters.CreateFromBytes(usage.MemoryPeakBytes, usage.MemoryCurrentBytes),
+                    KernelTime = MicrosecondsToTimeSpan(usage.SystemTimeUs),
+                    UserTime = MicrosecondsToTimeSpan(usage.UserTimeUs),
+                    NumberOfProcesses = processCount > 0 ? (uint)(processCount - 1) : 0, // Exclude the root process from the child count
+                };
+            }
             else
             {
                 using var _ = m_snapshotRwl.AcquireReadLock();
@@ -0,0 +1,370 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+
+namespace BuildXL.Processes.Sideband
+{
+    /// <summary>
+    /// The indexed path section of a sideband file, which follows the metadata in files with <see cref="SidebandWriter.IndexedFileEnvelope"/>.
+    /// </summary>
+    /// <remarks>
+    /// The recorded paths are sorted (ordinal) and front-coded: each path is stored as the number of characters it shares with the previous
+    /// path and the rest of it, so the many paths under the same directories cost little more than their file names. Every
+    /// <see cref="RestartInterval"/>-th path is stored in full, at an offset recorded by the index, and the section ends with a fixed-size
+    /// footer, so a reader of a mapped file finds everything from the end of the file.
+    ///
+    /// Format (offsets are relative to the start of the section, integers are little-endian or unsigned LEB128 varints):
+    ///     byte 0                      Marker; an empty string, at which readers of the legacy format stop
+    ///     varint path count
+    ///     varint restart interval
+    ///     Entries:                    varint shared prefix length (UTF-16 code units), varint suffix byte count, UTF-8 suffix
+    ///     Index:                      uint32 offset of every restart entry
+    ///     Footer:                     int64 section offset in the file, uint32 index offset, uint64 FNV-1a checksum of everything before the footer
+    /// </remarks>
+    internal static unsafe class SidebandPathIndex
+    {
+        /// <summary>
+        /// Every this many paths, a path is stored in full.
+        /// </summary>
+        internal const int RestartInterval = 32;
+
+        /// <nodoc />
+        internal const int FooterSize = sizeof(long) + sizeof(uint) + sizeof(ulong);
+
+        private const ulong Fnv1Basis64 = 14695981039346656037;
+        private const ulong Fnv1Prime64 = 1099511628211;
+
+        private static readonly Encoding s_encoding = new UTF8Encoding(encoderShouldEmitUTF8Identifier: false);
+
+        /// <summary>
+        /// Writes the section for <paramref name="paths"/> at the current position of <paramref name="stream"/>.
+        /// </summary>
+        internal static void Write(Stream stream, IReadOnlyCollection<string> paths)
+        {
+            var sortedPaths = new List<string>(paths);
+            sortedPaths.Sort(StringComparer.Ordinal);
+
+            long sectionOffset = stream.Position;
+            var buffer = new SectionBuffer(4096);
+            buffer.WriteByte(0);
+            buffer.WriteVarUInt((uint)sortedPaths.Count);
+            buffer.WriteVarUInt(RestartInterval);
+
+            var restartOffsets = new List<uint>((sortedPaths.Count + RestartInterval - 1) / RestartInterval);
+            string previous = string.Empty;
+            for (int i = 0; i < sortedPaths.Count; i++)
+            {
+                string path = sortedPaths[i];
+                int shared = 0;
+                if (i % RestartInterval == 0)
+                {
+                    restartOffsets.Add((uint)buffer.Length);
+                }
+                else
+                {
+                    int maxShared = Math.Min(previous.Length, path.Length);
+                    while (shared < maxShared && previous[shared] == path[shared])
+                    {
+                        shared++;
+                    }
+
+                    // The suffix must be valid UTF-16 on its own
+                    if (shared > 0 && char.IsHighSurrogate(path[shared - 1]))
+                    {
+                        shared--;
+                    }
+                }
+
+                buffer.WriteVarUInt((uint)shared);
+                buffer.WriteString(path, shared);
+                previous = path;
+            }
+
+            uint indexOffset = (uint)buffer.Length;
+            foreach (uint offset in restartOffsets)
+            {
+                buffer.WriteUInt32(offset);
+            }
+
+            ulong checksum = ComputeChecksum(buffer.Bytes, buffer.Length);
+            buffer.WriteUInt64((ulong)sectionOffset);
+            buffer.WriteUInt32(indexOffset);
+            buffer.WriteUInt64(checksum);
+
+            stream.Write(buffer.Bytes, 0, buffer.Length);
+        }
+
+        /// <summary>
+        /// Reads the footer at the end of a file and verifies the checksum of the section it ends.
+        /// </summary>
+        /// <param name="fileEnd">The end of the file</param>
+        /// <param name="fileLength">The length of the file</param>
+        /// <param name="firstAvailableOffset">The offset in the file of the first byte that can be read before <paramref name="fileEnd"/></param>
+        /// <param name="sectionOffset">The offset of the section in the file</param>
+        /// <param name="indexOffset">The offset of the index within the section</param>
+        internal static bool TryReadFooter(byte* fileEnd, long fileLength, long firstAvailableOffset, out long sectionOffset, out uint indexOffset)
+        {
+            sectionOffset = -1;
+            indexOffset = 0;
+            if (fileLength - firstAvailableOffset < FooterSize)
+            {
+                return false;
+            }
+
+            byte* footer = fileEnd - FooterSize;
+            sectionOffset = (long)ReadUInt64(footer);
+            indexOffset = ReadUInt32(footer + sizeof(long));
+            ulong checksum = ReadUInt64(footer + sizeof(long) + sizeof(uint));
+
+            if (sectionOffset < firstAvailableOffset || sectionOffset > fileLength - FooterSize)
+            {
+                return false;
+            }
+
+            long length = fileLength - FooterSize - sectionOffset;
+            return indexOffset <= length
+                && (length - indexOffset) % sizeof(uint) == 0
+                && ComputeChecksum(footer, length) == checksum;
+        }
+
+        private static ulong ComputeChecksum(byte[] bytes, int length)
+        {
+            fixed (byte* start = bytes)
+            {
+                return ComputeChecksum(start + length, length);
+            }
+        }
+
+        /// <summary>
+        /// FNV-1a of the <paramref name="length"/> bytes before <paramref name="end"/>.
+        /// </summary>
+        private static ulong ComputeChecksum(byte* end, long length)
+        {
+            ulong hash = Fnv1Basis64;
+            for (byte* current = end - length; current < end; current++)
+            {
+                hash = unchecked((hash ^ *current) * Fnv1Prime64);
+            }
+
+            return hash;
+        }
+
+        private static uint ReadUInt32(byte* p) => (uint)(p[0] | p[1] << 8 | p[2] << 16 | p[3] << 24);
+
+        private static ulong ReadUInt64(byte* p) => ReadUInt32(p) | (ulong)ReadUInt32(p + sizeof(uint)) << 32;
+
+        /// <summary>
+        /// Decodes the paths of a section one by one into a reused character buffer.
+        /// </summary>
+        /// <remarks>
+        /// Every read is bounds-checked, so a damaged section (e.g., the section of a file that was not completely written, read without
+        /// its footer) yields the paths before the damage. The memory of the section must stay valid while the decoder is used.
+        /// </remarks>
+        internal sealed class Decoder
+        {
+            private readonly byte* m_section;
+            private readonly long m_end;
+            private readonly byte* m_index;
+            private readonly int m_restartInterval;
+            private long m_position;
+            private int m_decoded;
+
+            /// <summary>
+            /// The number of paths the section records.
+            /// </summary>
+            public int Count { get; }
+
+            /// <summary>
+            /// The characters of the current path, in <c>[0, <see cref="Length"/>)</c>.
+            /// </summary>
+            public char[] Chars { get; private set; } = new char[260];
+
+            /// <nodoc />
+            public int Length { get; private set; }
+
+            /// <summary>
+            /// The number of leading characters the current path shares with the previous one.
+            /// </summary>
+            public int SharedLength { get; private set; }
+
+            /// <summary>
+            /// Whether decoding stopped before <see cref="Count"/> paths because the section is malformed.
+            /// </summary>
+            public bool IsMalformed { get; private set; }
+
+            /// <summary>
+            /// Creates a decoder for the section at <paramref name="section"/>.
+            /// </summary>
+            /// <param name="section">The start of the section (its marker)</param>
+            /// <param name="entriesEnd">The offset at which the entries end; the index offset of a verified section, the readable length otherwise</param>
+            /// <param name="indexLength">
+            /// The byte count of the index of a section verified by <see cref="TryReadFooter"/>, against which the restart entries are checked;
+            /// negative otherwise
+            /// </param>
+            public Decoder(byte* section, long entriesEnd, long indexLength)
+            {
+                m_section = section;
+                m_end = entriesEnd;
+                m_position = 1;
+
+                if (entriesEnd < 1 || section[0] != 0 || !TryReadVarUInt(out ulong count) || !TryReadVarUInt(out ulong restartInterval)
+                    || count > int.MaxValue || restartInterval == 0 || restartInterval > int.MaxValue)
+                {
+                    IsMalformed = true;
+                    return;
+                }
+
+                Count = (int)count;
+                m_restartInterval = (int)restartInterval;
+                if (indexLength >= 0)
+                {
+                    if ((ulong)indexLength / sizeof(uint) != (count + restartInterval - 1) / restartInterval)
+                    {
+                        IsMalformed = true;
+                        return;
+                    }
+
+                    m_index = section + entriesEnd;
+                }
+            }
+
+            /// <summary>
+            /// Decodes the next path, if any.
+            /// </summary>
+            public bool MoveNext()
+            {
+                if (IsMalformed || m_decoded == Count)
+                {
+                    return false;
+                }
+
+                bool isRestart = m_decoded % m_restartInterval == 0;
+                if (isRestart && m_index != null && ReadUInt32(m_index + (m_decoded / m_restartInterval) * sizeof(uint)) != m_position)
+                {
+                    IsMalformed = true;
+                    return false;
+                }
+
+                if (!TryReadVarUInt(out ulong shared)
+                    || !TryReadVarUInt(out ulong suffixByteCount)
+                    || (isRestart && shared != 0)
+                    || shared > (ulong)Length
+                    || suffixByteCount > (ulong)(m_end - m_position))
+                {
+                    IsMalformed = true;
+                    return false;
+                }
+
+                // UTF-8 never takes fewer bytes than UTF-16 code units
+                int maxLength = (int)shared + (int)suffixByteCount;
+                if (maxLength > Chars.Length)
+                {
+                    var chars = new char[Math.Max(maxLength, Chars.Length * 2)];
+                    Array.Copy(Chars, chars, (int)shared);
+                    Chars = chars;
+                }
+
+                fixed (char* chars = Chars)
+                {
+                    Length = (int)shared + s_encoding.GetChars(m_section + m_position, (int)suffixByteCount, chars + shared, Chars.Length - (int)shared);
+                }
+
+                SharedLength = (int)shared;
+                m_position += (long)suffixByteCount;
+                m_decoded++;
+                return true;
+            }
+
+            private bool TryReadVarUInt(out ulong value)
+            {
+                value = 0;
+                for (int shift = 0; shift < 64 && m_position < m_end; shift += 7)
+                {
+                    byte b = m_section[m_position++];
+                    value |= (ulong)(b & 0x7F) << shift;
+                    if (b < 0x80)
+                    {
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+        }
+
+        /// <summary>
+        /// The section, encoded in memory before it is written.
+        /// </summary>
+        private sealed class SectionBuffer
+        {
+            public byte[] Bytes;
+            public int Length;
+
+            public SectionBuffer(int capacity)
+            {
+                Bytes = new byte[capacity];
+            }
+
+            public void WriteByte(byte value)
+            {
+                EnsureCapacity(1);
+                Bytes[Length++] = value;
+            }
+
+            public void WriteVarUInt(ulong value)
+            {
+                EnsureCapacity(10);
+                while (value >= 0x80)
+                {
+                    Bytes[Length++] = (byte)(value | 0x80);
+                    value >>= 7;
+                }
+
+                Bytes[Length++] = (byte)value;
+            }
+
+            public void WriteUInt32(uint value)
+            {
+                EnsureCapacity(sizeof(uint));
+                for (int i = 0; i < sizeof(uint); i++)
+                {
+                    Bytes[Length++] = (byte)(value >> (8 * i));
+                }
+            }
+
+            public void WriteUInt64(ulong value)
+            {
+                WriteUInt32((uint)value);
+                WriteUInt32((uint)(value >> 32));
+            }
+
+            /// <summary>
+            /// Writes the characters of <paramref name="value"/> from <paramref name="start"/> on, prefixed with their byte count.
+            /// </summary>
+            public void WriteString(string value, int start)
+            {
+                int byteCount;
+                fixed (char* chars = value)
+                {
+                    byteCount = s_encoding.GetByteCount(chars + start, value.Length - start);
+                }
+
+                WriteVarUInt((uint)byteCount);
+                EnsureCapacity(byteCount);
+                Length += s_encoding.GetBytes(value, start, value.Length - start, Bytes, Length);
+            }
+
+            private void EnsureCapacity(int byteCount)
+            {
+                if (Length + byteCount > Bytes.Length)
+                {
+                    Array.Resize(ref Bytes, Math.Max(Length + byteCount, Bytes.Length * 2));
+                }
+            }
+        }
+    }
+}
@@ -5,6 +5,7 @@ using System;
 using System.Collections.Generic;
 using System.Diagnostics.ContractsLight;
 using System.IO;
+using System.IO.MemoryMappedFiles;
 using System.Linq;
 using System.Threading;
 using BuildXL.Utilities.Core;
@@ -15,11 +16,22 @@ namespace BuildXL.Processes.Sideband
     /// A disposable reader for sideband files.
     /// 
     /// Uses <see cref="FileEnvelope"/> to check the integrity of the given file.
+    /// 
+    /// Reads both the legacy format, in which each recorded path is a string, and the indexed format written by
+    /// <see cref="SidebandWriter"/> once it is disposed (see <see cref="SidebandPathIndex"/>).
     /// </summary>
-    public sealed class SidebandReader : IDisposable
+    public sealed unsafe class SidebandReader : IDisposable
     {
         private readonly BuildXLReader m_bxlReader;
 
+        /// <summary>
+        /// The bytes of a file in the indexed format, from the end of its header on, read and verified by <see cref="ReadHeader"/>.
+        /// </summary>
+        private byte[] m_indexedContent;
+        private long m_indexedContentOffset;
+        private long m_sectionOffset;
+        private uint m_indexOffset;
+
         private int m_readCounter = 0;
 
         private void IncrementAndAssertOrder(Func<int, bool> condition, string errorMessage)
@@ -52,6 +64,128 @@ namespace BuildXL.Processes.Sideband
             return (paths, metadata);
         }
 
+        /// <summary>
+        /// Returns all recorded paths inside the <paramref name="sidebandFile"/> sideband file, created in <paramref name="pathTable"/>.
+        /// </summary>
+        /// <remarks>
+        /// A file in the indexed format is read through a memory mapping, and its paths are created without a string per path:
+        /// consecutive paths in the same directory, which the sorted paths mostly are, share the directory and only add their file name.
+        /// </remarks>
+        /// <exception cref="BuildXLException">The sideband file is compromised (see <see cref="ReadHeader"/>) or records an invalid path.</exception>
+        /// <exception cref="IOException">The sideband file could not be read.</exception>
+        public static (IReadOnlyList<AbsolutePath> Paths, SidebandMetadata Metadata) ReadSidebandFile(PathTable pathTable, string sidebandFile)
+        {
+            using var stream = new FileStream(sidebandFile, FileMode.Open, FileAccess.Read, FileShare.Read | FileShare.Delete);
+            using var bxlReader = new BuildXLReader(debug: false, stream: stream, leaveOpen: true);
+
+            if (!SidebandWriter.IndexedFileEnvelope.TryReadHeader(stream, ignoreChecksum: false).Succeeded)
+            {
+                stream.Position = 0;
+                var header = SidebandWriter.FileEnvelope.TryReadHeader(stream, ignoreChecksum: false);
+                if (!header.Succeeded)
+                {
+                    throw new BuildXLException($"Sideband file '{sidebandFile}' is compromised: {header.Failure.Describe()}");
+                }
+
+                var legacyMetadata = SidebandMetadata.Deserialize(bxlReader);
+                var legacyPaths = new List<AbsolutePath>();
+                string pathString;
+                while ((pathString = ReadStringOrNull(bxlReader)) != null && pathString.Length > 0)
+                {
+                    legacyPaths.Add(CreatePath(pathTable, pathString, sidebandFile));
+                }
+
+                return (legacyPaths, legacyMetadata);
+            }
+
+            var metadata = SidebandMetadata.Deserialize(bxlReader);
+            long sectionOffset = stream.Position;
+            long length = stream.Length;
+
+#if NETCOREAPP
+            using var mapping = MemoryMappedFile.CreateFromFile(stream, mapName: null, capacity: 0, MemoryMappedFileAccess.Read, HandleInheritability.None, leaveOpen: true);
+#else
+            using var mapping = MemoryMappedFile.CreateFromFile(stream, mapName: null, capacity: 0, MemoryMappedFileAccess.Read, memoryMappedFileSecurity: null, HandleInheritability.None, leaveOpen: true);
+#endif
+            using var view = mapping.CreateViewAccessor(0, length, MemoryMappedFileAccess.Read);
+
+            byte* start = null;
+            view.SafeMemoryMappedViewHandle.AcquirePointer(ref start);
+            try
+            {
+                start += view.PointerOffset;
+                if (!SidebandPathIndex.TryReadFooter(start + length, length, firstAvailableOffset: 0, out long footerSectionOffset, out uint indexOffset)
+                    || footerSectionOffset != sectionOffset)
+                {
+                    throw new BuildXLException($"Sideband file '{sidebandFile}' is compromised: wrong path section checksum");
+                }
+
+                var decoder = new SidebandPathIndex.Decoder(
+                    start + sectionOffset,
+                    entriesEnd: indexOffset,
+                    indexLength: length - SidebandPathIndex.FooterSize - sectionOffset - indexOffset);
+                var paths = CreatePaths(pathTable, decoder, sidebandFile);
+                if (decoder.IsMalformed)
+                {
+                    throw new BuildXLException($"Sideband file '{sidebandFile}' is compromised: malformed path section");
+                }
+
+                return (paths, metadata);
+            }
+            finally
+            {
+                view.SafeMemoryMappedViewHandle.ReleasePointer();
+            }
+        }
+
+        private static List<AbsolutePath> CreatePaths(PathTable pathTable, SidebandPathIndex.Decoder decoder, string sidebandFile)
+        {
+            var paths = new List<AbsolutePath>(Math.Min(decoder.Count, 1024));
+
+            // The directory of the previous path, which the current path shares when it shares its characters
+            AbsolutePath directory = AbsolutePath.Invalid;
+            int directoryLength = -1;
+
+            while (decoder.MoveNext())
+            {
+                char[] chars = decoder.Chars;
+                int length = decoder.Length;
+                if (decoder.SharedLength < directoryLength)
+                {
+                    directoryLength = -1;
+                }
+
+                int separator = Array.LastIndexOf(chars, Path.DirectorySeparatorChar, length - 1, length);
+
+                // Paths right under a root (e.g., '/a' or 'C:\a') are created from their string, as their directory is not a path on its own
+                if (separator > 0 && separator < length - 1 && chars[separator - 1] != ':')
+                {
+                    if (separator != directoryLength)
+                    {
+                        directory = CreatePath(pathTable, new string(chars, 0, separator), sidebandFile);
+                        directoryLength = separator;
+                    }
+
+                    if (PathAtom.TryCreate(pathTable.StringTable, new CharArraySegment(chars, separator + 1, length - separator - 1), out PathAtom name))
+                    {
+                        paths.Add(directory.Combine(pathTable, name));
+                        continue;
+                    }
+                }
+
+                paths.Add(CreatePath(pathTable, new string(chars, 0, length), sidebandFile));
+            }
+
+            return paths;
+        }
+
+        private static AbsolutePath CreatePath(PathTable pathTable, string path, string sidebandFile)
+        {
+            return AbsolutePath.TryCreate(pathTable, path, out AbsolutePath result)
+                ? result
+                : throw new BuildXLException($"Sideband file '{sidebandFile}' records an invalid path: '{path}'");
+        }
+
         /// <summary>
         /// Reads the header and returns if the sideband file has been compromised.
         /// 
@@ -61,10 +195,48 @@ namespace BuildXL.Processes.Sideband
         public bool ReadHeader(bool ignoreChecksum)
         {
             IncrementAndAssertOrder(cnt => cnt == 1, "Read header must be called first");
-            var result = SidebandWriter.FileEnvelope.TryReadHeader(m_bxlReader.BaseStream, ignoreChecksum);
+            var stream = m_bxlReader.BaseStream;
+            if (SidebandWriter.IndexedFileEnvelope.TryReadHeader(stream, ignoreChecksum: false).Succeeded)
+            {
+                long headerEnd = stream.Position;
+                bool intact = TryReadIndexedContent(stream);
+                stream.Position = headerEnd;
+                return intact;
+            }
+
+            stream.Position = 0;
+            var result = SidebandWriter.FileEnvelope.TryReadHeader(stream, ignoreChecksum);
             return result.Succeeded;
         }
 
+        /// <summary>
+        /// Reads the rest of a file in the indexed format and verifies its path section.
+        /// </summary>
+        private bool TryReadIndexedContent(Stream stream)
+        {
+            long offset = stream.Position;
+            var content = new byte[stream.Length - offset];
+            int read = 0;
+            int count;
+            while (read < content.Length && (count = stream.Read(content, read, content.Length - read)) > 0)
+            {
+                read += count;
+            }
+
+            fixed (byte* start = content)
+            {
+                if (read != content.Length
+                    || !SidebandPathIndex.TryReadFooter(start + content.Length, offset + content.Length, firstAvailableOffset: offset, out m_sectionOffset, out m_indexOffset))
+                {
+                    return false;
+                }
+            }
+
+            m_indexedContent = content;
+            m_indexedContentOffset = offset;
+            return true;
+        }
+
         /// <summary>
         /// Reads and returns the metadata.
         /// 
@@ -97,18 +269,64 @@ namespace BuildXL.Processes.Sideband
         public IEnumerable<string> ReadRecordedPaths()
         {
             IncrementAndAssertOrder(cnt => cnt > 2, "ReadRecordedPaths must be called after ReadHeader and ReadMetadata");
+            if (m_indexedContent != null)
+            {
+                long sectionLength = m_indexedContent.Length - (m_sectionOffset - m_indexedContentOffset) - SidebandPathIndex.FooterSize;
+                foreach (var path in DecodePaths(m_indexedContent, m_sectionOffset - m_indexedContentOffset, m_indexOffset, sectionLength - m_indexOffset))
+                {
+                    yield return path;
+                }
+
+                yield break;
+            }
+
             string nextString = null;
-            while ((nextString = ReadStringOrNull()) != null)
+            while ((nextString = ReadStringOrNull(m_bxlReader)) != null)
             {
+                if (nextString.Length == 0)
+                {
+                    // The marker of the path section of a file in the indexed format whose header or footer is damaged:
+                    // recover the paths before the damage
+                    var rest = new byte[1 + m_bxlReader.BaseStream.Length - m_bxlReader.BaseStream.Position];
+                    int read = 1;
+                    int count;
+                    while (read < rest.Length && (count = m_bxlReader.BaseStream.Read(rest, read, rest.Length - read)) > 0)
+                    {
+                        read += count;
+                    }
+
+                    foreach (var path in DecodePaths(rest, 0, entriesEnd: read, indexLength: -1))
+                    {
+                        yield return path;
+                    }
+
+                    yield break;
+                }
+
                 yield return nextString;
             }
         }
 
-        private string ReadStringOrNull()
+        private static List<string> DecodePaths(byte[] content, long sectionStart, long entriesEnd, long indexLength)
+        {
+            fixed (byte* start = content)
+            {
+                var decoder = new SidebandPathIndex.Decoder(start + sectionStart, entriesEnd, indexLength);
+                var paths = new List<string>(Math.Min(decoder.Count, 1024));
+                while (decoder.MoveNext())
+                {
+                    paths.Add(new string(decoder.Chars, 0, decoder.Length));
+                }
+
+                return paths;
+            }
+        }
+
+        private static string ReadStringOrNull(BuildXLReader reader)
         {
             try
             {
-                return m_bxlReader.ReadString();
+                return reader.ReadString();
             }
             catch (IOException)
             {
@@ -1,9 +1,14 @@
 ﻿// Copyright (c) Microsoft Corporation.
 // Licensed under the MIT License.
 
+using System;
 using System.Collections.Generic;
 using System.Diagnostics.ContractsLight;
+using System.IO;
+using System.Linq;
+using System.Threading.Tasks;
 using BuildXL.Utilities.Core;
+using BuildXL.Utilities.Instrumentation.Common;
 
 namespace BuildXL.Processes.Sideband
 {
@@ -61,6 +66,86 @@ namespace BuildXL.Processes.Sideband
             return new SidebandState(shouldPostponeDeletion: true, entries, extraneousFiles);
         }
 
+        /// <summary>
+        /// Reads <paramref name="sidebandFiles"/> concurrently and creates the state for lazy deletion of the paths they record.
+        /// </summary>
+        /// <param name="loggingContext">Logging context</param>
+        /// <param name="pathTable">Path table in which the recorded paths are created</param>
+        /// <param name="sidebandFiles">The sideband files on disk</param>
+        /// <param name="isKnownPip">
+        /// Whether the pip a sideband file was written for is in the pip graph; the files of other pips are <see cref="ExtraneousSidebandFiles"/>.
+        /// Called concurrently.
+        /// </param>
+        /// <param name="maxDegreeOfParallelism">Maximum number of files read at once</param>
+        /// <returns>
+        /// The state for lazy deletion, or for eager deletion if a sideband file can't be read (logged as a warning), since the outputs of its pip are then unknown.
+        /// </returns>
+        public static SidebandState LoadForLazyDeletion(
+            LoggingContext loggingContext,
+            PathTable pathTable,
+            IReadOnlyList<string> sidebandFiles,
+            Func<SidebandMetadata, bool> isKnownPip,
+            int maxDegreeOfParallelism)
+        {
+            Contract.RequiresNotNull(sidebandFiles);
+            Contract.RequiresNotNull(isKnownPip);
+            Contract.Requires(maxDegreeOfParallelism > 0);
+
+            var contents = new (IReadOnlyList<AbsolutePath> Paths, SidebandMetadata Metadata)[sidebandFiles.Count];
+            var isKnown = new bool[sidebandFiles.Count];
+            var errors = new string[sidebandFiles.Count];
+
+            Parallel.For(
+                0,
+                sidebandFiles.Count,
+                new ParallelOptions { MaxDegreeOfParallelism = maxDegreeOfParallelism },
+                i =>
+                {
+                    try
+                    {
+                        contents[i] = SidebandReader.ReadSidebandFile(pathTable, sidebandFiles[i]);
+                        isKnown[i] = isKnownPip(contents[i].Metadata);
+                    }
+                    catch (Exception e) when (e is BuildXLException || e is IOException || e is UnauthorizedAccessException)
+                    {
+                        errors[i] = e.Message;
+                    }
+                });
+
+            bool allRead = true;
+            for (int i = 0; i < errors.Length; i++)
+            {
+                if (errors[i] != null)
+                {
+                    Tracing.Logger.Log.CannotReadSidebandFileWarning(loggingContext, sidebandFiles[i], errors[i]);
+                    allRead = false;
+                }
+            }
+
+            if (!allRead)
+            {
+                return CreateForEagerDeletion();
+            }
+
+            var entries = new Dictionary<long, IReadOnlyCollection<AbsolutePath>>(sidebandFiles.Count);
+            var extraneousFiles = new List<string>();
+            for (int i = 0; i < contents.Length; i++)
+            {
+                if (!isKnown[i])
+                {
+                    extraneousFiles.Add(sidebandFiles[i]);
+                    continue;
+                }
+
+                long pipSemiStableHash = contents[i].Metadata.PipSemiStableHash;
+                entries[pipSemiStableHash] = entries.TryGetValue(pipSemiStableHash, out var otherPaths)
+                    ? otherPaths.Union(contents[i].Paths).ToList()
+                    : contents[i].Paths;
+            }
+
+            return CreateForLazyDeletion(entries, extraneousFiles);
+        }
+
         /// <nodoc />
         public static SidebandState CreateForEagerDeletion()
         {
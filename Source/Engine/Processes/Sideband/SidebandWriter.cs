@@ -5,6 +5,7 @@ using System;
 using System.Collections.Generic;
 using System.IO;
 using System.Linq;
+using BuildXL.Native.IO;
 using BuildXL.Utilities.Core;
 using System.Diagnostics.CodeAnalysis;
 
@@ -18,6 +19,10 @@ namespace BuildXL.Processes.Sideband
     /// use all shared opaque directory outputs of a process as root directories.
     /// </summary>
     /// <remarks>
+    /// While the process runs, each recorded path is appended to the file as a string (the legacy format, <see cref="FileEnvelope"/>), so the
+    /// file lists the recorded paths even if the build is interrupted. Once the writer is disposed, the file is replaced with one in the indexed
+    /// format (<see cref="IndexedFileEnvelope"/>, <see cref="SidebandPathIndex"/>), which is smaller and faster to read at the start of the next build.
+    /// 
     /// NOTE: not thread-safe
     /// 
     /// NOTE: must be serializable in order to be compatible with VM execution; for this 
@@ -30,7 +35,13 @@ namespace BuildXL.Processes.Sideband
         /// </summary>
         public static readonly FileEnvelope FileEnvelope = new FileEnvelope(name: "SharedOpaqueSidebandState", version: 0);
 
+        /// <summary>
+        /// Envelope for serialization of sideband files in the indexed format
+        /// </summary>
+        public static readonly FileEnvelope IndexedFileEnvelope = new FileEnvelope(name: "SharedOpaqueSidebandState", version: 1);
+
         private readonly HashSet<AbsolutePath> m_recordedPathsCache;
+        private readonly List<string> m_recordedPaths;
         private readonly Lazy<BuildXLWriter> m_lazyBxlWriter;
         private readonly FileEnvelopeId m_envelopeId;
 
@@ -86,6 +97,7 @@ namespace BuildXL.Processes.Sideband
             SidebandLogFile = sidebandLogFile;
             RootDirectories = rootDirectories;
             m_recordedPathsCache = new HashSet<AbsolutePath>();
+            m_recordedPaths = new List<string>();
             m_envelopeId = FileEnvelopeId.Create();
 
             m_lazyBxlWriter = Lazy.Create(() =>
@@ -137,7 +149,9 @@ namespace BuildXL.Processes.Sideband
             {
                 if (m_recordedPathsCache.Add(path))
                 {
-                    m_lazyBxlWriter.Value.Write(path.ToString(pathTable));
+                    string pathString = path.ToString(pathTable);
+                    m_recordedPaths.Add(pathString);
+                    m_lazyBxlWriter.Value.Write(pathString);
                     if (flushImmediately)
                     {
                         m_lazyBxlWriter.Value.Flush();
@@ -174,6 +188,45 @@ namespace BuildXL.Processes.Sideband
             {
                 FileEnvelope.FixUpHeader(m_lazyBxlWriter.Value.BaseStream, m_envelopeId);
                 m_lazyBxlWriter.Value.Dispose();
+                WriteIndexedFile();
+            }
+        }
+
+        /// <summary>
+        /// Replaces the sideband file with one in the indexed format.
+        /// </summary>
+        /// <remarks>
+        /// The indexed file is written next to the sideband file and moved over it, so the sideband file is valid at all times. If that fails,
+        /// the sideband file is left in the legacy format, which <see cref="SidebandReader"/> also reads.
+        /// </remarks>
+        private void WriteIndexedFile()
+        {
+            string indexedFile = SidebandLogFile + ".tmp";
+            try
+            {
+                using (var writer = new BuildXLWriter(
+                    stream: new FileStream(indexedFile, FileMode.Create, FileAccess.Write, FileShare.Read | FileShare.Delete),
+                    debug: false,
+                    logStats: false,
+                    leaveOpen: false))
+                {
+                    IndexedFileEnvelope.WriteHeader(writer.BaseStream, m_envelopeId);
+                    Metadata.Serialize(writer);
+                    writer.Flush();
+                    SidebandPathIndex.Write(writer.BaseStream, m_recordedPaths);
+                    IndexedFileEnvelope.FixUpHeader(writer.BaseStream, m_envelopeId);
+                }
+
+                // Replaces the sideband file atomically (rename on Unix, MoveFileEx on Windows), unlike FileUtilities.MoveFileAsync on Unix
+#if NETCOREAPP
+                File.Move(indexedFile, SidebandLogFile, overwrite: true);
+#else
+                File.Replace(indexedFile, SidebandLogFile, destinationBackupFileName: null);
+#endif
+            }
+            catch (Exception e) when (e is IOException || e is UnauthorizedAccessException)
+            {
+                FileUtilities.TryDeleteFile(indexedFile, retryOnFailure: false);
             }
         }
 
@@ -0,0 +1,105 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Buffers.Binary;
+using System.IO;
+using System.Linq;
+using BuildXL.Processes;
+using BuildXL.Utilities.Core;
+using Xunit;
+
+namespace Test.BuildXL.Processes
+{
+    /// <summary>
+    /// Tests for the checksum of the manifest tree: the managed xxHash64 of <see cref="FileAccessManifest"/>, which must agree with the one
+    /// of the sandbox (XxHash64.h), and the checksum block written before the tree.
+    /// </summary>
+    public sealed class FileAccessManifestChecksumTests
+    {
+        /// <summary>
+        /// A manifest tree as serialized by <see cref="FileAccessManifest.GetManifestTreeBytes"/> (release layout, on Linux) for a scope on /usr
+        /// and a write policy on /out/bin/tool.
+        /// </summary>
+        /// <remarks>
+        /// CODESYNC: Public/Src/Sandbox/Windows/UnitTests/XxHash64Tests.cpp :: SerializedTree
+        /// </remarks>
+        private static readonly byte[] s_serializedTree =
+        {
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x00, 0x00, 0x24, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0xC5, 0x9D, 0x1C, 0x81, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x01, 0x00, 0x00, 0x10, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x02, 0x00, 0x00, 0x00,
+            0x48, 0x00, 0x00, 0x00, 0x29, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF9, 0x85, 0xA4, 0x80,
+            0x05, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x10, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x75, 0x73, 0x72, 0x00, 0xFB, 0xF5, 0xF8, 0xFB,
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x10, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x00, 0x00, 0x24, 0x00, 0x00, 0x00, 0x6F, 0x75, 0x74, 0x00,
+            0x46, 0xE6, 0x5C, 0xA2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x10,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x00, 0x00, 0x24, 0x00, 0x00, 0x00,
+            0x62, 0x69, 0x6E, 0x00, 0xF5, 0x4A, 0xC0, 0x71, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
+            0x05, 0x00, 0x00, 0x10, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00,
+            0x74, 0x6F, 0x6F, 0x6C, 0x00, 0x00, 0x00, 0x00,
+        };
+
+        /// <summary>
+        /// The buffer of the xxHash sanity checks: bytes taken from the top of a 64-bit multiplicative sequence.
+        /// </summary>
+        private static byte[] GetSanityBuffer()
+        {
+            var buffer = new byte[222];
+            ulong generator = 2654435761UL;
+            for (int i = 0; i < buffer.Length; i++)
+            {
+                buffer[i] = (byte)(generator >> 56);
+                generator = unchecked(generator * 11400714785074694797UL);
+            }
+
+            return buffer;
+        }
+
+        /// <summary>
+        /// The published values of the xxHash sanity checks, for lengths that go through every path of the hash:
+        /// no stripe, the 1-byte tail, the 8- and 4-byte tails, and several 32-byte stripes.
+        /// </summary>
+        [Theory]
+        [InlineData(0, 0UL, 0xEF46DB3751D8E999UL)]
+        [InlineData(0, 2654435761UL, 0xAC75FDA2929B17EFUL)]
+        [InlineData(1, 0UL, 0xE934A84ADB052768UL)]
+        [InlineData(1, 2654435761UL, 0x5014607643A9B4C3UL)]
+        [InlineData(14, 0UL, 0x8282DCC4994E35C8UL)]
+        [InlineData(14, 2654435761UL, 0xC3BD6BF63DEB6DF0UL)]
+        [InlineData(222, 0UL, 0xB641AE8CB691C174UL)]
+        [InlineData(222, 2654435761UL, 0x20CB8AB7AE10C14AUL)]
+        public void MatchesTheReferenceVectors(int length, ulong seed, ulong expected)
+        {
+            Assert.Equal(expected, FileAccessManifest.XxHash64.Compute(GetSanityBuffer().AsSpan(0, length), seed));
+        }
+
+        [Fact]
+        public void MatchesTheNativeChecksumOfASerializedTree()
+        {
+            // The value XxHash64.h computes for the same bytes
+            Assert.Equal(0xBF4C0FC60D42B490UL, FileAccessManifest.XxHash64.Compute(s_serializedTree));
+        }
+
+        [Fact]
+        public void ChecksumBlockDescribesTheTree()
+        {
+            var pathTable = new PathTable();
+            var manifest = new FileAccessManifest(pathTable);
+            manifest.AddScope(AbsolutePath.Create(pathTable, Path.Combine(Path.GetTempPath(), "usr")), FileAccessPolicy.MaskNothing, FileAccessPolicy.AllowReadAlways);
+            manifest.AddPath(AbsolutePath.Create(pathTable, Path.Combine(Path.GetTempPath(), "out", "bin", "tool")), FileAccessPolicy.MaskNothing, FileAccessPolicy.AllowWrite);
+
+            // The tree ends the payload, right after its checksum block: record count, tree size and checksum
+            var payload = manifest.GetSwapPayloadBytes(new MemoryStream()).AsSpan();
+            byte[] tree = manifest.GetManifestTreeBytes();
+            Assert.True(payload.EndsWith(tree));
+
+            var checksumBlock = payload.Slice(payload.Length - tree.Length - 16, 16);
+            Assert.Equal((uint)manifest.Describe().Count(), BinaryPrimitives.ReadUInt32LittleEndian(checksumBlock));
+            Assert.Equal((uint)tree.Length, BinaryPrimitives.ReadUInt32LittleEndian(checksumBlock.Slice(4)));
+            Assert.Equal(FileAccessManifest.XxHash64.Compute(tree), BinaryPrimitives.ReadUInt64LittleEndian(checksumBlock.Slice(8)));
+        }
+    }
+}
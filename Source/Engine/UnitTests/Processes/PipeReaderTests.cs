@@ -0,0 +1,246 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Generic;
+using System.IO.Pipes;
+using System.Linq;
+using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
+using BuildXL.Interop.Unix;
+using BuildXL.Native.IO;
+using BuildXL.Native.Streams;
+using BuildXL.Native.Streams.Unix;
+using BuildXL.Processes.Internal;
+using BuildXL.Utilities.Core;
+using Microsoft.Win32.SafeHandles;
+using Test.BuildXL.Native;
+using Xunit;
+
+namespace Test.BuildXL.Processes
+{
+    /// <summary>
+    /// Tests for how the pipe readers split what they read into lines (<see cref="StreamLinesReceived"/>), and for the delivery of those
+    /// lines one by one (<see cref="StreamDataReceivedAdapter"/>).
+    /// </summary>
+    public sealed class PipeReaderTests : TemporaryDirectoryTestBase
+    {
+        private static readonly TimeSpan s_timeout = TimeSpan.FromSeconds(30);
+
+        /// <summary>
+        /// Records the lines delivered by a reader, call by call.
+        /// </summary>
+        private sealed class LineRecorder
+        {
+            private readonly TaskCompletionSource<bool> m_endOfStream = new TaskCompletionSource<bool>(TaskCreationOptions.RunContinuationsAsynchronously);
+
+            public List<(string[] lines, bool isEndOfStream)> Calls { get; } = new List<(string[] lines, bool isEndOfStream)>();
+
+            public IEnumerable<string> Lines => Calls.SelectMany(call => call.lines);
+
+            public void OnLinesReceived(ReadOnlySpan<ReadOnlyMemory<char>> lines, bool isEndOfStream)
+            {
+                // The lines are only valid during the call
+                var copy = new string[lines.Length];
+                for (int i = 0; i < lines.Length; i++)
+                {
+                    copy[i] = lines[i].ToString();
+                }
+
+                lock (Calls)
+                {
+                    Assert.False(m_endOfStream.Task.IsCompleted, "Lines received after the end of the stream");
+                    Calls.Add((copy, isEndOfStream));
+                }
+
+                if (isEndOfStream)
+                {
+                    m_endOfStream.SetResult(true);
+                }
+            }
+
+            public void WaitForEndOfStream() => Assert.True(m_endOfStream.Task.Wait(s_timeout), "The end of the stream was not delivered");
+        }
+
+        private static void Deliver(StreamDataReceivedAdapter adapter, bool isEndOfStream, params string[] lines)
+        {
+            adapter.OnLinesReceived(lines.Select(line => line.AsMemory()).ToArray(), isEndOfStream);
+        }
+
+        [Fact]
+        public void AdapterDefersTheLinesLeftWhenTheCallbackReturnsFalse()
+        {
+            var received = new List<string>();
+            var refuseAfter = new HashSet<string> { "b", "c", "e" };
+            var adapter = new StreamDataReceivedAdapter(line =>
+            {
+                received.Add(line);
+                return line == null || !refuseAfter.Contains(line);
+            });
+
+            // The rest of the batch waits for the next one, and comes before its lines
+            Deliver(adapter, false, "a", "b", "c", "d");
+            Assert.Equal(new[] { "a", "b" }, received);
+
+            // Refused again while delivering the pending lines: the new lines go after the ones still pending
+            Deliver(adapter, false, "e", "f");
+            Assert.Equal(new[] { "a", "b", "c" }, received);
+
+            Deliver(adapter, false);
+            Assert.Equal(new[] { "a", "b", "c", "d", "e" }, received);
+
+            // The end of the stream comes after the last pending line, as a null line
+            Deliver(adapter, true, "g");
+            Assert.Equal(new[] { "a", "b", "c", "d", "e", "f", "g", null }, received);
+        }
+
+        [Fact]
+        public void AdapterDefersTheEndOfTheStream()
+        {
+            var received = new List<string>();
+            var adapter = new StreamDataReceivedAdapter(line =>
+            {
+                received.Add(line);
+                return line != "last";
+            });
+
+            Deliver(adapter, true, "first", "last");
+            Assert.Equal(new[] { "first", "last" }, received);
+
+            Deliver(adapter, false);
+            Assert.Equal(new[] { "first", "last", null }, received);
+        }
+
+        private (SafeFileHandle read, SafeFileHandle write) CreateFifo()
+        {
+            var path = GetFullPath("fifo");
+            Assert.Equal(0, IO.MkFifo(path, IO.FilePermissions.S_IRWXU));
+
+            // Opening either end blocks until the other one is opened
+            var read = Task.Run(() => IO.Open(path, IO.OpenFlags.O_RDONLY, 0));
+            var write = IO.Open(path, IO.OpenFlags.O_WRONLY, 0);
+            Assert.False(write.IsInvalid);
+            Assert.True(read.Wait(s_timeout));
+            Assert.False(read.Result.IsInvalid);
+            return (read.Result, write);
+        }
+
+        private static byte[] Utf8(string text) => Encoding.UTF8.GetBytes(text);
+
+        [LinuxFact]
+        public void AsyncPipeReaderSplitsLinesAcrossReads()
+        {
+            var (read, write) = CreateFifo();
+            var recorder = new LineRecorder();
+            var longLine = new string('x', 1000);
+            var accented = Utf8("café");
+
+            // Each chunk is given the time to be read on its own, so that lines, "\r\n" and a UTF-8 sequence are split between reads
+            var chunks = new[]
+            {
+                Utf8("first li"),
+                Utf8("ne\nsecond\r"),
+                Utf8("\nthird\rfourth\r\n\nfifth"),
+                Utf8(" line\n" + longLine + "\n"),
+                accented.Take(accented.Length - 1).ToArray(),
+                accented.Skip(accented.Length - 1).Concat(Utf8("\nunterminated")).ToArray(),
+            };
+
+            var file = new AsyncFileUnix(read, FileDesiredAccess.GenericRead, ownsHandle: true, GetFullPath("fifo"), FileKind.Pipe);
+            using (var reader = new AsyncPipeReader(file, recorder.OnLinesReceived, Encoding.UTF8, bufferSize: 256))
+            {
+                reader.BeginReadLine();
+                using (write)
+                {
+                    foreach (var chunk in chunks)
+                    {
+                        Assert.Equal(chunk.Length, IO.Write(write, chunk, 0, chunk.Length));
+                        Thread.Sleep(50);
+                    }
+                }
+
+                recorder.WaitForEndOfStream();
+                Assert.True(reader.CompletionAsync(waitForEof: true).Wait(s_timeout));
+            }
+
+            Assert.Equal(
+                new[] { "first line", "second", "third", "fourth", string.Empty, "fifth line", longLine, "café", "unterminated" },
+                recorder.Lines);
+
+            // The unterminated last line comes with the end of the stream, which is delivered once
+            Assert.Equal(new[] { "unterminated" }, recorder.Calls.Last().lines);
+            Assert.Equal(1, recorder.Calls.Count(call => call.isEndOfStream));
+        }
+
+#if NET6_0_OR_GREATER
+        private static (NamedPipeServerStream server, NamedPipeClientStream client) CreatePipe()
+        {
+            var name = Guid.NewGuid().ToString("N");
+            var server = new NamedPipeServerStream(name, PipeDirection.In, 1, PipeTransmissionMode.Byte, PipeOptions.Asynchronous);
+            var client = new NamedPipeClientStream(".", name, PipeDirection.Out);
+            var connection = server.WaitForConnectionAsync();
+            client.Connect((int)s_timeout.TotalMilliseconds);
+            Assert.True(connection.Wait(s_timeout));
+            return (server, client);
+        }
+
+        private static Task ReadWithPipelineReader(LineRecorder recorder, string text)
+        {
+            var (server, client) = CreatePipe();
+            using (server)
+            {
+                var reader = new PipelineAsyncPipeReader(server, recorder.OnLinesReceived, Encoding.UTF8);
+                reader.BeginReadLine();
+
+                // Chunks of a few bytes, given the time to be read one by one, so that lines and line terminators are split between reads
+                using (client)
+                {
+                    var bytes = Utf8(text);
+                    var chunkSizes = new[] { 1, 2, 3, 5, 7, 11, 13 };
+                    for (int offset = 0, i = 0; offset < bytes.Length; i++)
+                    {
+                        int count = Math.Min(chunkSizes[i % chunkSizes.Length], bytes.Length - offset);
+                        client.Write(bytes, offset, count);
+                        client.Flush();
+                        offset += count;
+                        Thread.Sleep(1);
+                    }
+                }
+
+                recorder.WaitForEndOfStream();
+                var completion = reader.CompletionAsync(waitForEof: true);
+                Assert.True(((IAsyncResult)completion).AsyncWaitHandle.WaitOne(s_timeout));
+                return completion;
+            }
+        }
+
+        [Fact]
+        public void PipelineReaderSplitsLinesAcrossReads()
+        {
+            var lines = new[] { "first line", string.Empty, "second", new string('x', 100), "café", "last" };
+            var recorder = new LineRecorder();
+
+            var completion = ReadWithPipelineReader(recorder, string.Join(Environment.NewLine, lines) + Environment.NewLine);
+            Assert.True(completion.IsCompletedSuccessfully, completion.Exception?.ToString());
+            Assert.Equal(lines, recorder.Lines);
+            Assert.Empty(recorder.Calls.Last().lines);
+        }
+
+        [Fact]
+        public void PipelineReaderFailsOnAnUnterminatedLastLine()
+        {
+            var recorder = new LineRecorder();
+
+            var completion = ReadWithPipelineReader(recorder, $"complete{Environment.NewLine}unterminated");
+            Assert.True(completion.IsFaulted);
+            var exception = Assert.IsType<BuildXLException>(completion.Exception.InnerException);
+            Assert.Contains("Incomplete pipe read: unterminated", exception.InnerException.Message);
+
+            // The complete lines and the end of the stream are still delivered
+            Assert.Equal(new[] { "complete" }, recorder.Lines);
+            Assert.True(recorder.Calls.Last().isEndOfStream);
+        }
+#endif
+    }
+}
@@ -0,0 +1,220 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Concurrent;
+using System.Diagnostics;
+using System.Linq;
+using System.Threading;
+using System.Threading.Tasks;
+using BuildXL.Processes;
+using Test.BuildXL.Native;
+using Xunit;
+using static BuildXL.Processes.ProcessExitWatcher;
+
+namespace Test.BuildXL.Processes
+{
+    /// <summary>
+    /// Tests for <see cref="ProcessExitWatcher"/>, on processes started by the tests and on processes they leave behind.
+    /// </summary>
+    /// <remarks>
+    /// On kernels without pidfds (before 5.3) every watch is <see cref="WatchResult.Unsupported"/>, and the tests only check that.
+    /// </remarks>
+    public sealed class ProcessExitWatcherTests
+    {
+        private static readonly TimeSpan s_timeout = TimeSpan.FromSeconds(30);
+
+        /// <summary>
+        /// Records the exits reported for one watch.
+        /// </summary>
+        private sealed class ExitRecorder
+        {
+            private readonly TaskCompletionSource<(int pid, ulong watchId, bool exited)> m_exit =
+                new TaskCompletionSource<(int pid, ulong watchId, bool exited)>(TaskCreationOptions.RunContinuationsAsynchronously);
+
+            private int m_count;
+
+            public int Count => Volatile.Read(ref m_count);
+
+            public void OnExit(int pid, ulong watchId, bool exited)
+            {
+                Interlocked.Increment(ref m_count);
+                m_exit.TrySetResult((pid, watchId, exited));
+            }
+
+            public (int pid, ulong watchId, bool exited) WaitForExit()
+            {
+                Assert.True(m_exit.Task.Wait(s_timeout), "The exit was not reported");
+                return m_exit.Task.Result;
+            }
+        }
+
+        private static Process StartShell(string command)
+        {
+            var process = Process.Start(new ProcessStartInfo("/bin/sh", new[] { "-c", command })
+            {
+                RedirectStandardInput = true,
+                RedirectStandardOutput = true,
+                UseShellExecute = false,
+            });
+
+            Assert.NotNull(process);
+            return process;
+        }
+
+        private static bool IsSupported(WatchResult result)
+        {
+            Assert.True(result == WatchResult.Watching || result == WatchResult.Unsupported, $"Unexpected result {result}");
+            return result == WatchResult.Watching;
+        }
+
+        [LinuxFact]
+        public void ReportsTheExitOfAChild()
+        {
+            using var process = StartShell("read line");
+            var recorder = new ExitRecorder();
+            if (!IsSupported(Instance.Watch(process.Id, recorder.OnExit, out var watchId)))
+            {
+                return;
+            }
+
+            Assert.NotEqual(0UL, watchId);
+
+            // Still running: nothing is reported until it exits
+            Thread.Sleep(100);
+            Assert.Equal(0, recorder.Count);
+
+            process.StandardInput.Close();
+            var exit = recorder.WaitForExit();
+            Assert.Equal((process.Id, watchId, true), exit);
+            Assert.True(process.WaitForExit((int)s_timeout.TotalMilliseconds));
+
+            Thread.Sleep(100);
+            Assert.Equal(1, recorder.Count);
+        }
+
+        [LinuxFact]
+        public void ReportsTheExitOfAnOrphanedProcess()
+        {
+            // The shell exits right away, leaving behind a background process that is not a child of this one
+            int orphan;
+            using (var shell = StartShell("sleep 0.5 > /dev/null 2>&1 & echo $!"))
+            {
+                orphan = int.Parse(shell.StandardOutput.ReadLine());
+                Assert.True(shell.WaitForExit((int)s_timeout.TotalMilliseconds));
+            }
+
+            var recorder = new ExitRecorder();
+            var result = Instance.Watch(orphan, recorder.OnExit, out var watchId);
+            if (result == WatchResult.AlreadyExited || !IsSupported(result))
+            {
+                return;
+            }
+
+            var stopwatch = Stopwatch.StartNew();
+            Assert.Equal((orphan, watchId, true), recorder.WaitForExit());
+
+            // Reported as it happens, well before a polling interval of a second would have noticed
+            Assert.True(stopwatch.Elapsed < TimeSpan.FromSeconds(5), $"Reported after {stopwatch.Elapsed}");
+        }
+
+        [LinuxFact]
+        public void ProcessesThatAlreadyExited()
+        {
+            int pid;
+            using (var process = StartShell("exit 0"))
+            {
+                pid = process.Id;
+                Assert.True(process.WaitForExit((int)s_timeout.TotalMilliseconds));
+            }
+
+            // The process was reaped, so there is nothing to watch (unless its pid was reused already, which is very unlikely)
+            var recorder = new ExitRecorder();
+            var result = Instance.Watch(pid, recorder.OnExit, out var watchId);
+            Assert.True(result == WatchResult.AlreadyExited || result == WatchResult.Unsupported, $"Unexpected result {result}");
+            Assert.Equal(0UL, watchId);
+            Assert.Equal(0, recorder.Count);
+        }
+
+        [LinuxFact]
+        public void UnwatchedExitsAreNotReported()
+        {
+            using var process = StartShell("read line");
+            var recorder = new ExitRecorder();
+            if (!IsSupported(Instance.Watch(process.Id, recorder.OnExit, out var watchId)))
+            {
+                return;
+            }
+
+            Instance.Unwatch(watchId);
+            process.StandardInput.Close();
+            Assert.True(process.WaitForExit((int)s_timeout.TotalMilliseconds));
+
+            // Give a report that would come anyway the time to arrive
+            Thread.Sleep(200);
+            Assert.Equal(0, recorder.Count);
+
+            // Unwatching again is harmless
+            Instance.Unwatch(watchId);
+        }
+
+        [LinuxFact]
+        public void ManyProcessesAndFailingCallbacks()
+        {
+            const int ProcessCount = 20;
+            var processes = Enumerable.Range(0, ProcessCount).Select(_ => StartShell("read line")).ToArray();
+            try
+            {
+                var exits = new ConcurrentDictionary<ulong, (int pid, bool exited, int count)>();
+                using var allReported = new CountdownEvent(ProcessCount);
+                var watchIds = new ulong[ProcessCount];
+                for (int i = 0; i < ProcessCount; i++)
+                {
+                    bool throws = i % 2 == 0;
+                    var result = Instance.Watch(
+                        processes[i].Id,
+                        (pid, watchId, exited) =>
+                        {
+                            exits.AddOrUpdate(watchId, (pid, exited, 1), (_, previous) => (previous.pid, previous.exited, previous.count + 1));
+                            allReported.Signal();
+
+                            // The watcher keeps reporting the exits of the other processes
+                            if (throws)
+                            {
+                                throw new InvalidOperationException("callback failure");
+                            }
+                        },
+                        out watchIds[i]);
+
+                    if (!IsSupported(result))
+                    {
+                        return;
+                    }
+                }
+
+                Assert.Equal(ProcessCount, watchIds.Distinct().Count());
+
+                // Exit in reverse order
+                for (int i = ProcessCount - 1; i >= 0; i--)
+                {
+                    processes[i].StandardInput.Close();
+                }
+
+                Assert.True(allReported.Wait(s_timeout), $"{allReported.CurrentCount} exits were not reported");
+                for (int i = 0; i < ProcessCount; i++)
+                {
+                    Assert.Equal((processes[i].Id, true, 1), exits[watchIds[i]]);
+                }
+            }
+            finally
+            {
+                foreach (var process in processes)
+                {
+                    process.StandardInput.Close();
+                    process.WaitForExit();
+                    process.Dispose();
+                }
+            }
+        }
+    }
+}
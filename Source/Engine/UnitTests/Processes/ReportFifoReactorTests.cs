@@ -0,0 +1,257 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Threading;
+using System.Threading.Tasks;
+using BuildXL.Interop.Unix;
+using BuildXL.Processes;
+using BuildXL.Utilities.Core;
+using Microsoft.Win32.SafeHandles;
+using Test.BuildXL.Native;
+using Xunit;
+
+namespace Test.BuildXL.Processes
+{
+    /// <summary>
+    /// Tests for <see cref="ReportFifoReactor"/>: the reassembly of the length-prefixed messages written to report FIFOs, sentinels, and how
+    /// reading stops.
+    /// </summary>
+    public sealed class ReportFifoReactorTests : TemporaryDirectoryTestBase
+    {
+        private static readonly TimeSpan s_timeout = TimeSpan.FromSeconds(30);
+
+        /// <summary>
+        /// Records what the reactor hands over for one FIFO.
+        /// </summary>
+        private sealed class RecordingConsumer : IReportFifoConsumer
+        {
+            public List<byte[]> Messages { get; } = new List<byte[]>();
+
+            public List<int> Sentinels { get; } = new List<int>();
+
+            /// <summary>
+            /// Whether to keep reading after a sentinel. By default, only <see cref="StopSentinel"/> stops.
+            /// </summary>
+            public Func<int, bool> OnSentinelReceived { get; set; } = sentinel => sentinel != StopSentinel;
+
+            public Action<byte[]> OnMessageReceived { get; set; }
+
+            /// <summary>
+            /// The failure reading stopped with, null if the consumer asked to stop.
+            /// </summary>
+            public TaskCompletionSource<string> Stopped { get; } = new TaskCompletionSource<string>(TaskCreationOptions.RunContinuationsAsynchronously);
+
+            public PooledObjectWrapper<byte[]> GetMessageBuffer(int length) => Pools.ByteArrayPool.GetInstance(length);
+
+            public bool OnMessage(PooledObjectWrapper<byte[]> message, int length)
+            {
+                using (message)
+                {
+                    var copy = message.Instance.Take(length).ToArray();
+                    OnMessageReceived?.Invoke(copy);
+                    Messages.Add(copy);
+                    return true;
+                }
+            }
+
+            public bool OnSentinel(int sentinel)
+            {
+                Sentinels.Add(sentinel);
+                return OnSentinelReceived(sentinel);
+            }
+
+            public void OnStopped(string failure) => Assert.True(Stopped.TrySetResult(failure), "Stopped twice");
+
+            public string WaitForStop()
+            {
+                Assert.True(Stopped.Task.Wait(s_timeout), "Reading did not stop");
+                return Stopped.Task.Result;
+            }
+        }
+
+        private const int StopSentinel = -1;
+
+        private int m_fifoCount;
+
+        private (SafeFileHandle read, SafeFileHandle write) CreateFifo()
+        {
+            var path = GetFullPath($"fifo{m_fifoCount++}");
+            Assert.Equal(0, IO.MkFifo(path, IO.FilePermissions.S_IRWXU));
+
+            // Like the report processors: a non-blocking reader, opened first so that opening the writer does not block
+            var read = IO.Open(path, IO.OpenFlags.O_RDONLY | IO.OpenFlags.O_NONBLOCK, 0);
+            Assert.False(read.IsInvalid);
+            var write = IO.Open(path, IO.OpenFlags.O_WRONLY, 0);
+            Assert.False(write.IsInvalid);
+            return (read, write);
+        }
+
+        private static byte[] Frame(int length, byte fill) => BitConverter.GetBytes(length).Concat(Enumerable.Repeat(fill, length)).ToArray();
+
+        private static byte[] Sentinel(int sentinel) => BitConverter.GetBytes(sentinel);
+
+        private static void WriteAll(SafeFileHandle handle, byte[] bytes, int offset, int count)
+        {
+            while (count > 0)
+            {
+                int written = IO.Write(handle, bytes, offset, count);
+                Assert.True(written > 0, $"write failed with errno {System.Runtime.InteropServices.Marshal.GetLastWin32Error()}");
+                offset += written;
+                count -= written;
+            }
+        }
+
+        private static void WriteAll(SafeFileHandle handle, byte[] bytes) => WriteAll(handle, bytes, 0, bytes.Length);
+
+        [LinuxFact]
+        public void ReassemblesMessagesSplitAcrossReads()
+        {
+            var (read, write) = CreateFifo();
+            using (read)
+            using (write)
+            {
+                var lengths = new[] { 1, 0, 17, 3, 250, 0, 4, 1000 };
+                var stream = lengths.SelectMany((length, i) => Frame(length, (byte)i)).Concat(Sentinel(StopSentinel)).ToArray();
+
+                var consumer = new RecordingConsumer();
+                ReportFifoReactor.Instance.Register(read, "split", consumer);
+
+                // Chunks of a few bytes, given time to be read one by one, so that length prefixes and messages get split
+                var chunkSizes = new[] { 1, 2, 3, 5, 7, 11, 13 };
+                for (int offset = 0, i = 0; offset < stream.Length; i++)
+                {
+                    int count = Math.Min(chunkSizes[i % chunkSizes.Length], stream.Length - offset);
+                    WriteAll(write, stream, offset, count);
+                    offset += count;
+                    Thread.Sleep(1);
+                }
+
+                Assert.Null(consumer.WaitForStop());
+                Assert.Equal(lengths, consumer.Messages.Select(m => m.Length));
+                for (int i = 0; i < lengths.Length; i++)
+                {
+                    Assert.True(consumer.Messages[i].All(b => b == (byte)i), $"message {i} is corrupt");
+                }
+
+                Assert.Equal(new[] { StopSentinel }, consumer.Sentinels);
+            }
+        }
+
+        [LinuxFact]
+        public void ManyFifosWithLargeMessages()
+        {
+            const int FifoCount = 8;
+            const int MessageCount = 50;
+
+            var fifos = Enumerable.Range(0, FifoCount).Select(_ => CreateFifo()).ToArray();
+            var consumers = Enumerable.Range(0, FifoCount).Select(_ => new RecordingConsumer()).ToArray();
+            try
+            {
+                for (int f = 0; f < FifoCount; f++)
+                {
+                    ReportFifoReactor.Instance.Register(fifos[f].read, $"fifo{f}", consumers[f]);
+                }
+
+                // Every FIFO gets messages much larger than a read, and larger than what a reactor thread reads from a FIFO
+                // before serving the others, interleaved with small ones
+                Parallel.For(0, FifoCount, f =>
+                {
+                    for (int i = 0; i < MessageCount; i++)
+                    {
+                        WriteAll(fifos[f].write, Frame(i % 25 == 0 ? 1_500_000 + f : 100 + i, (byte)(f * MessageCount + i)));
+                    }
+
+                    WriteAll(fifos[f].write, Sentinel(StopSentinel));
+                });
+
+                for (int f = 0; f < FifoCount; f++)
+                {
+                    Assert.Null(consumers[f].WaitForStop());
+                    Assert.Equal(MessageCount, consumers[f].Messages.Count);
+                    for (int i = 0; i < MessageCount; i++)
+                    {
+                        var message = consumers[f].Messages[i];
+                        Assert.Equal(i % 25 == 0 ? 1_500_000 + f : 100 + i, message.Length);
+                        Assert.True(message.All(b => b == (byte)(f * MessageCount + i)), $"message {i} of FIFO {f} is corrupt");
+                    }
+                }
+            }
+            finally
+            {
+                foreach (var (read, write) in fifos)
+                {
+                    read.Dispose();
+                    write.Dispose();
+                }
+            }
+        }
+
+        [LinuxFact]
+        public void SentinelsAndStopping()
+        {
+            var (read, write) = CreateFifo();
+            using (read)
+            using (write)
+            {
+                var consumer = new RecordingConsumer();
+                ReportFifoReactor.Instance.Register(read, "sentinels", consumer);
+
+                // A single write, so that the message after the stop sentinel is read along with it: it must be dropped
+                WriteAll(write, Frame(3, 1).Concat(Sentinel(-5)).Concat(Frame(2, 2)).Concat(Sentinel(StopSentinel)).Concat(Frame(1, 3)).ToArray());
+
+                Assert.Null(consumer.WaitForStop());
+                Assert.Equal(new[] { 3, 2 }, consumer.Messages.Select(m => m.Length));
+                Assert.Equal(new[] { -5, StopSentinel }, consumer.Sentinels);
+            }
+        }
+
+        [LinuxFact]
+        public void EndOfFileIsAFailure()
+        {
+            var (read, write) = CreateFifo();
+            using (read)
+            {
+                var consumer = new RecordingConsumer();
+                ReportFifoReactor.Instance.Register(read, "eof", consumer);
+
+                // A complete message, then half of one: the partial message is released when reading stops
+                WriteAll(write, Frame(8, 1).Concat(Frame(8, 2).Take(6)).ToArray());
+                write.Dispose();
+
+                Assert.Contains("EOF", consumer.WaitForStop());
+                Assert.Equal(new[] { 8 }, consumer.Messages.Select(m => m.Length));
+            }
+        }
+
+        [LinuxFact]
+        public void ConsumerExceptionsStopReading()
+        {
+            var (read, write) = CreateFifo();
+            using (read)
+            using (write)
+            {
+                var consumer = new RecordingConsumer
+                {
+                    OnMessageReceived = message =>
+                    {
+                        if (message.Length == 2)
+                        {
+                            throw new InvalidOperationException("unexpected report");
+                        }
+                    }
+                };
+
+                ReportFifoReactor.Instance.Register(read, "throwing", consumer);
+                WriteAll(write, Frame(1, 1).Concat(Frame(2, 2)).Concat(Frame(3, 3)).ToArray());
+
+                var failure = consumer.WaitForStop();
+                Assert.Contains("Could not process reports from FIFO throwing", failure);
+                Assert.Contains("unexpected report", failure);
+                Assert.Equal(new[] { 1 }, consumer.Messages.Select(m => m.Length));
+            }
+        }
+    }
+}
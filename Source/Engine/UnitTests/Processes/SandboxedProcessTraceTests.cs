@@ -0,0 +1,248 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+using BuildXL.Processes;
+using BuildXL.Utilities.Core;
+using Test.BuildXL.Native;
+using Xunit;
+
+namespace Test.BuildXL.Processes
+{
+    /// <summary>
+    /// Tests for the sandbox trace: <see cref="SandboxedProcessTraceBuilder"/> streams operations to a binary trace
+    /// (<see cref="SandboxedProcessTraceWriter"/>), which <see cref="SandboxedProcessTraceConverter"/> turns into the text format.
+    /// </summary>
+    public sealed class SandboxedProcessTraceTests : TemporaryDirectoryTestBase
+    {
+        private sealed class TraceFileStorage : ISandboxedProcessFileStorage
+        {
+            private readonly string m_traceFile;
+
+            public TraceFileStorage(string traceFile) => m_traceFile = traceFile;
+
+            public string GetFileName(SandboxedProcessFile file) => m_traceFile;
+        }
+
+        private readonly PathTable m_pathTable = new PathTable();
+
+        private string TraceFile => GetFullPath(Path.Combine("trace", "sandbox.trace"));
+
+        private SandboxedProcessTraceBuilder CreateBuilder(SandboxTraceFormat format)
+        {
+            return new SandboxedProcessTraceBuilder(new TraceFileStorage(TraceFile), m_pathTable, format);
+        }
+
+        /// <summary>
+        /// Reports <paramref name="operationCount"/> operations on a few paths, with all kinds of fields, and two processes.
+        /// Returns the operations that are expected in the trace.
+        /// </summary>
+        private List<SandboxedProcessTraceBuilder.Operation> Report(SandboxedProcessTraceBuilder builder, int operationCount)
+        {
+            var paths = Enumerable.Range(0, 50).Select(i => AbsolutePath.Create(m_pathTable, GetFullPath(Path.Combine("out", $"dir{i % 7}", $"file{i}.ü")))).ToArray();
+            var expected = new List<SandboxedProcessTraceBuilder.Operation>();
+            uint id = 0;
+
+            for (int i = 0; i < operationCount; i++)
+            {
+                // Operations the builder doesn't record don't take an id
+                if (i % 100 == 99)
+                {
+                    builder.ReportFileAccess(1, ReportedFileOperation.FirstAllowWriteCheckInProcess, RequestedAccess.Write, paths[0], 0, false, null);
+                }
+
+                var operation = new SandboxedProcessTraceBuilder.Operation
+                {
+                    Id = id++,
+                    ProcessId = (uint)(1000 + i % 3),
+                    Error = i % 11 == 0 ? 2u : 0u,
+                    Path = paths[i * 7 % paths.Length],
+                    FileOperation = i % 5 == 0 ? ReportedFileOperation.FindFirstFileEx : ReportedFileOperation.CreateFile,
+                    RequestedAccess = i % 5 == 0 ? RequestedAccess.Enumerate : i % 2 == 0 ? RequestedAccess.Read : RequestedAccess.Write,
+                    IsAnAugmentedFileAccess = i % 13 == 0,
+                    EnumeratePattern = i % 5 == 0 ? "*.c" : null,
+                };
+
+                builder.ReportFileAccess(
+                    operation.ProcessId,
+                    operation.FileOperation,
+                    operation.RequestedAccess,
+                    operation.Path,
+                    operation.Error,
+                    operation.IsAnAugmentedFileAccess,
+                    operation.EnumeratePattern);
+                expected.Add(operation);
+            }
+
+            var creationTime = new DateTime(2024, 1, 2, 3, 4, 5, DateTimeKind.Utc);
+            builder.ReportProcess(new ReportedProcess(1000, "/bin/sh", "sh -c make") { CreationTime = creationTime, ExitTime = creationTime.AddSeconds(3), ExitCode = 0 });
+            var child = new ReportedProcess(1001, "/bin/sh", "sh") { ParentProcessId = 1000, CreationTime = creationTime.AddSeconds(1), ExitTime = creationTime.AddSeconds(2), ExitCode = 2 };
+            builder.ReportProcess(child);
+            builder.UpdateProcessArgs(child, "/usr/bin/make", "make all " + new string('x', 100_000));
+
+            return expected;
+        }
+
+        private (byte version, List<SandboxedProcessTraceBuilder.Operation> operations, List<ReportedProcess> processes) ReadTrace(SandboxedProcessOutput output)
+        {
+            using (var reader = (StreamReader)output.CreateReader())
+            {
+                return SandboxedProcessTraceBuilder.ReadFromStream(reader, m_pathTable);
+            }
+        }
+
+        private void AssertExpectedTrace(List<SandboxedProcessTraceBuilder.Operation> expected, SandboxedProcessOutput output)
+        {
+            var (version, operations, processes) = ReadTrace(output);
+
+            Assert.Equal(SandboxedProcessTraceBuilder.Version, version);
+
+            // The text format has no null enumerate pattern
+            Assert.Equal(expected.Select(operation => operation with { EnumeratePattern = operation.EnumeratePattern ?? string.Empty }), operations);
+
+            Assert.Equal(2, processes.Count);
+            Assert.Equal("/bin/sh", processes[0].Path);
+            Assert.Equal("sh -c make", processes[0].ProcessArgs);
+            Assert.Equal(1000u, processes[1].ParentProcessId);
+            Assert.Equal("/usr/bin/make", processes[1].Path);
+            Assert.StartsWith("make all xxx", processes[1].ProcessArgs);
+            Assert.Equal(2u, processes[1].ExitCode);
+            Assert.Equal(new DateTime(2024, 1, 2, 3, 4, 7, DateTimeKind.Utc), processes[1].ExitTime);
+        }
+
+        [Theory]
+        [InlineData(SandboxTraceFormat.Text, 10)]
+        [InlineData(SandboxTraceFormat.Text, 50_000)]
+        [InlineData(SandboxTraceFormat.Binary, 10)]
+        [InlineData(SandboxTraceFormat.Binary, 50_000)]
+        public void RoundTrip(SandboxTraceFormat format, int operationCount)
+        {
+            List<SandboxedProcessTraceBuilder.Operation> expected;
+            SandboxedProcessOutput output;
+            using (var builder = CreateBuilder(format))
+            {
+                expected = Report(builder, operationCount);
+                Assert.Equal(operationCount, builder.OperationCount);
+                Assert.Equal(2, builder.ReportedProcessCount);
+
+                output = builder.Freeze();
+            }
+
+            Assert.False(output.HasException);
+            Assert.Equal(TraceFile, output.FileName);
+            Assert.Equal(new FileInfo(TraceFile).Length, output.Length);
+            Assert.Equal(format == SandboxTraceFormat.Binary, SandboxedProcessTraceConverter.IsBinaryTrace(TraceFile));
+            AssertExpectedTrace(expected, output);
+
+            // Only the trace file is left
+            Assert.Equal(new[] { TraceFile }, Directory.GetFiles(Path.GetDirectoryName(TraceFile)));
+        }
+
+        [Fact]
+        public async Task BinaryTraceIsReadAsTheTextFormat()
+        {
+            string text;
+            using (var builder = CreateBuilder(SandboxTraceFormat.Text))
+            {
+                Report(builder, 1000);
+                text = await builder.Freeze().ReadValueAsync();
+            }
+
+            File.Move(TraceFile, TraceFile + ".txt");
+
+            using (var builder = CreateBuilder(SandboxTraceFormat.Binary))
+            {
+                Report(builder, 1000);
+                var output = builder.Freeze();
+
+                Assert.Equal(Encoding.UTF8, output.Encoding);
+                Assert.Equal(text, await output.ReadValueAsync());
+
+                using (var reader = output.CreateReader())
+                {
+                    Assert.Equal(text, reader.ReadToEnd());
+                }
+
+                var converted = new StringWriter();
+                SandboxedProcessTraceConverter.ConvertToText(TraceFile, converted);
+                Assert.Equal(text, converted.ToString());
+            }
+        }
+
+        [Fact]
+        public async Task BinaryTraceReadsAreBoundedByTheTextLength()
+        {
+            using (var builder = CreateBuilder(SandboxTraceFormat.Binary))
+            {
+                Report(builder, 10_000);
+                var output = builder.Freeze();
+
+                // The binary trace is much shorter than its text format
+                string value = await output.ReadValueAsync(maxLength: 1000);
+                Assert.Equal(1000, value.Length);
+                Assert.StartsWith($"{SandboxedProcessTraceBuilder.Version}", value);
+            }
+        }
+
+        [Theory]
+        [InlineData(SandboxTraceFormat.Text)]
+        [InlineData(SandboxTraceFormat.Binary)]
+        public void DisposeWithoutFreezeDeletesTheBinaryTrace(SandboxTraceFormat format)
+        {
+            using (var builder = CreateBuilder(format))
+            {
+                Report(builder, 50_000);
+                Assert.True(Directory.EnumerateFiles(Path.GetDirectoryName(TraceFile)).Any());
+            }
+
+            Assert.Empty(Directory.EnumerateFiles(Path.GetDirectoryName(TraceFile)));
+        }
+
+        [Fact]
+        public void EmptyTrace()
+        {
+            using (var builder = CreateBuilder(SandboxTraceFormat.Binary))
+            {
+                var (_, operations, processes) = ReadTrace(builder.Freeze());
+
+                Assert.Empty(operations);
+                Assert.Empty(processes);
+            }
+        }
+
+        [Fact]
+        public void TruncatedBinaryTrace()
+        {
+            using (var builder = CreateBuilder(SandboxTraceFormat.Binary))
+            {
+                Report(builder, 10_000);
+                builder.Freeze();
+            }
+
+            long length = new FileInfo(TraceFile).Length;
+            foreach (long truncatedLength in new[] { 0, 3, 6, 7, length / 2, length - 1 })
+            {
+                using (var file = new FileStream(TraceFile, FileMode.Open))
+                {
+                    file.SetLength(truncatedLength);
+                }
+
+                Assert.Throws<BuildXLException>(() => SandboxedProcessTraceConverter.ConvertToText(TraceFile, new StringWriter()));
+            }
+        }
+
+        [Fact]
+        public void NotABinaryTrace()
+        {
+            string file = WriteFile("text.trace", "1\n0\n");
+
+            Assert.False(SandboxedProcessTraceConverter.IsBinaryTrace(file));
+            Assert.Throws<BuildXLException>(() => SandboxedProcessTraceConverter.ConvertToText(file, new StringWriter()));
+        }
+    }
+}
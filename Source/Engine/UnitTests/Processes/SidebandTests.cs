@@ -0,0 +1,337 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using BuildXL.Processes.Sideband;
+using BuildXL.Utilities.Core;
+using BuildXL.Utilities.Instrumentation.Common;
+using Test.BuildXL.Native;
+using Xunit;
+
+namespace Test.BuildXL.Processes
+{
+    /// <summary>
+    /// Tests for sideband files: the front-coded path section of the indexed format (<see cref="SidebandPathIndex"/>), and the recovery of the
+    /// recorded paths from files that were not completely written or were damaged.
+    /// </summary>
+    public sealed unsafe class SidebandTests : TemporaryDirectoryTestBase
+    {
+        private static readonly SidebandMetadata s_metadata = new SidebandMetadata(1234, new byte[] { 1, 2, 3 });
+
+        private readonly PathTable m_pathTable = new PathTable();
+
+        private string SidebandFile => GetFullPath(Path.Combine("sideband", "pip.sideband"));
+
+        /// <summary>
+        /// Paths under <see cref="TemporaryDirectoryTestBase.TemporaryDirectory"/>: many in a few directories, and a few unusual ones.
+        /// </summary>
+        private List<string> CreatePaths(int count)
+        {
+            var paths = new List<string>
+            {
+                GetFullPath("rootfile"),
+                GetFullPath(Path.Combine("a", "ünï", "cödé")),
+                GetFullPath(Path.Combine("a", "b", "😀x")),
+                GetFullPath(Path.Combine("a", "b", "😁y")),
+                GetFullPath(Path.Combine("a", "b", new string('q', 600))),
+            };
+
+            var random = new Random(count);
+            for (int i = 0; i < count; i++)
+            {
+                paths.Add(GetFullPath(Path.Combine("out", $"d{random.Next(20)}", $"sub{random.Next(30)}", "obj", $"f{i}.o")));
+            }
+
+            return paths;
+        }
+
+        /// <summary>
+        /// Records <paramref name="paths"/> (and a duplicate) in <see cref="SidebandFile"/>, leaving the writer undisposed if <paramref name="dispose"/> is false.
+        /// </summary>
+        private SidebandWriter WriteSidebandFile(IReadOnlyList<string> paths, bool dispose = true)
+        {
+            var writer = new SidebandWriter(s_metadata, SidebandFile, rootDirectories: null);
+            foreach (var path in paths)
+            {
+                Assert.True(writer.RecordFileWrite(m_pathTable, path, flushImmediately: true));
+            }
+
+            Assert.False(writer.RecordFileWrite(m_pathTable, paths[paths.Count - 1], flushImmediately: true));
+            if (dispose)
+            {
+                writer.Dispose();
+            }
+
+            return writer;
+        }
+
+        /// <summary>
+        /// Reads <paramref name="file"/> ignoring the checksum, which is what lets the paths of a compromised file be recovered.
+        /// </summary>
+        private static (bool intact, SidebandMetadata metadata, List<string> paths) Recover(string file)
+        {
+            using (var reader = new SidebandReader(file))
+            {
+                bool intact = reader.ReadHeader(ignoreChecksum: true);
+                var metadata = reader.ReadMetadata();
+                return (intact, metadata, reader.ReadRecordedPaths().ToList());
+            }
+        }
+
+        private static byte[] EncodeSection(IReadOnlyCollection<string> paths, int offset, out long sectionOffset)
+        {
+            using (var stream = new MemoryStream())
+            {
+                stream.Write(new byte[offset], 0, offset);
+                SidebandPathIndex.Write(stream, paths);
+                byte[] file = stream.ToArray();
+
+                fixed (byte* start = file)
+                {
+                    Assert.True(SidebandPathIndex.TryReadFooter(start + file.Length, file.Length, firstAvailableOffset: 0, out sectionOffset, out _));
+                }
+
+                return file;
+            }
+        }
+
+        /// <summary>
+        /// Decodes the section of <paramref name="file"/> at <paramref name="sectionOffset"/>, as a verified section or (without its footer) as a damaged one.
+        /// </summary>
+        private static List<(string path, int sharedLength)> DecodeSection(byte[] file, long sectionOffset, bool verified, out bool isMalformed)
+        {
+            fixed (byte* start = file)
+            {
+                SidebandPathIndex.Decoder decoder;
+                if (verified)
+                {
+                    Assert.True(SidebandPathIndex.TryReadFooter(start + file.Length, file.Length, firstAvailableOffset: 0, out _, out uint indexOffset));
+                    decoder = new SidebandPathIndex.Decoder(start + sectionOffset, indexOffset, file.Length - SidebandPathIndex.FooterSize - sectionOffset - indexOffset);
+                }
+                else
+                {
+                    decoder = new SidebandPathIndex.Decoder(start + sectionOffset, file.Length - sectionOffset, indexLength: -1);
+                }
+
+                var paths = new List<(string, int)>();
+                while (decoder.MoveNext())
+                {
+                    paths.Add((new string(decoder.Chars, 0, decoder.Length), decoder.SharedLength));
+                }
+
+                isMalformed = decoder.IsMalformed;
+                return paths;
+            }
+        }
+
+        [Fact]
+        public void FrontCodedSectionRoundTrip()
+        {
+            var paths = CreatePaths(1000);
+            var sortedPaths = paths.OrderBy(p => p, StringComparer.Ordinal).ToList();
+
+            byte[] file = EncodeSection(paths, offset: 10, out long sectionOffset);
+            Assert.Equal(10, sectionOffset);
+
+            var decoded = DecodeSection(file, sectionOffset, verified: true, out bool isMalformed);
+
+            Assert.False(isMalformed);
+            Assert.Equal(sortedPaths, decoded.Select(d => d.path).ToList());
+            for (int i = 0; i < decoded.Count; i++)
+            {
+                if (i % SidebandPathIndex.RestartInterval == 0)
+                {
+                    Assert.Equal(0, decoded[i].sharedLength);
+                }
+                else
+                {
+                    string previous = sortedPaths[i - 1];
+                    string path = sortedPaths[i];
+                    Assert.True(decoded[i].sharedLength <= Math.Min(previous.Length, path.Length));
+                    Assert.Equal(previous.Substring(0, decoded[i].sharedLength), path.Substring(0, decoded[i].sharedLength));
+                }
+            }
+
+            // The shared directories are stored once in a while, not once per path
+            Assert.True(file.Length < paths.Sum(p => p.Length) / 3, $"Section of {file.Length} bytes");
+        }
+
+        [Fact]
+        public void FrontCodingDoesNotSplitSurrogatePairs()
+        {
+            // The two emojis share their high surrogate, which must stay with the low surrogate in the suffix
+            var paths = new[] { "/a/b/😀x", "/a/b/😁y" };
+
+            byte[] file = EncodeSection(paths, offset: 0, out long sectionOffset);
+            var decoded = DecodeSection(file, sectionOffset, verified: true, out bool isMalformed);
+
+            Assert.False(isMalformed);
+            Assert.Equal(paths, decoded.Select(d => d.path).ToArray());
+            Assert.Equal("/a/b/".Length, decoded[1].sharedLength);
+        }
+
+        [Fact]
+        public void EmptySection()
+        {
+            byte[] file = EncodeSection(Array.Empty<string>(), offset: 0, out long sectionOffset);
+
+            Assert.Empty(DecodeSection(file, sectionOffset, verified: true, out bool isMalformed));
+            Assert.False(isMalformed);
+        }
+
+        [Fact]
+        public void FooterChecksumDetectsDamage()
+        {
+            byte[] file = EncodeSection(CreatePaths(100), offset: 0, out _);
+
+            for (int i = 0; i < file.Length - SidebandPathIndex.FooterSize; i += 7)
+            {
+                file[i] ^= 0x55;
+                fixed (byte* start = file)
+                {
+                    Assert.False(SidebandPathIndex.TryReadFooter(start + file.Length, file.Length, firstAvailableOffset: 0, out _, out _), $"Damage at {i} not detected");
+                }
+
+                file[i] ^= 0x55;
+            }
+        }
+
+        [Fact]
+        public void TruncatedSectionDecodesThePathsBeforeTheDamage()
+        {
+            var paths = CreatePaths(500);
+            var sortedPaths = paths.OrderBy(p => p, StringComparer.Ordinal).ToList();
+            byte[] file = EncodeSection(paths, offset: 0, out long sectionOffset);
+
+            for (int length = 1; length < file.Length; length += 97)
+            {
+                var decoded = DecodeSection(file.Take(length).ToArray(), sectionOffset, verified: false, out bool isMalformed);
+
+                Assert.Equal(sortedPaths.Take(decoded.Count), decoded.Select(d => d.path));
+                Assert.True(isMalformed || decoded.Count == sortedPaths.Count);
+            }
+        }
+
+        [Fact]
+        public void IndexedFileRoundTrip()
+        {
+            var paths = CreatePaths(2000);
+            WriteSidebandFile(paths);
+
+            Assert.False(File.Exists(SidebandFile + ".tmp"));
+
+            var (intact, metadata, recordedPaths) = Recover(SidebandFile);
+            Assert.True(intact);
+            Assert.Equal(s_metadata, metadata);
+            Assert.Equal(paths.OrderBy(p => p, StringComparer.Ordinal), recordedPaths);
+
+            var (stringPaths, stringMetadata) = SidebandReader.ReadSidebandFile(SidebandFile, ignoreChecksum: false);
+            Assert.Equal(s_metadata, stringMetadata);
+            Assert.Equal(recordedPaths, stringPaths);
+
+            var pathTable = new PathTable();
+            var (absolutePaths, absoluteMetadata) = SidebandReader.ReadSidebandFile(pathTable, SidebandFile);
+            Assert.Equal(s_metadata, absoluteMetadata);
+            Assert.Equal(recordedPaths, absolutePaths.Select(p => p.ToString(pathTable)));
+            Assert.All(absolutePaths, p => Assert.Equal(AbsolutePath.Create(pathTable, p.ToString(pathTable)), p));
+        }
+
+        [Fact]
+        public void EmptyIndexedFile()
+        {
+            using (var writer = new SidebandWriter(s_metadata, SidebandFile, rootDirectories: null))
+            {
+                writer.EnsureHeaderWritten();
+            }
+
+            Assert.Empty(SidebandReader.ReadSidebandFile(SidebandFile, ignoreChecksum: false).Paths);
+            Assert.Empty(SidebandReader.ReadSidebandFile(new PathTable(), SidebandFile).Paths);
+        }
+
+        [Fact]
+        public void UndisposedWriterLeavesARecoverableLegacyFile()
+        {
+            var paths = CreatePaths(100);
+            using (WriteSidebandFile(paths, dispose: false))
+            {
+                string copy = GetFullPath("copy.sideband");
+                File.Copy(SidebandFile, copy);
+
+                var (intact, metadata, recordedPaths) = Recover(copy);
+                Assert.False(intact);
+                Assert.Equal(s_metadata, metadata);
+                Assert.Equal(paths, recordedPaths);
+
+                Assert.Throws<BuildXLException>(() => SidebandReader.ReadSidebandFile(new PathTable(), copy));
+            }
+        }
+
+        [Fact]
+        public void DamagedIndexedFileRecoversThePathsBeforeTheDamage()
+        {
+            var paths = CreatePaths(2000);
+            var sortedPaths = paths.OrderBy(p => p, StringComparer.Ordinal).ToList();
+            WriteSidebandFile(paths);
+            byte[] bytes = File.ReadAllBytes(SidebandFile);
+
+            // A flipped byte in the index: every path is still there, but the file is not intact
+            byte[] flipped = (byte[])bytes.Clone();
+            flipped[bytes.Length - SidebandPathIndex.FooterSize - 2] ^= 0x55;
+            File.WriteAllBytes(SidebandFile, flipped);
+
+            var (intact, metadata, recoveredPaths) = Recover(SidebandFile);
+            Assert.False(intact);
+            Assert.Equal(s_metadata, metadata);
+            Assert.Equal(sortedPaths.Take(recoveredPaths.Count), recoveredPaths);
+            Assert.Throws<BuildXLException>(() => SidebandReader.ReadSidebandFile(new PathTable(), SidebandFile));
+
+            // A truncated file: the paths before the end are recovered
+            File.WriteAllBytes(SidebandFile, bytes.Take(bytes.Length / 2).ToArray());
+
+            (intact, metadata, recoveredPaths) = Recover(SidebandFile);
+            Assert.False(intact);
+            Assert.Equal(s_metadata, metadata);
+            Assert.InRange(recoveredPaths.Count, sortedPaths.Count / 4, sortedPaths.Count - 1);
+            Assert.Equal(sortedPaths.Take(recoveredPaths.Count), recoveredPaths);
+            Assert.Throws<BuildXLException>(() => SidebandReader.ReadSidebandFile(new PathTable(), SidebandFile));
+        }
+
+        [Fact]
+        public void LoadForLazyDeletion()
+        {
+            var files = new List<string>();
+            var expected = new Dictionary<long, List<string>>();
+            for (int i = 0; i < 20; i++)
+            {
+                string file = GetFullPath(Path.Combine("sideband", $"pip{i}"));
+                var paths = Enumerable.Range(0, 50).Select(j => GetFullPath(Path.Combine("out", $"pip{i}", $"f{j}"))).ToList();
+                using (var writer = new SidebandWriter(new SidebandMetadata(i, new byte[] { 1 }), file, rootDirectories: null))
+                {
+                    paths.ForEach(path => writer.RecordFileWrite(m_pathTable, path, flushImmediately: false));
+                }
+
+                files.Add(file);
+                expected[i] = paths;
+            }
+
+            var pathTable = new PathTable();
+            var state = SidebandState.LoadForLazyDeletion(new LoggingContext("Test"), pathTable, files, metadata => metadata.PipSemiStableHash % 5 != 0, maxDegreeOfParallelism: 4);
+
+            Assert.True(state.ShouldPostponeDeletion);
+            Assert.Equal(files.Where((file, i) => i % 5 == 0), state.ExtraneousSidebandFiles);
+            Assert.Equal(16, state.Entries.Count);
+            foreach (var entry in state.Entries)
+            {
+                Assert.Equal(expected[entry.Key].OrderBy(p => p, StringComparer.Ordinal), entry.Value.Select(p => p.ToString(pathTable)).OrderBy(p => p, StringComparer.Ordinal));
+            }
+
+            // The outputs of a pip whose sideband file can't be read are unknown
+            File.WriteAllBytes(files[3], File.ReadAllBytes(files[3]).Take(100).ToArray());
+            state = SidebandState.LoadForLazyDeletion(new LoggingContext("Test"), new PathTable(), files, metadata => true, maxDegreeOfParallelism: 4);
+            Assert.False(state.ShouldPostponeDeletion);
+        }
+    }
+}
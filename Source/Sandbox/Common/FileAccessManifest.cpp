@@ -10,8 +10,15 @@ namespace common {
 FileAccessManifest::FileAccessManifest(char *payload, size_t payload_size) {
     payload_ = std::unique_ptr<char []>(payload);
     payload_size_ = payload_size;
+    manifest_tree_ = nullptr;
 
-    ParseFileAccessManifest();
+    // A manifest that fails to parse has no tree, so that a corrupt one is never looked up
+    if (!ParseFileAccessManifest()) {
+        manifest_tree_ = nullptr;
+        if (parse_error_.empty()) {
+            parse_error_ = "The file access manifest could not be parsed";
+        }
+    }
 }
 
 FileAccessManifest::~FileAccessManifest() { }
@@ -114,14 +121,29 @@ bool FileAccessManifest::ParseFileAccessManifest() {
         }
     }
 
-    // 12. Manifest Tree
+    // 12. Manifest Tree Checksum
+    // The checksum covers the whole tree, so a corrupted or truncated tree is detected with one pass over its bytes, in release builds too.
+    // Walking the tree is only done when the engine asks for it.
+    auto tree_checksum = ParseAndAdvancePointer<PCManifestTreeChecksum>(offset);
+    const char* tree_error = tree_checksum->CheckTree(&(payload_.get()[offset]), offset <= payload_size_ ? payload_size_ - offset : 0);
+    if (tree_error == nullptr && CheckValidateManifestTree(extra_flags_)) {
+        tree_error = tree_checksum->CheckTreeStructure(Parse<PCManifestRecord>(offset));
+    }
+
+    if (tree_error != nullptr) {
+        parse_error_ = tree_error;
+        return false;
+    }
+
+    // 13. Manifest Tree
     manifest_tree_ = Parse<PCManifestRecord>(offset);
     manifest_tree_->AssertValid();
 
     // Verify the parsed manifest
     // TODO [pgunasekara]: Change this to run only on Linux when Windows uses this code
-    std::string error;
-    assert(CheckValidUnixManifestTreeRoot(manifest_tree_, error) == true && error.c_str());
+    if (!CheckValidUnixManifestTreeRoot(manifest_tree_, parse_error_)) {
+        return false;
+    }
 
     return true;
 }
@@ -152,6 +174,9 @@ bool FileAccessManifest::CheckValidUnixManifestTreeRoot(PCManifestRecord node, s
 std::basic_string<PathChar> FileAccessManifest::ManifestTreeToString(PCManifestRecord node, const int indent, const int index) {
     if (node == nullptr) {
         node = manifest_tree_;
+        if (node == nullptr) {
+            return std::basic_string<PathChar>();
+        }
     }
 
     PathChar indent_str[indent+1];
@@ -96,6 +96,7 @@ private:
     PCManifestSubstituteProcessExecutionShim shim_info_;
     std::basic_string<PathChar> shim_path_;
     PCManifestRecord manifest_tree_;
+    std::string parse_error_;
 
     /**
      * Parses the serialized manifest payload from the provided payload.
@@ -113,6 +114,7 @@ public:
     /**
      * Construct a file access manifest object.
      * This constructor will create a copy of the payload.
+     * Check GetParseError() before using the manifest: when parsing fails, it has no manifest tree.
      * @param payload The serialized manifest payload.
      * @param payload_size The size of the payload.
      */
@@ -126,8 +128,10 @@ public:
     inline PCManifestReport GetReport() const                               { return report_; }
     inline PCManifestDllBlock GetDll() const                                { return dll_; }
     inline PCManifestSubstituteProcessExecutionShim GetShimInfo() const     { return shim_info_; }
+    // The tree is null when the payload is empty or could not be parsed.
     inline PCManifestRecord GetManifestTreeRoot() const                     { return manifest_tree_; }
-    inline PCManifestRecord GetUnixManifestTreeRoot() const                 { return manifest_tree_->BucketCount > 0 ? manifest_tree_->GetChildRecord(0) : manifest_tree_; }
+    inline const char* GetParseError() const                                { return parse_error_.empty() ? nullptr : parse_error_.c_str(); }
+    inline PCManifestRecord GetUnixManifestTreeRoot() const                 { return manifest_tree_ == nullptr || manifest_tree_->BucketCount == 0 ? manifest_tree_ : manifest_tree_->GetChildRecord(0); }
     // TODO [pgunasekara]: accept a length argument as reference instead of a pointer.
     inline const char *GetReportsPath(int *length) const                    { *length = report_->Size; return report_->Report.ReportPath; }
     bool ShouldBreakaway(const PathChar *path, const PathChar *const argv[]);
@@ -92,6 +92,18 @@
 //
 #if defined(DETOURS_X64) || defined(DETOURS_X86)
 
+#include "disasmlen.h"
+
+#ifdef DETOURS_X64
+#define DETOUR_DECODE_X64 true
+#else
+#define DETOUR_DECODE_X64 false
+#endif
+
+// Bytes the decoder may look at. It only reads the bytes the instruction is made of; the rare longer
+// ones (runs of redundant prefixes) are left to CDetourDis.
+#define DETOUR_MAX_DECODED_INSTRUCTION  32
+
 class CDetourDis
 {
   public:
@@ -204,6 +216,34 @@ PVOID WINAPI DetourCopyInstruction(PVOID pDst,
                                    LONG *plExtra)
 {
     (void)ppDstPool; // x86 & x64 don't use a constant pool.
+
+    // Most instructions of a prologue don't depend on where they are: those are sized by the
+    // table-driven decoder and copied as they are. Anything that has to be relocated, or whose
+    // target has to be looked up, goes through CDetourDis.
+    DETOUR_INSTRUCTION_LENGTH length;
+    if (pSrc != NULL &&
+        DetourDecodeInstructionLength((const uint8_t *)pSrc,
+                                      DETOUR_MAX_DECODED_INSTRUCTION,
+                                      DETOUR_DECODE_X64,
+                                      &length) &&
+        (length.fFlags & (DETOUR_INSTRUCTION_RELATIVE |
+                          DETOUR_INSTRUCTION_INDIRECT |
+                          DETOUR_INSTRUCTION_INVALID)) == 0) {
+
+        if (pDst != NULL) {
+            CopyMemory(pDst, pSrc, length.cbInstruction);
+        }
+        if (ppTarget != NULL) {
+            *ppTarget = (length.fFlags & DETOUR_INSTRUCTION_DYNAMIC)
+                ? DETOUR_INSTRUCTION_TARGET_DYNAMIC
+                : DETOUR_INSTRUCTION_TARGET_NONE;
+        }
+        if (plExtra != NULL) {
+            *plExtra = 0;
+        }
+        return (PBYTE)pSrc + length.cbInstruction;
+    }
+
     CDetourDis oDetourDisasm((PBYTE*)ppTarget, plExtra);
     return oDetourDisasm.CopyInstruction((PBYTE)pDst, (PBYTE)pSrc);
 }
@@ -519,6 +559,8 @@ PBYTE CDetourDis::CopyFF(REFCOPYENTRY pEntry, PBYTE pbDst, PBYTE pbSrc)
 
 ///////////////////////////////////////////////////////// Disassembler Tables.
 //
+// The length decoder (disasmlen.cpp) mirrors these tables: keep them in sync.
+//
 const BYTE CDetourDis::s_rbModRm[256] = {
     0,0,0,0, SIB|1,RIP|4,0,0, 0,0,0,0, SIB|1,RIP|4,0,0, // 0x
     0,0,0,0, SIB|1,RIP|4,0,0, 0,0,0,0, SIB|1,RIP|4,0,0, // 1x
@@ -0,0 +1,774 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  x86/x64 instruction-length decoder (disasmlen.cpp of detours.lib)
+//
+//  Copyright (c) Microsoft Corporation.  All rights reserved.
+//
+//  The tables below mirror the COPYENTRY tables of CDetourDis (disasm.cpp)
+//  entry for entry: LENGTH_Xxx describes the size of the instructions
+//  CDetourDis handles with ENTRY_Xxx. A change to one set of tables has to be
+//  made to the other one too.
+//
+
+#include "disasmlen.h"
+
+// How the byte at the current position is handled.
+enum : uint8_t {
+    KIND_BYTES,     // Last opcode byte of the instruction.
+    KIND_PREFIX,    // Prefix with no effect on the length (segments, LOCK, REP).
+    KIND_66,        // Operand-size override prefix.
+    KIND_67,        // Address-size override prefix.
+    KIND_REX,       // REX prefix on x64, 1-byte INC/DEC on x86.
+    KIND_0F,        // Escape to the two-byte opcode table.
+    KIND_F6,        // Group 3, byte operand: TEST takes an immediate.
+    KIND_F7,        // Group 3, word operand: TEST takes an immediate.
+    KIND_FF,        // Group 5: INC, DEC, CALL, JMP, PUSH.
+    KIND_INVALID,
+};
+
+// Flags for LENGTHENTRY::nFlags. RELATIVE and DYNAMIC are reported as is.
+enum : uint8_t {
+    RELATIVE    = DETOUR_INSTRUCTION_RELATIVE,
+    DYNAMIC     = DETOUR_INSTRUCTION_DYNAMIC,
+    ADDRESS     = 0x10u,    // Immediate is an address (MOV A0-A3).
+    RAX         = 0x20u,    // Immediate is 64-bit with REX.W (MOV B8-BF).
+};
+
+// Flags for s_rbModRm, same as CDetourDis.
+enum : uint8_t {
+    SIB         = 0x10u,
+    RIP         = 0x20u,
+    NOTSIB      = 0x0fu,
+};
+
+struct LENGTHENTRY
+{
+    uint8_t     nFixedSize;     // Size of the opcode and its operands, from the opcode byte.
+    uint8_t     nFixedSize16;   // Size when the operand size is 16 bits.
+    uint8_t     nModOffset;     // Offset of the mod/rm byte from the opcode byte (0=none).
+    uint8_t     nKind;
+    uint8_t     nFlags;
+};
+
+#define LENGTH_CopyBytes1           1, 1, 0, KIND_BYTES, 0
+#define LENGTH_CopyBytes1Dynamic    1, 1, 0, KIND_BYTES, DYNAMIC
+#define LENGTH_CopyBytes2           2, 2, 0, KIND_BYTES, 0
+#define LENGTH_CopyBytes2Jump       2, 2, 0, KIND_BYTES, RELATIVE
+#define LENGTH_CopyBytes2CantJump   2, 2, 0, KIND_BYTES, RELATIVE
+#define LENGTH_CopyBytes2Dynamic    2, 2, 0, KIND_BYTES, DYNAMIC
+#define LENGTH_CopyBytes3           3, 3, 0, KIND_BYTES, 0
+#define LENGTH_CopyBytes3Dynamic    3, 3, 0, KIND_BYTES, DYNAMIC
+#define LENGTH_CopyBytes3Or5        5, 3, 0, KIND_BYTES, 0
+#define LENGTH_CopyBytes3Or5Rax     5, 3, 0, KIND_BYTES, RAX
+#define LENGTH_CopyBytes3Or5Target  5, 3, 0, KIND_BYTES, RELATIVE
+#define LENGTH_CopyBytes5Or7Dynamic 7, 5, 0, KIND_BYTES, DYNAMIC
+#define LENGTH_CopyBytes3Or5Address 5, 3, 0, KIND_BYTES, ADDRESS
+#define LENGTH_CopyBytes4           4, 4, 0, KIND_BYTES, 0
+#define LENGTH_CopyBytes2Mod        2, 2, 1, KIND_BYTES, 0
+#define LENGTH_CopyBytes2Mod1       3, 3, 1, KIND_BYTES, 0
+#define LENGTH_CopyBytes2ModOperand 6, 4, 1, KIND_BYTES, 0
+#define LENGTH_CopyBytes3Mod        3, 3, 2, KIND_BYTES, 0
+#define LENGTH_CopyBytesPrefix      1, 1, 0, KIND_PREFIX, 0
+#define LENGTH_CopyBytesRax         1, 1, 0, KIND_REX, 0
+#define LENGTH_Copy0F               1, 1, 0, KIND_0F, 0
+#define LENGTH_Copy66               1, 1, 0, KIND_66, 0
+#define LENGTH_Copy67               1, 1, 0, KIND_67, 0
+#define LENGTH_CopyF6               0, 0, 0, KIND_F6, 0
+#define LENGTH_CopyF7               0, 0, 0, KIND_F7, 0
+#define LENGTH_CopyFF               0, 0, 0, KIND_FF, 0
+#define LENGTH_Invalid              1, 1, 0, KIND_INVALID, 0
+
+/////////////////////////////////////////////////////////// Disassembler Tables.
+//
+static const uint8_t s_rbModRm[256] = {
+    0,0,0,0, SIB|1,RIP|4,0,0, 0,0,0,0, SIB|1,RIP|4,0,0, // 0x
+    0,0,0,0, SIB|1,RIP|4,0,0, 0,0,0,0, SIB|1,RIP|4,0,0, // 1x
+    0,0,0,0, SIB|1,RIP|4,0,0, 0,0,0,0, SIB|1,RIP|4,0,0, // 2x
+    0,0,0,0, SIB|1,RIP|4,0,0, 0,0,0,0, SIB|1,RIP|4,0,0, // 3x
+    1,1,1,1, 2,1,1,1, 1,1,1,1, 2,1,1,1,                 // 4x
+    1,1,1,1, 2,1,1,1, 1,1,1,1, 2,1,1,1,                 // 5x
+    1,1,1,1, 2,1,1,1, 1,1,1,1, 2,1,1,1,                 // 6x
+    1,1,1,1, 2,1,1,1, 1,1,1,1, 2,1,1,1,                 // 7x
+    4,4,4,4, 5,4,4,4, 4,4,4,4, 5,4,4,4,                 // 8x
+    4,4,4,4, 5,4,4,4, 4,4,4,4, 5,4,4,4,                 // 9x
+    4,4,4,4, 5,4,4,4, 4,4,4,4, 5,4,4,4,                 // Ax
+    4,4,4,4, 5,4,4,4, 4,4,4,4, 5,4,4,4,                 // Bx
+    0,0,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,0,                 // Cx
+    0,0,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,0,                 // Dx
+    0,0,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,0,                 // Ex
+    0,0,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,0                  // Fx
+};
+
+static const LENGTHENTRY s_rleLengthTable[256] =
+{
+    /* 0x00 */ { LENGTH_CopyBytes2Mod },           // ADD /r
+    /* 0x01 */ { LENGTH_CopyBytes2Mod },           // ADD /r
+    /* 0x02 */ { LENGTH_CopyBytes2Mod },           // ADD /r
+    /* 0x03 */ { LENGTH_CopyBytes2Mod },           // ADD /r
+    /* 0x04 */ { LENGTH_CopyBytes2 },              // ADD ib
+    /* 0x05 */ { LENGTH_CopyBytes3Or5 },           // ADD iw
+    /* 0x06 */ { LENGTH_CopyBytes1 },              // PUSH
+    /* 0x07 */ { LENGTH_CopyBytes1 },              // POP
+    /* 0x08 */ { LENGTH_CopyBytes2Mod },           // OR /r
+    /* 0x09 */ { LENGTH_CopyBytes2Mod },           // OR /r
+    /* 0x0A */ { LENGTH_CopyBytes2Mod },           // OR /r
+    /* 0x0B */ { LENGTH_CopyBytes2Mod },           // OR /r
+    /* 0x0C */ { LENGTH_CopyBytes2 },              // OR ib
+    /* 0x0D */ { LENGTH_CopyBytes3Or5 },           // OR iw
+    /* 0x0E */ { LENGTH_CopyBytes1 },              // PUSH
+    /* 0x0F */ { LENGTH_Copy0F },                  // Extension Ops
+    /* 0x10 */ { LENGTH_CopyBytes2Mod },           // ADC /r
+    /* 0x11 */ { LENGTH_CopyBytes2Mod },           // ADC /r
+    /* 0x12 */ { LENGTH_CopyBytes2Mod },           // ADC /r
+    /* 0x13 */ { LENGTH_CopyBytes2Mod },           // ADC /r
+    /* 0x14 */ { LENGTH_CopyBytes2 },              // ADC ib
+    /* 0x15 */ { LENGTH_CopyBytes3Or5 },           // ADC id
+    /* 0x16 */ { LENGTH_CopyBytes1 },              // PUSH
+    /* 0x17 */ { LENGTH_CopyBytes1 },              // POP
+    /* 0x18 */ { LENGTH_CopyBytes2Mod },           // SBB /r
+    /* 0x19 */ { LENGTH_CopyBytes2Mod },           // SBB /r
+    /* 0x1A */ { LENGTH_CopyBytes2Mod },           // SBB /r
+    /* 0x1B */ { LENGTH_CopyBytes2Mod },           // SBB /r
+    /* 0x1C */ { LENGTH_CopyBytes2 },              // SBB ib
+    /* 0x1D */ { LENGTH_CopyBytes3Or5 },           // SBB id
+    /* 0x1E */ { LENGTH_CopyBytes1 },              // PUSH
+    /* 0x1F */ { LENGTH_CopyBytes1 },              // POP
+    /* 0x20 */ { LENGTH_CopyBytes2Mod },           // AND /r
+    /* 0x21 */ { LENGTH_CopyBytes2Mod },           // AND /r
+    /* 0x22 */ { LENGTH_CopyBytes2Mod },           // AND /r
+    /* 0x23 */ { LENGTH_CopyBytes2Mod },           // AND /r
+    /* 0x24 */ { LENGTH_CopyBytes2 },              // AND ib
+    /* 0x25 */ { LENGTH_CopyBytes3Or5 },           // AND id
+    /* 0x26 */ { LENGTH_CopyBytesPrefix },         // ES prefix
+    /* 0x27 */ { LENGTH_CopyBytes1 },              // DAA
+    /* 0x28 */ { LENGTH_CopyBytes2Mod },           // SUB /r
+    /* 0x29 */ { LENGTH_CopyBytes2Mod },           // SUB /r
+    /* 0x2A */ { LENGTH_CopyBytes2Mod },           // SUB /r
+    /* 0x2B */ { LENGTH_CopyBytes2Mod },           // SUB /r
+    /* 0x2C */ { LENGTH_CopyBytes2 },              // SUB ib
+    /* 0x2D */ { LENGTH_CopyBytes3Or5 },           // SUB id
+    /* 0x2E */ { LENGTH_CopyBytesPrefix },         // CS prefix
+    /* 0x2F */ { LENGTH_CopyBytes1 },              // DAS
+    /* 0x30 */ { LENGTH_CopyBytes2Mod },           // XOR /r
+    /* 0x31 */ { LENGTH_CopyBytes2Mod },           // XOR /r
+    /* 0x32 */ { LENGTH_CopyBytes2Mod },           // XOR /r
+    /* 0x33 */ { LENGTH_CopyBytes2Mod },           // XOR /r
+    /* 0x34 */ { LENGTH_CopyBytes2 },              // XOR ib
+    /* 0x35 */ { LENGTH_CopyBytes3Or5 },           // XOR id
+    /* 0x36 */ { LENGTH_CopyBytesPrefix },         // SS prefix
+    /* 0x37 */ { LENGTH_CopyBytes1 },              // AAA
+    /* 0x38 */ { LENGTH_CopyBytes2Mod },           // CMP /r
+    /* 0x39 */ { LENGTH_CopyBytes2Mod },           // CMP /r
+    /* 0x3A */ { LENGTH_CopyBytes2Mod },           // CMP /r
+    /* 0x3B */ { LENGTH_CopyBytes2Mod },           // CMP /r
+    /* 0x3C */ { LENGTH_CopyBytes2 },              // CMP ib
+    /* 0x3D */ { LENGTH_CopyBytes3Or5 },           // CMP id
+    /* 0x3E */ { LENGTH_CopyBytesPrefix },         // DS prefix
+    /* 0x3F */ { LENGTH_CopyBytes1 },              // AAS
+    /* 0x40 */ { LENGTH_CopyBytesRax },            // REX prefix (INC/DEC on x86)
+    /* 0x41 */ { LENGTH_CopyBytesRax },            // REX prefix (INC/DEC on x86)
+    /* 0x42 */ { LENGTH_CopyBytesRax },            // REX prefix (INC/DEC on x86)
+    /* 0x43 */ { LENGTH_CopyBytesRax },            // REX prefix (INC/DEC on x86)
+    /* 0x44 */ { LENGTH_CopyBytesRax },            // REX prefix (INC/DEC on x86)
+    /* 0x45 */ { LENGTH_CopyBytesRax },            // REX prefix (INC/DEC on x86)
+    /* 0x46 */ { LENGTH_CopyBytesRax },            // REX prefix (INC/DEC on x86)
+    /* 0x47 */ { LENGTH_CopyBytesRax },            // REX prefix (INC/DEC on x86)
+    /* 0x48 */ { LENGTH_CopyBytesRax },            // REX prefix (INC/DEC on x86)
+    /* 0x49 */ { LENGTH_CopyBytesRax },            // REX prefix (INC/DEC on x86)
+    /* 0x4A */ { LENGTH_CopyBytesRax },            // REX prefix (INC/DEC on x86)
+    /* 0x4B */ { LENGTH_CopyBytesRax },            // REX prefix (INC/DEC on x86)
+    /* 0x4C */ { LENGTH_CopyBytesRax },            // REX prefix (INC/DEC on x86)
+    /* 0x4D */ { LENGTH_CopyBytesRax },            // REX prefix (INC/DEC on x86)
+    /* 0x4E */ { LENGTH_CopyBytesRax },            // REX prefix (INC/DEC on x86)
+    /* 0x4F */ { LENGTH_CopyBytesRax },            // REX prefix (INC/DEC on x86)
+    /* 0x50 */ { LENGTH_CopyBytes1 },              // PUSH
+    /* 0x51 */ { LENGTH_CopyBytes1 },              // PUSH
+    /* 0x52 */ { LENGTH_CopyBytes1 },              // PUSH
+    /* 0x53 */ { LENGTH_CopyBytes1 },              // PUSH
+    /* 0x54 */ { LENGTH_CopyBytes1 },              // PUSH
+    /* 0x55 */ { LENGTH_CopyBytes1 },              // PUSH
+    /* 0x56 */ { LENGTH_CopyBytes1 },              // PUSH
+    /* 0x57 */ { LENGTH_CopyBytes1 },              // PUSH
+    /* 0x58 */ { LENGTH_CopyBytes1 },              // POP
+    /* 0x59 */ { LENGTH_CopyBytes1 },              // POP
+    /* 0x5A */ { LENGTH_CopyBytes1 },              // POP
+    /* 0x5B */ { LENGTH_CopyBytes1 },              // POP
+    /* 0x5C */ { LENGTH_CopyBytes1 },              // POP
+    /* 0x5D */ { LENGTH_CopyBytes1 },              // POP
+    /* 0x5E */ { LENGTH_CopyBytes1 },              // POP
+    /* 0x5F */ { LENGTH_CopyBytes1 },              // POP
+    /* 0x60 */ { LENGTH_CopyBytes1 },              // PUSHAD
+    /* 0x61 */ { LENGTH_CopyBytes1 },              // POPAD
+    /* 0x62 */ { LENGTH_CopyBytes2Mod },           // BOUND /r
+    /* 0x63 */ { LENGTH_CopyBytes2Mod },           // ARPL /r
+    /* 0x64 */ { LENGTH_CopyBytesPrefix },         // FS prefix
+    /* 0x65 */ { LENGTH_CopyBytesPrefix },         // GS prefix
+    /* 0x66 */ { LENGTH_Copy66 },                  // Operand Prefix
+    /* 0x67 */ { LENGTH_Copy67 },                  // Address Prefix
+    /* 0x68 */ { LENGTH_CopyBytes3Or5 },           // PUSH
+    /* 0x69 */ { LENGTH_CopyBytes2ModOperand },    //
+    /* 0x6A */ { LENGTH_CopyBytes2 },              // PUSH
+    /* 0x6B */ { LENGTH_CopyBytes2Mod1 },          // IMUL /r ib
+    /* 0x6C */ { LENGTH_CopyBytes1 },              // INS
+    /* 0x6D */ { LENGTH_CopyBytes1 },              // INS
+    /* 0x6E */ { LENGTH_CopyBytes1 },              // OUTS/OUTSB
+    /* 0x6F */ { LENGTH_CopyBytes1 },              // OUTS/OUTSW
+    /* 0x70 */ { LENGTH_CopyBytes2Jump },          // JO           // 0f80
+    /* 0x71 */ { LENGTH_CopyBytes2Jump },          // JNO          // 0f81
+    /* 0x72 */ { LENGTH_CopyBytes2Jump },          // JB/JC/JNAE   // 0f82
+    /* 0x73 */ { LENGTH_CopyBytes2Jump },          // JAE/JNB/JNC  // 0f83
+    /* 0x74 */ { LENGTH_CopyBytes2Jump },          // JE/JZ        // 0f84
+    /* 0x75 */ { LENGTH_CopyBytes2Jump },          // JNE/JNZ      // 0f85
+    /* 0x76 */ { LENGTH_CopyBytes2Jump },          // JBE/JNA      // 0f86
+    /* 0x77 */ { LENGTH_CopyBytes2Jump },          // JA/JNBE      // 0f87
+    /* 0x78 */ { LENGTH_CopyBytes2Jump },          // JS           // 0f88
+    /* 0x79 */ { LENGTH_CopyBytes2Jump },          // JNS          // 0f89
+    /* 0x7A */ { LENGTH_CopyBytes2Jump },          // JP/JPE       // 0f8a
+    /* 0x7B */ { LENGTH_CopyBytes2Jump },          // JNP/JPO      // 0f8b
+    /* 0x7C */ { LENGTH_CopyBytes2Jump },          // JL/JNGE      // 0f8c
+    /* 0x7D */ { LENGTH_CopyBytes2Jump },          // JGE/JNL      // 0f8d
+    /* 0x7E */ { LENGTH_CopyBytes2Jump },          // JLE/JNG      // 0f8e
+    /* 0x7F */ { LENGTH_CopyBytes2Jump },          // JG/JNLE      // 0f8f
+    /* 0x80 */ { LENGTH_CopyBytes2Mod1 },          // ADC/2 ib, etc.s
+    /* 0x81 */ { LENGTH_CopyBytes2ModOperand },    //
+    /* 0x82 */ { LENGTH_CopyBytes2 },              // MOV al,x
+    /* 0x83 */ { LENGTH_CopyBytes2Mod1 },          // ADC/2 ib, etc.
+    /* 0x84 */ { LENGTH_CopyBytes2Mod },           // TEST /r
+    /* 0x85 */ { LENGTH_CopyBytes2Mod },           // TEST /r
+    /* 0x86 */ { LENGTH_CopyBytes2Mod },           // XCHG /r @todo
+    /* 0x87 */ { LENGTH_CopyBytes2Mod },           // XCHG /r @todo
+    /* 0x88 */ { LENGTH_CopyBytes2Mod },           // MOV /r
+    /* 0x89 */ { LENGTH_CopyBytes2Mod },           // MOV /r
+    /* 0x8A */ { LENGTH_CopyBytes2Mod },           // MOV /r
+    /* 0x8B */ { LENGTH_CopyBytes2Mod },           // MOV /r
+    /* 0x8C */ { LENGTH_CopyBytes2Mod },           // MOV /r
+    /* 0x8D */ { LENGTH_CopyBytes2Mod },           // LEA /r
+    /* 0x8E */ { LENGTH_CopyBytes2Mod },           // MOV /r
+    /* 0x8F */ { LENGTH_CopyBytes2Mod },           // POP /0
+    /* 0x90 */ { LENGTH_CopyBytes1 },              // NOP
+    /* 0x91 */ { LENGTH_CopyBytes1 },              // XCHG
+    /* 0x92 */ { LENGTH_CopyBytes1 },              // XCHG
+    /* 0x93 */ { LENGTH_CopyBytes1 },              // XCHG
+    /* 0x94 */ { LENGTH_CopyBytes1 },              // XCHG
+    /* 0x95 */ { LENGTH_CopyBytes1 },              // XCHG
+    /* 0x96 */ { LENGTH_CopyBytes1 },              // XCHG
+    /* 0x97 */ { LENGTH_CopyBytes1 },              // XCHG
+    /* 0x98 */ { LENGTH_CopyBytes1 },              // CWDE
+    /* 0x99 */ { LENGTH_CopyBytes1 },              // CDQ
+    /* 0x9A */ { LENGTH_CopyBytes5Or7Dynamic },    // CALL cp
+    /* 0x9B */ { LENGTH_CopyBytes1 },              // WAIT/FWAIT
+    /* 0x9C */ { LENGTH_CopyBytes1 },              // PUSHFD
+    /* 0x9D */ { LENGTH_CopyBytes1 },              // POPFD
+    /* 0x9E */ { LENGTH_CopyBytes1 },              // SAHF
+    /* 0x9F */ { LENGTH_CopyBytes1 },              // LAHF
+    /* 0xA0 */ { LENGTH_CopyBytes3Or5Address },    // MOV
+    /* 0xA1 */ { LENGTH_CopyBytes3Or5Address },    // MOV
+    /* 0xA2 */ { LENGTH_CopyBytes3Or5Address },    // MOV
+    /* 0xA3 */ { LENGTH_CopyBytes3Or5Address },    // MOV
+    /* 0xA4 */ { LENGTH_CopyBytes1 },              // MOVS
+    /* 0xA5 */ { LENGTH_CopyBytes1 },              // MOVS/MOVSD
+    /* 0xA6 */ { LENGTH_CopyBytes1 },              // CMPS/CMPSB
+    /* 0xA7 */ { LENGTH_CopyBytes1 },              // CMPS/CMPSW
+    /* 0xA8 */ { LENGTH_CopyBytes2 },              // TEST
+    /* 0xA9 */ { LENGTH_CopyBytes3Or5 },           // TEST
+    /* 0xAA */ { LENGTH_CopyBytes1 },              // STOS/STOSB
+    /* 0xAB */ { LENGTH_CopyBytes1 },              // STOS/STOSW
+    /* 0xAC */ { LENGTH_CopyBytes1 },              // LODS/LODSB
+    /* 0xAD */ { LENGTH_CopyBytes1 },              // LODS/LODSW
+    /* 0xAE */ { LENGTH_CopyBytes1 },              // SCAS/SCASB
+    /* 0xAF */ { LENGTH_CopyBytes1 },              // SCAS/SCASD
+    /* 0xB0 */ { LENGTH_CopyBytes2 },              // MOV B0+rb
+    /* 0xB1 */ { LENGTH_CopyBytes2 },              // MOV B0+rb
+    /* 0xB2 */ { LENGTH_CopyBytes2 },              // MOV B0+rb
+    /* 0xB3 */ { LENGTH_CopyBytes2 },              // MOV B0+rb
+    /* 0xB4 */ { LENGTH_CopyBytes2 },              // MOV B0+rb
+    /* 0xB5 */ { LENGTH_CopyBytes2 },              // MOV B0+rb
+    /* 0xB6 */ { LENGTH_CopyBytes2 },              // MOV B0+rb
+    /* 0xB7 */ { LENGTH_CopyBytes2 },              // MOV B0+rb
+    /* 0xB8 */ { LENGTH_CopyBytes3Or5Rax },        // MOV B8+rb
+    /* 0xB9 */ { LENGTH_CopyBytes3Or5 },           // MOV B8+rb
+    /* 0xBA */ { LENGTH_CopyBytes3Or5 },           // MOV B8+rb
+    /* 0xBB */ { LENGTH_CopyBytes3Or5 },           // MOV B8+rb
+    /* 0xBC */ { LENGTH_CopyBytes3Or5 },           // MOV B8+rb
+    /* 0xBD */ { LENGTH_CopyBytes3Or5 },           // MOV B8+rb
+    /* 0xBE */ { LENGTH_CopyBytes3Or5 },           // MOV B8+rb
+    /* 0xBF */ { LENGTH_CopyBytes3Or5 },           // MOV B8+rb
+    /* 0xC0 */ { LENGTH_CopyBytes2Mod1 },          // RCL/2 ib, etc.
+    /* 0xC1 */ { LENGTH_CopyBytes2Mod1 },          // RCL/2 ib, etc.
+    /* 0xC2 */ { LENGTH_CopyBytes3 },              // RET
+    /* 0xC3 */ { LENGTH_CopyBytes1 },              // RET
+    /* 0xC4 */ { LENGTH_CopyBytes2Mod },           // LES
+    /* 0xC5 */ { LENGTH_CopyBytes2Mod },           // LDS
+    /* 0xC6 */ { LENGTH_CopyBytes2Mod1 },          // MOV
+    /* 0xC7 */ { LENGTH_CopyBytes2ModOperand },    // MOV
+    /* 0xC8 */ { LENGTH_CopyBytes4 },              // ENTER
+    /* 0xC9 */ { LENGTH_CopyBytes1 },              // LEAVE
+    /* 0xCA */ { LENGTH_CopyBytes3Dynamic },       // RET
+    /* 0xCB */ { LENGTH_CopyBytes1Dynamic },       // RET
+    /* 0xCC */ { LENGTH_CopyBytes1Dynamic },       // INT 3
+    /* 0xCD */ { LENGTH_CopyBytes2Dynamic },       // INT ib
+    /* 0xCE */ { LENGTH_CopyBytes1Dynamic },       // INTO
+    /* 0xCF */ { LENGTH_CopyBytes1Dynamic },       // IRET
+    /* 0xD0 */ { LENGTH_CopyBytes2Mod },           // RCL/2, etc.
+    /* 0xD1 */ { LENGTH_CopyBytes2Mod },           // RCL/2, etc.
+    /* 0xD2 */ { LENGTH_CopyBytes2Mod },           // RCL/2, etc.
+    /* 0xD3 */ { LENGTH_CopyBytes2Mod },           // RCL/2, etc.
+    /* 0xD4 */ { LENGTH_CopyBytes2 },              // AAM
+    /* 0xD5 */ { LENGTH_CopyBytes2 },              // AAD
+    /* 0xD6 */ { LENGTH_Invalid },                 //
+    /* 0xD7 */ { LENGTH_CopyBytes1 },              // XLAT/XLATB
+    /* 0xD8 */ { LENGTH_CopyBytes2Mod },           // FADD, etc.
+    /* 0xD9 */ { LENGTH_CopyBytes2Mod },           // F2XM1, etc.
+    /* 0xDA */ { LENGTH_CopyBytes2Mod },           // FLADD, etc.
+    /* 0xDB */ { LENGTH_CopyBytes2Mod },           // FCLEX, etc.
+    /* 0xDC */ { LENGTH_CopyBytes2Mod },           // FADD/0, etc.
+    /* 0xDD */ { LENGTH_CopyBytes2Mod },           // FFREE, etc.
+    /* 0xDE */ { LENGTH_CopyBytes2Mod },           // FADDP, etc.
+    /* 0xDF */ { LENGTH_CopyBytes2Mod },           // FBLD/4, etc.
+    /* 0xE0 */ { LENGTH_CopyBytes2CantJump },      // LOOPNE cb
+    /* 0xE1 */ { LENGTH_CopyBytes2CantJump },      // LOOPE cb
+    /* 0xE2 */ { LENGTH_CopyBytes2CantJump },      // LOOP cb
+    /* 0xE3 */ { LENGTH_CopyBytes2Jump },          // JCXZ/JECXZ
+    /* 0xE4 */ { LENGTH_CopyBytes2 },              // IN ib
+    /* 0xE5 */ { LENGTH_CopyBytes2 },              // IN id
+    /* 0xE6 */ { LENGTH_CopyBytes2 },              // OUT ib
+    /* 0xE7 */ { LENGTH_CopyBytes2 },              // OUT ib
+    /* 0xE8 */ { LENGTH_CopyBytes3Or5Target },     // CALL cd
+    /* 0xE9 */ { LENGTH_CopyBytes3Or5Target },     // JMP cd
+    /* 0xEA */ { LENGTH_CopyBytes5Or7Dynamic },    // JMP cp
+    /* 0xEB */ { LENGTH_CopyBytes2Jump },          // JMP cb
+    /* 0xEC */ { LENGTH_CopyBytes1 },              // IN ib
+    /* 0xED */ { LENGTH_CopyBytes1 },              // IN id
+    /* 0xEE */ { LENGTH_CopyBytes1 },              // OUT
+    /* 0xEF */ { LENGTH_CopyBytes1 },              // OUT
+    /* 0xF0 */ { LENGTH_CopyBytesPrefix },         // LOCK prefix
+    /* 0xF1 */ { LENGTH_Invalid },                 //
+    /* 0xF2 */ { LENGTH_CopyBytesPrefix },         // REPNE prefix
+    /* 0xF3 */ { LENGTH_CopyBytesPrefix },         // REPE prefix
+    /* 0xF4 */ { LENGTH_CopyBytes1 },              // HLT
+    /* 0xF5 */ { LENGTH_CopyBytes1 },              // CMC
+    /* 0xF6 */ { LENGTH_CopyF6 },                  // TEST/0, DIV/6
+    /* 0xF7 */ { LENGTH_CopyF7 },                  // TEST/0, DIV/6
+    /* 0xF8 */ { LENGTH_CopyBytes1 },              // CLC
+    /* 0xF9 */ { LENGTH_CopyBytes1 },              // STC
+    /* 0xFA */ { LENGTH_CopyBytes1 },              // CLI
+    /* 0xFB */ { LENGTH_CopyBytes1 },              // STI
+    /* 0xFC */ { LENGTH_CopyBytes1 },              // CLD
+    /* 0xFD */ { LENGTH_CopyBytes1 },              // STD
+    /* 0xFE */ { LENGTH_CopyBytes2Mod },           // DEC/1,INC/0
+    /* 0xFF */ { LENGTH_CopyFF },                  // CALL/2
+};
+
+static const LENGTHENTRY s_rleLengthTable0F[256] =
+{
+    /* 0x00 */ { LENGTH_CopyBytes2Mod },           // LLDT/2, etc.
+    /* 0x01 */ { LENGTH_CopyBytes2Mod },           // INVLPG/7, etc.
+    /* 0x02 */ { LENGTH_CopyBytes2Mod },           // LAR/r
+    /* 0x03 */ { LENGTH_CopyBytes2Mod },           // LSL/r
+    /* 0x04 */ { LENGTH_Invalid },                 // _04
+    /* 0x05 */ { LENGTH_Invalid },                 // _05
+    /* 0x06 */ { LENGTH_CopyBytes2 },              // CLTS
+    /* 0x07 */ { LENGTH_Invalid },                 // _07
+    /* 0x08 */ { LENGTH_CopyBytes2 },              // INVD
+    /* 0x09 */ { LENGTH_CopyBytes2 },              // WBINVD
+    /* 0x0A */ { LENGTH_Invalid },                 // _0A
+    /* 0x0B */ { LENGTH_CopyBytes2 },              // UD2
+    /* 0x0C */ { LENGTH_Invalid },                 // _0C
+    /* 0x0D */ { LENGTH_CopyBytes2Mod },           // PREFETCH
+    /* 0x0E */ { LENGTH_CopyBytes2 },              // FEMMS
+    /* 0x0F */ { LENGTH_CopyBytes3Mod },           // 3DNow Opcodes
+    /* 0x10 */ { LENGTH_CopyBytes2Mod },           // MOVSS MOVUPD MOVSD
+    /* 0x11 */ { LENGTH_CopyBytes2Mod },           // MOVSS MOVUPD MOVSD
+    /* 0x12 */ { LENGTH_CopyBytes2Mod },           // MOVLPD
+    /* 0x13 */ { LENGTH_CopyBytes2Mod },           // MOVLPD
+    /* 0x14 */ { LENGTH_CopyBytes2Mod },           // UNPCKLPD
+    /* 0x15 */ { LENGTH_CopyBytes2Mod },           // UNPCKHPD
+    /* 0x16 */ { LENGTH_CopyBytes2Mod },           // MOVHPD
+    /* 0x17 */ { LENGTH_CopyBytes2Mod },           // MOVHPD
+    /* 0x18 */ { LENGTH_CopyBytes2Mod },           // PREFETCHINTA...
+    /* 0x19 */ { LENGTH_Invalid },                 // _19
+    /* 0x1A */ { LENGTH_Invalid },                 // _1A
+    /* 0x1B */ { LENGTH_Invalid },                 // _1B
+    /* 0x1C */ { LENGTH_Invalid },                 // _1C
+    /* 0x1D */ { LENGTH_Invalid },                 // _1D
+    /* 0x1E */ { LENGTH_Invalid },                 // _1E
+    /* 0x1F */ { LENGTH_CopyBytes2Mod },           // NOP/r
+    /* 0x20 */ { LENGTH_CopyBytes2Mod },           // MOV/r
+    /* 0x21 */ { LENGTH_CopyBytes2Mod },           // MOV/r
+    /* 0x22 */ { LENGTH_CopyBytes2Mod },           // MOV/r
+    /* 0x23 */ { LENGTH_CopyBytes2Mod },           // MOV/r
+    /* 0x24 */ { LENGTH_Invalid },                 // _24
+    /* 0x25 */ { LENGTH_Invalid },                 // _25
+    /* 0x26 */ { LENGTH_Invalid },                 // _26
+    /* 0x27 */ { LENGTH_Invalid },                 // _27
+    /* 0x28 */ { LENGTH_CopyBytes2Mod },           // MOVAPS MOVAPD
+    /* 0x29 */ { LENGTH_CopyBytes2Mod },           // MOVAPS MOVAPD
+    /* 0x2A */ { LENGTH_CopyBytes2Mod },           // CVPI2PS &
+    /* 0x2B */ { LENGTH_CopyBytes2Mod },           // MOVNTPS MOVNTPD
+    /* 0x2C */ { LENGTH_CopyBytes2Mod },           // CVTTPS2PI &
+    /* 0x2D */ { LENGTH_CopyBytes2Mod },           // CVTPS2PI &
+    /* 0x2E */ { LENGTH_CopyBytes2Mod },           // UCOMISS UCOMISD
+    /* 0x2F */ { LENGTH_CopyBytes2Mod },           // COMISS COMISD
+    /* 0x30 */ { LENGTH_CopyBytes2 },              // WRMSR
+    /* 0x31 */ { LENGTH_CopyBytes2 },              // RDTSC
+    /* 0x32 */ { LENGTH_CopyBytes2 },              // RDMSR
+    /* 0x33 */ { LENGTH_CopyBytes2 },              // RDPMC
+    /* 0x34 */ { LENGTH_CopyBytes2 },              // SYSENTER
+    /* 0x35 */ { LENGTH_CopyBytes2 },              // SYSEXIT
+    /* 0x36 */ { LENGTH_Invalid },                 // _36
+    /* 0x37 */ { LENGTH_Invalid },                 // _37
+    /* 0x38 */ { LENGTH_Invalid },                 // _38
+    /* 0x39 */ { LENGTH_Invalid },                 // _39
+    /* 0x3A */ { LENGTH_Invalid },                 // _3A
+    /* 0x3B */ { LENGTH_Invalid },                 // _3B
+    /* 0x3C */ { LENGTH_Invalid },                 // _3C
+    /* 0x3D */ { LENGTH_Invalid },                 // _3D
+    /* 0x3E */ { LENGTH_Invalid },                 // _3E
+    /* 0x3F */ { LENGTH_Invalid },                 // _3F
+    /* 0x40 */ { LENGTH_CopyBytes2Mod },           // CMOVO (0F 40)
+    /* 0x41 */ { LENGTH_CopyBytes2Mod },           // CMOVNO (0F 41)
+    /* 0x42 */ { LENGTH_CopyBytes2Mod },           // CMOVB & CMOVNE (0F 42)
+    /* 0x43 */ { LENGTH_CopyBytes2Mod },           // CMOVAE & CMOVNB (0F 43)
+    /* 0x44 */ { LENGTH_CopyBytes2Mod },           // CMOVE & CMOVZ (0F 44)
+    /* 0x45 */ { LENGTH_CopyBytes2Mod },           // CMOVNE & CMOVNZ (0F 45)
+    /* 0x46 */ { LENGTH_CopyBytes2Mod },           // CMOVBE & CMOVNA (0F 46)
+    /* 0x47 */ { LENGTH_CopyBytes2Mod },           // CMOVA & CMOVNBE (0F 47)
+    /* 0x48 */ { LENGTH_CopyBytes2Mod },           // CMOVS (0F 48)
+    /* 0x49 */ { LENGTH_CopyBytes2Mod },           // CMOVNS (0F 49)
+    /* 0x4A */ { LENGTH_CopyBytes2Mod },           // CMOVP & CMOVPE (0F 4A)
+    /* 0x4B */ { LENGTH_CopyBytes2Mod },           // CMOVNP & CMOVPO (0F 4B)
+    /* 0x4C */ { LENGTH_CopyBytes2Mod },           // CMOVL & CMOVNGE (0F 4C)
+    /* 0x4D */ { LENGTH_CopyBytes2Mod },           // CMOVGE & CMOVNL (0F 4D)
+    /* 0x4E */ { LENGTH_CopyBytes2Mod },           // CMOVLE & CMOVNG (0F 4E)
+    /* 0x4F */ { LENGTH_CopyBytes2Mod },           // CMOVG & CMOVNLE (0F 4F)
+    /* 0x50 */ { LENGTH_CopyBytes2Mod },           // MOVMSKPD MOVMSKPD
+    /* 0x51 */ { LENGTH_CopyBytes2Mod },           // SQRTPS &
+    /* 0x52 */ { LENGTH_CopyBytes2Mod },           // RSQRTTS RSQRTPS
+    /* 0x53 */ { LENGTH_CopyBytes2Mod },           // RCPPS RCPSS
+    /* 0x54 */ { LENGTH_CopyBytes2Mod },           // ANDPS ANDPD
+    /* 0x55 */ { LENGTH_CopyBytes2Mod },           // ANDNPS ANDNPD
+    /* 0x56 */ { LENGTH_CopyBytes2Mod },           // ORPS ORPD
+    /* 0x57 */ { LENGTH_CopyBytes2Mod },           // XORPS XORPD
+    /* 0x58 */ { LENGTH_CopyBytes2Mod },           // ADDPS &
+    /* 0x59 */ { LENGTH_CopyBytes2Mod },           // MULPS &
+    /* 0x5A */ { LENGTH_CopyBytes2Mod },           // CVTPS2PD &
+    /* 0x5B */ { LENGTH_CopyBytes2Mod },           // CVTDQ2PS &
+    /* 0x5C */ { LENGTH_CopyBytes2Mod },           // SUBPS &
+    /* 0x5D */ { LENGTH_CopyBytes2Mod },           // MINPS &
+    /* 0x5E */ { LENGTH_CopyBytes2Mod },           // DIVPS &
+    /* 0x5F */ { LENGTH_CopyBytes2Mod },           // MASPS &
+    /* 0x60 */ { LENGTH_CopyBytes2Mod },           // PUNPCKLBW/r
+    /* 0x61 */ { LENGTH_CopyBytes2Mod },           // PUNPCKLWD/r
+    /* 0x62 */ { LENGTH_CopyBytes2Mod },           // PUNPCKLWD/r
+    /* 0x63 */ { LENGTH_CopyBytes2Mod },           // PACKSSWB/r
+    /* 0x64 */ { LENGTH_CopyBytes2Mod },           // PCMPGTB/r
+    /* 0x65 */ { LENGTH_CopyBytes2Mod },           // PCMPGTW/r
+    /* 0x66 */ { LENGTH_CopyBytes2Mod },           // PCMPGTD/r
+    /* 0x67 */ { LENGTH_CopyBytes2Mod },           // PACKUSWB/r
+    /* 0x68 */ { LENGTH_CopyBytes2Mod },           // PUNPCKHBW/r
+    /* 0x69 */ { LENGTH_CopyBytes2Mod },           // PUNPCKHWD/r
+    /* 0x6A */ { LENGTH_CopyBytes2Mod },           // PUNPCKHDQ/r
+    /* 0x6B */ { LENGTH_CopyBytes2Mod },           // PACKSSDW/r
+    /* 0x6C */ { LENGTH_CopyBytes2Mod },           // PUNPCKLQDQ
+    /* 0x6D */ { LENGTH_CopyBytes2Mod },           // PUNPCKHQDQ
+    /* 0x6E */ { LENGTH_CopyBytes2Mod },           // MOVD/r
+    /* 0x6F */ { LENGTH_CopyBytes2Mod },           // MOV/r
+    /* 0x70 */ { LENGTH_CopyBytes2Mod1 },          // PSHUFW/r ib
+    /* 0x71 */ { LENGTH_CopyBytes2Mod1 },          // PSLLW/6 ib,PSRAW/4 ib,PSRLW/2 ib
+    /* 0x72 */ { LENGTH_CopyBytes2Mod1 },          // PSLLD/6 ib,PSRAD/4 ib,PSRLD/2 ib
+    /* 0x73 */ { LENGTH_CopyBytes2Mod1 },          // PSLLQ/6 ib,PSRLQ/2 ib
+    /* 0x74 */ { LENGTH_CopyBytes2Mod },           // PCMPEQB/r
+    /* 0x75 */ { LENGTH_CopyBytes2Mod },           // PCMPEQW/r
+    /* 0x76 */ { LENGTH_CopyBytes2Mod },           // PCMPEQD/r
+    /* 0x77 */ { LENGTH_CopyBytes2 },              // EMMS
+    /* 0x78 */ { LENGTH_Invalid },                 // _78
+    /* 0x79 */ { LENGTH_Invalid },                 // _79
+    /* 0x7A */ { LENGTH_Invalid },                 // _7A
+    /* 0x7B */ { LENGTH_Invalid },                 // _7B
+    /* 0x7C */ { LENGTH_Invalid },                 // _7C
+    /* 0x7D */ { LENGTH_Invalid },                 // _7D
+    /* 0x7E */ { LENGTH_CopyBytes2Mod },           // MOVD/r
+    /* 0x7F */ { LENGTH_CopyBytes2Mod },           // MOV/r
+    /* 0x80 */ { LENGTH_CopyBytes3Or5Target },     // JO
+    /* 0x81 */ { LENGTH_CopyBytes3Or5Target },     // JNO
+    /* 0x82 */ { LENGTH_CopyBytes3Or5Target },     // JB,JC,JNAE
+    /* 0x83 */ { LENGTH_CopyBytes3Or5Target },     // JAE,JNB,JNC
+    /* 0x84 */ { LENGTH_CopyBytes3Or5Target },     // JE,JZ,JZ
+    /* 0x85 */ { LENGTH_CopyBytes3Or5Target },     // JNE,JNZ
+    /* 0x86 */ { LENGTH_CopyBytes3Or5Target },     // JBE,JNA
+    /* 0x87 */ { LENGTH_CopyBytes3Or5Target },     // JA,JNBE
+    /* 0x88 */ { LENGTH_CopyBytes3Or5Target },     // JS
+    /* 0x89 */ { LENGTH_CopyBytes3Or5Target },     // JNS
+    /* 0x8A */ { LENGTH_CopyBytes3Or5Target },     // JP,JPE
+    /* 0x8B */ { LENGTH_CopyBytes3Or5Target },     // JNP,JPO
+    /* 0x8C */ { LENGTH_CopyBytes3Or5Target },     // JL,NGE
+    /* 0x8D */ { LENGTH_CopyBytes3Or5Target },     // JGE,JNL
+    /* 0x8E */ { LENGTH_CopyBytes3Or5Target },     // JLE,JNG
+    /* 0x8F */ { LENGTH_CopyBytes3Or5Target },     // JG,JNLE
+    /* 0x90 */ { LENGTH_CopyBytes2Mod },           // CMOVO (0F 40)
+    /* 0x91 */ { LENGTH_CopyBytes2Mod },           // CMOVNO (0F 41)
+    /* 0x92 */ { LENGTH_CopyBytes2Mod },           // CMOVB & CMOVC & CMOVNAE (0F 42)
+    /* 0x93 */ { LENGTH_CopyBytes2Mod },           // CMOVAE & CMOVNB & CMOVNC (0F 43)
+    /* 0x94 */ { LENGTH_CopyBytes2Mod },           // CMOVE & CMOVZ (0F 44)
+    /* 0x95 */ { LENGTH_CopyBytes2Mod },           // CMOVNE & CMOVNZ (0F 45)
+    /* 0x96 */ { LENGTH_CopyBytes2Mod },           // CMOVBE & CMOVNA (0F 46)
+    /* 0x97 */ { LENGTH_CopyBytes2Mod },           // CMOVA & CMOVNBE (0F 47)
+    /* 0x98 */ { LENGTH_CopyBytes2Mod },           // CMOVS (0F 48)
+    /* 0x99 */ { LENGTH_CopyBytes2Mod },           // CMOVNS (0F 49)
+    /* 0x9A */ { LENGTH_CopyBytes2Mod },           // CMOVP & CMOVPE (0F 4A)
+    /* 0x9B */ { LENGTH_CopyBytes2Mod },           // CMOVNP & CMOVPO (0F 4B)
+    /* 0x9C */ { LENGTH_CopyBytes2Mod },           // CMOVL & CMOVNGE (0F 4C)
+    /* 0x9D */ { LENGTH_CopyBytes2Mod },           // CMOVGE & CMOVNL (0F 4D)
+    /* 0x9E */ { LENGTH_CopyBytes2Mod },           // CMOVLE & CMOVNG (0F 4E)
+    /* 0x9F */ { LENGTH_CopyBytes2Mod },           // CMOVG & CMOVNLE (0F 4F)
+    /* 0xA0 */ { LENGTH_CopyBytes2 },              // PUSH
+    /* 0xA1 */ { LENGTH_CopyBytes2 },              // POP
+    /* 0xA2 */ { LENGTH_CopyBytes2 },              // CPUID
+    /* 0xA3 */ { LENGTH_CopyBytes2Mod },           // BT  (0F A3)
+    /* 0xA4 */ { LENGTH_CopyBytes2Mod1 },          // SHLD
+    /* 0xA5 */ { LENGTH_CopyBytes2Mod },           // SHLD
+    /* 0xA6 */ { LENGTH_Invalid },                 // _A6
+    /* 0xA7 */ { LENGTH_Invalid },                 // _A7
+    /* 0xA8 */ { LENGTH_CopyBytes2 },              // PUSH
+    /* 0xA9 */ { LENGTH_CopyBytes2 },              // POP
+    /* 0xAA */ { LENGTH_CopyBytes2 },              // RSM
+    /* 0xAB */ { LENGTH_CopyBytes2Mod },           // BTS (0F AB)
+    /* 0xAC */ { LENGTH_CopyBytes2Mod1 },          // SHRD
+    /* 0xAD */ { LENGTH_CopyBytes2Mod },           // SHRD
+    /* 0xAE */ { LENGTH_CopyBytes2Mod },           // FXRSTOR/1,FXSAVE/0
+    /* 0xAF */ { LENGTH_CopyBytes2Mod },           // IMUL (0F AF)
+    /* 0xB0 */ { LENGTH_CopyBytes2Mod },           // CMPXCHG (0F B0)
+    /* 0xB1 */ { LENGTH_CopyBytes2Mod },           // CMPXCHG (0F B1)
+    /* 0xB2 */ { LENGTH_CopyBytes2Mod },           // LSS/r
+    /* 0xB3 */ { LENGTH_CopyBytes2Mod },           // BTR (0F B3)
+    /* 0xB4 */ { LENGTH_CopyBytes2Mod },           // LFS/r
+    /* 0xB5 */ { LENGTH_CopyBytes2Mod },           // LGS/r
+    /* 0xB6 */ { LENGTH_CopyBytes2Mod },           // MOVZX/r
+    /* 0xB7 */ { LENGTH_CopyBytes2Mod },           // MOVZX/r
+    /* 0xB8 */ { LENGTH_Invalid },                 // _B8
+    /* 0xB9 */ { LENGTH_Invalid },                 // _B9
+    /* 0xBA */ { LENGTH_CopyBytes2Mod1 },          // BT & BTC & BTR & BTS (0F BA)
+    /* 0xBB */ { LENGTH_CopyBytes2Mod },           // BTC (0F BB)
+    /* 0xBC */ { LENGTH_CopyBytes2Mod },           // BSF (0F BC)
+    /* 0xBD */ { LENGTH_CopyBytes2Mod },           // BSR (0F BD)
+    /* 0xBE */ { LENGTH_CopyBytes2Mod },           // MOVSX/r
+    /* 0xBF */ { LENGTH_CopyBytes2Mod },           // MOVSX/r
+    /* 0xC0 */ { LENGTH_CopyBytes2Mod },           // XADD/r
+    /* 0xC1 */ { LENGTH_CopyBytes2Mod },           // XADD/r
+    /* 0xC2 */ { LENGTH_CopyBytes2Mod },           // CMPPS &
+    /* 0xC3 */ { LENGTH_CopyBytes2Mod },           // MOVNTI
+    /* 0xC4 */ { LENGTH_CopyBytes2Mod1 },          // PINSRW /r ib
+    /* 0xC5 */ { LENGTH_CopyBytes2Mod1 },          // PEXTRW /r ib
+    /* 0xC6 */ { LENGTH_CopyBytes2Mod1 },          // SHUFPS & SHUFPD
+    /* 0xC7 */ { LENGTH_CopyBytes2Mod },           // CMPXCHG8B (0F C7)
+    /* 0xC8 */ { LENGTH_CopyBytes2 },              // BSWAP 0F C8 + rd
+    /* 0xC9 */ { LENGTH_CopyBytes2 },              // BSWAP 0F C8 + rd
+    /* 0xCA */ { LENGTH_CopyBytes2 },              // BSWAP 0F C8 + rd
+    /* 0xCB */ { LENGTH_CopyBytes2 },              //CVTPD2PI BSWAP 0F C8 + rd
+    /* 0xCC */ { LENGTH_CopyBytes2 },              // BSWAP 0F C8 + rd
+    /* 0xCD */ { LENGTH_CopyBytes2 },              // BSWAP 0F C8 + rd
+    /* 0xCE */ { LENGTH_CopyBytes2 },              // BSWAP 0F C8 + rd
+    /* 0xCF */ { LENGTH_CopyBytes2 },              // BSWAP 0F C8 + rd
+    /* 0xD0 */ { LENGTH_Invalid },                 // _D0
+    /* 0xD1 */ { LENGTH_CopyBytes2Mod },           // PSRLW/r
+    /* 0xD2 */ { LENGTH_CopyBytes2Mod },           // PSRLD/r
+    /* 0xD3 */ { LENGTH_CopyBytes2Mod },           // PSRLQ/r
+    /* 0xD4 */ { LENGTH_CopyBytes2Mod },           // PADDQ
+    /* 0xD5 */ { LENGTH_CopyBytes2Mod },           // PMULLW/r
+    /* 0xD6 */ { LENGTH_CopyBytes2Mod },           // MOVDQ2Q / MOVQ2DQ
+    /* 0xD7 */ { LENGTH_CopyBytes2Mod },           // PMOVMSKB/r
+    /* 0xD8 */ { LENGTH_CopyBytes2Mod },           // PSUBUSB/r
+    /* 0xD9 */ { LENGTH_CopyBytes2Mod },           // PSUBUSW/r
+    /* 0xDA */ { LENGTH_CopyBytes2Mod },           // PMINUB/r
+    /* 0xDB */ { LENGTH_CopyBytes2Mod },           // PAND/r
+    /* 0xDC */ { LENGTH_CopyBytes2Mod },           // PADDUSB/r
+    /* 0xDD */ { LENGTH_CopyBytes2Mod },           // PADDUSW/r
+    /* 0xDE */ { LENGTH_CopyBytes2Mod },           // PMAXUB/r
+    /* 0xDF */ { LENGTH_CopyBytes2Mod },           // PANDN/r
+    /* 0xE0 */ { LENGTH_CopyBytes2Mod },           // PAVGB
+    /* 0xE1 */ { LENGTH_CopyBytes2Mod },           // PSRAW/r
+    /* 0xE2 */ { LENGTH_CopyBytes2Mod },           // PSRAD/r
+    /* 0xE3 */ { LENGTH_CopyBytes2Mod },           // PAVGW
+    /* 0xE4 */ { LENGTH_CopyBytes2Mod },           // PMULHUW/r
+    /* 0xE5 */ { LENGTH_CopyBytes2Mod },           // PMULHW/r
+    /* 0xE6 */ { LENGTH_CopyBytes2Mod },           // CTDQ2PD &
+    /* 0xE7 */ { LENGTH_CopyBytes2Mod },           // MOVNTQ
+    /* 0xE8 */ { LENGTH_CopyBytes2Mod },           // PSUBB/r
+    /* 0xE9 */ { LENGTH_CopyBytes2Mod },           // PSUBW/r
+    /* 0xEA */ { LENGTH_CopyBytes2Mod },           // PMINSW/r
+    /* 0xEB */ { LENGTH_CopyBytes2Mod },           // POR/r
+    /* 0xEC */ { LENGTH_CopyBytes2Mod },           // PADDSB/r
+    /* 0xED */ { LENGTH_CopyBytes2Mod },           // PADDSW/r
+    /* 0xEE */ { LENGTH_CopyBytes2Mod },           // PMAXSW /r
+    /* 0xEF */ { LENGTH_CopyBytes2Mod },           // PXOR/r
+    /* 0xF0 */ { LENGTH_Invalid },                 // _F0
+    /* 0xF1 */ { LENGTH_CopyBytes2Mod },           // PSLLW/r
+    /* 0xF2 */ { LENGTH_CopyBytes2Mod },           // PSLLD/r
+    /* 0xF3 */ { LENGTH_CopyBytes2Mod },           // PSLLQ/r
+    /* 0xF4 */ { LENGTH_CopyBytes2Mod },           // PMULUDQ/r
+    /* 0xF5 */ { LENGTH_CopyBytes2Mod },           // PMADDWD/r
+    /* 0xF6 */ { LENGTH_CopyBytes2Mod },           // PSADBW/r
+    /* 0xF7 */ { LENGTH_CopyBytes2Mod },           // MASKMOVQ
+    /* 0xF8 */ { LENGTH_CopyBytes2Mod },           // PSUBB/r
+    /* 0xF9 */ { LENGTH_CopyBytes2Mod },           // PSUBW/r
+    /* 0xFA */ { LENGTH_CopyBytes2Mod },           // PSUBD/r
+    /* 0xFB */ { LENGTH_CopyBytes2Mod },           // FSUBQ/r
+    /* 0xFC */ { LENGTH_CopyBytes2Mod },           // PADDB/r
+    /* 0xFD */ { LENGTH_CopyBytes2Mod },           // PADDW/r
+    /* 0xFE */ { LENGTH_CopyBytes2Mod },           // PADDD/r
+    /* 0xFF */ { LENGTH_Invalid },                 // _FF
+};
+// Forms CDetourDis substitutes for the group opcodes once it has looked at the reg field of their mod/rm byte.
+static const LENGTHENTRY s_leGroup          = { LENGTH_CopyBytes2Mod };          // F6, F7, FF except below
+static const LENGTHENTRY s_leTestByte       = { LENGTH_CopyBytes2Mod1 };         // F6 /0: TEST r/m8, imm8
+static const LENGTHENTRY s_leTestOperand    = { LENGTH_CopyBytes2ModOperand };   // F7 /0: TEST r/m, imm
+static const LENGTHENTRY s_leIncDec         = { LENGTH_CopyBytes1 };             // 40-4F on x86
+
+bool DetourDecodeInstructionLength(const uint8_t *pbCode,
+                                   size_t cbCode,
+                                   bool fX64,
+                                   DETOUR_INSTRUCTION_LENGTH *pLength)
+{
+    bool fOperandOverride = false;
+    bool fAddressOverride = false;
+    bool fRaxOverride = false;
+    uint32_t fFlags = 0;
+
+    // Prefixes are consumed one at a time, like CDetourDis does. The opcode byte at obOp is then looked
+    // up in the current table.
+    const LENGTHENTRY *rleTable = s_rleLengthTable;
+    const LENGTHENTRY *pEntry = nullptr;
+    size_t obOp = 0;
+    while (pEntry == nullptr) {
+        if (obOp >= cbCode) {
+            return false;
+        }
+
+        const uint8_t bOp = pbCode[obOp];
+        const LENGTHENTRY *pCandidate = &rleTable[bOp];
+        switch (pCandidate->nKind) {
+          case KIND_BYTES:
+            pEntry = pCandidate;
+            break;
+
+          case KIND_PREFIX:
+            obOp++;
+            break;
+
+          case KIND_66:
+            fOperandOverride = true;
+            obOp++;
+            break;
+
+          case KIND_67:
+            fAddressOverride = true;
+            obOp++;
+            break;
+
+          case KIND_REX:
+            if (!fX64) {
+                pEntry = &s_leIncDec;
+                break;
+            }
+            if (bOp & 0x8) {
+                fRaxOverride = true;
+            }
+            obOp++;
+            break;
+
+          case KIND_0F:
+            rleTable = s_rleLengthTable0F;
+            obOp++;
+            break;
+
+          case KIND_F6:
+          case KIND_F7:
+          case KIND_FF:
+          {
+            if (obOp + 1 >= cbCode) {
+                return false;
+            }
+
+            const uint8_t bModRm = pbCode[obOp + 1];
+            const uint8_t bReg = bModRm & 0x38;
+            if (pCandidate->nKind == KIND_FF) {
+                if (bModRm == 0x15 || bModRm == 0x25) {         // CALL [], JMP []
+                    fFlags |= DETOUR_INSTRUCTION_INDIRECT;
+                }
+                else if (bReg >= 0x10 && bReg <= 0x28) {        // CALL /2, CALL /3, JMP /4, JMP /5
+                    fFlags |= DETOUR_INSTRUCTION_DYNAMIC;
+                }
+                pEntry = &s_leGroup;
+            }
+            else if (bReg == 0x00) {                            // TEST /0
+                pEntry = pCandidate->nKind == KIND_F6 ? &s_leTestByte : &s_leTestOperand;
+            }
+            else {
+                pEntry = &s_leGroup;
+            }
+            break;
+          }
+
+          default:
+            // CDetourDis skips the byte without copying it.
+            pLength->cbInstruction = (uint32_t)(obOp + 1);
+            pLength->fFlags = DETOUR_INSTRUCTION_INVALID;
+            return true;
+        }
+    }
+
+    size_t cbFixed;
+    if (fX64 && (pEntry->nFlags & ADDRESS)) {
+        cbFixed = fAddressOverride ? 5 : 9;
+    }
+    else if (fX64 && (pEntry->nFlags & RAX)) {
+        cbFixed = fRaxOverride ? 9 : 5;
+    }
+    else if (pEntry->nFlags & ADDRESS) {
+        cbFixed = fAddressOverride ? pEntry->nFixedSize16 : pEntry->nFixedSize;
+    }
+    else {
+        cbFixed = fOperandOverride ? pEntry->nFixedSize16 : pEntry->nFixedSize;
+    }
+
+    size_t cbOp = cbFixed;
+    if (pEntry->nModOffset > 0) {
+        const size_t obModRm = obOp + pEntry->nModOffset;
+        if (obModRm >= cbCode) {
+            return false;
+        }
+
+        const uint8_t bModRm = pbCode[obModRm];
+        const uint8_t bFlags = s_rbModRm[bModRm];
+        cbOp += bFlags & NOTSIB;
+
+        if (bFlags & SIB) {
+            if (obModRm + 1 >= cbCode) {
+                return false;
+            }
+
+            // No base register: a 32-bit displacement follows, or an 8-bit one with mod 01.
+            const uint8_t bSib = pbCode[obModRm + 1];
+            if ((bSib & 0x07) == 0x05) {
+                if ((bModRm & 0xc0) == 0x00 || (bModRm & 0xc0) == 0x80) {
+                    cbOp += 4;
+                }
+                else if ((bModRm & 0xc0) == 0x40) {
+                    cbOp += 1;
+                }
+            }
+        }
+        else if ((bFlags & RIP) && fX64) {
+            fFlags |= DETOUR_INSTRUCTION_RELATIVE;
+        }
+    }
+
+    const size_t cbInstruction = obOp + cbOp;
+    if (cbInstruction > cbCode) {
+        return false;
+    }
+
+    pLength->cbInstruction = (uint32_t)cbInstruction;
+    pLength->fFlags = fFlags | (pEntry->nFlags & (RELATIVE | DYNAMIC));
+    return true;
+}
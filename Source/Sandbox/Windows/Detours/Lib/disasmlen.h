@@ -0,0 +1,50 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  x86/x64 instruction-length decoder (disasmlen.h of detours.lib)
+//
+//  Copyright (c) Microsoft Corporation.  All rights reserved.
+//
+//  Sizes an instruction the same way CDetourDis (disasm.cpp) does, without
+//  copying or relocating it. It depends on nothing but the C runtime headers,
+//  allocates nothing, never reads past the bytes it is given and takes the
+//  instruction set as an argument, so the same code can be built and measured
+//  on any platform.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The instruction has an operand relative to its own address (a relative
+// branch, or a RIP-relative operand on x64), which must be adjusted when the
+// instruction is moved. Short branches may also have to be enlarged.
+#define DETOUR_INSTRUCTION_RELATIVE     0x1u
+
+// The instruction transfers control to an address that is only known at run
+// time (far RET, INT 3, JMP/CALL through a register or memory, ...). Like
+// CDetourDis, a near RET is not flagged.
+#define DETOUR_INSTRUCTION_DYNAMIC      0x2u
+
+// The instruction is a JMP/CALL through an absolute or RIP-relative memory
+// slot (FF 15, FF 25), whose target CDetourDis reads from that slot.
+#define DETOUR_INSTRUCTION_INDIRECT     0x4u
+
+// The opcode is not known. The length is the one CDetourDis assumes for it.
+#define DETOUR_INSTRUCTION_INVALID      0x8u
+
+struct DETOUR_INSTRUCTION_LENGTH
+{
+    uint32_t    cbInstruction;  // Length, including prefixes.
+    uint32_t    fFlags;         // DETOUR_INSTRUCTION_* flags.
+};
+
+// Decodes the length of the instruction at pbCode, of which cbCode bytes can
+// be read. fX64 selects the 64-bit instruction set (REX prefixes, RIP-relative
+// addressing, 64-bit immediates) instead of the 32-bit one.
+//
+// Returns false if the instruction does not fit in cbCode bytes.
+bool DetourDecodeInstructionLength(const uint8_t *pbCode,
+                                   size_t cbCode,
+                                   bool fX64,
+                                   DETOUR_INSTRUCTION_LENGTH *pLength);
@@ -16,6 +16,7 @@
 #define DETOURS_INTERNAL
 
 #include "detours.h"
+#include "peimage.h"
 
 namespace Detour
 {
@@ -911,8 +912,7 @@ BOOL CImage::ZeroFileData(HANDLE hFile, DWORD cbData)
     ZeroMemory(m_pbOutputBuffer, 4096);
 
     for (DWORD cbLeft = cbData; cbLeft > 0;) {
-        DWORD cbStep = cbLeft > sizeof(m_pbOutputBuffer)
-            ? sizeof(m_pbOutputBuffer) : cbLeft;
+        DWORD cbStep = cbLeft > 4096 ? 4096 : cbLeft;
         DWORD cbDone = 0;
 
         if (!WriteFile(hFile, m_pbOutputBuffer, cbStep, &cbDone)) {
@@ -973,6 +973,14 @@ BOOL CImage::Read(HANDLE hFile)
         return FALSE;
     }
 
+    // Check that the headers are all there before copying them out of the mapping.
+    DETOUR_PE_IMAGE peImage;
+    if (!DetourPeParseHeaders(m_pMap, m_nFileSize, &peImage) ||
+        peImage.nPeOffset + sizeof(m_NtHeader) > m_nFileSize) {
+        SetLastError(ERROR_BAD_EXE_FORMAT);
+        return FALSE;
+    }
+
     ////////////////////////////////////////////////////// Process DOS Header.
     //
     PIMAGE_DOS_HEADER pDosHeader = (PIMAGE_DOS_HEADER)m_pMap;
@@ -2078,6 +2086,75 @@ BOOL WINAPI DetourBinaryEditImports(PDETOUR_BINARY pdi,
                                pfCommitCallback);
 }
 
+//////////////////////////////////////////////////////////////////////////////
+//
+struct DETOUR_ENUMERATE_BINARY_IMPORTS_CONTEXT
+{
+    PVOID                           pContext;
+    PF_DETOUR_IMPORT_FILE_CALLBACK  pfImportFile;
+    PF_DETOUR_IMPORT_FUNC_CALLBACK  pfImportFunc;
+};
+
+static bool EnumerateBinaryImportFile(void *pContext, const char *pszFile)
+{
+    DETOUR_ENUMERATE_BINARY_IMPORTS_CONTEXT *pEnum = (DETOUR_ENUMERATE_BINARY_IMPORTS_CONTEXT *)pContext;
+    return pEnum->pfImportFile(pEnum->pContext, NULL, pszFile) != FALSE;
+}
+
+static bool EnumerateBinaryImportFunc(void *pContext, uint32_t nOrdinal, const char *pszFunc)
+{
+    DETOUR_ENUMERATE_BINARY_IMPORTS_CONTEXT *pEnum = (DETOUR_ENUMERATE_BINARY_IMPORTS_CONTEXT *)pContext;
+    return pEnum->pfImportFunc(pEnum->pContext, nOrdinal, pszFunc, NULL) != FALSE;
+}
+
+BOOL WINAPI DetourBinaryEnumerateImports(HANDLE hFile,
+                                         PVOID pContext,
+                                         PF_DETOUR_IMPORT_FILE_CALLBACK pfImportFile,
+                                         PF_DETOUR_IMPORT_FUNC_CALLBACK pfImportFunc)
+{
+    if (hFile == INVALID_HANDLE_VALUE) {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return FALSE;
+    }
+
+    LARGE_INTEGER cbFile;
+    if (!GetFileSizeEx(hFile, &cbFile)) {
+        return FALSE;
+    }
+    if (cbFile.QuadPart == 0) {
+        SetLastError(ERROR_BAD_EXE_FORMAT);
+        return FALSE;
+    }
+
+    HANDLE hMap = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (hMap == NULL) {
+        return FALSE;
+    }
+
+    PBYTE pbMap = (PBYTE)MapViewOfFileEx(hMap, FILE_MAP_READ, 0, 0, 0, NULL);
+    if (pbMap == NULL) {
+        DWORD dwError = GetLastError();
+        CloseHandle(hMap);
+        SetLastError(dwError);
+        return FALSE;
+    }
+
+    DETOUR_ENUMERATE_BINARY_IMPORTS_CONTEXT enumContext = { pContext, pfImportFile, pfImportFunc };
+
+    DETOUR_PE_IMAGE peImage;
+    BOOL fSuccess = DetourPeParseHeaders(pbMap, (size_t)cbFile.QuadPart, &peImage) &&
+        DetourPeEnumerateImports(&peImage,
+                                 &enumContext,
+                                 pfImportFile != NULL ? EnumerateBinaryImportFile : NULL,
+                                 pfImportFunc != NULL ? EnumerateBinaryImportFunc : NULL);
+
+    UnmapViewOfFile(pbMap);
+    CloseHandle(hMap);
+
+    SetLastError(fSuccess ? NO_ERROR : ERROR_EXE_MARKED_INVALID);
+    return fSuccess;
+}
+
 BOOL WINAPI DetourBinaryClose(PDETOUR_BINARY pdi)
 {
     Detour::CImage *pImage = Detour::CImage::IsValid(pdi);
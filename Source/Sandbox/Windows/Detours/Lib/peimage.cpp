@@ -0,0 +1,300 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  PE file parser (peimage.cpp of detours.lib)
+//
+//  Copyright (c) Microsoft Corporation.  All rights reserved.
+//
+
+#include "peimage.h"
+
+#include <string.h>
+
+// Layout of the structures of winnt.h the parser looks at, as offsets from their start.
+#define DOS_HEADER_SIZE                 0x40
+#define DOS_HEADER_LFANEW               0x3c
+#define NT_SIGNATURE_SIZE               4
+#define FILE_HEADER_SIZE                20
+#define FILE_HEADER_NUMBER_OF_SECTIONS  2
+#define FILE_HEADER_SIZE_OF_OPTIONAL    16
+#define OPTIONAL_MAGIC_PE32             0x10b
+#define OPTIONAL_MAGIC_PE32_PLUS        0x20b
+#define OPTIONAL_SIZE_OF_HEADERS        60
+#define OPTIONAL_NUMBER_OF_RVAS_PE32    92
+#define OPTIONAL_NUMBER_OF_RVAS_PE32_PLUS 108
+#define DATA_DIRECTORY_SIZE             8
+#define SECTION_HEADER_SIZE             40
+#define SECTION_VIRTUAL_ADDRESS         12
+#define SECTION_SIZE_OF_RAW_DATA        16
+#define SECTION_POINTER_TO_RAW_DATA     20
+#define IMPORT_DESCRIPTOR_SIZE          20
+#define IMPORT_ORIGINAL_FIRST_THUNK     0
+#define IMPORT_NAME                     12
+#define IMPORT_FIRST_THUNK              16
+#define IMPORT_BY_NAME_HINT_SIZE        2
+
+static inline uint16_t Read16(const uint8_t *pb)
+{
+    return (uint16_t)(pb[0] | (pb[1] << 8));
+}
+
+static inline uint32_t Read32(const uint8_t *pb)
+{
+    return (uint32_t)pb[0] | ((uint32_t)pb[1] << 8) | ((uint32_t)pb[2] << 16) | ((uint32_t)pb[3] << 24);
+}
+
+static inline uint64_t Read64(const uint8_t *pb)
+{
+    return (uint64_t)Read32(pb) | ((uint64_t)Read32(pb + 4) << 32);
+}
+
+// Whether the cb bytes at nOffset are within the file.
+static inline bool InFile(const DETOUR_PE_IMAGE *pImage, uint64_t nOffset, uint64_t cb)
+{
+    return nOffset <= pImage->cbFile && cb <= pImage->cbFile - nOffset;
+}
+
+bool DetourPeParseHeaders(const uint8_t *pbFile,
+                          size_t cbFile,
+                          DETOUR_PE_IMAGE *pImage)
+{
+    memset(pImage, 0, sizeof(*pImage));
+    pImage->pbFile = pbFile;
+    pImage->cbFile = cbFile;
+
+    if (!InFile(pImage, 0, DOS_HEADER_SIZE) || pbFile[0] != 'M' || pbFile[1] != 'Z') {
+        return false;
+    }
+
+    const uint32_t nPeOffset = Read32(pbFile + DOS_HEADER_LFANEW);
+    if (!InFile(pImage, nPeOffset, NT_SIGNATURE_SIZE + FILE_HEADER_SIZE) ||
+        memcmp(pbFile + nPeOffset, "PE\0\0", NT_SIGNATURE_SIZE) != 0) {
+        return false;
+    }
+
+    const uint8_t *pbFileHeader = pbFile + nPeOffset + NT_SIGNATURE_SIZE;
+    const uint16_t nSections = Read16(pbFileHeader + FILE_HEADER_NUMBER_OF_SECTIONS);
+    const uint16_t cbOptional = Read16(pbFileHeader + FILE_HEADER_SIZE_OF_OPTIONAL);
+
+    const uint64_t nOptionalOffset = (uint64_t)nPeOffset + NT_SIGNATURE_SIZE + FILE_HEADER_SIZE;
+    if (cbOptional < OPTIONAL_NUMBER_OF_RVAS_PE32 + 4 || !InFile(pImage, nOptionalOffset, cbOptional)) {
+        return false;
+    }
+
+    const uint8_t *pbOptional = pbFile + nOptionalOffset;
+    uint32_t obNumberOfRvas;
+    switch (Read16(pbOptional)) {
+      case OPTIONAL_MAGIC_PE32:
+        pImage->fPe32Plus = false;
+        obNumberOfRvas = OPTIONAL_NUMBER_OF_RVAS_PE32;
+        break;
+      case OPTIONAL_MAGIC_PE32_PLUS:
+        pImage->fPe32Plus = true;
+        obNumberOfRvas = OPTIONAL_NUMBER_OF_RVAS_PE32_PLUS;
+        break;
+      default:
+        return false;
+    }
+
+    if (cbOptional < obNumberOfRvas + 4) {
+        return false;
+    }
+
+    // Only the entries that fit in the optional header count, whatever NumberOfRvaAndSizes says.
+    const uint32_t obDataDirectories = obNumberOfRvas + 4;
+    uint32_t nDataDirectories = Read32(pbOptional + obNumberOfRvas);
+    if (nDataDirectories > (cbOptional - obDataDirectories) / DATA_DIRECTORY_SIZE) {
+        nDataDirectories = (cbOptional - obDataDirectories) / DATA_DIRECTORY_SIZE;
+    }
+
+    const uint64_t nSectionsOffset = nOptionalOffset + cbOptional;
+    if (!InFile(pImage, nSectionsOffset, (uint64_t)nSections * SECTION_HEADER_SIZE)) {
+        return false;
+    }
+
+    pImage->nPeOffset = nPeOffset;
+    pImage->nSectionsOffset = (uint32_t)nSectionsOffset;
+    pImage->nSections = nSections;
+    pImage->nDataDirectoriesOffset = (uint32_t)(nOptionalOffset + obDataDirectories);
+    pImage->nDataDirectories = nDataDirectories;
+    pImage->cbSizeOfHeaders = Read32(pbOptional + OPTIONAL_SIZE_OF_HEADERS);
+    return true;
+}
+
+bool DetourPeGetDataDirectory(const DETOUR_PE_IMAGE *pImage,
+                              uint32_t nEntry,
+                              uint32_t *pnRva,
+                              uint32_t *pcbSize)
+{
+    if (nEntry >= pImage->nDataDirectories) {
+        return false;
+    }
+
+    const uint8_t *pbEntry = pImage->pbFile + pImage->nDataDirectoriesOffset + nEntry * DATA_DIRECTORY_SIZE;
+    *pnRva = Read32(pbEntry);
+    *pcbSize = Read32(pbEntry + 4);
+    return true;
+}
+
+// Returns the file offset of nRva and the number of bytes of raw data that follow it in its section,
+// the same way CImage::RvaToVa maps addresses.
+static bool RvaToFileOffset(const DETOUR_PE_IMAGE *pImage,
+                            uint32_t nRva,
+                            uint64_t *pnOffset,
+                            uint64_t *pcbAvailable)
+{
+    if (nRva == 0) {
+        return false;
+    }
+
+    const uint8_t *pbSection = pImage->pbFile + pImage->nSectionsOffset;
+    for (uint32_t n = 0; n < pImage->nSections; n++, pbSection += SECTION_HEADER_SIZE) {
+        const uint64_t vaStart = Read32(pbSection + SECTION_VIRTUAL_ADDRESS);
+        const uint64_t vaEnd = vaStart + Read32(pbSection + SECTION_SIZE_OF_RAW_DATA);
+
+        if (nRva >= vaStart && nRva < vaEnd) {
+            const uint64_t nOffset = Read32(pbSection + SECTION_POINTER_TO_RAW_DATA) + (nRva - vaStart);
+            if (nOffset >= pImage->cbFile) {
+                return false;
+            }
+
+            const uint64_t cbInSection = vaEnd - nRva;
+            const uint64_t cbInFile = pImage->cbFile - nOffset;
+            *pnOffset = nOffset;
+            *pcbAvailable = cbInSection < cbInFile ? cbInSection : cbInFile;
+            return true;
+        }
+    }
+    return false;
+}
+
+const uint8_t * DetourPeRvaToData(const DETOUR_PE_IMAGE *pImage,
+                                  uint32_t nRva,
+                                  uint32_t cbData)
+{
+    uint64_t nOffset;
+    uint64_t cbAvailable;
+    if (!RvaToFileOffset(pImage, nRva, &nOffset, &cbAvailable) || cbData > cbAvailable) {
+        return NULL;
+    }
+    return pImage->pbFile + nOffset;
+}
+
+const char * DetourPeRvaToString(const DETOUR_PE_IMAGE *pImage, uint32_t nRva)
+{
+    uint64_t nOffset;
+    uint64_t cbAvailable;
+    if (!RvaToFileOffset(pImage, nRva, &nOffset, &cbAvailable)) {
+        return NULL;
+    }
+
+    const char *psz = (const char *)pImage->pbFile + nOffset;
+    if (memchr(psz, '\0', (size_t)cbAvailable) == NULL) {
+        return NULL;
+    }
+    return psz;
+}
+
+// Enumerates the functions of the thunk table at rvaThunks. Returns false if the table is corrupt.
+static bool EnumerateImportedFunctions(const DETOUR_PE_IMAGE *pImage,
+                                       uint32_t rvaThunks,
+                                       void *pContext,
+                                       PF_DETOUR_PE_IMPORT_FUNC_CALLBACK pfImportFunc)
+{
+    const uint32_t cbThunk = pImage->fPe32Plus ? 8 : 4;
+    const uint64_t fOrdinalFlag = pImage->fPe32Plus ? 0x8000000000000000ull : 0x80000000ull;
+
+    for (uint32_t rvaThunk = rvaThunks;; rvaThunk += cbThunk) {
+        const uint8_t *pbThunk = DetourPeRvaToData(pImage, rvaThunk, cbThunk);
+        if (pbThunk == NULL) {
+            return false;
+        }
+
+        const uint64_t nThunk = pImage->fPe32Plus ? Read64(pbThunk) : Read32(pbThunk);
+        if (nThunk == 0) {
+            break;
+        }
+
+        uint32_t nOrdinal = 0;
+        const char *pszFunc = NULL;
+        if (nThunk & fOrdinalFlag) {
+            nOrdinal = (uint32_t)(nThunk & 0xffff);
+        }
+        else {
+            // IMAGE_IMPORT_BY_NAME: a hint, then the name.
+            pszFunc = DetourPeRvaToString(pImage, (uint32_t)nThunk + IMPORT_BY_NAME_HINT_SIZE);
+            if (pszFunc == NULL) {
+                return false;
+            }
+        }
+
+        if (!pfImportFunc(pContext, nOrdinal, pszFunc)) {
+            break;
+        }
+
+        // Sections may alias each other: don't let a table that runs to the end of the address space wrap around.
+        if (rvaThunk > UINT32_MAX - cbThunk) {
+            return false;
+        }
+    }
+
+    pfImportFunc(pContext, 0, NULL);
+    return true;
+}
+
+bool DetourPeEnumerateImports(const DETOUR_PE_IMAGE *pImage,
+                              void *pContext,
+                              PF_DETOUR_PE_IMPORT_FILE_CALLBACK pfImportFile,
+                              PF_DETOUR_PE_IMPORT_FUNC_CALLBACK pfImportFunc)
+{
+    uint32_t rvaDescriptors = 0;
+    uint32_t cbDescriptors = 0;
+    if (!DetourPeGetDataDirectory(pImage, DETOUR_PE_DIRECTORY_IMPORT, &rvaDescriptors, &cbDescriptors)) {
+        rvaDescriptors = 0;
+    }
+
+    bool fValid = true;
+    if (rvaDescriptors != 0) {
+        // Like CImage::Read, the table ends with a descriptor that has neither thunk table.
+        for (uint32_t rvaDescriptor = rvaDescriptors;; rvaDescriptor += IMPORT_DESCRIPTOR_SIZE) {
+            const uint8_t *pbDescriptor = DetourPeRvaToData(pImage, rvaDescriptor, IMPORT_DESCRIPTOR_SIZE);
+            if (pbDescriptor == NULL) {
+                fValid = false;
+                break;
+            }
+
+            const uint32_t rvaOriginalFirstThunk = Read32(pbDescriptor + IMPORT_ORIGINAL_FIRST_THUNK);
+            const uint32_t rvaFirstThunk = Read32(pbDescriptor + IMPORT_FIRST_THUNK);
+            if (rvaOriginalFirstThunk == 0 && rvaFirstThunk == 0) {
+                break;
+            }
+
+            const char *pszFile = DetourPeRvaToString(pImage, Read32(pbDescriptor + IMPORT_NAME));
+            if (pszFile == NULL) {
+                fValid = false;
+                break;
+            }
+
+            if (pfImportFile != NULL && !pfImportFile(pContext, pszFile)) {
+                break;
+            }
+
+            if (pfImportFunc != NULL) {
+                const uint32_t rvaThunks = rvaOriginalFirstThunk != 0 ? rvaOriginalFirstThunk : rvaFirstThunk;
+                if (!EnumerateImportedFunctions(pImage, rvaThunks, pContext, pfImportFunc)) {
+                    fValid = false;
+                    break;
+                }
+            }
+
+            if (rvaDescriptor > UINT32_MAX - IMPORT_DESCRIPTOR_SIZE) {
+                fValid = false;
+                break;
+            }
+        }
+    }
+
+    if (pfImportFile != NULL) {
+        pfImportFile(pContext, NULL);
+    }
+    return fValid;
+}
@@ -0,0 +1,81 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  PE file parser (peimage.h of detours.lib)
+//
+//  Copyright (c) Microsoft Corporation.  All rights reserved.
+//
+//  Reads the headers, sections and import directory of a PE file straight
+//  from its bytes (typically a read-only mapping of the file). Nothing is
+//  copied or allocated: names are returned as pointers into the file. Every
+//  offset is checked against the size of the file, so a truncated or corrupt
+//  file is reported as such instead of faulting. Only the C runtime headers
+//  are used, and fields are read with explicit little-endian loads, so the
+//  parser builds on any platform.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Indexes in the data directory used by detours.
+#define DETOUR_PE_DIRECTORY_IMPORT      1
+
+struct DETOUR_PE_IMAGE
+{
+    const uint8_t * pbFile;
+    size_t          cbFile;
+
+    bool            fPe32Plus;                  // 64-bit image (8-byte thunks).
+    uint32_t        nPeOffset;                  // Offset of the "PE\0\0" signature.
+    uint32_t        nSectionsOffset;            // Offset of the section table.
+    uint16_t        nSections;
+    uint32_t        nDataDirectoriesOffset;
+    uint32_t        nDataDirectories;
+    uint32_t        cbSizeOfHeaders;
+};
+
+// Parses the DOS header, the NT headers and the section table of the cbFile
+// bytes at pbFile. Returns false if they are not those of a PE file, or do not
+// fit in the file. pbFile must stay valid for as long as pImage is used.
+bool DetourPeParseHeaders(const uint8_t *pbFile,
+                          size_t cbFile,
+                          DETOUR_PE_IMAGE *pImage);
+
+// Returns the address and size of data directory entry nEntry, or false if
+// the image does not have that many entries.
+bool DetourPeGetDataDirectory(const DETOUR_PE_IMAGE *pImage,
+                              uint32_t nEntry,
+                              uint32_t *pnRva,
+                              uint32_t *pcbSize);
+
+// Returns the cbData bytes of the file at nRva, or NULL if nRva is not backed
+// by the raw data of a section, or the data crosses the end of the section or
+// of the file.
+const uint8_t * DetourPeRvaToData(const DETOUR_PE_IMAGE *pImage,
+                                  uint32_t nRva,
+                                  uint32_t cbData);
+
+// Returns the NUL-terminated string at nRva, or NULL if it is not terminated
+// within the raw data of its section.
+const char * DetourPeRvaToString(const DETOUR_PE_IMAGE *pImage, uint32_t nRva);
+
+// Called for each imported file, then once with NULL after the last one.
+// Returning false stops the enumeration.
+typedef bool (*PF_DETOUR_PE_IMPORT_FILE_CALLBACK)(void *pContext,
+                                                  const char *pszFile);
+
+// Called for each function imported from the file last reported, with either
+// an ordinal or a name, then once with (0, NULL) after the last one.
+// Returning false skips the remaining functions of the file.
+typedef bool (*PF_DETOUR_PE_IMPORT_FUNC_CALLBACK)(void *pContext,
+                                                  uint32_t nOrdinal,
+                                                  const char *pszFunc);
+
+// Enumerates the import directory. Either callback may be NULL. Returns false
+// if the import directory is corrupt, possibly after some callbacks were made.
+// An image without imports enumerates nothing and succeeds.
+bool DetourPeEnumerateImports(const DETOUR_PE_IMAGE *pImage,
+                              void *pContext,
+                              PF_DETOUR_PE_IMPORT_FILE_CALLBACK pfImportFile,
+                              PF_DETOUR_PE_IMPORT_FUNC_CALLBACK pfImportFunc);
@@ -291,6 +291,14 @@ BOOL WINAPI DetourBinaryEditImports(PDETOUR_BINARY pBinary,
 BOOL WINAPI DetourBinaryWrite(PDETOUR_BINARY pBinary, HANDLE hFile);
 BOOL WINAPI DetourBinaryClose(PDETOUR_BINARY pBinary);
 
+// Enumerates the imports of the PE file open as hFile like DetourEnumerateImports does for a loaded module,
+// but straight from a read-only mapping of the file: nothing is copied, and the names passed to the callbacks
+// are only valid during the call. The callbacks get NULL for hModule and pvFunc.
+BOOL WINAPI DetourBinaryEnumerateImports(HANDLE hFile,
+                                         PVOID pContext,
+                                         PF_DETOUR_IMPORT_FILE_CALLBACK pfImportFile,
+                                         PF_DETOUR_IMPORT_FUNC_CALLBACK pfImportFunc);
+
 /////////////////////////////////////////////////// Create Process & Load Dll.
 //
 typedef BOOL (WINAPI *PDETOUR_CREATE_PROCESS_ROUTINEA)
@@ -54,17 +54,23 @@ static DWORD GetFullPath(__in PCWSTR path, std::wstring& fullPath)
 }
 
 CanonicalizedPath CanonicalizedPath::Canonicalize(wchar_t const* noncanonicalPath) {
-    PathType pathType;
-    std::wstring fullPath;
-    if (IsWin32NtPathName(noncanonicalPath)) {
+    // A single pass gives the prefix, the length and the component count (used to index the path),
+    // and tells whether GetFullPathName would have anything to do.
+    PathScan scan = ScanPath(noncanonicalPath);
+
+    if (scan.Prefix == PathPrefixKind::Win32Nt) {
         // Caller is using escape syntax to avoid Win32 interpretation of path.
         // That's actually really good for us.  The text after the prefix is
         // always an absolute path. Note that we must skip calling GetFullPathName here;
         // the kernel's effective algorithm for translating to an NT path is something like 
         //    IsWin32NtPathName(path) ? path : GetFullPathName(path),
         // and in fact GetFullPathName(path) and path aren't always equivalent if IsWin32NtPathName(path).
-        pathType = PathType::Win32Nt;
-        fullPath = std::wstring(noncanonicalPath);
+        return CanonicalizedPath(PathType::Win32Nt, noncanonicalPath, scan);
+    }
+    else if (scan.IsNormalized) {
+        // An absolute drive path with nothing to collapse, trim or map to a device: GetFullPathName would return it unchanged.
+        // Skipping it saves the call and a copy of the path.
+        return CanonicalizedPath(PathType::Win32, noncanonicalPath, scan);
     }
     else {
         // The path is not a Win32-NT pathname so it is subject to GetFullPathName canonicalization by the kernel.
@@ -74,16 +80,16 @@ CanonicalizedPath CanonicalizedPath::Canonicalize(wchar_t const* noncanonicalPat
         // Note that even non-drive-letter devices like \\.\nul, \\.\Harddisk0Partition1, etc. can safely become nul and Harddisk0Partition1 respectively; 
         // imagine the manifest tree root as implicitly \??\ (the session's DosDevices namespace).
 
+        std::wstring fullPath;
         DWORD error = GetFullPath(noncanonicalPath, fullPath);
         if (error != ERROR_SUCCESS) {
             return CanonicalizedPath();
         }
 
         // Note that GetFullPath("nul") == "\\.\nul" (similar for other classic devices), so we check for the local device type after that step.
-        pathType = IsLocalDevicePathName(fullPath.c_str()) ? PathType::LocalDevice : PathType::Win32;
+        PathType pathType = IsLocalDevicePathName(fullPath.c_str()) ? PathType::LocalDevice : PathType::Win32;
+        return CanonicalizedPath(pathType, fullPath.c_str(), fullPath.length());
     }
-
-    return CanonicalizedPath(pathType, std::move(fullPath));
 }
 
 CanonicalizedPath CanonicalizedPath::Extend(wchar_t const* additionalComponents, size_t* extensionStartIndex) const {
@@ -93,21 +99,15 @@ CanonicalizedPath CanonicalizedPath::Extend(wchar_t const* additionalComponents,
         additionalComponents++;
     }
 
-    std::wstring extended{};
-    extended.reserve(wcslen(additionalComponents) + Length() + 1);
-    extended.append(*m_value);
-
-    if (!extended.empty() && !IsDirectorySeparator(extended.back())) {
-        extended.push_back(NT_DIRECTORY_SEPARATOR);
-    }
+    // Only the additional components get scanned and hashed; the components of this path are carried over.
+    size_t length = Length();
+    wchar_t separator = length > 0 && !IsDirectorySeparator(GetPathString()[length - 1]) ? NT_DIRECTORY_SEPARATOR : L'\0';
 
     if (extensionStartIndex != nullptr) {
-        *extensionStartIndex = extended.size();
+        *extensionStartIndex = separator != L'\0' ? length + 1 : length;
     }
 
-    extended.append(additionalComponents);
-
-    return CanonicalizedPath(Type, std::move(extended));
+    return CanonicalizedPath(Type, IndexedPath::CreateExtended(*m_value, separator, additionalComponents, wcslen(additionalComponents)));
 }
 
 wchar_t const* CanonicalizedPath::GetLastComponent() const {
@@ -116,7 +116,7 @@ wchar_t const* CanonicalizedPath::GetLastComponent() const {
     }
     else {
         wchar_t const* str = GetPathString();
-        size_t lastPathSeparatorOrNullIndex = FindFinalPathSeparator(str);
+        size_t lastPathSeparatorOrNullIndex = m_value->FinalSeparatorIndex();
 
         if (str[lastPathSeparatorOrNullIndex] == L'\0') {
             return &str[lastPathSeparatorOrNullIndex];
@@ -132,9 +132,9 @@ CanonicalizedPath CanonicalizedPath::RemoveLastComponent() const {
 
     // If the last path separator is at zero-based index N, we want the preceding N characters.
     // If there are no path separators (or a path separator at index 0), we want a zero length string.
-    size_t lastSeparatorIndex = FindFinalPathSeparator(m_value->c_str());
-    size_t rootLength = GetRootLength(m_value->c_str());
+    size_t lastSeparatorIndex = m_value->FinalSeparatorIndex();
+    size_t rootLength = GetRootLength(GetPathString(), Length());
     size_t length = lastSeparatorIndex < rootLength ? rootLength : lastSeparatorIndex;
 
-    return CanonicalizedPath(Type, m_value->substr(0, length));
+    return CanonicalizedPath(Type, IndexedPath::CreatePrefix(*m_value, length));
 }
@@ -4,19 +4,29 @@
 #pragma once
 
 #include "FileAccessHelpers.h"
+#include "IndexedPath.h"
 
 // Immutable, typed, and canonical path string. The represented path is absolute, free of .. and . traversals, redundant path separators, etc.
 // A canonicalized path is independent of the current directory (which is mutable and process global).
 // Since the path is immutable, the underlying storage for the path string is shared among instances under copy construction and assignment.
+// Along with the string, the storage holds the HashPath value of the path and an index of its components (see IndexedPath), which are computed
+// once when the path is created; paths derived via Extend and RemoveLastComponent reuse those of the path they are derived from.
 struct CanonicalizedPath {
     CanonicalizedPath()
-        : Type(PathType::Null), m_value(nullptr)
+        : Type(PathType::Null), m_value()
     { }
 
     CanonicalizedPath(PathType type, wchar_t const* value, size_t valuePrefixLength)
-        : Type(type), m_value(std::make_shared<std::wstring>(value, valuePrefixLength))
+        : Type(type), m_value(IndexedPath::Create(value, valuePrefixLength, GetTypePrefixLength(type)))
     { }
 
+    // Creates a path from a string already known to be canonical, which has been scanned by ScanPath.
+    CanonicalizedPath(PathType type, wchar_t const* value, PathScan const& scan)
+        : Type(type), m_value(IndexedPath::Create(value, scan))
+    {
+        assert(scan.PrefixLength == GetTypePrefixLength(type));
+    }
+
     CanonicalizedPath(CanonicalizedPath&& other)
         : Type(other.Type), m_value(std::move(other.m_value))
     {
@@ -32,11 +42,11 @@ struct CanonicalizedPath {
     bool IsNull() const { return Type == PathType::Null; }
 
     size_t Length() const {
-        return m_value ? m_value->length() : 0;
+        return m_value ? m_value->Length() : 0;
     }
 
     wchar_t const* GetPathString() const {
-        return m_value ? m_value->c_str() : nullptr;
+        return m_value ? m_value->GetString() : nullptr;
     }
 
     // Returns the path string with the type prefix (\\?\, \??\, or \\.\) omitted if present.
@@ -55,6 +65,30 @@ struct CanonicalizedPath {
         }
     }
 
+    // HashPath of the entire path string (including the type prefix), computed when the path was created.
+    DWORD Hash() const {
+        return m_value ? m_value->Hash() : 0;
+    }
+
+    // Components of the path following the type prefix, in order. Offsets are relative to GetPathString().
+    PathComponent const* GetComponents() const {
+        return m_value ? m_value->GetComponents() : nullptr;
+    }
+
+    size_t ComponentCount() const {
+        return m_value ? m_value->ComponentCount() : 0;
+    }
+
+    // Index of the first component that starts at or after the given offset into GetPathString().
+    size_t FindFirstComponentStartingAt(size_t offset) const {
+        return m_value ? m_value->FindFirstComponentStartingAt(offset) : 0;
+    }
+
+    // Index of the first character that has to be escaped when the path is sent in a report, or Length() if there is none.
+    size_t FirstCharacterToEscapeForReport() const {
+        return m_value ? m_value->FirstNewLineIndex() : 0;
+    }
+
     // Returns the suffix of the path string corresponding to the last component in the path.
     wchar_t const* GetLastComponent() const;
 
@@ -64,11 +98,14 @@ struct CanonicalizedPath {
     PathType Type;
 
 private:
-    // Private constructor for Canonicalize, which creates a wstring for m_value.
-    // This constructor allocates a new shared_ptr managed string but moves the contents rather than copying them.
-    CanonicalizedPath(PathType type, std::wstring&& value)
-        : Type(type), m_value(std::make_shared<std::wstring>(std::move(value)))
+    CanonicalizedPath(PathType type, IndexedPath::Ref&& value)
+        : Type(type), m_value(std::move(value))
     { }
 
-    std::shared_ptr<std::wstring> m_value;
+    // Length of the type prefix (\\?\, \??\, or \\.\), which does not belong to any path component.
+    static size_t GetTypePrefixLength(PathType type) {
+        return type == PathType::Win32Nt || type == PathType::LocalDevice ? 4 : 0;
+    }
+
+    IndexedPath::Ref m_value;
 };
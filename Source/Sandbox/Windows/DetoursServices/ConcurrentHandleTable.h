@@ -0,0 +1,412 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <thread>
+
+// Number of slots in the first segment of a ConcurrentHandleTable. Must be a power of 2.
+#define CONCURRENT_HANDLE_TABLE_INITIAL_CAPACITY 1024U
+
+// Maximum number of segments of a ConcurrentHandleTable.
+#ifndef CONCURRENT_HANDLE_TABLE_MAX_SEGMENTS
+#define CONCURRENT_HANDLE_TABLE_MAX_SEGMENTS 16U
+#endif
+
+// warning C26409: Avoid calling new and delete explicitly, use std::make_unique<T> instead (r.11).
+// warning C26481: Don't use pointer arithmetic. Use span instead (bounds.1).
+// warning C26446: Prefer to use gsl::at() instead of unchecked subscript operator (bounds.4).
+// warning C26482: Only index into arrays using constant expressions (bounds.2).
+#pragma warning( disable : 26409 26481 26446 26482 )
+
+// A thread-safe map from handle values to values of type TValue, for which lookups never take a lock.
+//
+// The table is an open-addressing hash table with linear probing. Handle values are multiples of 4 (or aligned pointers,
+// for pseudo-handles such as those of FindFirstFile), so a multiplicative hash of the value shifted right by 2 spreads them well.
+// Removed entries leave a tombstone behind, which a later insertion can reuse (handle values get reused a lot). The table grows by
+// adding segments rather than by rehashing: inserts go to the newest segment, lookups probe the newest segment first. Once there are
+// CONCURRENT_HANDLE_TABLE_MAX_SEGMENTS segments, inserts also reuse the tombstones of older segments. Segments are only freed with
+// the table, so a lookup never touches freed memory.
+//
+// Each value lives in its own allocation, and each slot keeps a count of the readers currently looking at it. Lookups copy the value
+// out while being counted as a reader; replacing a value swaps the pointer in the slot, then waits for the slot's readers to leave before
+// destroying the old value, which only takes as long as copying a value. Removing a value first marks its key as being removed, which keeps
+// new readers and writers off the slot, then waits for the readers to leave before taking the value out. This gives lock-free lookups
+// without needing thread-local state (such as hazard pointers), which is not reliably available in every context Detours runs in.
+//
+// Keys 0, 1 and 2 are reserved. Concurrent Set and Remove calls for the same key are safe: the outcome is that of one of their orders,
+// and it is up to the caller to order them.
+template<typename TValue>
+class ConcurrentHandleTable
+{
+public:
+    ConcurrentHandleTable() noexcept : m_segmentCount(0), m_count(0)
+    {
+        for (std::atomic<Segment*>& segment : m_segments)
+        {
+            segment.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ~ConcurrentHandleTable()
+    {
+        for (std::atomic<Segment*>& segment : m_segments)
+        {
+            DestroySegment(segment.load(std::memory_order_relaxed));
+        }
+    }
+
+    ConcurrentHandleTable(const ConcurrentHandleTable&) = delete;
+    ConcurrentHandleTable& operator=(const ConcurrentHandleTable&) = delete;
+
+    // Associates 'value' with 'key', replacing any value already associated with it. Sets 'isNewKey' to whether the key was not in the
+    // table before. Returns false, dropping the value, only if every slot of every segment holds a key.
+    bool Set(uintptr_t key, TValue&& value, bool& isNewKey)
+    {
+        TValue* box = new TValue(std::move(value));
+
+        while (true)
+        {
+            Slot* slot = nullptr;
+            for (size_t i = m_segmentCount.load(); i > 0 && slot == nullptr; i--)
+            {
+                slot = Find(m_segments[i - 1].load(), key);
+            }
+
+            if (slot == nullptr)
+            {
+                slot = ClaimSlot(key);
+                if (slot == nullptr)
+                {
+                    delete box;
+                    isNewKey = false;
+                    return false;
+                }
+            }
+
+            // A slot whose value is still null was just claimed, and its value not published yet, by this or another thread.
+            if (TryPublish(slot, key, box, isNewKey))
+            {
+                if (isNewKey)
+                {
+                    m_count.fetch_add(1);
+                }
+
+                return true;
+            }
+
+            // The key was removed in the meantime; insert it anew.
+        }
+    }
+
+    // Copies the value associated with 'key' into 'value'. Returns false if there is none.
+    bool TryGet(uintptr_t key, TValue& value) const
+    {
+        for (size_t i = m_segmentCount.load(); i > 0; i--)
+        {
+            Slot* slot = Find(m_segments[i - 1].load(), key);
+            if (slot == nullptr)
+            {
+                continue;
+            }
+
+            // While counted as a reader, neither the key nor the value of the slot can go away (see Remove).
+            slot->Readers.fetch_add(1);
+            bool found = false;
+            if (slot->Key.load() == key)
+            {
+                const TValue* current = slot->Value.load();
+                if (current != nullptr)
+                {
+                    value = *current;
+                    found = true;
+                }
+            }
+
+            slot->Readers.fetch_sub(1);
+            if (found)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Removes the value associated with 'key', if any, leaving a tombstone in its slot. Returns whether there was one.
+    bool Remove(uintptr_t key)
+    {
+        bool removed = false;
+        for (size_t i = m_segmentCount.load(); i > 0; i--)
+        {
+            Slot* slot = Find(m_segments[i - 1].load(), key);
+            if (slot == nullptr)
+            {
+                continue;
+            }
+
+            // Marking the key first keeps new readers and writers (see TryPublish) off the value, and keeps insertions from reusing
+            // the slot before the value is gone. Once the readers that came before have left, nobody else can reach the value.
+            uintptr_t expected = key;
+            if (!slot->Key.compare_exchange_strong(expected, RemovingKey))
+            {
+                // Removed by another thread in the meantime.
+                continue;
+            }
+
+            WaitForReaders(slot);
+            TValue* old = slot->Value.exchange(nullptr);
+            slot->Key.store(TombstoneKey);
+
+            if (old != nullptr)
+            {
+                delete old;
+                removed = true;
+            }
+        }
+
+        if (removed)
+        {
+            m_count.fetch_sub(1);
+        }
+
+        return removed;
+    }
+
+    // Number of keys in the table. The value may be stale by the time it is returned if other threads are updating the table.
+    size_t Size() const noexcept
+    {
+        return m_count.load();
+    }
+
+private:
+    static const uintptr_t EmptyKey = 0;
+    static const uintptr_t TombstoneKey = 1;
+
+    // Key of a slot whose value is being removed. Neither matched by lookups nor reused by insertions.
+    static const uintptr_t RemovingKey = 2;
+
+    struct Slot
+    {
+        std::atomic<uintptr_t> Key;
+        std::atomic<TValue*> Value;
+        std::atomic<uint32_t> Readers;
+    };
+
+    struct Segment
+    {
+        unsigned CapacityLog2;
+
+        // Slots that are not empty, i.e., that hold a key or a tombstone.
+        std::atomic<size_t> UsedSlots;
+
+        size_t Capacity() const noexcept { return static_cast<size_t>(1) << CapacityLog2; }
+        Slot* GetSlots() noexcept { return reinterpret_cast<Slot*>(this + 1); }
+    };
+
+    static size_t GetInitialIndex(const Segment* segment, uintptr_t key) noexcept
+    {
+        // Fibonacci hashing: the high bits of the product are the well mixed ones.
+        const uint64_t hash = static_cast<uint64_t>(key >> 2) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(hash >> (64 - segment->CapacityLog2));
+    }
+
+    // Finds the slot holding 'key' in a segment, if any.
+    static Slot* Find(Segment* segment, uintptr_t key) noexcept
+    {
+        const size_t mask = segment->Capacity() - 1;
+        Slot* slots = segment->GetSlots();
+        size_t index = GetInitialIndex(segment, key);
+        for (size_t probes = 0; probes <= mask; probes++, index = (index + 1) & mask)
+        {
+            const uintptr_t current = slots[index].Key.load();
+            if (current == key)
+            {
+                return &slots[index];
+            }
+
+            if (current == EmptyKey)
+            {
+                break;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // Takes the first empty or tombstone slot for 'key' in a segment. If another thread inserts the same key first, returns its slot instead.
+    static Slot* Claim(Segment* segment, uintptr_t key) noexcept
+    {
+        const size_t mask = segment->Capacity() - 1;
+        Slot* slots = segment->GetSlots();
+        size_t index = GetInitialIndex(segment, key);
+        for (size_t probes = 0; probes <= mask; probes++, index = (index + 1) & mask)
+        {
+            uintptr_t current = slots[index].Key.load();
+            if ((current == EmptyKey || current == TombstoneKey) && slots[index].Key.compare_exchange_strong(current, key))
+            {
+                if (current == EmptyKey)
+                {
+                    segment->UsedSlots.fetch_add(1);
+                }
+
+                return &slots[index];
+            }
+
+            if (current == key)
+            {
+                return &slots[index];
+            }
+        }
+
+        return nullptr;
+    }
+
+    // Takes a slot for 'key', adding a segment if the newest one is too full. Once no segment can be added, takes the first empty or
+    // tombstone slot of any segment, newest first. Returns null if every slot of every segment holds a key.
+    Slot* ClaimSlot(uintptr_t key)
+    {
+        size_t segmentCount = m_segmentCount.load();
+        while (true)
+        {
+            Segment* newest = segmentCount > 0 ? m_segments[segmentCount - 1].load() : nullptr;
+            if ((newest == nullptr || (newest->UsedSlots.load() + 1) * 4 > newest->Capacity() * 3)
+                && segmentCount < CONCURRENT_HANDLE_TABLE_MAX_SEGMENTS)
+            {
+                segmentCount = AddSegment(segmentCount);
+                continue;
+            }
+
+            // Below the segment cap, only the newest segment takes keys.
+            const size_t oldestToClaim = segmentCount < CONCURRENT_HANDLE_TABLE_MAX_SEGMENTS ? segmentCount - 1 : 0;
+            for (size_t i = segmentCount; i > oldestToClaim; i--)
+            {
+                Slot* slot = Claim(m_segments[i - 1].load(), key);
+                if (slot != nullptr)
+                {
+                    return slot;
+                }
+            }
+
+            if (segmentCount < CONCURRENT_HANDLE_TABLE_MAX_SEGMENTS)
+            {
+                // Other threads filled the newest segment in the meantime.
+                segmentCount = AddSegment(segmentCount);
+                continue;
+            }
+
+            return nullptr;
+        }
+    }
+
+    // Stores 'box' as the value of a slot holding 'key' and destroys the value it replaces, if any, setting 'wasEmpty' to whether there
+    // was none. Returns false, leaving 'box' to the caller, if the slot does not hold 'key' anymore.
+    static bool TryPublish(Slot* slot, uintptr_t key, TValue* box, bool& wasEmpty)
+    {
+        // While counted as a reader, the key cannot be removed (see Remove), so the value cannot be stored behind a tombstone.
+        slot->Readers.fetch_add(1);
+        if (slot->Key.load() != key)
+        {
+            slot->Readers.fetch_sub(1);
+            return false;
+        }
+
+        TValue* old = slot->Value.exchange(box);
+        slot->Readers.fetch_sub(1);
+
+        wasEmpty = old == nullptr;
+        if (old != nullptr)
+        {
+            WaitForReaders(slot);
+            delete old;
+        }
+
+        return true;
+    }
+
+    static void WaitForReaders(Slot* slot) noexcept
+    {
+        // Readers only stay for as long as it takes to copy a value out.
+        while (slot->Readers.load() != 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    // Makes sure there are more than 'segmentCount' segments. Returns the new segment count.
+    size_t AddSegment(size_t segmentCount)
+    {
+        // Size the segment for the keys currently in the table rather than for all the keys the previous segments ever saw:
+        // with handles being closed and reopened all the time, most slots of a full segment are often tombstones.
+        const unsigned capacityLog2 = Log2(std::max<size_t>(CONCURRENT_HANDLE_TABLE_INITIAL_CAPACITY, m_count.load() * 4));
+        Segment* segment = CreateSegment(capacityLog2);
+
+        Segment* expected = nullptr;
+        if (!m_segments[segmentCount].compare_exchange_strong(expected, segment))
+        {
+            // Another thread added this segment first.
+            DestroySegment(segment);
+        }
+
+        // The segment is published before the count that makes it visible to lookups.
+        size_t expectedCount = segmentCount;
+        m_segmentCount.compare_exchange_strong(expectedCount, segmentCount + 1);
+        return m_segmentCount.load();
+    }
+
+    static unsigned Log2(size_t value) noexcept
+    {
+        unsigned log2 = 0;
+        while ((static_cast<size_t>(1) << log2) < value)
+        {
+            log2++;
+        }
+
+        return log2;
+    }
+
+    static Segment* CreateSegment(unsigned capacityLog2)
+    {
+        const size_t capacity = static_cast<size_t>(1) << capacityLog2;
+        Segment* segment = new (::operator new(sizeof(Segment) + capacity * sizeof(Slot))) Segment();
+        segment->CapacityLog2 = capacityLog2;
+        segment->UsedSlots.store(0, std::memory_order_relaxed);
+
+        Slot* slots = segment->GetSlots();
+        for (size_t i = 0; i < capacity; i++)
+        {
+            Slot* slot = new (&slots[i]) Slot();
+            slot->Key.store(EmptyKey, std::memory_order_relaxed);
+            slot->Value.store(nullptr, std::memory_order_relaxed);
+            slot->Readers.store(0, std::memory_order_relaxed);
+        }
+
+        return segment;
+    }
+
+    static void DestroySegment(Segment* segment) noexcept
+    {
+        if (segment == nullptr)
+        {
+            return;
+        }
+
+        Slot* slots = segment->GetSlots();
+        for (size_t i = 0; i < segment->Capacity(); i++)
+        {
+            delete slots[i].Value.load(std::memory_order_relaxed);
+            slots[i].~Slot();
+        }
+
+        segment->~Segment();
+        ::operator delete(static_cast<void*>(segment));
+    }
+
+    std::atomic<Segment*> m_segments[CONCURRENT_HANDLE_TABLE_MAX_SEGMENTS];
+    std::atomic<size_t> m_segmentCount;
+    std::atomic<size_t> m_count;
+};
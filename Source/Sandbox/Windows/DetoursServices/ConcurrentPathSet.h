@@ -0,0 +1,249 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+
+#include "DataTypes.h"
+
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+// Number of independently locked partitions of a ConcurrentPathSet. Must be a power of 2.
+#define CONCURRENT_PATH_SET_STRIPE_COUNT 64U
+
+// Initial number of slots in each partition. Must be a power of 2.
+#define CONCURRENT_PATH_SET_INITIAL_CAPACITY 64U
+
+// Number of path characters carved out of the heap at once for storing keys.
+#define CONCURRENT_PATH_SET_ARENA_CHUNK_CHARS 8192U
+
+// warning C26409: Avoid calling new and delete explicitly, use std::make_unique<T> instead (r.11).
+// warning C26481: Don't use pointer arithmetic. Use span instead (bounds.1).
+// warning C26446: Prefer to use gsl::at() instead of unchecked subscript operator (bounds.4).
+#pragma warning( disable : 26409 26481 26446 )
+
+// A thread-safe set of paths. Paths are only ever added, until the whole set is cleared.
+//
+// Callers provide the hash of the path, as computed by HashPath. Paths that have already been canonicalized typically
+// carry that hash with them, so a lookup neither rehashes nor copies the path. The set is split into
+// CONCURRENT_PATH_SET_STRIPE_COUNT partitions (selected by the high bits of the hash), each one guarded by its own reader/writer
+// lock, so concurrent threads registering different paths rarely contend. Each partition is an open-addressing table
+// storing the hash, the length and a pointer to the key; keys are copied once, on first insertion, into a
+// partition-owned arena and never move afterwards.
+//
+// Key comparison uses IsPathCharEqual, so the set is case-insensitive wherever NormalizePathChar folds case.
+class ConcurrentPathSet
+{
+public:
+    ConcurrentPathSet() = default;
+
+    ~ConcurrentPathSet()
+    {
+        for (Stripe& stripe : m_stripes)
+        {
+            for (PPathChar chunk : stripe.Chunks)
+            {
+                delete[] chunk;
+            }
+        }
+    }
+
+    ConcurrentPathSet(const ConcurrentPathSet&) = delete;
+    ConcurrentPathSet& operator=(const ConcurrentPathSet&) = delete;
+
+    // Adds a path (of the given length, not necessarily null-terminated) whose HashPath value is 'hash'.
+    // Returns whether the path was not in the set before.
+    bool TryInsert(PCPathChar path, size_t length, DWORD hash)
+    {
+        Stripe& stripe = GetStripe(hash);
+
+        {
+            // Most registrations are for paths that were already seen, so try the cheap shared lookup first.
+            const std::shared_lock<std::shared_mutex> lock(stripe.Lock);
+            if (Find(stripe, path, length, hash) != nullptr)
+            {
+                return false;
+            }
+        }
+
+        const std::unique_lock<std::shared_mutex> lock(stripe.Lock);
+
+        // Somebody could have inserted the same path while we were not holding the lock.
+        if (Find(stripe, path, length, hash) != nullptr)
+        {
+            return false;
+        }
+
+        if ((stripe.Count + 1) * 4 > stripe.Slots.size() * 3)
+        {
+            Grow(stripe);
+        }
+
+        Slot* slot = FindFreeSlot(stripe.Slots, hash);
+        slot->Hash = hash;
+        slot->Length = length;
+        slot->Key = Intern(stripe, path, length);
+        stripe.Count++;
+
+        return true;
+    }
+
+    // Returns whether a path (of the given length, not necessarily null-terminated) whose HashPath value is 'hash' is in the set.
+    bool Contains(PCPathChar path, size_t length, DWORD hash)
+    {
+        Stripe& stripe = GetStripe(hash);
+        const std::shared_lock<std::shared_mutex> lock(stripe.Lock);
+        return Find(stripe, path, length, hash) != nullptr;
+    }
+
+    // Removes every path from the set and releases the memory holding them.
+    void Clear()
+    {
+        for (Stripe& stripe : m_stripes)
+        {
+            const std::unique_lock<std::shared_mutex> lock(stripe.Lock);
+            for (PPathChar chunk : stripe.Chunks)
+            {
+                delete[] chunk;
+            }
+
+            stripe.Chunks.clear();
+            stripe.ChunkUsed = 0;
+            stripe.ChunkCapacity = 0;
+            stripe.Slots.clear();
+            stripe.Count = 0;
+        }
+    }
+
+    // Number of paths in the set. The value may be stale by the time it is returned if other threads are inserting.
+    size_t Size()
+    {
+        size_t size = 0;
+        for (Stripe& stripe : m_stripes)
+        {
+            const std::shared_lock<std::shared_mutex> lock(stripe.Lock);
+            size += stripe.Count;
+        }
+
+        return size;
+    }
+
+private:
+    struct Slot
+    {
+        // A null key denotes an empty slot.
+        PCPathChar Key = nullptr;
+        size_t Length = 0;
+        DWORD Hash = 0;
+    };
+
+    struct Stripe
+    {
+        std::shared_mutex Lock;
+        std::vector<Slot> Slots;
+        size_t Count = 0;
+
+        // Arena for the keys. The last chunk is the one currently being filled.
+        std::vector<PPathChar> Chunks;
+        size_t ChunkUsed = 0;
+        size_t ChunkCapacity = 0;
+    };
+
+    inline Stripe& GetStripe(DWORD hash) noexcept
+    {
+        // The low bits of the hash pick the slot within a partition, so use the high ones to pick the partition.
+        return m_stripes[(hash >> 16) & (CONCURRENT_PATH_SET_STRIPE_COUNT - 1)];
+    }
+
+    static bool AreKeysEqual(PCPathChar key, PCPathChar path, size_t length) noexcept
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            if (!IsPathCharEqual(key[i], path[i]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Must be called while holding the stripe lock (shared or exclusive).
+    static const Slot* Find(const Stripe& stripe, PCPathChar path, size_t length, DWORD hash) noexcept
+    {
+        if (stripe.Slots.empty())
+        {
+            return nullptr;
+        }
+
+        const size_t mask = stripe.Slots.size() - 1;
+        for (size_t index = hash & mask;; index = (index + 1) & mask)
+        {
+            const Slot& slot = stripe.Slots[index];
+            if (slot.Key == nullptr)
+            {
+                return nullptr;
+            }
+
+            if (slot.Hash == hash && slot.Length == length && AreKeysEqual(slot.Key, path, length))
+            {
+                return &slot;
+            }
+        }
+    }
+
+    // The table is never full (see the load factor check in TryInsert), so this always terminates.
+    static Slot* FindFreeSlot(std::vector<Slot>& slots, DWORD hash) noexcept
+    {
+        const size_t mask = slots.size() - 1;
+        size_t index = hash & mask;
+        while (slots[index].Key != nullptr)
+        {
+            index = (index + 1) & mask;
+        }
+
+        return &slots[index];
+    }
+
+    // Must be called while holding the stripe lock exclusively.
+    static void Grow(Stripe& stripe)
+    {
+        const size_t newCapacity = stripe.Slots.empty() ? CONCURRENT_PATH_SET_INITIAL_CAPACITY : stripe.Slots.size() * 2;
+        std::vector<Slot> newSlots(newCapacity);
+
+        // Keys live in the arena, so rehashing only moves the slots around.
+        for (const Slot& slot : stripe.Slots)
+        {
+            if (slot.Key != nullptr)
+            {
+                *FindFreeSlot(newSlots, slot.Hash) = slot;
+            }
+        }
+
+        stripe.Slots.swap(newSlots);
+    }
+
+    // Copies the given key into the stripe's arena. Must be called while holding the stripe lock exclusively.
+    static PCPathChar Intern(Stripe& stripe, PCPathChar path, size_t length)
+    {
+        const size_t required = length + 1;
+        if (stripe.ChunkCapacity - stripe.ChunkUsed < required)
+        {
+            const size_t capacity = required > CONCURRENT_PATH_SET_ARENA_CHUNK_CHARS ? required : CONCURRENT_PATH_SET_ARENA_CHUNK_CHARS;
+            stripe.Chunks.push_back(new PathChar[capacity]);
+            stripe.ChunkCapacity = capacity;
+            stripe.ChunkUsed = 0;
+        }
+
+        PPathChar key = stripe.Chunks.back() + stripe.ChunkUsed;
+        memcpy(key, path, length * sizeof(PathChar));
+        key[length] = 0;
+        stripe.ChunkUsed += required;
+
+        return key;
+    }
+
+    Stripe m_stripes[CONCURRENT_PATH_SET_STRIPE_COUNT];
+};
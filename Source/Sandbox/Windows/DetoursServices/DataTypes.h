@@ -5,6 +5,7 @@
 
 #include "stdafx.h"
 #include "StringOperations.h"
+#include "XxHash64.h"
 
 #if _WIN32 || MAC_OS_LIBRARY
 #include <string>
@@ -35,6 +36,8 @@
 //
 // IMPORTANT: Keep this in sync with the C# version declared in FileAccessManifest.cs
 //
+// 0x4000 and 0x8000 are reserved: they were UseLargeNtClosePreallocatedList and UseExtraThreadToDrainNtClose, and must not be reused.
+//
 #define FOR_ALL_FAM_FLAGS(m) \
     m(None,                               0x0)            \
     m(BreakOnAccessDenied,                0x1)            \
@@ -51,8 +54,6 @@
     m(NormalizeReadTimestamps,            0x800)          \
     m(IgnoreZwRenameFileInformation,      0x1000)         \
     m(IgnoreSetFileInformationByHandle,   0x2000)         \
-    m(UseLargeNtClosePreallocatedList,    0x4000)         \
-    m(UseExtraThreadToDrainNtClose,       0x8000)         \
     m(DisableDetours,                     0x10000)        \
     m(LogProcessData,                     0x20000)        \
     m(IgnoreGetFinalPathNameByHandle,     0x40000)        \
@@ -109,6 +110,7 @@ inline bool CheckReportAnyAccess(FileAccessManifestFlag flags, bool accessDenied
     m(AlwaysRemoteInjectDetoursFrom32BitProcess,        0x10) \
     m(UnconditionallyEnableLinuxPTraceSandbox,          0x20) \
     m(IgnoreDeviceIoControlGetReparsePoint,             0x40) \
+    m(ValidateManifestTree,                             0x80) \
 
 enum class FileAccessManifestExtraFlag {
     FOR_ALL_FAM_EXTRA_FLAGS(GEN_FAM_FLAG_ENUM_NAME_VALUE)
@@ -712,9 +714,143 @@ typedef struct ManifestRecord_t
         __in  PCPathChar target,
         __in  size_t targetLength,
         __out PCManifestRecord& child) const;
+
+    // Same as above, for a target whose HashPath value is already known.
+    __success(return)
+    bool FindChild(
+        __in  PCPathChar target,
+        __in  size_t targetLength,
+        __in  DWORD targetHash,
+        __out PCManifestRecord& child) const;
 } ManifestRecord;
 typedef const ManifestRecord * PCManifestRecord; // duplicated for use in scopes outside of the struct
 
+// ==========================================================================
+// == ManifestTreeChecksum
+// ==========================================================================
+// Precedes the manifest tree in the payload. Lets the sandbox detect a corrupted or truncated tree in a single linear pass over its
+// bytes (CheckTree), without walking the tree. A full structural check (CheckTreeStructure) walks every record; it is only run when
+// the engine asks for it through the ValidateManifestTree extra flag.
+typedef struct ManifestTreeChecksum_t
+{
+    GENERATE_TAG("ManifestTreeChecksum", 0xC4EC5001)
+
+    typedef uint32_t    CountType;
+    typedef uint32_t    ChecksumPartType;
+
+    CountType           NodeCount;
+    CountType           TreeSize;
+    ChecksumPartType    ChecksumLo, ChecksumHi; // we split this value up as we don't want to introduce 64-bit alignment here
+
+    inline uint64_t GetChecksum() const noexcept
+    {
+        return ((static_cast<uint64_t>(this->ChecksumHi)) << 32) | this->ChecksumLo;
+    }
+
+    /// There are no variable-length members, so the length of this struct can be determined using sizeof.
+    inline size_t GetSize() const noexcept
+    {
+        return sizeof(ManifestTreeChecksum_t);
+    }
+
+    // Checks that the tree starting at 'tree' lies within the 'availableBytes' that follow it and has the expected xxHash64 checksum.
+    // Returns nullptr if so, an error message otherwise.
+    const char* CheckTree(const void* tree, size_t availableBytes) const noexcept
+    {
+        if (this->TreeSize > availableBytes)
+        {
+            return "The manifest tree is truncated.";
+        }
+
+        if (XxHash64::Compute(tree, this->TreeSize) != GetChecksum())
+        {
+            return "The manifest tree does not match its checksum.";
+        }
+
+        return nullptr;
+    }
+
+    // Walks the tree rooted at 'root', checking that every record, bucket array and partial path lies within the tree, that children
+    // follow their parent, and that the tree has the expected number of records. Returns nullptr if so, an error message otherwise.
+    const char* CheckTreeStructure(PCManifestRecord root) const noexcept
+    {
+        CountType nodeCount = 0;
+        const char* error = CheckRecordStructure(reinterpret_cast<const BYTE *>(root), 0, nodeCount);
+        if (error == nullptr && nodeCount != this->NodeCount)
+        {
+            return "The manifest tree does not have the expected number of records.";
+        }
+
+        return error;
+    }
+
+private:
+    const char* CheckRecordStructure(const BYTE* treeStart, size_t recordOffset, CountType& nodeCount) const noexcept
+    {
+        const size_t headerSize = offsetof(ManifestRecord, Buckets);
+        if (recordOffset + headerSize > this->TreeSize)
+        {
+            return "A manifest record lies outside of the manifest tree.";
+        }
+
+        PCManifestRecord record = reinterpret_cast<PCManifestRecord>(treeStart + recordOffset);
+        const char* error = record->CheckValid();
+        if (error != nullptr)
+        {
+            return error;
+        }
+
+        if (++nodeCount > this->NodeCount)
+        {
+            return "The manifest tree has more records than expected.";
+        }
+
+        const size_t bucketsSize = static_cast<size_t>(record->BucketCount) * sizeof(ManifestRecord::ChildOffsetType);
+        if (bucketsSize > this->TreeSize - recordOffset - headerSize)
+        {
+            return "The buckets of a manifest record lie outside of the manifest tree.";
+        }
+
+        const size_t pathOffset = recordOffset + headerSize + bucketsSize;
+        const size_t maxPathLength = (this->TreeSize - pathOffset) / sizeof(PathChar);
+        const PathChar* path = reinterpret_cast<const PathChar *>(treeStart + pathOffset);
+        size_t pathLength = 0;
+        while (pathLength < maxPathLength && path[pathLength] != 0)
+        {
+            pathLength++;
+        }
+
+        if (pathLength == maxPathLength)
+        {
+            return "The partial path of a manifest record is not terminated within the manifest tree.";
+        }
+
+        for (ManifestRecord::BucketCountType i = 0; i < record->BucketCount; i++)
+        {
+            const ManifestRecord::ChildOffsetType childOffset = record->Buckets[i] & ~FileAccessBucketOffsetFlag::ChainMask;
+            if (record->Buckets[i] == 0)
+            {
+                continue;
+            }
+
+            // Children are serialized after their parent, which also rules out cycles.
+            if (childOffset == 0 || childOffset > this->TreeSize - recordOffset)
+            {
+                return "A manifest record has an invalid child offset.";
+            }
+
+            error = CheckRecordStructure(treeStart, recordOffset + childOffset, nodeCount);
+            if (error != nullptr)
+            {
+                return error;
+            }
+        }
+
+        return nullptr;
+    }
+} ManifestTreeChecksum;
+typedef const ManifestTreeChecksum * PCManifestTreeChecksum;
+
 // ==========================================================================
 // == SpecialProcessKind
 // ==========================================================================
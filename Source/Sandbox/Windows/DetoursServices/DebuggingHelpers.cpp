@@ -91,7 +91,7 @@ static void WriteMessage(PCWSTR text)
     fputs(ansiBuffer.c_str(), stderr);
 #endif
 
-    if ((g_fileAccessManifestFlags & FileAccessManifestFlag::DiagnosticMessagesEnabled) != FileAccessManifestFlag::None) {
+    if ((OperationManifest::GetFlags() & FileAccessManifestFlag::DiagnosticMessagesEnabled) != FileAccessManifestFlag::None) {
         HANDLE stderrHandle = GetStdHandle(STD_ERROR_HANDLE);
         DWORD bytesTransferred;
         DWORD lastError = GetLastError();
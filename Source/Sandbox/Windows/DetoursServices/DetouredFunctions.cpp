@@ -7,6 +7,7 @@
 #include "DetouredScope.h"
 #include "HandleOverlay.h"
 #include "MetadataOverrides.h"
+#include "ReparsePointResolver.h"
 #include "ResolvedPathCache.h"
 #include "SendReport.h"
 #include "StringOperations.h"
@@ -34,7 +35,6 @@ using std::wstring;
 #define SYMLINK_FLAG_RELATIVE 0x00000001
 
 #define _MAX_EXTENDED_PATH_LENGTH 32768 // see https://docs.microsoft.com/en-us/cpp/c-runtime-library/path-field-limits?view=vs-2019
-#define _MAX_EXTENDED_DIR_LENGTH (_MAX_EXTENDED_PATH_LENGTH - _MAX_DRIVE - _MAX_FNAME - _MAX_EXT - 4)
 
 #define NTQUERYDIRECTORYFILE_MIN_BUFFER_SIZE 4096
 
@@ -583,339 +583,163 @@ static void InvalidateReparsePointCacheIfNeeded(
 /////////////////////////////////////////// Symlink traversal utilities /////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-/// <summary>
-/// Split paths into path atoms and insert them into <code>atoms</code> in reverse order.
-/// </summary>
-static void SplitPathsReverse(_In_ const wstring& path, _Inout_ vector<wstring>& atoms)
+static inline bool PathContainedInPathTranslations(wstring path, bool canonicalize = false)
 {
-    size_t length = path.length();
-
-    if (length >= 2 && IsDirectorySeparator(path[length - 1]))
+    if (path.empty())
     {
-        // Skip ending directory separator without trimming the path.
-        --length;
+        return false;
     }
 
-    size_t rootLength = GetRootLength(path.c_str());
-
-    if (length <= rootLength)
+    if (canonicalize)
     {
-        return;
+        CanonicalizedPath normalized = CanonicalizedPath::Canonicalize(path.c_str());
+        path = std::wstring(normalized.GetPathStringWithoutTypePrefix());
     }
 
-    size_t i = length - 1;
-    wstring dir = path;
-
-    while (i >= rootLength)
+    if (path.back() == L'\\')
     {
-        while (i > rootLength && !IsDirectorySeparator(dir[i]))
-        {
-            --i;
-        }
-
-        if (i >= rootLength)
-        {
-            atoms.push_back(dir.substr(i));
-        }
+        path.pop_back();
+    }
 
-        dir = dir.substr(0, i);
+    std::transform(path.begin(), path.end(), path.begin(), std::towupper);
 
-        if (i == 0)
-        {
-            break;
-        }
+    return g_pManifestTranslatePathLookupTable->find(path) != g_pManifestTranslatePathLookupTable->end();
+}
 
-        --i;
-    }
+/// <summary>
+/// How <code>DetoursReparsePointFileSystem</code> canonicalizes the paths produced by following reparse points.
+/// </summary>
+enum class ReparsePointPathNormalization
+{
+    // CanonicalizedPath::Canonicalize, i.e., what the kernel would do with the path.
+    Canonicalize,
 
-    if (!dir.empty())
-    {
-        atoms.push_back(dir);
-    }
-}
+    // PathCchCanonicalizeEx, which only collapses '.' and '..' components.
+    PathCch,
+};
 
 /// <summary>
-/// Resolves a reparse point path with respect to its relative target.
+/// Answers the file system queries of <code>ReparsePointResolver</code> with Win32 calls, going through the resolved path cache.
 /// </summary>
 /// <remarks>
-/// Given a reparse point path A\B\C and its relative target D\E\F, this method
-/// simply "combines" A\B and D\E\F. The symlink C is essentially replaced by the relative target D\E\F.
+/// The handle provided at construction (if any) is used for the first reparse point query only, which is always about the path being resolved.
 /// </remarks>
-static bool TryResolveRelativeTarget(
-    _Inout_ wstring& result,
-    _In_ const wstring& relativeTarget,
-    _In_ vector<wstring> *processed,
-    _In_ vector<wstring> *needToBeProcessed)
+class DetoursReparsePointFileSystem : public ReparsePointFileSystem
 {
-    // Trim directory separator ending.
-    if (result[result.length() - 1] == L'\\')
-    {
-        result = result.substr(0, result.length() - 1);
-    }
-
-    // Skip last path atom.
-    size_t lastSeparator = result.find_last_of(L'\\');
-    if (lastSeparator == std::string::npos)
+public:
+    DetoursReparsePointFileSystem(
+        const PolicyResult& policyResult,
+        HANDLE hInput,
+        ReparsePointPathNormalization normalization,
+        bool skipTranslatedPaths)
+        : m_policyResult(policyResult),
+          m_handle(hInput),
+          m_normalization(normalization),
+          m_skipTranslatedPaths(skipTranslatedPaths)
     {
-        return false;
     }
 
-    if (processed != nullptr)
+    bool TryGetReparsePointTarget(PCPathChar path, size_t pathLength, PathString& target) override
     {
-        if (processed->empty())
-        {
-            return false;
-        }
+        HANDLE handle = m_handle;
+        m_handle = INVALID_HANDLE_VALUE;
 
-        processed->pop_back();
+        target.clear();
+        return ::TryGetReparsePointTarget(wstring(path, pathLength), handle, target, m_policyResult);
     }
 
-    // Handle '.' and '..' in the relative target.
-    size_t pos = 0;
-    size_t length = relativeTarget.length();
-    bool startWithDotSlash = length >= 2 && relativeTarget[pos] == L'.' && relativeTarget[pos + 1] == L'\\';
-    bool startWithDotDotSlash = length >= 3 && relativeTarget[pos] == L'.' && relativeTarget[pos + 1] == L'.' && relativeTarget[pos + 2] == L'\\';
-
-    while ((startWithDotDotSlash || startWithDotSlash) && lastSeparator != std::string::npos)
+    bool IsDirectorySymlink(PCPathChar path, size_t pathLength) override
     {
-        if (startWithDotSlash)
-        {
-            pos += 2;
-            length -= 2;
-        }
-        else
-        {
-            pos += 3;
-            length -= 3;
-            lastSeparator = result.find_last_of(L'\\', lastSeparator - 1);
-            if (processed != nullptr && !processed->empty())
-            {
-                if (processed->empty())
-                {
-                    return false;
-                }
-
-                processed->pop_back();
-            }
-        }
-
-        startWithDotSlash = length >= 2 && relativeTarget[pos] == L'.' && relativeTarget[pos + 1] == L'\\';
-        startWithDotDotSlash = length >= 3 && relativeTarget[pos] == L'.' && relativeTarget[pos + 1] == L'.' && relativeTarget[pos + 2] == L'\\';
-    }
-
-    if (lastSeparator == std::string::npos && startWithDotDotSlash)
-    {
-        return false;
+        UNREFERENCED_PARAMETER(pathLength);
+        return GetReparsePointType(path, INVALID_HANDLE_VALUE) == IO_REPARSE_TAG_SYMLINK;
     }
 
-    wstring slicedTarget;
-    slicedTarget.append(relativeTarget, pos, length);
-
-    result = result.substr(0, lastSeparator != std::string::npos ? lastSeparator : 0);
-
-    if (needToBeProcessed != nullptr)
-    {
-        SplitPathsReverse(slicedTarget, *needToBeProcessed);
-    }
-    else
+    bool TryNormalize(PCPathChar path, size_t pathLength, PathString& normalized) override
     {
-        result.push_back(L'\\');
-        result.append(slicedTarget);
-    }
-
-    return true;
-}
-
-/// <summary>
-/// Resolves the reparse points with relative target.
-/// </summary>
-/// <remarks>
-/// This method resolves reparse points that occur in the path prefix. This method should only be called when path itself
-/// is an actionable reparse point whose target is a relative path.
-/// This method traverses each prefix starting from the shortest one. Every time it encounters a directory symlink, it uses GetFinalPathNameByHandle to get the final path.
-/// However, if the prefix itself is a junction, then it leaves the current resolved path intact.
-/// The following example show the needs for this method as a prerequisite in getting
-/// the immediate target of a reparse point. Suppose that we have the following file system layout:
-///
-///    repo
-///    |
-///    +---intermediate
-///    |   \---current
-///    |         symlink1.link ==> ..\..\target\file1.txt
-///    |         symlink2.link ==> ..\target\file2.txt
-///    |
-///    +---source ==> intermediate\current (case 1: directory symlink, case 2: junction)
-///    |
-///    \---target
-///          file1.txt
-///          file2.txt
-///
-/// **CASE 1**: source ==> intermediate\current is a directory symlink.
-///
-/// If a tool accesses repo\source\symlink1.link (say 'type repo\source\symlink1.link'), then the tool should get the content of repo\target\file1.txt.
-/// If the tool accesses repo\source\symlink2.link, then the tool should get path-not-found error because the resolved path will be repo\intermediate\target\file2.txt.
-/// Now, if we try to resolve repo\source\symlink1.link by simply combining it with ..\..\target\file1.txt, then we end up with target\file1.txt (not repo\target\file1.txt),
-/// which is a non-existent path. To resolve repo\source\symlink1, we need to resolve the reparse points of its prefix, i.e., repo\source. For directory symlinks,
-/// we need to resolve the prefix to its target. I.e., repo\source is resolved to repo\intermediate\current, and so, given repo\source\symlink1.link, this method returns
-/// repo\intermediate\current\symlink1.link. Combining repo\intermediate\current\symlink1.link with ..\..\target\file1.txt will give the correct path, i.e., repo\target\file1.txt.
-///
-/// Similarly, given repo\source\symlink2.link, the method returns repo\intermediate\current\symlink2.link, and combining it with ..\target\file2.txt, will give us
-/// repo\intermediate\target\file2.txt, which is a non-existent path. This corresponds to the behavior of symlink accesses above.
-///
-/// **CASE 2**: source ==> intermediate\current is a junction.
-///
-/// If a tool accesses repo\source\symlink1.link (say 'type repo\source\symlink1.link'), then the tool should get path-not-found error because the resolve path will be target\file1.txt (not repo\target\file1).
-/// If the tool accesses repo\source\symlink2.link, then the tool should the content of repo\target\file2.txt.
-/// Unlike directory symlinks, when we try to resolve repo\source\symlink2.link, the prefix repo\source is left intact because it is a junction. Thus, combining repo\source\symlink2.link
-/// with ..\target\file2.txt results in a correct path, i.e., repo\target\file2.txt. The same reasoning can be given for repo\source\symlink1.link, and its resolution results in
-/// a non-existent path target\file1.txt.
-/// </remarks>
-static bool TryResolveRelativeTarget(_In_ const wstring& path, _In_ const wstring& relativeTarget, _Inout_ wstring& result, _In_ const PolicyResult& policyResult)
-{
-    vector<wstring> needToBeProcessed;
-    vector<wstring> processed;
-
-    // Split path into atoms that need to be processed one-by-one.
-    // For example, C:\P1\P2\P3\symlink --> symlink, P3, P1, P2, C:
-    SplitPathsReverse(path, needToBeProcessed);
-
-    while (!needToBeProcessed.empty())
-    {
-        wstring atom = needToBeProcessed.back();
-        needToBeProcessed.pop_back();
-        processed.push_back(atom);
-
-        if (!result.empty())
+        if (m_normalization == ReparsePointPathNormalization::Canonicalize)
         {
-            // Append directory separator as necessary.
-            if (result[result.length() - 1] != L'\\' && atom[0] != L'\\')
-            {
-                result.append(L"\\");
-            }
+            normalized.assign(CanonicalizedPath::Canonicalize(path).GetPathString());
+            return true;
         }
 
-        result.append(atom);
-
-        if (needToBeProcessed.empty())
+        if (m_buffer == nullptr)
         {
-            // The last atom is the symlink that we are going to replace.
-            break;
+            m_buffer = std::make_unique<wchar_t[]>(_MAX_EXTENDED_PATH_LENGTH);
         }
 
-        if (GetReparsePointType(result.c_str(), INVALID_HANDLE_VALUE) == IO_REPARSE_TAG_SYMLINK)
+        HRESULT res = PathCchCanonicalizeEx(m_buffer.get(), _MAX_EXTENDED_PATH_LENGTH, path, PATHCCH_ALLOW_LONG_PATHS);
+        if (res != S_OK)
         {
-            // Prefix path is a directory symlink.
-            // For example, C:\P1\P2 is a directory symlink.
-
-            // Get the next target of the directory symlink.
-            wstring target;
-            if (!TryGetReparsePointTarget(result, INVALID_HANDLE_VALUE, target, policyResult))
-            {
-                return false;
-            }
-
-            if (GetRootLength(target.c_str()) > 0)
-            {
-                // The target of the directory symlink is a rooted path:
-                // - clear result so far,
-                // - restart all the processed atoms,
-                // - initialize the atoms to be processed.
-                result.clear();
-                processed.clear();
-                SplitPathsReverse(target, needToBeProcessed);
-            }
-            else
-            {
-                // The target of the directory symlink is a relative path, then resolve it by "combining"
-                // the directory symlink (stored in the result) and the relative target.
-                if (!TryResolveRelativeTarget(result, target, &processed, &needToBeProcessed))
-                {
-                    return false;
-                }
-            }
+            Dbg(L"DetoursReparsePointFileSystem: PathCchCanonicalizeEx failed for %s", path);
+            return false;
         }
+
+        normalized.assign(m_buffer.get());
+        return true;
     }
 
-    // Finally, resolve the last atom, i.e., the symlink atom.
-    if (!TryResolveRelativeTarget(result, relativeTarget, nullptr, nullptr))
+    bool ShouldFollow(PCPathChar path, size_t pathLength, const PathString& target) override
     {
-        return false;
+        // Paths subject to directory translation are left for the translation to deal with.
+        return !m_skipTranslatedPaths
+            || !(PathContainedInPathTranslations(wstring(path, pathLength)) || PathContainedInPathTranslations(target, true));
     }
 
-    return true;
-}
+private:
+    const PolicyResult& m_policyResult;
+    HANDLE m_handle;
+    ReparsePointPathNormalization m_normalization;
+    bool m_skipTranslatedPaths;
+    std::unique_ptr<wchar_t[]> m_buffer;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////// Symlink traversal utilities /////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /// <summary>
-/// Get the next path of a reparse point path.
+/// Adds the paths of a chain to the lookup structures the resolved path cache keeps for a path.
 /// </summary>
-static bool TryGetNextPath(_In_ const wstring& path, _In_ HANDLE hInput, _Inout_ wstring& result, _In_ const PolicyResult& policyResult)
+static void CopyChainToCacheEntries(
+    _In_ const ReparsePointChain& chain,
+    _Inout_ std::shared_ptr<vector<wstring>>& order,
+    _Inout_ std::shared_ptr<map<wstring, ResolvedPathType, CaseInsensitiveStringLessThan>>& resolvedPaths)
 {
-    wstring target;
-
-    // Get the next target of a reparse point path.
-    if (!TryGetReparsePointTarget(path, hInput, target, policyResult))
-    {
-        return false;
-    }
-
-    if (GetRootLength(target.c_str()) > 0)
-    {
-        // The next target is a rooted path, then return it as is.
-        result.assign(target);
-    }
-    else
+    order->reserve(order->size() + chain.Count());
+    for (size_t i = 0; i < chain.Count(); i++)
     {
-        // The next target is a relative path, then resolve it first.
-        if (!TryResolveRelativeTarget(path, target, result, policyResult))
-        {
-            return false;
-        }
+        order->emplace_back(chain.GetPath(i), chain.GetPathLength(i));
+        resolvedPaths->emplace(
+            order->back(),
+            i + 1 == chain.Count() && chain.IsFullyResolved() ? ResolvedPathType::FullyResolved : ResolvedPathType::Intermediate);
     }
-
-    return true;
 }
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-/////////////////////////////////////////// Symlink traversal utilities /////////////////////////////////////////////////////////
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-
 /// <summary>
 /// Gets chains of the paths leading to and including the final path given the file name.
 /// </summary>
 static void DetourGetFinalPaths(_In_ const CanonicalizedPath& path, _In_ HANDLE hInput, _Inout_ std::shared_ptr<vector<wstring>>& order, _Inout_ std::shared_ptr<map<wstring, ResolvedPathType, CaseInsensitiveStringLessThan>>& finalPaths, _In_ const PolicyResult& policyResult)
 {
-    HANDLE handle = hInput;
-    wstring currentPath = path.GetPathString();
+    DetoursReparsePointFileSystem fileSystem(policyResult, hInput, ReparsePointPathNormalization::Canonicalize, false);
+    ReparsePointResolver resolver(fileSystem);
+    ReparsePointChain chain;
 
-    while (true)
+    if (!resolver.ResolveChain(path.GetPathString(), path.Length(), chain))
     {
-        order->push_back(currentPath);
-
-        wstring nextPath;
-        auto nextPathResult = TryGetNextPath(currentPath, handle, nextPath, policyResult);
-        handle = INVALID_HANDLE_VALUE;
-
-        if (nextPathResult)
+        // If a cycle was detected in the chain of symlinks, or the chain is too long to follow, we will log it,
+        // and return back the symlinks up to the last resolved path, not including any duplicates.
+        if (chain.HitHopLimit())
         {
-            // If there's a next path, then the current path is an intermediate path.
-            finalPaths->emplace(currentPath, ResolvedPathType::Intermediate);
-            currentPath = CanonicalizedPath::Canonicalize(nextPath.c_str()).GetPathString();
+            WriteWarningOrErrorF(L"More than %u reparse points found when attempting to resolve symlink path '%s'.", MAX_REPARSE_POINT_HOPS, path.GetPathString());
         }
         else
         {
-            // If the next path was not found, then the current path is considered fully resolved (although full symlink resolution is not enabled here).
-            finalPaths->emplace(currentPath, ResolvedPathType::FullyResolved);
-            break;
-        }
-
-        if (std::find(order->begin(), order->end(), currentPath) != order->end())
-        {
-            // If a cycle was detected in the chain of symlinks, we will log it, and return back the symlinks up to the last resolved path, not including any duplicates.
             WriteWarningOrErrorF(L"Cycle found when attempting to resolve symlink path '%s'.", path.GetPathString());
-            break;
         }
     }
+
+    // If the last path is not a reparse point, it is considered fully resolved (although full symlink resolution is not enabled here).
+    CopyChainToCacheEntries(chain, order, finalPaths);
 }
 
 /// <summary>
@@ -1189,35 +1013,13 @@ static bool EnforceReparsePointAccess(
     return ret;
 }
 
-static inline bool PathContainedInPathTranslations(wstring path, bool canonicalize = false)
-{
-    if (path.empty())
-    {
-        return false;
-    }
-
-    if (canonicalize)
-    {
-        CanonicalizedPath normalized = CanonicalizedPath::Canonicalize(path.c_str());
-        path = std::wstring(normalized.GetPathStringWithoutTypePrefix());
-    }
-
-    if (path.back() == L'\\')
-    {
-        path.pop_back();
-    }
-
-    std::transform(path.begin(), path.end(), path.begin(), std::towupper);
-
-    return g_pManifestTranslatePathLookupTable->find(path) != g_pManifestTranslatePathLookupTable->end();
-}
-
 /// <summary>
 /// Resolves all reparse points potentially contained in a path and enforces allowed accesses for all found matches and optionally the final resolved path.
 /// </summary>
 /// <remarks>
-/// This function first canonicalizes the input path, then splits it by its path components to then analyze each component to check if it is a reparse
+/// The resolution itself is done by <code>ReparsePointResolver::ResolveAll</code>: it analyzes each component of the input path to check if it is a reparse
 /// point. If that is the case, the target of the reparse point is used to gradually resolve the input and transform it into its final form.
+/// Access is then enforced on every reparse point that was followed and (optionally) on the final path, in the order they were found.
 /// </remarks>
 static bool ResolveAllReparsePointsAndEnforceAccess(
     const CanonicalizedPath& path,
@@ -1233,200 +1035,66 @@ static bool ResolveAllReparsePointsAndEnforceAccess(
     const bool enforceAccessForResolvedPath = true,
     const bool preserveLastReparsePointInPath = false)
 {
-    bool success = true;
-    auto normalized = std::make_unique<wchar_t[]>(_MAX_EXTENDED_PATH_LENGTH);
-    const wchar_t* input = (wchar_t*)path.GetPathStringWithoutTypePrefix();
-
-    std::shared_ptr<vector<wstring>> order = std::make_shared<vector<wstring>>();
-    std::shared_ptr< map<wstring, ResolvedPathType, CaseInsensitiveStringLessThan>> resolvedPaths = std::make_shared<map<wstring, ResolvedPathType, CaseInsensitiveStringLessThan>>();
-
-    auto drive = std::make_unique<wchar_t[]>(_MAX_DRIVE);
-    auto directory = std::make_unique<wchar_t[]>(_MAX_EXTENDED_DIR_LENGTH);
-    auto file_name = std::make_unique<wchar_t[]>(_MAX_FNAME);
-    auto extension = std::make_unique<wchar_t[]>(_MAX_EXT);
+    DetoursReparsePointFileSystem fileSystem(policyResult, INVALID_HANDLE_VALUE, ReparsePointPathNormalization::PathCch, true);
+    ReparsePointResolver resolver(fileSystem);
+    ReparsePointChain chain;
+
+    const wchar_t* input = path.GetPathStringWithoutTypePrefix();
+    bool resolved = resolver.ResolveAll(
+        input,
+        path.Length() - (input - path.GetPathString()),
+        GetLevelToEnableFullReparsePointParsing(policyResult),
+        preserveLastReparsePointInPath,
+        chain);
 
-    // levelToEnforceReparsePointParsingFrom is only valid for the path associated with policyResult.
-    // Once we follow that symlink, the next path has to be checked at each level.
-    bool first = true;
-    size_t level = 0;
-    size_t levelToEnforceReparsePointParsingFrom = GetLevelToEnableFullReparsePointParsing(policyResult);
-    while (true)
+    if (!resolved)
     {
-        errno_t err = _wsplitpath_s(
-            GetPathWithoutPrefix(input),
-            drive.get(),     _MAX_DRIVE,
-            directory.get(), _MAX_EXTENDED_DIR_LENGTH,
-            file_name.get(), _MAX_FNAME,
-            extension.get(), _MAX_EXT);
-
-        if (err != 0)
-        {
-            Dbg(L"ResolveAllReparsePointsAndEnforceAccess: _wsplitpath_s failed: %d", err);
-            return false;
-        }
-
-        bool foundReparsePoint = false;
-
-        wstring target = L"";
-        wstring resolved = drive.get();
-
-        wchar_t* context = nullptr;
-        wchar_t* next = wcstok_s(directory.get(), L"\\/", &context);
-
-        // Fist lets resolve the part of path that consists of directories e.g. XXXX:\a\b\c\XXXX -> resolve 'a\b\c'
-        while (next)
-        {
-            resolved += L"\\";
-            resolved += next;
-            level++;
-
-            // Avoid opening handle by not calling TryGetReparsePointTarget when reparse point has been fouond (foundReparsePoint == true).
-            if ((!first || level >= levelToEnforceReparsePointParsingFrom) && !foundReparsePoint)
-            {
-                bool result = TryGetReparsePointTarget(resolved, INVALID_HANDLE_VALUE, target, policyResult);
-                bool isFilteredPath = PathContainedInPathTranslations(resolved) || PathContainedInPathTranslations(target, true);
-                if (result && !isFilteredPath)
-                {
-                    order->push_back(resolved);
-                    resolvedPaths->emplace(resolved, ResolvedPathType::Intermediate);
-
-                    success &= EnforceReparsePointAccess(
-                        resolved,
-                        dwDesiredAccess,
-                        dwShareMode,
-                        dwCreationDisposition,
-                        dwFlagsAndAttributes,
-                        pNtStatus,
-                        enforceAccess,
-                        isCreateDirectory);
-
-                    if (GetRootLength(target.c_str()) > 0)
-                    {
-                        resolved = target;
-                    }
-                    else
-                    {
-                        resolved = resolved.substr(0, resolved.length() - lstrlenW(next));
-                        resolved += target;
-                    }
-
-                    foundReparsePoint = true;
-                }
-            }
-
-            next = wcstok_s(nullptr, L"\\/", &context);
-            target = L"";
-        }
-
-        first = false;
-
-        // If the original path ends with a trailing slash, then file name and extension are both an empty string
-        // So make sure we don't append a trailing slash in that case
-        if (lstrlenW(file_name.get()) + lstrlenW(extension.get()) > 0)
-        {
-            resolved += L"\\";
-            resolved += file_name.get();
-            resolved += extension.get();
-        }
-
-        if (foundReparsePoint)
-        {
-            // Normalize the partially resolved path and repeat the directory resolving, because we could have
-            // more reparse points added after each resolution step (e.g. more directory symbolic links or junctions that point to reparse points again)
-            HRESULT res = PathCchCanonicalizeEx(normalized.get(), _MAX_EXTENDED_PATH_LENGTH, resolved.c_str(), PATHCCH_ALLOW_LONG_PATHS);
-            if (res == S_OK)
-            {
-                input = normalized.get();
-                continue;
-            }
-            else
-            {
-                Dbg(L"ResolveAllReparsePointsAndEnforceAccess: PathCchCanonicalizeEx failed for %s", resolved.c_str());
-                return false;
-            }
-        }
-
-        // The path leading to the last path particle has been resolved, now lets take care of the last part - if 'preserveLastReparsePointInPath' is true,
-        // we don't resolve the last part of the path because we don't want the potential target value.
-        bool result = !preserveLastReparsePointInPath && TryGetReparsePointTarget(resolved, INVALID_HANDLE_VALUE, target, policyResult);
-        bool isFilteredPath = !preserveLastReparsePointInPath && (PathContainedInPathTranslations(resolved) || PathContainedInPathTranslations(target, true));
-        if (result && !isFilteredPath)
-        {
-            // The last part is a reparse point, resolve it and repeat the resolving, re-running the outer while loop
-            // is ok as each resolving step is cached from previous resolution steps
-            order->push_back(resolved);
-            resolvedPaths->emplace(resolved, ResolvedPathType::Intermediate);
-
-            success &= EnforceReparsePointAccess(
-                resolved,
-                dwDesiredAccess,
-                dwShareMode,
-                dwCreationDisposition,
-                dwFlagsAndAttributes,
-                pNtStatus,
-                enforceAccess,
-                isCreateDirectory);
-
-            if (GetRootLength(target.c_str()) > 0)
-            {
-                resolved = target;
-            }
-            else
-            {
-                resolved = resolved.substr(0, resolved.length() - lstrlenW(file_name.get()) - lstrlenW(extension.get()));
-                resolved += target;
-            }
+        Dbg(L"ResolveAllReparsePointsAndEnforceAccess: Failed to resolve %s", input);
+    }
 
-            HRESULT res = PathCchCanonicalizeEx(normalized.get(), _MAX_EXTENDED_PATH_LENGTH, resolved.c_str(), PATHCCH_ALLOW_LONG_PATHS);
-            if (res == S_OK)
-            {
-                input = normalized.get();
-                continue;
-            }
-            else
-            {
-                Dbg(L"ResolveAllReparsePointsAndEnforceAccess: PathCchCanonicalizeEx failed for %s", resolved.c_str());
-                return false;
-            }
-        }
-        else
-        {
-            // Now we have a fully resolved path without any reparse points present, normalize it, add it to the cache and enforce access eventually
-            HRESULT res = PathCchCanonicalizeEx(normalized.get(), _MAX_EXTENDED_PATH_LENGTH, resolved.c_str(), PATHCCH_ALLOW_LONG_PATHS);
-            if (res == S_OK)
-            {
-                input = normalized.get();
+    std::shared_ptr<vector<wstring>> order = std::make_shared<vector<wstring>>();
+    std::shared_ptr<map<wstring, ResolvedPathType, CaseInsensitiveStringLessThan>> resolvedPaths = std::make_shared<map<wstring, ResolvedPathType, CaseInsensitiveStringLessThan>>();
+    CopyChainToCacheEntries(chain, order, resolvedPaths);
 
-                if (resolvedPath != nullptr)
-                {
-                    resolvedPath->assign(input);
-                }
+    // Every reparse point that got followed is accessed, and so is the final path (if resolution got that far).
+    bool success = true;
+    const size_t reparsePointCount = resolved ? order->size() - 1 : order->size();
+    for (size_t i = 0; i < reparsePointCount; i++)
+    {
+        success &= EnforceReparsePointAccess(
+            (*order)[i],
+            dwDesiredAccess,
+            dwShareMode,
+            dwCreationDisposition,
+            dwFlagsAndAttributes,
+            pNtStatus,
+            enforceAccess,
+            isCreateDirectory);
+    }
 
-                order->push_back(input);
-                resolvedPaths->emplace(input, ResolvedPathType::FullyResolved);
+    if (!resolved)
+    {
+        return false;
+    }
 
-                if (enforceAccessForResolvedPath)
-                {
-                    success &= EnforceReparsePointAccess(
-                        input,
-                        dwDesiredAccess,
-                        dwShareMode,
-                        dwCreationDisposition,
-                        dwFlagsAndAttributes,
-                        pNtStatus,
-                        enforceAccess,
-                        isCreateDirectory,
-                        true);
-                }
-            }
-            else
-            {
-                Dbg(L"ResolveAllReparsePointsAndEnforceAccess: PathCchCanonicalizeEx failed for %s", resolved.c_str());
-                return false;
-            }
-        }
+    const wstring& finalPath = order->back();
+    if (resolvedPath != nullptr)
+    {
+        resolvedPath->assign(finalPath);
+    }
 
-        break;
+    if (enforceAccessForResolvedPath)
+    {
+        success &= EnforceReparsePointAccess(
+            finalPath,
+            dwDesiredAccess,
+            dwShareMode,
+            dwCreationDisposition,
+            dwFlagsAndAttributes,
+            pNtStatus,
+            enforceAccess,
+            isCreateDirectory,
+            true);
     }
 
     PathCache_InsertResolvedPaths(
@@ -3324,7 +2992,7 @@ BOOL WINAPI Detoured_CloseHandle(_In_ HANDLE handle)
 
     // Make sure the handle is closed after the object is removed from the map.
     // This way the handle will never be assigned to a another object before removed from the table.
-    CloseHandleOverlay(handle, true);
+    CloseHandleOverlay(handle);
 
     return Real_CloseHandle(handle);
 }
@@ -4935,7 +4603,7 @@ BOOL WINAPI Detoured_FindClose(_In_ HANDLE handle)
 
     // Make sure the handle is closed after the object is removed from the map.
     // This way the handle will never be assigned to a another object before removed from the table.
-    CloseHandleOverlay(handle, true);
+    CloseHandleOverlay(handle);
 
     BOOL result = Real_FindClose(handle);
     error = GetLastError();
@@ -7032,9 +6700,8 @@ NTSTATUS NTAPI Detoured_NtClose(_In_ HANDLE handle)
     // would AV. As a workaround, we just don't check it here (there's no harm in
     // dropping a handle overlay when trying to close the handle, anyway).
     //
-    // Make sure the handle is closed after the object is marked for removal from the map.
-    // This way the handle will never be assigned to a another object before removed from the map
-    // (whenever the map is accessed, the closed handle list is drained).
+    // Make sure the overlay is removed before the handle is closed.
+    // This way the handle can never be assigned to another object while its old overlay is still in the map.
 
     if (!IsNullOrInvalidHandle(handle))
     {
@@ -7044,16 +6711,7 @@ NTSTATUS NTAPI Detoured_NtClose(_In_ HANDLE handle)
             // This is to make sure the behaviour for Windows builds is not altered.
             // Also if the NtCreateFile is no monitored, the map should not grow significantly. The other cases where it is updated -
             // for example CreateFileW, the map is updated by the CloseFile detoured API.
-            if (UseExtraThreadToDrainNtClose())
-            {
-                AddClosedHandle(handle);
-            }
-            else
-            {
-                // Just remove the handle from the table directly.
-                // Pass true for recursiveCall, since we don't have anything in the handle drain list and call to drain it is not needed.
-                CloseHandleOverlay(handle, true);
-            }
+            CloseHandleOverlay(handle);
         }
     }
 
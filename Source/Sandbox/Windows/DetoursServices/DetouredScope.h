@@ -7,6 +7,8 @@ Implements APIs involving ignoring contexts for detouring.
 
 #pragma once
 
+#include "ManifestGeneration.h"
+
 // ----------------------------------------------------------------------------
 // CLASSES
 // ----------------------------------------------------------------------------
@@ -17,6 +19,8 @@ Implements APIs involving ignoring contexts for detouring.
 // The goal of the scope is not detour any Windows APIs which are called as a result
 // of already detoured APIs. There is no need to spend additional resources
 // on applying BuildXL's access policy more than once.
+//
+// The top level scope also pins the manifest generation the operation runs under (see OperationManifest).
 class DetouredScope
 {
 private:
@@ -25,12 +29,18 @@ private:
 public:
     DetouredScope() noexcept
     {
-        ++gt_DetouredCount;
+        if (++gt_DetouredCount == 1)
+        {
+            OperationManifest::Enter();
+        }
     }
 
     ~DetouredScope()
     {
-        --gt_DetouredCount;
+        if (--gt_DetouredCount == 0)
+        {
+            OperationManifest::Exit();
+        }
     }
 
     // This function returns false except for the top level scope.
@@ -13,6 +13,9 @@
 #include "DeviceMap.h"
 #include "CanonicalizedPath.h"
 #include "PolicyResult.h"
+#include "ManifestGeneration.h"
+#include "FilesCheckedForAccess.h"
+#include "ResolvedPathCache.h"
 #include <list>
 #include <string>
 #include <stdio.h>
@@ -25,6 +28,8 @@ using std::basic_string;
 // FUNCTION DEFINITIONS
 // ----------------------------------------------------------------------------
 
+static void TranslateCanonicalizedFilePath(_In_ const CanonicalizedPath& canonicalizedPath, _Out_ std::wstring& outFileName);
+
 /// <summary>
 /// Gets the normalized (or subst'ed) path from a full path.
 /// </summary>
@@ -44,8 +49,34 @@ void TranslateFilePath(_In_ const std::wstring& inFileName, _Out_ std::wstring&
         return;
     }
 
-    CanonicalizedPath canonicalizedPath = CanonicalizedPath::Canonicalize(inFileName.c_str());
-    std::wstring tempStr(canonicalizedPath.GetPathString());
+    TranslateCanonicalizedFilePath(CanonicalizedPath::Canonicalize(inFileName.c_str()), outFileName);
+}
+
+/// <summary>
+/// Gets the normalized (or subst'ed) path from an already canonicalized path, which is not canonicalized again.
+/// </summary>
+void TranslateFilePath(_In_ const CanonicalizedPath& inPath, _Out_ std::wstring& outFileName)
+{
+    outFileName.assign(inPath.GetPathString(), inPath.Length());
+
+    if (g_pManifestTranslatePathTuples->empty() || inPath.Length() == 0)
+    {
+        // Nothing to translate.
+        return;
+    }
+
+    TranslateCanonicalizedFilePath(inPath, outFileName);
+}
+
+// Sets outFileName to the translation of canonicalizedPath, if any translation applies; leaves it untouched otherwise.
+static void TranslateCanonicalizedFilePath(_In_ const CanonicalizedPath& canonicalizedPath, _Out_ std::wstring& outFileName)
+{
+    if (canonicalizedPath.IsNull())
+    {
+        return;
+    }
+
+    std::wstring tempStr(canonicalizedPath.GetPathString(), canonicalizedPath.Length());
 
     // If the canonicalized string is null or empty, just return. No need to do anything.
     if (tempStr.empty() || tempStr.c_str() == nullptr)
@@ -429,35 +460,6 @@ bool LocateFileAccessManifest(
     }
 }
 
-/// VerifyManifestTree
-///
-/// Run through the tree and perform integrity checks on everything reachable in the tree,
-/// to detect the possibility of data corruption in the tree.
-///
-/// This check is O(m) where m is the number of entries in the manifest.
-/// Only use it for debugging when a corrupted binary structure is suspected.
-#pragma warning( push )
-#pragma warning( disable: 4100 ) // in release builds, record is unused
-inline void VerifyManifestTree(PCManifestRecord const record)
-{
-#ifdef _DEBUG
-    record->AssertValid();
-
-    // loop through every item on every level recursively and verify tags are correct
-    ManifestRecord::BucketCountType numBuckets = record->BucketCount;
-    for (ManifestRecord::BucketCountType i = 0; i < numBuckets; i++)
-    {
-        PCManifestRecord child = record->GetChildRecord(i);
-
-        if (child != nullptr)
-        {
-            VerifyManifestTree(child);
-        }
-    }
-#endif
-}
-#pragma warning( pop )
-
 /// VerifyManifestRoot
 ///
 /// Check that the root is a valid root record by checking the tag and that
@@ -722,6 +724,49 @@ static bool ShouldResolveReparsePointsInPath(
     return !ignoreReparsePointForPath;
 }
 
+/// ParseManifestTree
+///
+/// Validates the manifest tree checksum block found at the given offset and the tree that follows it.
+/// Returns the root of the tree, or null (after reporting the error) if the tree is invalid.
+static PCManifestRecord ParseManifestTree(
+    PCWSTR caller,
+    LPCBYTE payloadBytes,
+    size_t payloadSize,
+    size_t offset,
+    FileAccessManifestExtraFlag extraFlags)
+{
+    // The checksum covers the whole tree, so corruption is detected in release builds too, in one pass over the tree bytes.
+    // Walking the tree record by record is much more expensive, so it is only done if the engine asks for it.
+    const char* treeError = nullptr;
+    if (offset + sizeof(ManifestTreeChecksum) > payloadSize)
+    {
+        treeError = "The manifest tree checksum block is truncated.";
+    }
+    else
+    {
+        PCManifestTreeChecksum treeChecksum = reinterpret_cast<PCManifestTreeChecksum>(&payloadBytes[offset]);
+        treeChecksum->AssertValid();
+        offset += treeChecksum->GetSize();
+
+        treeError = treeChecksum->CheckTree(&payloadBytes[offset], offset <= payloadSize ? payloadSize - offset : 0);
+        if (treeError == nullptr && CheckValidateManifestTree(extraFlags))
+        {
+            treeError = treeChecksum->CheckTreeStructure(reinterpret_cast<PCManifestRecord>(&payloadBytes[offset]));
+        }
+    }
+
+    if (treeError != nullptr)
+    {
+        std::wstring errorMsg = DebugStringFormat(L"%s: Invalid manifest tree: %S", caller, treeError);
+        HandleDetoursInjectionAndCommunicationErrors(DETOURS_PAYLOAD_PARSE_FAILED_22, errorMsg.c_str(), DETOURS_WINDOWS_LOG_MESSAGE_22);
+        return nullptr;
+    }
+
+    PCManifestRecord root = reinterpret_cast<PCManifestRecord>(&payloadBytes[offset]);
+    VerifyManifestRoot(root);
+    return root;
+}
+
 bool ParseFileAccessManifest(
     const void* payload,
     DWORD)
@@ -1000,8 +1045,19 @@ bool ParseFileAccessManifest(
         LoadSubstituteProcessExecutionPluginDll();
     }
 
-    g_manifestTreeRoot = reinterpret_cast<PCManifestRecord>(&payloadBytes[offset]);
-    VerifyManifestRoot(g_manifestTreeRoot);
+    PCManifestRecord manifestTreeRoot = ParseManifestTree(L"ParseFileAccessManifest", payloadBytes, payloadSize, offset, g_fileAccessManifestExtraFlags);
+    if (manifestTreeRoot == nullptr)
+    {
+        return false;
+    }
+
+    // The payload Detours handed over stays around for the lifetime of the process, so the generation does not need to own it.
+    CurrentManifest::GetInstance()->Publish(ManifestGeneration::Create(
+        nullptr,
+        manifestTreeRoot,
+        g_fileAccessManifestFlags,
+        g_fileAccessManifestExtraFlags,
+        g_FileAccessManifestPipId));
 
     //
     // Try to read module file and check permissions.
@@ -1133,6 +1189,74 @@ bool LocateAndParseFileAccessManifest()
     return ParseFileAccessManifest(manifest, manifestSize);
 }
 
+bool ApplyFileAccessManifestSwap(
+    const void* payload,
+    size_t payloadSize)
+{
+    assert(payload != nullptr);
+
+    // Operations started under the current manifest may still be running after the swap, so the new tree must not live in a buffer the
+    // caller could reuse. The copy is owned by the new generation, and released once nothing refers to the generation anymore.
+    std::unique_ptr<unsigned char[]> payloadCopy(new unsigned char[payloadSize]);
+    memcpy_s(payloadCopy.get(), payloadSize, payload, payloadSize);
+    LPCBYTE payloadBytes = payloadCopy.get();
+
+    const char* error = nullptr;
+    size_t offset = 0;
+
+    if (payloadSize < sizeof(ManifestFlags) + sizeof(ManifestExtraFlags) + sizeof(ManifestPipId))
+    {
+        error = "The payload is truncated.";
+    }
+
+    PCManifestFlags flags = reinterpret_cast<PCManifestFlags>(&payloadBytes[offset]);
+    if (error == nullptr && (error = flags->CheckValid()) == nullptr)
+    {
+        offset += flags->GetSize();
+    }
+
+    PCManifestExtraFlags extraFlags = reinterpret_cast<PCManifestExtraFlags>(&payloadBytes[offset]);
+    if (error == nullptr && (error = extraFlags->CheckValid()) == nullptr)
+    {
+        offset += extraFlags->GetSize();
+    }
+
+    PCManifestPipId pipId = reinterpret_cast<PCManifestPipId>(&payloadBytes[offset]);
+    if (error == nullptr && (error = pipId->CheckValid()) == nullptr)
+    {
+        offset += pipId->GetSize();
+    }
+
+    if (error != nullptr)
+    {
+        std::wstring errorMsg = DebugStringFormat(L"SwapFileAccessManifest: Invalid payload: %S", error);
+        HandleDetoursInjectionAndCommunicationErrors(DETOURS_PAYLOAD_PARSE_FAILED_23, errorMsg.c_str(), DETOURS_WINDOWS_LOG_MESSAGE_23);
+        return false;
+    }
+
+    const FileAccessManifestFlag newFlags = static_cast<FileAccessManifestFlag>(flags->Flags);
+    const FileAccessManifestExtraFlag newExtraFlags = static_cast<FileAccessManifestExtraFlag>(extraFlags->ExtraFlags);
+    const uint64_t newPipId = static_cast<uint64_t>(pipId->PipId);
+
+    PCManifestRecord manifestTreeRoot = ParseManifestTree(L"SwapFileAccessManifest", payloadBytes, payloadSize, offset, newExtraFlags);
+    if (manifestTreeRoot == nullptr)
+    {
+        return false;
+    }
+
+    // The flags and pip id are only published with the generation: operations read them from the generation they started under,
+    // while the manifest globals keep describing the manifest the process was started with.
+    CurrentManifest::GetInstance()->Publish(ManifestGeneration::Create(std::move(payloadCopy), manifestTreeRoot, newFlags, newExtraFlags, newPipId));
+
+    // Drop what was derived from the previous manifest, or for the previous pip. Results handed out before the swap (e.g. those kept by
+    // handle overlays) hold on to the previous generation until they are released.
+    PolicySnapshotCache::GetInstance()->Clear();
+    FilesCheckedForAccess::GetInstance()->Clear();
+    ResolvedPathCache::Instance().Clear();
+
+    return true;
+}
+
 SpecialProcessKind  g_ProcessKind = SpecialProcessKind::NotSpecial;
 
 void InitProcessKind()
@@ -31,6 +31,9 @@
 #define DETOURS_UNICODE_CONVERSION_18               -60
 #define DETOURS_PAYLOAD_PARSE_FAILED_19             -61
 #define DETOURS_CREATE_PROCESS_ATTRIBUTE_LIST_21    -62
+#define DETOURS_PAYLOAD_PARSE_FAILED_22             -63
+#define DETOURS_PAYLOAD_PARSE_FAILED_23             -64
+#define DETOURS_HANDLE_TABLE_FULL_24                -65
 
 #define DETOURS_WINDOWS_LOG_MESSAGE_1  L"DominoDetoursService:1"
 #define DETOURS_WINDOWS_LOG_MESSAGE_2  L"DominoDetoursService:2"
@@ -53,6 +56,9 @@
 #define DETOURS_WINDOWS_LOG_MESSAGE_19 L"DominoDetoursService:19"
 #define DETOURS_WINDOWS_LOG_MESSAGE_20 L"DominoDetoursService:20"
 #define DETOURS_WINDOWS_LOG_MESSAGE_21 L"DominoDetoursService:21"
+#define DETOURS_WINDOWS_LOG_MESSAGE_22 L"DominoDetoursService:22"
+#define DETOURS_WINDOWS_LOG_MESSAGE_23 L"DominoDetoursService:23"
+#define DETOURS_WINDOWS_LOG_MESSAGE_24 L"DominoDetoursService:24"
 // ----------------------------------------------------------------------------
 // INLINE FUNCTION DEFINITIONS
 // ----------------------------------------------------------------------------
@@ -106,12 +112,19 @@ bool ParseFileAccessManifest(
 
 bool LocateAndParseFileAccessManifest();
 
+// Replaces the file access manifest of the running process (see SwapFileAccessManifest).
+bool ApplyFileAccessManifestSwap(
+    const void* payload,
+    size_t payloadSize);
+
 void WriteToInternalErrorsFile(PCWSTR format, ...);
 
 void InitProcessKind();
 
 void TranslateFilePath(_In_ const std::wstring& inFileName, _Out_ std::wstring& outFileName);
 
+void TranslateFilePath(_In_ const CanonicalizedPath& inPath, _Out_ std::wstring& outFileName);
+
 DWORD GetReportedError(BOOL result, DWORD error);
 
 void ReportIfNeeded(
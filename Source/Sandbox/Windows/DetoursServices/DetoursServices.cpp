@@ -70,12 +70,8 @@ extern "C" {
 }
 
 #if MEASURE_DETOURED_NT_CLOSE_IMPACT
-volatile LONG g_msTimeToPopulatePoolList = 0;
 volatile ULONGLONG g_pipExecutionStart = 0;
 volatile LONG g_ntCloseHandeCount = 0;
-volatile LONG g_maxClosedListCount = 0;
-volatile LONG g_msTimeInAddClosedList = 0;
-volatile LONG g_msTimeInRemoveClosedList = 0;
 #endif // #if MEASURE_DETOURED_NT_CLOSE_IMPACT
 
 #if MEASURE_REPARSEPOINT_RESOLVING_IMPACT
@@ -226,8 +222,6 @@ FileAccessManifestFlag g_fileAccessManifestFlags;
 FileAccessManifestExtraFlag g_fileAccessManifestExtraFlags;
 uint64_t g_FileAccessManifestPipId;
 
-PCManifestRecord g_manifestTreeRoot;
-
 PManifestChildProcessesToBreakAwayFromJob g_manifestChildProcessesToBreakAwayFromJob;
 vector<BreakawayChildProcess>* g_breakawayChildProcesses = nullptr;
 PManifestTranslatePathsStrings g_manifestTranslatePathsStrings;
@@ -251,14 +245,9 @@ DetouredProcessInjector* g_pDetouredProcessInjector = nullptr;
 
 HANDLE g_hPrivateHeap = nullptr;
 
-// Peak Detours allocated memory. It is allocated in a private heap.
-volatile LONG64 g_detoursMaxAllocatedMemoryInBytes = 0;
-
-// Running allocated memory by Detours in its private heap.
-volatile LONG64 g_detoursHeapAllocatedMemoryInBytes = 0;
-
-// The number of entries allocated in the no-lock, concurrent list for use by NtClose.
-volatile LONG g_detoursAllocatedNoLockConcurentPoolEntries = 0;
+// Allocator behind dd_malloc / dd_free, and thus behind every new / delete in Detours. Large blocks come from g_hPrivateHeap.
+// It keeps its own statistics; the peak memory it used is reported with the process data.
+SlabAllocator g_detoursAllocator;
 
 // The max number of entries in the HandleHeapMap hash table. Allocated in private heap.
 volatile LONG64 g_detoursMaxHandleHeapEntries = 0;
@@ -1014,19 +1003,18 @@ static bool DllProcessDetach()
         // report in BuildXL to reduce the time difference between the time the report
         // is generated, and handling of the report message.
         GetSystemTimeAsFileTime(&exitTime);
-        ReportProcessData(counters, creationTime, exitTime, kernelTime, userTime, exitCode, g_parentProcessId, (LONG64)g_detoursMaxAllocatedMemoryInBytes);
+
+        SlabAllocatorStatistics allocatorStatistics;
+        g_detoursAllocator.GetStatistics(allocatorStatistics);
+        ReportProcessData(counters, creationTime, exitTime, kernelTime, userTime, exitCode, g_parentProcessId, allocatorStatistics);
     }
 
     TraceLoggingUnregister(g_detoursServicesTraceProvider);
 
 #if MEASURE_DETOURED_NT_CLOSE_IMPACT
     // Do some statistical information logging for different measurements
-    Dbg(L"Populate NtClose pool list entries time: %d ms.", g_msTimeToPopulatePoolList);
     Dbg(L"Pip execution time: %d ms.", (LONG)(GetTickCount64() - g_pipExecutionStart));
     Dbg(L"NtCloseHandle call times: %d", g_ntCloseHandeCount);
-    Dbg(L"Maxinum closed list count: %d", g_maxClosedListCount);
-    Dbg(L"Time adding to closed list: %d ms.", g_msTimeInAddClosedList);
-    Dbg(L"Time removing from closed list: %d ms.", g_msTimeInRemoveClosedList);
 #endif // MEASURE_DETOURED_NT_CLOSE_IMPACT
 
 #if MEASURE_REPARSEPOINT_RESOLVING_IMPACT
@@ -1069,6 +1057,8 @@ static bool DllProcessDetach()
         delete g_pDetouredProcessInjector;
     }
 
+    g_detoursAllocator.Destroy();
+
     if (g_hPrivateHeap != nullptr)
     {
         HeapDestroy(g_hPrivateHeap);
@@ -1135,6 +1125,12 @@ static bool DllProcessAttach()
         return false;
     }
 
+    if (!g_detoursAllocator.Initialize())
+    {
+        // Not fatal: every allocation then goes to the private heap.
+        Dbg(L"Failure initializing the detours allocator. Last Error: %d", (int)GetLastError());
+    }
+
     TraceLoggingRegister(g_detoursServicesTraceProvider);
 
     g_breakawayChildProcesses = new vector<BreakawayChildProcess>();
@@ -1384,6 +1380,12 @@ static bool DllProcessAttach()
         return false;
     }
 
+    if (!g_detoursAllocator.Initialize())
+    {
+        // Not fatal: every allocation then goes to the private heap.
+        Dbg(L"Failure initializing the detours allocator. Last Error: %d", (int)GetLastError());
+    }
+
     g_breakawayChildProcesses = new vector<BreakawayChildProcess>();
     g_pManifestTranslatePathTuples = new vector<TranslatePathTuple*>();
     g_pManifestTranslatePathLookupTable = new unordered_set<std::wstring>();
@@ -1395,6 +1397,45 @@ static bool DllProcessAttach()
 #error BUILDXL_NATIVES_LIBRARY or DETOURS_SERVICES_NATIVES_LIBRARY must be defined.
 #endif // DETOURS_SERVICES_NATIVES_LIBRARY
 
+#ifdef DETOURS_SERVICES_NATIVES_LIBRARY
+
+// Control message asking a running detoured process to replace its file access manifest: the size of the payload, followed by the
+// payload itself (the flags, extra flags, pip id, manifest tree checksum and manifest tree blocks of a file access manifest).
+//
+// CODESYNC: Public/Src/Engine/Processes/FileAccessManifest.cs :: GetSwapPayloadBytes
+typedef struct FileAccessManifestSwapMessage_t
+{
+    uint32_t PayloadSize;
+    BYTE Payload[ANYSIZE_ARRAY];
+} FileAccessManifestSwapMessage;
+
+// Replaces the file access manifest of this process, so that a long-lived process (e.g. a compiler server) can be reused across pips.
+//
+// Meant to be started as a thread of the detoured process (e.g. with CreateRemoteThread), with 'message' pointing to a
+// FileAccessManifestSwapMessage the caller wrote into the process. The exit code of the thread tells whether the swap succeeded.
+// The payload is copied, so the caller may release the message as soon as the thread has exited.
+DWORD
+WINAPI
+SwapFileAccessManifest(LPVOID message)
+{
+    // No detours should be called recursively from here.
+    DetouredScope scope;
+
+    if (!g_isAttached)
+    {
+        return ERROR_INVALID_STATE;
+    }
+
+    if (message == nullptr)
+    {
+        return ERROR_INVALID_PARAMETER;
+    }
+
+    const FileAccessManifestSwapMessage* swapMessage = static_cast<const FileAccessManifestSwapMessage*>(message);
+    return ApplyFileAccessManifestSwap(swapMessage->Payload, swapMessage->PayloadSize) ? ERROR_SUCCESS : ERROR_INVALID_DATA;
+}
+
+#endif // DETOURS_SERVICES_NATIVES_LIBRARY
 
 void RetrieveParentProcessId()
 {
@@ -1444,6 +1485,11 @@ DllMain(
 #endif // DETOURS_SERVICES_NATIVES_LIBRARY
         return FALSE;
 
+    case DLL_THREAD_DETACH:
+        // Hand the blocks cached by the exiting thread back to the allocator.
+        g_detoursAllocator.ReleaseThreadCache();
+        return TRUE;
+
     default:
         return TRUE;
     }
@@ -0,0 +1,132 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "stdafx.h"
+#include "EpochReclaimer.h"
+
+#if !_WIN32
+#include <sched.h>
+#endif
+
+// warning C26446: Prefer to use gsl::at() instead of unchecked subscript operator (bounds.4).
+// warning C26482: Only index into arrays using constant expressions (bounds.2).
+// warning C26490: Don't use reinterpret_cast (type.1).
+#pragma warning( disable : 26446 26482 26490 )
+
+static void YieldThread()
+{
+#if _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+EpochReclaimer::EpochReclaimer()
+    : m_epoch(1)
+{
+    for (Slot& slot : m_slots)
+    {
+        slot.Epoch.store(0, std::memory_order_relaxed);
+    }
+}
+
+EpochReclaimer* EpochReclaimer::GetInstance()
+{
+    static EpochReclaimer s_singleton;
+    return &s_singleton;
+}
+
+std::atomic<uint64_t>* EpochReclaimer::Enter() noexcept
+{
+    // Stacks of different threads are far apart, so the address of a local spreads concurrent readers over the slots.
+    const int anchor = 0;
+    const size_t start = static_cast<size_t>(reinterpret_cast<uintptr_t>(&anchor) >> 12);
+
+    for (;;)
+    {
+        for (size_t probe = 0; probe < EPOCH_RECLAIMER_SLOT_COUNT; probe++)
+        {
+            std::atomic<uint64_t>& slot = m_slots[(start + probe) & (EPOCH_RECLAIMER_SLOT_COUNT - 1)].Epoch;
+
+            // The announced epoch may already be stale by the time the slot is claimed. That only holds back the epoch a little longer:
+            // it cannot advance past an epoch some reader still announces.
+            uint64_t free = 0;
+            if (slot.load(std::memory_order_relaxed) == 0 && slot.compare_exchange_strong(free, m_epoch.load()))
+            {
+                return &slot;
+            }
+        }
+
+        YieldThread();
+    }
+}
+
+uint64_t EpochReclaimer::TryAdvance() noexcept
+{
+    uint64_t epoch = m_epoch.load();
+    for (const Slot& slot : m_slots)
+    {
+        const uint64_t announced = slot.Epoch.load();
+        if (announced != 0 && announced != epoch)
+        {
+            return epoch;
+        }
+    }
+
+    // On failure, somebody else advanced the epoch, and 'epoch' is updated to the new value.
+    return m_epoch.compare_exchange_strong(epoch, epoch + 1) ? epoch + 1 : epoch;
+}
+
+void EpochReclaimer::Retire(void* object, ReclaimFunction reclaim)
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_retiredLock);
+        m_retired.push_back(RetiredObject{ object, reclaim, m_epoch.load() });
+    }
+
+    TryReclaim();
+}
+
+size_t EpochReclaimer::TryReclaim()
+{
+    std::vector<RetiredObject> reclaimable;
+    size_t pending = 0;
+
+    {
+        const std::lock_guard<std::mutex> lock(m_retiredLock);
+        if (m_retired.empty())
+        {
+            return 0;
+        }
+
+        // Objects become reclaimable two epochs after their retirement, so try to get there right away
+        // (which succeeds whenever no reader is in a critical section).
+        TryAdvance();
+        const uint64_t epoch = TryAdvance();
+
+        size_t kept = 0;
+        for (RetiredObject const& retired : m_retired)
+        {
+            if (retired.Epoch + 2 <= epoch)
+            {
+                reclaimable.push_back(retired);
+            }
+            else
+            {
+                m_retired[kept++] = retired;
+            }
+        }
+
+        m_retired.resize(kept);
+        pending = kept;
+    }
+
+    // Reclaim outside of the lock: reclaiming an object may retire others.
+    for (RetiredObject const& retired : reclaimable)
+    {
+        retired.Reclaim(retired.Object);
+    }
+
+    return pending;
+}
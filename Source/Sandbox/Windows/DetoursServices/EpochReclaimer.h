@@ -0,0 +1,96 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Number of readers that can be inside a critical section at the same time. Must be a power of 2.
+// Further readers spin until a slot frees up.
+#define EPOCH_RECLAIMER_SLOT_COUNT 256U
+
+// Epoch-based reclamation of objects that readers reach through an atomically published pointer without taking a lock.
+//
+// Readers enter a critical section (see Guard) before loading a published pointer, and must not use what they loaded once they leave it.
+// A writer first unpublishes an object (e.g. by exchanging the pointer) and then retires it: the object is reclaimed once every reader that
+// could still see it has left its critical section.
+//
+// The reclaimer keeps a global epoch. A reader entering a critical section claims one of EPOCH_RECLAIMER_SLOT_COUNT slots and announces the
+// epoch it observed there. The global epoch only advances when every claimed slot announces the current one, and an object retired during
+// epoch E is reclaimed once the global epoch reaches E + 2: by then, every critical section that was open when the object was retired is over.
+//
+// Slots are claimed per critical section rather than per thread, so nothing needs to be cleaned up when a thread exits and no thread-local
+// storage is involved. Critical sections may nest. Entering and leaving one costs an interlocked operation and a store.
+// All operations are thread-safe.
+class EpochReclaimer
+{
+public:
+    typedef void (*ReclaimFunction)(void* object);
+
+    static EpochReclaimer* GetInstance();
+
+    // Critical section of a reader. Pointers loaded while a guard is alive stay valid until it is destroyed.
+    class Guard
+    {
+    public:
+        explicit Guard(EpochReclaimer* reclaimer) noexcept
+            : m_slot(reclaimer->Enter())
+        { }
+
+        ~Guard()
+        {
+            m_slot->store(0, std::memory_order_release);
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        std::atomic<uint64_t>* m_slot;
+    };
+
+    // Schedules 'reclaim(object)' for when no reader can hold a reference to 'object' anymore. The object must already be unreachable
+    // for readers entering a critical section from now on. Reclaims whatever can be reclaimed before returning, possibly 'object' itself.
+    void Retire(void* object, ReclaimFunction reclaim);
+
+    // Tries to advance the epoch and reclaims the objects no reader can see anymore. Returns the number of objects still pending.
+    size_t TryReclaim();
+
+    uint64_t GetEpoch() const noexcept { return m_epoch.load(); }
+
+private:
+    EpochReclaimer();
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+    struct RetiredObject
+    {
+        void* Object;
+        ReclaimFunction Reclaim;
+        uint64_t Epoch;
+    };
+
+    // Each slot gets a cache line of its own, so that readers do not contend on the lines of other readers.
+    struct alignas(64) Slot
+    {
+        // Epoch announced by the reader holding the slot, or 0 if the slot is free.
+        std::atomic<uint64_t> Epoch;
+    };
+
+    std::atomic<uint64_t>* Enter() noexcept;
+
+    // Advances the epoch if every reader is in the current one. Returns the epoch after the attempt.
+    uint64_t TryAdvance() noexcept;
+
+    // Epochs start at 1, as 0 marks free slots.
+    std::atomic<uint64_t> m_epoch;
+    Slot m_slots[EPOCH_RECLAIMER_SLOT_COUNT];
+
+    // Retirement is rare (e.g. once per manifest swap), so retired objects are simply kept in a list under a lock.
+    std::mutex m_retiredLock;
+    std::vector<RetiredObject> m_retired;
+};
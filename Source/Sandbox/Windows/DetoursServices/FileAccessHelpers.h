@@ -7,6 +7,7 @@
 
 #if _WIN32
 #include "globals.h"
+#include "ManifestGeneration.h"
 #include <string>
 #endif // _WIN32
 
@@ -348,15 +349,16 @@ enum PathType {
 #if _WIN32
 
 #define GEN_CHECK_GLOBAL_FAM_FLAG(flag_name, flag_value) \
-inline bool flag_name()         { return Check##flag_name(g_fileAccessManifestFlags); } \
-inline bool Should##flag_name() { return Check##flag_name(g_fileAccessManifestFlags); }
+inline bool flag_name()         { return Check##flag_name(OperationManifest::GetFlags()); } \
+inline bool Should##flag_name() { return Check##flag_name(OperationManifest::GetFlags()); }
 
+// The flags are those of the manifest the current operation runs under (see OperationManifest).
 FOR_ALL_FAM_FLAGS(GEN_CHECK_GLOBAL_FAM_FLAG)
-inline bool ReportAnyAccess(bool accessDenied) { return CheckReportAnyAccess(g_fileAccessManifestFlags, accessDenied); }
+inline bool ReportAnyAccess(bool accessDenied) { return CheckReportAnyAccess(OperationManifest::GetFlags(), accessDenied); }
 
 #define GEN_CHECK_GLOBAL_FAM_EXTRA_FLAG(flag_name, flag_value) \
-inline bool flag_name()         { return Check##flag_name(g_fileAccessManifestExtraFlags); } \
-inline bool Should##flag_name() { return Check##flag_name(g_fileAccessManifestExtraFlags); }
+inline bool flag_name()         { return Check##flag_name(OperationManifest::GetExtraFlags()); } \
+inline bool Should##flag_name() { return Check##flag_name(OperationManifest::GetExtraFlags()); }
 
 FOR_ALL_FAM_EXTRA_FLAGS(GEN_CHECK_GLOBAL_FAM_EXTRA_FLAG)
 
@@ -8,26 +8,41 @@ FilesCheckedForAccess::FilesCheckedForAccess()
 {
 }
 
-bool FilesCheckedForAccess::TryRegisterPath(const CanonicalizedPathType& path) {
-    const std::unique_lock<std::shared_mutex> lock(m_lock);
+DWORD FilesCheckedForAccess::HashCanonicalizedPath(const CanonicalizedPathType& path) {
 #if _WIN32
-    auto result = m_pathSet.insert(path.GetPathString());
+    // Canonicalized paths carry their hash, computed when they were created.
+    return path.Hash();
 #else
-    auto result = m_pathSet.insert(path);
+    return HashPath(path.c_str(), path.length());
 #endif
+}
 
-    return result.second;
+bool FilesCheckedForAccess::TryRegisterPath(const CanonicalizedPathType& path) {
+    return TryRegisterPath(path, HashCanonicalizedPath(path));
+}
+
+bool FilesCheckedForAccess::TryRegisterPath(const CanonicalizedPathType& path, DWORD pathHash) {
+#if _WIN32
+    return m_pathSet.TryInsert(path.GetPathString(), path.Length(), pathHash);
+#else
+    return m_pathSet.TryInsert(path.c_str(), path.length(), pathHash);
+#endif
 }
 
 bool FilesCheckedForAccess::IsRegistered(const CanonicalizedPathType& path) {
-    const std::shared_lock<std::shared_mutex> lock(m_lock);
+    return IsRegistered(path, HashCanonicalizedPath(path));
+}
+
+bool FilesCheckedForAccess::IsRegistered(const CanonicalizedPathType& path, DWORD pathHash) {
 #if _WIN32
-    auto result = m_pathSet.find(path.GetPathString());
+    return m_pathSet.Contains(path.GetPathString(), path.Length(), pathHash);
 #else
-    auto result = m_pathSet.find(path);
+    return m_pathSet.Contains(path.c_str(), path.length(), pathHash);
 #endif
+}
 
-    return (result != m_pathSet.end());
+void FilesCheckedForAccess::Clear() {
+    m_pathSet.Clear();
 }
 
 FilesCheckedForAccess* FilesCheckedForAccess::GetInstance() {
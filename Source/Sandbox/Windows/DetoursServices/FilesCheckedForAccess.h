@@ -12,17 +12,9 @@
     typedef std::string CanonicalizedPathType;
 #endif // _WIN32
 
-#include <unordered_set>
-#include <cwctype>
-#include <mutex>
-#include <shared_mutex>
-#include <cassert>
-#if _WIN32
-    #include "UtilityHelpers.h"
-    #include <algorithm>
-#endif
+#include "ConcurrentPathSet.h"
 
-// Keeps a set of case-insensitive paths that were checked for access 
+// Keeps a set of paths that were checked for access. Comparisons are case-insensitive on Windows.
 // All operations are thread-safe
 class FilesCheckedForAccess {
 public:
@@ -31,20 +23,25 @@ public:
     // Tries to register that a given path was checked for access
     // Returns whether the path was not registered before
     bool TryRegisterPath(const CanonicalizedPathType& path);
+
+    // Same as above, but takes the HashPath value of the path, when the caller already has it
+    bool TryRegisterPath(const CanonicalizedPathType& path, DWORD pathHash);
     
     // Returns whether the given path is registered.
     bool IsRegistered(const CanonicalizedPathType& path);
 
+    // Same as above, but takes the HashPath value of the path, when the caller already has it
+    bool IsRegistered(const CanonicalizedPathType& path, DWORD pathHash);
+
+    // Forgets every registered path.
+    void Clear();
+
 private:
     FilesCheckedForAccess();
     FilesCheckedForAccess(const FilesCheckedForAccess&) = delete;
     FilesCheckedForAccess& operator = (const FilesCheckedForAccess&) = delete;
 
-// We only want case insensitive comparisons on Windows
-#if _WIN32
-    std::unordered_set<std::wstring, CaseInsensitiveStringHasher, CaseInsensitiveStringComparer> m_pathSet;
-#else
-    std::unordered_set<std::string> m_pathSet;
-#endif
-    std::shared_mutex m_lock;
+    static DWORD HashCanonicalizedPath(const CanonicalizedPathType& path);
+
+    ConcurrentPathSet m_pathSet;
 };
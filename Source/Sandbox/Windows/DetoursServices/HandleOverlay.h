@@ -9,7 +9,8 @@
 // That's only viable so long as ALL HANDLE-consuming APIs are detoured (even boring things like GetHandleInformation); otherwise
 // any missing API would reject our fake HANDLEs, or crash.
 //
-// Instead, we define a process-global HANDLE -> overlay map and return all HANDLEs unmodified.
+// Instead, we define a process-global HANDLE -> overlay map and return all HANDLEs unmodified. The map is a ConcurrentHandleTable,
+// so looking up an overlay (which happens on every HANDLE-only API) never takes a lock.
 
 #include "FileAccessHelpers.h"
 #include "PolicyResult.h"
@@ -54,17 +55,15 @@ typedef std::shared_ptr<HandleOverlay> HandleOverlayRef;
 // Creates or replaces an overlay for the given handle (intended for the time at which a handle is created).
 // The new overlays wraps the policy / access check determined for the handle so far.
 // The policy represents what operations should be allowed via operations on this handle.
+// If the overlay cannot be recorded (the handle table is full), accesses through the handle would go unreported, so that is reported
+// as a Detours error.
 void RegisterHandleOverlay(HANDLE handle, AccessCheckResult const& accessCheck, PolicyResult const& policy, HandleType type);
 
 // Tries to look up an existing overlay for the given handle. The returned ref may wrap nullptr in the event that there was no overlay found.
-HandleOverlayRef TryLookupHandleOverlay(HANDLE handle, bool drain = true);
+HandleOverlayRef TryLookupHandleOverlay(HANDLE handle);
 
 // If an overlay exists for the given handle, disassociates it from the handle. Future calls to TryLookupHandleOverlay for the handle will no
 // longer succeed. Concurrent users that already have a ref to the overlay may continue to use it safely.
-void CloseHandleOverlay(HANDLE handle, bool inRecursion = false);
-
-// Adds a closed handle to the closed handle list.
-void AddClosedHandle(HANDLE handle);
-
-// Remove all closed handlefrom the overlay map.
-void RemoveClosedHandles();
+// This takes no lock, so it is safe to call from NtClose even while the heap holds its own lock. It does free the overlay, and may briefly
+// spin until concurrent lookups of the handle are done copying it.
+void CloseHandleOverlay(HANDLE handle);
@@ -0,0 +1,267 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "stdafx.h"
+#include "IndexedPath.h"
+#include "StringOperations.h"
+
+#include <new>
+
+// warning C26481: Don't use pointer arithmetic. Use span instead (bounds.1).
+// warning C26446: Prefer to use gsl::at() instead of unchecked subscript operator (bounds.4).
+// warning C26490: Don't use reinterpret_cast (type.1).
+#pragma warning( disable : 26481 26446 26490 )
+
+static const size_t NoNewLine = PathScan::NoNewLine;
+
+IndexedPath::Ref IndexedPath::Create(PCPathChar path, size_t length, size_t prefixLength)
+{
+    return Build(&path, &length, 1, prefixLength, nullptr, 0);
+}
+
+IndexedPath::Ref IndexedPath::Create(PCPathChar path, const PathScan& scan)
+{
+    if (!scan.IsIndexed)
+    {
+        return Build(&path, &scan.Length, 1, scan.PrefixLength, nullptr, 0, scan.ComponentCount);
+    }
+
+    IndexedPath* result = Allocate(scan.Length, scan.PrefixLength, scan.ComponentCount);
+    PathComponent* components = result->GetMutableComponents();
+    if (scan.ComponentCount > 0)
+    {
+        memcpy(components, scan.Components, scan.ComponentCount * sizeof(PathComponent));
+    }
+
+    memcpy(components + scan.ComponentCount, path, (scan.Length + 1) * sizeof(PathChar));
+    result->m_hash = scan.Hash;
+    result->m_firstNewLineIndex = scan.FirstNewLineIndex;
+
+    return Ref::Adopt(result);
+}
+
+IndexedPath::Ref IndexedPath::CreatePrefix(const IndexedPath& base, size_t length)
+{
+    assert(length <= base.Length());
+
+    PCPathChar path = base.GetString();
+    return Build(&path, &length, 1, base.PrefixLength(), &base, base.CountComponentsEndingBefore(length));
+}
+
+IndexedPath::Ref IndexedPath::CreateExtended(const IndexedPath& base, PathChar separator, PCPathChar suffix, size_t suffixLength)
+{
+    // The last component of the base must not run into the suffix.
+    assert(separator != 0 || base.Length() == 0 || suffixLength == 0
+        || IsDirectorySeparator(base.GetString()[base.Length() - 1]) || IsDirectorySeparator(suffix[0]));
+
+    const PCPathChar parts[] = { base.GetString(), &separator, suffix };
+    const size_t partLengths[] = { base.Length(), separator != 0 ? 1U : 0U, suffixLength };
+    return Build(parts, partLengths, 3, base.PrefixLength(), &base, base.ComponentCount());
+}
+
+void IndexedPath::Destroy(IndexedPath* path) noexcept
+{
+    path->~IndexedPath();
+    ::operator delete(static_cast<void*>(path));
+}
+
+IndexedPath* IndexedPath::Allocate(size_t length, size_t prefixLength, size_t componentCount)
+{
+    const size_t size = sizeof(IndexedPath) + componentCount * sizeof(PathComponent) + (length + 1) * sizeof(PathChar);
+    IndexedPath* result = new (::operator new(size)) IndexedPath();
+    result->m_length = length;
+    result->m_prefixLength = prefixLength;
+    result->m_componentCount = componentCount;
+    return result;
+}
+
+IndexedPath::Ref IndexedPath::Build(
+    const PCPathChar* parts,
+    const size_t* partLengths,
+    size_t partCount,
+    size_t prefixLength,
+    const IndexedPath* base,
+    size_t reusedComponents,
+    size_t componentCount)
+{
+    // Everything up to the end of the last reused component is identical to the base path, so scanning resumes right after it.
+    const PathComponent* reused = base != nullptr ? base->GetComponents() : nullptr;
+    const size_t resumeIndex = reusedComponents > 0 ? reused[reusedComponents - 1].End() : 0;
+
+    size_t length = 0;
+    for (size_t part = 0; part < partCount; part++)
+    {
+        length += partLengths[part];
+    }
+
+    // Unless the caller already knows it, count the remaining components first, so that the whole path can be laid out in
+    // one exactly sized allocation. This pass only looks for separators; the hashing pass below is the expensive one.
+    if (componentCount == UnknownComponentCount)
+    {
+        componentCount = reusedComponents;
+        size_t position = 0;
+        bool inComponent = false;
+        for (size_t part = 0; part < partCount; part++)
+        {
+            for (size_t i = 0; i < partLengths[part]; i++, position++)
+            {
+                if (position < resumeIndex || position < prefixLength)
+                {
+                    continue;
+                }
+
+                const bool isSeparator = IsDirectorySeparator(parts[part][i]);
+                if (!isSeparator && !inComponent)
+                {
+                    componentCount++;
+                }
+
+                inComponent = !isSeparator;
+            }
+        }
+    }
+
+    IndexedPath* result = Allocate(length, prefixLength, componentCount);
+
+    PathComponent* components = result->GetMutableComponents();
+    PPathChar chars = reinterpret_cast<PPathChar>(components + componentCount);
+    size_t copied = 0;
+    for (size_t part = 0; part < partCount; part++)
+    {
+        if (partLengths[part] > 0)
+        {
+            memcpy(chars + copied, parts[part], partLengths[part] * sizeof(PathChar));
+            copied += partLengths[part];
+        }
+    }
+
+    chars[length] = 0;
+
+    DWORD pathHash = Fnv1Basis32;
+    result->m_firstNewLineIndex = NoNewLine;
+    if (reusedComponents > 0)
+    {
+        memcpy(components, reused, reusedComponents * sizeof(PathComponent));
+        pathHash = reused[reusedComponents - 1].PathHash;
+
+        if (base->m_firstNewLineIndex < resumeIndex)
+        {
+            result->m_firstNewLineIndex = base->m_firstNewLineIndex;
+        }
+    }
+
+    // Single pass over the remaining characters folding both the hash of the whole path and the hash of the current component.
+    size_t componentIndex = reusedComponents;
+    PathComponent* current = nullptr;
+    for (size_t i = resumeIndex; i < length; i++)
+    {
+        const PathChar c = chars[i];
+        const PathChar normalized = NormalizePathChar(c);
+        pathHash = FoldPathHash(pathHash, normalized);
+
+        if ((c == '\r' || c == '\n') && result->m_firstNewLineIndex == NoNewLine)
+        {
+            result->m_firstNewLineIndex = i;
+        }
+
+        if (i < prefixLength || IsDirectorySeparator(c))
+        {
+            current = nullptr;
+            continue;
+        }
+
+        if (current == nullptr)
+        {
+            current = &components[componentIndex++];
+            current->Start = static_cast<uint32_t>(i);
+            current->Length = 0;
+            current->Hash = Fnv1Basis32;
+        }
+
+        current->Length++;
+        current->Hash = FoldPathHash(current->Hash, normalized);
+        current->PathHash = pathHash;
+    }
+
+    assert(componentIndex == componentCount);
+    result->m_hash = pathHash;
+
+    return Ref::Adopt(result);
+}
+
+size_t IndexedPath::CountComponentsEndingBefore(size_t offset) const noexcept
+{
+    // Components are sorted and disjoint, so their ends are increasing.
+    const PathComponent* components = GetComponents();
+    size_t low = 0;
+    size_t high = m_componentCount;
+    while (low < high)
+    {
+        const size_t middle = low + (high - low) / 2;
+        if (components[middle].End() <= offset)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+size_t IndexedPath::FindFirstComponentStartingAt(size_t offset) const noexcept
+{
+    const PathComponent* components = GetComponents();
+    size_t low = 0;
+    size_t high = m_componentCount;
+    while (low < high)
+    {
+        const size_t middle = low + (high - low) / 2;
+        if (components[middle].Start < offset)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+size_t IndexedPath::FinalSeparatorIndex() const noexcept
+{
+    PCPathChar str = GetString();
+    if (m_length > 0 && IsDirectorySeparator(str[m_length - 1]))
+    {
+        return m_length - 1;
+    }
+
+    // Every non-separator character past the prefix belongs to a component, so unless the path ends with a separator,
+    // the final separator immediately precedes the last component. It can only be elsewhere if that component
+    // starts right after the prefix (or there is no component at all), in which case the prefix has to be looked at.
+    size_t end = m_length < m_prefixLength ? m_length : m_prefixLength;
+    if (m_componentCount > 0)
+    {
+        const size_t lastStart = GetComponents()[m_componentCount - 1].Start;
+        if (lastStart > m_prefixLength)
+        {
+            return lastStart - 1;
+        }
+
+        end = lastStart;
+    }
+
+    for (size_t i = end; i > 0; i--)
+    {
+        if (IsDirectorySeparator(str[i - 1]))
+        {
+            return i - 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+
+#include "DataTypes.h"
+#include "PathScanner.h"
+#include "RefCountedPtr.h"
+
+// Immutable path string together with an index of its components, its HashPath value and some flags computed
+// while scanning it. This is platform neutral: it does not interpret the path beyond separators and a caller-provided
+// prefix length (e.g. 4 for \\?\C:\foo), so the same logic runs against recorded path corpora anywhere.
+//
+// Instances are reference counted (see RefCountedPtr) and live in a single allocation:
+// the header, followed by the component array, followed by the null-terminated characters.
+//
+// Derived paths (extending a path or truncating it to a prefix) reuse the components and hashes of the
+// path they derive from, so only the characters that actually changed are scanned.
+class IndexedPath : public RefCounted
+{
+public:
+    typedef RefCountedPtr<IndexedPath> Ref;
+
+    // Indexes the first 'length' characters of 'path'. Characters before 'prefixLength' (such as a \\?\ prefix) are hashed
+    // but do not belong to any component.
+    static Ref Create(PCPathChar path, size_t length, size_t prefixLength);
+
+    // Indexes a path that has already been scanned by ScanPath. The components and hashes of the scan are used as they are
+    // when it has them (see PathScan::IsIndexed); otherwise the scan still spares the pass that sizes the component array.
+    static Ref Create(PCPathChar path, const PathScan& scan);
+
+    // Indexes the first 'length' characters of 'base'. Components and hashes of 'base' that lie within that prefix are reused.
+    static Ref CreatePrefix(const IndexedPath& base, size_t length);
+
+    // Indexes 'base' followed by 'separator' (unless it is zero) and the first 'suffixLength' characters of 'suffix'.
+    // All components and hashes of 'base' are reused, so only the appended characters are scanned.
+    static Ref CreateExtended(const IndexedPath& base, PathChar separator, PCPathChar suffix, size_t suffixLength);
+
+    // Destroys an instance once its last reference goes away. Used by RefCountedPtr.
+    static void Destroy(IndexedPath* path) noexcept;
+
+    PCPathChar GetString() const noexcept { return reinterpret_cast<PCPathChar>(GetComponents() + m_componentCount); }
+    size_t Length() const noexcept { return m_length; }
+
+    // HashPath(GetString(), Length()).
+    DWORD Hash() const noexcept { return m_hash; }
+
+    size_t PrefixLength() const noexcept { return m_prefixLength; }
+
+    const PathComponent* GetComponents() const noexcept { return reinterpret_cast<const PathComponent*>(this + 1); }
+    size_t ComponentCount() const noexcept { return m_componentCount; }
+
+    // Number of leading components that end at or before the given offset.
+    size_t CountComponentsEndingBefore(size_t offset) const noexcept;
+
+    // Index of the first component starting at or after the given offset (ComponentCount() if none).
+    size_t FindFirstComponentStartingAt(size_t offset) const noexcept;
+
+    // Index of the final directory separator, or zero if there is none. Same as FindFinalPathSeparator.
+    size_t FinalSeparatorIndex() const noexcept;
+
+    // Index of the first \r or \n, which have to be escaped before the path is sent in a report line, or Length() if there is none.
+    size_t FirstNewLineIndex() const noexcept { return m_firstNewLineIndex < m_length ? m_firstNewLineIndex : m_length; }
+
+private:
+    IndexedPath() noexcept = default;
+    ~IndexedPath() = default;
+
+    PathComponent* GetMutableComponents() noexcept { return reinterpret_cast<PathComponent*>(this + 1); }
+
+    static const size_t UnknownComponentCount = static_cast<size_t>(-1);
+
+    // Allocates an instance for a path of the given length and number of components. The characters, the components,
+    // the hash and the new line index are left to the caller.
+    static IndexedPath* Allocate(size_t length, size_t prefixLength, size_t componentCount);
+
+    // Indexes the concatenation of the given parts. The characters up to the end of component 'reusedComponents - 1' of 'base'
+    // must be identical to those of 'base'. The total number of components is counted unless provided.
+    static Ref Build(
+        const PCPathChar* parts,
+        const size_t* partLengths,
+        size_t partCount,
+        size_t prefixLength,
+        const IndexedPath* base,
+        size_t reusedComponents,
+        size_t componentCount = UnknownComponentCount);
+
+    size_t m_length;
+    size_t m_prefixLength;
+    size_t m_componentCount;
+    size_t m_firstNewLineIndex;
+    DWORD m_hash;
+};
@@ -0,0 +1,150 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "stdafx.h"
+#include "ManifestGeneration.h"
+#include "globals.h"
+
+// warning C26409: Avoid calling new and delete explicitly, use std::make_unique<T> instead (r.11).
+#pragma warning( disable : 26409 )
+
+static std::atomic<uint64_t> s_lastGenerationNumber(0);
+
+ManifestGeneration::Ref ManifestGeneration::Create(
+    std::unique_ptr<unsigned char[]> payload,
+    PCManifestRecord root,
+    FileAccessManifestFlag flags,
+    FileAccessManifestExtraFlag extraFlags,
+    uint64_t pipId)
+{
+    return Ref::Adopt(new ManifestGeneration(std::move(payload), root, flags, extraFlags, pipId, ++s_lastGenerationNumber));
+}
+
+void ManifestGeneration::Destroy(ManifestGeneration* generation) noexcept
+{
+    delete generation;
+}
+
+CurrentManifest* CurrentManifest::GetInstance()
+{
+    static CurrentManifest s_singleton;
+    return &s_singleton;
+}
+
+ManifestGeneration::Ref CurrentManifest::Get() const
+{
+    // The reference the publisher holds may be dropped as soon as the pointer is swapped, so it is only safe
+    // to take a reference of our own while in a critical section.
+    const EpochReclaimer::Guard guard(m_reclaimer);
+
+    const ManifestGeneration* current = m_current.load();
+    if (current != nullptr)
+    {
+        current->AddRef();
+    }
+
+    return ManifestGeneration::Ref::Adopt(current);
+}
+
+void CurrentManifest::Publish(ManifestGeneration::Ref const& generation)
+{
+    assert(generation);
+
+    // The current pointer owns a reference of its own. The initial generation keeps it when it is replaced: it is never retired.
+    generation->AddRef();
+    if (m_initial.load() == nullptr)
+    {
+        m_initial.store(generation.Get());
+    }
+
+    const ManifestGeneration* previous = m_current.exchange(generation.Get());
+    m_publishCount++;
+
+    if (previous != nullptr && previous != m_initial.load())
+    {
+        m_reclaimer->Retire(
+            const_cast<ManifestGeneration*>(previous),
+            [](void* object)
+            {
+                // Adopting the reference the current pointer held releases it on the way out.
+                const ManifestGeneration::Ref released = ManifestGeneration::Ref::Adopt(static_cast<const ManifestGeneration*>(object));
+            });
+    }
+}
+
+__declspec(thread) const ManifestGeneration* OperationManifest::gt_pinned = nullptr;
+
+void OperationManifest::Enter() noexcept
+{
+    assert(gt_pinned == nullptr);
+
+    const CurrentManifest* current = CurrentManifest::GetInstance();
+    if (!current->IsSwapped())
+    {
+        // The initial generation is current, and stays alive for the lifetime of the process.
+        gt_pinned = current->GetInitial();
+        return;
+    }
+
+    // The pin owns the reference Get took.
+    gt_pinned = current->Get().Detach();
+}
+
+void OperationManifest::Exit() noexcept
+{
+    const ManifestGeneration* pinned = gt_pinned;
+    gt_pinned = nullptr;
+
+    if (pinned != CurrentManifest::GetInstance()->GetInitial())
+    {
+        const ManifestGeneration::Ref released = ManifestGeneration::Ref::Adopt(pinned);
+    }
+}
+
+ManifestGeneration::Ref OperationManifest::Get()
+{
+    const ManifestGeneration* pinned = gt_pinned;
+    if (pinned == nullptr)
+    {
+        return CurrentManifest::GetInstance()->Get();
+    }
+
+    pinned->AddRef();
+    return ManifestGeneration::Ref::Adopt(pinned);
+}
+
+FileAccessManifestFlag OperationManifest::GetFlags()
+{
+    const ManifestGeneration* pinned = gt_pinned;
+    if (pinned != nullptr)
+    {
+        return pinned->GetFlags();
+    }
+
+    const ManifestGeneration::Ref current = CurrentManifest::GetInstance()->Get();
+    return current ? current->GetFlags() : g_fileAccessManifestFlags;
+}
+
+FileAccessManifestExtraFlag OperationManifest::GetExtraFlags()
+{
+    const ManifestGeneration* pinned = gt_pinned;
+    if (pinned != nullptr)
+    {
+        return pinned->GetExtraFlags();
+    }
+
+    const ManifestGeneration::Ref current = CurrentManifest::GetInstance()->Get();
+    return current ? current->GetExtraFlags() : g_fileAccessManifestExtraFlags;
+}
+
+uint64_t OperationManifest::GetPipId()
+{
+    const ManifestGeneration* pinned = gt_pinned;
+    if (pinned != nullptr)
+    {
+        return pinned->GetPipId();
+    }
+
+    const ManifestGeneration::Ref current = CurrentManifest::GetInstance()->Get();
+    return current ? current->GetPipId() : g_FileAccessManifestPipId;
+}
@@ -0,0 +1,130 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+
+#include "DataTypes.h"
+#include "EpochReclaimer.h"
+#include "RefCountedPtr.h"
+
+#include <atomic>
+#include <memory>
+
+// One file access manifest a process ran (or runs) under: the root of its policy tree, its flags and the pip it belongs to.
+//
+// A process normally keeps the manifest it started with. Long-lived processes reused across pips (e.g. compiler servers) get a new manifest
+// for every pip (see SwapFileAccessManifest), while operations started under the previous one may still be running: everything derived from a
+// manifest (policy search cursors point into its tree) holds a reference to its generation, which keeps the tree alive.
+class ManifestGeneration : public RefCounted
+{
+public:
+    typedef RefCountedPtr<ManifestGeneration> Ref;
+
+    // Creates a generation for the tree at 'root'. 'payload' is the buffer the tree lives in, released with the generation; it is null
+    // when the tree lives in memory that stays valid for the lifetime of the process (the payload the process was started with).
+    static Ref Create(
+        std::unique_ptr<unsigned char[]> payload,
+        PCManifestRecord root,
+        FileAccessManifestFlag flags,
+        FileAccessManifestExtraFlag extraFlags,
+        uint64_t pipId);
+
+    // Destroys an instance once its last reference goes away. Used by RefCountedPtr.
+    static void Destroy(ManifestGeneration* generation) noexcept;
+
+    PCManifestRecord GetRoot() const noexcept { return m_root; }
+    FileAccessManifestFlag GetFlags() const noexcept { return m_flags; }
+    FileAccessManifestExtraFlag GetExtraFlags() const noexcept { return m_extraFlags; }
+    uint64_t GetPipId() const noexcept { return m_pipId; }
+
+    // Sequence number of the generation within the process, starting at 1.
+    uint64_t GetNumber() const noexcept { return m_number; }
+
+private:
+    ManifestGeneration(
+        std::unique_ptr<unsigned char[]> payload,
+        PCManifestRecord root,
+        FileAccessManifestFlag flags,
+        FileAccessManifestExtraFlag extraFlags,
+        uint64_t pipId,
+        uint64_t number)
+        : m_payload(std::move(payload)), m_root(root), m_flags(flags), m_extraFlags(extraFlags), m_pipId(pipId), m_number(number)
+    { }
+
+    ~ManifestGeneration() = default;
+
+    std::unique_ptr<unsigned char[]> m_payload;
+    PCManifestRecord m_root;
+    FileAccessManifestFlag m_flags;
+    FileAccessManifestExtraFlag m_extraFlags;
+    uint64_t m_pipId;
+    uint64_t m_number;
+};
+
+// The manifest generation new operations run under.
+//
+// The current generation is published through a single atomic pointer, so looking it up takes no lock. Publishing a new generation swaps
+// the pointer and hands the reference the publisher held on the previous one to the EpochReclaimer, which drops it once no reader can be
+// in the middle of acquiring it anymore. Readers holding their own reference keep the previous generation alive for as long as they need.
+// All operations are thread-safe.
+class CurrentManifest
+{
+public:
+    static CurrentManifest* GetInstance();
+
+    // Returns the current generation, or a null reference if no manifest was published yet.
+    ManifestGeneration::Ref Get() const;
+
+    // Makes 'generation' the current generation.
+    void Publish(ManifestGeneration::Ref const& generation);
+
+    // Whether the manifest the process started with was replaced. Reports carry the pip id once it was (see SendReportString).
+    // Once this returns true, Get no longer returns the initial generation.
+    bool IsSwapped() const noexcept { return m_publishCount.load(std::memory_order_acquire) > 1; }
+
+    // The first generation published, or null if there is none yet. It is referenced for the lifetime of the process, so callers may use it
+    // without taking a reference of their own.
+    const ManifestGeneration* GetInitial() const noexcept { return m_initial.load(std::memory_order_relaxed); }
+
+private:
+    CurrentManifest()
+        : m_current(nullptr), m_initial(nullptr), m_publishCount(0), m_reclaimer(EpochReclaimer::GetInstance())
+    { }
+
+    CurrentManifest(const CurrentManifest&) = delete;
+    CurrentManifest& operator=(const CurrentManifest&) = delete;
+
+    std::atomic<const ManifestGeneration*> m_current;
+    std::atomic<const ManifestGeneration*> m_initial;
+    std::atomic<uint64_t> m_publishCount;
+    EpochReclaimer* m_reclaimer;
+};
+
+// The manifest generation of the operation running on the calling thread.
+//
+// The outermost DetouredScope of a thread pins the current generation when it is entered and releases it when it is left. So everything an
+// operation reads from its manifest (its flags, its policy tree, the pip id its reports are tagged with) comes from the generation it started
+// under, even if the manifest is swapped while it runs. Until the manifest is first swapped, the generation pinned is the initial one, which
+// is borrowed rather than referenced: most processes are never handed a second manifest, and their detoured calls should not pay for a reader
+// critical section and a shared reference count update each.
+// Outside of a detoured operation (e.g. while the process attaches or detaches), the current generation is used, and before the first one is
+// published, the manifest globals the process was started with.
+class OperationManifest
+{
+public:
+    // Pins the current generation for the calling thread. Called when the outermost DetouredScope is entered.
+    static void Enter() noexcept;
+
+    // Releases the generation pinned by Enter. Called when the outermost DetouredScope is left.
+    static void Exit() noexcept;
+
+    // Returns the generation pinned by the calling thread, or the current generation if there is none.
+    static ManifestGeneration::Ref Get();
+
+    static FileAccessManifestFlag GetFlags();
+    static FileAccessManifestExtraFlag GetExtraFlags();
+    static uint64_t GetPipId();
+
+private:
+    static __declspec(thread) const ManifestGeneration* gt_pinned;
+};
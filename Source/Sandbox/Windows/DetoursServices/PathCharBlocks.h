@@ -0,0 +1,335 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Block-at-a-time building blocks for the case-insensitive path primitives in StringOperations and UtilityHelpers.
+//
+// Build paths are overwhelmingly ASCII. A block of ASCII characters can be case folded and compared in a vector register,
+// because for ASCII every case mapping we use (towupper, towlower, the invariant locale and utf8proc) just moves 'a'-'z' onto
+// 'A'-'Z' or back. Blocks containing anything else are handed, one character at a time, to the caller-provided scalar fold,
+// so results are always identical to folding every character with it.
+//
+// SSE2 is part of the baseline of every x86 and x64 target we build, and NEON of every ARM64 one, so no runtime dispatch is needed.
+// Elsewhere (and for 4-byte characters) blocks are single characters, which still avoids the scalar fold for ASCII.
+// Defining PATH_CHAR_BLOCKS_SCALAR forces single-character blocks everywhere.
+
+#if defined(PATH_CHAR_BLOCKS_SCALAR)
+// No vector implementation.
+#elif defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define PATH_CHAR_BLOCKS_SSE2 1
+#include <emmintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define PATH_CHAR_BLOCKS_NEON 1
+#include <arm_neon.h>
+#endif
+
+// warning C26481: Don't use pointer arithmetic. Use span instead (bounds.1).
+// warning C26490: Don't use reinterpret_cast (type.1).
+// warning C26446: Prefer to use gsl::at() instead of unchecked subscript operator (bounds.4).
+#pragma warning( push )
+#pragma warning( disable : 26481 26490 26446 )
+
+namespace PathCharBlocks {
+
+// Operations on a block of characters of the given size. ToUpper and ToLower must only be applied to ASCII blocks.
+// The generic version processes a single character per block.
+template <size_t CharSize>
+struct BlockOps
+{
+    typedef uint32_t Block;
+    static const size_t Width = 1;
+
+    static Block Load(const void* p) noexcept
+    {
+        return CharSize == 1 ? *static_cast<const uint8_t*>(p) : CharSize == 2 ? *static_cast<const uint16_t*>(p) : *static_cast<const uint32_t*>(p);
+    }
+
+    static void Store(void* p, Block b) noexcept
+    {
+        if (CharSize == 1) *static_cast<uint8_t*>(p) = static_cast<uint8_t>(b);
+        else if (CharSize == 2) *static_cast<uint16_t*>(p) = static_cast<uint16_t>(b);
+        else *static_cast<uint32_t*>(p) = b;
+    }
+
+    static bool AreEqual(Block a, Block b) noexcept { return a == b; }
+    static bool IsAscii(Block b) noexcept { return b < 0x80; }
+    static Block ToUpper(Block b) noexcept { return b >= 'a' && b <= 'z' ? b - 0x20 : b; }
+    static Block ToLower(Block b) noexcept { return b >= 'A' && b <= 'Z' ? b + 0x20 : b; }
+};
+
+#if PATH_CHAR_BLOCKS_SSE2
+
+template <>
+struct BlockOps<2>
+{
+    typedef __m128i Block;
+    static const size_t Width = 8;
+
+    static Block Load(const void* p) noexcept { return _mm_loadu_si128(static_cast<const __m128i*>(p)); }
+    static void Store(void* p, Block b) noexcept { _mm_storeu_si128(static_cast<__m128i*>(p), b); }
+    static bool AreEqual(Block a, Block b) noexcept { return _mm_movemask_epi8(_mm_cmpeq_epi16(a, b)) == 0xFFFF; }
+
+    static bool IsAscii(Block b) noexcept
+    {
+        return _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(b, _mm_set1_epi16(static_cast<short>(0xFF80))), _mm_setzero_si128())) == 0xFFFF;
+    }
+
+    static Block ToUpper(Block b) noexcept { return _mm_sub_epi16(b, CaseBit(b, 'a', 'z')); }
+    static Block ToLower(Block b) noexcept { return _mm_add_epi16(b, CaseBit(b, 'A', 'Z')); }
+
+private:
+    // 0x20 in every lane holding a character in [first, last], zero elsewhere. Signed comparisons are fine for ASCII.
+    static Block CaseBit(Block b, short first, short last) noexcept
+    {
+        const __m128i inRange = _mm_and_si128(_mm_cmpgt_epi16(b, _mm_set1_epi16(first - 1)), _mm_cmplt_epi16(b, _mm_set1_epi16(last + 1)));
+        return _mm_and_si128(inRange, _mm_set1_epi16(0x20));
+    }
+};
+
+template <>
+struct BlockOps<1>
+{
+    typedef __m128i Block;
+    static const size_t Width = 16;
+
+    static Block Load(const void* p) noexcept { return _mm_loadu_si128(static_cast<const __m128i*>(p)); }
+    static void Store(void* p, Block b) noexcept { _mm_storeu_si128(static_cast<__m128i*>(p), b); }
+    static bool AreEqual(Block a, Block b) noexcept { return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) == 0xFFFF; }
+    static bool IsAscii(Block b) noexcept { return _mm_movemask_epi8(b) == 0; }
+    static Block ToUpper(Block b) noexcept { return _mm_sub_epi8(b, CaseBit(b, 'a', 'z')); }
+    static Block ToLower(Block b) noexcept { return _mm_add_epi8(b, CaseBit(b, 'A', 'Z')); }
+
+private:
+    static Block CaseBit(Block b, char first, char last) noexcept
+    {
+        const __m128i inRange = _mm_and_si128(
+            _mm_cmpgt_epi8(b, _mm_set1_epi8(static_cast<char>(first - 1))),
+            _mm_cmplt_epi8(b, _mm_set1_epi8(static_cast<char>(last + 1))));
+        return _mm_and_si128(inRange, _mm_set1_epi8(0x20));
+    }
+};
+
+#elif PATH_CHAR_BLOCKS_NEON
+
+template <>
+struct BlockOps<2>
+{
+    typedef uint16x8_t Block;
+    static const size_t Width = 8;
+
+    static Block Load(const void* p) noexcept { return vld1q_u16(static_cast<const uint16_t*>(p)); }
+    static void Store(void* p, Block b) noexcept { vst1q_u16(static_cast<uint16_t*>(p), b); }
+    static bool AreEqual(Block a, Block b) noexcept { return vminvq_u16(vceqq_u16(a, b)) == 0xFFFF; }
+    static bool IsAscii(Block b) noexcept { return vmaxvq_u16(b) < 0x80; }
+    static Block ToUpper(Block b) noexcept { return vsubq_u16(b, CaseBit(b, 'a', 'z')); }
+    static Block ToLower(Block b) noexcept { return vaddq_u16(b, CaseBit(b, 'A', 'Z')); }
+
+private:
+    static Block CaseBit(Block b, uint16_t first, uint16_t last) noexcept
+    {
+        const uint16x8_t inRange = vandq_u16(vcgeq_u16(b, vdupq_n_u16(first)), vcleq_u16(b, vdupq_n_u16(last)));
+        return vandq_u16(inRange, vdupq_n_u16(0x20));
+    }
+};
+
+template <>
+struct BlockOps<1>
+{
+    typedef uint8x16_t Block;
+    static const size_t Width = 16;
+
+    static Block Load(const void* p) noexcept { return vld1q_u8(static_cast<const uint8_t*>(p)); }
+    static void Store(void* p, Block b) noexcept { vst1q_u8(static_cast<uint8_t*>(p), b); }
+    static bool AreEqual(Block a, Block b) noexcept { return vminvq_u8(vceqq_u8(a, b)) == 0xFF; }
+    static bool IsAscii(Block b) noexcept { return vmaxvq_u8(b) < 0x80; }
+    static Block ToUpper(Block b) noexcept { return vsubq_u8(b, CaseBit(b, 'a', 'z')); }
+    static Block ToLower(Block b) noexcept { return vaddq_u8(b, CaseBit(b, 'A', 'Z')); }
+
+private:
+    static Block CaseBit(Block b, uint8_t first, uint8_t last) noexcept
+    {
+        const uint8x16_t inRange = vandq_u8(vcgeq_u8(b, vdupq_n_u8(first)), vcleq_u8(b, vdupq_n_u8(last)));
+        return vandq_u8(inRange, vdupq_n_u8(0x20));
+    }
+};
+
+#endif
+
+// Case folding direction of the ASCII fast path. It has to agree with the scalar fold passed alongside it.
+enum class AsciiFold { None, Upper, Lower };
+
+template <typename Ops>
+inline typename Ops::Block FoldBlock(typename Ops::Block b, AsciiFold asciiFold) noexcept
+{
+    return asciiFold == AsciiFold::Upper ? Ops::ToUpper(b) : asciiFold == AsciiFold::Lower ? Ops::ToLower(b) : b;
+}
+
+/// AreFoldedEqual
+///
+/// Whether fold(a[i]) == fold(b[i]) for the first 'length' characters. Both must hold at least 'length' characters.
+template <typename Ch, typename Fold>
+inline bool AreFoldedEqual(const Ch* a, const Ch* b, size_t length, AsciiFold asciiFold, Fold fold) noexcept
+{
+    typedef BlockOps<sizeof(Ch)> Ops;
+
+    size_t i = 0;
+    for (; i + Ops::Width <= length; i += Ops::Width)
+    {
+        const typename Ops::Block blockA = Ops::Load(a + i);
+        const typename Ops::Block blockB = Ops::Load(b + i);
+        if (Ops::AreEqual(blockA, blockB))
+        {
+            continue;
+        }
+
+        if (Ops::IsAscii(blockA) && Ops::IsAscii(blockB))
+        {
+            if (!Ops::AreEqual(FoldBlock<Ops>(blockA, asciiFold), FoldBlock<Ops>(blockB, asciiFold)))
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        for (size_t j = i; j < i + Ops::Width; j++)
+        {
+            if (a[j] != b[j] && fold(a[j]) != fold(b[j]))
+            {
+                return false;
+            }
+        }
+    }
+
+    for (; i < length; i++)
+    {
+        if (a[i] != b[i] && fold(a[i]) != fold(b[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// IsFoldedEqualTo
+///
+/// Whether fold(text[i]) == folded[i] for the first 'length' characters, where 'folded' has already been folded.
+/// Both must hold at least 'length' characters: whole blocks are read from each.
+template <typename Ch, typename Fold>
+inline bool IsFoldedEqualTo(const Ch* text, const Ch* folded, size_t length, AsciiFold asciiFold, Fold fold) noexcept
+{
+    typedef BlockOps<sizeof(Ch)> Ops;
+
+    size_t i = 0;
+    for (; i + Ops::Width <= length; i += Ops::Width)
+    {
+        const typename Ops::Block block = Ops::Load(text + i);
+        if (Ops::IsAscii(block))
+        {
+            // Whatever 'folded' holds, comparing against the folded block is exact.
+            if (!Ops::AreEqual(FoldBlock<Ops>(block, asciiFold), Ops::Load(folded + i)))
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        for (size_t j = i; j < i + Ops::Width; j++)
+        {
+            if (fold(text[j]) != folded[j])
+            {
+                return false;
+            }
+        }
+    }
+
+    for (; i < length; i++)
+    {
+        if (fold(text[i]) != folded[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// FoldInto
+///
+/// Stores fold(text[i]) into destination[i] for the first 'length' characters. The ranges may be the same but must not otherwise overlap.
+template <typename Ch, typename Fold>
+inline void FoldInto(const Ch* text, Ch* destination, size_t length, AsciiFold asciiFold, Fold fold) noexcept
+{
+    typedef BlockOps<sizeof(Ch)> Ops;
+
+    size_t i = 0;
+    for (; i + Ops::Width <= length; i += Ops::Width)
+    {
+        const typename Ops::Block block = Ops::Load(text + i);
+        if (Ops::IsAscii(block))
+        {
+            Ops::Store(destination + i, FoldBlock<Ops>(block, asciiFold));
+            continue;
+        }
+
+        for (size_t j = i; j < i + Ops::Width; j++)
+        {
+            destination[j] = fold(text[j]);
+        }
+    }
+
+    for (; i < length; i++)
+    {
+        destination[i] = fold(text[i]);
+    }
+}
+
+/// FindLastFoldedMismatch
+///
+/// Returns one plus the index of the last character for which fold(a[i]) != fold(b[i]) among the first 'length' ones, or zero if there is none.
+template <typename Ch, typename Fold>
+inline size_t FindLastFoldedMismatch(const Ch* a, const Ch* b, size_t length, AsciiFold asciiFold, Fold fold) noexcept
+{
+    typedef BlockOps<sizeof(Ch)> Ops;
+
+    size_t end = length;
+    for (; end >= Ops::Width; end -= Ops::Width)
+    {
+        const size_t start = end - Ops::Width;
+        const typename Ops::Block blockA = Ops::Load(a + start);
+        const typename Ops::Block blockB = Ops::Load(b + start);
+        if (Ops::AreEqual(blockA, blockB)
+            || (Ops::IsAscii(blockA) && Ops::IsAscii(blockB) && Ops::AreEqual(FoldBlock<Ops>(blockA, asciiFold), FoldBlock<Ops>(blockB, asciiFold))))
+        {
+            continue;
+        }
+
+        for (size_t j = end; j > start; j--)
+        {
+            if (a[j - 1] != b[j - 1] && fold(a[j - 1]) != fold(b[j - 1]))
+            {
+                return j;
+            }
+        }
+    }
+
+    for (; end > 0; end--)
+    {
+        if (a[end - 1] != b[end - 1] && fold(a[end - 1]) != fold(b[end - 1]))
+        {
+            return end;
+        }
+    }
+
+    return 0;
+}
+
+} // namespace PathCharBlocks
+
+#pragma warning( pop )
@@ -0,0 +1,204 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "stdafx.h"
+#include "PathScanner.h"
+#include "StringOperations.h"
+
+// warning C26481: Don't use pointer arithmetic. Use span instead (bounds.1).
+// warning C26446: Prefer to use gsl::at() instead of unchecked subscript operator (bounds.4).
+#pragma warning( disable : 26481 26446 )
+
+// Paths at least this long are never considered normalized; GetFullPathName rejects them.
+#define PATH_SCANNER_MAX_NORMALIZED_LENGTH 32767
+
+#if _WIN32
+static inline PathChar ToUpperAscii(PathChar c) noexcept
+{
+    return c >= 'a' && c <= 'z' ? static_cast<PathChar>(c - ('a' - 'A')) : c;
+}
+
+static bool IsAsciiEqualCaseInsensitively(PCPathChar text, size_t length, const char* expected) noexcept
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        if (expected[i] == 0 || ToUpperAscii(text[i]) != static_cast<PathChar>(expected[i]))
+        {
+            return false;
+        }
+    }
+
+    return expected[length] == 0;
+}
+
+// Whether GetFullPathName may turn a path ending in this component into a device path (e.g. C:\foo\nul.txt -> \\.\nul).
+// This is deliberately conservative: a false positive only costs a regular canonicalization.
+static bool MayBeDosDeviceName(PCPathChar component, size_t length) noexcept
+{
+    // The device name is what precedes the first dot or colon, ignoring trailing spaces.
+    size_t nameLength = 0;
+    while (nameLength < length && component[nameLength] != L'.' && component[nameLength] != L':')
+    {
+        nameLength++;
+    }
+
+    while (nameLength > 0 && component[nameLength - 1] == L' ')
+    {
+        nameLength--;
+    }
+
+    switch (nameLength)
+    {
+        case 3:
+            return IsAsciiEqualCaseInsensitively(component, 3, "CON")
+                || IsAsciiEqualCaseInsensitively(component, 3, "PRN")
+                || IsAsciiEqualCaseInsensitively(component, 3, "AUX")
+                || IsAsciiEqualCaseInsensitively(component, 3, "NUL");
+        case 4:
+            // COM and LPT followed by a digit, including the superscript ones.
+            return (IsAsciiEqualCaseInsensitively(component, 3, "COM") || IsAsciiEqualCaseInsensitively(component, 3, "LPT"))
+                && ((component[3] >= L'0' && component[3] <= L'9') || component[3] == L'\u00B9' || component[3] == L'\u00B2' || component[3] == L'\u00B3');
+        case 6:
+            return IsAsciiEqualCaseInsensitively(component, 6, "CONIN$");
+        case 7:
+            return IsAsciiEqualCaseInsensitively(component, 7, "CONOUT$");
+        default:
+            return false;
+    }
+}
+#endif // _WIN32
+
+// Whether full path canonicalization leaves this component as it is.
+static bool IsNormalizedComponent(PCPathChar component, size_t length) noexcept
+{
+    assert(length > 0);
+
+    if (component[0] == PATH_DOT && (length == 1 || (length == 2 && component[1] == PATH_DOT)))
+    {
+        return false;
+    }
+
+#if _WIN32
+    // Trailing dots and spaces get trimmed.
+    const PathChar last = component[length - 1];
+    if (last == L'.' || last == L' ')
+    {
+        return false;
+    }
+
+    return !MayBeDosDeviceName(component, length);
+#else
+    return true;
+#endif
+}
+
+PathScan ScanPath(PCPathChar path) noexcept
+{
+    assert(path != nullptr);
+
+    PathScan scan;
+    scan.Length = 0;
+    scan.ComponentCount = 0;
+    scan.FirstNewLineIndex = PathScan::NoNewLine;
+    scan.Prefix = IsWin32NtPathName(path)
+        ? PathPrefixKind::Win32Nt
+        : IsLocalDevicePathName(path) ? PathPrefixKind::LocalDevice : PathPrefixKind::None;
+    scan.PrefixLength = scan.Prefix != PathPrefixKind::None ? 4 : 0;
+
+#if _WIN32
+    bool isNormalized = scan.Prefix == PathPrefixKind::None && IsDriveBasedAbsolutePath(path);
+#else
+    bool isNormalized = path[0] == UNIX_DIRECTORY_SEPARATOR;
+#endif
+
+    // Hashes are only worth computing for paths that are used as they are (see PathScan::IsIndexed).
+    const bool isUsedAsIs = scan.Prefix == PathPrefixKind::Win32Nt;
+    bool indexing = isUsedAsIs || isNormalized;
+    DWORD pathHash = Fnv1Basis32;
+    PathComponent* current = nullptr;
+
+    bool inComponent = false;
+    size_t componentStart = 0;
+    size_t i = 0;
+    for (; path[i] != 0; i++)
+    {
+        const PathChar c = path[i];
+        if ((c == '\r' || c == '\n') && scan.FirstNewLineIndex == PathScan::NoNewLine)
+        {
+            scan.FirstNewLineIndex = i;
+        }
+
+        PathChar normalized = c;
+        if (indexing)
+        {
+            normalized = NormalizePathChar(c);
+            pathHash = FoldPathHash(pathHash, normalized);
+        }
+
+        if (i < scan.PrefixLength)
+        {
+            continue;
+        }
+
+        if (!IsDirectorySeparator(c))
+        {
+            if (!inComponent)
+            {
+                inComponent = true;
+                componentStart = i;
+
+                // Too many components for the scan to index: IndexedPath does it.
+                indexing = indexing && scan.ComponentCount < PathScan::MaxComponents;
+                if (indexing)
+                {
+                    current = &scan.Components[scan.ComponentCount];
+                    current->Start = static_cast<uint32_t>(i);
+                    current->Length = 0;
+                    current->Hash = Fnv1Basis32;
+                }
+
+                scan.ComponentCount++;
+            }
+
+            if (indexing)
+            {
+                current->Length++;
+                current->Hash = FoldPathHash(current->Hash, normalized);
+                current->PathHash = pathHash;
+            }
+
+            continue;
+        }
+
+        if (c != PREFERRED_DIRECTORY_SEPARATOR)
+        {
+            isNormalized = false;
+        }
+
+        if (inComponent)
+        {
+            isNormalized = isNormalized && IsNormalizedComponent(path + componentStart, i - componentStart);
+            inComponent = false;
+        }
+        else if (i > 0)
+        {
+            // Repeated separator.
+            isNormalized = false;
+        }
+
+        indexing = indexing && (isUsedAsIs || isNormalized);
+    }
+
+    if (inComponent)
+    {
+        isNormalized = isNormalized && IsNormalizedComponent(path + componentStart, i - componentStart);
+    }
+
+    scan.Length = i;
+    scan.EndsWithSeparator = i > 0 && IsDirectorySeparator(path[i - 1]);
+    scan.IsNormalized = isNormalized && i < PATH_SCANNER_MAX_NORMALIZED_LENGTH;
+    scan.IsIndexed = indexing && (isUsedAsIs || scan.IsNormalized);
+    scan.Hash = pathHash;
+
+    return scan;
+}
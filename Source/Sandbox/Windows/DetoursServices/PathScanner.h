@@ -0,0 +1,81 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+
+#include "DataTypes.h"
+
+// Kind of prefix a path starts with, as far as canonicalization is concerned.
+enum class PathPrefixKind {
+    // No prefix that changes how the path is interpreted.
+    None,
+
+    // \\?\ or \??\, which escape Win32 -> NT path canonicalization.
+    Win32Nt,
+
+    // \\.\, the local device namespace.
+    LocalDevice,
+};
+
+// A path component: a maximal run of non-separator characters.
+struct PathComponent {
+    // Offset of the first character of the component in the path.
+    uint32_t Start;
+
+    // Number of characters in the component. Never zero.
+    uint32_t Length;
+
+    // HashPath of the component alone. This is the hash the file access manifest uses for its records.
+    DWORD Hash;
+
+    // HashPath of the path up to and including this component.
+    DWORD PathHash;
+
+    uint32_t End() const noexcept { return Start + Length; }
+};
+
+// Facts about a path gathered in a single pass over its characters, so that canonicalization, indexing (see IndexedPath)
+// and reporting do not each need their own pass.
+struct PathScan {
+    // Most components a scan indexes. Longer paths are indexed by IndexedPath itself.
+    static const size_t MaxComponents = 32;
+
+    // Number of characters, not including the null terminator.
+    size_t Length;
+
+    PathPrefixKind Prefix;
+
+    // Number of characters taken by the prefix (e.g. 4 for \\?\C:\foo).
+    size_t PrefixLength;
+
+    // Number of maximal runs of non-separator characters after the prefix.
+    size_t ComponentCount;
+
+    // Index of the first \r or \n, which have to be escaped in reports, or NoNewLine if there is none.
+    size_t FirstNewLineIndex;
+    static const size_t NoNewLine = static_cast<size_t>(-1);
+
+    bool EndsWithSeparator;
+
+    // Whether the path is absolute and already in the form full path canonicalization would produce: only preferred separators,
+    // none of them repeated, no . or .. components, and (on Windows) no component that GetFullPathName would trim or
+    // turn into a device. Such a path is its own canonical form. A false value only means the path has to go through the
+    // regular canonicalization.
+    bool IsNormalized;
+
+    // Whether Hash and Components cover the whole path. The scan only hashes paths that are used as they are (normalized or
+    // Win32Nt prefixed ones, see CanonicalizedPath::Canonicalize), and stops as soon as it finds out a path is not one of them,
+    // because any other path gets rewritten and scanned again.
+    bool IsIndexed;
+
+    // HashPath of the whole path. Only valid if IsIndexed.
+    DWORD Hash;
+
+    // The components of the path, with their hashes. Only valid if IsIndexed.
+    PathComponent Components[MaxComponents];
+
+    bool ContainsNewLine() const noexcept { return FirstNewLineIndex != NoNewLine; }
+};
+
+// Scans a null-terminated path.
+PathScan ScanPath(PCPathChar path) noexcept;
@@ -171,6 +171,11 @@ void PathTree::RetrieveAndRemoveAllDescendants(const std::wstring& path, TreeNod
     node->children.clear();
 }
 
+void PathTree::Clear()
+{
+    RemoveAllDescendants(m_root);
+}
+
 void PathTree::RemoveAllDescendants(TreeNode* node)
 {
     const auto remove = [this](std::pair<std::wstring, TreeNode*>* iter)
@@ -31,6 +31,9 @@ public:
     // Check Public\Src\Sandbox\Windows\UnitTests\PathTreeTests.cpp for additional examples and expected behavior
     EXPORT void RetrieveAndRemoveAllDescendants(const std::wstring& path, std::vector<std::wstring>& descendants);
 
+    // Removes every path from the tree
+    EXPORT void Clear();
+
     EXPORT PathTree();
     EXPORT ~PathTree();
 
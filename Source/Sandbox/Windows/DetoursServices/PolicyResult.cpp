@@ -6,9 +6,12 @@
 #include "SendReport.h"
 #include "FilesCheckedForAccess.h"
 
+const CanonicalizedPathType PolicyResult::s_nullPath;
+const PolicySearchCursor PolicyResult::s_nullCursor;
+
 bool PolicyResult::Initialize(PCPathChar path)
 {
-    assert(m_isIndeterminate);
+    assert(IsIndeterminate());
     assert(path);
 
     CanonicalizedPathType canonicalizedPath = CanonicalizedPath::Canonicalize(path);
@@ -23,60 +26,106 @@ bool PolicyResult::Initialize(PCPathChar path)
 
 void PolicyResult::Initialize(CanonicalizedPathType const& canonicalizedPath)
 {
-    // Initializing from a canonicalized path without a cursor; use the global tree root as the start cursor, and the entire path (without the type prefix)
+    // Initializing from a canonicalized path without a cursor; use the root of the current manifest tree as the start cursor, and the entire path (without the type prefix)
     // as the search 'suffix' (we aren't resuming a search - we are starting a new one).
     // For reporting it is important that we preserve the \\?\ or \??\ prefix; \\?\C: and C: are different!
     // The former refers to a device. The other is drive-relative (based on current directory of that drive).
     // But for evaluating special cases and traversing the manifest tree, we strip the prefix (the tree shouldn't have \\?\ in it for example).
-    InitializeFromCursor(canonicalizedPath, g_manifestTreeRoot, nullptr);
+    //
+    // The outcome of such a search only depends on the path and the manifest, so it is shared with every other result for the same path
+    // under the same manifest generation. The generation is the one the current operation started under.
+    ManifestGeneration::Ref manifest = OperationManifest::Get();
+    PolicySnapshotCache* snapshotCache = PolicySnapshotCache::GetInstance();
+    m_snapshot = snapshotCache->TryGet(canonicalizedPath, manifest.Get());
+    if (!m_snapshot) {
+        InitializeFromCursor(manifest, canonicalizedPath, manifest ? manifest->GetRoot() : nullptr, nullptr);
+        snapshotCache->Add(m_snapshot);
+    }
 }
 
-void PolicyResult::InitializeFromCursor(CanonicalizedPathType const& canonicalizedPath, PolicySearchCursor const& policySearchCursor, PCPathChar const searchSuffix)
+void PolicyResult::InitializeFromCursor(
+    ManifestGeneration::Ref const& manifest,
+    CanonicalizedPathType const& canonicalizedPath,
+    PolicySearchCursor const& policySearchCursor,
+    PCPathChar const searchSuffix)
 {
-    assert(m_isIndeterminate);
-    assert(m_canonicalizedPath.IsNull());
+    assert(IsIndeterminate());
     assert(!canonicalizedPath.IsNull());
 
     // The path is already canonicalized; now we are committed to set a policy, which doesn't fail.
     // We will do so via special-case rules (no policy search or cursor) or via the policy tree (which is searched, producing a cursor).
-    m_canonicalizedPath = canonicalizedPath;
-
-    TranslateFilePath(std::wstring(canonicalizedPath.GetPathString()), m_translatedPath);
-    wchar_t const* translatedSearchSuffix = searchSuffix != nullptr ? searchSuffix : GetTranslatedPathWithoutTypePrefix();
-    size_t searchSuffixLength = wcslen(translatedSearchSuffix);
+    wchar_t const* pathString = canonicalizedPath.GetPathString();
+    size_t pathLength = canonicalizedPath.Length();
+
+    // Without translations the translated path is the canonicalized path itself, so the search can walk the component index
+    // that came with the canonicalized path rather than tokenize and hash the path again.
+    bool isTranslationIdentity = g_pManifestTranslatePathTuples->empty();
+    std::wstring translatedPath;
+    TranslateFilePath(canonicalizedPath, translatedPath);
+
+    // A search suffix always points into the canonicalized path (see GetPolicyForSubpath).
+    bool isSuffixOfPath = searchSuffix != nullptr && searchSuffix >= pathString && searchSuffix <= pathString + pathLength;
+    wchar_t const* translatedSearchSuffix = searchSuffix != nullptr
+        ? searchSuffix
+        : translatedPath.c_str() + (canonicalizedPath.GetPathStringWithoutTypePrefix() - pathString);
+    size_t searchSuffixLength;
+
+    PolicySearchCursor newCursor;
+    if (isSuffixOfPath || (searchSuffix == nullptr && isTranslationIdentity)) {
+        size_t searchStartIndex = isSuffixOfPath
+            ? static_cast<size_t>(searchSuffix - pathString)
+            : static_cast<size_t>(canonicalizedPath.GetPathStringWithoutTypePrefix() - pathString);
+        searchSuffixLength = pathLength - searchStartIndex;
+
+        size_t firstComponent = canonicalizedPath.FindFirstComponentStartingAt(searchStartIndex);
+        newCursor = FindFileAccessPolicyInTreeEx(
+            policySearchCursor,
+            pathString,
+            pathLength,
+            searchStartIndex,
+            canonicalizedPath.GetComponents() + firstComponent,
+            canonicalizedPath.ComponentCount() - firstComponent);
+    }
+    else {
+        searchSuffixLength = wcslen(translatedSearchSuffix);
+        newCursor = FindFileAccessPolicyInTreeEx(policySearchCursor, translatedSearchSuffix, searchSuffixLength);
+    }
 
-    PolicySearchCursor newCursor = FindFileAccessPolicyInTreeEx(policySearchCursor, translatedSearchSuffix, searchSuffixLength);
-    Initialize(canonicalizedPath, newCursor);
+    FileAccessPolicy policy = GetPolicyFromCursor(newCursor);
 
-    if (GetSpecialCaseRulesForWindows(translatedSearchSuffix, searchSuffixLength, /*out*/ m_policy)) 
+    if (GetSpecialCaseRulesForWindows(translatedSearchSuffix, searchSuffixLength, /*out*/ policy)) 
     {
 #if SUPER_VERBOSE
         Dbg(L"match (special case rules for Windows): %s - policySearchCursor: %x, searchSuffix: %s", canonicalizedPath.GetPathString(), policySearchCursor, searchSuffix);
 #endif // SUPER_VERBOSE
     }
-    else if (GetSpecialCaseRulesForCoverageAndSpecialDevices(translatedSearchSuffix, searchSuffixLength, canonicalizedPath.Type, /*out*/ m_policy)) {
+    else if (GetSpecialCaseRulesForCoverageAndSpecialDevices(translatedSearchSuffix, searchSuffixLength, canonicalizedPath.Type, /*out*/ policy)) {
 #if SUPER_VERBOSE
         Dbg(L"match (special case rules for coverage and special devices): %s - policySearchCursor: %x, searchSuffix: %s", canonicalizedPath.GetPathString(), policySearchCursor, searchSuffix);
 #endif // SUPER_VERBOSE
     }
-    else if (GetSpecialCaseRulesForSpecialTools(translatedSearchSuffix, searchSuffixLength, /*out*/ m_policy))
+    else if (GetSpecialCaseRulesForSpecialTools(translatedSearchSuffix, searchSuffixLength, /*out*/ policy))
     {
 #if SUPER_VERBOSE
             Dbg(L"match (special case rules for special tools): %s - policySearchCursor: %x, searchSuffix: %s", canonicalizedPath.GetPathString(), policySearchCursor, searchSuffix);
 #endif // SUPER_VERBOSE
     }
+
+    m_snapshot = PolicySnapshot::Create(manifest, canonicalizedPath, newCursor, policy, translatedPath);
 }
 
 PolicyResult PolicyResult::GetPolicyForSubpath(wchar_t const* pathSuffix) const {
-    assert(!m_isIndeterminate);
-    assert(!m_canonicalizedPath.IsNull());
+    assert(!IsIndeterminate());
+    assert(!GetCanonicalizedPath().IsNull());
 
     size_t extensionStartIndex = 0;
-    CanonicalizedPathType extendedPath = m_canonicalizedPath.Extend(pathSuffix, &extensionStartIndex);
+    CanonicalizedPathType extendedPath = GetCanonicalizedPath().Extend(pathSuffix, &extensionStartIndex);
 
+    // Special case rules only see the suffix of a resumed search, so the outcome is not necessarily the one Initialize would get
+    // for the extended path, and the snapshot is not shared through the PolicySnapshotCache.
     PolicyResult subpolicy;
-    if (m_policySearchCursor.IsValid()) {
-        subpolicy.InitializeFromCursor(extendedPath, m_policySearchCursor, &extendedPath.GetPathString()[extensionStartIndex]);
+    if (GetPolicySearchCursor().IsValid()) {
+        subpolicy.InitializeFromCursor(m_snapshot->GetManifest(), extendedPath, GetPolicySearchCursor(), &extendedPath.GetPathString()[extensionStartIndex]);
     }
     else {
         subpolicy.Initialize(extendedPath);
@@ -109,7 +158,7 @@ void PolicyResult::ReportIndeterminatePolicyAndSetLastError(FileOperationContext
 
 bool PolicyResult::AllowWrite(bool basedOnlyOnPolicy) const {
 
-    bool isWriteAllowedByPolicy = (m_policy & FileAccessPolicy_AllowWrite) != 0;
+    bool isWriteAllowedByPolicy = (GetPolicy() & FileAccessPolicy_AllowWrite) != 0;
 
     // Send a special message to managed code if the policy to override allowed writes based on file existence is set
     // and the write is allowed by policy (for the latter, if the write is denied, there is nothing to override)
@@ -120,7 +169,7 @@ bool PolicyResult::AllowWrite(bool basedOnlyOnPolicy) const {
         // But for the current process it will avoid probing the file system over and over for the same path.
         FilesCheckedForAccess* filesCheckedForWriteAccess = FilesCheckedForAccess::GetInstance();
 
-        if (filesCheckedForWriteAccess->TryRegisterPath(m_canonicalizedPath)) {
+        if (filesCheckedForWriteAccess->TryRegisterPath(GetCanonicalizedPath())) {
             DWORD error = GetLastError();
 
             // Our ultimate goal is to understand if the path represents a file that was there before the pip started (and therefore blocked for writes).
@@ -129,7 +178,7 @@ bool PolicyResult::AllowWrite(bool basedOnlyOnPolicy) const {
             // So what we do is just to emit a special report line with the information of whether the access should be allowed or not, based on existence, from
             // the perspective of the running process. These special report lines are then processed outside of detours to determine the real first write attempt
             // Observe this implies that in this case we never block accesses on detours based on file existence, but generate a DFA on managed code
-            bool fileExists = ExistsAsFile(m_canonicalizedPath.GetPathString());
+            bool fileExists = ExistsAsFile(GetCanonicalizedPath().GetPathString());
 
             FileOperationContext operationContext = 
                 FileOperationContext::CreateForRead(L"FirstAllowWriteCheckInProcess", this->GetCanonicalizedPath().GetPathString());
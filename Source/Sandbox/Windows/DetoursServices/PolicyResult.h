@@ -11,6 +11,7 @@
 
 #if _WIN32
     #include "CanonicalizedPath.h"
+    #include "PolicySnapshot.h"
     typedef CanonicalizedPath CanonicalizedPathType;
 #else // _WIN32
     typedef std::string CanonicalizedPathType;
@@ -24,6 +25,16 @@
 class PolicyResult
 {
 private:
+#if _WIN32
+    // Everything determined for the path: the path itself, its translation, the policy search cursor and the effective policy.
+    // Shared by all copies of this result, and by later results for the same path (see PolicySnapshotCache).
+    // Null iff this is an invalid policy result (Initialize not called, or it failed).
+    PolicySnapshot::Ref m_snapshot;
+
+    // Path and cursor reported by an invalid policy result.
+    static const CanonicalizedPathType s_nullPath;
+    static const PolicySearchCursor s_nullCursor;
+#else
     CanonicalizedPathType m_canonicalizedPath;
 
     // Effective policy. If m_policySearchCursor is valid, this should agree;
@@ -33,25 +44,19 @@ private:
 
     // Indicates if this is an invalid policy result (Initialize not called, or it failed).
     bool m_isIndeterminate;
+#endif // _WIN32
 
-public:
-    // Assumes that the search was already performed and that `cursor` is pointing
-    // to the correct ManifestRecord node.
-    //
-    // It doesn't perform any additional policy search, it simply initializes the
-    // following state: m_canonicalizedPath, m_policy, m_policySearchCursor.; it
-    // also sets m_isIndeterminate to false.
-    //
-    // It does check the cursor to see if the search was truncated, and if so clears
-    // the `FileAccessPolicy_ExactPathPolicies` bits in the stored `m_policy` field.
-    void Initialize(CanonicalizedPathType path, PolicySearchCursor cursor);
+    // Effective policy of a search that ended at `cursor`: if the search was truncated, the cone policy of the
+    // record it stopped at (i.e., without the `FileAccessPolicy_ExactPathPolicies` bits); otherwise its node policy.
+    static FileAccessPolicy GetPolicyFromCursor(PolicySearchCursor const& cursor);
 
+public:
     PolicyResult(const PolicyResult& other) = default;
     PolicyResult& operator=(const PolicyResult&) = default;
 
 #if _WIN32
-    CanonicalizedPathType Path() const        { return m_canonicalizedPath; }
-    size_t PathLength() const                 { return m_canonicalizedPath.Length(); }
+    CanonicalizedPathType Path() const        { return GetCanonicalizedPath(); }
+    size_t PathLength() const                 { return GetCanonicalizedPath().Length(); }
 #else
     PCPathChar Path() const                   { return m_canonicalizedPath.c_str(); }
     size_t PathLength() const                 { return m_canonicalizedPath.length(); }
@@ -60,36 +65,24 @@ public:
 #if _WIN32
 
 private:
-    // Result of path translation.
-    std::wstring m_translatedPath;
-
     /// Checks the file access manifest to determine a policy for the given already-canonicalized path.
     /// The policy search is resumed from the given cursor, applying searchSuffix. The path generating policySearchCursor combined with searchSuffix
     /// must be equivalent to canonicalizedPath (we are avoiding wasted work in re-traversing some prefix of canonicalizedPath in the policy tree).
-    void InitializeFromCursor(CanonicalizedPathType const& canonicalizedPath, PolicySearchCursor const& policySearchCursor, PCPathChar const searchSuffix);
+    /// The cursor points into the tree of the given manifest generation.
+    void InitializeFromCursor(
+        ManifestGeneration::Ref const& manifest,
+        CanonicalizedPathType const& canonicalizedPath,
+        PolicySearchCursor const& policySearchCursor,
+        PCPathChar const searchSuffix);
 
-public:
-    PolicyResult()
-        : m_canonicalizedPath(),
-        m_policy((FileAccessPolicy)0), m_policySearchCursor(),
-        m_isIndeterminate(true) // Note that until Initialize is called, we are indeterminate.
-    {
-    }
+    PolicySearchCursor const& GetPolicySearchCursor() const { return m_snapshot ? m_snapshot->GetCursor() : s_nullCursor; }
 
-    PolicyResult(PolicyResult&& other)
-        : m_canonicalizedPath(std::move(other.m_canonicalizedPath)),
-        m_policy(other.m_policy), m_policySearchCursor(other.m_policySearchCursor),
-        m_isIndeterminate(other.m_isIndeterminate),
-        m_translatedPath(other.m_translatedPath)
-    {
-        other.m_isIndeterminate = true;
-        other.m_policy = (FileAccessPolicy)0;
-        other.m_policySearchCursor = PolicySearchCursor();
-        other.m_translatedPath.clear();
+public:
+    // Note that until Initialize is called, we are indeterminate.
+    PolicyResult() = default;
 
-        assert(other.m_canonicalizedPath.Type == PathType::Null);
-        assert(other.m_policySearchCursor.Record == nullptr);
-    }
+    // Leaves `other` indeterminate.
+    PolicyResult(PolicyResult&& other) = default;
 
     /// Checks the file access manifest to determine a policy for the given path (not yet canonicalized).
     ///
@@ -105,29 +98,48 @@ public:
     // TODO: This is a poorly exercised and very exceptional path; for simplicity consider throwing (failfast exception?)
     void ReportIndeterminatePolicyAndSetLastError(FileOperationContext const& fileOperationContext) const;
 
-    PCPathChar GetTranslatedPath() const { return m_translatedPath.c_str(); }
+    PCPathChar GetTranslatedPath() const { return m_snapshot ? m_snapshot->GetTranslatedPath() : L""; }
 
     PCPathChar GetTranslatedPathWithoutTypePrefix() const {
-        switch (m_canonicalizedPath.Type) {
+        switch (GetCanonicalizedPath().Type) {
             case PathType::Null:
                 return nullptr;
             case PathType::Win32:
-                return m_translatedPath.c_str();
+                return GetTranslatedPath();
             case Win32Nt:
             case LocalDevice:
-                return m_translatedPath.c_str() + 4;
+                return GetTranslatedPath() + 4;
             default:
                 assert(false);
                 return nullptr;
         }
     }
+
+    CanonicalizedPathType const& GetCanonicalizedPath() const { return m_snapshot ? m_snapshot->GetPath() : s_nullPath; }
+    FileAccessPolicy GetPolicy() const { return m_snapshot ? m_snapshot->GetPolicy() : (FileAccessPolicy)0; }
+
+    // Indicates if this policy is invalid (iff Initialize did not complete successfully or has not been called).
+    bool IsIndeterminate() const { return !m_snapshot; }
 #else // _WIN32
 
 private:
     FileAccessManifestFlag m_famFlag;
     FileAccessManifestExtraFlag m_famExtraFlag;
 
+    PolicySearchCursor const& GetPolicySearchCursor() const { return m_policySearchCursor; }
+
 public:
+    // Assumes that the search was already performed and that `cursor` is pointing
+    // to the correct ManifestRecord node.
+    //
+    // It doesn't perform any additional policy search, it simply initializes the
+    // following state: m_canonicalizedPath, m_policy, m_policySearchCursor.; it
+    // also sets m_isIndeterminate to false.
+    //
+    // It does check the cursor to see if the search was truncated, and if so clears
+    // the `FileAccessPolicy_ExactPathPolicies` bits in the stored `m_policy` field.
+    void Initialize(CanonicalizedPathType path, PolicySearchCursor cursor);
+
     PolicyResult(FileAccessManifestFlag famFlag, FileAccessManifestExtraFlag famExtraFlag)
         : m_famFlag(famFlag), m_isIndeterminate(true), m_famExtraFlag(famExtraFlag)
     {
@@ -146,6 +158,11 @@ public:
     #define GEN_CHECK_FAM_EXTRA_FLAG_FUNC(flag_name, flag_value) inline bool flag_name() const { return Check##flag_name(m_famExtraFlag); }
     FOR_ALL_FAM_EXTRA_FLAGS(GEN_CHECK_FAM_EXTRA_FLAG_FUNC)
 
+    CanonicalizedPathType const& GetCanonicalizedPath() const { return m_canonicalizedPath; }
+    FileAccessPolicy GetPolicy() const { return m_policy; }
+
+    // Indicates if this policy is invalid (iff Initialize did not complete successfully or has not been called).
+    bool IsIndeterminate() const { return m_isIndeterminate; }
 #endif // _WIN32
 
     // Performs an access check for a read-access, based on dynamically-observed read context (existence, etc.)
@@ -172,30 +189,25 @@ public:
     // Determines a policy result for the combined path GetCanonicalizedPath() + pathSuffix.
     PolicyResult GetPolicyForSubpath(wchar_t const* pathSuffix) const;
 
-    CanonicalizedPathType const& GetCanonicalizedPath() const { return m_canonicalizedPath; }
-
-    bool AllowRead() const { return (m_policy & FileAccessPolicy_AllowRead) != 0; }
-    bool AllowReadIfNonexistent() const { return (m_policy & FileAccessPolicy_AllowReadIfNonExistent) != 0; }
+    bool AllowRead() const { return (GetPolicy() & FileAccessPolicy_AllowRead) != 0; }
+    bool AllowReadIfNonexistent() const { return (GetPolicy() & FileAccessPolicy_AllowReadIfNonExistent) != 0; }
     bool AllowWrite(bool basedOnlyOnPolicy) const;
-    bool AllowSymlinkCreation() const { return (m_policy & FileAccessPolicy_AllowSymlinkCreation) != 0; }
-    bool AllowCreateDirectory() const { return (m_policy & FileAccessPolicy_AllowCreateDirectory) != 0; }
-    bool AllowRealInputTimestamps() const { return (m_policy & FileAccessPolicy_AllowRealInputTimestamps) != 0; }
-    bool OverrideAllowWriteForExistingFiles() const { return (m_policy & FileAccessPolicy_OverrideAllowWriteForExistingFiles) != 0; }
-    bool ReportUsnAfterOpen() const { return (m_policy & FileAccessPolicy_ReportUsnAfterOpen) != 0; }
-    bool ReportDirectoryEnumeration() const { return (m_policy & FileAccessPolicy_ReportDirectoryEnumerationAccess) != 0; }
-    bool IndicateUntracked() const { return ((m_policy & FileAccessPolicy_AllowAll) == FileAccessPolicy_AllowAll) && ((m_policy & FileAccessPolicy_ReportAccess) == 0); }
-    bool TreatDirectorySymlinkAsDirectory() const { return (m_policy & FileAccessPolicy_TreatDirectorySymlinkAsDirectory) != 0; }
-    bool EnableFullReparsePointParsing() const { return (m_policy & FileAccessPolicy_EnableFullReparsePointParsing) != 0; }
-    DWORD GetPathId() const { return m_policySearchCursor.IsValid() ? m_policySearchCursor.Record->GetPathId() : 0; }
-    FileAccessPolicy GetPolicy() const { return m_policy; }
-    USN GetExpectedUsn() const { return m_policySearchCursor.GetExpectedUsn(); }
-    // Indicates if this policy is invalid (iff Initialize did not complete successfully or has not been called).
-    bool IsIndeterminate() const { return m_isIndeterminate; }
+    bool AllowSymlinkCreation() const { return (GetPolicy() & FileAccessPolicy_AllowSymlinkCreation) != 0; }
+    bool AllowCreateDirectory() const { return (GetPolicy() & FileAccessPolicy_AllowCreateDirectory) != 0; }
+    bool AllowRealInputTimestamps() const { return (GetPolicy() & FileAccessPolicy_AllowRealInputTimestamps) != 0; }
+    bool OverrideAllowWriteForExistingFiles() const { return (GetPolicy() & FileAccessPolicy_OverrideAllowWriteForExistingFiles) != 0; }
+    bool ReportUsnAfterOpen() const { return (GetPolicy() & FileAccessPolicy_ReportUsnAfterOpen) != 0; }
+    bool ReportDirectoryEnumeration() const { return (GetPolicy() & FileAccessPolicy_ReportDirectoryEnumerationAccess) != 0; }
+    bool IndicateUntracked() const { return ((GetPolicy() & FileAccessPolicy_AllowAll) == FileAccessPolicy_AllowAll) && ((GetPolicy() & FileAccessPolicy_ReportAccess) == 0); }
+    bool TreatDirectorySymlinkAsDirectory() const { return (GetPolicy() & FileAccessPolicy_TreatDirectorySymlinkAsDirectory) != 0; }
+    bool EnableFullReparsePointParsing() const { return (GetPolicy() & FileAccessPolicy_EnableFullReparsePointParsing) != 0; }
+    DWORD GetPathId() const { return GetPolicySearchCursor().IsValid() ? GetPolicySearchCursor().Record->GetPathId() : 0; }
+    USN GetExpectedUsn() const { return GetPolicySearchCursor().GetExpectedUsn(); }
 
     // d: is level 0, d:\office is level 1, d:\office\dev is level 2, etc...
     // Level of a policy search cursor refers to the level of the remainder of the path after this policyresult.
     // To find the level including this policy result, we subtract 1
-    size_t Level() const { return m_policySearchCursor.Level -1; }
+    size_t Level() const { return GetPolicySearchCursor().Level -1; }
 
     // Given a file access policy to search for, search from this policy result through parents to find the lowest level at which the given file access policy is detected consecutively.
     // All parents from the given policy result's level through to the returned level inclusive must have fileAccessPolicy set.
@@ -206,14 +218,14 @@ public:
     size_t FindLowestConsecutiveLevelThatStillHasProperty(const FileAccessPolicy fileAccessPolicy) const
     {
         size_t first_level = 0;
-        if ((m_policy & fileAccessPolicy) != 0)
+        if ((GetPolicy() & fileAccessPolicy) != 0)
         {
-            if (m_policy & fileAccessPolicy)
+            if (GetPolicy() & fileAccessPolicy)
             {
                 first_level = Level();
             }
 
-            PolicySearchCursor::PPolicySearchCursor parent = m_policySearchCursor.Parent;
+            PolicySearchCursor::PPolicySearchCursor parent = GetPolicySearchCursor().Parent;
             while (parent != nullptr)
             {
                 if ((parent->Record->GetConePolicy() & fileAccessPolicy) != 0)
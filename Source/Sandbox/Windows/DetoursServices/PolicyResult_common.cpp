@@ -36,20 +36,27 @@ PathValidity ProbePathForValidity(CanonicalizedPathType canonicalizedPath) {
     return PathValidity::Valid; // Optimism!
 }
 
+FileAccessPolicy PolicyResult::GetPolicyFromCursor(PolicySearchCursor const& cursor)
+{
+    assert(cursor.IsValid());
+
+    // If the search for policy was truncated, we do not have an explicit policy in the manifest for the current path. In that case, the policy is defined 
+	// by the last (directory) node that was found on the tree while looking for the full path. This is the cone policy.
+    // So if the search was truncated, the policy to apply is the cone policy. Otherwise, it is the node policy.
+	return cursor.SearchWasTruncated ? cursor.Record->GetConePolicy() : cursor.Record->GetNodePolicy();
+}
+
+#if !_WIN32
 void PolicyResult::Initialize(CanonicalizedPathType path, PolicySearchCursor cursor)
 {
     assert(IsIndeterminate());
-    assert(cursor.IsValid());
 
     m_isIndeterminate = false;
     m_canonicalizedPath = path;
     m_policySearchCursor = cursor;
-
-    // If the search for policy was truncated, we do not have an explicit policy in the manifest for the current path. In that case, the policy is defined 
-	// by the last (directory) node that was found on the tree while looking for the full path. This is the cone policy.
-    // So if the search was truncated, the policy to apply is the cone policy. Otherwise, it is the node policy.
-	m_policy = m_policySearchCursor.SearchWasTruncated ? m_policySearchCursor.Record->GetConePolicy() : m_policySearchCursor.Record->GetNodePolicy();
+    m_policy = GetPolicyFromCursor(cursor);
 }
+#endif // !_WIN32
 
 AccessCheckResult PolicyResult::CheckReadAccess(RequestedReadAccess readAccessRequested, FileReadContext const& context) const
 {
@@ -101,8 +108,8 @@ AccessCheckResult PolicyResult::CheckReadAccess(RequestedReadAccess readAccessRe
     // When ExplicitlyReportDirectoryProbes is set, if the request access is a probe then explicitly report it
     // When ExplicitlyReportDirectoryProbes is not set, do not explicitly report any operations on directories (context.OpenedDirectory)
     bool explicitReport = ((ExplicitlyReportDirectoryProbes() && accessRequested == RequestedAccess::Probe) || !context.OpenedDirectory) &&
-        ((exists && ((m_policy & FileAccessPolicy::FileAccessPolicy_ReportAccessIfExistent) != 0)) ||
-         (!exists && ((m_policy & FileAccessPolicy::FileAccessPolicy_ReportAccessIfNonExistent) != 0)));
+        ((exists && ((GetPolicy() & FileAccessPolicy::FileAccessPolicy_ReportAccessIfExistent) != 0)) ||
+         (!exists && ((GetPolicy() & FileAccessPolicy::FileAccessPolicy_ReportAccessIfNonExistent) != 0)));
 
     ReportLevel reportLevel = explicitReport 
         ? ReportLevel::ReportExplicit 
@@ -124,7 +131,7 @@ AccessCheckResult PolicyResult::CreateAccessCheckResult(ResultAction result, Rep
     PathValidity pathValidity = PathValidity::Valid;
 
     if (result != ResultAction::Allow) {
-        pathValidity = ProbePathForValidity(m_canonicalizedPath);
+        pathValidity = ProbePathForValidity(GetCanonicalizedPath());
         switch (pathValidity)
         {
             case PathValidity::Valid:
@@ -153,7 +160,7 @@ AccessCheckResult PolicyResult::CreateAccessCheckResult(bool isAllowed) const
         ? ResultAction::Allow
         : (FailUnexpectedFileAccesses() ? ResultAction::Deny : ResultAction::Warn);
 
-    ReportLevel reportLevel = ((m_policy & FileAccessPolicy::FileAccessPolicy_ReportAccess) != 0)
+    ReportLevel reportLevel = ((GetPolicy() & FileAccessPolicy::FileAccessPolicy_ReportAccess) != 0)
         ? ReportLevel::ReportExplicit
         : (ReportAnyAccess(result != ResultAction::Allow) ? ReportLevel::Report : ReportLevel::Ignore);
 
@@ -176,7 +183,7 @@ AccessCheckResult PolicyResult::CheckDirectoryAccess(bool enforceCreationAccess)
 #if !(_WIN32) && !(MAC_OS_SANDBOX) && !(MAC_OS_LIBRARY)
 bool PolicyResult::AllowWrite(bool basedOnlyOnPolicy) const {
 
-    bool isWriteAllowedByPolicy = (m_policy & FileAccessPolicy_AllowWrite) != 0;
+    bool isWriteAllowedByPolicy = (GetPolicy() & FileAccessPolicy_AllowWrite) != 0;
 
     // Send a special message to managed code if the policy to override allowed writes based on file existence is set
     // and the write is allowed by policy (for the latter, if the write is denied, there is nothing to override)
@@ -187,7 +194,7 @@ bool PolicyResult::AllowWrite(bool basedOnlyOnPolicy) const {
         // But for the current process it will avoid probing the file system over and over for the same path.
         FilesCheckedForAccess* filesCheckedForWriteAccess = FilesCheckedForAccess::GetInstance();
 
-        if (filesCheckedForWriteAccess->TryRegisterPath(m_canonicalizedPath)) {
+        if (filesCheckedForWriteAccess->TryRegisterPath(GetCanonicalizedPath())) {
             // Our ultimate goal is to understand if the path represents a file that was there before the pip started (and therefore blocked for writes).
             // The existence of the file on disk before the first time the file is written will tell us that. But the problem is that knowing when is the first
             // time is not trivial: it involves sharing information across child processes.
@@ -203,6 +210,6 @@ bool PolicyResult::AllowWrite(bool basedOnlyOnPolicy) const {
 #elif !(_WIN32)
 bool PolicyResult::AllowWrite(bool) const 
 {
-    return (m_policy & FileAccessPolicy_AllowWrite) != 0;
+    return (GetPolicy() & FileAccessPolicy_AllowWrite) != 0;
 }
 #endif
\ No newline at end of file
@@ -107,6 +107,56 @@ PolicySearchCursor FindFileAccessPolicyInTreeEx(
     return FindFileAccessPolicyInTreeEx(PolicySearchCursor(childRecord, cursor.Level + 1, MakePPolicySearchCursor(cursor)), remainder, remainderLength);
 }
 
+PolicySearchCursor FindFileAccessPolicyInTreeEx(
+    __in  PolicySearchCursor const& startCursor,
+    __in  PCPathChar path,
+    __in  size_t pathLength,
+    __in  size_t searchStartIndex,
+    __in  PathComponent const* components,
+    __in  size_t componentCount)
+{
+    assert(path);
+    assert(pathLength == pathlen(path));
+    assert(searchStartIndex <= pathLength);
+    assert(startCursor.Record != nullptr);
+
+    // The component offsets are relative to path. Each iteration does what one recursive step of the
+    // string-based search above does, minus tokenizing and hashing the component, which the index already did.
+    // That search treats leading and repeated separators as part of the next partial path, so as soon as the
+    // remaining path does not have the shape component[\component]*[\], hand it over to preserve the exact behavior.
+    PolicySearchCursor cursor = startCursor;
+    size_t position = searchStartIndex;
+    for (size_t i = 0; i < componentCount; i++)
+    {
+        if (cursor.SearchWasTruncated)
+        {
+            return cursor;
+        }
+
+        PathComponent const& component = components[i];
+        if (component.Start != position)
+        {
+            return FindFileAccessPolicyInTreeEx(cursor, path + position, pathLength - position);
+        }
+
+        if (cursor.Record->BucketCount == 0)
+        {
+            return PolicySearchCursor(cursor.Record, cursor.Level, cursor.Parent, /*searchWasTruncated*/ true);
+        }
+
+        PCManifestRecord childRecord = nullptr;
+        if (!cursor.Record->FindChild(path + component.Start, component.Length, component.Hash, /*out*/ childRecord) || childRecord == nullptr)
+        {
+            return PolicySearchCursor(cursor.Record, cursor.Level, cursor.Parent, /*searchWasTruncated*/ true);
+        }
+
+        cursor = PolicySearchCursor(childRecord, cursor.Level + 1, MakePPolicySearchCursor(cursor));
+        position = component.End() < pathLength ? component.End() + 1 : pathLength;
+    }
+
+    return FindFileAccessPolicyInTreeEx(cursor, path + position, pathLength - position);
+}
+
 #ifdef BUILDXL_NATIVES_LIBRARY
 BOOL WINAPI FindFileAccessPolicyInTree(
     __in  ManifestRecord const* record,
@@ -140,7 +190,20 @@ __in  PCPathChar target,
 __in  size_t targetLength,
 __out PCManifestRecord& child) const
 {
-    DWORD hash = HashPath(target, targetLength);
+    return FindChild(target, targetLength, HashPath(target, targetLength), child);
+}
+
+/// FindChild
+///
+/// Same as above, for a target whose HashPath value is already known (e.g., computed by the path scan).
+__success(return)
+bool ManifestRecord::FindChild(
+__in  PCPathChar target,
+__in  size_t targetLength,
+__in  DWORD targetHash,
+__out PCManifestRecord& child) const
+{
+    const DWORD hash = targetHash;
     ManifestRecord::BucketCountType numBuckets = this->BucketCount;
 
     // We are searching a hash-table that has been constructed in FileAccessManifest.cs
@@ -5,6 +5,7 @@
 #define policysearch_h
 
 #include "DataTypes.h"
+#include "IndexedPath.h"
 
 // ----------------------------------------------------------------------------
 // Manifest policy tree search
@@ -87,6 +88,17 @@ PolicySearchCursor FindFileAccessPolicyInTreeEx(
     __in  PCPathChar absolutePath,
     __in  size_t absolutePathLength);
 
+// Same as above, searching for the suffix of 'path' starting at searchStartIndex, for a path whose components
+// (those starting at or after searchStartIndex, in order) have already been indexed. The components are neither
+// tokenized nor hashed again while walking the tree.
+PolicySearchCursor FindFileAccessPolicyInTreeEx(
+    __in  PolicySearchCursor const& startCursor,
+    __in  PCPathChar path,
+    __in  size_t pathLength,
+    __in  size_t searchStartIndex,
+    __in  PathComponent const* components,
+    __in  size_t componentCount);
+
 // This is equivalent to FindFileAccessPolicyInTreeEx, but taking just a start record
 // rather than a full cursor, and returning only the matched record details rather than a cursor.
 // This is a simplified variant for easier C#-side testing.
@@ -0,0 +1,104 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "stdafx.h"
+#include "PolicySnapshot.h"
+
+#include <new>
+#include <vector>
+
+// warning C26481: Don't use pointer arithmetic. Use span instead (bounds.1).
+// warning C26490: Don't use reinterpret_cast (type.1).
+#pragma warning( disable : 26481 26490 )
+
+PolicySnapshot::Ref PolicySnapshot::Create(
+    ManifestGeneration::Ref const& manifest,
+    CanonicalizedPath const& path,
+    PolicySearchCursor const& cursor,
+    FileAccessPolicy policy,
+    std::wstring const& translatedPath)
+{
+    const bool isTranslationIdentity =
+        translatedPath.length() == path.Length()
+        && (path.Length() == 0 || wmemcmp(translatedPath.c_str(), path.GetPathString(), path.Length()) == 0);
+
+    const size_t translatedChars = isTranslationIdentity ? 0 : translatedPath.length() + 1;
+    void* memory = ::operator new(sizeof(PolicySnapshot) + translatedChars * sizeof(PathChar));
+    PolicySnapshot* snapshot = new (memory) PolicySnapshot(manifest, path, cursor, policy);
+
+    if (isTranslationIdentity)
+    {
+        snapshot->m_translatedPath = path.IsNull() ? L"" : path.GetPathString();
+    }
+    else
+    {
+        PPathChar chars = reinterpret_cast<PPathChar>(snapshot + 1);
+        wmemcpy(chars, translatedPath.c_str(), translatedChars);
+        snapshot->m_translatedPath = chars;
+    }
+
+    return Ref::Adopt(snapshot);
+}
+
+void PolicySnapshot::Destroy(PolicySnapshot* snapshot) noexcept
+{
+    snapshot->~PolicySnapshot();
+    ::operator delete(static_cast<void*>(snapshot));
+}
+
+bool PolicySnapshot::IsFor(CanonicalizedPath const& path) const noexcept
+{
+    return m_path.Type == path.Type
+        && m_path.Hash() == path.Hash()
+        && m_path.Length() == path.Length()
+        && (m_path.GetPathString() == path.GetPathString()
+            || wmemcmp(m_path.GetPathString(), path.GetPathString(), path.Length()) == 0);
+}
+
+PolicySnapshotCache* PolicySnapshotCache::GetInstance()
+{
+    static PolicySnapshotCache s_singleton;
+    return &s_singleton;
+}
+
+PolicySnapshot::Ref PolicySnapshotCache::TryGet(CanonicalizedPath const& path, ManifestGeneration const* manifest)
+{
+    const size_t slotIndex = GetSlotIndex(path);
+    const std::shared_lock<std::shared_mutex> lock(GetLock(slotIndex));
+
+    PolicySnapshot::Ref const& cached = m_slots[slotIndex];
+    return cached && cached->GetManifest().Get() == manifest && cached->IsFor(path) ? cached : PolicySnapshot::Ref();
+}
+
+void PolicySnapshotCache::Add(PolicySnapshot::Ref const& snapshot)
+{
+    const size_t slotIndex = GetSlotIndex(snapshot->GetPath());
+    PolicySnapshot::Ref evicted(snapshot);
+
+    {
+        const std::unique_lock<std::shared_mutex> lock(GetLock(slotIndex));
+        std::swap(m_slots[slotIndex], evicted);
+    }
+
+    // The evicted snapshot (if this was its last reference) is destroyed here, outside of the lock.
+}
+
+void PolicySnapshotCache::Clear()
+{
+    for (size_t stripe = 0; stripe < POLICY_SNAPSHOT_CACHE_STRIPE_COUNT; stripe++)
+    {
+        // Keep the evicted snapshots alive until the lock is released, for the same reason as in Add.
+        std::vector<PolicySnapshot::Ref> evicted;
+
+        {
+            const std::unique_lock<std::shared_mutex> lock(m_locks[stripe]);
+            for (size_t slotIndex = stripe; slotIndex < POLICY_SNAPSHOT_CACHE_SIZE; slotIndex += POLICY_SNAPSHOT_CACHE_STRIPE_COUNT)
+            {
+                if (m_slots[slotIndex])
+                {
+                    evicted.push_back(std::move(m_slots[slotIndex]));
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,97 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+
+#include "CanonicalizedPath.h"
+#include "ManifestGeneration.h"
+#include "PolicySearch.h"
+#include "RefCountedPtr.h"
+
+#include <shared_mutex>
+
+// Number of snapshots kept by the PolicySnapshotCache. Must be a power of 2.
+#define POLICY_SNAPSHOT_CACHE_SIZE 4096U
+
+// Number of independently locked partitions of the PolicySnapshotCache. Must be a power of 2.
+#define POLICY_SNAPSHOT_CACHE_STRIPE_COUNT 64U
+
+// Immutable outcome of determining the policy for a canonicalized path: the path, its translation, the policy search cursor
+// (with its chain of parents) and the effective policy. The snapshot keeps the manifest generation it was determined under alive,
+// since the cursor points into its tree.
+//
+// A PolicyResult references its snapshot through a single RefCountedPtr, so copying a PolicyResult (into a handle overlay, a report,
+// a cache entry...) costs one atomic increment however much the snapshot holds. A snapshot lives in a single allocation: the header,
+// followed by the characters of the translated path - unless the translated path is the canonicalized path itself (the common case),
+// whose characters are then shared.
+class PolicySnapshot : public RefCounted
+{
+public:
+    typedef RefCountedPtr<PolicySnapshot> Ref;
+
+    static Ref Create(
+        ManifestGeneration::Ref const& manifest,
+        CanonicalizedPath const& path,
+        PolicySearchCursor const& cursor,
+        FileAccessPolicy policy,
+        std::wstring const& translatedPath);
+
+    // Destroys an instance once its last reference goes away. Used by RefCountedPtr.
+    static void Destroy(PolicySnapshot* snapshot) noexcept;
+
+    ManifestGeneration::Ref const& GetManifest() const noexcept { return m_manifest; }
+    CanonicalizedPath const& GetPath() const noexcept { return m_path; }
+    PolicySearchCursor const& GetCursor() const noexcept { return m_cursor; }
+    FileAccessPolicy GetPolicy() const noexcept { return m_policy; }
+    PCPathChar GetTranslatedPath() const noexcept { return m_translatedPath; }
+
+    // Whether the snapshot is for exactly the given path (same type and same characters).
+    bool IsFor(CanonicalizedPath const& path) const noexcept;
+
+private:
+    PolicySnapshot(ManifestGeneration::Ref const& manifest, CanonicalizedPath const& path, PolicySearchCursor const& cursor, FileAccessPolicy policy)
+        : m_manifest(manifest), m_path(path), m_cursor(cursor), m_policy(policy), m_translatedPath(nullptr)
+    { }
+
+    ~PolicySnapshot() = default;
+
+    ManifestGeneration::Ref m_manifest;
+    CanonicalizedPath m_path;
+    PolicySearchCursor m_cursor;
+    FileAccessPolicy m_policy;
+    PCPathChar m_translatedPath;
+};
+
+// Interns the snapshots of recently looked up paths, so that repeatedly opening the same path shares one snapshot, skipping path
+// translation and the policy search altogether. Only snapshots of searches started from the root of the manifest tree are interned.
+//
+// The policy of a path only depends on the manifest, so a cached snapshot is valid for as long as the manifest generation it was determined
+// under is the current one; the cache is cleared when the manifest is swapped, and lookups ignore snapshots of any other generation
+// (which a lookup racing with a swap could still add). The cache is direct-mapped on the path hash: a new snapshot simply replaces the one in its slot, which keeps the memory
+// it pins bounded. Each slot belongs to one of POLICY_SNAPSHOT_CACHE_STRIPE_COUNT partitions, each guarded by its own reader/writer lock.
+// All operations are thread-safe.
+class PolicySnapshotCache
+{
+public:
+    static PolicySnapshotCache* GetInstance();
+
+    // Returns the cached snapshot for the given path under the given manifest generation, or a null reference.
+    PolicySnapshot::Ref TryGet(CanonicalizedPath const& path, ManifestGeneration const* manifest);
+
+    // Caches a snapshot, replacing whatever its slot held.
+    void Add(PolicySnapshot::Ref const& snapshot);
+
+    // Drops every cached snapshot.
+    void Clear();
+
+private:
+    PolicySnapshotCache() = default;
+    PolicySnapshotCache(const PolicySnapshotCache&) = delete;
+    PolicySnapshotCache& operator=(const PolicySnapshotCache&) = delete;
+
+    static size_t GetSlotIndex(CanonicalizedPath const& path) noexcept { return path.Hash() & (POLICY_SNAPSHOT_CACHE_SIZE - 1); }
+    std::shared_mutex& GetLock(size_t slotIndex) noexcept { return m_locks[slotIndex & (POLICY_SNAPSHOT_CACHE_STRIPE_COUNT - 1)]; }
+
+    std::shared_mutex m_locks[POLICY_SNAPSHOT_CACHE_STRIPE_COUNT];
+    PolicySnapshot::Ref m_slots[POLICY_SNAPSHOT_CACHE_SIZE];
+};
@@ -0,0 +1,122 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Base for objects whose lifetime is managed by RefCountedPtr. The count lives in the object itself,
+// so an object and its count take a single allocation and a pointer to it is a single word.
+// Derived classes provide a static Destroy(T*) that releases the object once the count drops to zero.
+class RefCounted
+{
+public:
+    void AddRef() const noexcept
+    {
+        m_refCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Returns whether this was the last reference.
+    bool ReleaseRef() const noexcept
+    {
+        return m_refCount.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+protected:
+    RefCounted() noexcept : m_refCount(1) { }
+    ~RefCounted() = default;
+
+    RefCounted(const RefCounted&) = delete;
+    RefCounted& operator=(const RefCounted&) = delete;
+
+private:
+    mutable std::atomic<uint32_t> m_refCount;
+};
+
+// Intrusive, thread-safe counted reference to an immutable T derived from RefCounted.
+// Copying a RefCountedPtr only increments the count of the referenced object.
+template<typename T>
+class RefCountedPtr
+{
+public:
+    RefCountedPtr() noexcept : m_ptr(nullptr) { }
+
+    // Takes ownership of the (single) reference a newly created object starts with.
+    static RefCountedPtr Adopt(const T* ptr) noexcept
+    {
+        RefCountedPtr result;
+        result.m_ptr = ptr;
+        return result;
+    }
+
+    RefCountedPtr(const RefCountedPtr& other) noexcept : m_ptr(other.m_ptr)
+    {
+        if (m_ptr != nullptr)
+        {
+            m_ptr->AddRef();
+        }
+    }
+
+    RefCountedPtr(RefCountedPtr&& other) noexcept : m_ptr(other.m_ptr)
+    {
+        other.m_ptr = nullptr;
+    }
+
+    RefCountedPtr& operator=(const RefCountedPtr& other) noexcept
+    {
+        // Read the pointer before Reset: 'other' may be this very instance, or live in the object Reset releases.
+        const T* ptr = other.m_ptr;
+        if (ptr != nullptr)
+        {
+            ptr->AddRef();
+        }
+
+        Reset();
+        m_ptr = ptr;
+        return *this;
+    }
+
+    RefCountedPtr& operator=(RefCountedPtr&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            m_ptr = other.m_ptr;
+            other.m_ptr = nullptr;
+        }
+
+        return *this;
+    }
+
+    ~RefCountedPtr()
+    {
+        Reset();
+    }
+
+    void Reset() noexcept
+    {
+        if (m_ptr != nullptr && m_ptr->ReleaseRef())
+        {
+            T::Destroy(const_cast<T*>(m_ptr));
+        }
+
+        m_ptr = nullptr;
+    }
+
+    // Gives up the reference without releasing it. The caller owns it, and may hand it back to Adopt.
+    const T* Detach() noexcept
+    {
+        const T* ptr = m_ptr;
+        m_ptr = nullptr;
+        return ptr;
+    }
+
+    const T* Get() const noexcept { return m_ptr; }
+    const T* operator->() const noexcept { return m_ptr; }
+    const T& operator*() const noexcept { return *m_ptr; }
+    explicit operator bool() const noexcept { return m_ptr != nullptr; }
+
+private:
+    const T* m_ptr;
+};
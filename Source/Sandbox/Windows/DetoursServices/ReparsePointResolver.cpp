@@ -0,0 +1,424 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "stdafx.h"
+#include "ReparsePointResolver.h"
+#include "StringOperations.h"
+
+// warning C26481: Don't use pointer arithmetic. Use span instead (bounds.1).
+// warning C26446: Prefer to use gsl::at() instead of unchecked subscript operator (bounds.4).
+// warning C26482: Only index into arrays using constant expressions (bounds.2).
+#pragma warning( disable : 26481 26446 26482 )
+
+static const size_t NotFound = PathString::npos;
+
+static inline bool IsRooted(const PathString& path) noexcept
+{
+    return GetRootLength(path.c_str(), path.length()) > 0;
+}
+
+// Index of the last directory separator before 'end', or NotFound.
+static size_t FindLastSeparatorBefore(const PathString& path, size_t end) noexcept
+{
+    for (size_t i = end; i > 0; i--)
+    {
+        if (IsDirectorySeparator(path[i - 1]))
+        {
+            return i - 1;
+        }
+    }
+
+    return NotFound;
+}
+
+static inline size_t SkipSeparators(PCPathChar path, size_t pathLength, size_t position) noexcept
+{
+    while (position < pathLength && IsDirectorySeparator(path[position]))
+    {
+        position++;
+    }
+
+    return position;
+}
+
+static inline size_t SkipComponent(PCPathChar path, size_t pathLength, size_t position) noexcept
+{
+    while (position < pathLength && !IsDirectorySeparator(path[position]))
+    {
+        position++;
+    }
+
+    return position;
+}
+
+static inline bool StartsWithDotSeparator(const PathString& path, size_t position) noexcept
+{
+    return path.length() >= position + 2 && path[position] == PATH_DOT && IsDirectorySeparator(path[position + 1]);
+}
+
+static inline bool StartsWithDotDotSeparator(const PathString& path, size_t position) noexcept
+{
+    return path.length() >= position + 3 && path[position] == PATH_DOT && path[position + 1] == PATH_DOT && IsDirectorySeparator(path[position + 2]);
+}
+
+static void AppendComponent(PathString& path, PCPathChar component, size_t componentLength)
+{
+    if (!path.empty() && !IsDirectorySeparator(path.back()))
+    {
+        path.push_back(PREFERRED_DIRECTORY_SEPARATOR);
+    }
+
+    path.append(component, componentLength);
+}
+
+// Replaces the last component of 'base' by the relative target of the reparse point it names. Leading '.\' and '..\' of the target are
+// applied to 'base' right away; 'slicedStart' receives the offset of the remainder of the target, which the caller appends.
+static bool TryCombineWithRelativeTarget(PathString& base, const PathString& relativeTarget, size_t& slicedStart)
+{
+    if (!base.empty() && IsDirectorySeparator(base.back()))
+    {
+        base.pop_back();
+    }
+
+    // Skip the last component, i.e., the reparse point itself.
+    size_t lastSeparator = FindLastSeparatorBefore(base, base.length());
+    if (lastSeparator == NotFound)
+    {
+        return false;
+    }
+
+    size_t position = 0;
+    while (lastSeparator != NotFound)
+    {
+        if (StartsWithDotSeparator(relativeTarget, position))
+        {
+            position += 2;
+        }
+        else if (StartsWithDotDotSeparator(relativeTarget, position))
+        {
+            position += 3;
+            lastSeparator = FindLastSeparatorBefore(base, lastSeparator);
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (lastSeparator == NotFound && StartsWithDotDotSeparator(relativeTarget, position))
+    {
+        return false;
+    }
+
+    base.resize(lastSeparator != NotFound ? lastSeparator : 0);
+    slicedStart = position;
+    return true;
+}
+
+bool TryNormalizePathLexically(PCPathChar path, size_t pathLength, PathString& normalized)
+{
+    const size_t rootLength = GetRootLength(path, pathLength);
+    if (rootLength == 0)
+    {
+        return false;
+    }
+
+    normalized.assign(path, rootLength);
+    const size_t rootEnd = normalized.length();
+
+    size_t position = rootLength;
+    while (true)
+    {
+        const size_t start = SkipSeparators(path, pathLength, position);
+        position = SkipComponent(path, pathLength, start);
+        const size_t componentLength = position - start;
+        if (componentLength == 0)
+        {
+            break;
+        }
+
+        if (componentLength == 1 && path[start] == PATH_DOT)
+        {
+            continue;
+        }
+
+        if (componentLength == 2 && path[start] == PATH_DOT && path[start + 1] == PATH_DOT)
+        {
+            if (normalized.length() == rootEnd)
+            {
+                return false;
+            }
+
+            const size_t lastSeparator = FindLastSeparatorBefore(normalized, normalized.length());
+            normalized.resize(lastSeparator == NotFound || lastSeparator < rootEnd ? rootEnd : lastSeparator);
+            continue;
+        }
+
+        AppendComponent(normalized, path + start, componentLength);
+    }
+
+    return true;
+}
+
+bool ReparsePointFileSystem::TryNormalize(PCPathChar path, size_t pathLength, PathString& normalized)
+{
+    return TryNormalizePathLexically(path, pathLength, normalized);
+}
+
+bool ReparsePointFileSystem::ShouldFollow(PCPathChar, size_t, const PathString&)
+{
+    return true;
+}
+
+void ReparsePointChain::Clear() noexcept
+{
+    m_buffer.clear();
+    m_offsets[0] = 0;
+    m_count = 0;
+    m_isFullyResolved = false;
+    m_hitHopLimit = false;
+}
+
+bool ReparsePointChain::TryAppend(PCPathChar path, size_t pathLength)
+{
+    if (m_count > MAX_REPARSE_POINT_HOPS)
+    {
+        m_hitHopLimit = true;
+        return false;
+    }
+
+    // Entries stay null terminated inside the shared buffer so that each one can be handed out as a C string.
+    m_buffer.append(path, pathLength);
+    m_buffer.push_back(0);
+    m_offsets[++m_count] = m_buffer.length();
+    return true;
+}
+
+bool ReparsePointChain::Contains(PCPathChar path, size_t pathLength) const noexcept
+{
+    for (size_t i = 0; i < m_count; i++)
+    {
+        if (GetPathLength(i) == pathLength && ArePathCharsEqual(GetPath(i), path, pathLength))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ReparsePointResolver::TryGetNextPath(PCPathChar path, size_t pathLength, PathString& nextPath)
+{
+    if (!m_fileSystem.TryGetReparsePointTarget(path, pathLength, m_target))
+    {
+        return false;
+    }
+
+    if (IsRooted(m_target))
+    {
+        nextPath.assign(m_target);
+        return true;
+    }
+
+    m_relativeTarget.swap(m_target);
+    return TryResolveRelativeTarget(path, pathLength, nextPath);
+}
+
+bool ReparsePointResolver::TryResolveRelativeTarget(PCPathChar path, size_t pathLength, PathString& result)
+{
+    // Walk the path from the root, resolving the directory symlinks in it. 'result' holds the part resolved so far,
+    // and 'm_pending' the rest, which gets rewritten whenever a directory symlink is replaced by its target.
+    m_pending.assign(path, pathLength);
+    size_t rootLength = GetRootLength(m_pending.c_str(), m_pending.length());
+    result.assign(m_pending, 0, rootLength);
+
+    size_t position = rootLength;
+    while (true)
+    {
+        const size_t start = SkipSeparators(m_pending.c_str(), m_pending.length(), position);
+        position = SkipComponent(m_pending.c_str(), m_pending.length(), start);
+        if (position == start)
+        {
+            break;
+        }
+
+        AppendComponent(result, m_pending.c_str() + start, position - start);
+
+        if (SkipSeparators(m_pending.c_str(), m_pending.length(), position) == m_pending.length())
+        {
+            // The last component is the reparse point whose target gets combined below.
+            break;
+        }
+
+        if (!m_fileSystem.IsDirectorySymlink(result.c_str(), result.length()))
+        {
+            continue;
+        }
+
+        if (!m_fileSystem.TryGetReparsePointTarget(result.c_str(), result.length(), m_target))
+        {
+            return false;
+        }
+
+        if (IsRooted(m_target))
+        {
+            // Start over from the target, followed by the components still to be walked.
+            m_pending.replace(0, position, m_target);
+            rootLength = GetRootLength(m_pending.c_str(), m_pending.length());
+            result.assign(m_pending, 0, rootLength);
+            position = rootLength;
+        }
+        else
+        {
+            size_t slicedStart;
+            if (!TryCombineWithRelativeTarget(result, m_target, slicedStart))
+            {
+                return false;
+            }
+
+            m_pending.replace(0, position, m_target, slicedStart, NotFound);
+            position = 0;
+        }
+    }
+
+    size_t slicedStart;
+    if (!TryCombineWithRelativeTarget(result, m_relativeTarget, slicedStart))
+    {
+        return false;
+    }
+
+    result.push_back(PREFERRED_DIRECTORY_SEPARATOR);
+    result.append(m_relativeTarget, slicedStart, NotFound);
+    return true;
+}
+
+bool ReparsePointResolver::ResolveChain(PCPathChar path, size_t pathLength, ReparsePointChain& chain)
+{
+    chain.Clear();
+    m_current.assign(path, pathLength);
+
+    while (chain.TryAppend(m_current.c_str(), m_current.length()))
+    {
+        if (!TryGetNextPath(m_current.c_str(), m_current.length(), m_resolved))
+        {
+            // The current path is not a reparse point (or its target cannot be found), so it is as resolved as it gets.
+            chain.m_isFullyResolved = true;
+            return true;
+        }
+
+        if (!m_fileSystem.TryNormalize(m_resolved.c_str(), m_resolved.length(), m_current)
+            || chain.Contains(m_current.c_str(), m_current.length()))
+        {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+bool ReparsePointResolver::ResolveAll(PCPathChar path, size_t pathLength, size_t firstLevelToResolve, bool preserveLastReparsePoint, ReparsePointChain& chain)
+{
+    chain.Clear();
+    m_current.assign(path, pathLength);
+
+    // 'firstLevelToResolve' only applies to the original path. Once a reparse point has been followed, every level of the new path is checked.
+    bool isOriginalPath = true;
+    size_t level = 0;
+    while (true)
+    {
+        PCPathChar current = m_current.c_str();
+        const size_t currentLength = m_current.length();
+        const size_t rootLength = GetRootLength(current, currentLength);
+        m_resolved.assign(current, rootLength);
+
+        // First resolve the directories, e.g. 'a\b\c' of 'C:\a\b\c\file'. As soon as one of them is followed, the rest are appended
+        // as they are and the whole walk is repeated on the new path, since following a reparse point can introduce more of them.
+        bool followedReparsePoint = false;
+        size_t start = SkipSeparators(current, currentLength, rootLength);
+        size_t end = SkipComponent(current, currentLength, start);
+        size_t next = SkipSeparators(current, currentLength, end);
+        while (end > start && next < currentLength)
+        {
+            AppendComponent(m_resolved, current + start, end - start);
+            if (isOriginalPath)
+            {
+                level++;
+            }
+
+            if (!followedReparsePoint && (!isOriginalPath || level >= firstLevelToResolve))
+            {
+                if (!TryFollow(end - start, chain, followedReparsePoint))
+                {
+                    return false;
+                }
+            }
+
+            start = next;
+            end = SkipComponent(current, currentLength, start);
+            next = SkipSeparators(current, currentLength, end);
+        }
+
+        isOriginalPath = false;
+
+        // Then the final component, unless it is to be preserved.
+        const size_t lastComponentLength = end - start;
+        if (lastComponentLength > 0)
+        {
+            AppendComponent(m_resolved, current + start, lastComponentLength);
+
+            if (!followedReparsePoint && !preserveLastReparsePoint && !TryFollow(lastComponentLength, chain, followedReparsePoint))
+            {
+                return false;
+            }
+        }
+
+        // 'm_resolved' no longer aliases 'm_current' past this point.
+        if (!m_fileSystem.TryNormalize(m_resolved.c_str(), m_resolved.length(), m_current))
+        {
+            return false;
+        }
+
+        if (!followedReparsePoint)
+        {
+            // No reparse point left: the normalized path is the final one.
+            if (!chain.TryAppend(m_current.c_str(), m_current.length()))
+            {
+                return false;
+            }
+
+            chain.m_isFullyResolved = true;
+            return true;
+        }
+    }
+}
+
+bool ReparsePointResolver::TryFollow(size_t componentLength, ReparsePointChain& chain, bool& followed)
+{
+    // 'm_resolved' ends with the component to check.
+    followed = false;
+    if (!m_fileSystem.TryGetReparsePointTarget(m_resolved.c_str(), m_resolved.length(), m_target)
+        || !m_fileSystem.ShouldFollow(m_resolved.c_str(), m_resolved.length(), m_target))
+    {
+        return true;
+    }
+
+    if (!chain.TryAppend(m_resolved.c_str(), m_resolved.length()))
+    {
+        // Too many reparse points.
+        return false;
+    }
+
+    if (IsRooted(m_target))
+    {
+        m_resolved.assign(m_target);
+    }
+    else
+    {
+        // A relative target replaces the reparse point. Any '.' and '..' it contains are taken care of by the normalization that follows.
+        m_resolved.resize(m_resolved.length() - componentLength);
+        m_resolved.append(m_target);
+    }
+
+    followed = true;
+    return true;
+}
@@ -0,0 +1,122 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+
+#include "DataTypes.h"
+
+#include <string>
+
+typedef std::basic_string<PathChar> PathString;
+
+// Upper bound on the number of reparse points followed while resolving a single path.
+// This is the limit Windows itself applies before failing with ERROR_CANT_RESOLVE_FILENAME.
+#define MAX_REPARSE_POINT_HOPS 63U
+
+// Queries the resolver needs to make against the file system. Detours implements these with Win32 calls (see DetouredFunctions.cpp);
+// any other implementation (e.g. an in-memory table of links) can drive the same resolution logic on any platform.
+//
+// Paths passed to these functions are always null terminated; the length is provided so that implementations need not recompute it.
+class ReparsePointFileSystem
+{
+public:
+    virtual ~ReparsePointFileSystem() = default;
+
+    // Whether 'path' is a reparse point that the resolver should follow (a symlink or a junction on Windows).
+    // If so, 'target' receives its immediate target, which may be relative to the directory containing 'path'.
+    virtual bool TryGetReparsePointTarget(PCPathChar path, size_t pathLength, PathString& target) = 0;
+
+    // Whether 'path' is a directory symlink. Directory symlinks in the prefix of a path are resolved before a relative
+    // target is combined with it; other reparse points (junctions) are left in place, which is how Windows evaluates relative targets.
+    virtual bool IsDirectorySymlink(PCPathChar path, size_t pathLength) = 0;
+
+    // Puts a path produced by following a reparse point into its canonical form, collapsing '.' and '..' components.
+    // The default implementation does so lexically.
+    virtual bool TryNormalize(PCPathChar path, size_t pathLength, PathString& normalized);
+
+    // Whether a reparse point found while resolving all reparse points in a path should be followed. Defaults to true.
+    virtual bool ShouldFollow(PCPathChar path, size_t pathLength, const PathString& target);
+};
+
+// Paths visited while resolving reparse points, in order. Each entry is a null-terminated path; all of them share one buffer.
+// Unless IsFullyResolved(), the last entry still is a reparse point (the resolution ran into a cycle, the hop limit or an error).
+class ReparsePointChain
+{
+public:
+    ReparsePointChain() noexcept { Clear(); }
+
+    size_t Count() const noexcept { return m_count; }
+
+    PCPathChar GetPath(size_t index) const noexcept { return m_buffer.c_str() + m_offsets[index]; }
+    size_t GetPathLength(size_t index) const noexcept { return m_offsets[index + 1] - m_offsets[index] - 1; }
+
+    // Whether the last entry is the final path, i.e., it does not contain any reparse point that was to be followed.
+    bool IsFullyResolved() const noexcept { return m_isFullyResolved; }
+
+    // Whether the resolution stopped because following one more reparse point would have exceeded MAX_REPARSE_POINT_HOPS.
+    bool HitHopLimit() const noexcept { return m_hitHopLimit; }
+
+    // Whether the chain already contains the given path (compared with IsPathCharEqual).
+    bool Contains(PCPathChar path, size_t pathLength) const noexcept;
+
+private:
+    friend class ReparsePointResolver;
+
+    void Clear() noexcept;
+    bool TryAppend(PCPathChar path, size_t pathLength);
+
+    PathString m_buffer;
+    size_t m_offsets[MAX_REPARSE_POINT_HOPS + 2];
+    size_t m_count;
+    bool m_isFullyResolved;
+    bool m_hitHopLimit;
+};
+
+// Resolves chains of symlinks and junctions against a ReparsePointFileSystem.
+//
+// The resolver works on path buffers it owns and reuses: path components are visited in place and strings are only built
+// for the paths that end up in the result (or are handed to the file system), so reusing one resolver for many paths does not
+// allocate in the steady state.
+class ReparsePointResolver
+{
+public:
+    explicit ReparsePointResolver(ReparsePointFileSystem& fileSystem) noexcept : m_fileSystem(fileSystem) { }
+
+    // Gets the path a reparse point immediately leads to. Returns false if 'path' is not a reparse point or its target cannot be determined.
+    //
+    // A rooted target is returned as is. A relative target is evaluated against the directory containing 'path' once the directory
+    // symlinks in that directory have been resolved, e.g., given 'repo\source\link' ==> '..\target' where 'repo\source' ==> 'intermediate\current'
+    // is a directory symlink, the next path is 'repo\intermediate\target'; if 'repo\source' is a junction instead, it is 'repo\target'.
+    bool TryGetNextPath(PCPathChar path, size_t pathLength, PathString& nextPath);
+
+    // Follows 'path' from one reparse point to the next one. The chain starts with 'path' and ends with the first path that is not a reparse
+    // point (after normalization with TryNormalize), or before a path that would repeat an earlier one. Returns false if a cycle was found
+    // or the hop limit was hit.
+    bool ResolveChain(PCPathChar path, size_t pathLength, ReparsePointChain& chain);
+
+    // Resolves every reparse point in 'path', not just the final component. The chain receives each reparse point that got followed, in order,
+    // and then the fully resolved path. Components at a depth lower than 'firstLevelToResolve' (the root is level 0) are not checked the first
+    // time 'path' is walked; once a reparse point has been followed, every component of the new path is. If 'preserveLastReparsePoint' is set,
+    // the final component is not followed, so the chain ends with a path whose directories contain no reparse points.
+    // Returns false if normalization failed, or the hop limit was hit.
+    bool ResolveAll(PCPathChar path, size_t pathLength, size_t firstLevelToResolve, bool preserveLastReparsePoint, ReparsePointChain& chain);
+
+private:
+    bool TryResolveRelativeTarget(PCPathChar path, size_t pathLength, PathString& result);
+
+    // Follows the reparse point 'm_resolved' names, if any, appending it to the chain. Returns false once the hop limit is hit.
+    bool TryFollow(size_t componentLength, ReparsePointChain& chain, bool& followed);
+
+    ReparsePointFileSystem& m_fileSystem;
+
+    // Scratch buffers reused across calls.
+    PathString m_target;
+    PathString m_relativeTarget;
+    PathString m_pending;
+    PathString m_current;
+    PathString m_resolved;
+};
+
+// Lexically collapses '.' and '..' components and repeated separators of a rooted path, using the preferred directory separator.
+// Returns false if the path is not rooted or '..' would go above the root.
+bool TryNormalizePathLexically(PCPathChar path, size_t pathLength, PathString& normalized);
@@ -264,6 +264,18 @@ public:
     ResolvedPathCache(const ResolvedPathCache&) = delete;
     ResolvedPathCache& operator=(const ResolvedPathCache&) = delete;
 
+    // Drops every cached entry, e.g. when the process starts running for a different pip (see SwapFileAccessManifest).
+    void Clear()
+    {
+        ResolvedPathCacheWriteLock w_lock(m_lock);
+
+        m_resolverCache.clear();
+        m_targetCache.clear();
+        m_paths.clear();
+        m_paths_reverse.clear();
+        m_pathTree.Clear();
+    }
+
     static ResolvedPathCache& Instance()
     {
         static ResolvedPathCache instance;
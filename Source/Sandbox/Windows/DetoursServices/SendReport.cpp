@@ -14,12 +14,12 @@
 #include "PolicyResult.h"
 #include "buildXL_mem.h"
 #include "ReportType.h"
+#include "ManifestGeneration.h"
 
 #include <TraceLoggingProvider.h>
 
 using std::unique_ptr;
 
-extern volatile LONG g_detoursAllocatedNoLockConcurentPoolEntries;
 extern volatile LONG64 g_detoursMaxHandleHeapEntries;
 extern volatile LONG64 g_detoursHandleHeapEntries;
 
@@ -27,12 +27,47 @@ extern volatile LONG64 g_detoursHandleHeapEntries;
 // HELPER FUNCTION DEFINITIONS
 // ----------------------------------------------------------------------------
 
+/**
+ ** Tags a report line ("<report type>,<data>") with the pip id of the manifest the current operation started under (see OperationManifest),
+ ** as "<report type>@<pip id in hex>,<data>".
+ ** Returns the tagged line, which lives in taggedReport, or the line itself if it does not start with a report type.
+ **
+ ** Only done once the manifest was swapped: a process reused across pips keeps reporting through the same channel, and the engine
+ ** must tell the lines of the previous pip (e.g. from operations that were still running during the swap) from those of the current one.
+ **
+ ** CODESYNC: Public/Src/Engine/Processes/SandboxedProcessReports.cs
+ */
+static wchar_t const* TagReportWithPipId(_In_z_ wchar_t const* dataString, std::wstring& taggedReport)
+{
+    wchar_t const* separator = wcschr(dataString, L',');
+    ManifestGeneration::Ref manifest = OperationManifest::Get();
+    if (separator == nullptr || !manifest)
+    {
+        return dataString;
+    }
+
+    wchar_t pipId[24];
+    swprintf_s(pipId, L"@%llx", (unsigned long long)manifest->GetPipId());
+
+    taggedReport.reserve(wcslen(dataString) + wcslen(pipId));
+    taggedReport.assign(dataString, separator);
+    taggedReport.append(pipId);
+    taggedReport.append(separator);
+    return taggedReport.c_str();
+}
+
 void SendReportString(_In_z_ wchar_t const* dataString)
 {
     if (g_reportFileHandle == NULL || g_reportFileHandle == INVALID_HANDLE_VALUE) {
         return;
     }
 
+    std::wstring taggedReport;
+    if (CurrentManifest::GetInstance()->IsSwapped())
+    {
+        dataString = TagReportWithPipId(dataString, taggedReport);
+    }
+
     // Increment the message sent counter. The managed sandbox will decrement it upon receiving the message.
     if (g_messageCountSemaphore != INVALID_HANDLE_VALUE)
     {
@@ -52,7 +87,7 @@ void SendReportString(_In_z_ wchar_t const* dataString)
     TraceLoggingWrite(
         g_detoursServicesTraceProvider,
         "SendReportString",
-        TraceLoggingInt64((int64_t)g_FileAccessManifestPipId, "PipId"),
+        TraceLoggingInt64((int64_t)OperationManifest::GetPipId(), "PipId"),
         TraceLoggingUInt64(length, "Length"),
         TraceLoggingCountedWideString(dataString, (ULONG)min((size_t)32, length), "Start")
     );
@@ -85,41 +120,35 @@ void SendReportString(_In_z_ wchar_t const* dataString)
 
 /**
  ** Escapes new line characters from filenames by replacing the \ with \\
- ** Returns true if the filename needed to be escaped, with the escaped name set in escapedFileName.
+ ** The escaped name is set in escapedFileName. firstEscapeIndex is the index of the first \r or \n, which the caller already knows
+ ** (the scan of a canonicalized path records it), so the name is not searched from its start again.
  **
  ** CODESYNC: Public/Src/Engine/Processes/SandboxedProcessReports.cs
  */
-bool EscapeFileName(PCWSTR fileName, size_t fileNameLength, std::wstring &escapedFileName)
+static void EscapeFileName(PCWSTR fileName, size_t fileNameLength, size_t firstEscapeIndex, std::wstring &escapedFileName)
 {
-    size_t escapeCharIndex = wcscspn(fileName, L"\r\n"); // Returns the length of fileName if \r or \n not found.
-    if (escapeCharIndex < fileNameLength)
-    {
-        size_t startIndex = 0;
+    size_t startIndex = 0;
+    size_t escapeIndex = firstEscapeIndex;
 
-        while (startIndex < fileNameLength)
+    while (startIndex < fileNameLength)
+    {
+        // Append the part of the string from the starting index up to the character to be escaped.
+        escapedFileName.append(fileName + startIndex, escapeIndex - startIndex);
+        if (escapeIndex == fileNameLength)
         {
-            // Append the part of the string from the starting index up to the character to be escaped.
-            escapedFileName.append(fileName, startIndex, escapeCharIndex);
-
-            // Escape \r or \n
-            switch (fileName[startIndex + escapeCharIndex])
-            {
-                case L'\r':
-                    escapedFileName.append(L"/\\r");
-                    break;
-                case L'\n':
-                    escapedFileName.append(L"/\\n");
-                    break;
-            }
-
-            startIndex += escapeCharIndex + 1;
-            escapeCharIndex = startIndex < fileNameLength ? wcscspn(&fileName[startIndex], L"\r\n") : 0;
+            break;
         }
 
-        return true;
-    }
+        // Escape \r or \n
+        escapedFileName.append(fileName[escapeIndex] == L'\r' ? L"/\\r" : L"/\\n");
 
-    return false;
+        startIndex = escapeIndex + 1;
+        escapeIndex = startIndex + wcscspn(fileName + startIndex, L"\r\n"); // Stops at the terminating null if \r or \n is not found.
+        if (escapeIndex > fileNameLength)
+        {
+            escapeIndex = fileNameLength;
+        }
+    }
 }
 
 // ----------------------------------------------------------------------------
@@ -152,25 +181,34 @@ void ReportFileAccess(
     }
 
     PCWSTR fileName, filterStr;
+    size_t fileNameLength; // in characters
+    size_t firstEscapeIndex; // fileNameLength when nothing has to be escaped
     std::wstring escapedFileName;
 
     if (policyResult.IsIndeterminate()) {
         fileName = fileOperationContext.NoncanonicalPath;
+        fileNameLength = fileName != nullptr ? wcslen(fileName) : 0;
+        firstEscapeIndex = fileName != nullptr ? wcscspn(fileName, L"\r\n") : 0;
     }
     else {
-        fileName = policyResult.GetCanonicalizedPath().GetPathString();
+        // The canonicalized path knows its length and where the first character to escape is.
+        CanonicalizedPath const& canonicalizedPath = policyResult.GetCanonicalizedPath();
+        fileName = canonicalizedPath.GetPathString();
+        fileNameLength = canonicalizedPath.Length();
+        firstEscapeIndex = canonicalizedPath.FirstCharacterToEscapeForReport();
     }
 
     if (fileName == nullptr) {
         fileName = L"";
+        fileNameLength = 0;
+        firstEscapeIndex = 0;
     }
 
-    size_t fileNameLength = wcslen(fileName); // in characters
-
-    if (EscapeFileName(fileName, fileNameLength, escapedFileName))
+    if (firstEscapeIndex < fileNameLength)
     {
+        EscapeFileName(fileName, fileNameLength, firstEscapeIndex, escapedFileName);
         fileName = escapedFileName.c_str();
-        fileNameLength = wcslen(fileName);
+        fileNameLength = escapedFileName.length();
     }
 
     if (filter == nullptr || accessCheckResult.Access != RequestedAccess::Enumerate) {
@@ -402,7 +440,7 @@ void ReportProcessData(
     FILETIME const& userTime, 
     DWORD const& exitCode,
     DWORD const& parentProcessId,
-    LONG64 const& detoursMaxMemHeapSize)
+    SlabAllocatorStatistics const& allocatorStatistics)
 {
     if (g_reportFileHandle == NULL || g_reportFileHandle == INVALID_HANDLE_VALUE || !ShouldLogProcessData()) {
         return;
@@ -421,8 +459,8 @@ void ReportProcessData(
     // exit time, and the kernel and user mode execution times. They have a high and low DWORD value.
     // There is 1 32 bit process exit code.
     // There is 1 32 bit parent process id.
-    // There are 29 separators for the "," and "|" characters. (30 values total gives us 29 separators)
-    // There are 5 * 64 bit and 2 * 32 bit for detours max memory heap size * and payload size, final heap allocated, max and final HandleHeapEntries, allocated pool entries for the non-locking list.
+    // There are 28 separators for the "," and "|" characters. (29 values total gives us 28 separators)
+    // There are 4 * 64 bit and 1 * 32 bit for the peak memory used by the detours allocator, the payload size, the memory the allocator still hands out, and max and final HandleHeapEntries.
     // There are 6 * 64 bit for the max allocated/reallocated, virtual allocated data, max realloc chunck, final and max app used heap space
     // And the length of the module file name.
     // 3 characters for "\r\n" and null.
@@ -431,16 +469,16 @@ void ReportProcessData(
         10 /*Process ID*/ +
         (20 * 6) /*IO Counters*/ +
         (10 * 7) /*Creation, exit, kernel, user times*/ +
-        29 /*Separators*/ +
+        28 /*Separators*/ +
         MAX_PATH + /*Module file name*/ +
         10 /*Process exit code*/ +
         10 /*Parent process id*/ +
-        120 /*Detours max memory heap size * and payload size, final heap allocated, max and final HandleHeapEntries, allocated pool entries for the non-locking list. */ +
+        90 /*Detours allocator peak and in use memory, payload size, max and final HandleHeapEntries. */ +
         3; /*\r\n null*/
 
     wchar_t report[reportBufferSize];
 
-    int const constructReportResult = swprintf_s(report, reportBufferSize, L"%u,%lu|%I64u|%I64u|%I64u|%I64u|%I64u|%I64u|%lu|%lu|%lu|%lu|%lu|%lu|%lu|%lu|%s|%lu|%lu|%I64u|%lu|%I64u|%lu|%I64u|%I64u\r\n",
+    int const constructReportResult = swprintf_s(report, reportBufferSize, L"%u,%lu|%I64u|%I64u|%I64u|%I64u|%I64u|%I64u|%lu|%lu|%lu|%lu|%lu|%lu|%lu|%lu|%s|%lu|%lu|%I64u|%lu|%I64u|%I64u|%I64u\r\n",
         buildxl::common::ReportType::kProcessData,
         GetCurrentProcessId(),
         ioCounters.ReadOperationCount,
@@ -460,10 +498,9 @@ void ReportProcessData(
         fileName,
         exitCode,
         parentProcessId,
-        (ULONG64)detoursMaxMemHeapSize,
+        (ULONG64)allocatorStatistics.PeakBytes(),
         (ULONG)g_manifestSize,
-        (ULONG64)g_detoursHeapAllocatedMemoryInBytes,
-        (ULONG)g_detoursAllocatedNoLockConcurentPoolEntries,
+        (ULONG64)(allocatorStatistics.SmallBytesInUse + allocatorStatistics.LargeBytesInUse),
         (ULONG64)g_detoursMaxHandleHeapEntries,
         (ULONG64)g_detoursHandleHeapEntries);
 
@@ -8,6 +8,7 @@
 #include "DataTypes.h"
 #include "PolicyResult.h"
 #include "globals.h"
+#include "SlabAllocator.h"
 
 // ----------------------------------------------------------------------------
 // FUNCTION DECLARATIONS
@@ -40,7 +41,7 @@ void ReportProcessData(
     FILETIME const& userTime,
     DWORD const& exitCode,
     DWORD const& parentProcessId,
-    LONG64 const& detoursMaxMemHeapSize);
+    SlabAllocatorStatistics const& allocatorStatistics);
 
 void ReportProcessDetouringStatus(
     ProcessDetouringStatus status,
@@ -0,0 +1,595 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "stdafx.h"
+#include "SlabAllocator.h"
+
+#include <new>
+
+#if _WIN32
+#include "globals.h"
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#endif
+
+// warning C26481: Don't use pointer arithmetic. Use span instead (bounds.1).
+// warning C26446: Prefer to use gsl::at() instead of unchecked subscript operator (bounds.4).
+// warning C26490: Don't use reinterpret_cast (type.1).
+// warning C26482: Only index into arrays using constant expressions (bounds.2).
+#pragma warning( disable : 26481 26446 26490 26482 )
+
+// ----------------------------------------------------------------------------
+// Platform specific memory and TLS primitives
+// ----------------------------------------------------------------------------
+
+#if _WIN32
+
+static void* ReserveAddressSpace(size_t size)
+{
+    return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_READWRITE);
+}
+
+static bool CommitMemory(void* address, size_t size)
+{
+    return VirtualAlloc(address, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+}
+
+static void ReleaseAddressSpace(void* address, size_t size)
+{
+    UNREFERENCED_PARAMETER(size);
+    VirtualFree(address, 0, MEM_RELEASE);
+}
+
+static void* AllocateLargeBlock(size_t size)
+{
+    return HeapAlloc(g_hPrivateHeap, HEAP_ZERO_MEMORY, size);
+}
+
+static void FreeLargeBlock(void* block)
+{
+    HeapFree(g_hPrivateHeap, 0, block);
+}
+
+static bool TryAllocateTlsSlot(unsigned long& index, void (*threadExit)(void*))
+{
+    // Threads hand their caches back on DLL_THREAD_DETACH instead (see ReleaseThreadCache).
+    UNREFERENCED_PARAMETER(threadExit);
+    index = TlsAlloc();
+    return index != TLS_OUT_OF_INDEXES;
+}
+
+static void FreeTlsSlot(unsigned long index)
+{
+    TlsFree(index);
+}
+
+static void YieldThread()
+{
+    SwitchToThread();
+}
+
+static void* GetTlsValue(unsigned long index)
+{
+    // TlsGetValue clears the last error on success, and allocations happen between the calls detours make and the
+    // moment they read the last error back.
+    const DWORD lastError = GetLastError();
+    void* value = TlsGetValue(index);
+    SetLastError(lastError);
+    return value;
+}
+
+static bool SetTlsValue(unsigned long index, void* value)
+{
+    const DWORD lastError = GetLastError();
+    const bool set = TlsSetValue(index, value) != FALSE;
+    SetLastError(lastError);
+    return set;
+}
+
+#else // _WIN32
+
+static void* ReserveAddressSpace(size_t size)
+{
+    void* address = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return address == MAP_FAILED ? nullptr : address;
+}
+
+static bool CommitMemory(void* address, size_t size)
+{
+    return mprotect(address, size, PROT_READ | PROT_WRITE) == 0;
+}
+
+static void ReleaseAddressSpace(void* address, size_t size)
+{
+    munmap(address, size);
+}
+
+static void* AllocateLargeBlock(size_t size)
+{
+    return calloc(1, size);
+}
+
+static void FreeLargeBlock(void* block)
+{
+    free(block);
+}
+
+static bool TryAllocateTlsSlot(unsigned long& index, void (*threadExit)(void*))
+{
+    pthread_key_t key;
+    if (pthread_key_create(&key, threadExit) != 0)
+    {
+        return false;
+    }
+
+    index = static_cast<unsigned long>(key);
+    return true;
+}
+
+static void FreeTlsSlot(unsigned long index)
+{
+    pthread_key_delete(static_cast<pthread_key_t>(index));
+}
+
+static void YieldThread()
+{
+    sched_yield();
+}
+
+static void* GetTlsValue(unsigned long index)
+{
+    return pthread_getspecific(static_cast<pthread_key_t>(index));
+}
+
+static bool SetTlsValue(unsigned long index, void* value)
+{
+    return pthread_setspecific(static_cast<pthread_key_t>(index), value) == 0;
+}
+
+#endif // _WIN32
+
+// ----------------------------------------------------------------------------
+// SlabAllocator
+// ----------------------------------------------------------------------------
+
+bool SlabAllocator::Initialize() noexcept
+{
+    assert(!m_initialized);
+
+    m_base = static_cast<uint8_t*>(ReserveAddressSpace(SLAB_ALLOCATOR_RESERVED_SIZE));
+    if (m_base == nullptr)
+    {
+        return false;
+    }
+
+    // Caches of threads that exit are handed back by ReleaseThreadCache on Windows, and by the key destructor elsewhere.
+    auto threadExit = [](void* value)
+    {
+        ThreadCache* cache = static_cast<ThreadCache*>(value);
+        cache->Owner->ReleaseCache(cache);
+    };
+
+    if (!TryAllocateTlsSlot(m_tlsIndex, threadExit))
+    {
+        ReleaseAddressSpace(m_base, SLAB_ALLOCATOR_RESERVED_SIZE);
+        m_base = nullptr;
+        return false;
+    }
+
+    m_initialized = true;
+    return true;
+}
+
+void SlabAllocator::Destroy() noexcept
+{
+    if (!m_initialized)
+    {
+        return;
+    }
+
+    m_initialized = false;
+    FreeTlsSlot(m_tlsIndex);
+
+    ThreadCache* cache = m_caches.exchange(nullptr);
+    while (cache != nullptr)
+    {
+        ThreadCache* next = cache->NextCache;
+        cache->~ThreadCache();
+        FreeLargeBlock(cache);
+        cache = next;
+    }
+
+    // m_base is kept, and the range is left to the process teardown: releasing it would make IsSlabBlock fail for blocks still held,
+    // whose frees would then be taken for large blocks.
+}
+
+unsigned SlabAllocator::GetSizeClass(size_t size) noexcept
+{
+    assert(size <= SLAB_ALLOCATOR_MAX_SMALL_SIZE);
+
+    if (size <= 128)
+    {
+        return size == 0 ? 0 : static_cast<unsigned>((size - 1) >> 4);
+    }
+
+    // Four classes per power of two: (128, 256] is split into steps of 32 bytes, (256, 512] into steps of 64 bytes, and so on.
+    unsigned highBit = 7;
+    while (((size - 1) >> (highBit + 1)) != 0)
+    {
+        highBit++;
+    }
+
+    return 8 + (highBit - 7) * 4 + static_cast<unsigned>((size - 1) >> (highBit - 2)) - 4;
+}
+
+size_t SlabAllocator::GetClassSize(unsigned sizeClass) noexcept
+{
+    assert(sizeClass < SLAB_ALLOCATOR_CLASS_COUNT);
+
+    if (sizeClass < 8)
+    {
+        return static_cast<size_t>(sizeClass + 1) * 16;
+    }
+
+    const unsigned group = (sizeClass - 8) / 4;
+    const unsigned step = (sizeClass - 8) % 4;
+    return static_cast<size_t>(5 + step) << (group + 5);
+}
+
+uint32_t SlabAllocator::GetMagazineCapacity(unsigned sizeClass) noexcept
+{
+    // About 4KB worth of blocks per class, but at least a few of the largest ones.
+    const size_t capacity = 4096 / GetClassSize(sizeClass);
+    return capacity < 8 ? 8 : capacity > 64 ? 64 : static_cast<uint32_t>(capacity);
+}
+
+bool SlabAllocator::IsSlabBlock(const void* block) const noexcept
+{
+    const uint8_t* address = static_cast<const uint8_t*>(block);
+    return m_base != nullptr && address >= m_base && address < m_base + SLAB_ALLOCATOR_RESERVED_SIZE;
+}
+
+void* SlabAllocator::Allocate(size_t size) noexcept
+{
+    ThreadCache* cache = m_initialized ? GetThreadCache() : nullptr;
+    if (size > SLAB_ALLOCATOR_MAX_SMALL_SIZE || !m_initialized)
+    {
+        return AllocateLarge(size, cache);
+    }
+
+    const unsigned sizeClass = GetSizeClass(size);
+    const int64_t classSize = static_cast<int64_t>(GetClassSize(sizeClass));
+
+    FreeBlock* block = nullptr;
+    if (cache != nullptr)
+    {
+        Magazine& magazine = cache->Magazines[sizeClass];
+        if (magazine.Head != nullptr || Refill(magazine, sizeClass, GetMagazineCapacity(sizeClass) / 2) > 0)
+        {
+            block = magazine.Head;
+            magazine.Head = block->Next;
+            magazine.Count--;
+
+            AddRelaxed<uint64_t>(cache->Stats.SmallAllocations, 1);
+            AddRelaxed<int64_t>(cache->Stats.SmallBytesInUse, classSize);
+        }
+    }
+    else
+    {
+        Magazine single = { nullptr, 0 };
+        if (Refill(single, sizeClass, 1) > 0)
+        {
+            block = single.Head;
+
+            m_sharedStats.SmallAllocations.fetch_add(1, std::memory_order_relaxed);
+            m_sharedStats.SmallBytesInUse.fetch_add(classSize, std::memory_order_relaxed);
+        }
+    }
+
+    if (block == nullptr)
+    {
+        // The slab range is used up (or could not be committed).
+        return AllocateLarge(size, cache);
+    }
+
+    memset(block, 0, size);
+    return block;
+}
+
+void SlabAllocator::Free(void* block) noexcept
+{
+    if (block == nullptr)
+    {
+        return;
+    }
+
+    if (!IsSlabBlock(block))
+    {
+        FreeLarge(block);
+        return;
+    }
+
+    const size_t slab = static_cast<size_t>(static_cast<uint8_t*>(block) - m_base) / SLAB_ALLOCATOR_SLAB_SIZE;
+    const unsigned sizeClass = m_slabClasses[slab];
+    const int64_t classSize = static_cast<int64_t>(GetClassSize(sizeClass));
+    FreeBlock* freeBlock = static_cast<FreeBlock*>(block);
+
+    ThreadCache* cache = m_initialized ? GetThreadCache() : nullptr;
+    if (cache == nullptr)
+    {
+        m_sharedStats.SmallBytesInUse.fetch_sub(classSize, std::memory_order_relaxed);
+        FreeToCentral(freeBlock, freeBlock, sizeClass);
+        return;
+    }
+
+    AddRelaxed<int64_t>(cache->Stats.SmallBytesInUse, -classSize);
+
+    // Blocks freed by a thread other than the one that allocated them simply join the freeing thread's magazine.
+    Magazine& magazine = cache->Magazines[sizeClass];
+    freeBlock->Next = magazine.Head;
+    magazine.Head = freeBlock;
+    magazine.Count++;
+
+    const uint32_t capacity = GetMagazineCapacity(sizeClass);
+    if (magazine.Count >= capacity)
+    {
+        FlushMagazine(magazine, sizeClass, capacity / 2);
+    }
+}
+
+void SlabAllocator::ReleaseThreadCache() noexcept
+{
+    if (!m_initialized)
+    {
+        return;
+    }
+
+    ThreadCache* cache = static_cast<ThreadCache*>(GetTlsValue(m_tlsIndex));
+    if (cache != nullptr)
+    {
+        SetTlsValue(m_tlsIndex, nullptr);
+        ReleaseCache(cache);
+    }
+}
+
+void SlabAllocator::GetStatistics(SlabAllocatorStatistics& statistics) const noexcept
+{
+    statistics.SmallAllocations = m_sharedStats.SmallAllocations.load(std::memory_order_relaxed);
+    statistics.SmallBytesInUse = m_sharedStats.SmallBytesInUse.load(std::memory_order_relaxed);
+    statistics.LargeAllocations = m_sharedStats.LargeAllocations.load(std::memory_order_relaxed);
+
+    for (const ThreadCache* cache = m_caches.load(); cache != nullptr; cache = cache->NextCache)
+    {
+        statistics.SmallAllocations += cache->Stats.SmallAllocations.load(std::memory_order_relaxed);
+        statistics.SmallBytesInUse += cache->Stats.SmallBytesInUse.load(std::memory_order_relaxed);
+        statistics.LargeAllocations += cache->Stats.LargeAllocations.load(std::memory_order_relaxed);
+    }
+
+    statistics.LargeBytesInUse = m_largeBytesInUse.load(std::memory_order_relaxed);
+    statistics.PeakLargeBytes = m_peakLargeBytes.load(std::memory_order_relaxed);
+    statistics.CommittedSlabBytes = static_cast<uint64_t>(m_committedSlabCount.load()) * SLAB_ALLOCATOR_SLAB_SIZE;
+}
+
+SlabAllocator::ThreadCache* SlabAllocator::GetThreadCache() noexcept
+{
+    ThreadCache* cache = static_cast<ThreadCache*>(GetTlsValue(m_tlsIndex));
+    return cache != nullptr ? cache : AcquireThreadCache();
+}
+
+SlabAllocator::ThreadCache* SlabAllocator::AcquireThreadCache() noexcept
+{
+    ThreadCache* cache = nullptr;
+    for (ThreadCache* candidate = m_caches.load(); candidate != nullptr; candidate = candidate->NextCache)
+    {
+        bool inUse = false;
+        if (!candidate->InUse.load() && candidate->InUse.compare_exchange_strong(inUse, true))
+        {
+            cache = candidate;
+            break;
+        }
+    }
+
+    if (cache == nullptr)
+    {
+        void* memory = AllocateLargeBlock(sizeof(ThreadCache));
+        if (memory == nullptr)
+        {
+            return nullptr;
+        }
+
+        cache = new (memory) ThreadCache();
+        cache->Owner = this;
+        cache->InUse.store(true);
+
+        ThreadCache* head = m_caches.load();
+        do
+        {
+            cache->NextCache = head;
+        } while (!m_caches.compare_exchange_weak(head, cache));
+    }
+
+    if (!SetTlsValue(m_tlsIndex, cache))
+    {
+        cache->InUse.store(false);
+        return nullptr;
+    }
+
+    return cache;
+}
+
+void SlabAllocator::ReleaseCache(ThreadCache* cache) noexcept
+{
+    for (unsigned sizeClass = 0; sizeClass < SLAB_ALLOCATOR_CLASS_COUNT; sizeClass++)
+    {
+        FlushMagazine(cache->Magazines[sizeClass], sizeClass, 0);
+    }
+
+    cache->InUse.store(false);
+}
+
+void SlabAllocator::FlushMagazine(Magazine& magazine, unsigned sizeClass, uint32_t keep) noexcept
+{
+    if (magazine.Count <= keep)
+    {
+        return;
+    }
+
+    // Keep the most recently freed blocks, which are the likeliest to still be in the cache, and hand back the rest.
+    FreeBlock* lastKept = nullptr;
+    FreeBlock* first = magazine.Head;
+    for (uint32_t i = 0; i < keep; i++)
+    {
+        lastKept = first;
+        first = first->Next;
+    }
+
+    FreeBlock* last = first;
+    while (last->Next != nullptr)
+    {
+        last = last->Next;
+    }
+
+    if (lastKept != nullptr)
+    {
+        lastKept->Next = nullptr;
+    }
+    else
+    {
+        magazine.Head = nullptr;
+    }
+
+    magazine.Count = keep;
+    FreeToCentral(first, last, sizeClass);
+}
+
+uint32_t SlabAllocator::Refill(Magazine& magazine, unsigned sizeClass, uint32_t count) noexcept
+{
+    CentralList& list = m_central[sizeClass];
+    const size_t classSize = GetClassSize(sizeClass);
+
+    uint32_t moved = 0;
+    LockCentral(list);
+    while (moved < count)
+    {
+        FreeBlock* block = list.Head;
+        if (block != nullptr)
+        {
+            list.Head = block->Next;
+        }
+        else
+        {
+            if (list.Cursor == list.End && !TryAssignSlab(list, sizeClass))
+            {
+                break;
+            }
+
+            block = reinterpret_cast<FreeBlock*>(list.Cursor);
+            list.Cursor += classSize;
+        }
+
+        block->Next = magazine.Head;
+        magazine.Head = block;
+        moved++;
+    }
+
+    UnlockCentral(list);
+
+    magazine.Count += moved;
+    return moved;
+}
+
+bool SlabAllocator::TryAssignSlab(CentralList& list, unsigned sizeClass) noexcept
+{
+    const size_t slab = m_slabCount.fetch_add(1);
+    if (slab >= SLAB_ALLOCATOR_MAX_SLABS)
+    {
+        return false;
+    }
+
+    uint8_t* start = m_base + slab * SLAB_ALLOCATOR_SLAB_SIZE;
+    if (!CommitMemory(start, SLAB_ALLOCATOR_SLAB_SIZE))
+    {
+        return false;
+    }
+
+    m_committedSlabCount.fetch_add(1);
+
+    // The class is recorded before any block of the slab is handed out, so a free always finds it.
+    m_slabClasses[slab] = static_cast<uint8_t>(sizeClass);
+
+    const size_t classSize = GetClassSize(sizeClass);
+    list.Cursor = start;
+    list.End = start + (SLAB_ALLOCATOR_SLAB_SIZE / classSize) * classSize;
+    return true;
+}
+
+void SlabAllocator::FreeToCentral(FreeBlock* first, FreeBlock* last, unsigned sizeClass) noexcept
+{
+    CentralList& list = m_central[sizeClass];
+    LockCentral(list);
+    last->Next = list.Head;
+    list.Head = first;
+    UnlockCentral(list);
+}
+
+void SlabAllocator::LockCentral(CentralList& list) noexcept
+{
+    // Critical sections are short (moving a few dozen blocks, or committing a slab), so spinning beats any OS lock,
+    // and unlike most OS locks it needs no initialization and is safe under the loader lock.
+    while (list.Lock.exchange(true, std::memory_order_acquire))
+    {
+        while (list.Lock.load(std::memory_order_relaxed))
+        {
+            YieldThread();
+        }
+    }
+}
+
+void SlabAllocator::UnlockCentral(CentralList& list) noexcept
+{
+    list.Lock.store(false, std::memory_order_release);
+}
+
+void* SlabAllocator::AllocateLarge(size_t size, ThreadCache* cache) noexcept
+{
+    if (size > SIZE_MAX - sizeof(LargeBlockHeader))
+    {
+        return nullptr;
+    }
+
+    LargeBlockHeader* header = static_cast<LargeBlockHeader*>(AllocateLargeBlock(sizeof(LargeBlockHeader) + size));
+    if (header == nullptr)
+    {
+        return nullptr;
+    }
+
+    header->Size = size;
+
+    if (cache != nullptr)
+    {
+        AddRelaxed<uint64_t>(cache->Stats.LargeAllocations, 1);
+    }
+    else
+    {
+        m_sharedStats.LargeAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const int64_t inUse = m_largeBytesInUse.fetch_add(static_cast<int64_t>(size)) + static_cast<int64_t>(size);
+    int64_t peak = m_peakLargeBytes.load();
+    while (inUse > peak && !m_peakLargeBytes.compare_exchange_weak(peak, inUse))
+    {
+    }
+
+    return header + 1;
+}
+
+void SlabAllocator::FreeLarge(void* block) noexcept
+{
+    LargeBlockHeader* header = static_cast<LargeBlockHeader*>(block) - 1;
+    m_largeBytesInUse.fetch_sub(static_cast<int64_t>(header->Size));
+    FreeLargeBlock(header);
+}
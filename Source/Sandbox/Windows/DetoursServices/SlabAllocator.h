@@ -0,0 +1,185 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Size of a slab, i.e., of the unit in which memory for small blocks is committed. Every slab serves a single size class.
+#define SLAB_ALLOCATOR_SLAB_SIZE 0x10000U
+
+// Largest block served from slabs. Larger requests go to the large block allocator (the private heap on Windows).
+#define SLAB_ALLOCATOR_MAX_SMALL_SIZE 1024U
+
+// Number of size classes: multiples of 16 bytes up to 128 bytes, then four classes per power of two up to SLAB_ALLOCATOR_MAX_SMALL_SIZE.
+#define SLAB_ALLOCATOR_CLASS_COUNT 20U
+
+// Address space reserved up front for slabs. Memory is only committed one slab at a time, as size classes need it;
+// once the reservation is used up, small blocks come from the large block allocator too.
+#if defined(_WIN64) || defined(__LP64__)
+#define SLAB_ALLOCATOR_RESERVED_SIZE 0x40000000ULL
+#else
+#define SLAB_ALLOCATOR_RESERVED_SIZE 0x4000000ULL
+#endif
+
+#define SLAB_ALLOCATOR_MAX_SLABS (SLAB_ALLOCATOR_RESERVED_SIZE / SLAB_ALLOCATOR_SLAB_SIZE)
+
+// Allocation statistics, summed over all threads when requested.
+struct SlabAllocatorStatistics
+{
+    // Number of small blocks handed out so far, and bytes (rounded up to the size class) currently held by callers.
+    uint64_t SmallAllocations;
+    int64_t SmallBytesInUse;
+
+    // Number of large blocks handed out so far, bytes currently held by callers and the peak of the latter.
+    uint64_t LargeAllocations;
+    int64_t LargeBytesInUse;
+    int64_t PeakLargeBytes;
+
+    // Memory committed for slabs. Slabs are never decommitted, so this is also the peak footprint of small blocks.
+    uint64_t CommittedSlabBytes;
+
+    // Upper bound of the peak memory footprint of the allocator.
+    int64_t PeakBytes() const noexcept { return static_cast<int64_t>(CommittedSlabBytes) + PeakLargeBytes; }
+};
+
+// Memory allocator for the many small, short lived objects of the sandbox (policy results, path strings, report lines).
+//
+// Small requests are rounded up to one of SLAB_ALLOCATOR_CLASS_COUNT size classes. Each thread keeps a magazine of free blocks per class
+// (a singly linked list threaded through the blocks themselves), so most allocations and frees touch no shared state at all.
+// When a magazine runs empty (or full) half a magazine worth of blocks is moved from (or to) the central free list of the class,
+// which is protected by a spin lock; the central list is refilled by carving new slabs. Slabs live in a single reserved range of
+// address space, so a free finds the class of a block from its address alone and blocks need no header.
+//
+// Large blocks carry a small header with their size and come from the platform's large block allocator: HeapAlloc on the private heap
+// on Windows, calloc elsewhere. Slabs come from VirtualAlloc on Windows and mmap elsewhere.
+//
+// Nothing here takes a loader-lock-sensitive lock or depends on the CRT being initialized, so the allocator is usable from DllMain.
+// Per-thread state is found through an explicitly allocated TLS slot rather than through compiler-supported thread-local variables,
+// which are not reliably available in every context Detours runs in (e.g. while dispatching some exceptions).
+//
+// All memory handed out is zeroed, as HeapAlloc with HEAP_ZERO_MEMORY would.
+class SlabAllocator
+{
+public:
+    // Reserves the slab address range and the TLS slot. Returns false if either fails, in which case every request goes to the large block allocator.
+    bool Initialize() noexcept;
+
+    // Frees the thread caches and the TLS slot. The slab address range stays reserved and committed, so that small blocks freed after this
+    // (e.g. by the destructors of globals that run later) are still recognized as slab blocks and go back to the central free lists rather
+    // than to the large block allocator. Large blocks must not be freed once the large block allocator itself is gone.
+    void Destroy() noexcept;
+
+    void* Allocate(size_t size) noexcept;
+    void Free(void* block) noexcept;
+
+    // Returns the blocks cached by the calling thread to the central free lists. To be called when a thread exits.
+    void ReleaseThreadCache() noexcept;
+
+    // Sums the per-thread counters. Counters of threads that are allocating concurrently may be slightly stale.
+    void GetStatistics(SlabAllocatorStatistics& statistics) const noexcept;
+
+    // Size class of a small request, in [0, SLAB_ALLOCATOR_CLASS_COUNT).
+    static unsigned GetSizeClass(size_t size) noexcept;
+
+    // Block size of a size class.
+    static size_t GetClassSize(unsigned sizeClass) noexcept;
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* Next;
+    };
+
+    struct Magazine
+    {
+        FreeBlock* Head;
+        uint32_t Count;
+    };
+
+    // Counters updated by a single thread at a time and read by GetStatistics.
+    struct Counters
+    {
+        std::atomic<uint64_t> SmallAllocations;
+        std::atomic<int64_t> SmallBytesInUse;
+        std::atomic<uint64_t> LargeAllocations;
+    };
+
+    // Per-thread cache. Caches live until Destroy: a cache released by an exiting thread is reused by the next new thread,
+    // and its counters keep accumulating.
+    struct ThreadCache
+    {
+        SlabAllocator* Owner;
+        ThreadCache* NextCache;
+        std::atomic<bool> InUse;
+        Magazine Magazines[SLAB_ALLOCATOR_CLASS_COUNT];
+        Counters Stats;
+    };
+
+    struct CentralList
+    {
+        std::atomic<bool> Lock;
+        FreeBlock* Head;
+
+        // Uncarved part of the slab most recently assigned to the class.
+        uint8_t* Cursor;
+        uint8_t* End;
+    };
+
+    // Header of a large block. Keeps the payload 16 bytes aligned.
+    struct alignas(16) LargeBlockHeader
+    {
+        size_t Size;
+    };
+
+    static uint32_t GetMagazineCapacity(unsigned sizeClass) noexcept;
+
+    // Adds to a counter of a thread cache, which only its owner thread updates, without paying for an interlocked operation.
+    template<typename T>
+    static void AddRelaxed(std::atomic<T>& counter, T value) noexcept
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    bool IsSlabBlock(const void* block) const noexcept;
+
+    ThreadCache* GetThreadCache() noexcept;
+    ThreadCache* AcquireThreadCache() noexcept;
+    void ReleaseCache(ThreadCache* cache) noexcept;
+    void FlushMagazine(Magazine& magazine, unsigned sizeClass, uint32_t keep) noexcept;
+
+    // Moves up to 'count' blocks of the given class from the central list into 'magazine'. Returns the number of blocks moved.
+    uint32_t Refill(Magazine& magazine, unsigned sizeClass, uint32_t count) noexcept;
+    bool TryAssignSlab(CentralList& list, unsigned sizeClass) noexcept;
+    void FreeToCentral(FreeBlock* first, FreeBlock* last, unsigned sizeClass) noexcept;
+
+    void LockCentral(CentralList& list) noexcept;
+    void UnlockCentral(CentralList& list) noexcept;
+
+    void* AllocateLarge(size_t size, ThreadCache* cache) noexcept;
+    void FreeLarge(void* block) noexcept;
+
+    uint8_t* m_base;
+
+    // Slabs assigned to a class so far (may overshoot SLAB_ALLOCATOR_MAX_SLABS once the range is used up), and slabs actually committed.
+    std::atomic<size_t> m_slabCount;
+    std::atomic<size_t> m_committedSlabCount;
+    uint8_t m_slabClasses[SLAB_ALLOCATOR_MAX_SLABS];
+    CentralList m_central[SLAB_ALLOCATOR_CLASS_COUNT];
+
+    // Per-thread caches, most recently created first.
+    std::atomic<ThreadCache*> m_caches;
+
+    // Counters for the threads that could not get a cache.
+    Counters m_sharedStats;
+
+    // Large blocks are tracked globally, as their peak is needed. They are the minority, and already pay for a call to the large block allocator.
+    std::atomic<int64_t> m_largeBytesInUse;
+    std::atomic<int64_t> m_peakLargeBytes;
+
+    // TLS index (Windows) or pthread key holding the calling thread's cache.
+    unsigned long m_tlsIndex;
+    bool m_initialized;
+};
@@ -10,6 +10,7 @@
 
 #include "stdafx.h"
 #include "StringOperations.h"
+#include "PathCharBlocks.h"
 #include <cwctype>
 
 #if MAC_OS_LIBRARY
@@ -32,20 +33,19 @@
 // 
 #pragma warning( disable : 26472 26493 26461 26446 26482 )
 
-// Magic numbers known to provide good hash distributions.
-// See here: http://www.isthe.com/chongo/tech/comp/fnv/
-
-constexpr DWORD Fnv1Prime32 = 16777619;
-constexpr DWORD Fnv1Basis32 = static_cast<const unsigned int>(2166136261);
+// What NormalizePathChar does to ASCII characters, which lets the primitives below fold and compare whole blocks of them at once.
+#if __linux__
+static const PathCharBlocks::AsciiFold NormalizePathCharAsciiFold = PathCharBlocks::AsciiFold::None;
+#else
+static const PathCharBlocks::AsciiFold NormalizePathCharAsciiFold = PathCharBlocks::AsciiFold::Upper;
+#endif
 
-constexpr inline static DWORD _Fold(DWORD hash, BYTE value) noexcept
-{
-    return (hash * Fnv1Prime32) ^ (DWORD)value;
-}
+// Number of characters HashPath normalizes at once before folding them into the hash.
+#define HASH_PATH_CHUNK_LENGTH 64
 
-constexpr inline static DWORD Fold(DWORD hash, WORD value) noexcept
+static inline PathChar NormalizePathCharFunction(PathChar c) noexcept
 {
-    return _Fold(_Fold(hash, (BYTE)value), (BYTE)(((WORD)value) >> 8));
+    return NormalizePathChar(c);
 }
 
 #pragma warning( push )
@@ -60,15 +60,17 @@ DWORD WINAPI NormalizeAndHashPath(
     assert((pathlen(pPath) + 1)*sizeof(PathChar) == nBufferLength);
 
     // not the fastest hashing implementation, but gives awesome distribution
+    const size_t length = pathlen(pPath);
+    PPathChar normalized = (PPathChar)pBuffer;
+    PathCharBlocks::FoldInto(pPath, normalized, length, NormalizePathCharAsciiFold, NormalizePathCharFunction);
+    normalized[length] = 0;
+
     DWORD hash = Fnv1Basis32;
     size_t i;
-    for (i = 0; pPath[i]; i++) {
-        const PathChar c = NormalizePathChar(pPath[i]);
-        ((PPathChar)pBuffer)[i] = c;
-        hash = Fold(hash, c);
+    for (i = 0; i < length; i++) {
+        hash = FoldPathHash(hash, normalized[i]);
     }
 
-    ((PPathChar)pBuffer)[i] = 0;
     assert((i + 1)*sizeof(PathChar) == nBufferLength);
     assert(hash == HashPath(pPath, i));
     return hash;
@@ -81,12 +83,17 @@ DWORD WINAPI HashPath(
 {
     assert(pPath != nullptr);
 
-    // not the fastest hashing implementation, but gives awesome distribution
+    // not the fastest hashing implementation, but gives awesome distribution.
+    // Normalizing a chunk at a time keeps NormalizePathChar off the path for ASCII characters; folding the hash is inherently sequential.
     DWORD hash = Fnv1Basis32;
-    size_t i;
-    for (i = 0; i < nLength; i++) {
-        const PathChar c = NormalizePathChar(pPath[i]);
-        hash = Fold(hash, c);
+    PathChar normalized[HASH_PATH_CHUNK_LENGTH];
+    for (size_t start = 0; start < nLength; start += HASH_PATH_CHUNK_LENGTH) {
+        const size_t chunkLength = nLength - start < HASH_PATH_CHUNK_LENGTH ? nLength - start : HASH_PATH_CHUNK_LENGTH;
+        PathCharBlocks::FoldInto(pPath + start, normalized, chunkLength, NormalizePathCharAsciiFold, NormalizePathCharFunction);
+
+        for (size_t i = 0; i < chunkLength; i++) {
+            hash = FoldPathHash(hash, normalized[i]);
+        }
     }
 
     return hash;
@@ -102,21 +109,29 @@ BOOL WINAPI AreBuffersEqual(
 
 BOOL WINAPI ArePathsEqual(
     __in_ecount(nLength)        PCPathChar pPath,
-    __in_ecount(nLength + 1)    PCPathChar pNormalizedPath,
+    __in_z                      PCPathChar pNormalizedPath,
     __in                        size_t nLength) noexcept
 {
     assert(pPath != nullptr);
     assert(pNormalizedPath != nullptr);
 
-    size_t i;
-    for (i = 0; i < nLength; i++) {
-        const PathChar c = NormalizePathChar(pPath[i]);
-        if (c != pNormalizedPath[i]) {
-            return false;
-        }
+    // The normalized path may be shorter than nLength (e.g. the partial path of a manifest record whose hash collides).
+    // Find its length first, stopping past nLength, so that the block compare never reads beyond its terminator.
+    size_t normalizedLength = 0;
+    while (normalizedLength <= nLength && pNormalizedPath[normalizedLength]) {
+        normalizedLength++;
     }
 
-    return !pNormalizedPath[i];
+    return normalizedLength == nLength
+        && PathCharBlocks::IsFoldedEqualTo(pPath, pNormalizedPath, nLength, NormalizePathCharAsciiFold, NormalizePathCharFunction);
+}
+
+bool ArePathCharsEqual(PCPathChar path1, PCPathChar path2, size_t length) noexcept
+{
+    assert(path1 != nullptr || length == 0);
+    assert(path2 != nullptr || length == 0);
+
+    return PathCharBlocks::AreFoldedEqual(path1, path2, length, NormalizePathCharAsciiFold, NormalizePathCharFunction);
 }
 
 bool HasPrefix(PCPathChar str, PCPathChar prefix) noexcept
@@ -139,6 +154,14 @@ bool HasPrefix(PCPathChar str, PCPathChar prefix) noexcept
     }
 }
 
+bool HasPrefix(PCPathChar str, size_t strLength, PCPathChar prefix, size_t prefixLength) noexcept
+{
+    assert(str != nullptr);
+    assert(prefix != nullptr);
+
+    return prefixLength <= strLength && ArePathCharsEqual(str, prefix, prefixLength);
+}
+
 #pragma warning(push)
 // warning C6387: 'suffix' could be '0'.
 #pragma warning( disable : 6387 )
@@ -152,15 +175,7 @@ bool HasSuffix(PCPathChar str, size_t str_length, PCPathChar suffix) noexcept
         return false;
     }
 
-    for (size_t i = 0; i < suffix_length; i++) {
-        const PathChar c1 = str[str_length - i - 1];
-        const PathChar c2 = suffix[suffix_length - i - 1];
-        if (!IsPathCharEqual(c1, c2)) {
-            return false;
-        }
-    }
-
-    return true;
+    return ArePathCharsEqual(str + str_length - suffix_length, suffix, suffix_length);
 }
 #pragma warning(pop)
 
@@ -264,12 +279,8 @@ bool IsPathWithinTree(PCPathChar tree, PCPathChar path) noexcept
             return false;
         }
 
-        for (size_t i = 0; i < treeElementLength; i++) {
-            const PathChar ct = tree[treeElementStart + i];
-            const PathChar cp = path[pathElementStart + i];
-            if (!IsPathCharEqual(ct, cp)) {
-                return false;
-            }
+        if (!ArePathCharsEqual(tree + treeElementStart, path + pathElementStart, treeElementLength)) {
+            return false;
         }
 
         // Path element looks the same in both.
@@ -474,6 +485,11 @@ std::basic_string<PathChar> GetCommandLineFromArgv(const PathChar * const * argv
 #if _WIN32
 
 size_t GetRootLength(PCPathChar path) noexcept
+{
+    return path == nullptr ? 0 : GetRootLength(path, pathlen(path));
+}
+
+size_t GetRootLength(PCPathChar path, size_t pathLength) noexcept
 {
     if (path == nullptr)
     {
@@ -484,9 +500,9 @@ size_t GetRootLength(PCPathChar path) noexcept
     size_t volumeSeparatorLength = 2;  // Length to the colon "C:"
     size_t uncRootLength = 2;          // Length to the start of the server name "\\"
 
-    const bool extendedSyntax = HasPrefix(path, NT_LONG_PATH_PREFIX) || HasPrefix(path, NT_PATH_PREFIX);
-    const bool extendedUncSyntax = HasPrefix(path, LONG_UNC_PATH_PREFIX);
-    const size_t pathLength = pathlen(path);
+    const bool extendedSyntax = HasPrefix(path, pathLength, NT_LONG_PATH_PREFIX, pathlen(NT_LONG_PATH_PREFIX))
+        || HasPrefix(path, pathLength, NT_PATH_PREFIX, pathlen(NT_PATH_PREFIX));
+    const bool extendedUncSyntax = HasPrefix(path, pathLength, LONG_UNC_PATH_PREFIX, pathlen(LONG_UNC_PATH_PREFIX));
 
     if (extendedSyntax)
     {
@@ -654,4 +670,18 @@ std::wstring PathCombine(const std::wstring& fragment1, const std::wstring& frag
         ? fragment1 + NT_DIRECTORY_SEPARATOR + fragment2
         : fragment1 + fragment2;
 }
+
+#else // _WIN32
+
+size_t GetRootLength(PCPathChar path) noexcept
+{
+    return path == nullptr ? 0 : GetRootLength(path, pathlen(path));
+}
+
+// The only root a Unix path can have is the leading directory separator.
+size_t GetRootLength(PCPathChar path, size_t pathLength) noexcept
+{
+    return path != nullptr && pathLength > 0 && path[0] == UNIX_DIRECTORY_SEPARATOR ? 1 : 0;
+}
+
 #endif // _WIN32
\ No newline at end of file
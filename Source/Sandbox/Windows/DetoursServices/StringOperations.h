@@ -20,12 +20,14 @@
 
 typedef WCHAR PathChar;
 #define pathlen wcslen
+#define PREFERRED_DIRECTORY_SEPARATOR NT_DIRECTORY_SEPARATOR
 #define BUILD_EXE_TRACE_FILE L"_buildc_dep_out.pass"
 
 #else
 
 typedef char PathChar;
 #define pathlen strlen
+#define PREFERRED_DIRECTORY_SEPARATOR UNIX_DIRECTORY_SEPARATOR
 #define BUILD_EXE_TRACE_FILE "_buildc_dep_out.pass"
 
 #endif
@@ -91,6 +93,35 @@ inline PathChar NormalizePathChar(PathChar c) noexcept
 #endif
 }
 
+// Magic numbers known to provide good hash distributions.
+// See here: http://www.isthe.com/chongo/tech/comp/fnv/
+
+constexpr DWORD Fnv1Prime32 = 16777619;
+constexpr DWORD Fnv1Basis32 = 2166136261u;
+
+constexpr inline DWORD FoldPathHashByte(DWORD hash, BYTE value) noexcept
+{
+    return (hash * Fnv1Prime32) ^ (DWORD)value;
+}
+
+/// FoldPathHash
+///
+/// Folds an already normalized path character into a running HashPath value.
+constexpr inline DWORD FoldPathHash(DWORD hash, WORD value) noexcept
+{
+    return FoldPathHashByte(FoldPathHashByte(hash, (BYTE)value), (BYTE)(((WORD)value) >> 8));
+}
+
+/// HashPathChar
+///
+/// Normalizes a path character and folds it into a running HashPath value. Starting from Fnv1Basis32 and
+/// applying this to every character of a path yields HashPath of that path, so hashes of a path and of
+/// all of its prefixes can be computed in a single pass.
+inline DWORD HashPathChar(DWORD hash, PathChar c) noexcept
+{
+    return FoldPathHash(hash, NormalizePathChar(c));
+}
+
 /// IsPathCharEqual
 ///
 /// Doing an ordinal comparison is appropriate for path characters.
@@ -218,14 +249,19 @@ BOOL WINAPI AreBuffersEqual(
     __in_ecount(nBufferLength)    PBYTE pBuffer2,
     __in                          DWORD nBufferLength) noexcept;
 
-// Check if a path is equal to a normalized path, after applying NormalizePathChar to all characters of the un-normalized path
+// Check if a path is equal to a normalized path, after applying NormalizePathChar to all characters of the un-normalized path.
+// The normalized path is null terminated and may have any length.
 BOOL WINAPI ArePathsEqual(
     __in_ecount(nLength)        PCPathChar pPath,
-    __in_ecount(nLength + 1)    PCPathChar pNormalizedPath,
+    __in_z                      PCPathChar pNormalizedPath,
     __in                        size_t nLength) noexcept;
 
+// ArePathCharsEqual compares the first 'length' characters of both paths using IsPathCharEqual
+bool ArePathCharsEqual(PCPathChar path1, PCPathChar path2, size_t length) noexcept;
+
 // HasPrefix and HasSuffix compare using IsPathCharEqual
 bool HasPrefix(PCPathChar text, PCPathChar prefix) noexcept;
+bool HasPrefix(PCPathChar text, size_t textLength, PCPathChar prefix, size_t prefixLength) noexcept;
 bool HasSuffix(PCPathChar str, size_t str_length, PCPathChar suffix) noexcept;
 
 // Returns true if 'path' is exactly equal to 'tree' (ignoring case),
@@ -260,6 +296,9 @@ bool IsPathToNamedStream(PCPathChar const path, size_t pathLength) noexcept;
 // Gets root length of a path.
 size_t GetRootLength(PCPathChar path) noexcept;
 
+// Gets root length of a path whose length is already known.
+size_t GetRootLength(PCPathChar path, size_t pathLength) noexcept;
+
 // Compares two strings in a case-insensitive manner
 bool AreEqualCaseInsensitively(const std::basic_string<PathChar>& s1, const std::basic_string<PathChar>& s2);
 
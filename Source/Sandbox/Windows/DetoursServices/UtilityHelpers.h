@@ -7,6 +7,12 @@
 #include <cwctype>
 #include <algorithm>
 #include "DataTypes.h"
+#include "PathCharBlocks.h"
+
+inline wint_t ToLowerStringChar(const wchar_t c)
+{
+    return towlower(c);
+}
 
 // Case-insensitive equality for wstrings
 struct CaseInsensitiveStringComparer {
@@ -19,16 +25,7 @@ struct CaseInsensitiveStringComparer {
                 return true;
             }
 
-            return std::equal(rhs.begin(), rhs.end(), lhs.begin(),
-                [](const wchar_t a, const wchar_t b)
-                {
-                    if (a == b)
-                    {
-                        return true;
-                    }
-
-                    return towlower(a) == towlower(b);
-                });
+            return PathCharBlocks::AreFoldedEqual(rhs.data(), lhs.data(), rhs.length(), PathCharBlocks::AsciiFold::Lower, ToLowerStringChar);
         }
         else {
             return false;
@@ -50,18 +47,9 @@ struct CaseInsensitiveStringLessThan {
             }
 
             // Paths in the same process tend to share a significant prefix in common. Starting backwards
-            // has a better chance to hit a difference first
-            const auto result = std::lexicographical_compare(rhs.rbegin(), rhs.rend(), lhs.rbegin(), lhs.rend(),
-                [](const wchar_t a, const wchar_t b)
-                {
-                    if (a == b)
-                    {
-                        return false;
-                    }
-
-                    return towlower(a) < towlower(b);
-                });
-           return result;
+            // has a better chance to hit a difference first. The last difference decides the order.
+            const size_t mismatch = PathCharBlocks::FindLastFoldedMismatch(rhs.data(), lhs.data(), rhs.length(), PathCharBlocks::AsciiFold::Lower, ToLowerStringChar);
+            return mismatch > 0 && ToLowerStringChar(rhs[mismatch - 1]) < ToLowerStringChar(lhs[mismatch - 1]);
         }
         else
         {
@@ -74,7 +62,7 @@ struct CaseInsensitiveStringLessThan {
 struct CaseInsensitiveStringHasher {
     size_t operator()(const std::wstring& str) const {
         std::wstring lowerstr(str);
-        std::transform(lowerstr.begin(), lowerstr.end(), lowerstr.begin(), towlower);
+        PathCharBlocks::FoldInto(lowerstr.data(), &lowerstr[0], lowerstr.length(), PathCharBlocks::AsciiFold::Lower, ToLowerStringChar);
 
         return std::hash<std::wstring>()(lowerstr);
     }
@@ -0,0 +1,121 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// xxHash64 (https://github.com/Cyan4973/xxHash), a non-cryptographic hash that runs at memory bandwidth.
+// Used to detect corruption of buffers handed over by the engine, such as the manifest tree.
+//
+// CODESYNC: Public/Src/Engine/Processes/FileAccessManifest.cs :: XxHash64
+// Both implementations must produce the same value for the same bytes.
+namespace XxHash64
+{
+    const uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+    const uint64_t Prime3 = 0x165667B19E3779F9ULL;
+    const uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+    const uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+    inline uint64_t RotateLeft(uint64_t value, int bits) noexcept
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    // Unaligned little-endian reads. The buffers hashed here are only guaranteed to be 4 bytes aligned.
+    inline uint64_t Read64(const uint8_t* p) noexcept
+    {
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint32_t Read32(const uint8_t* p) noexcept
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t Round(uint64_t accumulator, uint64_t input) noexcept
+    {
+        accumulator += input * Prime2;
+        accumulator = RotateLeft(accumulator, 31);
+        return accumulator * Prime1;
+    }
+
+    inline uint64_t MergeRound(uint64_t accumulator, uint64_t value) noexcept
+    {
+        accumulator ^= Round(0, value);
+        return accumulator * Prime1 + Prime4;
+    }
+
+    // Hashes 'length' bytes starting at 'data' in a single pass.
+    inline uint64_t Compute(const void* data, size_t length, uint64_t seed = 0) noexcept
+    {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        const uint8_t* const end = p + length;
+        uint64_t hash;
+
+        if (length >= 32)
+        {
+            // Four independent lanes, so that the multiplications of consecutive stripes overlap.
+            uint64_t v1 = seed + Prime1 + Prime2;
+            uint64_t v2 = seed + Prime2;
+            uint64_t v3 = seed;
+            uint64_t v4 = seed - Prime1;
+
+            const uint8_t* const limit = end - 32;
+            do
+            {
+                v1 = Round(v1, Read64(p));
+                v2 = Round(v2, Read64(p + 8));
+                v3 = Round(v3, Read64(p + 16));
+                v4 = Round(v4, Read64(p + 24));
+                p += 32;
+            } while (p <= limit);
+
+            hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+            hash = MergeRound(hash, v1);
+            hash = MergeRound(hash, v2);
+            hash = MergeRound(hash, v3);
+            hash = MergeRound(hash, v4);
+        }
+        else
+        {
+            hash = seed + Prime5;
+        }
+
+        hash += static_cast<uint64_t>(length);
+
+        for (; p + 8 <= end; p += 8)
+        {
+            hash ^= Round(0, Read64(p));
+            hash = RotateLeft(hash, 27) * Prime1 + Prime4;
+        }
+
+        if (p + 4 <= end)
+        {
+            hash ^= static_cast<uint64_t>(Read32(p)) * Prime1;
+            hash = RotateLeft(hash, 23) * Prime2 + Prime3;
+            p += 4;
+        }
+
+        for (; p < end; p++)
+        {
+            hash ^= static_cast<uint64_t>(*p) * Prime5;
+            hash = RotateLeft(hash, 11) * Prime1;
+        }
+
+        // Final avalanche.
+        hash ^= hash >> 33;
+        hash *= Prime2;
+        hash ^= hash >> 29;
+        hash *= Prime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+}
@@ -5,58 +5,29 @@
 
 #pragma once
 
-extern volatile LONG64 g_detoursMaxAllocatedMemoryInBytes;
-extern volatile LONG64 g_detoursHeapAllocatedMemoryInBytes;
+#include "SlabAllocator.h"
 
-#define BUILDXL_DETOURS_MEMORY_ALLOC_FLAGS HEAP_ZERO_MEMORY
+extern SlabAllocator g_detoursAllocator;
 
 // This file defines a memory interface for BuildXL Detours, using the dd_ prefix.
 // The general allocation APIs are stubbed out and one should call only the dd_* methods.
-// The memory allocation done from the BuildXL Detours library happens on a private heap.
+// The memory allocation done from the BuildXL Detours library happens in the detours allocator (see SlabAllocator.h):
+// small blocks come from slabs with per-thread caches, larger ones from a private heap.
 
-// malloc and free versions for this DLL.
+// malloc and free versions for this DLL. The returned memory is zeroed.
 inline void* dd_malloc(size_t size)
 {
     assert(g_hPrivateHeap != nullptr);
-    void* ret = HeapAlloc(g_hPrivateHeap, BUILDXL_DETOURS_MEMORY_ALLOC_FLAGS, size);
-
-     if (ret != nullptr && ShouldLogProcessData())
-     {
-         // Get the size since alignment matters and the actual allocated bytes can be a bit moe than size.
-         LONG64 allocatedSize = (LONG64)HeapSize(g_hPrivateHeap, BUILDXL_DETOURS_MEMORY_ALLOC_FLAGS, ret);
-         allocatedSize = InterlockedAdd64(&g_detoursHeapAllocatedMemoryInBytes, allocatedSize);
-         LONG64 localMax = InterlockedAdd64(&g_detoursMaxAllocatedMemoryInBytes, 0);
-       
-         // Update the global MaxAllocated heap only if the current allocated heap is bigger than what is recorded.
-         while (allocatedSize > localMax)
-         {
-             InterlockedCompareExchange64(&g_detoursMaxAllocatedMemoryInBytes, allocatedSize, localMax);
-             localMax = InterlockedAdd64(&g_detoursMaxAllocatedMemoryInBytes, 0);
-         }
-     }
-
-    return ret;
+    return g_detoursAllocator.Allocate(size);
 }
 
 inline void dd_free(void* pMem)
 {
     assert(g_hPrivateHeap != nullptr);
-    if (pMem == nullptr)
-    {
-        return;
-    }
-
-     if (ShouldLogProcessData())
-     {
-         // Get the size since alignment matters and the actual allocated bytes can be a bit moe than size.
-         LONG64 deallocatedSize = (LONG64)HeapSize(g_hPrivateHeap, BUILDXL_DETOURS_MEMORY_ALLOC_FLAGS, pMem);
-         InterlockedAdd64(&g_detoursHeapAllocatedMemoryInBytes, -(deallocatedSize));
-     }
-
-    HeapFree(g_hPrivateHeap, HEAP_ZERO_MEMORY, pMem);
+    g_detoursAllocator.Free(pMem);
 }
 
-// New news and deletes operators that call the private heap.
+// New news and deletes operators that call the detours allocator.
 inline void* operator new(size_t count)
 {
     return dd_malloc(count);
@@ -41,12 +41,12 @@ extern DWORD g_manifestSize;
 extern DWORD g_currentProcessId;
 extern PCWSTR g_currentProcessCommandLine;
 
+// The flags and pip id of the manifest the process was started with. They are not updated when the manifest is swapped;
+// use OperationManifest to read those of the manifest the current operation runs under.
 extern FileAccessManifestFlag g_fileAccessManifestFlags;
 extern FileAccessManifestExtraFlag g_fileAccessManifestExtraFlags;
 extern uint64_t g_FileAccessManifestPipId;
 
-extern PCManifestRecord g_manifestTreeRoot;
-
 extern PManifestChildProcessesToBreakAwayFromJob g_manifestChildProcessesToBreakAwayFromJob;
 extern vector<BreakawayChildProcess>* g_breakawayChildProcesses;
 extern PManifestTranslatePathsStrings g_manifestTranslatePathsStrings;
@@ -204,12 +204,8 @@ extern CreatePipe_t Real_CreatePipe;
 extern DeviceIoControl_t Real_DeviceIoControl;
 
 #if MEASURE_DETOURED_NT_CLOSE_IMPACT
-extern volatile LONG g_msTimeToPopulatePoolList;
 extern volatile ULONGLONG g_pipExecutionStart;
 extern volatile LONG g_ntCloseHandeCount;
-extern volatile LONG g_maxClosedListCount;
-extern volatile LONG g_msTimeInAddClosedList;
-extern volatile LONG g_msTimeInRemoveClosedList;
 #endif // MEASURE_DETOURED_NT_CLOSE_IMPACT
 
 #if MEASURE_REPARSEPOINT_RESOLVING_IMPACT
@@ -34,6 +34,7 @@
 #define __in
 #define __out
 #define __in_ecount(nBufferLength)
+#define __in_z
 #define __out_ecount(nBufferLength)
 
 #define Dbg(format, ...)
@@ -0,0 +1,228 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+// Two segments (1024 and 4096 slots, see ConcurrentHandleTable::AddSegment) are enough to cover growth, and small enough to fill up.
+// No other file of the test binary includes ConcurrentHandleTable.h, so the table is only ever instantiated with this limit.
+#define CONCURRENT_HANDLE_TABLE_MAX_SEGMENTS 2U
+
+#include "TestFramework.h"
+#include "ConcurrentHandleTable.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef ConcurrentHandleTable<std::string> StringTable;
+
+// Handle values are multiples of 4, and 0 to 2 are reserved.
+static uintptr_t Handle(size_t i)
+{
+    return (i + 1) * 4;
+}
+
+static std::string ValueOf(uintptr_t key, size_t version)
+{
+    return std::to_string(key) + ":" + std::to_string(version);
+}
+
+static bool Set(StringTable& table, uintptr_t key, const std::string& value)
+{
+    bool isNewKey;
+    std::string copy = value;
+    return table.Set(key, std::move(copy), isNewKey);
+}
+
+TEST(ConcurrentHandleTable, SetGetReplaceRemove)
+{
+    StringTable table;
+    std::string value;
+
+    EXPECT_FALSE(table.TryGet(Handle(0), value));
+
+    bool isNewKey = false;
+    std::string first = "first";
+    ASSERT_TRUE(table.Set(Handle(0), std::move(first), isNewKey));
+    EXPECT_TRUE(isNewKey);
+    ASSERT_TRUE(table.TryGet(Handle(0), value));
+    EXPECT_EQ(std::string("first"), value);
+    EXPECT_EQ(1U, table.Size());
+
+    std::string second = "second";
+    ASSERT_TRUE(table.Set(Handle(0), std::move(second), isNewKey));
+    EXPECT_FALSE(isNewKey);
+    ASSERT_TRUE(table.TryGet(Handle(0), value));
+    EXPECT_EQ(std::string("second"), value);
+    EXPECT_EQ(1U, table.Size());
+
+    EXPECT_TRUE(table.Remove(Handle(0)));
+    EXPECT_FALSE(table.Remove(Handle(0)));
+    EXPECT_FALSE(table.TryGet(Handle(0), value));
+    EXPECT_EQ(0U, table.Size());
+
+    // The tombstone does not hide the key from a new insertion
+    ASSERT_TRUE(table.Set(Handle(0), std::string("third"), isNewKey));
+    EXPECT_TRUE(isNewKey);
+    ASSERT_TRUE(table.TryGet(Handle(0), value));
+    EXPECT_EQ(std::string("third"), value);
+}
+
+TEST(ConcurrentHandleTable, GrowsPastTheFirstSegment)
+{
+    StringTable table;
+    const size_t count = 3000;
+    for (size_t i = 0; i < count; i++)
+    {
+        ASSERT_TRUE(Set(table, Handle(i), ValueOf(Handle(i), 0)));
+    }
+
+    EXPECT_EQ(count, table.Size());
+
+    // Keys of the first segment are removed and replaced through the newer one
+    for (size_t i = 0; i < count; i += 2)
+    {
+        ASSERT_TRUE(table.Remove(Handle(i)));
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        std::string value;
+        ASSERT_EQ(i % 2 == 1, table.TryGet(Handle(i), value));
+        if (i % 2 == 1)
+        {
+            ASSERT_EQ(ValueOf(Handle(i), 0), value);
+            ASSERT_TRUE(Set(table, Handle(i), ValueOf(Handle(i), 1)));
+            ASSERT_TRUE(table.TryGet(Handle(i), value));
+            ASSERT_EQ(ValueOf(Handle(i), 1), value);
+        }
+    }
+
+    EXPECT_EQ(count / 2, table.Size());
+}
+
+TEST(ConcurrentHandleTable, ReportsAFullTable)
+{
+    StringTable table;
+    size_t count = 0;
+    while (Set(table, Handle(count), ValueOf(Handle(count), 0)))
+    {
+        count++;
+        ASSERT_TRUE(count <= 1024 + 4096);
+    }
+
+    EXPECT_EQ(1024U + 4096U, count);
+    EXPECT_EQ(count, table.Size());
+
+    // The key is not there
+    std::string value;
+    EXPECT_FALSE(table.TryGet(Handle(count), value));
+
+    // Existing keys can still be replaced, and a removed key frees its slot for another one
+    EXPECT_TRUE(Set(table, Handle(0), "replaced"));
+    EXPECT_TRUE(table.Remove(Handle(1)));
+    EXPECT_TRUE(Set(table, Handle(count), "new"));
+    ASSERT_TRUE(table.TryGet(Handle(count), value));
+    EXPECT_EQ(std::string("new"), value);
+    EXPECT_FALSE(Set(table, Handle(count + 1), "full"));
+}
+
+TEST(ConcurrentHandleTable, ReadersSeeWholeValuesWhileWritersReplaceAndRemove)
+{
+    StringTable table;
+    const size_t keyCount = 64;
+    std::atomic<bool> stop(false);
+    std::atomic<size_t> torn(0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&table, &stop, &torn, t]()
+        {
+            std::string value;
+            for (size_t i = t; !stop.load(); i++)
+            {
+                const uintptr_t key = Handle(i % keyCount);
+                if (table.TryGet(key, value) && value.compare(0, value.find(':'), std::to_string(key)) != 0)
+                {
+                    torn++;
+                }
+            }
+        });
+    }
+
+    for (int t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&table, t]()
+        {
+            for (size_t i = 0; i < 20000; i++)
+            {
+                const uintptr_t key = Handle((i * 7 + t) % keyCount);
+                if (i % 3 == 0)
+                {
+                    table.Remove(key);
+                }
+                else
+                {
+                    // Long enough to live on the heap, so that a value read after being freed is caught by the sanitizers
+                    Set(table, key, ValueOf(key, i) + std::string(32, 'x'));
+                }
+            }
+        });
+    }
+
+    for (size_t i = 4; i < threads.size(); i++)
+    {
+        threads[i].join();
+    }
+
+    stop = true;
+    for (size_t i = 0; i < 4; i++)
+    {
+        threads[i].join();
+    }
+
+    EXPECT_EQ(0U, torn.load());
+}
+
+TEST(ConcurrentHandleTable, SizeStaysExactUnderRacingSetAndRemove)
+{
+    StringTable table;
+    const size_t keyCount = 8;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++)
+    {
+        threads.emplace_back([&table, t]()
+        {
+            for (size_t i = 0; i < 20000; i++)
+            {
+                const uintptr_t key = Handle((i + t) % keyCount);
+                if ((i + t) % 2 == 0)
+                {
+                    table.Remove(key);
+                }
+                else
+                {
+                    Set(table, key, "value");
+                }
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    size_t present = 0;
+    for (size_t i = 0; i < keyCount; i++)
+    {
+        std::string value;
+        if (table.TryGet(Handle(i), value))
+        {
+            present++;
+        }
+    }
+
+    EXPECT_EQ(present, table.Size());
+}
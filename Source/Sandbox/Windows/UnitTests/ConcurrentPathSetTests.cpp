@@ -0,0 +1,111 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "TestFramework.h"
+#include "PathTestHelpers.h"
+#include "ConcurrentPathSet.h"
+
+#include <atomic>
+#include <thread>
+
+static PathString NumberedPath(size_t i)
+{
+    return MakePath("/out/dir") + PathString(1, static_cast<PathChar>('a' + i % 26)) + MakePath("/file") + MakePath(std::to_string(i).c_str());
+}
+
+TEST(ConcurrentPathSet, InsertsEachPathOnce)
+{
+    ConcurrentPathSet set;
+    const PathString path = MakePath("/out/a.txt");
+
+    EXPECT_FALSE(set.Contains(path.c_str(), path.length(), HashPath(path)));
+    EXPECT_TRUE(set.TryInsert(path.c_str(), path.length(), HashPath(path)));
+    EXPECT_FALSE(set.TryInsert(path.c_str(), path.length(), HashPath(path)));
+    EXPECT_TRUE(set.Contains(path.c_str(), path.length(), HashPath(path)));
+    EXPECT_EQ(1U, set.Size());
+}
+
+TEST(ConcurrentPathSet, KeysAreNotNullTerminated)
+{
+    ConcurrentPathSet set;
+    const PathString path = MakePath("/out/a.txt");
+    const PathString prefix = MakePath("/out");
+
+    // Only the first 'length' characters are the key
+    EXPECT_TRUE(set.TryInsert(path.c_str(), prefix.length(), HashPath(prefix)));
+    EXPECT_TRUE(set.Contains(prefix.c_str(), prefix.length(), HashPath(prefix)));
+    EXPECT_FALSE(set.Contains(path.c_str(), path.length(), HashPath(path)));
+}
+
+TEST(ConcurrentPathSet, DistinguishesPathsWithTheSameHash)
+{
+    ConcurrentPathSet set;
+    const PathString a = MakePath("/out/a");
+    const PathString b = MakePath("/out/b");
+
+    // A forced collision: lookups have to compare the keys
+    EXPECT_TRUE(set.TryInsert(a.c_str(), a.length(), 42));
+    EXPECT_FALSE(set.Contains(b.c_str(), b.length(), 42));
+    EXPECT_TRUE(set.TryInsert(b.c_str(), b.length(), 42));
+    EXPECT_TRUE(set.Contains(a.c_str(), a.length(), 42));
+    EXPECT_TRUE(set.Contains(b.c_str(), b.length(), 42));
+    EXPECT_EQ(2U, set.Size());
+}
+
+TEST(ConcurrentPathSet, GrowsAndClears)
+{
+    ConcurrentPathSet set;
+    const size_t count = 20000;
+    for (size_t i = 0; i < count; i++)
+    {
+        const PathString path = NumberedPath(i);
+        ASSERT_TRUE(set.TryInsert(path.c_str(), path.length(), HashPath(path)));
+    }
+
+    EXPECT_EQ(count, set.Size());
+    for (size_t i = 0; i < count; i++)
+    {
+        const PathString path = NumberedPath(i);
+        ASSERT_TRUE(set.Contains(path.c_str(), path.length(), HashPath(path)));
+    }
+
+    set.Clear();
+    EXPECT_EQ(0U, set.Size());
+
+    const PathString path = NumberedPath(0);
+    EXPECT_FALSE(set.Contains(path.c_str(), path.length(), HashPath(path)));
+    EXPECT_TRUE(set.TryInsert(path.c_str(), path.length(), HashPath(path)));
+}
+
+TEST(ConcurrentPathSet, ConcurrentInsertsSucceedOncePerPath)
+{
+    ConcurrentPathSet set;
+    const size_t count = 5000;
+    const int threadCount = 8;
+    std::atomic<size_t> successes(0);
+
+    // Every thread inserts every path, so each one is contended
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++)
+    {
+        threads.emplace_back([&set, &successes, t]()
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                const PathString path = NumberedPath((i + t * 997) % count);
+                if (set.TryInsert(path.c_str(), path.length(), HashPath(path)))
+                {
+                    successes++;
+                }
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(count, successes.load());
+    EXPECT_EQ(count, set.Size());
+}
@@ -0,0 +1,398 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "TestFramework.h"
+#include "disasmlen.h"
+#include "peimage.h"
+
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+struct EncodedInstruction
+{
+    const char* Name;
+    std::vector<uint8_t> Bytes;
+    uint32_t Flags;
+};
+
+static const uint32_t Relative = DETOUR_INSTRUCTION_RELATIVE;
+static const uint32_t Dynamic = DETOUR_INSTRUCTION_DYNAMIC;
+static const uint32_t Indirect = DETOUR_INSTRUCTION_INDIRECT;
+
+// Instructions of both instruction sets. The displacements and immediates are filled with 0x11 so that they cannot be taken for opcodes.
+static const std::vector<EncodedInstruction>& GetCommonInstructions()
+{
+    static const std::vector<EncodedInstruction> instructions =
+    {
+        { "nop", { 0x90 }, 0 },
+        { "push ebp", { 0x55 }, 0 },
+        { "ret", { 0xC3 }, 0 },
+        { "ret 8", { 0xC2, 0x08, 0x00 }, 0 },
+        { "retf", { 0xCB }, Dynamic },
+        { "int 3", { 0xCC }, Dynamic },
+        { "mov ebp, esp", { 0x8B, 0xEC }, 0 },
+        { "sub esp, 0x20", { 0x83, 0xEC, 0x20 }, 0 },
+        { "sub esp, 0x1000", { 0x81, 0xEC, 0x00, 0x10, 0x00, 0x00 }, 0 },
+        { "sub sp, 0x1000", { 0x66, 0x81, 0xEC, 0x00, 0x10 }, 0 },
+        { "mov eax, [esp+8]", { 0x8B, 0x44, 0x24, 0x08 }, 0 },
+        { "mov eax, [esp+disp32]", { 0x8B, 0x84, 0x24, 0x11, 0x11, 0x11, 0x11 }, 0 },
+        { "mov eax, [ecx*4+disp32]", { 0x8B, 0x04, 0x8D, 0x11, 0x11, 0x11, 0x11 }, 0 },
+        { "mov eax, [ebp+ecx*4+8]", { 0x8B, 0x44, 0x8D, 0x08 }, 0 },
+        { "mov dword [eax], imm32", { 0xC7, 0x00, 0x11, 0x11, 0x11, 0x11 }, 0 },
+        { "mov cl, 1", { 0xB1, 0x01 }, 0 },
+        { "push imm32", { 0x68, 0x11, 0x11, 0x11, 0x11 }, 0 },
+        { "push imm8", { 0x6A, 0x11 }, 0 },
+        { "enter 16, 0", { 0xC8, 0x10, 0x00, 0x00 }, 0 },
+        { "test cl, 1", { 0xF6, 0xC1, 0x01 }, 0 },
+        { "not cl", { 0xF6, 0xD1 }, 0 },
+        { "test ecx, imm32", { 0xF7, 0xC1, 0x11, 0x11, 0x11, 0x11 }, 0 },
+        { "test cx, imm16", { 0x66, 0xF7, 0xC1, 0x11, 0x11 }, 0 },
+        { "neg dword [eax]", { 0xF7, 0x18 }, 0 },
+        { "call eax", { 0xFF, 0xD0 }, Dynamic },
+        { "jmp eax", { 0xFF, 0xE0 }, Dynamic },
+        { "jmp [eax+8]", { 0xFF, 0x60, 0x08 }, Dynamic },
+        { "push [eax]", { 0xFF, 0x30 }, 0 },
+        { "inc dword [eax]", { 0xFF, 0x00 }, 0 },
+        { "call rel32", { 0xE8, 0x11, 0x11, 0x11, 0x11 }, Relative },
+        { "jmp rel32", { 0xE9, 0x11, 0x11, 0x11, 0x11 }, Relative },
+        { "jmp rel8", { 0xEB, 0x11 }, Relative },
+        { "je rel8", { 0x74, 0x11 }, Relative },
+        { "je rel32", { 0x0F, 0x84, 0x11, 0x11, 0x11, 0x11 }, Relative },
+        { "movzx eax, byte [ecx]", { 0x0F, 0xB6, 0x01 }, 0 },
+        { "nop dword [eax+eax]", { 0x0F, 0x1F, 0x44, 0x00, 0x00 }, 0 },
+        { "lock xadd [ecx], eax", { 0xF0, 0x0F, 0xC1, 0x01 }, 0 },
+        { "rep movsb", { 0xF3, 0xA4 }, 0 },
+    };
+
+    return instructions;
+}
+
+static const std::vector<EncodedInstruction>& GetX86Instructions()
+{
+    static const std::vector<EncodedInstruction> instructions =
+    {
+        { "inc eax", { 0x40 }, 0 },
+        { "dec edi", { 0x4F }, 0 },
+        { "mov eax, [disp32]", { 0x8B, 0x05, 0x11, 0x11, 0x11, 0x11 }, 0 },
+        { "mov eax, [moffs32]", { 0xA1, 0x11, 0x11, 0x11, 0x11 }, 0 },
+        { "mov eax, [moffs16]", { 0x67, 0xA1, 0x11, 0x11 }, 0 },
+        { "mov eax, imm32", { 0xB8, 0x11, 0x11, 0x11, 0x11 }, 0 },
+        { "mov ax, imm16", { 0x66, 0xB8, 0x11, 0x11 }, 0 },
+        { "mov eax, fs:[0x18]", { 0x64, 0xA1, 0x18, 0x00, 0x00, 0x00 }, 0 },
+        { "jmp [abs32]", { 0xFF, 0x25, 0x11, 0x11, 0x11, 0x11 }, Indirect },
+        { "call [abs32]", { 0xFF, 0x15, 0x11, 0x11, 0x11, 0x11 }, Indirect },
+        { "call far", { 0x9A, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11 }, Dynamic },
+    };
+
+    return instructions;
+}
+
+static const std::vector<EncodedInstruction>& GetX64Instructions()
+{
+    static const std::vector<EncodedInstruction> instructions =
+    {
+        { "mov rbp, rsp", { 0x48, 0x89, 0xE5 }, 0 },
+        { "sub rsp, 0x28", { 0x48, 0x83, 0xEC, 0x28 }, 0 },
+        { "push r12", { 0x41, 0x54 }, 0 },
+        { "mov [rsp+8], rbx", { 0x48, 0x89, 0x5C, 0x24, 0x08 }, 0 },
+        { "mov rax, [rip+disp32]", { 0x48, 0x8B, 0x05, 0x11, 0x11, 0x11, 0x11 }, Relative },
+        { "lea rcx, [rip+disp32]", { 0x48, 0x8D, 0x0D, 0x11, 0x11, 0x11, 0x11 }, Relative },
+        { "cmp byte [rip+disp32], imm8", { 0x80, 0x3D, 0x11, 0x11, 0x11, 0x11, 0x11 }, Relative },
+        { "mov eax, [abs32]", { 0x8B, 0x04, 0x25, 0x11, 0x11, 0x11, 0x11 }, 0 },
+        { "mov eax, [moffs64]", { 0xA1, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11 }, 0 },
+        { "mov eax, [moffs32]", { 0x67, 0xA1, 0x11, 0x11, 0x11, 0x11 }, 0 },
+        { "mov eax, gs:[moffs64]", { 0x65, 0xA1, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11 }, 0 },
+        { "mov eax, imm32", { 0xB8, 0x11, 0x11, 0x11, 0x11 }, 0 },
+        { "mov rax, imm64", { 0x48, 0xB8, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11 }, 0 },
+        { "mov rax, imm32", { 0x48, 0xC7, 0xC0, 0x11, 0x11, 0x11, 0x11 }, 0 },
+        { "jmp [rip+disp32]", { 0xFF, 0x25, 0x11, 0x11, 0x11, 0x11 }, Relative | Indirect },
+        { "call [rip+disp32]", { 0xFF, 0x15, 0x11, 0x11, 0x11, 0x11 }, Relative | Indirect },
+        { "jmp r11", { 0x41, 0xFF, 0xE3 }, Dynamic },
+        { "call [rip+disp32] with rex", { 0x48, 0xFF, 0x15, 0x11, 0x11, 0x11, 0x11 }, Relative | Indirect },
+    };
+
+    return instructions;
+}
+
+// Decodes 'bytes' from an exactly sized heap buffer, so that reading past them is caught by the sanitizers.
+static bool Decode(const std::vector<uint8_t>& bytes, size_t count, bool x64, DETOUR_INSTRUCTION_LENGTH& length)
+{
+    std::vector<uint8_t> buffer(bytes.begin(), bytes.begin() + count);
+    return DetourDecodeInstructionLength(buffer.data(), buffer.size(), x64, &length);
+}
+
+static void CheckInstructions(const std::vector<EncodedInstruction>& instructions, bool x64)
+{
+    for (const EncodedInstruction& instruction : instructions)
+    {
+        DETOUR_INSTRUCTION_LENGTH length = {};
+        if (!EXPECT_TRUE(Decode(instruction.Bytes, instruction.Bytes.size(), x64, length)))
+        {
+            std::fprintf(stderr, "  %s (x64: %d)\n", instruction.Name, x64);
+            continue;
+        }
+
+        if (!EXPECT_EQ(static_cast<uint32_t>(instruction.Bytes.size()), length.cbInstruction)
+            || !EXPECT_EQ(instruction.Flags, length.fFlags))
+        {
+            std::fprintf(stderr, "  %s (x64: %d)\n", instruction.Name, x64);
+        }
+
+        // Bytes past the instruction don't change anything
+        std::vector<uint8_t> longer = instruction.Bytes;
+        longer.insert(longer.end(), 16, 0x90);
+        DETOUR_INSTRUCTION_LENGTH longerLength = {};
+        EXPECT_TRUE(Decode(longer, longer.size(), x64, longerLength));
+        EXPECT_EQ(length.cbInstruction, longerLength.cbInstruction);
+
+        // A truncated instruction is reported as such
+        for (size_t count = 0; count < instruction.Bytes.size(); count++)
+        {
+            DETOUR_INSTRUCTION_LENGTH truncated = {};
+            if (!EXPECT_FALSE(Decode(instruction.Bytes, count, x64, truncated)))
+            {
+                std::fprintf(stderr, "  %s truncated to %zu bytes (x64: %d)\n", instruction.Name, count, x64);
+            }
+        }
+    }
+}
+
+TEST(DisassemblerLength, DecodesX86Instructions)
+{
+    CheckInstructions(GetCommonInstructions(), false);
+    CheckInstructions(GetX86Instructions(), false);
+}
+
+TEST(DisassemblerLength, DecodesX64Instructions)
+{
+    CheckInstructions(GetCommonInstructions(), true);
+    CheckInstructions(GetX64Instructions(), true);
+}
+
+TEST(DisassemblerLength, MatchesCDetourDis)
+{
+    // The decoder reports the lengths CDetourDis copies, including where they are longer than the actual instruction:
+    // UD2 is copied as 0F plus two bytes, and MOV B8-BF ignores the operand-size prefix on x64.
+    const EncodedInstruction instructions[] =
+    {
+        { "ud2", { 0x0F, 0x0B, 0x11 }, 0 },
+        { "mov ax, imm16", { 0x66, 0xB8, 0x11, 0x11, 0x11, 0x11 }, 0 },
+    };
+
+    for (const EncodedInstruction& instruction : instructions)
+    {
+        DETOUR_INSTRUCTION_LENGTH length = {};
+        ASSERT_TRUE(Decode(instruction.Bytes, instruction.Bytes.size(), true, length));
+        EXPECT_EQ(static_cast<uint32_t>(instruction.Bytes.size()), length.cbInstruction);
+    }
+}
+
+TEST(DisassemblerLength, ReportsInvalidOpcodes)
+{
+    const std::vector<uint8_t> invalid[] = { { 0xD6 }, { 0xF1 }, { 0x0F, 0xFF } };
+    for (const std::vector<uint8_t>& bytes : invalid)
+    {
+        DETOUR_INSTRUCTION_LENGTH length = {};
+        ASSERT_TRUE(Decode(bytes, bytes.size(), true, length));
+        EXPECT_EQ(static_cast<uint32_t>(bytes.size()), length.cbInstruction);
+        EXPECT_EQ(static_cast<uint32_t>(DETOUR_INSTRUCTION_INVALID), length.fFlags);
+    }
+}
+
+TEST(DisassemblerLength, NeverReadsPastTheGivenBytes)
+{
+    // Random bytes, mostly prefixes and opcodes with operands, in exactly sized buffers
+    std::mt19937 random(7);
+    const uint8_t interesting[] = { 0x0F, 0x26, 0x48, 0x66, 0x67, 0xF0, 0xF3, 0xF6, 0xF7, 0xFF, 0x8B, 0xC7, 0x81, 0xA1, 0xB8, 0xE8, 0x04, 0x05, 0x44, 0x84 };
+    for (int iteration = 0; iteration < 100000; iteration++)
+    {
+        std::vector<uint8_t> bytes(1 + random() % 15);
+        for (uint8_t& byte : bytes)
+        {
+            byte = random() % 2 == 0 ? interesting[random() % sizeof(interesting)] : static_cast<uint8_t>(random());
+        }
+
+        for (bool x64 : { false, true })
+        {
+            DETOUR_INSTRUCTION_LENGTH length = {};
+            if (Decode(bytes, bytes.size(), x64, length))
+            {
+                ASSERT_TRUE(length.cbInstruction > 0);
+                ASSERT_TRUE(length.cbInstruction <= bytes.size());
+            }
+        }
+    }
+}
+
+// Bytes a prologue is sized over: the instructions a trampoline would get, and then some
+static const size_t PrologueSize = 32;
+
+// Prologues as compilers emit them, each padded with INT 3 to PrologueSize bytes
+static std::vector<std::vector<uint8_t>> GetTypicalPrologues(bool x64)
+{
+    std::vector<std::vector<uint8_t>> prologues = x64
+        ? std::vector<std::vector<uint8_t>>
+        {
+            // mov [rsp+8], rbx; mov [rsp+10h], rsi; push rdi; sub rsp, 20h; mov rdi, rcx
+            { 0x48, 0x89, 0x5C, 0x24, 0x08, 0x48, 0x89, 0x74, 0x24, 0x10, 0x57, 0x48, 0x83, 0xEC, 0x20, 0x48, 0x8B, 0xF9 },
+            // mov rax, rsp; mov [rax+8], rbx; push rbp; push rsi; push rdi; push r14; push r15; lea rbp, [rax-5Fh]; sub rsp, 0B0h
+            { 0x48, 0x8B, 0xC4, 0x48, 0x89, 0x58, 0x08, 0x55, 0x56, 0x57, 0x41, 0x56, 0x41, 0x57, 0x48, 0x8D, 0x68, 0xA1,
+              0x48, 0x81, 0xEC, 0xB0, 0x00, 0x00, 0x00 },
+            // sub rsp, 48h; mov rax, [rip+disp32]; xor rax, rsp; mov [rsp+38h], rax
+            { 0x48, 0x83, 0xEC, 0x48, 0x48, 0x8B, 0x05, 0x11, 0x11, 0x11, 0x11, 0x48, 0x33, 0xC4, 0x48, 0x89, 0x44, 0x24, 0x38 },
+            // mov r10, rcx; mov eax, 55h; test byte [7FFE0308h], 1; jne +3; syscall; ret (an ntdll stub)
+            { 0x4C, 0x8B, 0xD1, 0xB8, 0x55, 0x00, 0x00, 0x00, 0xF6, 0x04, 0x25, 0x08, 0x03, 0xFE, 0x7F, 0x01, 0x75, 0x03,
+              0x0F, 0x05, 0xC3 },
+            // jmp [rip+disp32] (an import thunk)
+            { 0xFF, 0x25, 0x11, 0x11, 0x11, 0x11 },
+            // endbr64; push r15; push r14; mov r14, rdi; push r13; push r12; push rbp; push rbx; sub rsp, 18h
+            { 0xF3, 0x0F, 0x1E, 0xFA, 0x41, 0x57, 0x41, 0x56, 0x49, 0x89, 0xFE, 0x41, 0x55, 0x41, 0x54, 0x55, 0x53,
+              0x48, 0x83, 0xEC, 0x18 },
+        }
+        : std::vector<std::vector<uint8_t>>
+        {
+            // mov edi, edi; push ebp; mov ebp, esp; sub esp, 10h; push esi
+            { 0x8B, 0xFF, 0x55, 0x8B, 0xEC, 0x83, 0xEC, 0x10, 0x56 },
+            // push 14h; push imm32; call rel32
+            { 0x6A, 0x14, 0x68, 0x11, 0x11, 0x11, 0x11, 0xE8, 0x11, 0x11, 0x11, 0x11 },
+            // mov eax, 55h; mov edx, imm32; call edx; ret 2Ch (an ntdll stub)
+            { 0xB8, 0x55, 0x00, 0x00, 0x00, 0xBA, 0x11, 0x11, 0x11, 0x11, 0xFF, 0xD2, 0xC2, 0x2C, 0x00 },
+            // jmp [abs32] (an import thunk)
+            { 0xFF, 0x25, 0x11, 0x11, 0x11, 0x11 },
+            // push ebp; mov ebp, esp; and esp, 0FFFFFFF8h; sub esp, 0Ch; mov eax, [ebp+8]
+            { 0x55, 0x8B, 0xEC, 0x83, 0xE4, 0xF8, 0x83, 0xEC, 0x0C, 0x8B, 0x45, 0x08 },
+        };
+
+    for (std::vector<uint8_t>& prologue : prologues)
+    {
+        prologue.resize(PrologueSize, 0xCC);
+    }
+
+    return prologues;
+}
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define HOST_IS_X86_OR_X64 1
+
+// The first PrologueSize bytes of functions of the C runtime and of this binary, and on Windows of functions the sandbox
+// detours: real compiler output for the host instruction set
+static std::vector<std::vector<uint8_t>> GetHostPrologues()
+{
+    std::vector<const void*> functions =
+    {
+        reinterpret_cast<const void*>(&std::memcpy),
+        reinterpret_cast<const void*>(&std::memcmp),
+        reinterpret_cast<const void*>(&std::strlen),
+        reinterpret_cast<const void*>(&std::strcmp),
+        reinterpret_cast<const void*>(&std::malloc),
+        reinterpret_cast<const void*>(&std::free),
+        reinterpret_cast<const void*>(&std::memset),
+        reinterpret_cast<const void*>(&std::fopen),
+        reinterpret_cast<const void*>(&std::fclose),
+        reinterpret_cast<const void*>(&std::strtol),
+        reinterpret_cast<const void*>(&DetourDecodeInstructionLength),
+        reinterpret_cast<const void*>(&DetourPeParseHeaders),
+        reinterpret_cast<const void*>(&DetourPeEnumerateImports),
+    };
+
+#ifdef _WIN32
+    const char* const kernel32[] =
+    {
+        "CreateFileW", "CreateProcessW", "CloseHandle", "CopyFileExW", "CreateDirectoryW", "CreateHardLinkW", "CreateSymbolicLinkW",
+        "DeleteFileW", "FindFirstFileExW", "FindNextFileW", "GetFileAttributesExW", "GetFinalPathNameByHandleW", "MoveFileWithProgressW",
+        "ReadFile", "RemoveDirectoryW", "SetFileInformationByHandle", "WriteFile",
+    };
+    const char* const ntdll[] =
+    {
+        "NtClose", "NtCreateFile", "NtOpenFile", "NtQueryDirectoryFile", "NtQueryInformationFile", "NtSetInformationFile", "ZwCreateUserProcess",
+    };
+
+    for (const char* name : kernel32)
+    {
+        functions.push_back(reinterpret_cast<const void*>(GetProcAddress(GetModuleHandleW(L"kernel32.dll"), name)));
+    }
+
+    for (const char* name : ntdll)
+    {
+        functions.push_back(reinterpret_cast<const void*>(GetProcAddress(GetModuleHandleW(L"ntdll.dll"), name)));
+    }
+#endif
+
+    std::vector<std::vector<uint8_t>> prologues;
+    for (const void* function : functions)
+    {
+        if (function != nullptr)
+        {
+            const uint8_t* bytes = static_cast<const uint8_t*>(function);
+            prologues.emplace_back(bytes, bytes + PrologueSize);
+        }
+    }
+
+    return prologues;
+}
+#endif
+
+// Sizes the instructions of each prologue up to PrologueSize bytes, the first ret, jmp or int 3, or the first truncated instruction.
+// Returns the number of instructions.
+static size_t DecodePrologues(const std::vector<std::vector<uint8_t>>& prologues, bool x64)
+{
+    size_t instructions = 0;
+    for (const std::vector<uint8_t>& prologue : prologues)
+    {
+        for (size_t offset = 0; offset < prologue.size();)
+        {
+            DETOUR_INSTRUCTION_LENGTH length;
+            if (!DetourDecodeInstructionLength(prologue.data() + offset, prologue.size() - offset, x64, &length))
+            {
+                break;
+            }
+
+            instructions++;
+            const uint8_t opcode = prologue[offset];
+            offset += length.cbInstruction;
+            if (opcode == 0xC3 || opcode == 0xC2 || opcode == 0xCC || opcode == 0xE9 || opcode == 0xEB || (length.fFlags & DETOUR_INSTRUCTION_INDIRECT) != 0)
+            {
+                break;
+            }
+        }
+    }
+
+    return instructions;
+}
+
+static void MeasurePrologues(const char* what, const std::vector<std::vector<uint8_t>>& prologues, bool x64)
+{
+    std::printf("  %s: %zu prologues, %zu instructions\n", what, prologues.size(), DecodePrologues(prologues, x64));
+    UnitTests::Measure(what, [&]() { return DecodePrologues(prologues, x64); });
+}
+
+BENCHMARK(DisassemblerLength, Prologues)
+{
+    MeasurePrologues("typical x86 prologues", GetTypicalPrologues(false), false);
+    MeasurePrologues("typical x64 prologues", GetTypicalPrologues(true), true);
+
+#ifdef HOST_IS_X86_OR_X64
+    MeasurePrologues("host prologues", GetHostPrologues(), sizeof(void*) == 8);
+#endif
+}
+
+BENCHMARK(DisassemblerLength, RandomBytes)
+{
+    // The worst case: long runs of prefixes and operands of every kind
+    std::mt19937 random(7);
+    std::vector<std::vector<uint8_t>> chunks(64, std::vector<uint8_t>(PrologueSize));
+    for (std::vector<uint8_t>& chunk : chunks)
+    {
+        for (uint8_t& byte : chunk)
+        {
+            byte = static_cast<uint8_t>(random());
+        }
+    }
+
+    MeasurePrologues("random x64 bytes", chunks, true);
+}
@@ -0,0 +1,194 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "TestFramework.h"
+#include "EpochReclaimer.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// An object that records its reclamation.
+struct Tracked
+{
+    static const uint32_t LiveMagic = 0x4C495645;
+
+    explicit Tracked(std::atomic<int>* reclaimed) : Magic(LiveMagic), Reclaimed(reclaimed) { }
+
+    uint32_t Magic;
+    std::atomic<int>* Reclaimed;
+
+    static void Reclaim(void* object)
+    {
+        Tracked* tracked = static_cast<Tracked*>(object);
+        tracked->Magic = 0;
+        (*tracked->Reclaimed)++;
+        delete tracked;
+    }
+};
+
+// Reclaims what earlier tests left pending. The reclaimer is a process-wide singleton.
+static EpochReclaimer* GetReclaimer()
+{
+    EpochReclaimer* reclaimer = EpochReclaimer::GetInstance();
+    while (reclaimer->TryReclaim() > 0)
+    {
+    }
+
+    return reclaimer;
+}
+
+TEST(EpochReclaimer, ReclaimsRightAwayWithoutReaders)
+{
+    EpochReclaimer* reclaimer = GetReclaimer();
+    std::atomic<int> reclaimed(0);
+
+    const uint64_t epoch = reclaimer->GetEpoch();
+    reclaimer->Retire(new Tracked(&reclaimed), Tracked::Reclaim);
+
+    EXPECT_EQ(1, reclaimed.load());
+    EXPECT_EQ(epoch + 2, reclaimer->GetEpoch());
+    EXPECT_EQ(0U, reclaimer->TryReclaim());
+}
+
+TEST(EpochReclaimer, WaitsForReadersThatCouldSeeTheObject)
+{
+    EpochReclaimer* reclaimer = GetReclaimer();
+    std::atomic<int> reclaimed(0);
+
+    {
+        EpochReclaimer::Guard guard(reclaimer);
+        reclaimer->Retire(new Tracked(&reclaimed), Tracked::Reclaim);
+
+        for (int i = 0; i < 10; i++)
+        {
+            EXPECT_EQ(1U, reclaimer->TryReclaim());
+        }
+
+        EXPECT_EQ(0, reclaimed.load());
+    }
+
+    EXPECT_EQ(0U, reclaimer->TryReclaim());
+    EXPECT_EQ(1, reclaimed.load());
+}
+
+TEST(EpochReclaimer, GuardsNest)
+{
+    EpochReclaimer* reclaimer = GetReclaimer();
+    std::atomic<int> reclaimed(0);
+
+    {
+        EpochReclaimer::Guard outer(reclaimer);
+        {
+            EpochReclaimer::Guard inner(reclaimer);
+            reclaimer->Retire(new Tracked(&reclaimed), Tracked::Reclaim);
+        }
+
+        // The outer critical section still holds the object back
+        EXPECT_EQ(1U, reclaimer->TryReclaim());
+        EXPECT_EQ(0, reclaimed.load());
+    }
+
+    EXPECT_EQ(0U, reclaimer->TryReclaim());
+    EXPECT_EQ(1, reclaimed.load());
+}
+
+TEST(EpochReclaimer, ReaderOnAnotherThreadHoldsObjectsBack)
+{
+    EpochReclaimer* reclaimer = GetReclaimer();
+    std::atomic<int> reclaimed(0);
+    std::atomic<int> stage(0);
+
+    std::thread reader([reclaimer, &stage]()
+    {
+        EpochReclaimer::Guard guard(reclaimer);
+        stage = 1;
+        while (stage.load() != 2)
+        {
+            std::this_thread::yield();
+        }
+    });
+
+    while (stage.load() != 1)
+    {
+        std::this_thread::yield();
+    }
+
+    reclaimer->Retire(new Tracked(&reclaimed), Tracked::Reclaim);
+    EXPECT_EQ(1U, reclaimer->TryReclaim());
+    EXPECT_EQ(0, reclaimed.load());
+
+    stage = 2;
+    reader.join();
+
+    EXPECT_EQ(0U, reclaimer->TryReclaim());
+    EXPECT_EQ(1, reclaimed.load());
+}
+
+TEST(EpochReclaimer, ReclaimingMayRetireMoreObjects)
+{
+    EpochReclaimer* reclaimer = GetReclaimer();
+    static std::atomic<int> reclaimed(0);
+    reclaimed = 0;
+
+    // Reclaiming the first object retires a second one, as releasing the last reference to a manifest does
+    reclaimer->Retire(new Tracked(&reclaimed), [](void* object)
+    {
+        Tracked::Reclaim(object);
+        EpochReclaimer::GetInstance()->Retire(new Tracked(&reclaimed), Tracked::Reclaim);
+    });
+
+    while (reclaimer->TryReclaim() > 0)
+    {
+    }
+
+    EXPECT_EQ(2, reclaimed.load());
+}
+
+TEST(EpochReclaimer, ReadersNeverSeeReclaimedObjects)
+{
+    EpochReclaimer* reclaimer = GetReclaimer();
+    std::atomic<int> reclaimed(0);
+    std::atomic<Tracked*> published(new Tracked(&reclaimed));
+    std::atomic<bool> stop(false);
+    std::atomic<int> stale(0);
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++)
+    {
+        readers.emplace_back([reclaimer, &published, &stop, &stale]()
+        {
+            while (!stop.load())
+            {
+                EpochReclaimer::Guard guard(reclaimer);
+                const Tracked* current = published.load();
+                for (int i = 0; i < 10; i++)
+                {
+                    if (current->Magic != Tracked::LiveMagic)
+                    {
+                        stale++;
+                    }
+                }
+            }
+        });
+    }
+
+    const int swaps = 2000;
+    for (int i = 0; i < swaps; i++)
+    {
+        Tracked* old = published.exchange(new Tracked(&reclaimed));
+        reclaimer->Retire(old, Tracked::Reclaim);
+    }
+
+    stop = true;
+    for (std::thread& reader : readers)
+    {
+        reader.join();
+    }
+
+    EXPECT_EQ(0U, reclaimer->TryReclaim());
+    EXPECT_EQ(swaps, reclaimed.load());
+    EXPECT_EQ(0, stale.load());
+
+    Tracked::Reclaim(published.load());
+}
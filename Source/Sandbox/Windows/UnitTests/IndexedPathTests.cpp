@@ -0,0 +1,161 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "TestFramework.h"
+#include "PathTestHelpers.h"
+#include "IndexedPath.h"
+
+#include <algorithm>
+
+// Checks every indexed fact of 'indexed' against a straightforward computation over 'expected'.
+static void ExpectIndexedAs(const IndexedPath& indexed, const PathString& expected, size_t prefixLength)
+{
+    ASSERT_EQ(expected.length(), indexed.Length());
+    EXPECT_TRUE(expected == PathString(indexed.GetString()));
+    EXPECT_EQ(HashPath(expected), indexed.Hash());
+    EXPECT_EQ(prefixLength, indexed.PrefixLength());
+    EXPECT_EQ(std::min(expected.find_first_of(MakePath("\r\n")), expected.length()), indexed.FirstNewLineIndex());
+
+    size_t componentCount = 0;
+    for (size_t i = prefixLength; i < expected.length(); i++)
+    {
+        if (IsDirectorySeparator(expected[i]) || (i > prefixLength && !IsDirectorySeparator(expected[i - 1])))
+        {
+            continue;
+        }
+
+        size_t end = i;
+        while (end < expected.length() && !IsDirectorySeparator(expected[end]))
+        {
+            end++;
+        }
+
+        ASSERT_TRUE(componentCount < indexed.ComponentCount());
+        const PathComponent& component = indexed.GetComponents()[componentCount++];
+        EXPECT_EQ(i, static_cast<size_t>(component.Start));
+        EXPECT_EQ(end - i, static_cast<size_t>(component.Length));
+        EXPECT_EQ(HashPath(expected.c_str() + i, end - i), component.Hash);
+        EXPECT_EQ(HashPath(expected.c_str(), end), component.PathHash);
+    }
+
+    EXPECT_EQ(componentCount, indexed.ComponentCount());
+}
+
+TEST(IndexedPath, CreateIndexesComponents)
+{
+    const char* paths[] = { "", "/", "a", "/out/bin/a.txt", "//out//bin/", "out/bin/a.txt/", "/out/We\rird\n/x" };
+    for (const char* path : paths)
+    {
+        const PathString expected = MakePath(path);
+        ExpectIndexedAs(*IndexedPath::Create(expected.c_str(), expected.length(), 0), expected, 0);
+    }
+}
+
+TEST(IndexedPath, CreateExcludesThePrefixFromComponents)
+{
+    const PathString path = MakePath("//?/out/a.txt");
+    IndexedPath::Ref indexed = IndexedPath::Create(path.c_str(), path.length(), 4);
+
+    ExpectIndexedAs(*indexed, path, 4);
+    ASSERT_EQ(2U, indexed->ComponentCount());
+    EXPECT_EQ(4U, static_cast<size_t>(indexed->GetComponents()[0].Start));
+}
+
+TEST(IndexedPath, CreateIndexesOnlyTheGivenLength)
+{
+    const PathString path = MakePath("/out/bin/a.txt");
+    const size_t length = MakePath("/out/b").length();
+
+    ExpectIndexedAs(*IndexedPath::Create(path.c_str(), length, 0), path.substr(0, length), 0);
+}
+
+TEST(IndexedPath, CreateFromScanMatchesCreate)
+{
+    const char* paths[] = { "/out/bin/a.txt", "/out//bin/../a.txt", "//?/out/a.txt", "/out/a\nb" };
+    for (const char* path : paths)
+    {
+        const PathString expected = MakePath(path);
+        const PathScan scan = ScanPath(expected.c_str());
+        ExpectIndexedAs(*IndexedPath::Create(expected.c_str(), scan), expected, scan.PrefixLength);
+    }
+}
+
+TEST(IndexedPath, CreateFromScanIndexesPathsWithManyComponents)
+{
+    // More components than a scan indexes
+    PathString path;
+    for (size_t i = 0; i < PathScan::MaxComponents * 2; i++)
+    {
+        path += MakePath("/c");
+    }
+
+    const PathScan scan = ScanPath(path.c_str());
+    EXPECT_FALSE(scan.IsIndexed);
+    ExpectIndexedAs(*IndexedPath::Create(path.c_str(), scan), path, scan.PrefixLength);
+}
+
+TEST(IndexedPath, CreatePrefixMatchesCreate)
+{
+    const PathString path = MakePath("//?/out//bin/a.txt/");
+    IndexedPath::Ref indexed = IndexedPath::Create(path.c_str(), path.length(), 4);
+
+    for (size_t length = 0; length <= path.length(); length++)
+    {
+        ExpectIndexedAs(*IndexedPath::CreatePrefix(*indexed, length), path.substr(0, length), 4);
+    }
+}
+
+TEST(IndexedPath, CreateExtendedMatchesCreate)
+{
+    const PathString base = MakePath("/out/bin");
+    const PathString suffix = MakePath("a.txt");
+    IndexedPath::Ref indexed = IndexedPath::Create(base.c_str(), base.length(), 0);
+
+    ExpectIndexedAs(
+        *IndexedPath::CreateExtended(*indexed, PREFERRED_DIRECTORY_SEPARATOR, suffix.c_str(), suffix.length()),
+        base + MakePath("/a.txt"),
+        0);
+
+    // No separator, with a suffix that starts with one
+    const PathString separatedSuffix = MakePath("/x/y\n");
+    ExpectIndexedAs(
+        *IndexedPath::CreateExtended(*indexed, 0, separatedSuffix.c_str(), separatedSuffix.length()),
+        base + separatedSuffix,
+        0);
+
+    // Extending a path that ends with a separator
+    const PathString directory = MakePath("/out/");
+    IndexedPath::Ref indexedDirectory = IndexedPath::Create(directory.c_str(), directory.length(), 0);
+    ExpectIndexedAs(*IndexedPath::CreateExtended(*indexedDirectory, 0, suffix.c_str(), suffix.length()), directory + suffix, 0);
+}
+
+TEST(IndexedPath, DerivedPathsOutliveTheirBase)
+{
+    const PathString path = MakePath("/out/bin/a.txt");
+    IndexedPath::Ref prefix;
+    {
+        IndexedPath::Ref indexed = IndexedPath::Create(path.c_str(), path.length(), 0);
+        prefix = IndexedPath::CreatePrefix(*indexed, MakePath("/out/bin").length());
+    }
+
+    ExpectIndexedAs(*prefix, MakePath("/out/bin"), 0);
+}
+
+TEST(IndexedPath, ComponentQueries)
+{
+    const PathString path = MakePath("/out/bin/a.txt");
+    IndexedPath::Ref indexed = IndexedPath::Create(path.c_str(), path.length(), 0);
+
+    EXPECT_EQ(0U, indexed->CountComponentsEndingBefore(3));
+    EXPECT_EQ(1U, indexed->CountComponentsEndingBefore(4));
+    EXPECT_EQ(2U, indexed->CountComponentsEndingBefore(9));
+    EXPECT_EQ(3U, indexed->CountComponentsEndingBefore(path.length()));
+
+    EXPECT_EQ(0U, indexed->FindFirstComponentStartingAt(0));
+    EXPECT_EQ(1U, indexed->FindFirstComponentStartingAt(2));
+    EXPECT_EQ(2U, indexed->FindFirstComponentStartingAt(9));
+    EXPECT_EQ(3U, indexed->FindFirstComponentStartingAt(10));
+
+    EXPECT_EQ(FindFinalPathSeparator(path.c_str()), indexed->FinalSeparatorIndex());
+    EXPECT_EQ(8U, indexed->FinalSeparatorIndex());
+}
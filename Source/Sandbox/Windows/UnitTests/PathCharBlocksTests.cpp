@@ -0,0 +1,176 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "TestFramework.h"
+#include "PathTestHelpers.h"
+#include "PathCharBlocks.h"
+
+#include <random>
+#include <vector>
+
+using namespace PathCharBlocks;
+
+// Scalar folds that agree with the ASCII fast paths and also fold Latin-1 letters, which the blocks must hand to them.
+template <typename Ch>
+static Ch FoldUpper(Ch c) noexcept
+{
+    const uint32_t u = static_cast<uint32_t>(c) & (sizeof(Ch) == 1 ? 0xFFU : 0xFFFFFFFFU);
+    return (u >= 'a' && u <= 'z') || (u >= 0xE0 && u <= 0xFE && u != 0xF7) ? static_cast<Ch>(u - 0x20) : c;
+}
+
+template <typename Ch>
+static Ch FoldLower(Ch c) noexcept
+{
+    const uint32_t u = static_cast<uint32_t>(c) & (sizeof(Ch) == 1 ? 0xFFU : 0xFFFFFFFFU);
+    return (u >= 'A' && u <= 'Z') || (u >= 0xC0 && u <= 0xDE && u != 0xD7) ? static_cast<Ch>(u + 0x20) : c;
+}
+
+template <typename Ch>
+static Ch FoldNone(Ch c) noexcept
+{
+    return c;
+}
+
+template <typename Ch>
+static Ch RandomChar(std::mt19937& random)
+{
+    static const char ascii[] = "abcxyzABCXYZ019_./\\:";
+    if (random() % 8 == 0)
+    {
+        // Non-ASCII, cased or not
+        return static_cast<Ch>(0xC0 + random() % 0x40);
+    }
+
+    return static_cast<Ch>(ascii[random() % (sizeof(ascii) - 1)]);
+}
+
+// Compares the block primitives with the scalar fold they are given, on random strings at random alignments.
+// Strings are heap allocated at their exact length, so that reading past them is caught by the sanitizers.
+template <typename Ch>
+static void CheckAgainstScalarFold(AsciiFold asciiFold, Ch (*fold)(Ch))
+{
+    std::mt19937 random(42);
+    for (int iteration = 0; iteration < 20000; iteration++)
+    {
+        const size_t length = random() % 70;
+        std::vector<Ch> a(length);
+        std::vector<Ch> b(length);
+        for (size_t i = 0; i < length; i++)
+        {
+            a[i] = RandomChar<Ch>(random);
+            switch (random() % 4)
+            {
+                case 0: b[i] = RandomChar<Ch>(random); break;
+                case 1: b[i] = FoldUpper(a[i]); break;
+                case 2: b[i] = FoldLower(a[i]); break;
+                default: b[i] = a[i]; break;
+            }
+        }
+
+        // Mostly equal strings, so that the comparisons get past the first block
+        if (random() % 2 == 0)
+        {
+            for (size_t i = 0; i < length; i++)
+            {
+                if (fold(a[i]) != fold(b[i]))
+                {
+                    b[i] = a[i];
+                }
+            }
+
+            if (length > 0 && random() % 2 == 0)
+            {
+                b[random() % length] = RandomChar<Ch>(random);
+            }
+        }
+
+        std::vector<Ch> folded(length);
+        size_t lastMismatch = 0;
+        bool equal = true;
+        bool equalToFolded = true;
+        for (size_t i = 0; i < length; i++)
+        {
+            folded[i] = fold(b[i]);
+            if (fold(a[i]) != fold(b[i]))
+            {
+                equal = false;
+                lastMismatch = i + 1;
+            }
+
+            equalToFolded = equalToFolded && fold(a[i]) == folded[i];
+        }
+
+        ASSERT_EQ(equal, AreFoldedEqual(a.data(), b.data(), length, asciiFold, fold));
+        ASSERT_EQ(lastMismatch, FindLastFoldedMismatch(a.data(), b.data(), length, asciiFold, fold));
+        ASSERT_EQ(equalToFolded, IsFoldedEqualTo(a.data(), folded.data(), length, asciiFold, fold));
+
+        std::vector<Ch> destination(length);
+        FoldInto(a.data(), destination.data(), length, asciiFold, fold);
+        for (size_t i = 0; i < length; i++)
+        {
+            ASSERT_TRUE(destination[i] == fold(a[i]));
+        }
+
+        // In place
+        FoldInto(a.data(), a.data(), length, asciiFold, fold);
+        ASSERT_TRUE(a == destination);
+    }
+}
+
+TEST(PathCharBlocks, SingleByteCharsMatchTheScalarFold)
+{
+    CheckAgainstScalarFold<char>(AsciiFold::Upper, FoldUpper<char>);
+    CheckAgainstScalarFold<char>(AsciiFold::Lower, FoldLower<char>);
+    CheckAgainstScalarFold<char>(AsciiFold::None, FoldNone<char>);
+}
+
+TEST(PathCharBlocks, TwoByteCharsMatchTheScalarFold)
+{
+    CheckAgainstScalarFold<char16_t>(AsciiFold::Upper, FoldUpper<char16_t>);
+    CheckAgainstScalarFold<char16_t>(AsciiFold::Lower, FoldLower<char16_t>);
+    CheckAgainstScalarFold<char16_t>(AsciiFold::None, FoldNone<char16_t>);
+}
+
+TEST(PathCharBlocks, FourByteCharsMatchTheScalarFold)
+{
+    CheckAgainstScalarFold<char32_t>(AsciiFold::Upper, FoldUpper<char32_t>);
+    CheckAgainstScalarFold<char32_t>(AsciiFold::Lower, FoldLower<char32_t>);
+}
+
+// An exactly sized copy of a null-terminated path, normalized as the file access manifest stores it.
+static std::vector<PathChar> Normalized(const PathString& path)
+{
+    std::vector<PathChar> normalized(path.length() + 1);
+    for (size_t i = 0; i < path.length(); i++)
+    {
+        normalized[i] = NormalizePathChar(path[i]);
+    }
+
+    normalized[path.length()] = 0;
+    return normalized;
+}
+
+TEST(ArePathsEqual, ComparesWithTheNormalizedPath)
+{
+    const PathString path = MakePath("/Out/Some/Longer/Directory/File.txt");
+    EXPECT_TRUE(ArePathsEqual(path.c_str(), Normalized(path).data(), path.length()));
+    EXPECT_FALSE(ArePathsEqual(path.c_str(), Normalized(MakePath("/Out/Some/Longer/Directory/File.tx_")).data(), path.length()));
+
+    // Only the first nLength characters of the path are compared
+    const PathString prefix = MakePath("/Out/Some");
+    EXPECT_TRUE(ArePathsEqual(path.c_str(), Normalized(prefix).data(), prefix.length()));
+}
+
+TEST(ArePathsEqual, NormalizedPathsOfAnotherLengthDiffer)
+{
+    const PathString path = MakePath("/Out/Some/Longer/Directory/File.txt");
+
+    // Shorter: must not be read past its terminator
+    for (size_t length = 0; length < path.length(); length++)
+    {
+        EXPECT_FALSE(ArePathsEqual(path.c_str(), Normalized(path.substr(0, length)).data(), path.length()));
+    }
+
+    // Longer
+    EXPECT_FALSE(ArePathsEqual(path.c_str(), Normalized(path + MakePath("/x")).data(), path.length()));
+}
@@ -0,0 +1,150 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "TestFramework.h"
+#include "PathTestHelpers.h"
+#include "PathScanner.h"
+
+static PathScan Scan(const PathString& path)
+{
+    return ScanPath(path.c_str());
+}
+
+TEST(PathScanner, CountsCharactersAndComponents)
+{
+    const PathScan scan = Scan(MakePath("out//bin/a.txt"));
+    EXPECT_EQ(MakePath("out//bin/a.txt").length(), scan.Length);
+    EXPECT_EQ(3U, scan.ComponentCount);
+    EXPECT_FALSE(scan.EndsWithSeparator);
+    EXPECT_FALSE(scan.ContainsNewLine());
+
+    EXPECT_TRUE(Scan(MakePath("/out/")).EndsWithSeparator);
+    EXPECT_EQ(0U, Scan(MakePath("")).ComponentCount);
+    EXPECT_EQ(0U, Scan(MakePath("//")).ComponentCount);
+}
+
+TEST(PathScanner, FindsTheFirstNewLine)
+{
+    const PathScan scan = Scan(MakePath("/out/a\rb\nc"));
+    EXPECT_TRUE(scan.ContainsNewLine());
+    EXPECT_EQ(6U, scan.FirstNewLineIndex);
+    EXPECT_EQ(static_cast<size_t>(PathScan::NoNewLine), Scan(MakePath("/out/ab")).FirstNewLineIndex);
+}
+
+TEST(PathScanner, RecognizesPrefixes)
+{
+    // The prefixes are spelled with backslashes on every platform
+    const PathScan win32Nt = Scan(MakePath("\\\\?\\out"));
+    EXPECT_TRUE(win32Nt.Prefix == PathPrefixKind::Win32Nt);
+    EXPECT_EQ(4U, win32Nt.PrefixLength);
+    EXPECT_EQ(1U, win32Nt.ComponentCount);
+
+    EXPECT_TRUE(Scan(MakePath("\\??\\out")).Prefix == PathPrefixKind::Win32Nt);
+    EXPECT_TRUE(Scan(MakePath("\\\\.\\pipe")).Prefix == PathPrefixKind::LocalDevice);
+
+    const PathScan none = Scan(MakePath("/out"));
+    EXPECT_TRUE(none.Prefix == PathPrefixKind::None);
+    EXPECT_EQ(0U, none.PrefixLength);
+}
+
+TEST(PathScanner, RecognizesNormalizedPaths)
+{
+    EXPECT_TRUE(Scan(MakeAbsolutePath("/out/bin/a.txt")).IsNormalized);
+    EXPECT_TRUE(Scan(MakeAbsolutePath("/out/.../a")).IsNormalized);
+    EXPECT_TRUE(Scan(MakeAbsolutePath("/out/.a")).IsNormalized);
+
+    EXPECT_FALSE(Scan(MakePath("out/a.txt")).IsNormalized);
+    EXPECT_FALSE(Scan(MakeAbsolutePath("/out//a.txt")).IsNormalized);
+    EXPECT_FALSE(Scan(MakeAbsolutePath("/out/./a.txt")).IsNormalized);
+    EXPECT_FALSE(Scan(MakeAbsolutePath("/out/../a.txt")).IsNormalized);
+    EXPECT_FALSE(Scan(MakeAbsolutePath("/out/..")).IsNormalized);
+    EXPECT_FALSE(Scan(MakePath("\\\\?\\out")).IsNormalized);
+
+    // Too long for GetFullPathName
+    PathString longPath = MakeAbsolutePath("/out/");
+    longPath.append(32767, static_cast<PathChar>('a'));
+    EXPECT_FALSE(Scan(longPath).IsNormalized);
+}
+
+#if _WIN32
+TEST(PathScanner, RecognizesPathsGetFullPathNameRewrites)
+{
+    EXPECT_FALSE(Scan(L"C:/out/a.txt").IsNormalized);
+    EXPECT_FALSE(Scan(L"C:\\out\\a.").IsNormalized);
+    EXPECT_FALSE(Scan(L"C:\\out \\a").IsNormalized);
+    EXPECT_FALSE(Scan(L"C:\\out\\nul.txt").IsNormalized);
+    EXPECT_FALSE(Scan(L"C:\\out\\COM1").IsNormalized);
+    EXPECT_FALSE(Scan(L"C:\\out\\conout$").IsNormalized);
+    EXPECT_FALSE(Scan(L"\\out\\a").IsNormalized);
+
+    EXPECT_TRUE(Scan(L"C:\\out\\null.txt").IsNormalized);
+    EXPECT_TRUE(Scan(L"C:\\out\\COM").IsNormalized);
+}
+#endif
+
+// Checks that an indexed scan has the components and hashes of a straightforward computation over the path.
+static void ExpectIndexed(const PathString& path)
+{
+    const PathScan scan = Scan(path);
+    ASSERT_TRUE(scan.IsIndexed);
+    EXPECT_EQ(HashPath(path), scan.Hash);
+
+    size_t count = 0;
+    for (size_t i = scan.PrefixLength; i < path.length(); i++)
+    {
+        if (IsDirectorySeparator(path[i]) || (i > scan.PrefixLength && !IsDirectorySeparator(path[i - 1])))
+        {
+            continue;
+        }
+
+        size_t end = i;
+        while (end < path.length() && !IsDirectorySeparator(path[end]))
+        {
+            end++;
+        }
+
+        ASSERT_TRUE(count < scan.ComponentCount);
+        const PathComponent& component = scan.Components[count++];
+        EXPECT_EQ(i, static_cast<size_t>(component.Start));
+        EXPECT_EQ(end - i, static_cast<size_t>(component.Length));
+        EXPECT_EQ(HashPath(path.c_str() + i, end - i), component.Hash);
+        EXPECT_EQ(HashPath(path.c_str(), end), component.PathHash);
+    }
+
+    EXPECT_EQ(count, scan.ComponentCount);
+}
+
+TEST(PathScanner, IndexesPathsUsedAsTheyAre)
+{
+    ExpectIndexed(MakeAbsolutePath("/out/bin/a.txt"));
+    ExpectIndexed(MakeAbsolutePath("/Out/Bin/"));
+    ExpectIndexed(MakeAbsolutePath("/"));
+
+    // Win32Nt paths are used as they are, normalized or not
+    ExpectIndexed(MakePath("\\\\?\\out//bin/../a.txt"));
+}
+
+TEST(PathScanner, DoesNotIndexPathsThatGetRewritten)
+{
+    EXPECT_FALSE(Scan(MakePath("out/a.txt")).IsIndexed);
+    EXPECT_FALSE(Scan(MakeAbsolutePath("/out/../a.txt")).IsIndexed);
+    EXPECT_FALSE(Scan(MakeAbsolutePath("/out//a.txt")).IsIndexed);
+    EXPECT_FALSE(Scan(MakePath("\\\\.\\pipe/a")).IsIndexed);
+}
+
+TEST(PathScanner, IndexesAtMostMaxComponents)
+{
+    PathString path = MakeAbsolutePath("");
+    for (size_t i = 0; i < PathScan::MaxComponents; i++)
+    {
+        path += MakePath("/c");
+    }
+
+    ExpectIndexed(path);
+
+    path += MakePath("/c");
+    const PathScan scan = Scan(path);
+    EXPECT_FALSE(scan.IsIndexed);
+    EXPECT_TRUE(scan.IsNormalized);
+    EXPECT_EQ(PathScan::MaxComponents + 1, scan.ComponentCount);
+}
@@ -0,0 +1,38 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+
+#include "stdafx.h"
+#include "StringOperations.h"
+
+#include <string>
+
+typedef std::basic_string<PathChar> PathString;
+
+// Converts an ASCII path written with '/' separators into a path of the platform, so that the same tests run everywhere.
+inline PathString MakePath(const char* path)
+{
+    PathString result;
+    for (const char* c = path; *c != 0; c++)
+    {
+        result += *c == '/' ? PREFERRED_DIRECTORY_SEPARATOR : static_cast<PathChar>(*c);
+    }
+
+    return result;
+}
+
+// Same as MakePath, for a path starting with '/', rooted at C: on Windows.
+inline PathString MakeAbsolutePath(const char* path)
+{
+#if _WIN32
+    return PathString(L"C:") + MakePath(path);
+#else
+    return MakePath(path);
+#endif
+}
+
+inline DWORD HashPath(const PathString& path)
+{
+    return HashPath(path.c_str(), path.length());
+}
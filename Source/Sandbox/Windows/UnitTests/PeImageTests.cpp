@@ -0,0 +1,559 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "TestFramework.h"
+#include "peimage.h"
+
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Builds a PE file with one section, .idata, that holds the import directory:
+//   kernel32.dll: CreateFileW by name, ordinal 17 (through OriginalFirstThunk)
+//   ntdll.dll:    NtCreateFile by name (through FirstThunk only)
+class TestImage
+{
+public:
+    static const uint32_t PeOffset = 0x40;
+    static const uint32_t SectionRva = 0x1000;
+    static const uint32_t SectionOffset = 0x200;
+    static const uint32_t SectionSize = 0x200;
+
+    explicit TestImage(bool pe32Plus)
+        : m_pe32Plus(pe32Plus), m_bytes(SectionOffset + SectionSize)
+    {
+        const uint32_t optionalHeaderSize = (pe32Plus ? 112 : 96) + 16 * 8;
+
+        m_bytes[0] = 'M';
+        m_bytes[1] = 'Z';
+        Write32(0x3c, PeOffset);
+        Write(PeOffset, "PE\0\0", 4);
+        Write16(PeOffset + 4 + 2, 1);
+        Write16(PeOffset + 4 + 16, static_cast<uint16_t>(optionalHeaderSize));
+
+        const uint32_t optionalHeader = PeOffset + 4 + 20;
+        Write16(optionalHeader, pe32Plus ? 0x20b : 0x10b);
+        Write32(optionalHeader + 60, SectionOffset);
+        const uint32_t numberOfRvas = optionalHeader + (pe32Plus ? 108 : 92);
+        Write32(numberOfRvas, 16);
+        m_importDirectory = numberOfRvas + 4 + 8;
+        Write32(m_importDirectory, SectionRva);
+        Write32(m_importDirectory + 4, 3 * 20);
+
+        const uint32_t section = optionalHeader + optionalHeaderSize;
+        Write(section, ".idata", 6);
+        Write32(section + 12, SectionRva);
+        Write32(section + 16, SectionSize);
+        Write32(section + 20, SectionOffset);
+
+        // Descriptors, then the null descriptor
+        WriteRva(SectionRva + 0x00, SectionRva + 0x100);
+        WriteRva(SectionRva + 0x0c, SectionRva + 0x80);
+        WriteRva(SectionRva + 0x14 + 0x0c, SectionRva + 0x90);
+        WriteRva(SectionRva + 0x14 + 0x10, SectionRva + 0x140);
+
+        WriteString(SectionRva + 0x80, "kernel32.dll");
+        WriteString(SectionRva + 0x90, "ntdll.dll");
+
+        WriteThunk(SectionRva + 0x100, SectionRva + 0x180);
+        WriteThunk(SectionRva + 0x100 + ThunkSize(), (pe32Plus ? 0x8000000000000000ull : 0x80000000ull) | 17);
+        WriteThunk(SectionRva + 0x140, SectionRva + 0x1a0);
+
+        WriteString(SectionRva + 0x180 + 2, "CreateFileW");
+        WriteString(SectionRva + 0x1a0 + 2, "NtCreateFile");
+    }
+
+    std::vector<uint8_t>& Bytes() { return m_bytes; }
+
+    uint32_t ThunkSize() const { return m_pe32Plus ? 8 : 4; }
+
+    void WriteRva(uint32_t rva, uint32_t value) { Write32(SectionOffset + rva - SectionRva, value); }
+
+    void WriteThunk(uint32_t rva, uint64_t value)
+    {
+        WriteRva(rva, static_cast<uint32_t>(value));
+        if (m_pe32Plus)
+        {
+            WriteRva(rva + 4, static_cast<uint32_t>(value >> 32));
+        }
+    }
+
+    void WriteString(uint32_t rva, const char* value) { Write(SectionOffset + rva - SectionRva, value, std::strlen(value) + 1); }
+
+    void SetImportDirectory(uint32_t rva) { Write32(m_importDirectory, rva); }
+
+    void Write16(uint32_t offset, uint16_t value)
+    {
+        m_bytes[offset] = static_cast<uint8_t>(value);
+        m_bytes[offset + 1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    void Write32(uint32_t offset, uint32_t value)
+    {
+        Write16(offset, static_cast<uint16_t>(value));
+        Write16(offset + 2, static_cast<uint16_t>(value >> 16));
+    }
+
+    void Write(uint32_t offset, const char* bytes, size_t count) { std::memcpy(&m_bytes[offset], bytes, count); }
+
+private:
+    bool m_pe32Plus;
+    std::vector<uint8_t> m_bytes;
+    uint32_t m_importDirectory;
+};
+
+// Parses the first 'count' bytes of 'bytes', copied to an exactly sized heap buffer so that reading past them is
+// caught by the sanitizers. The buffer must outlive the image.
+static bool Parse(const std::vector<uint8_t>& bytes, size_t count, std::vector<uint8_t>& buffer, DETOUR_PE_IMAGE& image)
+{
+    buffer.assign(bytes.begin(), bytes.begin() + count);
+    return DetourPeParseHeaders(buffer.data(), buffer.size(), &image);
+}
+
+struct ImportLog
+{
+    std::vector<std::string> Entries;
+    bool ContinueFiles = true;
+    bool ContinueFunctions = true;
+};
+
+static bool LogFile(void* context, const char* file)
+{
+    ImportLog* log = static_cast<ImportLog*>(context);
+    log->Entries.push_back(file == nullptr ? "end of files" : std::string("file ") + file);
+    return log->ContinueFiles;
+}
+
+static bool LogFunction(void* context, uint32_t ordinal, const char* function)
+{
+    ImportLog* log = static_cast<ImportLog*>(context);
+    if (function != nullptr)
+    {
+        log->Entries.push_back(std::string("name ") + function);
+    }
+    else
+    {
+        log->Entries.push_back(ordinal == 0 ? "end of functions" : "ordinal " + std::to_string(ordinal));
+    }
+
+    return log->ContinueFunctions;
+}
+
+static std::string Join(const std::vector<std::string>& entries)
+{
+    std::string joined;
+    for (const std::string& entry : entries)
+    {
+        joined += entry + "; ";
+    }
+
+    return joined;
+}
+
+static const char* const AllImports =
+    "file kernel32.dll; name CreateFileW; ordinal 17; end of functions; "
+    "file ntdll.dll; name NtCreateFile; end of functions; end of files; ";
+
+TEST(PeImage, ParsesHeaders)
+{
+    for (bool pe32Plus : { false, true })
+    {
+        TestImage testImage(pe32Plus);
+        std::vector<uint8_t> buffer;
+        DETOUR_PE_IMAGE image;
+        ASSERT_TRUE(Parse(testImage.Bytes(), testImage.Bytes().size(), buffer, image));
+
+        EXPECT_EQ(pe32Plus, image.fPe32Plus);
+        EXPECT_EQ(static_cast<uint32_t>(TestImage::PeOffset), image.nPeOffset);
+        EXPECT_EQ(1, image.nSections);
+        EXPECT_EQ(16U, image.nDataDirectories);
+        EXPECT_EQ(static_cast<uint32_t>(TestImage::SectionOffset), image.cbSizeOfHeaders);
+
+        uint32_t rva = 0;
+        uint32_t size = 0;
+        ASSERT_TRUE(DetourPeGetDataDirectory(&image, DETOUR_PE_DIRECTORY_IMPORT, &rva, &size));
+        EXPECT_EQ(static_cast<uint32_t>(TestImage::SectionRva), rva);
+        EXPECT_EQ(60U, size);
+        EXPECT_FALSE(DetourPeGetDataDirectory(&image, 16, &rva, &size));
+    }
+}
+
+TEST(PeImage, EnumeratesImportsByNameAndOrdinal)
+{
+    for (bool pe32Plus : { false, true })
+    {
+        TestImage testImage(pe32Plus);
+        std::vector<uint8_t> buffer;
+        DETOUR_PE_IMAGE image;
+        ASSERT_TRUE(Parse(testImage.Bytes(), testImage.Bytes().size(), buffer, image));
+
+        ImportLog log;
+        EXPECT_TRUE(DetourPeEnumerateImports(&image, &log, LogFile, LogFunction));
+        EXPECT_EQ(std::string(AllImports), Join(log.Entries));
+
+        ImportLog files;
+        EXPECT_TRUE(DetourPeEnumerateImports(&image, &files, LogFile, nullptr));
+        EXPECT_EQ(std::string("file kernel32.dll; file ntdll.dll; end of files; "), Join(files.Entries));
+    }
+}
+
+TEST(PeImage, CallbacksStopTheEnumeration)
+{
+    TestImage testImage(true);
+    std::vector<uint8_t> buffer;
+    DETOUR_PE_IMAGE image;
+    ASSERT_TRUE(Parse(testImage.Bytes(), testImage.Bytes().size(), buffer, image));
+
+    ImportLog stopFiles;
+    stopFiles.ContinueFiles = false;
+    EXPECT_TRUE(DetourPeEnumerateImports(&image, &stopFiles, LogFile, LogFunction));
+    EXPECT_EQ(std::string("file kernel32.dll; end of files; "), Join(stopFiles.Entries));
+
+    ImportLog stopFunctions;
+    stopFunctions.ContinueFunctions = false;
+    EXPECT_TRUE(DetourPeEnumerateImports(&image, &stopFunctions, LogFile, LogFunction));
+    EXPECT_EQ(
+        std::string("file kernel32.dll; name CreateFileW; end of functions; file ntdll.dll; name NtCreateFile; end of functions; end of files; "),
+        Join(stopFunctions.Entries));
+}
+
+TEST(PeImage, ImageWithoutImports)
+{
+    TestImage testImage(false);
+    testImage.SetImportDirectory(0);
+    std::vector<uint8_t> buffer;
+    DETOUR_PE_IMAGE image;
+    ASSERT_TRUE(Parse(testImage.Bytes(), testImage.Bytes().size(), buffer, image));
+
+    ImportLog log;
+    EXPECT_TRUE(DetourPeEnumerateImports(&image, &log, LogFile, LogFunction));
+    EXPECT_EQ(std::string("end of files; "), Join(log.Entries));
+}
+
+TEST(PeImage, RvaToDataStaysWithinTheSectionAndTheFile)
+{
+    TestImage testImage(false);
+    std::vector<uint8_t> buffer;
+    DETOUR_PE_IMAGE image;
+    ASSERT_TRUE(Parse(testImage.Bytes(), testImage.Bytes().size(), buffer, image));
+
+    const uint32_t rva = TestImage::SectionRva;
+    const uint32_t size = TestImage::SectionSize;
+    EXPECT_TRUE(DetourPeRvaToData(&image, rva, size) == buffer.data() + TestImage::SectionOffset);
+    EXPECT_TRUE(DetourPeRvaToData(&image, rva + size - 1, 1) != nullptr);
+    EXPECT_TRUE(DetourPeRvaToData(&image, rva, size + 1) == nullptr);
+    EXPECT_TRUE(DetourPeRvaToData(&image, rva + size - 1, 2) == nullptr);
+    EXPECT_TRUE(DetourPeRvaToData(&image, rva + size, 1) == nullptr);
+    EXPECT_TRUE(DetourPeRvaToData(&image, rva - 1, 1) == nullptr);
+    EXPECT_TRUE(DetourPeRvaToData(&image, 0, 1) == nullptr);
+    EXPECT_TRUE(DetourPeRvaToData(&image, UINT32_MAX, 1) == nullptr);
+
+    // Raw data cut short by the end of the file
+    const size_t truncatedSize = TestImage::SectionOffset + 0x100;
+    ASSERT_TRUE(Parse(testImage.Bytes(), truncatedSize, buffer, image));
+    EXPECT_TRUE(DetourPeRvaToData(&image, rva, 0x100) != nullptr);
+    EXPECT_TRUE(DetourPeRvaToData(&image, rva, 0x101) == nullptr);
+    EXPECT_TRUE(DetourPeRvaToData(&image, rva + 0x100, 1) == nullptr);
+}
+
+TEST(PeImage, RvaToStringRequiresATerminator)
+{
+    TestImage testImage(false);
+    const uint32_t lastBytes = TestImage::SectionRva + TestImage::SectionSize - 4;
+    testImage.WriteRva(lastBytes, 0x41414141);
+    testImage.WriteString(TestImage::SectionRva + 0x1f0, "abc");
+
+    std::vector<uint8_t> buffer;
+    DETOUR_PE_IMAGE image;
+    ASSERT_TRUE(Parse(testImage.Bytes(), testImage.Bytes().size(), buffer, image));
+
+    EXPECT_EQ(std::string("kernel32.dll"), std::string(DetourPeRvaToString(&image, TestImage::SectionRva + 0x80)));
+    EXPECT_EQ(std::string("abc"), std::string(DetourPeRvaToString(&image, TestImage::SectionRva + 0x1f0)));
+    EXPECT_TRUE(DetourPeRvaToString(&image, lastBytes) == nullptr);
+    EXPECT_TRUE(DetourPeRvaToString(&image, lastBytes + 3) == nullptr);
+    EXPECT_TRUE(DetourPeRvaToString(&image, TestImage::SectionRva + TestImage::SectionSize) == nullptr);
+
+    // The terminator of "ntdll.dll" is the last byte of the file
+    const size_t truncatedSize = TestImage::SectionOffset + 0x90 + sizeof("ntdll.dll");
+    ASSERT_TRUE(Parse(testImage.Bytes(), truncatedSize, buffer, image));
+    EXPECT_EQ(std::string("ntdll.dll"), std::string(DetourPeRvaToString(&image, TestImage::SectionRva + 0x90)));
+    ASSERT_TRUE(Parse(testImage.Bytes(), truncatedSize - 1, buffer, image));
+    EXPECT_TRUE(DetourPeRvaToString(&image, TestImage::SectionRva + 0x90) == nullptr);
+}
+
+TEST(PeImage, RejectsCorruptHeaders)
+{
+    for (bool pe32Plus : { false, true })
+    {
+        TestImage valid(pe32Plus);
+        std::vector<uint8_t> buffer;
+        DETOUR_PE_IMAGE image;
+
+        // Every truncation that cuts into the headers or the section table
+        const size_t headersSize = TestImage::PeOffset + 4 + 20 + (pe32Plus ? 112 : 96) + 16 * 8 + 40;
+        for (size_t count = 0; count < headersSize; count++)
+        {
+            if (!EXPECT_FALSE(Parse(valid.Bytes(), count, buffer, image)))
+            {
+                std::fprintf(stderr, "  truncated to %zu bytes\n", count);
+            }
+        }
+
+        EXPECT_TRUE(Parse(valid.Bytes(), headersSize, buffer, image));
+
+        TestImage badDosSignature(pe32Plus);
+        badDosSignature.Bytes()[1] = 'X';
+        EXPECT_FALSE(Parse(badDosSignature.Bytes(), badDosSignature.Bytes().size(), buffer, image));
+
+        TestImage badPeSignature(pe32Plus);
+        badPeSignature.Write(TestImage::PeOffset, "PX\0\0", 4);
+        EXPECT_FALSE(Parse(badPeSignature.Bytes(), badPeSignature.Bytes().size(), buffer, image));
+
+        TestImage peOffsetPastTheEnd(pe32Plus);
+        peOffsetPastTheEnd.Write32(0x3c, 0xfffffff0);
+        EXPECT_FALSE(Parse(peOffsetPastTheEnd.Bytes(), peOffsetPastTheEnd.Bytes().size(), buffer, image));
+
+        TestImage badMagic(pe32Plus);
+        badMagic.Write16(TestImage::PeOffset + 4 + 20, 0x107);
+        EXPECT_FALSE(Parse(badMagic.Bytes(), badMagic.Bytes().size(), buffer, image));
+
+        TestImage tooManySections(pe32Plus);
+        tooManySections.Write16(TestImage::PeOffset + 4 + 2, 0xffff);
+        EXPECT_FALSE(Parse(tooManySections.Bytes(), tooManySections.Bytes().size(), buffer, image));
+
+        TestImage optionalHeaderTooSmall(pe32Plus);
+        optionalHeaderTooSmall.Write16(TestImage::PeOffset + 4 + 16, pe32Plus ? 108 : 92);
+        EXPECT_FALSE(Parse(optionalHeaderTooSmall.Bytes(), optionalHeaderTooSmall.Bytes().size(), buffer, image));
+
+        // NumberOfRvaAndSizes larger than the optional header: only the entries that fit count
+        TestImage tooManyRvas(pe32Plus);
+        tooManyRvas.Write32(TestImage::PeOffset + 4 + 20 + (pe32Plus ? 108 : 92), 0xffffffff);
+        ASSERT_TRUE(Parse(tooManyRvas.Bytes(), tooManyRvas.Bytes().size(), buffer, image));
+        EXPECT_EQ(16U, image.nDataDirectories);
+    }
+}
+
+TEST(PeImage, TruncatedFilesNeverEnumeratePastTheirEnd)
+{
+    for (bool pe32Plus : { false, true })
+    {
+        TestImage testImage(pe32Plus);
+        for (size_t count = TestImage::SectionOffset; count <= testImage.Bytes().size(); count++)
+        {
+            std::vector<uint8_t> buffer;
+            DETOUR_PE_IMAGE image;
+            ASSERT_TRUE(Parse(testImage.Bytes(), count, buffer, image));
+
+            // Either everything is found, or the enumeration fails. The name of the last import ends at 0x1af.
+            ImportLog log;
+            const bool complete = DetourPeEnumerateImports(&image, &log, LogFile, LogFunction);
+            EXPECT_EQ(count >= TestImage::SectionOffset + 0x1af, complete);
+            if (complete)
+            {
+                EXPECT_EQ(std::string(AllImports), Join(log.Entries));
+            }
+            else
+            {
+                EXPECT_EQ(std::string("end of files"), log.Entries.back());
+            }
+        }
+    }
+}
+
+TEST(PeImage, RejectsCorruptImports)
+{
+    const uint32_t rva = TestImage::SectionRva;
+    for (bool pe32Plus : { false, true })
+    {
+        std::vector<uint8_t> buffer;
+        DETOUR_PE_IMAGE image;
+        ImportLog log;
+
+        TestImage fileNameOutside(pe32Plus);
+        fileNameOutside.WriteRva(rva + 0x14 + 0x0c, 0x5000);
+        ASSERT_TRUE(Parse(fileNameOutside.Bytes(), fileNameOutside.Bytes().size(), buffer, image));
+        EXPECT_FALSE(DetourPeEnumerateImports(&image, &log, LogFile, LogFunction));
+        EXPECT_EQ(std::string("file kernel32.dll; name CreateFileW; ordinal 17; end of functions; end of files; "), Join(log.Entries));
+
+        TestImage functionNameOutside(pe32Plus);
+        functionNameOutside.WriteThunk(rva + 0x140, 0x5000);
+        log.Entries.clear();
+        ASSERT_TRUE(Parse(functionNameOutside.Bytes(), functionNameOutside.Bytes().size(), buffer, image));
+        EXPECT_FALSE(DetourPeEnumerateImports(&image, &log, LogFile, LogFunction));
+
+        TestImage thunksOutside(pe32Plus);
+        thunksOutside.WriteRva(rva + 0x00, 0x5000);
+        ASSERT_TRUE(Parse(thunksOutside.Bytes(), thunksOutside.Bytes().size(), buffer, image));
+        EXPECT_FALSE(DetourPeEnumerateImports(&image, nullptr, nullptr, LogFunction));
+        log.Entries.clear();
+        EXPECT_TRUE(DetourPeEnumerateImports(&image, &log, LogFile, nullptr));
+
+        // Thunks running to the end of the section without a terminator
+        TestImage unterminatedThunks(pe32Plus);
+        for (uint32_t thunk = rva + 0x140; thunk < rva + TestImage::SectionSize; thunk += unterminatedThunks.ThunkSize())
+        {
+            unterminatedThunks.WriteThunk(thunk, (pe32Plus ? 0x8000000000000000ull : 0x80000000ull) | 1);
+        }
+
+        ASSERT_TRUE(Parse(unterminatedThunks.Bytes(), unterminatedThunks.Bytes().size(), buffer, image));
+        log.Entries.clear();
+        EXPECT_FALSE(DetourPeEnumerateImports(&image, &log, LogFile, LogFunction));
+
+        // Descriptors running to the end of the section without a null descriptor
+        TestImage unterminatedDescriptors(pe32Plus);
+        unterminatedDescriptors.SetImportDirectory(rva + TestImage::SectionSize - 20);
+        unterminatedDescriptors.WriteRva(rva + TestImage::SectionSize - 20, rva + 0x100);
+        unterminatedDescriptors.WriteRva(rva + TestImage::SectionSize - 20 + 0x0c, rva + 0x80);
+        ASSERT_TRUE(Parse(unterminatedDescriptors.Bytes(), unterminatedDescriptors.Bytes().size(), buffer, image));
+        log.Entries.clear();
+        EXPECT_FALSE(DetourPeEnumerateImports(&image, &log, LogFile, nullptr));
+        EXPECT_EQ(std::string("file kernel32.dll; end of files; "), Join(log.Entries));
+    }
+}
+
+// Everything a parse of a (possibly corrupt) image finds, and whether any string handed to the callbacks was not
+// terminated within the file
+struct ParseOutcome
+{
+    const uint8_t* End = nullptr;
+    bool StringOutsideTheFile = false;
+    std::vector<std::string> Entries;
+
+    static bool OnFile(void* context, const char* file)
+    {
+        ParseOutcome* outcome = static_cast<ParseOutcome*>(context);
+        outcome->Entries.push_back(file == nullptr ? "end of files" : std::string("file ") + outcome->Check(file));
+        return true;
+    }
+
+    static bool OnFunction(void* context, uint32_t ordinal, const char* function)
+    {
+        ParseOutcome* outcome = static_cast<ParseOutcome*>(context);
+        outcome->Entries.push_back(function == nullptr ? "ordinal " + std::to_string(ordinal) : std::string("name ") + outcome->Check(function));
+        return true;
+    }
+
+    std::string Check(const char* value)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(value);
+        if (bytes >= End || std::memchr(bytes, 0, End - bytes) == nullptr)
+        {
+            StringOutsideTheFile = true;
+            return "<outside>";
+        }
+
+        return value;
+    }
+};
+
+// Parses the first 'count' bytes of 'bytes' and enumerates their imports, from a buffer that ends with them or from one
+// where they are followed by non-zero bytes: the outcome must not depend on bytes past the file.
+static ParseOutcome ParseAndEnumerate(const std::vector<uint8_t>& bytes, size_t count, bool padded)
+{
+    std::vector<uint8_t> buffer(bytes.begin(), bytes.begin() + count);
+    if (padded)
+    {
+        buffer.resize(count + 4096, 0xA5);
+    }
+
+    ParseOutcome outcome;
+    outcome.End = buffer.data() + count;
+
+    DETOUR_PE_IMAGE image;
+    if (!DetourPeParseHeaders(buffer.data(), count, &image))
+    {
+        outcome.Entries.push_back("not a PE file");
+        return outcome;
+    }
+
+    outcome.Entries.push_back("sections " + std::to_string(image.nSections) + ", directories " + std::to_string(image.nDataDirectories));
+    outcome.Entries.push_back(DetourPeEnumerateImports(&image, &outcome, &ParseOutcome::OnFile, &ParseOutcome::OnFunction) ? "complete" : "failed");
+    return outcome;
+}
+
+TEST(PeImage, FuzzedImagesStayWithinTheFile)
+{
+    // Random bytes of the headers and the import section overwritten with random or boundary values, and random truncations.
+    // The sanitizers catch reads past the exactly sized buffer; the padded one catches them without sanitizers.
+    std::mt19937 random(11);
+    const uint8_t boundaries[] = { 0x00, 0x01, 0x7F, 0x80, 0xFE, 0xFF, 0x10, 0x20 };
+    size_t parsed = 0;
+    for (bool pe32Plus : { false, true })
+    {
+        TestImage testImage(pe32Plus);
+        for (int iteration = 0; iteration < 20000; iteration++)
+        {
+            std::vector<uint8_t> bytes = testImage.Bytes();
+            for (int mutations = 1 + random() % 4; mutations > 0; mutations--)
+            {
+                bytes[random() % bytes.size()] = random() % 2 == 0 ? boundaries[random() % sizeof(boundaries)] : static_cast<uint8_t>(random());
+            }
+
+            const size_t count = random() % 8 == 0 ? random() % (bytes.size() + 1) : bytes.size();
+            const ParseOutcome exact = ParseAndEnumerate(bytes, count, false);
+            const ParseOutcome padded = ParseAndEnumerate(bytes, count, true);
+
+            ASSERT_FALSE(exact.StringOutsideTheFile);
+            ASSERT_FALSE(padded.StringOutsideTheFile);
+            ASSERT_EQ(Join(exact.Entries), Join(padded.Entries));
+            parsed += exact.Entries.front() != "not a PE file";
+        }
+    }
+
+    // Most mutations leave a parsable image, so that the import enumeration is fuzzed as well
+    EXPECT_TRUE(parsed > 20000);
+}
+
+static bool CountImport(void* context, const char* file)
+{
+    ++*static_cast<size_t*>(context);
+    return true;
+}
+
+static bool CountFunction(void* context, uint32_t ordinal, const char* function)
+{
+    ++*static_cast<size_t*>(context);
+    return true;
+}
+
+static void MeasureImports(const char* what, const std::vector<uint8_t>& bytes)
+{
+    UnitTests::Measure(what, [&]()
+    {
+        size_t imports = 0;
+        DETOUR_PE_IMAGE image;
+        if (DetourPeParseHeaders(bytes.data(), bytes.size(), &image))
+        {
+            DetourPeEnumerateImports(&image, &imports, CountImport, CountFunction);
+        }
+
+        return imports;
+    });
+}
+
+BENCHMARK(PeImage, EnumerateImports)
+{
+    MeasureImports("PE32 test image", TestImage(false).Bytes());
+    MeasureImports("PE32+ test image", TestImage(true).Bytes());
+
+#ifdef _WIN32
+    // Real images, read once: the benchmark measures the parsing, not the I/O
+    wchar_t system[MAX_PATH];
+    const UINT length = GetSystemDirectoryW(system, MAX_PATH);
+    for (const wchar_t* name : { L"\\kernel32.dll", L"\\ntdll.dll", L"\\cmd.exe" })
+    {
+        std::ifstream file(std::wstring(system, length) + name, std::ios::binary);
+        const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (!bytes.empty())
+        {
+            MeasureImports(UnitTests::Describe(std::wstring(name + 1)).c_str(), bytes);
+        }
+    }
+#endif
+}
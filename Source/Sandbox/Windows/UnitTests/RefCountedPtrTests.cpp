@@ -0,0 +1,168 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "TestFramework.h"
+#include "RefCountedPtr.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// An object that counts its destructions, like a PolicySnapshot or a ManifestGeneration released by its last reference.
+class Counted : public RefCounted
+{
+public:
+    typedef RefCountedPtr<Counted> Ref;
+
+    static Ref Create(std::atomic<int>* destroyed, int value)
+    {
+        return Ref::Adopt(new Counted(destroyed, value));
+    }
+
+    static void Destroy(Counted* counted) noexcept
+    {
+        (*counted->m_destroyed)++;
+        delete counted;
+    }
+
+    int GetValue() const noexcept { return m_value; }
+
+private:
+    Counted(std::atomic<int>* destroyed, int value) : m_destroyed(destroyed), m_value(value) { }
+    ~Counted() = default;
+
+    std::atomic<int>* m_destroyed;
+    int m_value;
+};
+
+TEST(RefCountedPtr, DestroysWithTheLastReference)
+{
+    std::atomic<int> destroyed(0);
+
+    {
+        Counted::Ref first = Counted::Create(&destroyed, 42);
+        ASSERT_TRUE(static_cast<bool>(first));
+
+        Counted::Ref copy(first);
+        Counted::Ref assigned;
+        EXPECT_FALSE(static_cast<bool>(assigned));
+        assigned = copy;
+
+        // Copies share the object
+        EXPECT_TRUE(first.Get() == copy.Get());
+        EXPECT_TRUE(first.Get() == assigned.Get());
+        EXPECT_EQ(42, assigned->GetValue());
+
+        first.Reset();
+        copy.Reset();
+        EXPECT_FALSE(static_cast<bool>(first));
+        EXPECT_EQ(0, destroyed.load());
+        EXPECT_EQ(42, (*assigned).GetValue());
+    }
+
+    EXPECT_EQ(1, destroyed.load());
+}
+
+TEST(RefCountedPtr, AssignmentReleasesThePreviousObject)
+{
+    std::atomic<int> destroyed(0);
+    Counted::Ref a = Counted::Create(&destroyed, 1);
+    Counted::Ref b = Counted::Create(&destroyed, 2);
+
+    a = b;
+    EXPECT_EQ(1, destroyed.load());
+    EXPECT_EQ(2, a->GetValue());
+
+    // Assigning an object to itself must not release it first
+    Counted::Ref& self = a;
+    a = self;
+    b.Reset();
+    EXPECT_EQ(1, destroyed.load());
+    EXPECT_EQ(2, a->GetValue());
+
+    a = Counted::Ref();
+    EXPECT_EQ(2, destroyed.load());
+}
+
+TEST(RefCountedPtr, MovesTransferTheReference)
+{
+    std::atomic<int> destroyed(0);
+    Counted::Ref source = Counted::Create(&destroyed, 7);
+    const Counted* object = source.Get();
+
+    Counted::Ref moved(std::move(source));
+    EXPECT_FALSE(static_cast<bool>(source));
+    EXPECT_TRUE(moved.Get() == object);
+
+    Counted::Ref assigned = Counted::Create(&destroyed, 8);
+    assigned = std::move(moved);
+    EXPECT_EQ(1, destroyed.load());
+    EXPECT_FALSE(static_cast<bool>(moved));
+    EXPECT_TRUE(assigned.Get() == object);
+
+    Counted::Ref& self = assigned;
+    assigned = std::move(self);
+    EXPECT_TRUE(assigned.Get() == object);
+
+    assigned.Reset();
+    EXPECT_EQ(2, destroyed.load());
+}
+
+TEST(RefCountedPtr, DetachHandsTheReferenceToTheCaller)
+{
+    std::atomic<int> destroyed(0);
+    Counted::Ref ref = Counted::Create(&destroyed, 3);
+
+    const Counted* detached = ref.Detach();
+    EXPECT_FALSE(static_cast<bool>(ref));
+    EXPECT_EQ(0, destroyed.load());
+
+    Counted::Ref adopted = Counted::Ref::Adopt(detached);
+    EXPECT_EQ(3, adopted->GetValue());
+    adopted.Reset();
+    EXPECT_EQ(1, destroyed.load());
+}
+
+TEST(RefCountedPtr, ConcurrentCopiesDestroyOnce)
+{
+    std::atomic<int> destroyed(0);
+    std::atomic<int> mismatches(0);
+
+    for (int round = 0; round < 200; round++)
+    {
+        Counted::Ref shared = Counted::Create(&destroyed, round);
+
+        // Each thread keeps copies of the shared object (as handle overlays keep the snapshot of the file they were opened for),
+        // then drops them, racing with the others and with the release of the original reference
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++)
+        {
+            threads.emplace_back([shared, &mismatches, round]()
+            {
+                std::vector<Counted::Ref> copies;
+                for (int i = 0; i < 64; i++)
+                {
+                    copies.push_back(i == 0 ? shared : copies.back());
+                }
+
+                for (const Counted::Ref& copy : copies)
+                {
+                    if (copy->GetValue() != round)
+                    {
+                        mismatches++;
+                    }
+                }
+            });
+        }
+
+        shared.Reset();
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        ASSERT_EQ(round + 1, destroyed.load());
+    }
+
+    EXPECT_EQ(0, mismatches.load());
+}
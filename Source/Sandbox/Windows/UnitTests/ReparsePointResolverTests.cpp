@@ -0,0 +1,358 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "TestFramework.h"
+#include "PathTestHelpers.h"
+#include "ReparsePointResolver.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+// A file system made of a table of reparse points. Any path that is not in the table is a regular file or directory.
+class InMemoryFileSystem : public ReparsePointFileSystem
+{
+public:
+    // Adds a reparse point. Paths and targets are written as for MakeAbsolutePath (or MakePath for a relative target).
+    void AddSymlink(const char* path, const char* target, bool isDirectory = false)
+    {
+        m_links[MakeAbsolutePath(path)] = Link{ IsRelative(target) ? MakePath(target) : MakeAbsolutePath(target), isDirectory };
+    }
+
+    void AddJunction(const char* path, const char* target)
+    {
+        AddSymlink(path, target);
+    }
+
+    void DoNotFollow(const char* path)
+    {
+        m_notFollowed.insert(MakeAbsolutePath(path));
+    }
+
+    bool TryGetReparsePointTarget(PCPathChar path, size_t pathLength, PathString& target) override
+    {
+        // Paths handed to the file system are null terminated
+        EXPECT_EQ(0, static_cast<int>(path[pathLength]));
+
+        const auto link = m_links.find(PathString(path, pathLength));
+        if (link == m_links.end())
+        {
+            return false;
+        }
+
+        target = link->second.Target;
+        return true;
+    }
+
+    bool IsDirectorySymlink(PCPathChar path, size_t pathLength) override
+    {
+        const auto link = m_links.find(PathString(path, pathLength));
+        return link != m_links.end() && link->second.IsDirectorySymlink;
+    }
+
+    bool ShouldFollow(PCPathChar path, size_t pathLength, const PathString&) override
+    {
+        return m_notFollowed.find(PathString(path, pathLength)) == m_notFollowed.end();
+    }
+
+private:
+    struct Link
+    {
+        PathString Target;
+        bool IsDirectorySymlink;
+    };
+
+    static bool IsRelative(const char* path)
+    {
+        return path[0] != '/';
+    }
+
+    std::map<PathString, Link> m_links;
+    std::set<PathString> m_notFollowed;
+};
+
+static std::vector<PathString> GetPaths(const ReparsePointChain& chain)
+{
+    std::vector<PathString> paths;
+    for (size_t i = 0; i < chain.Count(); i++)
+    {
+        EXPECT_EQ(0, static_cast<int>(chain.GetPath(i)[chain.GetPathLength(i)]));
+        paths.push_back(PathString(chain.GetPath(i), chain.GetPathLength(i)));
+    }
+
+    return paths;
+}
+
+static std::vector<PathString> AbsolutePaths(std::initializer_list<const char*> paths)
+{
+    std::vector<PathString> result;
+    for (const char* path : paths)
+    {
+        result.push_back(MakeAbsolutePath(path));
+    }
+
+    return result;
+}
+
+static bool GetNextPath(ReparsePointResolver& resolver, const char* path, PathString& nextPath)
+{
+    const PathString fullPath = MakeAbsolutePath(path);
+    return resolver.TryGetNextPath(fullPath.c_str(), fullPath.length(), nextPath);
+}
+
+static bool ResolveChain(ReparsePointResolver& resolver, const char* path, ReparsePointChain& chain)
+{
+    const PathString fullPath = MakeAbsolutePath(path);
+    return resolver.ResolveChain(fullPath.c_str(), fullPath.length(), chain);
+}
+
+static bool ResolveAll(ReparsePointResolver& resolver, const char* path, ReparsePointChain& chain, size_t firstLevelToResolve = 0, bool preserveLastReparsePoint = false)
+{
+    const PathString fullPath = MakeAbsolutePath(path);
+    return resolver.ResolveAll(fullPath.c_str(), fullPath.length(), firstLevelToResolve, preserveLastReparsePoint, chain);
+}
+
+TEST(ReparsePointResolver, NextPathOfAbsoluteAndRelativeTargets)
+{
+    InMemoryFileSystem fileSystem;
+    fileSystem.AddSymlink("/repo/absolute", "/elsewhere/target");
+    fileSystem.AddSymlink("/repo/sibling", "target");
+    fileSystem.AddSymlink("/repo/src/parent", "../target");
+    fileSystem.AddSymlink("/repo/src/dot", "./sub/target");
+    fileSystem.AddSymlink("/repo/abovetheroot", "../../../target");
+
+    ReparsePointResolver resolver(fileSystem);
+    PathString next;
+
+    EXPECT_FALSE(GetNextPath(resolver, "/repo/file", next));
+
+    ASSERT_TRUE(GetNextPath(resolver, "/repo/absolute", next));
+    EXPECT_EQ(MakeAbsolutePath("/elsewhere/target"), next);
+
+    ASSERT_TRUE(GetNextPath(resolver, "/repo/sibling", next));
+    EXPECT_EQ(MakeAbsolutePath("/repo/target"), next);
+
+    ASSERT_TRUE(GetNextPath(resolver, "/repo/src/parent", next));
+    EXPECT_EQ(MakeAbsolutePath("/repo/target"), next);
+
+    ASSERT_TRUE(GetNextPath(resolver, "/repo/src/dot", next));
+    EXPECT_EQ(MakeAbsolutePath("/repo/src/sub/target"), next);
+
+    EXPECT_FALSE(GetNextPath(resolver, "/repo/abovetheroot", next));
+}
+
+TEST(ReparsePointResolver, RelativeTargetsAreEvaluatedPastDirectorySymlinks)
+{
+    // repo/source/link ==> ..\target where repo/source ==> intermediate/current
+    InMemoryFileSystem fileSystem;
+    fileSystem.AddSymlink("/repo/source", "intermediate/current", true);
+    fileSystem.AddSymlink("/repo/source/link", "../target");
+
+    ReparsePointResolver resolver(fileSystem);
+    PathString next;
+    ASSERT_TRUE(GetNextPath(resolver, "/repo/source/link", next));
+    EXPECT_EQ(MakeAbsolutePath("/repo/intermediate/target"), next);
+}
+
+TEST(ReparsePointResolver, RelativeTargetsAreEvaluatedAgainstJunctionsAsTheyAre)
+{
+    InMemoryFileSystem fileSystem;
+    fileSystem.AddJunction("/repo/source", "/repo/intermediate/current");
+    fileSystem.AddSymlink("/repo/source/link", "../target");
+
+    ReparsePointResolver resolver(fileSystem);
+    PathString next;
+    ASSERT_TRUE(GetNextPath(resolver, "/repo/source/link", next));
+    EXPECT_EQ(MakeAbsolutePath("/repo/target"), next);
+}
+
+TEST(ReparsePointResolver, RelativeTargetsAreEvaluatedPastAbsoluteDirectorySymlinks)
+{
+    InMemoryFileSystem fileSystem;
+    fileSystem.AddSymlink("/repo/source", "/other/current", true);
+    fileSystem.AddSymlink("/repo/source/link", "../target");
+
+    ReparsePointResolver resolver(fileSystem);
+    PathString next;
+    ASSERT_TRUE(GetNextPath(resolver, "/repo/source/link", next));
+    EXPECT_EQ(MakeAbsolutePath("/other/target"), next);
+}
+
+TEST(ReparsePointResolver, ResolveChainFollowsEveryHop)
+{
+    InMemoryFileSystem fileSystem;
+    fileSystem.AddSymlink("/a", "/b");
+    fileSystem.AddSymlink("/b", "dir/./../c");
+    fileSystem.AddSymlink("/c", "/d/file");
+
+    ReparsePointResolver resolver(fileSystem);
+    ReparsePointChain chain;
+    ASSERT_TRUE(ResolveChain(resolver, "/a", chain));
+    EXPECT_TRUE(chain.IsFullyResolved());
+    EXPECT_TRUE(AbsolutePaths({ "/a", "/b", "/c", "/d/file" }) == GetPaths(chain));
+    EXPECT_TRUE(chain.Contains(MakeAbsolutePath("/c").c_str(), MakeAbsolutePath("/c").length()));
+    EXPECT_FALSE(chain.Contains(MakeAbsolutePath("/e").c_str(), MakeAbsolutePath("/e").length()));
+
+    // Not a reparse point
+    ASSERT_TRUE(ResolveChain(resolver, "/d/file", chain));
+    EXPECT_TRUE(chain.IsFullyResolved());
+    EXPECT_TRUE(AbsolutePaths({ "/d/file" }) == GetPaths(chain));
+}
+
+TEST(ReparsePointResolver, ResolveChainStopsAtCycles)
+{
+    InMemoryFileSystem fileSystem;
+    fileSystem.AddSymlink("/a", "/b");
+    fileSystem.AddSymlink("/b", "c");
+    fileSystem.AddSymlink("/c", "/a");
+    fileSystem.AddSymlink("/self", "self");
+
+    ReparsePointResolver resolver(fileSystem);
+    ReparsePointChain chain;
+    EXPECT_FALSE(ResolveChain(resolver, "/a", chain));
+    EXPECT_FALSE(chain.IsFullyResolved());
+    EXPECT_FALSE(chain.HitHopLimit());
+    EXPECT_TRUE(AbsolutePaths({ "/a", "/b", "/c" }) == GetPaths(chain));
+
+    EXPECT_FALSE(ResolveChain(resolver, "/self", chain));
+    EXPECT_TRUE(AbsolutePaths({ "/self" }) == GetPaths(chain));
+}
+
+TEST(ReparsePointResolver, ResolveChainStopsAtTheHopLimit)
+{
+    // A chain of distinct links one longer than the limit
+    InMemoryFileSystem fileSystem;
+    std::vector<std::string> names;
+    for (size_t i = 0; i <= MAX_REPARSE_POINT_HOPS + 1; i++)
+    {
+        names.push_back("/link" + std::to_string(i));
+    }
+
+    for (size_t i = 0; i + 1 < names.size(); i++)
+    {
+        fileSystem.AddSymlink(names[i].c_str(), names[i + 1].c_str());
+    }
+
+    ReparsePointResolver resolver(fileSystem);
+    ReparsePointChain chain;
+    EXPECT_FALSE(ResolveChain(resolver, "/link0", chain));
+    EXPECT_FALSE(chain.IsFullyResolved());
+    EXPECT_TRUE(chain.HitHopLimit());
+    EXPECT_EQ(static_cast<size_t>(MAX_REPARSE_POINT_HOPS + 1), chain.Count());
+
+    // One hop fewer resolves
+    ASSERT_TRUE(ResolveChain(resolver, "/link1", chain));
+    EXPECT_TRUE(chain.IsFullyResolved());
+    EXPECT_FALSE(chain.HitHopLimit());
+    EXPECT_EQ(static_cast<size_t>(MAX_REPARSE_POINT_HOPS + 1), chain.Count());
+}
+
+TEST(ReparsePointResolver, ResolveAllFollowsDirectoriesAndTheFinalComponent)
+{
+    InMemoryFileSystem fileSystem;
+    fileSystem.AddSymlink("/out/dirlink", "/real", true);
+    fileSystem.AddSymlink("/real/sub", "../other", true);
+    fileSystem.AddSymlink("/other/filelink", "file");
+
+    ReparsePointResolver resolver(fileSystem);
+    ReparsePointChain chain;
+    ASSERT_TRUE(ResolveAll(resolver, "/out/dirlink/sub/filelink", chain));
+    EXPECT_TRUE(chain.IsFullyResolved());
+    EXPECT_TRUE(AbsolutePaths({ "/out/dirlink", "/real/sub", "/other/filelink", "/other/file" }) == GetPaths(chain));
+
+    // Without reparse points, the chain is the normalized path alone
+    ASSERT_TRUE(ResolveAll(resolver, "/out//plain/./file", chain));
+    EXPECT_TRUE(AbsolutePaths({ "/out/plain/file" }) == GetPaths(chain));
+}
+
+TEST(ReparsePointResolver, ResolveAllCanPreserveTheLastReparsePoint)
+{
+    InMemoryFileSystem fileSystem;
+    fileSystem.AddSymlink("/out/dirlink", "/real", true);
+    fileSystem.AddSymlink("/real/filelink", "file");
+
+    ReparsePointResolver resolver(fileSystem);
+    ReparsePointChain chain;
+    ASSERT_TRUE(ResolveAll(resolver, "/out/dirlink/filelink", chain, 0, true));
+    EXPECT_TRUE(AbsolutePaths({ "/out/dirlink", "/real/filelink" }) == GetPaths(chain));
+}
+
+TEST(ReparsePointResolver, ResolveAllSkipsLowLevelsOfTheOriginalPathOnly)
+{
+    InMemoryFileSystem fileSystem;
+    fileSystem.AddSymlink("/top", "/real", true);
+    fileSystem.AddSymlink("/top/link", "/top/again", true);
+
+    ReparsePointResolver resolver(fileSystem);
+    ReparsePointChain chain;
+
+    // Level 1 (/top) is skipped in the original path, but checked again in the path /top/link leads to
+    ASSERT_TRUE(ResolveAll(resolver, "/top/link/file", chain, 2));
+    EXPECT_TRUE(AbsolutePaths({ "/top/link", "/top", "/real/again/file" }) == GetPaths(chain));
+
+    ASSERT_TRUE(ResolveAll(resolver, "/top/link/file", chain, 0));
+    EXPECT_TRUE(AbsolutePaths({ "/top", "/real/link/file" }) == GetPaths(chain));
+}
+
+TEST(ReparsePointResolver, ResolveAllHonorsShouldFollow)
+{
+    InMemoryFileSystem fileSystem;
+    fileSystem.AddSymlink("/out/dirlink", "/real", true);
+    fileSystem.DoNotFollow("/out/dirlink");
+
+    ReparsePointResolver resolver(fileSystem);
+    ReparsePointChain chain;
+    ASSERT_TRUE(ResolveAll(resolver, "/out/dirlink/file", chain));
+    EXPECT_TRUE(AbsolutePaths({ "/out/dirlink/file" }) == GetPaths(chain));
+}
+
+TEST(ReparsePointResolver, ResolveAllStopsAtCycles)
+{
+    InMemoryFileSystem fileSystem;
+    fileSystem.AddSymlink("/a", "/b", true);
+    fileSystem.AddSymlink("/b", "/a", true);
+
+    ReparsePointResolver resolver(fileSystem);
+    ReparsePointChain chain;
+    EXPECT_FALSE(ResolveAll(resolver, "/a/file", chain));
+    EXPECT_FALSE(chain.IsFullyResolved());
+
+    // Directory links are not checked for repeats, so the cycle ends at the hop limit
+    EXPECT_TRUE(chain.HitHopLimit());
+    EXPECT_EQ(static_cast<size_t>(MAX_REPARSE_POINT_HOPS + 1), chain.Count());
+}
+
+TEST(ReparsePointResolver, ResolverIsReusable)
+{
+    InMemoryFileSystem fileSystem;
+    fileSystem.AddSymlink("/a", "/b");
+    fileSystem.AddSymlink("/x/y", "z");
+
+    ReparsePointResolver resolver(fileSystem);
+    ReparsePointChain chain;
+    for (int i = 0; i < 3; i++)
+    {
+        ASSERT_TRUE(ResolveChain(resolver, "/a", chain));
+        EXPECT_TRUE(AbsolutePaths({ "/a", "/b" }) == GetPaths(chain));
+        ASSERT_TRUE(ResolveAll(resolver, "/x/y", chain));
+        EXPECT_TRUE(AbsolutePaths({ "/x/y", "/x/z" }) == GetPaths(chain));
+    }
+}
+
+TEST(TryNormalizePathLexically, CollapsesDotsAndSeparators)
+{
+    PathString normalized;
+    const PathString path = MakeAbsolutePath("/a//b/./c/../d/");
+    ASSERT_TRUE(TryNormalizePathLexically(path.c_str(), path.length(), normalized));
+    EXPECT_EQ(MakeAbsolutePath("/a/b/d"), normalized);
+
+    const PathString root = MakeAbsolutePath("/a/..");
+    ASSERT_TRUE(TryNormalizePathLexically(root.c_str(), root.length(), normalized));
+    EXPECT_EQ(MakeAbsolutePath("/"), normalized);
+
+    const PathString aboveRoot = MakeAbsolutePath("/a/../..");
+    EXPECT_FALSE(TryNormalizePathLexically(aboveRoot.c_str(), aboveRoot.length(), normalized));
+
+    const PathString relative = MakePath("a/b");
+    EXPECT_FALSE(TryNormalizePathLexically(relative.c_str(), relative.length(), normalized));
+}
@@ -0,0 +1,269 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "TestFramework.h"
+#include "stdafx.h"
+#include "SlabAllocator.h"
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+#if _WIN32
+// The large block allocator is the private heap of DetoursServices (see DetoursServices.cpp).
+HANDLE g_hPrivateHeap = GetProcessHeap();
+#endif
+
+// A fresh allocator for each test. The allocator is zero initialized, as the global one is.
+// Destroy leaves the slab range reserved, which only costs address space.
+class TestAllocator
+{
+public:
+    TestAllocator() : m_allocator(new SlabAllocator()) { }
+    ~TestAllocator() { m_allocator->Destroy(); }
+
+    SlabAllocator* operator->() const noexcept { return m_allocator.get(); }
+    SlabAllocator& operator*() const noexcept { return *m_allocator; }
+
+private:
+    std::unique_ptr<SlabAllocator> m_allocator;
+};
+
+static bool IsZeroed(const void* block, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(block);
+    for (size_t i = 0; i < size; i++)
+    {
+        if (bytes[i] != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static SlabAllocatorStatistics GetStatistics(const SlabAllocator& allocator)
+{
+    SlabAllocatorStatistics statistics;
+    allocator.GetStatistics(statistics);
+    return statistics;
+}
+
+TEST(SlabAllocator, SizeClassesCoverEverySmallSize)
+{
+    EXPECT_EQ(0U, SlabAllocator::GetSizeClass(0));
+    EXPECT_EQ(SLAB_ALLOCATOR_CLASS_COUNT - 1, SlabAllocator::GetSizeClass(SLAB_ALLOCATOR_MAX_SMALL_SIZE));
+    EXPECT_EQ(static_cast<size_t>(SLAB_ALLOCATOR_MAX_SMALL_SIZE), SlabAllocator::GetClassSize(SLAB_ALLOCATOR_CLASS_COUNT - 1));
+
+    for (unsigned sizeClass = 0; sizeClass < SLAB_ALLOCATOR_CLASS_COUNT; sizeClass++)
+    {
+        const size_t classSize = SlabAllocator::GetClassSize(sizeClass);
+        ASSERT_EQ(0U, classSize % 16);
+        ASSERT_EQ(sizeClass, SlabAllocator::GetSizeClass(classSize));
+        if (sizeClass > 0)
+        {
+            ASSERT_TRUE(SlabAllocator::GetClassSize(sizeClass - 1) < classSize);
+        }
+    }
+
+    // Each size gets the smallest class it fits in
+    for (size_t size = 1; size <= SLAB_ALLOCATOR_MAX_SMALL_SIZE; size++)
+    {
+        const unsigned sizeClass = SlabAllocator::GetSizeClass(size);
+        ASSERT_TRUE(SlabAllocator::GetClassSize(sizeClass) >= size);
+        ASSERT_TRUE(sizeClass == 0 || SlabAllocator::GetClassSize(sizeClass - 1) < size);
+    }
+}
+
+TEST(SlabAllocator, SmallBlocksAreZeroedAlignedAndDistinct)
+{
+    TestAllocator allocator;
+    ASSERT_TRUE(allocator->Initialize());
+
+    std::vector<std::pair<uint8_t*, size_t>> blocks;
+    for (size_t size = 1; size <= SLAB_ALLOCATOR_MAX_SMALL_SIZE; size += 7)
+    {
+        uint8_t* block = static_cast<uint8_t*>(allocator->Allocate(size));
+        ASSERT_TRUE(block != nullptr);
+        EXPECT_EQ(0U, reinterpret_cast<uintptr_t>(block) % 16);
+        EXPECT_TRUE(IsZeroed(block, size));
+        blocks.push_back(std::make_pair(block, size));
+    }
+
+    // No block overlaps another: fill each one, then check that all of them kept their contents
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        memset(blocks[i].first, static_cast<int>(i % 255 + 1), blocks[i].second);
+    }
+
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        for (size_t j = 0; j < blocks[i].second; j++)
+        {
+            ASSERT_EQ(static_cast<int>(i % 255 + 1), static_cast<int>(blocks[i].first[j]));
+        }
+
+        allocator->Free(blocks[i].first);
+    }
+}
+
+TEST(SlabAllocator, ReusedBlocksAreZeroed)
+{
+    TestAllocator allocator;
+    ASSERT_TRUE(allocator->Initialize());
+
+    std::set<void*> freed;
+    for (int i = 0; i < 100; i++)
+    {
+        void* block = allocator->Allocate(48);
+        memset(block, 0xAB, 48);
+        freed.insert(block);
+        allocator->Free(block);
+    }
+
+    // The freed block gets handed out again, cleared
+    void* block = allocator->Allocate(40);
+    EXPECT_TRUE(freed.find(block) != freed.end());
+    EXPECT_TRUE(IsZeroed(block, 40));
+    allocator->Free(block);
+}
+
+TEST(SlabAllocator, TracksSmallAndLargeBlocks)
+{
+    TestAllocator allocator;
+    ASSERT_TRUE(allocator->Initialize());
+
+    void* small = allocator->Allocate(100);
+    void* large = allocator->Allocate(SLAB_ALLOCATOR_MAX_SMALL_SIZE + 1);
+    void* larger = allocator->Allocate(100000);
+    ASSERT_TRUE(small != nullptr && large != nullptr && larger != nullptr);
+    EXPECT_TRUE(IsZeroed(larger, 100000));
+    EXPECT_EQ(0U, reinterpret_cast<uintptr_t>(large) % 16);
+
+    SlabAllocatorStatistics statistics = GetStatistics(*allocator);
+    EXPECT_EQ(1U, statistics.SmallAllocations);
+    EXPECT_EQ(static_cast<int64_t>(SlabAllocator::GetClassSize(SlabAllocator::GetSizeClass(100))), statistics.SmallBytesInUse);
+    EXPECT_EQ(2U, statistics.LargeAllocations);
+    EXPECT_EQ(static_cast<int64_t>(SLAB_ALLOCATOR_MAX_SMALL_SIZE + 1 + 100000), statistics.LargeBytesInUse);
+    EXPECT_EQ(statistics.LargeBytesInUse, statistics.PeakLargeBytes);
+    EXPECT_EQ(static_cast<uint64_t>(SLAB_ALLOCATOR_SLAB_SIZE), statistics.CommittedSlabBytes);
+
+    allocator->Free(small);
+    allocator->Free(larger);
+    allocator->Free(large);
+    allocator->Free(nullptr);
+
+    statistics = GetStatistics(*allocator);
+    EXPECT_EQ(0, statistics.SmallBytesInUse);
+    EXPECT_EQ(0, statistics.LargeBytesInUse);
+    EXPECT_EQ(static_cast<int64_t>(SLAB_ALLOCATOR_MAX_SMALL_SIZE + 1 + 100000), statistics.PeakLargeBytes);
+}
+
+TEST(SlabAllocator, UninitializedAllocatorServesLargeBlocks)
+{
+    TestAllocator allocator;
+
+    void* block = allocator->Allocate(16);
+    ASSERT_TRUE(block != nullptr);
+    EXPECT_TRUE(IsZeroed(block, 16));
+
+    const SlabAllocatorStatistics statistics = GetStatistics(*allocator);
+    EXPECT_EQ(0U, statistics.SmallAllocations);
+    EXPECT_EQ(1U, statistics.LargeAllocations);
+    EXPECT_EQ(0U, statistics.CommittedSlabBytes);
+
+    allocator->Free(block);
+}
+
+TEST(SlabAllocator, BlocksCanBeFreedAfterDestroy)
+{
+    TestAllocator allocator;
+    ASSERT_TRUE(allocator->Initialize());
+
+    void* small = allocator->Allocate(64);
+    void* large = allocator->Allocate(4096);
+    allocator->Destroy();
+
+    // Still recognized as a slab block, so it is not handed to the large block allocator
+    allocator->Free(small);
+    allocator->Free(large);
+
+    const SlabAllocatorStatistics statistics = GetStatistics(*allocator);
+    EXPECT_EQ(0, statistics.LargeBytesInUse);
+}
+
+TEST(SlabAllocator, ThreadsAllocateAndFreeConcurrently)
+{
+    TestAllocator allocator;
+    ASSERT_TRUE(allocator->Initialize());
+
+    const int threadCount = 8;
+    const size_t blocksPerThread = 2000;
+    std::vector<std::vector<uint8_t*>> allocated(threadCount);
+    std::atomic<int> corrupted(0);
+
+    // Each thread allocates, fills and checks its own blocks, then frees those of its neighbor, so that blocks move between threads.
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++)
+    {
+        threads.emplace_back([&allocator, &allocated, &corrupted, t]()
+        {
+            for (size_t i = 0; i < blocksPerThread; i++)
+            {
+                const size_t size = 1 + (i * 37 + t) % (SLAB_ALLOCATOR_MAX_SMALL_SIZE + 200);
+                uint8_t* block = static_cast<uint8_t*>(allocator->Allocate(size));
+                if (block == nullptr || !IsZeroed(block, size))
+                {
+                    corrupted++;
+                    continue;
+                }
+
+                memset(block, t + 1, size);
+                allocated[t].push_back(block);
+            }
+
+            for (size_t i = 0; i < allocated[t].size(); i++)
+            {
+                if (allocated[t][i][0] != t + 1)
+                {
+                    corrupted++;
+                }
+            }
+
+            allocator->ReleaseThreadCache();
+        });
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    threads.clear();
+    for (int t = 0; t < threadCount; t++)
+    {
+        threads.emplace_back([&allocator, &allocated, t]()
+        {
+            for (uint8_t* block : allocated[(t + 1) % threadCount])
+            {
+                allocator->Free(block);
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(0, corrupted.load());
+
+    // Caches of exited threads are reused by new ones, and the counters add up across them
+    const SlabAllocatorStatistics statistics = GetStatistics(*allocator);
+    EXPECT_EQ(static_cast<uint64_t>(threadCount * blocksPerThread), statistics.SmallAllocations + statistics.LargeAllocations);
+    EXPECT_EQ(0, statistics.SmallBytesInUse);
+    EXPECT_EQ(0, statistics.LargeBytesInUse);
+}
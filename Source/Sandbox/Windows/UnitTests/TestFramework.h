@@ -0,0 +1,198 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Minimal unit test framework for the sandbox sources that do not depend on the Win32 API.
+//
+// Tests are defined with TEST(Suite, Name) and registered when the test binary starts. EXPECT_* checks report
+// a failure and let the test continue; ASSERT_* checks report a failure and return from the test.
+// The runner (main.cpp) runs every test whose "Suite.Name" contains the filter given on the command line.
+//
+// Benchmarks are defined with BENCHMARK(Suite, Name) and only run with --benchmark. They time their loops with Measure.
+namespace UnitTests {
+
+struct TestCase
+{
+    const char* Suite;
+    const char* Name;
+    void (*Body)();
+};
+
+inline std::vector<TestCase>& GetTests()
+{
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+inline std::vector<TestCase>& GetBenchmarks()
+{
+    static std::vector<TestCase> benchmarks;
+    return benchmarks;
+}
+
+// Number of failed checks of the running test.
+inline int& CurrentFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+inline void ReportFailure(const char* file, int line, const std::string& message)
+{
+    CurrentFailures()++;
+    std::fprintf(stderr, "%s(%d): %s\n", file, line, message.c_str());
+}
+
+struct TestRegistration
+{
+    TestRegistration(std::vector<TestCase>& tests, const char* suite, const char* name, void (*body)())
+    {
+        tests.push_back(TestCase{ suite, name, body });
+    }
+};
+
+// Calls 'body' until it ran for about half a second, and prints the average time per call.
+// 'body' returns a value that depends on the work done, so that the compiler can't drop it.
+template <typename TBody>
+void Measure(const char* what, TBody body)
+{
+    using Clock = std::chrono::steady_clock;
+
+    volatile size_t sink = 0;
+    size_t calls = 0;
+    const Clock::time_point start = Clock::now();
+    Clock::duration elapsed;
+    do
+    {
+        for (int i = 0; i < 64; i++)
+        {
+            sink = sink + static_cast<size_t>(body());
+        }
+
+        calls += 64;
+        elapsed = Clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(500));
+
+    const double nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count() / calls;
+    std::printf("  %-40s %12.1f ns per call (%zu calls)\n", what, nanoseconds, calls);
+}
+
+template <typename T>
+std::string Describe(const T& value)
+{
+    std::ostringstream stream;
+    stream << value;
+    return stream.str();
+}
+
+inline std::string Describe(const std::wstring& value)
+{
+    std::string narrow;
+    for (wchar_t c : value)
+    {
+        narrow += c < 0x80 ? static_cast<char>(c) : '?';
+    }
+
+    return narrow;
+}
+
+inline std::string Describe(const wchar_t* value) { return Describe(std::wstring(value)); }
+inline std::string Describe(std::nullptr_t) { return "nullptr"; }
+inline std::string Describe(bool value) { return value ? "true" : "false"; }
+
+template <typename TExpected, typename TActual>
+bool CheckEqual(const TExpected& expected, const TActual& actual, const char* expectedText, const char* actualText, const char* file, int line)
+{
+    if (expected == actual)
+    {
+        return true;
+    }
+
+    ReportFailure(file, line, std::string("Expected ") + actualText + " == " + expectedText
+        + ", actual: " + Describe(actual) + ", expected: " + Describe(expected));
+    return false;
+}
+
+inline bool CheckTrue(bool condition, const char* text, const char* file, int line)
+{
+    if (!condition)
+    {
+        ReportFailure(file, line, std::string("Expected ") + text);
+    }
+
+    return condition;
+}
+
+// Runs the tests whose full name contains 'filter' (all of them if it is null). Returns the number of failed tests.
+inline int RunTests(const char* filter)
+{
+    int failedTests = 0;
+    int ranTests = 0;
+    for (const TestCase& test : GetTests())
+    {
+        const std::string fullName = std::string(test.Suite) + "." + test.Name;
+        if (filter != nullptr && fullName.find(filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        CurrentFailures() = 0;
+        test.Body();
+        ranTests++;
+        if (CurrentFailures() > 0)
+        {
+            failedTests++;
+            std::fprintf(stderr, "[  FAILED  ] %s\n", fullName.c_str());
+        }
+        else
+        {
+            std::printf("[       OK ] %s\n", fullName.c_str());
+        }
+    }
+
+    std::printf("%d tests ran, %d failed\n", ranTests, failedTests);
+    return failedTests;
+}
+
+// Runs the benchmarks whose full name contains 'filter' (all of them if it is null).
+inline void RunBenchmarks(const char* filter)
+{
+    for (const TestCase& benchmark : GetBenchmarks())
+    {
+        const std::string fullName = std::string(benchmark.Suite) + "." + benchmark.Name;
+        if (filter == nullptr || fullName.find(filter) != std::string::npos)
+        {
+            std::printf("%s\n", fullName.c_str());
+            benchmark.Body();
+        }
+    }
+}
+
+} // namespace UnitTests
+
+#define TEST(suite, name) \
+    static void suite##_##name(); \
+    static const UnitTests::TestRegistration s_##suite##_##name##_registration(UnitTests::GetTests(), #suite, #name, &suite##_##name); \
+    static void suite##_##name()
+
+#define BENCHMARK(suite, name) \
+    static void suite##_##name##_Benchmark(); \
+    static const UnitTests::TestRegistration s_##suite##_##name##_benchmark(UnitTests::GetBenchmarks(), #suite, #name, &suite##_##name##_Benchmark); \
+    static void suite##_##name##_Benchmark()
+
+#define EXPECT_TRUE(condition) UnitTests::CheckTrue(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+#define EXPECT_FALSE(condition) UnitTests::CheckTrue(!(condition), "!(" #condition ")", __FILE__, __LINE__)
+#define EXPECT_EQ(expected, actual) UnitTests::CheckEqual((expected), (actual), #expected, #actual, __FILE__, __LINE__)
+
+#define ASSERT_TRUE(condition) do { if (!EXPECT_TRUE(condition)) return; } while (0)
+#define ASSERT_FALSE(condition) do { if (!EXPECT_FALSE(condition)) return; } while (0)
+#define ASSERT_EQ(expected, actual) do { if (!EXPECT_EQ(expected, actual)) return; } while (0)
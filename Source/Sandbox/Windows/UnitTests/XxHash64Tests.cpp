@@ -0,0 +1,76 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "TestFramework.h"
+#include "XxHash64.h"
+
+#include <vector>
+
+// The buffer of the xxHash sanity checks: bytes taken from the top of a 64-bit multiplicative sequence
+static std::vector<uint8_t> GetSanityBuffer()
+{
+    std::vector<uint8_t> buffer(222);
+    uint64_t generator = 2654435761ULL;
+    for (uint8_t& byte : buffer)
+    {
+        byte = static_cast<uint8_t>(generator >> 56);
+        generator *= 11400714785074694797ULL;
+    }
+
+    return buffer;
+}
+
+// A manifest tree as serialized by FileAccessManifest.GetManifestTreeBytes (release layout, on Linux) for a scope on /usr
+// and a write policy on /out/bin/tool.
+// CODESYNC: Public/Src/Engine/UnitTests/Processes/FileAccessManifestChecksumTests.cs :: s_serializedTree
+static const uint8_t SerializedTree[] =
+{
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x00, 0x00, 0x24, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xC5, 0x9D, 0x1C, 0x81, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x10, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x02, 0x00, 0x00, 0x00,
+    0x48, 0x00, 0x00, 0x00, 0x29, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF9, 0x85, 0xA4, 0x80,
+    0x05, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x10, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x75, 0x73, 0x72, 0x00, 0xFB, 0xF5, 0xF8, 0xFB,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x10, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x00, 0x00, 0x24, 0x00, 0x00, 0x00, 0x6F, 0x75, 0x74, 0x00,
+    0x46, 0xE6, 0x5C, 0xA2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x10,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x00, 0x00, 0x24, 0x00, 0x00, 0x00,
+    0x62, 0x69, 0x6E, 0x00, 0xF5, 0x4A, 0xC0, 0x71, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
+    0x05, 0x00, 0x00, 0x10, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00,
+    0x74, 0x6F, 0x6F, 0x6C, 0x00, 0x00, 0x00, 0x00,
+};
+
+TEST(XxHash64, MatchesTheReferenceVectors)
+{
+    // The published values of the xxHash sanity checks, for lengths that go through every path of the hash:
+    // no stripe, the 1-byte tail, the 8- and 4-byte tails, and several 32-byte stripes
+    const std::vector<uint8_t> buffer = GetSanityBuffer();
+    const uint64_t seed = 2654435761ULL;
+
+    EXPECT_EQ(0xEF46DB3751D8E999ULL, XxHash64::Compute(nullptr, 0));
+    EXPECT_EQ(0xAC75FDA2929B17EFULL, XxHash64::Compute(nullptr, 0, seed));
+    EXPECT_EQ(0xE934A84ADB052768ULL, XxHash64::Compute(buffer.data(), 1));
+    EXPECT_EQ(0x5014607643A9B4C3ULL, XxHash64::Compute(buffer.data(), 1, seed));
+    EXPECT_EQ(0x8282DCC4994E35C8ULL, XxHash64::Compute(buffer.data(), 14));
+    EXPECT_EQ(0xC3BD6BF63DEB6DF0ULL, XxHash64::Compute(buffer.data(), 14, seed));
+    EXPECT_EQ(0xB641AE8CB691C174ULL, XxHash64::Compute(buffer.data(), 222));
+    EXPECT_EQ(0x20CB8AB7AE10C14AULL, XxHash64::Compute(buffer.data(), 222, seed));
+
+    EXPECT_EQ(0x44BC2CF5AD770999ULL, XxHash64::Compute("abc", 3));
+}
+
+TEST(XxHash64, ReadsUnalignedData)
+{
+    const std::vector<uint8_t> buffer = GetSanityBuffer();
+    std::vector<uint8_t> shifted(buffer.size() + 3);
+    std::memcpy(shifted.data() + 3, buffer.data(), buffer.size());
+
+    EXPECT_EQ(0xB641AE8CB691C174ULL, XxHash64::Compute(shifted.data() + 3, buffer.size()));
+}
+
+TEST(XxHash64, MatchesTheManagedChecksumOfASerializedTree)
+{
+    // The value the managed writer puts in the checksum block for this tree
+    EXPECT_EQ(0xBF4C0FC60D42B490ULL, XxHash64::Compute(SerializedTree, sizeof(SerializedTree)));
+}
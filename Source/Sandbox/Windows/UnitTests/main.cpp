@@ -0,0 +1,22 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "TestFramework.h"
+
+// Runs the sandbox unit tests: all of them, or those whose "Suite.Name" contains the first argument.
+// Exits with the number of failed tests. With --benchmark, runs the benchmarks instead (those whose name contains
+// the next argument, if any); build with optimizations and without sanitizers for those.
+//
+// On Windows the tests are built by DetoursServices.UnitTests.x64.vcxproj. Elsewhere they build with any C++17
+// compiler, from this directory, e.g.:
+//   g++ -std=c++17 -pthread -I. -I../DetoursServices -I../Detours/Lib -o UnitTests *.cpp ../DetoursServices/{EpochReclaimer,IndexedPath,PathScanner,ReparsePointResolver,SlabAllocator,StringOperations}.cpp ../Detours/Lib/{disasmlen,peimage}.cpp
+int main(int argc, char** argv)
+{
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0)
+    {
+        UnitTests::RunBenchmarks(argc > 2 ? argv[2] : nullptr);
+        return 0;
+    }
+
+    return UnitTests::RunTests(argc > 1 ? argv[1] : nullptr);
+}
@@ -0,0 +1,27 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+
+// The sandbox sources include this header first when they are built for Linux (see DetoursServices/stdafx.h).
+// The unit tests only build the sources that don't depend on the sandbox runtime, which need nothing but the
+// standard headers. They have to be included before stdafx-unix-common.h defines its Win32 type macros.
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cwctype>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <random>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
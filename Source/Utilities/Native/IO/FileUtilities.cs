@@ -235,6 +235,44 @@ namespace BuildXL.Native.IO
             Func<SafeFileHandle, SafeFileHandle, bool> predicate = null,
             Action<SafeFileHandle, SafeFileHandle> onCompletion = null) => OsFileUtilities.CopyFileAsync(source, destination, predicate, onCompletion);
 
+        /// <summary>
+        /// Copies each (source, destination) pair of <paramref name="copies"/> as <see cref="CopyFileAsync"/> does, with at most
+        /// <paramref name="maxConcurrentCopies"/> copies in flight (<see cref="Environment.ProcessorCount"/> when not positive).
+        /// </summary>
+        /// <remarks>
+        /// <paramref name="predicate"/> and <paramref name="onCompletion"/> are called for each pair as for a single copy, concurrently across pairs.
+        /// Returns, for each pair, whether it was copied (false when the predicate declined it). All copies run to completion before the failures,
+        /// if any, are thrown together in an <see cref="AggregateException"/>.
+        /// </remarks>
+        public static async Task<bool[]> CopyFilesAsync(
+            IReadOnlyList<(string source, string destination)> copies,
+            Func<SafeFileHandle, SafeFileHandle, bool> predicate = null,
+            Action<SafeFileHandle, SafeFileHandle> onCompletion = null,
+            int maxConcurrentCopies = 0)
+        {
+            Contract.RequiresNotNull(copies);
+
+            using (var semaphore = new SemaphoreSlim(maxConcurrentCopies > 0 ? maxConcurrentCopies : Environment.ProcessorCount))
+            {
+                var tasks = new Task<bool>[copies.Count];
+                for (int i = 0; i < copies.Count; i++)
+                {
+                    tasks[i] = copyAsync(semaphore, copies[i].source, copies[i].destination);
+                }
+
+                // Every copy is done with the semaphore once this completes, successfully or not.
+                return await TaskUtilities.SafeWhenAll(tasks);
+            }
+
+            async Task<bool> copyAsync(SemaphoreSlim semaphore, string source, string destination)
+            {
+                using (await semaphore.AcquireAsync())
+                {
+                    return await OsFileUtilities.CopyFileAsync(source, destination, predicate, onCompletion);
+                }
+            }
+        }
+
         /// <see cref="IFileUtilities.MoveFileAsync(string, string, bool)"/>
         public static Task MoveFileAsync(
             string source,
@@ -56,6 +56,14 @@ namespace BuildXL.Native.IO
         /// Indicates that no modification can be done further.
         /// </summary>
         void Done();
+
+        /// <summary>
+        /// Whether the attributes passed to <see cref="IDirectoryEntryAccumulator.AddTrackFile"/> must include <see cref="FileAttributes.ReadOnly"/>.
+        /// </summary>
+        /// <remarks>
+        /// On Linux, the other attributes of most entries come with the entry itself, while ReadOnly costs a stat per entry.
+        /// </remarks>
+        bool TracksReadOnly => true;
     }
 }
 
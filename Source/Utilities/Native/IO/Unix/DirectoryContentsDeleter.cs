@@ -0,0 +1,378 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Generic;
+using System.Threading;
+using System.Threading.Tasks;
+using BuildXL.Interop.Linux;
+using Microsoft.Win32.SafeHandles;
+
+namespace BuildXL.Native.IO.Unix
+{
+    /// <summary>
+    /// Deletes the contents of a directory tree through directory file descriptors, for <see cref="FileUtilitiesUnix.DeleteDirectoryContents"/>.
+    /// </summary>
+    /// <remarks>
+    /// Every directory is opened with O_DIRECTORY | O_NOFOLLOW relative to its parent and read with getdents64 (<see cref="DirectoryEnumerator"/>).
+    /// Its entries are removed with unlinkat relative to it, and the directory itself with unlinkat(AT_REMOVEDIR) relative to its parent once
+    /// its contents are gone, so no path is resolved by the kernel along the way and paths are only built for the shouldDelete predicate.
+    ///
+    /// Subdirectories go on a stack shared by the calling thread and up to <see cref="MaxWorkerCount"/> dedicated threads, started once
+    /// the root has a subdirectory. Nothing runs on the thread pool, so waiting for the workers can't starve it. A directory is removed
+    /// by whichever thread finishes its last subdirectory, and its parent keeps its descriptor open until then.
+    /// The shouldDelete predicate is called concurrently from all these threads.
+    ///
+    /// Whenever a descriptor-relative operation fails with anything else than the entry being gone already, the entry is handed to the
+    /// path-based code of <see cref="FileUtilitiesUnix"/>, which retries (unless best effort) and throws when it gives up.
+    /// As with the path-based code, an exception while deleting the contents of a directory (such a failure, or the cancellation)
+    /// stops the deletion of that directory only: the rest of its entries are left in place and are not counted as remaining.
+    /// Subdirectories already being deleted on other threads when that happens are still deleted.
+    /// </remarks>
+    internal sealed class DirectoryContentsDeleter
+    {
+        /// <summary>
+        /// Number of threads deleting subtrees besides the calling one. Deleting mostly waits on the file system, so a few help even on few cores.
+        /// </summary>
+        internal static readonly int MaxWorkerCount = Math.Clamp(Environment.ProcessorCount, 4, 8) - 1;
+
+        // Linux errno values
+        private const int ENOENT = 2;
+        private const int ENOTDIR = 20;
+        private const int ELOOP = 40;
+
+        private readonly FileUtilitiesUnix m_fileUtilities;
+        private readonly Func<string, bool, bool> m_shouldDelete;
+        private readonly ITempCleaner m_tempDirectoryCleaner;
+        private readonly bool m_bestEffort;
+        private readonly CancellationToken m_cancellationToken;
+
+        // Subdirectories waiting to be deleted, and whether the root is complete; both guarded by the stack
+        private readonly Stack<PendingDirectory> m_pending = new Stack<PendingDirectory>();
+        private bool m_done;
+
+        private Task[] m_workers;
+
+        private DirectoryContentsDeleter(
+            FileUtilitiesUnix fileUtilities,
+            Func<string, bool, bool> shouldDelete,
+            ITempCleaner tempDirectoryCleaner,
+            bool bestEffort,
+            CancellationToken cancellationToken)
+        {
+            m_fileUtilities = fileUtilities;
+            m_shouldDelete = shouldDelete ?? ((path, isDirectory) => true);
+            m_tempDirectoryCleaner = tempDirectoryCleaner;
+            m_bestEffort = bestEffort;
+            m_cancellationToken = cancellationToken;
+        }
+
+        /// <summary>
+        /// Deletes the contents of <paramref name="directory"/> (open on <paramref name="directoryPath"/>), and disposes it.
+        /// Returns the number of entries of the directory that are left: entries not to be deleted, and subdirectories with entries left.
+        /// </summary>
+        internal static int DeleteContents(
+            FileUtilitiesUnix fileUtilities,
+            SafeFileHandle directory,
+            string directoryPath,
+            Func<string, bool, bool> shouldDelete,
+            ITempCleaner tempDirectoryCleaner,
+            bool bestEffort,
+            CancellationToken cancellationToken)
+        {
+            using (directory)
+            {
+                var root = new PendingDirectory { Handle = directory, Path = directoryPath };
+                new DirectoryContentsDeleter(fileUtilities, shouldDelete, tempDirectoryCleaner, bestEffort, cancellationToken).Run(root);
+                return root.RemainingChildCount;
+            }
+        }
+
+        private void Run(PendingDirectory root)
+        {
+            var buffer = new byte[DirectoryEnumerator.DefaultBufferSize];
+            DeleteContents(root, buffer);
+            Work(buffer);
+
+            if (m_workers != null)
+            {
+                Task.WaitAll(m_workers);
+            }
+        }
+
+        /// <summary>
+        /// Deletes subdirectories from the shared stack until the root is complete.
+        /// </summary>
+        private void Work(byte[] buffer)
+        {
+            while (true)
+            {
+                PendingDirectory next;
+                lock (m_pending)
+                {
+                    while (m_pending.Count == 0 && !m_done)
+                    {
+                        Monitor.Wait(m_pending);
+                    }
+
+                    if (m_done)
+                    {
+                        return;
+                    }
+
+                    next = m_pending.Pop();
+                }
+
+                DeleteSubdirectory(next, buffer);
+            }
+        }
+
+        private void Push(List<PendingDirectory> subdirectories)
+        {
+            lock (m_pending)
+            {
+                foreach (var subdirectory in subdirectories)
+                {
+                    m_pending.Push(subdirectory);
+                }
+
+                if (m_workers == null)
+                {
+                    m_workers = new Task[MaxWorkerCount];
+                    for (int i = 0; i < m_workers.Length; i++)
+                    {
+                        m_workers[i] = Task.Factory.StartNew(() => Work(new byte[DirectoryEnumerator.DefaultBufferSize]), TaskCreationOptions.LongRunning);
+                    }
+                }
+
+                Monitor.PulseAll(m_pending);
+            }
+        }
+
+        /// <summary>
+        /// Enumerates <paramref name="directory"/>, deleting its files and pushing its subdirectories, then completes its enumeration.
+        /// </summary>
+        private void DeleteContents(PendingDirectory directory, byte[] buffer)
+        {
+            List<PendingDirectory> subdirectories = null;
+            int remainingChildCount = 0;
+
+            try
+            {
+                int error = DirectoryEnumerator.Enumerate(directory.Handle, buffer, (name, type) =>
+                {
+                    m_cancellationToken.ThrowIfCancellationRequested();
+
+                    string childPath = GetChildPath(directory.Path, name);
+                    if (type == DirectoryEnumerator.EntryType.Directory)
+                    {
+                        (subdirectories ??= new List<PendingDirectory>()).Add(new PendingDirectory
+                        {
+                            Parent = directory,
+                            Name = name.ToArray(),
+                            Path = childPath,
+                            Delete = m_shouldDelete(childPath, true),
+                        });
+                    }
+                    else if (m_shouldDelete(childPath, type == DirectoryEnumerator.EntryType.Symlink))
+                    {
+                        DeleteFile(directory.Handle, name, childPath);
+                    }
+                    else
+                    {
+                        remainingChildCount++;
+                    }
+
+                    return true;
+                });
+
+                if (error != 0)
+                {
+                    // Start over by path: entries deleted so far are simply not found again, and those left are counted again.
+                    subdirectories = null;
+                    remainingChildCount = m_fileUtilities.DeleteDirectoryContentsByPath(
+                        directory.Path,
+                        deleteRootDirectory: false,
+                        m_shouldDelete,
+                        m_tempDirectoryCleaner,
+                        m_bestEffort,
+                        m_cancellationToken);
+                }
+            }
+            catch (Exception)
+            {
+                // The path-based code enumerates through FileSystemUnix, which turns any exception into a failed enumeration result that is ignored
+                subdirectories = null;
+            }
+
+            // Set before any subdirectory can complete and count itself
+            directory.RemainingChildCount = remainingChildCount;
+            if (subdirectories != null)
+            {
+                Interlocked.Add(ref directory.PendingCount, subdirectories.Count);
+                Push(subdirectories);
+            }
+
+            Complete(directory);
+        }
+
+        /// <summary>
+        /// Opens a subdirectory popped from the stack and deletes its contents, unless its parent was stopped meanwhile.
+        /// </summary>
+        private void DeleteSubdirectory(PendingDirectory directory, byte[] buffer)
+        {
+            var parent = directory.Parent;
+            bool opened = false;
+            if (!parent.Stopped)
+            {
+                try
+                {
+                    m_cancellationToken.ThrowIfCancellationRequested();
+                    opened = TryOpen(directory);
+                }
+                catch (Exception)
+                {
+                    parent.Stopped = true;
+                }
+            }
+
+            if (opened)
+            {
+                DeleteContents(directory, buffer);
+            }
+            else
+            {
+                Complete(parent);
+            }
+        }
+
+        /// <summary>
+        /// Opens <paramref name="directory"/> relative to its parent. When it can't be, deals with it as a whole, counting it in its parent if it is left.
+        /// </summary>
+        private bool TryOpen(PendingDirectory directory)
+        {
+            var parent = directory.Parent;
+            int error = DirectoryEnumerator.OpenDirectoryAt(parent.Handle, directory.Name, followSymlink: false, out directory.Handle);
+            if (error == 0)
+            {
+                return true;
+            }
+
+            if (error == ENOTDIR || error == ELOOP)
+            {
+                // Replaced by a file or a symlink since it was enumerated
+                if (!directory.Delete)
+                {
+                    Interlocked.Increment(ref parent.RemainingChildCount);
+                }
+                else
+                {
+                    DeleteFile(parent.Handle, directory.Name, directory.Path);
+                }
+            }
+            else if (error != ENOENT)
+            {
+                // E.g., no permission to read it, or out of file descriptors
+                if (m_fileUtilities.DeleteDirectoryContentsByPath(directory.Path, directory.Delete, m_shouldDelete, m_tempDirectoryCleaner, m_bestEffort, m_cancellationToken) > 0)
+                {
+                    Interlocked.Increment(ref parent.RemainingChildCount);
+                }
+            }
+
+            return false;
+        }
+
+        /// <summary>
+        /// Completes the enumeration or a subdirectory of <paramref name="directory"/>. The last one to complete closes the directory, removes it
+        /// if it is to be deleted and nothing is left in it, and in turn completes its parent. Completing the root ends the deletion.
+        /// </summary>
+        /// <remarks>
+        /// A subdirectory with entries left counts as remaining in its parent, while one kept by shouldDelete does not when it is empty,
+        /// and is removed along with its parent.
+        /// </remarks>
+        private void Complete(PendingDirectory directory)
+        {
+            while (Interlocked.Decrement(ref directory.PendingCount) == 0)
+            {
+                var parent = directory.Parent;
+                if (parent == null)
+                {
+                    lock (m_pending)
+                    {
+                        m_done = true;
+                        Monitor.PulseAll(m_pending);
+                    }
+
+                    return;
+                }
+
+                directory.Handle.Dispose();
+
+                try
+                {
+                    if (directory.RemainingChildCount > 0)
+                    {
+                        Interlocked.Increment(ref parent.RemainingChildCount);
+                    }
+                    else if (directory.Delete)
+                    {
+                        RemoveDirectory(parent.Handle, directory.Name, directory.Path);
+                    }
+                }
+                catch (Exception)
+                {
+                    parent.Stopped = true;
+                }
+
+                directory = parent;
+            }
+        }
+
+        private void DeleteFile(SafeFileHandle directory, ReadOnlySpan<byte> name, string path)
+        {
+            int error = DirectoryEnumerator.RemoveEntryAt(directory, name, isDirectory: false);
+            if (error == 0 || error == ENOENT)
+            {
+                return;
+            }
+
+            // DeleteFile has the retry logic, and throws when it fails
+            m_fileUtilities.DeleteFile(path, retryOnFailure: !m_bestEffort, tempDirectoryCleaner: m_tempDirectoryCleaner);
+        }
+
+        private void RemoveDirectory(SafeFileHandle parent, byte[] name, string path)
+        {
+            int error = DirectoryEnumerator.RemoveEntryAt(parent, name, isDirectory: true);
+            if (error == 0 || error == ENOENT)
+            {
+                return;
+            }
+
+            // E.g., an empty subdirectory kept by shouldDelete, or entries added since the directory was enumerated.
+            // This removes them as the recursive delete of the path-based code does, and throws when it gives up.
+            m_fileUtilities.DeleteDirectoryWithRetries(path, m_bestEffort);
+        }
+
+        private static string GetChildPath(string directoryPath, ReadOnlySpan<byte> name) => directoryPath + "/" + DirectoryEnumerator.GetName(name);
+
+        /// <summary>
+        /// A directory whose contents are being deleted, or a subdirectory waiting on the stack for a thread to open it.
+        /// </summary>
+        private sealed class PendingDirectory
+        {
+            internal PendingDirectory Parent;
+            internal byte[] Name;
+            internal string Path;
+            internal bool Delete;
+            internal SafeFileHandle Handle;
+
+            // The enumeration of the directory, and each of its subdirectories not complete yet: the directory is complete when this drops to 0
+            internal int PendingCount = 1;
+
+            internal int RemainingChildCount;
+
+            // Set by an exception: subdirectories not opened yet are left in place and are not counted
+            internal volatile bool Stopped;
+        }
+    }
+}
@@ -15,6 +15,7 @@ using System.Runtime.InteropServices;
 using System.Security;
 using System.Text;
 using System.Text.RegularExpressions;
+using BuildXL.Interop.Linux;
 using BuildXL.Interop.Unix;
 using BuildXL.Native.IO.Windows;
 using BuildXL.Utilities.Core;
@@ -53,6 +54,10 @@ namespace BuildXL.Native.IO.Unix
 
         private readonly ConcurrentDictionary<string, Regex> m_patternRegexes;
 
+        private readonly ConcurrentDictionary<string, GlobMatcher> m_patternMatchers = new ConcurrentDictionary<string, GlobMatcher>();
+
+        private static readonly byte[] s_dsStoreMetaFileNameBytes = Encoding.ASCII.GetBytes(DsStoreMetaFileName);
+
         /// <summary>
         /// Creates an instance of <see cref="FileSystemUnix"/>.
         /// </summary>
@@ -256,20 +261,18 @@ namespace BuildXL.Native.IO.Unix
         public EnumerateDirectoryResult EnumerateDirectoryEntries(string directoryPath, Action<string, FileAttributes> handleEntry, bool isEnumerationForDirectoryDeletion = false) =>
             EnumerateDirectoryEntries(directoryPath, false, (currentDirectory, fileName, fileAttributes) => handleEntry(fileName, fileAttributes), isEnumerationForDirectoryDeletion);
 
-        private static Regex TranslatePattern(string pattern)
-        {
-            string regexStr = Regex
-                .Escape(pattern)
-                .Replace("\\?", ".")
-                .Replace("\\*", ".*");
-            return new Regex($"^{regexStr}$", RegexOptions.IgnoreCase | RegexOptions.Compiled);
-        }
+        private static Regex TranslatePattern(string pattern) => GlobMatcher.ToRegex(pattern);
 
         private Regex GetRegex(string pattern)
         {
             return m_patternRegexes.GetOrAdd(pattern, TranslatePattern);
         }
 
+        private GlobMatcher GetGlobMatcher(string pattern)
+        {
+            return m_patternMatchers.GetOrAdd(pattern, p => new GlobMatcher(p));
+        }
+
         /// <inheritdoc />
         public EnumerateDirectoryResult EnumerateDirectoryEntries(
             string directoryPath,
@@ -279,6 +282,62 @@ namespace BuildXL.Native.IO.Unix
             bool recursive,
             IDirectoryEntriesAccumulator accumulators,
             bool isEnumerationForDirectoryDeletion)
+        {
+            if (!OperatingSystemHelper.IsLinuxOS)
+            {
+                return EnumerateDirectoryEntriesByPath(
+                    directoryPath,
+                    enumerateDirectory,
+                    pattern,
+                    directoriesToSkipRecursively,
+                    recursive,
+                    accumulators,
+                    isEnumerationForDirectoryDeletion);
+            }
+
+            try
+            {
+                int error = DirectoryEnumerator.OpenDirectory(directoryPath, out var directory);
+                if (error != 0)
+                {
+                    accumulators.Current.Succeeded = false;
+                    return CreateEnumerateDirectoryResultFromErrno(directoryPath, error);
+                }
+
+                using (directory)
+                {
+                    return EnumerateDirectoryEntriesAt(
+                        directory,
+                        directoryPath,
+                        enumerateDirectory,
+                        GetGlobMatcher(pattern),
+                        directoriesToSkipRecursively,
+                        recursive,
+                        accumulators,
+                        isEnumerationForDirectoryDeletion,
+                        new byte[DirectoryEnumerator.DefaultBufferSize]);
+                }
+            }
+            catch (Exception ex)
+            {
+                var result = EnumerateDirectoryResult.CreateFromException(directoryPath, ex);
+                accumulators.Current.Succeeded = false;
+                return result;
+            }
+        }
+
+        /// <summary>
+        /// Enumerates through full paths with <see cref="Directory.GetFileSystemEntries(string)"/>, on the platforms where
+        /// <see cref="DirectoryEnumerator"/> is not available.
+        /// </summary>
+        internal EnumerateDirectoryResult EnumerateDirectoryEntriesByPath(
+            string directoryPath,
+            bool enumerateDirectory,
+            string pattern,
+            uint directoriesToSkipRecursively,
+            bool recursive,
+            IDirectoryEntriesAccumulator accumulators,
+            bool isEnumerationForDirectoryDeletion)
         {
             try
             {
@@ -317,7 +376,7 @@ namespace BuildXL.Native.IO.Unix
                     {
                         accumulators.AddNew(accumulator, filename);
 
-                        var recurs = EnumerateDirectoryEntries(
+                        var recurs = EnumerateDirectoryEntriesByPath(
                             entry,
                             enumerateDirectory,
                             pattern,
@@ -346,6 +405,173 @@ namespace BuildXL.Native.IO.Unix
                 (int)NativeIOConstants.ErrorNoMoreFiles);
         }
 
+        /// <summary>
+        /// An entry read by <see cref="EnumerateDirectoryEntriesAt"/>, kept until the whole directory is read so that entries are reported in order.
+        /// </summary>
+        private readonly struct DirectoryEntry
+        {
+            public readonly string Name;
+            public readonly DirectoryEnumerator.EntryType Type;
+            public readonly FileAttributes Attributes;
+            public readonly bool MatchesPattern;
+
+            public DirectoryEntry(string name, DirectoryEnumerator.EntryType type, FileAttributes attributes, bool matchesPattern)
+            {
+                Name = name;
+                Type = type;
+                Attributes = attributes;
+                MatchesPattern = matchesPattern;
+            }
+        }
+
+        /// <summary>
+        /// Enumerates the open <paramref name="directory"/> with getdents64 and recurses into its subdirectories relative to it.
+        /// </summary>
+        /// <remarks>
+        /// The attributes <see cref="File.GetAttributes(string)"/> reports come from the type getdents64 returns with each entry, except for Directory on a
+        /// symlink to a directory, and ReadOnly. So only symlinks are stat'ed, unless the accumulators track ReadOnly
+        /// (<see cref="IDirectoryEntriesAccumulator.TracksReadOnly"/>), in which case every entry is. Lookups are relative to <paramref name="directory"/>
+        /// rather than through full paths. Entries are reported sorted by name, as before.
+        /// <paramref name="buffer"/> is shared by the whole recursion: a directory is read completely before any of its subdirectories.
+        /// </remarks>
+        private EnumerateDirectoryResult EnumerateDirectoryEntriesAt(
+            SafeFileHandle directory,
+            string directoryPath,
+            bool enumerateDirectory,
+            GlobMatcher matcher,
+            uint directoriesToSkipRecursively,
+            bool recursive,
+            IDirectoryEntriesAccumulator accumulators,
+            bool isEnumerationForDirectoryDeletion,
+            byte[] buffer)
+        {
+            var accumulator = accumulators.Current;
+            var entries = new List<DirectoryEntry>();
+            bool tracksReadOnly = accumulators.TracksReadOnly;
+
+            int error = DirectoryEnumerator.Enumerate(directory, buffer, (name, type) =>
+            {
+                if (!isEnumerationForDirectoryDeletion && name.SequenceEqual(s_dsStoreMetaFileNameBytes))
+                {
+                    return true;
+                }
+
+                // A symlink needs the type of its target. ReadOnly needs the mode of every entry, and tells the type of the target as well.
+                var targetType = type;
+                bool isReadOnly = false;
+                if (tracksReadOnly)
+                {
+                    DirectoryEnumerator.TryGetEntryInfo(directory, name, out targetType, out isReadOnly);
+                }
+                else if (type == DirectoryEnumerator.EntryType.Symlink)
+                {
+                    targetType = DirectoryEnumerator.GetEntryType(directory, name, followSymlink: true);
+                }
+
+                bool isDirectory = type == DirectoryEnumerator.EntryType.Directory
+                    || (type == DirectoryEnumerator.EntryType.Symlink && targetType == DirectoryEnumerator.EntryType.Directory);
+
+                var attributes = (FileAttributes)0;
+                if (isDirectory)
+                {
+                    attributes |= FileAttributes.Directory;
+                }
+
+                if (isReadOnly)
+                {
+                    attributes |= FileAttributes.ReadOnly;
+                }
+
+                if (type == DirectoryEnumerator.EntryType.Symlink)
+                {
+                    attributes |= FileAttributes.ReparsePoint;
+                }
+
+                if (name[0] == '.')
+                {
+                    attributes |= FileAttributes.Hidden;
+                }
+
+                entries.Add(new DirectoryEntry(DirectoryEnumerator.GetName(name), type, attributes == 0 ? FileAttributes.Normal : attributes, matcher.IsMatch(name)));
+                return true;
+            });
+
+            if (error != 0)
+            {
+                accumulator.Succeeded = false;
+                return CreateEnumerateDirectoryResultFromErrno(directoryPath, error);
+            }
+
+            entries.Sort((left, right) => StringComparer.InvariantCulture.Compare(left.Name, right.Name));
+
+            foreach (var entry in entries)
+            {
+                var isDirectory = (entry.Attributes & FileAttributes.Directory) == FileAttributes.Directory;
+
+                if (entry.MatchesPattern && !(enumerateDirectory ^ isDirectory) && directoriesToSkipRecursively == 0)
+                {
+                    accumulator.AddFile(entry.Name);
+                }
+
+                accumulator.AddTrackFile(entry.Name, entry.Attributes);
+
+                if ((recursive || directoriesToSkipRecursively > 0) && isDirectory)
+                {
+                    accumulators.AddNew(accumulator, entry.Name);
+
+                    string subdirectoryPath = Path.Combine(directoryPath, entry.Name);
+                    error = DirectoryEnumerator.OpenDirectoryAt(
+                        directory,
+                        Encoding.UTF8.GetBytes(entry.Name),
+                        followSymlink: entry.Type == DirectoryEnumerator.EntryType.Symlink,
+                        out var subdirectory);
+                    if (error != 0)
+                    {
+                        accumulators.Current.Succeeded = false;
+                        return CreateEnumerateDirectoryResultFromErrno(subdirectoryPath, error);
+                    }
+
+                    EnumerateDirectoryResult recurs;
+                    using (subdirectory)
+                    {
+                        recurs = EnumerateDirectoryEntriesAt(
+                            subdirectory,
+                            subdirectoryPath,
+                            enumerateDirectory,
+                            matcher,
+                            directoriesToSkipRecursively == 0 ? 0 : directoriesToSkipRecursively - 1,
+                            recursive,
+                            accumulators,
+                            isEnumerationForDirectoryDeletion,
+                            buffer);
+                    }
+
+                    if (!recurs.Succeeded)
+                    {
+                        return recurs;
+                    }
+                }
+            }
+
+            return new EnumerateDirectoryResult(
+                directoryPath,
+                EnumerateDirectoryStatus.Success,
+                (int)NativeIOConstants.ErrorNoMoreFiles);
+        }
+
+        private static EnumerateDirectoryResult CreateEnumerateDirectoryResultFromErrno(string directoryPath, int errno)
+        {
+            var status = (Errno)errno switch
+            {
+                Errno.ENOENT => EnumerateDirectoryStatus.SearchDirectoryNotFound,
+                Errno.ENOTDIR => EnumerateDirectoryStatus.CannotEnumerateFile,
+                Errno.EACCES or Errno.EPERM => EnumerateDirectoryStatus.AccessDenied,
+                _ => EnumerateDirectoryStatus.UnknownError,
+            };
+
+            return new EnumerateDirectoryResult(directoryPath, status, errno);
+        }
+
         /// <inheritdoc />
         public string GetFinalPathNameByHandle(SafeFileHandle handle, bool volumeGuidPath = false) => throw new NotImplementedException();
 
@@ -385,20 +611,35 @@ namespace BuildXL.Native.IO.Unix
         /// <inheritdoc />
         public unsafe FileSystemType GetVolumeFileSystemByHandle(SafeFileHandle fileHandle)
         {
-            var buffer = new StringBuilder(32);
-            int result = GetFileSystemType(fileHandle, buffer, buffer.Capacity);
-            if (result != 0)
+            string fsTypeName;
+            if (OperatingSystemHelper.IsLinuxOS)
             {
-                throw ThrowForNativeFailure(Marshal.GetLastWin32Error(), nameof(GetFileSystemType), managedApiName: nameof(GetVolumeFileSystemByHandle));
+                // Straight from the cached mount table, which avoids building a string for every query
+                fsTypeName = Interop.Linux.MountTable.Instance.GetFileSystemType(fileHandle);
+                if (fsTypeName == null)
+                {
+                    throw ThrowForNativeFailure(Marshal.GetLastWin32Error(), nameof(GetFileSystemType), managedApiName: nameof(GetVolumeFileSystemByHandle));
+                }
+            }
+            else
+            {
+                var buffer = new StringBuilder(32);
+                int result = GetFileSystemType(fileHandle, buffer, buffer.Capacity);
+                if (result != 0)
+                {
+                    throw ThrowForNativeFailure(Marshal.GetLastWin32Error(), nameof(GetFileSystemType), managedApiName: nameof(GetVolumeFileSystemByHandle));
+                }
+
+                fsTypeName = buffer.ToString();
             }
 
-            return buffer.ToString().ToUpperInvariant() switch
+            return fsTypeName switch
             {
-                "APFS" => FileSystemType.APFS,
-                "HFS"  => FileSystemType.HFS,
-                "EXT3" => FileSystemType.EXT3,
-                "EXT4" => FileSystemType.EXT4,
-                     _ => FileSystemType.Unknown
+                _ when string.Equals(fsTypeName, "APFS", StringComparison.OrdinalIgnoreCase) => FileSystemType.APFS,
+                _ when string.Equals(fsTypeName, "HFS",  StringComparison.OrdinalIgnoreCase) => FileSystemType.HFS,
+                _ when string.Equals(fsTypeName, "EXT3", StringComparison.OrdinalIgnoreCase) => FileSystemType.EXT3,
+                _ when string.Equals(fsTypeName, "EXT4", StringComparison.OrdinalIgnoreCase) => FileSystemType.EXT4,
+                _                                                                             => FileSystemType.Unknown
             };
         }
 
@@ -2,6 +2,7 @@
 // Licensed under the MIT License.
 
 using System;
+using System.Collections.Concurrent;
 using System.Collections.Generic;
 using System.Diagnostics.ContractsLight;
 using System.IO;
@@ -10,6 +11,7 @@ using System.Security.AccessControl;
 using System.Text;
 using System.Threading;
 using System.Threading.Tasks;
+using BuildXL.Interop.Linux;
 using BuildXL.Utilities.Core;
 using BuildXL.Utilities.Core.Tasks;
 using Microsoft.Win32.SafeHandles;
@@ -44,6 +46,34 @@ namespace BuildXL.Native.IO.Unix
         /// </summary>
         private bool m_sendFileSupported = true;
 
+        // Linux errno values that differ from the macOS ones of Errno
+        private const int LinuxENOSYS = 38;
+        private const int LinuxEOPNOTSUPP = 95;
+
+        /// <summary>
+        /// The most bytes copy_file_range and sendfile transfer in one call (MAX_RW_COUNT).
+        /// </summary>
+        private const long MaxKernelCopyLength = 0x7ffff000;
+
+        /// <summary>
+        /// The ways <see cref="TryCopyInKernel"/> copies file contents, in the order they are tried.
+        /// </summary>
+        [Flags]
+        private enum KernelCopyStrategies
+        {
+            None = 0,
+            Clone = 1,
+            CopyFileRange = 2,
+            SendFile = 4,
+        }
+
+        /// <summary>
+        /// The strategies found to be unsupported between two mounts, keyed by the devices of the source and the destination,
+        /// so that each copy only tries what can work.
+        /// </summary>
+        private readonly ConcurrentDictionary<(int sourceDevice, int destinationDevice), KernelCopyStrategies> m_unsupportedCopyStrategies =
+            new ConcurrentDictionary<(int, int), KernelCopyStrategies>();
+
         /// <inheritdoc />
         public PosixDeleteMode PosixDeleteMode { get; set; }
 
@@ -74,7 +104,55 @@ namespace BuildXL.Native.IO.Unix
             DeleteDirectoryContentsInternal(path, deleteRootDirectory, shouldDelete, tempDirectoryCleaner, bestEffort, cancellationToken);
         }
 
-        private int DeleteDirectoryContentsInternal(
+        /// <summary>
+        /// <see cref="DeleteDirectoryContents"/>, returning the number of entries of <paramref name="path"/> that are left.
+        /// </summary>
+        internal int DeleteDirectoryContentsInternal(
+            string path,
+            bool deleteRootDirectory,
+            Func<string, bool, bool> shouldDelete,
+            ITempCleaner tempDirectoryCleaner,
+            bool bestEffort,
+            CancellationToken? cancellationToken)
+        {
+            if (!OperatingSystemHelper.IsLinuxOS)
+            {
+                return DeleteDirectoryContentsByPath(path, deleteRootDirectory, shouldDelete, tempDirectoryCleaner, bestEffort, cancellationToken);
+            }
+
+            int error = DirectoryEnumerator.OpenDirectory(path, out var directory);
+            if (error == (int)Errno.ENOENT || error == (int)Errno.ENOTDIR)
+            {
+                return 0;
+            }
+
+            if (error != 0)
+            {
+                return DeleteDirectoryContentsByPath(path, deleteRootDirectory, shouldDelete, tempDirectoryCleaner, bestEffort, cancellationToken);
+            }
+
+            int remainingChildCount = DirectoryContentsDeleter.DeleteContents(
+                this,
+                directory,
+                path,
+                shouldDelete,
+                tempDirectoryCleaner,
+                bestEffort,
+                cancellationToken ?? CancellationToken.None);
+
+            if (deleteRootDirectory && remainingChildCount == 0)
+            {
+                DeleteDirectoryWithRetries(path, bestEffort);
+            }
+
+            return remainingChildCount;
+        }
+
+        /// <summary>
+        /// Deletes the contents of a directory one path at a time: the implementation off Linux, and the fallback of <see cref="DirectoryContentsDeleter"/>
+        /// for directories it can't open or read.
+        /// </summary>
+        internal int DeleteDirectoryContentsByPath(
             string path,
             bool deleteRootDirectory,
             Func<string, bool, bool> shouldDelete,
@@ -102,7 +180,7 @@ namespace BuildXL.Native.IO.Unix
 
                     if (isDirectory)
                     {
-                        int subDirectoryCount = DeleteDirectoryContentsInternal(
+                        int subDirectoryCount = DeleteDirectoryContentsByPath(
                             childPath,
                             deleteRootDirectory: shouldDelete(childPath, isDirectory),
                             shouldDelete: shouldDelete,
@@ -131,26 +209,34 @@ namespace BuildXL.Native.IO.Unix
 
             if (deleteRootDirectory && remainingChildCount == 0)
             {
-                bool success = Helpers.RetryOnFailure(
-                    finalRound =>
-                    {
-                        // An exception will be thrown on failure, which will trigger a retry, this deletes the path itself
-                        // and any file or dir still in recursively through the 'true' flag
-                        Directory.Delete(path, true);
+                DeleteDirectoryWithRetries(path, bestEffort);
+            }
 
-                        // Only reached if there are no exceptions
-                        return true;
-                    },
-                    numberOfAttempts: bestEffort ? 1 : Helpers.DefaultNumberOfAttempts);
+            return remainingChildCount;
+        }
 
-                if (!success && Directory.Exists(path))
+        /// <summary>
+        /// Deletes <paramref name="path"/> and anything still in it, retrying unless <paramref name="bestEffort"/>.
+        /// </summary>
+        internal void DeleteDirectoryWithRetries(string path, bool bestEffort)
+        {
+            bool success = Helpers.RetryOnFailure(
+                finalRound =>
                 {
-                    var code = (int)Tracing.LogEventId.RetryOnFailureException;
-                    throw new BuildXLException($"Failed to delete directory: {path}.  Search for DX{code:0000} log messages to see why.");
-                }
-            }
+                    // An exception will be thrown on failure, which will trigger a retry, this deletes the path itself
+                    // and any file or dir still in recursively through the 'true' flag
+                    Directory.Delete(path, true);
 
-            return remainingChildCount;
+                    // Only reached if there are no exceptions
+                    return true;
+                },
+                numberOfAttempts: bestEffort ? 1 : Helpers.DefaultNumberOfAttempts);
+
+            if (!success && Directory.Exists(path))
+            {
+                var code = (int)Tracing.LogEventId.RetryOnFailureException;
+                throw new BuildXLException($"Failed to delete directory: {path}.  Search for DX{code:0000} log messages to see why.");
+            }
         }
 
         /// <inheritdoc />
@@ -442,7 +528,19 @@ namespace BuildXL.Native.IO.Unix
 
                         using (var destinationStream = CreateReplacementFile(destination, FileShare.Delete, openAsync: true))
                         {
-                            await sourceStream.CopyToAsync(destinationStream);
+                            var (copiedInKernel, bytesCopied) = await Task.Run(() =>
+                            {
+                                bool completed = TryCopyInKernel(sourceStream.SafeFileHandle, destinationStream.SafeFileHandle, out long copied);
+                                return (completed, copied);
+                            });
+
+                            if (!copiedInKernel)
+                            {
+                                sourceStream.Position = bytesCopied;
+                                destinationStream.Position = bytesCopied;
+                                await sourceStream.CopyToAsync(destinationStream, (int)s_copyBufferSizeMax);
+                            }
+
                             var mode = GetFilePermissionsForFilePath(source, followSymlink: false);
                             var result = SetFilePermissionsForFilePath(destination, checked((FilePermissions)mode), followSymlink: false);
                             if (result < 0)
@@ -493,6 +591,11 @@ namespace BuildXL.Native.IO.Unix
         /// <inheritdoc />
         public Possible<Unit> CloneFile(string source, string destination, bool followSymlink)
         {
+            if (!OperatingSystemHelper.IsMacOS)
+            {
+                return CloneFileLinux(source, destination, followSymlink);
+            }
+
             var flags = followSymlink ? CloneFileFlags.CLONE_NONE : CloneFileFlags.CLONE_NOFOLLOW;
             int result = Interop.Unix.IO.CloneFile(source, destination, flags);
             if (result != 0)
@@ -503,6 +606,51 @@ namespace BuildXL.Native.IO.Unix
             return Unit.Void;
         }
 
+        private Possible<Unit> CloneFileLinux(string source, string destination, bool followSymlink)
+        {
+            OpenFileResult openResult = m_fileSystem.TryCreateOrOpenFile(
+                source,
+                FileDesiredAccess.GenericRead,
+                FileShare.Read | FileShare.Delete,
+                FileMode.Open,
+                followSymlink ? FileFlagsAndAttributes.None : FileFlagsAndAttributes.FileFlagOpenReparsePoint,
+                out SafeFileHandle sourceHandle);
+
+            if (!openResult.Succeeded)
+            {
+                return new NativeFailure(openResult.NativeErrorCode, I($"Failed to open source file '{source}' in {nameof(CloneFile)}"));
+            }
+
+            using (sourceHandle)
+            {
+                openResult = m_fileSystem.TryCreateOrOpenFile(
+                    destination,
+                    FileDesiredAccess.GenericWrite,
+                    FileShare.Read | FileShare.Delete,
+                    FileMode.CreateNew,
+                    FileFlagsAndAttributes.None,
+                    out SafeFileHandle destinationHandle);
+
+                if (!openResult.Succeeded)
+                {
+                    return new NativeFailure(openResult.NativeErrorCode, I($"Failed to create destination file '{destination}' in {nameof(CloneFile)}"));
+                }
+
+                using (destinationHandle)
+                {
+                    if (CloneFileContents(sourceHandle, destinationHandle) != 0)
+                    {
+                        int error = Marshal.GetLastWin32Error();
+                        destinationHandle.Close();
+                        DeleteFile(destination, retryOnFailure: false);
+                        return new NativeFailure(error, I($"Failed to clone '{source}' to '{destination}'"));
+                    }
+
+                    return Unit.Void;
+                }
+            }
+        }
+
         /// <inheritdoc />
         public Possible<Unit> InKernelFileCopy(string source, string destination, bool followSymlink)
         {
@@ -542,63 +690,182 @@ namespace BuildXL.Native.IO.Unix
 
                 using (destinationHandle)
                 {
-                    var statBuffer = new StatBuffer();
-                    if (StatFileDescriptor(sourceHandle, ref statBuffer) != 0)
-                    {
-                        destinationHandle.Close();
-                        DeleteFile(destination, false);
-                        return new NativeFailure(Marshal.GetLastWin32Error(), I($"Failed to stat source file '{source}' for size query in {nameof(InKernelFileCopy)}"));
-                    }
-
-                    var length = statBuffer.Size;
-                    long bytesCopied = 0;
-                    int lastError = 0;
-
-                    do
+                    int error = 0;
+                    try
                     {
-                        bytesCopied = CopyBytes(sourceHandle, destinationHandle);
-                        if (bytesCopied == -1)
+                        if (!TryCopyInKernel(sourceHandle, destinationHandle, out long bytesCopied))
                         {
-                            destinationHandle.Close();
-                            DeleteFile(destination, false);
-                            return new NativeFailure(Marshal.GetLastWin32Error(), I($"{nameof(InKernelFileCopy)} failed  copying '{source}' to '{destination}' with error code: {lastError}"));
+                            // E.g., a procfs or sysfs file, whose size says nothing about its contents
+                            CopyRemainingContents(sourceHandle, destinationHandle, bytesCopied);
                         }
+                    }
+                    catch (NativeWin32Exception ex)
+                    {
+                        error = ex.NativeErrorCode;
+                    }
+                    catch (IOException ex)
+                    {
+                        error = ex.HResult;
+                    }
 
-                        length -= bytesCopied;
-                    } while (length > 0 && bytesCopied > 0);
+                    if (error != 0)
+                    {
+                        destinationHandle.Close();
+                        DeleteFile(destination, false);
+                        return new NativeFailure(error, I($"{nameof(InKernelFileCopy)} failed copying '{source}' to '{destination}' with error code: {error}"));
+                    }
 
                     return Unit.Void;
                 }
             }
         }
 
-        private long CopyBytes(SafeFileHandle sourceHandle, SafeFileHandle destinationHandle)
+        /// <summary>
+        /// Copies the contents of <paramref name="source"/> into the empty <paramref name="destination"/> without going through user space:
+        /// by sharing extents (FICLONE), else with copy_file_range, else with sendfile. Both files must be at offset 0.
+        /// </summary>
+        /// <remarks>
+        /// A strategy that fails as unsupported by the mounts (e.g., EOPNOTSUPP from a file system that can't share extents, or EXDEV across mounts
+        /// on kernels that don't copy across file systems) is not tried again between the same two devices. A strategy that fails for this file only
+        /// (EINVAL or EPERM, e.g. for an append-only file, or a short copy) falls through to the next one, and is still tried for the next file.
+        /// Returns false when the contents could not be fully copied in the kernel, in which case the first <paramref name="bytesCopied"/> bytes were
+        /// copied and both files are at that offset. Files whose size is 0 are not copied in the kernel at all: procfs and sysfs report 0 for files
+        /// that have contents, and copy_file_range reads nothing from them. Throws <see cref="NativeWin32Exception"/> for any other failure.
+        /// </remarks>
+        private bool TryCopyInKernel(SafeFileHandle source, SafeFileHandle destination, out long bytesCopied)
         {
-            if (m_copyFileRangeSupported)
+            bytesCopied = 0;
+
+            if (OperatingSystemHelper.IsMacOS)
+            {
+                return false;
+            }
+
+            var sourceStat = new StatBuffer();
+            var destinationStat = new StatBuffer();
+            if (StatFileDescriptor(source, ref sourceStat) != 0 || StatFileDescriptor(destination, ref destinationStat) != 0)
+            {
+                throw new NativeWin32Exception(Marshal.GetLastWin32Error(), "Failed to stat the files of a copy");
+            }
+
+            if (sourceStat.Size == 0)
+            {
+                return false;
+            }
+
+            var devices = (sourceStat.DeviceID, destinationStat.DeviceID);
+            m_unsupportedCopyStrategies.TryGetValue(devices, out var unsupported);
+
+            if ((unsupported & KernelCopyStrategies.Clone) == 0)
+            {
+                if (CloneFileContents(source, destination) == 0)
+                {
+                    bytesCopied = sourceStat.Size;
+                    return true;
+                }
+
+                unsupported = OnKernelCopyFailure(devices, unsupported, KernelCopyStrategies.Clone, "FICLONE");
+            }
+
+            if ((unsupported & KernelCopyStrategies.CopyFileRange) == 0 && m_copyFileRangeSupported)
             {
                 try
                 {
-                    return Interop.Unix.IO.CopyFileRange(sourceHandle, IntPtr.Zero, destinationHandle, IntPtr.Zero, s_copyBufferSizeMax);
+                    if (CopyUntilEndOfFile(() => CopyFileRange(source, IntPtr.Zero, destination, IntPtr.Zero, MaxKernelCopyLength), sourceStat.Size, ref bytesCopied))
+                    {
+                        return true;
+                    }
+
+                    unsupported = OnKernelCopyFailure(devices, unsupported, KernelCopyStrategies.CopyFileRange, "copy_file_range");
                 }
-                catch (System.EntryPointNotFoundException)
+                catch (EntryPointNotFoundException)
                 {
                     m_copyFileRangeSupported = false;
                 }
             }
 
-            if (m_sendFileSupported)
+            if ((unsupported & KernelCopyStrategies.SendFile) == 0 && m_sendFileSupported)
             {
                 try
                 {
-                    return Interop.Unix.IO.SendFile(sourceHandle, destinationHandle, IntPtr.Zero, s_copyBufferSizeMax);
+                    if (CopyUntilEndOfFile(() => SendFile(source, destination, IntPtr.Zero, MaxKernelCopyLength), sourceStat.Size, ref bytesCopied))
+                    {
+                        return true;
+                    }
+
+                    OnKernelCopyFailure(devices, unsupported, KernelCopyStrategies.SendFile, "sendfile");
                 }
-                catch (System.EntryPointNotFoundException)
+                catch (EntryPointNotFoundException)
                 {
                     m_sendFileSupported = false;
                 }
             }
 
-            return -1;
+            return false;
+        }
+
+        /// <summary>
+        /// Calls <paramref name="copy"/> until it reports the end of the file. Returns false when it fails, or when it reports the end of the file before
+        /// <paramref name="expectedLength"/> bytes were copied (e.g., the file was truncated concurrently).
+        /// </summary>
+        private static bool CopyUntilEndOfFile(Func<long> copy, long expectedLength, ref long bytesCopied)
+        {
+            while (true)
+            {
+                long copied = copy();
+                if (copied > 0)
+                {
+                    bytesCopied += copied;
+                }
+                else if (copied == 0)
+                {
+                    return bytesCopied >= expectedLength;
+                }
+                else if (Marshal.GetLastWin32Error() != (int)Errno.EINTR)
+                {
+                    return false;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Records <paramref name="strategy"/> as unsupported between the two devices when the last error says the mounts don't support it, and returns
+        /// the strategies not to try for the current copy. Errors that can be specific to the file, and a short copy (no error), only skip the strategy
+        /// for the current copy. Throws for any other error.
+        /// </summary>
+        private KernelCopyStrategies OnKernelCopyFailure((int, int) devices, KernelCopyStrategies unsupported, KernelCopyStrategies strategy, string syscall)
+        {
+            int error = Marshal.GetLastWin32Error();
+            switch (error)
+            {
+                case (int)Errno.EXDEV:
+                case (int)Errno.ENOTTY:
+                case LinuxENOSYS:
+                case LinuxEOPNOTSUPP:
+                    return m_unsupportedCopyStrategies.AddOrUpdate(devices, strategy, (_, recorded) => recorded | strategy) | unsupported;
+                case 0:
+                case (int)Errno.EINVAL:
+                case (int)Errno.EPERM:
+                    return unsupported | strategy;
+                default:
+                    throw new NativeWin32Exception(error, I($"{syscall} failed"));
+            }
+        }
+
+        /// <summary>
+        /// Copies the contents of <paramref name="source"/> after its first <paramref name="bytesCopied"/> bytes through user space,
+        /// for the files <see cref="TryCopyInKernel"/> leaves to its caller.
+        /// </summary>
+        private static void CopyRemainingContents(SafeFileHandle source, SafeFileHandle destination, long bytesCopied)
+        {
+            // The handles stay owned by the caller
+            using (var sourceStream = new FileStream(new SafeFileHandle(source.DangerousGetHandle(), ownsHandle: false), FileAccess.Read, bufferSize: 1))
+            using (var destinationStream = new FileStream(new SafeFileHandle(destination.DangerousGetHandle(), ownsHandle: false), FileAccess.Write, bufferSize: 1))
+            {
+                sourceStream.Position = bytesCopied;
+                destinationStream.Position = bytesCopied;
+                sourceStream.CopyTo(destinationStream, (int)s_copyBufferSizeMax);
+            }
         }
 
         /// <inheritdoc />
@@ -0,0 +1,141 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Text.RegularExpressions;
+using BuildXL.Interop.Linux;
+
+namespace BuildXL.Native.IO.Unix
+{
+    /// <summary>
+    /// Matches the raw (UTF-8) names returned by <see cref="DirectoryEnumerator"/> against a file name pattern, where '*' matches any
+    /// sequence of characters and '?' any single character, ignoring case.
+    /// </summary>
+    /// <remarks>
+    /// Names are matched byte by byte, folding ASCII letters, so that matching a name allocates nothing. Case folding beyond ASCII needs
+    /// the decoded name, so patterns with non-ASCII characters fall back to the same regular expression <see cref="FileSystemUnix"/> uses
+    /// for decoded names.
+    /// </remarks>
+    internal sealed class GlobMatcher
+    {
+        private readonly byte[] m_pattern;
+        private readonly bool m_matchesEverything;
+        private readonly Regex m_fallback;
+
+        /// <summary>
+        /// Creates a matcher for <paramref name="pattern"/>.
+        /// </summary>
+        public GlobMatcher(string pattern)
+        {
+            m_matchesEverything = pattern == "*";
+
+            m_pattern = new byte[pattern.Length];
+            for (int i = 0; i < pattern.Length; i++)
+            {
+                char c = pattern[i];
+                if (c >= 0x80)
+                {
+                    m_fallback = ToRegex(pattern);
+                    return;
+                }
+
+                m_pattern[i] = ToLowerAscii((byte)c);
+            }
+        }
+
+        /// <summary>
+        /// Translates <paramref name="pattern"/> to the equivalent regular expression, for matching decoded names.
+        /// </summary>
+        public static Regex ToRegex(string pattern)
+        {
+            string regexStr = Regex
+                .Escape(pattern)
+                .Replace("\\?", ".")
+                .Replace("\\*", ".*");
+            return new Regex($"^{regexStr}$", RegexOptions.IgnoreCase | RegexOptions.Compiled);
+        }
+
+        /// <summary>
+        /// Whether <paramref name="name"/> matches the pattern.
+        /// </summary>
+        public bool IsMatch(ReadOnlySpan<byte> name)
+        {
+            if (m_matchesEverything)
+            {
+                return true;
+            }
+
+            if (m_fallback != null)
+            {
+                return m_fallback.IsMatch(DirectoryEnumerator.GetName(name));
+            }
+
+            // Greedy matching that backtracks to the last '*' on a mismatch: linear for patterns with a single '*', which are the common ones
+            int p = 0;
+            int n = 0;
+            int starPattern = -1;
+            int starName = 0;
+
+            while (n < name.Length)
+            {
+                if (p < m_pattern.Length)
+                {
+                    byte c = m_pattern[p];
+                    if (c == '*')
+                    {
+                        starPattern = p++;
+                        starName = n;
+                        continue;
+                    }
+
+                    if (c == '?')
+                    {
+                        p++;
+                        n = NextCharacter(name, n);
+                        continue;
+                    }
+
+                    if (c == ToLowerAscii(name[n]))
+                    {
+                        p++;
+                        n++;
+                        continue;
+                    }
+                }
+
+                if (starPattern < 0)
+                {
+                    return false;
+                }
+
+                // Let the last '*' absorb one more character and retry from there
+                p = starPattern + 1;
+                starName = NextCharacter(name, starName);
+                n = starName;
+            }
+
+            while (p < m_pattern.Length && m_pattern[p] == '*')
+            {
+                p++;
+            }
+
+            return p == m_pattern.Length;
+        }
+
+        /// <summary>
+        /// Index of the character after the one starting at <paramref name="index"/>: a lead byte and its continuation bytes (10xxxxxx) are one character.
+        /// </summary>
+        private static int NextCharacter(ReadOnlySpan<byte> name, int index)
+        {
+            index++;
+            while (index < name.Length && (name[index] & 0xC0) == 0x80)
+            {
+                index++;
+            }
+
+            return index;
+        }
+
+        private static byte ToLowerAscii(byte b) => b >= 'A' && b <= 'Z' ? (byte)(b | 0x20) : b;
+    }
+}
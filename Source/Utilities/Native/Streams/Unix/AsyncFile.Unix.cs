@@ -3,17 +3,20 @@
 
 using System;
 using System.Diagnostics.ContractsLight;
-using System.IO;
-using System.Threading;
+using System.Runtime.InteropServices;
 using System.Threading.Tasks;
 using BuildXL.Native.IO;
 using BuildXL.Utilities.Core;
 using Microsoft.Win32.SafeHandles;
-using static BuildXL.Native.IO.Unix.FileSystemUnix;
+using UnixIO = BuildXL.Interop.Unix.IO;
 
 namespace BuildXL.Native.Streams.Unix
 {
     /// <inheritdoc />
+    /// <remarks>
+    /// Reads are positional reads of the handle straight into the pinned buffer of the caller, issued by <see cref="PositionalReadQueue"/>
+    /// (through io_uring on Linux), so concurrent reads of one file don't serialize.
+    /// </remarks>
     public sealed class AsyncFileUnix : IAsyncFile
     {
         private readonly SafeFileHandle m_handle;
@@ -21,7 +24,6 @@ namespace BuildXL.Native.Streams.Unix
         private readonly string m_path;
         private readonly bool m_ownsHandle;
         private readonly FileDesiredAccess m_access;
-        private readonly FileStream m_fileStream;
 
         /// <summary>
         /// Creates an <see cref="AsyncFileUnix"/> to wrap an existing native handle compatible with Unix based systems.
@@ -40,18 +42,10 @@ namespace BuildXL.Native.Streams.Unix
             m_path = path;
             m_ownsHandle = ownsHandle;
             m_access = access;
-
-            m_fileStream = new FileStream(
-                m_path,
-                FileMode.Open,
-                FileDesiredAccessToFileAccess(access),
-                FileShare.ReadWrite,
-                DefaultBufferSize,
-                FileOptions.Asynchronous);
         }
 
         /// <inheritdoc />
-        public SafeFileHandle Handle => m_fileStream.SafeFileHandle;
+        public SafeFileHandle Handle => m_handle;
 
         /// <inheritdoc />
         public string Path => m_path;
@@ -75,8 +69,6 @@ namespace BuildXL.Native.Streams.Unix
             {
                 m_handle.Dispose();
             }
-
-            m_fileStream.Dispose();
         }
 
         /// <nodoc />
@@ -86,15 +78,20 @@ namespace BuildXL.Native.Streams.Unix
             {
                 m_handle.Close();
             }
-
-            m_fileStream.Close();
         }
 
         /// <inheritdoc />
         public long GetCurrentLength()
         {
             Contract.Requires(Kind == FileKind.File);
-            return m_fileStream.Length;
+
+            var statBuffer = new UnixIO.StatBuffer();
+            if (UnixIO.StatFileDescriptor(m_handle, ref statBuffer) != 0)
+            {
+                throw new NativeWin32Exception(Marshal.GetLastWin32Error(), "Failed to query the length of file " + m_path);
+            }
+
+            return statBuffer.Size;
         }
 
         /// <inheritdoc />
@@ -112,66 +109,10 @@ namespace BuildXL.Native.Streams.Unix
             int bytesToRead,
             long fileOffset)
         {
-            FileAsyncIOResult result;
-            if (GetCurrentLength() == 0 || fileOffset >= GetCurrentLength())
-            {
-                result = new FileAsyncIOResult(FileAsyncIOStatus.Failed, bytesTransferred: 0, error: NativeIOConstants.ErrorHandleEof);
-            }
-            else
-            {
-                lock(m_fileStream)
-                {
-                    try
-                    {
-                        byte[] buffer = new byte[bytesToRead];
-                        m_fileStream.Seek(fileOffset, SeekOrigin.Begin);
-                        int bytesRead = m_fileStream.Read(buffer, 0, bytesToRead);
-
-                        for (int i = 0; i < bytesRead; i++)
-                        {
-                            pinnedBuffer[i] = buffer[i];
-                        }
-
-                        // Files under proc and sys are part of pseudo file systems. The length reported by the underlying stream in these cases
-                        // do not always reflect actual content that can be read. When no bytes are read from the stream, we treat that as an EOF
-                        if (bytesRead == 0)
-                        {
-                            result = new FileAsyncIOResult(FileAsyncIOStatus.Failed, bytesTransferred: 0, error: NativeIOConstants.ErrorHandleEof);
-                        }
-                        else
-                        {
-                            result = new FileAsyncIOResult(FileAsyncIOStatus.Succeeded, bytesTransferred: bytesRead, error: NativeIOConstants.ErrorSuccess);
-                        }
-                    }
-                    catch (Exception ex)
-                    {
-                        int errorCode = (int)NativeErrorCodeForException(ex);
-                        result = new FileAsyncIOResult(FileAsyncIOStatus.Failed, bytesTransferred: 0, error: errorCode);
-                    }
-                }
-            }
-
-            QueueCompletionNotification(target, result);
+            PositionalReadQueue.Instance.Read(m_handle, target, pinnedBuffer, bytesToRead, m_kind == FileKind.Pipe ? -1 : fileOffset);
             return null;
         }
 
-        private unsafe void QueueCompletionNotification(IIOCompletionTarget target, FileAsyncIOResult result)
-        {
-            var notificationArgs = new IOCompletionNotificationArgs
-            {
-                Result = result,
-                Target = target,
-            };
-
-            ThreadPool.QueueUserWorkItem(
-                state =>
-                {
-                    var stateArgs = (IOCompletionNotificationArgs)state;
-                    stateArgs.Target.OnCompletion(stateArgs.Result);
-                },
-                notificationArgs);
-        }
-
         /// <inheritdoc />
         public unsafe Task<FileAsyncIOResult> ReadAsync(
             byte[] buffer,
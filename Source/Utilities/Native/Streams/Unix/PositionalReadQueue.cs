@@ -0,0 +1,227 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
+using System.Threading;
+using BuildXL.Interop.Linux;
+using BuildXL.Native.IO;
+using BuildXL.Utilities.Core;
+using Microsoft.Win32.SafeHandles;
+using UnixIO = BuildXL.Interop.Unix.IO;
+
+namespace BuildXL.Native.Streams.Unix
+{
+    /// <summary>
+    /// Issues the positional reads of <see cref="AsyncFileUnix"/> straight into the pinned buffers of their callers.
+    /// </summary>
+    /// <remarks>
+    /// On Linux, reads are submitted to one io_uring instance shared by all files, whose completions are reaped by one dedicated thread,
+    /// so no thread blocks on a read. The completion targets run on thread-pool threads, as with the Windows <see cref="IIOCompletionManager"/>,
+    /// so they can't starve the completion thread.
+    ///
+    /// Where io_uring is not available (macOS, kernels older than 5.6, or io_uring disabled by a seccomp profile or sysctl), and for reads
+    /// beyond the <see cref="MaxInFlightReads"/> the ring takes at once, the read is a pread on a thread-pool thread instead.
+    /// </remarks>
+    internal sealed unsafe class PositionalReadQueue
+    {
+        /// <summary>
+        /// Reads the ring can have in flight; the completion queue has twice as many entries, so completions never overflow it.
+        /// </summary>
+        private const int MaxInFlightReads = 256;
+
+        /// <summary>
+        /// The queue shared by all files.
+        /// </summary>
+        internal static readonly PositionalReadQueue Instance = new PositionalReadQueue();
+
+        /// <summary>
+        /// A read submitted to the ring. The handle of the file is kept alive (DangerousAddRef) until the read completes.
+        /// </summary>
+        private sealed class PendingRead
+        {
+            internal SafeFileHandle Handle;
+            internal IIOCompletionTarget Target;
+        }
+
+        private readonly IoUring m_ring;
+
+        /// <summary>
+        /// Reads in flight, indexed by the user data of their submission.
+        /// </summary>
+        private readonly PendingRead[] m_pendingReads;
+
+        /// <summary>
+        /// Free indices of <see cref="m_pendingReads"/>. Guarded by <see cref="m_submissionLock"/>, like the submission queue of the ring.
+        /// </summary>
+        private readonly Stack<int> m_freeSlots;
+        private readonly object m_submissionLock = new object();
+
+        /// <summary>
+        /// Whether reads go through io_uring.
+        /// </summary>
+        internal bool UsesIoUring => m_ring != null;
+
+        private PositionalReadQueue()
+        {
+            if (OperatingSystemHelper.IsMacOS || IoUring.Create(MaxInFlightReads, out m_ring) != 0)
+            {
+                return;
+            }
+
+            m_pendingReads = new PendingRead[MaxInFlightReads];
+            m_freeSlots = new Stack<int>(MaxInFlightReads);
+            for (int i = MaxInFlightReads - 1; i >= 0; i--)
+            {
+                m_pendingReads[i] = new PendingRead();
+                m_freeSlots.Push(i);
+            }
+
+            var completionThread = new Thread(CompletionLoop)
+            {
+                Name = "IoUringCompletionWorker",
+                IsBackground = true,
+            };
+            completionThread.Start();
+        }
+
+        /// <summary>
+        /// Reads up to <paramref name="bytesToRead"/> bytes of <paramref name="handle"/> at <paramref name="fileOffset"/> (or at the current
+        /// position when negative, for pipes) into <paramref name="pinnedBuffer"/>, and reports the result to <paramref name="target"/>.
+        /// </summary>
+        /// <remarks>
+        /// Reading no bytes is reported as <see cref="NativeIOConstants.ErrorHandleEof"/>, and a failure with its errno value.
+        /// </remarks>
+        internal void Read(SafeFileHandle handle, IIOCompletionTarget target, byte* pinnedBuffer, int bytesToRead, long fileOffset)
+        {
+            bool addedRef = false;
+            handle.DangerousAddRef(ref addedRef);
+
+            if (m_ring != null && TrySubmit(handle, target, pinnedBuffer, bytesToRead, fileOffset))
+            {
+                return;
+            }
+
+            IntPtr buffer = (IntPtr)pinnedBuffer;
+            ThreadPool.UnsafeQueueUserWorkItem(
+                _ =>
+                {
+                    FileAsyncIOResult result;
+                    try
+                    {
+                        long bytesRead = UnixIO.PRead(handle, (byte*)buffer, bytesToRead, fileOffset);
+                        result = CreateResult(bytesRead >= 0 ? (int)bytesRead : -Marshal.GetLastWin32Error());
+                    }
+                    finally
+                    {
+                        handle.DangerousRelease();
+                    }
+
+                    target.OnCompletion(result);
+                },
+                null);
+        }
+
+        private bool TrySubmit(SafeFileHandle handle, IIOCompletionTarget target, byte* pinnedBuffer, int bytesToRead, long fileOffset)
+        {
+            lock (m_submissionLock)
+            {
+                if (m_freeSlots.Count == 0)
+                {
+                    return false;
+                }
+
+                int slot = m_freeSlots.Pop();
+                PendingRead read = m_pendingReads[slot];
+                read.Handle = handle;
+                read.Target = target;
+
+                if (m_ring.SubmitRead(handle.DangerousGetHandle().ToInt32(), pinnedBuffer, (uint)bytesToRead, fileOffset, (ulong)slot) != 0)
+                {
+                    read.Handle = null;
+                    read.Target = null;
+                    m_freeSlots.Push(slot);
+                    return false;
+                }
+
+                return true;
+            }
+        }
+
+        private void CompletionLoop()
+        {
+            try
+            {
+                while (true)
+                {
+                    while (m_ring.TryGetCompletion(out IoUring.Completion completion))
+                    {
+                        Complete(completion);
+                    }
+
+                    int error = m_ring.WaitForCompletions();
+                    if (error != 0 && error != (int)UnixIO.Errno.EINTR)
+                    {
+                        throw new NativeWin32Exception(error, "io_uring_enter failed waiting for completions");
+                    }
+                }
+            }
+            catch (Exception ex)
+            {
+                ExceptionUtilities.FailFast("Catastrophic failure in I/O completion worker", ex);
+                throw;
+            }
+        }
+
+        private void Complete(IoUring.Completion completion)
+        {
+            int slot = (int)completion.UserData;
+            PendingRead read = m_pendingReads[slot];
+            SafeFileHandle handle = read.Handle;
+            IIOCompletionTarget target = read.Target;
+
+            lock (m_submissionLock)
+            {
+                read.Handle = null;
+                read.Target = null;
+                m_freeSlots.Push(slot);
+            }
+
+            handle.DangerousRelease();
+
+            var notificationArgs = new IOCompletionNotificationArgs
+            {
+                Result = CreateResult(completion.Result),
+                Target = target,
+            };
+
+            ThreadPool.UnsafeQueueUserWorkItem(
+                state =>
+                {
+                    var stateArgs = (IOCompletionNotificationArgs)state;
+                    stateArgs.Target.OnCompletion(stateArgs.Result);
+                },
+                notificationArgs);
+        }
+
+        /// <summary>
+        /// Result of a read that returned <paramref name="result"/> bytes, or -errno.
+        /// </summary>
+        /// <remarks>
+        /// Files under proc and sys are part of pseudo file systems, whose length does not always reflect the content that can be read,
+        /// so reading no bytes is what indicates the end of the file.
+        /// </remarks>
+        private static FileAsyncIOResult CreateResult(int result)
+        {
+            if (result > 0)
+            {
+                return new FileAsyncIOResult(FileAsyncIOStatus.Succeeded, bytesTransferred: result, error: NativeIOConstants.ErrorSuccess);
+            }
+
+            return result == 0
+                ? new FileAsyncIOResult(FileAsyncIOStatus.Failed, bytesTransferred: 0, error: NativeIOConstants.ErrorHandleEof)
+                : new FileAsyncIOResult(FileAsyncIOStatus.Failed, bytesTransferred: 0, error: -result);
+        }
+    }
+}
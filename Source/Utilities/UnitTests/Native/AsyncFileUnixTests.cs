@@ -0,0 +1,143 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.IO;
+using System.Linq;
+using System.Threading.Tasks;
+using BuildXL.Native.IO;
+using BuildXL.Native.Streams;
+using Xunit;
+
+namespace Test.BuildXL.Native
+{
+    /// <summary>
+    /// Tests for the positional reads of <see cref="global::BuildXL.Native.Streams.Unix.AsyncFileUnix"/>, which go through io_uring where the
+    /// kernel allows it and through pread on the thread pool otherwise.
+    /// </summary>
+    public sealed class AsyncFileUnixTests : TemporaryDirectoryTestBase
+    {
+        private const int EISDIR = 21;
+
+        private string WriteRandomFile(string relativePath, int size)
+        {
+            var contents = new byte[size];
+            new Random(size).NextBytes(contents);
+
+            string path = GetFullPath(relativePath);
+            File.WriteAllBytes(path, contents);
+            return path;
+        }
+
+        private static IAsyncFile OpenForRead(string path, FileFlagsAndAttributes flagsAndAttributes = FileFlagsAndAttributes.None)
+        {
+            return AsyncFileFactory.CreateOrOpen(path, FileDesiredAccess.GenericRead, FileShare.Read, FileMode.Open, flagsAndAttributes);
+        }
+
+        [LinuxFact]
+        public void ReadsThroughTheStream()
+        {
+            foreach (int size in new[] { 0, 1, 65535, 65536, 3 << 20 })
+            {
+                string path = WriteRandomFile($"file{size}", size);
+
+                using (var file = OpenForRead(path))
+                using (var stream = file.CreateReadableStream())
+                using (var contents = new MemoryStream())
+                {
+                    Assert.Equal(size, file.GetCurrentLength());
+
+                    stream.CopyTo(contents);
+                    Assert.True(File.ReadAllBytes(path).AsSpan().SequenceEqual(contents.ToArray()), $"Contents of a file of {size} bytes differ");
+                }
+            }
+        }
+
+        [LinuxFact]
+        public async Task ReadsAtTheGivenOffset()
+        {
+            string path = WriteRandomFile("file", 10000);
+            byte[] expected = File.ReadAllBytes(path);
+
+            using (var file = OpenForRead(path))
+            {
+                var buffer = new byte[100];
+                var result = await file.ReadAsync(buffer, buffer.Length, 9950);
+
+                Assert.Equal(FileAsyncIOStatus.Succeeded, result.Status);
+                Assert.Equal(50, result.BytesTransferred);
+                Assert.True(expected.AsSpan(9950).SequenceEqual(buffer.AsSpan(0, 50)));
+            }
+        }
+
+        [LinuxFact]
+        public async Task ReportsTheEndOfFile()
+        {
+            string path = WriteRandomFile("file", 100);
+
+            using (var file = OpenForRead(path))
+            {
+                var atEnd = await file.ReadAsync(new byte[10], 10, 100);
+                var pastEnd = await file.ReadAsync(new byte[10], 10, 1000);
+
+                Assert.Equal(FileAsyncIOStatus.Failed, atEnd.Status);
+                Assert.True(atEnd.ErrorIndicatesEndOfFile);
+                Assert.Equal(FileAsyncIOStatus.Failed, pastEnd.Status);
+                Assert.True(pastEnd.ErrorIndicatesEndOfFile);
+            }
+        }
+
+        [LinuxFact]
+        public async Task ReadsProcFsFiles()
+        {
+            // procfs reports a length of 0 for files that have contents: only a read that returns no bytes is the end of the file
+            using (var file = OpenForRead("/proc/self/status"))
+            {
+                var buffer = new byte[4096];
+                var result = await file.ReadAsync(buffer, buffer.Length, 0);
+
+                Assert.Equal(FileAsyncIOStatus.Succeeded, result.Status);
+                Assert.StartsWith("Name:", System.Text.Encoding.ASCII.GetString(buffer, 0, result.BytesTransferred));
+            }
+        }
+
+        [LinuxFact]
+        public async Task ReportsReadErrors()
+        {
+            Directory.CreateDirectory(GetFullPath("directory"));
+
+            using (var directory = OpenForRead(GetFullPath("directory"), FileFlagsAndAttributes.FileFlagBackupSemantics))
+            {
+                var result = await directory.ReadAsync(new byte[10], 10, 0);
+
+                Assert.Equal(FileAsyncIOStatus.Failed, result.Status);
+                Assert.Equal(EISDIR, result.Error);
+            }
+        }
+
+        [LinuxFact]
+        public async Task ReadsConcurrently()
+        {
+            // More reads than the ring takes at once, so some of them go through the thread pool
+            const int ReadSize = 65536;
+            string path = WriteRandomFile("file", 8 << 20);
+            byte[] expected = File.ReadAllBytes(path);
+
+            using (var file = OpenForRead(path))
+            {
+                var reads = Enumerable.Range(0, 2000).Select(async i =>
+                {
+                    var buffer = new byte[ReadSize];
+                    int offset = (int)((long)i * 32768 % expected.Length);
+                    var result = await file.ReadAsync(buffer, buffer.Length, offset);
+
+                    return result.Status == FileAsyncIOStatus.Succeeded
+                        && result.BytesTransferred == Math.Min(ReadSize, expected.Length - offset)
+                        && buffer.AsSpan(0, result.BytesTransferred).SequenceEqual(expected.AsSpan(offset, result.BytesTransferred));
+                }).ToArray();
+
+                Assert.True((await Task.WhenAll(reads)).All(succeeded => succeeded));
+            }
+        }
+    }
+}
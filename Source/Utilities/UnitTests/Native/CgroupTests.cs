@@ -0,0 +1,140 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System.IO;
+using BuildXL.Interop.Linux;
+using Xunit;
+
+namespace Test.BuildXL.Native
+{
+    /// <summary>
+    /// Tests for the cgroup v2 counter parsing of <see cref="Cgroup"/>, over a fake cgroup directory.
+    /// </summary>
+    public sealed class CgroupTests : TemporaryDirectoryTestBase
+    {
+        private const string CpuStat =
+            "usage_usec 1500\n" +
+            "user_usec 1000\n" +
+            "system_usec 500\n" +
+            "nr_periods 0\n";
+
+        // Keys that start like the ones that are looked for come first
+        private const string MemoryStat =
+            "anon_thp 999\n" +
+            "anon 4096\n" +
+            "file 1048576\n" +
+            "file_mapped 8192\n" +
+            "file_dirty 0\n";
+
+        private const string IoStat =
+            "8:0 rbytes=100 wbytes=200 rios=1 wios=2 dbytes=1000 dios=10\n" +
+            "8:16 rbytes=1000 wbytes=2000 rios=10 wios=20 dbytes=0 dios=0\n";
+
+        private readonly byte[] m_buffer = new byte[Cgroup.UsageBufferSize];
+
+        private string CreateCgroup(string cpuStat = CpuStat, string memoryStat = MemoryStat, string ioStat = IoStat)
+        {
+            var path = GetFullPath("pip");
+            Directory.CreateDirectory(path);
+            WriteFile("pip/cgroup.controllers", "cpu memory io\n");
+            if (cpuStat != null)
+            {
+                WriteFile("pip/cpu.stat", cpuStat);
+            }
+
+            if (memoryStat != null)
+            {
+                WriteFile("pip/memory.stat", memoryStat);
+            }
+
+            if (ioStat != null)
+            {
+                WriteFile("pip/io.stat", ioStat);
+            }
+
+            return path;
+        }
+
+        [Fact]
+        public void ReadsUsage()
+        {
+            var usage = default(Cgroup.Usage);
+            Assert.True(Cgroup.TryReadUsage(CreateCgroup(), m_buffer, ref usage));
+
+            Assert.Equal(1000UL, usage.UserTimeUs);
+            Assert.Equal(500UL, usage.SystemTimeUs);
+
+            // The page cache ('file') is left out
+            Assert.Equal(4096UL + 8192UL, usage.MemoryCurrentBytes);
+            Assert.Equal(4096UL + 8192UL, usage.MemoryPeakBytes);
+
+            // Summed over devices, without the discard counters
+            Assert.Equal(1100UL, usage.ReadBytes);
+            Assert.Equal(2200UL, usage.WriteBytes);
+            Assert.Equal(11UL, usage.ReadOps);
+            Assert.Equal(22UL, usage.WriteOps);
+        }
+
+        [Fact]
+        public void EmptyIoStatMeansNoIo()
+        {
+            var usage = default(Cgroup.Usage);
+            Assert.True(Cgroup.TryReadUsage(CreateCgroup(ioStat: string.Empty), m_buffer, ref usage));
+
+            Assert.Equal(1000UL, usage.UserTimeUs);
+            Assert.Equal(0UL, usage.ReadBytes);
+            Assert.Equal(0UL, usage.WriteOps);
+        }
+
+        [Fact]
+        public void PeakIsOnlyRaised()
+        {
+            var usage = new Cgroup.Usage { MemoryPeakBytes = 1 << 20 };
+            Assert.True(Cgroup.TryReadUsage(CreateCgroup(), m_buffer, ref usage));
+            Assert.Equal(4096UL + 8192UL, usage.MemoryCurrentBytes);
+            Assert.Equal((ulong)(1 << 20), usage.MemoryPeakBytes);
+
+            usage.MemoryPeakBytes = 0;
+            Assert.True(Cgroup.TryReadUsage(CreateCgroup(), m_buffer, ref usage));
+            Assert.Equal(4096UL + 8192UL, usage.MemoryPeakBytes);
+        }
+
+        [Fact]
+        public void LastLineWithoutNewLine()
+        {
+            var usage = default(Cgroup.Usage);
+            Assert.True(Cgroup.TryReadUsage(CreateCgroup(cpuStat: "user_usec 7\nsystem_usec 8", ioStat: "8:0 rbytes=5"), m_buffer, ref usage));
+            Assert.Equal(7UL, usage.UserTimeUs);
+            Assert.Equal(8UL, usage.SystemTimeUs);
+            Assert.Equal(5UL, usage.ReadBytes);
+        }
+
+        [Theory]
+        [InlineData(null, MemoryStat, IoStat)]
+        [InlineData(CpuStat, null, IoStat)]
+        [InlineData(CpuStat, MemoryStat, null)]
+        [InlineData("usage_usec 1500\nsystem_usec 500\n", MemoryStat, IoStat)]
+        [InlineData(CpuStat, "anon 4096\nfile 1048576\n", IoStat)]
+        [InlineData("user_usec 12x\nsystem_usec 500\n", MemoryStat, IoStat)]
+        [InlineData("user_usec \nsystem_usec 500\n", MemoryStat, IoStat)]
+        public void IncompleteCgroupLeavesUsageUnchanged(string cpuStat, string memoryStat, string ioStat)
+        {
+            var usage = new Cgroup.Usage { UserTimeUs = 1, MemoryCurrentBytes = 2, MemoryPeakBytes = 3, ReadBytes = 4 };
+            Assert.False(Cgroup.TryReadUsage(CreateCgroup(cpuStat, memoryStat, ioStat), m_buffer, ref usage));
+
+            Assert.Equal(1UL, usage.UserTimeUs);
+            Assert.Equal(2UL, usage.MemoryCurrentBytes);
+            Assert.Equal(3UL, usage.MemoryPeakBytes);
+            Assert.Equal(4UL, usage.ReadBytes);
+        }
+
+        [Fact]
+        public void RemovedCgroup()
+        {
+            var usage = default(Cgroup.Usage);
+            Assert.False(Cgroup.TryReadUsage(GetFullPath("gone"), m_buffer, ref usage));
+            Assert.False(Cgroup.IsCgroup2Directory(GetFullPath("gone")));
+            Assert.True(Cgroup.IsCgroup2Directory(CreateCgroup()));
+        }
+    }
+}
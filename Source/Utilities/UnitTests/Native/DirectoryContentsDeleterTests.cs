@@ -0,0 +1,240 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Threading;
+using BuildXL.Native.IO.Unix;
+using Xunit;
+
+namespace Test.BuildXL.Native
+{
+    /// <summary>
+    /// Tests for the descriptor-based deletion of directory contents on Linux (see DirectoryContentsDeleter), which must behave like the
+    /// path-based deletion of <see cref="FileUtilitiesUnix"/>.
+    /// </summary>
+    public sealed class DirectoryContentsDeleterTests : TemporaryDirectoryTestBase
+    {
+        private readonly FileUtilitiesUnix m_fileUtilities = new FileUtilitiesUnix();
+
+        private string Root => GetFullPath("root");
+
+        private void CreateTree()
+        {
+            for (int i = 0; i < 5; i++)
+            {
+                for (int j = 0; j < 3; j++)
+                {
+                    WriteFile($"root/pkg{i}/f{j}.js", "x");
+                    WriteFile($"root/pkg{i}/lib/sub/g{j}.keep", "y");
+                }
+            }
+
+            WriteFile("root/.hidden", "x");
+            Directory.CreateDirectory(Path.Combine(Root, "pkg1", "emptykept"));
+            WriteFile("root/pkg2/kept/full/x", "x");
+        }
+
+        private List<string> GetRemainingEntries()
+        {
+            return Directory.Exists(Root)
+                ? Directory.EnumerateFileSystemEntries(Root, "*", SearchOption.AllDirectories).Select(p => p.Substring(Root.Length)).OrderBy(p => p, StringComparer.Ordinal).ToList()
+                : null;
+        }
+
+        [LinuxFact]
+        public void DeletesEverythingButTheRoot()
+        {
+            CreateTree();
+            m_fileUtilities.DeleteDirectoryContents(Root);
+
+            Assert.True(Directory.Exists(Root));
+            Assert.Empty(GetRemainingEntries());
+        }
+
+        [LinuxFact]
+        public void DeletesTheRoot()
+        {
+            CreateTree();
+            m_fileUtilities.DeleteDirectoryContents(Root, deleteRootDirectory: true);
+
+            Assert.False(Directory.Exists(Root));
+        }
+
+        [LinuxFact]
+        public void DoesNotFollowSymlinks()
+        {
+            CreateTree();
+            var outsideFile = WriteFile("outside/file", "keep me");
+            var outsideDirectory = GetFullPath("outside/directory");
+            WriteFile("outside/directory/file", "keep me");
+            File.CreateSymbolicLink(Path.Combine(Root, "pkg0", "linkfile"), outsideFile);
+            Directory.CreateSymbolicLink(Path.Combine(Root, "pkg1", "linkdir"), outsideDirectory);
+
+            m_fileUtilities.DeleteDirectoryContents(Root, deleteRootDirectory: true);
+
+            Assert.False(Directory.Exists(Root));
+            Assert.True(File.Exists(outsideFile));
+            Assert.True(File.Exists(Path.Combine(outsideDirectory, "file")));
+        }
+
+        [LinuxFact]
+        public void MissingDirectoryOrFile()
+        {
+            Assert.Equal(0, m_fileUtilities.DeleteDirectoryContentsInternal(GetFullPath("missing"), true, null, null, false, null));
+
+            var file = WriteFile("file", "x");
+            Assert.Equal(0, m_fileUtilities.DeleteDirectoryContentsInternal(file, true, null, null, false, null));
+            Assert.True(File.Exists(file));
+        }
+
+        [LinuxFact]
+        public void MatchesThePathBasedDeletion()
+        {
+            var predicates = new Dictionary<string, Func<string, bool, bool>>
+            {
+                ["everything"] = null,
+                ["keep some files"] = (path, isDirectory) => !path.EndsWith(".keep", StringComparison.Ordinal) || !path.Contains("/pkg3/"),
+                ["keep directories"] = (path, isDirectory) => !path.EndsWith("/emptykept", StringComparison.Ordinal) && !path.EndsWith("/kept", StringComparison.Ordinal),
+                ["keep hidden files"] = (path, isDirectory) => !Path.GetFileName(path).StartsWith(".", StringComparison.Ordinal),
+                ["keep nothing deletable"] = (path, isDirectory) => false,
+            };
+
+            foreach (var predicate in predicates)
+            {
+                foreach (bool deleteRootDirectory in new[] { false, true })
+                {
+                    var outcomes = new List<(int remaining, List<string> entries, List<string> calls)>();
+                    foreach (bool byPath in new[] { false, true })
+                    {
+                        if (Directory.Exists(Root))
+                        {
+                            Directory.Delete(Root, recursive: true);
+                        }
+
+                        CreateTree();
+                        File.CreateSymbolicLink(Path.Combine(Root, "pkg4", "link"), Path.Combine(Root, "pkg0"));
+
+                        var calls = new List<string>();
+                        Func<string, bool, bool> shouldDelete = (path, isDirectory) =>
+                        {
+                            lock (calls)
+                            {
+                                calls.Add($"{path.Substring(Root.Length)} {isDirectory}");
+                            }
+
+                            return predicate.Value?.Invoke(path, isDirectory) ?? true;
+                        };
+
+                        int remaining = byPath
+                            ? m_fileUtilities.DeleteDirectoryContentsByPath(Root, deleteRootDirectory, shouldDelete, null, false, null)
+                            : m_fileUtilities.DeleteDirectoryContentsInternal(Root, deleteRootDirectory, shouldDelete, null, false, null);
+
+                        calls.Sort(StringComparer.Ordinal);
+                        outcomes.Add((remaining, GetRemainingEntries(), calls));
+                    }
+
+                    var (descriptorRemaining, descriptorEntries, descriptorCalls) = outcomes[0];
+                    var (pathRemaining, pathEntries, pathCalls) = outcomes[1];
+                    Assert.True(descriptorRemaining == pathRemaining, $"{predicate.Key}: {descriptorRemaining} entries left instead of {pathRemaining}");
+                    Assert.Equal(pathEntries == null, descriptorEntries == null);
+                    if (pathEntries != null)
+                    {
+                        Assert.Equal(pathEntries, descriptorEntries);
+                    }
+
+                    Assert.Equal(pathCalls, descriptorCalls);
+                }
+            }
+        }
+
+        [LinuxFact]
+        public void DeletesWideTreesWithSomeEntriesKept()
+        {
+            for (int i = 0; i < 32; i++)
+            {
+                for (int j = 0; j < 8; j++)
+                {
+                    WriteFile($"root/d{i}/e{j}/f.js", "x");
+                    WriteFile($"root/d{i}/e{j}/g/h.keep", "x");
+                }
+            }
+
+            // Every d{i}/e{j} directory counts as remaining in d{i}, and every d{i} in the root
+            int remaining = m_fileUtilities.DeleteDirectoryContentsInternal(
+                Root,
+                deleteRootDirectory: true,
+                (path, isDirectory) => !path.EndsWith(".keep", StringComparison.Ordinal) || !path.Contains("/d7/"),
+                null,
+                false,
+                null);
+
+            Assert.Equal(1, remaining);
+            Assert.Equal(
+                Enumerable.Range(0, 8).SelectMany(j => new[] { $"/d7/e{j}", $"/d7/e{j}/g", $"/d7/e{j}/g/h.keep" }).Append("/d7").OrderBy(p => p, StringComparer.Ordinal),
+                GetRemainingEntries());
+        }
+
+        [LinuxFact]
+        public void CancellationDuringTheDeletion()
+        {
+            for (int i = 0; i < 32; i++)
+            {
+                WriteFile($"root/d{i}/e/f", "x");
+            }
+
+            using var cancellation = new CancellationTokenSource();
+            int calls = 0;
+            m_fileUtilities.DeleteDirectoryContentsInternal(
+                Root,
+                deleteRootDirectory: false,
+                (path, isDirectory) =>
+                {
+                    if (Interlocked.Increment(ref calls) == 40)
+                    {
+                        cancellation.Cancel();
+                    }
+
+                    return true;
+                },
+                null,
+                false,
+                cancellation.Token);
+
+            // Stopped without throwing
+            Assert.True(Directory.Exists(Root));
+            Assert.NotEmpty(GetRemainingEntries());
+        }
+
+        [LinuxFact]
+        public void CancellationStopsTheDeletion()
+        {
+            using var cancellation = new CancellationTokenSource();
+            cancellation.Cancel();
+
+            // Like the path-based deletion, the cancellation stops the deletion of the directory being enumerated without throwing,
+            // and the entries left there are not counted
+            var outcomes = new List<List<string>>();
+            foreach (bool byPath in new[] { false, true })
+            {
+                if (Directory.Exists(Root))
+                {
+                    Directory.Delete(Root, recursive: true);
+                }
+
+                CreateTree();
+                int remaining = byPath
+                    ? m_fileUtilities.DeleteDirectoryContentsByPath(Root, false, null, null, false, cancellation.Token)
+                    : m_fileUtilities.DeleteDirectoryContentsInternal(Root, false, null, null, false, cancellation.Token);
+
+                Assert.Equal(0, remaining);
+                outcomes.Add(GetRemainingEntries());
+            }
+
+            Assert.NotEmpty(outcomes[0]);
+            Assert.Equal(outcomes[1], outcomes[0]);
+        }
+    }
+}
@@ -0,0 +1,424 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+using BuildXL.Interop.Linux;
+using BuildXL.Native.IO;
+using BuildXL.Native.IO.Unix;
+using BuildXL.Utilities.Core;
+using Xunit;
+
+namespace Test.BuildXL.Native
+{
+    /// <summary>
+    /// Tests for the getdents64 enumeration of <see cref="DirectoryEnumerator"/>, the name matching of <see cref="GlobMatcher"/>, and the
+    /// accumulator enumeration of <see cref="FileSystemUnix"/> built on them.
+    /// </summary>
+    public sealed class DirectoryEnumeratorTests : TemporaryDirectoryTestBase
+    {
+        // Linux errno values
+        private const int ENOENT = 2;
+        private const int ENOTDIR = 20;
+        private const int ENOTEMPTY = 39;
+
+        private static byte[] Utf8(string name) => Encoding.UTF8.GetBytes(name);
+
+        private static Dictionary<string, DirectoryEnumerator.EntryType> Enumerate(string path, int bufferSize = DirectoryEnumerator.DefaultBufferSize)
+        {
+            Assert.Equal(0, DirectoryEnumerator.OpenDirectory(path, out var directory));
+            using (directory)
+            {
+                var entries = new Dictionary<string, DirectoryEnumerator.EntryType>();
+                Assert.Equal(0, DirectoryEnumerator.Enumerate(directory, new byte[bufferSize], (name, type) =>
+                {
+                    entries.Add(DirectoryEnumerator.GetName(name), type);
+                    return true;
+                }));
+
+                return entries;
+            }
+        }
+
+        [LinuxFact]
+        public void EnumeratesEntriesWithTheirTypes()
+        {
+            WriteFile("file.txt", "x");
+            WriteFile("ümläut", "x");
+            WriteFile(".hidden", "x");
+            Directory.CreateDirectory(GetFullPath("directory"));
+            File.CreateSymbolicLink(GetFullPath("link"), GetFullPath("directory"));
+            File.CreateSymbolicLink(GetFullPath("dangling"), GetFullPath("missing"));
+
+            var entries = Enumerate(TemporaryDirectory);
+
+            Assert.Equal(6, entries.Count);
+            Assert.Equal(DirectoryEnumerator.EntryType.RegularFile, entries["file.txt"]);
+            Assert.Equal(DirectoryEnumerator.EntryType.RegularFile, entries["ümläut"]);
+            Assert.Equal(DirectoryEnumerator.EntryType.RegularFile, entries[".hidden"]);
+            Assert.Equal(DirectoryEnumerator.EntryType.Directory, entries["directory"]);
+            Assert.Equal(DirectoryEnumerator.EntryType.Symlink, entries["link"]);
+            Assert.Equal(DirectoryEnumerator.EntryType.Symlink, entries["dangling"]);
+        }
+
+        [LinuxFact]
+        public void EnumeratesLargeDirectoriesWithSmallBuffers()
+        {
+            var expected = Enumerable.Range(0, 500).Select(i => $"file-with-a-longer-name-{i}").ToList();
+            foreach (var name in expected)
+            {
+                WriteFile(name, string.Empty);
+            }
+
+            // Each getdents64 call returns a handful of entries
+            var entries = Enumerate(TemporaryDirectory, bufferSize: 512);
+            Assert.Equal(expected.OrderBy(n => n, StringComparer.Ordinal), entries.Keys.OrderBy(n => n, StringComparer.Ordinal));
+        }
+
+        [LinuxFact]
+        public void VisitorStopsTheEnumeration()
+        {
+            for (int i = 0; i < 10; i++)
+            {
+                WriteFile($"file{i}", string.Empty);
+            }
+
+            Assert.Equal(0, DirectoryEnumerator.OpenDirectory(TemporaryDirectory, out var directory));
+            using (directory)
+            {
+                int visited = 0;
+                Assert.Equal(0, DirectoryEnumerator.Enumerate(directory, new byte[DirectoryEnumerator.DefaultBufferSize], (name, type) => ++visited < 3));
+                Assert.Equal(3, visited);
+            }
+        }
+
+        [LinuxFact]
+        public void OpenReportsErrors()
+        {
+            var file = WriteFile("file", "x");
+            Directory.CreateDirectory(GetFullPath("directory"));
+            File.CreateSymbolicLink(GetFullPath("link"), GetFullPath("directory"));
+
+            Assert.Equal(ENOENT, DirectoryEnumerator.OpenDirectory(GetFullPath("missing"), out var missing));
+            Assert.Null(missing);
+            Assert.Equal(ENOTDIR, DirectoryEnumerator.OpenDirectory(file, out _));
+
+            Assert.Equal(0, DirectoryEnumerator.OpenDirectory(TemporaryDirectory, out var root));
+            using (root)
+            {
+                Assert.Equal(0, DirectoryEnumerator.OpenDirectoryAt(root, Utf8("directory"), followSymlink: false, out var directory));
+                directory.Dispose();
+
+                Assert.Equal(0, DirectoryEnumerator.OpenDirectoryAt(root, Utf8("link"), followSymlink: true, out var target));
+                target.Dispose();
+
+                Assert.NotEqual(0, DirectoryEnumerator.OpenDirectoryAt(root, Utf8("link"), followSymlink: false, out var link));
+                Assert.Null(link);
+                Assert.Equal(ENOTDIR, DirectoryEnumerator.OpenDirectoryAt(root, Utf8("file"), followSymlink: false, out _));
+                Assert.Equal(ENOENT, DirectoryEnumerator.OpenDirectoryAt(root, Utf8("missing"), followSymlink: false, out _));
+            }
+        }
+
+        [LinuxFact]
+        public void GetsEntryInfo()
+        {
+            var readOnly = WriteFile("readonly", "x");
+            File.SetAttributes(readOnly, FileAttributes.ReadOnly);
+            WriteFile("writable", "x");
+            Directory.CreateDirectory(GetFullPath("directory"));
+            File.CreateSymbolicLink(GetFullPath("link"), GetFullPath("directory"));
+            File.CreateSymbolicLink(GetFullPath("dangling"), GetFullPath("missing"));
+
+            Assert.Equal(0, DirectoryEnumerator.OpenDirectory(TemporaryDirectory, out var root));
+            using (root)
+            {
+                Assert.True(DirectoryEnumerator.TryGetEntryInfo(root, Utf8("readonly"), out var type, out bool isReadOnly));
+                Assert.Equal(DirectoryEnumerator.EntryType.RegularFile, type);
+                Assert.Equal(File.GetAttributes(readOnly).HasFlag(FileAttributes.ReadOnly), isReadOnly);
+
+                Assert.True(DirectoryEnumerator.TryGetEntryInfo(root, Utf8("writable"), out _, out isReadOnly));
+                Assert.False(isReadOnly);
+
+                // Symlinks are followed
+                Assert.True(DirectoryEnumerator.TryGetEntryInfo(root, Utf8("link"), out type, out _));
+                Assert.Equal(DirectoryEnumerator.EntryType.Directory, type);
+                Assert.Equal(DirectoryEnumerator.EntryType.Symlink, DirectoryEnumerator.GetEntryType(root, Utf8("link"), followSymlink: false));
+
+                Assert.False(DirectoryEnumerator.TryGetEntryInfo(root, Utf8("dangling"), out type, out isReadOnly));
+                Assert.Equal(DirectoryEnumerator.EntryType.Unknown, type);
+                Assert.False(isReadOnly);
+                Assert.Equal(DirectoryEnumerator.EntryType.Unknown, DirectoryEnumerator.GetEntryType(root, Utf8("missing"), followSymlink: true));
+
+                Assert.False(DirectoryEnumerator.TryGetEntryInfo(root, new byte[DirectoryEnumerator.MaxNameLength + 1], out _, out _));
+            }
+        }
+
+        [LinuxFact]
+        public void GetsTheSameEntryInfoWithoutStatx()
+        {
+            File.SetAttributes(WriteFile("readonly", "x"), FileAttributes.ReadOnly);
+            WriteFile("writable", "x");
+            Directory.CreateDirectory(GetFullPath("directory"));
+            File.CreateSymbolicLink(GetFullPath("link"), GetFullPath("directory"));
+            File.CreateSymbolicLink(GetFullPath("dangling"), GetFullPath("missing"));
+
+            Assert.Equal(0, DirectoryEnumerator.OpenDirectory(TemporaryDirectory, out var root));
+            using (root)
+            {
+                foreach (var name in new[] { "readonly", "writable", "directory", "link", "dangling", "missing" })
+                {
+                    bool found = DirectoryEnumerator.TryGetEntryInfo(root, Utf8(name), useStatx: true, out var type, out bool isReadOnly);
+                    Assert.Equal(found, DirectoryEnumerator.TryGetEntryInfo(root, Utf8(name), useStatx: false, out var fallbackType, out bool fallbackIsReadOnly));
+                    Assert.Equal(type, fallbackType);
+                    Assert.Equal(isReadOnly, fallbackIsReadOnly);
+                }
+
+                Assert.True(DirectoryEnumerator.TryGetEntryInfo(root, Utf8("directory"), useStatx: false, out var directoryType, out _));
+                Assert.Equal(DirectoryEnumerator.EntryType.Directory, directoryType);
+            }
+        }
+
+        [LinuxFact]
+        public void RemovesEntries()
+        {
+            WriteFile("file", "x");
+            WriteFile("full/file", "x");
+            Directory.CreateDirectory(GetFullPath("empty"));
+            File.CreateSymbolicLink(GetFullPath("link"), GetFullPath("full"));
+
+            Assert.Equal(0, DirectoryEnumerator.OpenDirectory(TemporaryDirectory, out var root));
+            using (root)
+            {
+                Assert.Equal(0, DirectoryEnumerator.RemoveEntryAt(root, Utf8("file"), isDirectory: false));
+                Assert.Equal(ENOENT, DirectoryEnumerator.RemoveEntryAt(root, Utf8("file"), isDirectory: false));
+                Assert.Equal(0, DirectoryEnumerator.RemoveEntryAt(root, Utf8("empty"), isDirectory: true));
+                Assert.Equal(ENOTEMPTY, DirectoryEnumerator.RemoveEntryAt(root, Utf8("full"), isDirectory: true));
+
+                // The link, not its target
+                Assert.Equal(0, DirectoryEnumerator.RemoveEntryAt(root, Utf8("link"), isDirectory: false));
+            }
+
+            Assert.Equal(new[] { "full" }, Directory.GetFileSystemEntries(TemporaryDirectory).Select(Path.GetFileName));
+            Assert.True(File.Exists(GetFullPath("full/file")));
+        }
+
+        [LinuxFact]
+        public void EnumeratesTreesInParallel()
+        {
+            var expected = new List<string>();
+            for (int i = 0; i < 8; i++)
+            {
+                for (int j = 0; j < 8; j++)
+                {
+                    for (int k = 0; k < 16; k++)
+                    {
+                        expected.Add(WriteFile($"d{i}/d{j}/f{k}", "x"));
+                    }
+
+                    expected.Add(GetFullPath($"d{i}/d{j}"));
+                }
+
+                expected.Add(GetFullPath($"d{i}"));
+            }
+
+            // Neither followed nor reported under the pruned directory
+            File.CreateSymbolicLink(GetFullPath("link"), GetFullPath("d0"));
+            expected.Add(GetFullPath("link"));
+            WriteFile("pruned/file", "x");
+            expected.Add(GetFullPath("pruned"));
+
+            var visited = new ConcurrentQueue<string>();
+            int error = DirectoryEnumerator.EnumerateParallel(TemporaryDirectory, 4, (directoryPath, name, type) =>
+            {
+                string fileName = DirectoryEnumerator.GetName(name);
+                visited.Enqueue(Path.Combine(directoryPath, fileName));
+                return fileName != "pruned";
+            }, out string failedPath);
+
+            Assert.Equal(0, error);
+            Assert.Null(failedPath);
+            Assert.Equal(expected.OrderBy(path => path, StringComparer.Ordinal), visited.OrderBy(path => path, StringComparer.Ordinal));
+        }
+
+        [LinuxFact]
+        public void ParallelEnumerationReportsFailures()
+        {
+            Assert.Equal(ENOENT, DirectoryEnumerator.EnumerateParallel(GetFullPath("missing"), 4, (directoryPath, name, type) => true, out string failedPath));
+            Assert.Equal(GetFullPath("missing"), failedPath);
+
+            for (int i = 0; i < 16; i++)
+            {
+                WriteFile($"d{i}/file", "x");
+            }
+
+            var exception = Assert.Throws<InvalidOperationException>(() => DirectoryEnumerator.EnumerateParallel(TemporaryDirectory, 4, (directoryPath, name, type) =>
+                type == DirectoryEnumerator.EntryType.Directory ? true : throw new InvalidOperationException(directoryPath), out _));
+            Assert.StartsWith(TemporaryDirectory + "/d", exception.Message);
+        }
+
+        [Theory]
+        [InlineData("*", "anything", true)]
+        [InlineData("*", "", true)]
+        [InlineData("*.c", "main.c", true)]
+        [InlineData("*.c", "MAIN.C", true)]
+        [InlineData("*.c", "main.cpp", false)]
+        [InlineData("*.c", ".c", true)]
+        [InlineData("*.*", "noextension", false)]
+        [InlineData("*.*", "a.b.c", true)]
+        [InlineData("a?c", "abc", true)]
+        [InlineData("a?c", "ac", false)]
+        [InlineData("a?c", "aüc", true)]
+        [InlineData("a*b*c", "aXXbYYbZZc", true)]
+        [InlineData("a*b*c", "aXXbYYbZZ", false)]
+        [InlineData("Ü*", "über", true)]
+        [InlineData("exact", "Exact", true)]
+        [InlineData("exact", "exactly", false)]
+        public void MatchesGlobs(string pattern, string name, bool expected)
+        {
+            Assert.Equal(expected, new GlobMatcher(pattern).IsMatch(Utf8(name)));
+            Assert.Equal(expected, GlobMatcher.ToRegex(pattern).IsMatch(name));
+        }
+
+        [Fact]
+        public void GlobsMatchLikeRegularExpressions()
+        {
+            var random = new Random(1);
+            const string PatternCharacters = "abcABC.*?xü";
+            const string NameCharacters = "abcABC.xü";
+            for (int i = 0; i < 20000; i++)
+            {
+                var pattern = new string(Enumerable.Range(0, random.Next(0, 6)).Select(_ => PatternCharacters[random.Next(PatternCharacters.Length)]).ToArray());
+                var name = new string(Enumerable.Range(0, random.Next(1, 8)).Select(_ => NameCharacters[random.Next(NameCharacters.Length)]).ToArray());
+                Assert.True(
+                    GlobMatcher.ToRegex(pattern).IsMatch(name) == new GlobMatcher(pattern).IsMatch(Utf8(name)),
+                    $"pattern '{pattern}', name '{name}'");
+            }
+        }
+
+        [LinuxFact]
+        public void AccumulatorEnumerationMatchesThePathBasedOne()
+        {
+            WriteFile("a.c", "x");
+            WriteFile("B.C", "x");
+            WriteFile("readme", "x");
+            WriteFile(".hidden.c", "x");
+            WriteFile(".DS_Store", "x");
+            WriteFile("über.c", "x");
+            WriteFile("src/lib/x.c", "x");
+            WriteFile("src/lib/y.h", "x");
+            WriteFile("src/z.c", "x");
+            Directory.CreateDirectory(GetFullPath("empty"));
+            File.SetAttributes(WriteFile("src/readonly.c", "x"), FileAttributes.ReadOnly);
+            File.CreateSymbolicLink(GetFullPath("linked"), GetFullPath("src/lib"));
+            File.CreateSymbolicLink(GetFullPath("linked.c"), GetFullPath("a.c"));
+
+            var fileSystem = new FileSystemUnix();
+            foreach (var pattern in new[] { "*", "*.c", "?.c", "*.*", "ü*" })
+            {
+                foreach (bool enumerateDirectory in new[] { false, true })
+                {
+                    foreach (bool recursive in new[] { false, true })
+                    {
+                        var byDescriptor = new LoggingAccumulators();
+                        var byDescriptorResult = fileSystem.EnumerateDirectoryEntries(
+                            TemporaryDirectory, enumerateDirectory, pattern, 0, recursive, byDescriptor, isEnumerationForDirectoryDeletion: false);
+
+                        var byPath = new LoggingAccumulators();
+                        var byPathResult = fileSystem.EnumerateDirectoryEntriesByPath(
+                            TemporaryDirectory, enumerateDirectory, pattern, 0, recursive, byPath, isEnumerationForDirectoryDeletion: false);
+
+                        Assert.True(byDescriptorResult.Succeeded);
+                        Assert.True(byPathResult.Succeeded);
+                        Assert.NotEmpty(byPath.Log);
+                        Assert.Equal(byPath.Log, byDescriptor.Log);
+                    }
+                }
+            }
+        }
+
+        [LinuxFact]
+        public void AccumulatorEnumerationWithoutReadOnly()
+        {
+            File.SetAttributes(WriteFile("readonly.c", "x"), FileAttributes.ReadOnly);
+            WriteFile("writable.c", "x");
+            Directory.CreateDirectory(GetFullPath("directory"));
+            File.CreateSymbolicLink(GetFullPath("linked"), GetFullPath("directory"));
+            File.CreateSymbolicLink(GetFullPath("linked.c"), GetFullPath("readonly.c"));
+
+            var fileSystem = new FileSystemUnix();
+            var withReadOnly = new LoggingAccumulators();
+            var withoutReadOnly = new LoggingAccumulators(tracksReadOnly: false);
+            Assert.True(fileSystem.EnumerateDirectoryEntries(TemporaryDirectory, false, "*", 0, true, withReadOnly, isEnumerationForDirectoryDeletion: false).Succeeded);
+            Assert.True(fileSystem.EnumerateDirectoryEntries(TemporaryDirectory, false, "*", 0, true, withoutReadOnly, isEnumerationForDirectoryDeletion: false).Succeeded);
+
+            // Only ReadOnly is missing: a symlink to a directory is still reported as a directory, and followed
+            Assert.Contains(" track readonly.c ReadOnly", withReadOnly.Log);
+            Assert.Contains(" track readonly.c Normal", withoutReadOnly.Log);
+            Assert.Contains(" track linked Directory, ReparsePoint", withoutReadOnly.Log);
+            Assert.Equal(
+                withReadOnly.Log.Select(line => line.Replace("ReadOnly, ", string.Empty).Replace(" ReadOnly", " Normal")),
+                withoutReadOnly.Log);
+        }
+
+        [LinuxFact]
+        public void AccumulatorEnumerationOfMissingDirectory()
+        {
+            var result = new FileSystemUnix().EnumerateDirectoryEntries(
+                GetFullPath("missing"), false, "*", 0, true, new LoggingAccumulators(), isEnumerationForDirectoryDeletion: false);
+
+            Assert.Equal(EnumerateDirectoryStatus.SearchDirectoryNotFound, result.Status);
+        }
+
+        /// <summary>
+        /// Logs every entry reported to the accumulators, with the relative path of its directory.
+        /// </summary>
+        private sealed class LoggingAccumulators : IDirectoryEntriesAccumulator
+        {
+            private readonly Stack<LoggingAccumulator> m_accumulators = new Stack<LoggingAccumulator>();
+
+            public LoggingAccumulators(bool tracksReadOnly = true)
+            {
+                m_accumulators.Push(new LoggingAccumulator(string.Empty, Log));
+                TracksReadOnly = tracksReadOnly;
+            }
+
+            public List<string> Log { get; } = new List<string>();
+
+            public bool TracksReadOnly { get; }
+
+            public IDirectoryEntryAccumulator Current => m_accumulators.Peek();
+
+            public void AddNew(IDirectoryEntryAccumulator parent, string directoryName)
+                => m_accumulators.Push(new LoggingAccumulator(((LoggingAccumulator)parent).Name + "/" + directoryName, Log));
+
+            public void Done()
+            {
+            }
+        }
+
+        private sealed class LoggingAccumulator : IDirectoryEntryAccumulator
+        {
+            private readonly List<string> m_log;
+
+            public LoggingAccumulator(string name, List<string> log)
+            {
+                Name = name;
+                m_log = log;
+            }
+
+            public string Name { get; }
+
+            public AbsolutePath DirectoryPath => AbsolutePath.Invalid;
+
+            public bool Succeeded { get; set; } = true;
+
+            public void AddFile(string fileName) => m_log.Add($"{Name} file {fileName}");
+
+            public void AddTrackFile(string fileName, FileAttributes fileAttributes) => m_log.Add($"{Name} track {fileName} {fileAttributes}");
+        }
+    }
+}
@@ -0,0 +1,219 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+using System.Threading;
+using BuildXL.Utilities.Core;
+using Xunit;
+using static BuildXL.Utilities.Core.ElfBinaryAnalyzer;
+
+namespace Test.BuildXL.Native
+{
+    /// <summary>
+    /// Tests for <see cref="ElfBinaryAnalyzer"/>, on ELF images synthesized for every word size and byte order.
+    /// </summary>
+    public sealed class ElfBinaryAnalyzerTests : TemporaryDirectoryTestBase
+    {
+        private const string Interpreter = "/lib64/ld-linux-x86-64.so.2";
+
+        private static readonly (bool is64, bool bigEndian)[] s_layouts = new[] { (false, false), (false, true), (true, false), (true, true) };
+
+        private static long s_modificationTime;
+
+        private int m_fileCount;
+
+        /// <summary>
+        /// Writes an executable with a loadable segment covering the whole file, then optionally PT_INTERP and PT_DYNAMIC segments whose
+        /// dynamic section lists <paramref name="needed"/> as DT_NEEDED entries. The dynamic section is last in the file.
+        /// </summary>
+        private static byte[] CreateElf(bool is64, bool bigEndian, bool hasInterpreter, params string[] needed)
+        {
+            const long BaseAddress = 0x400000;
+            bool hasDynamic = needed.Length > 0;
+            int headerSize = is64 ? 64 : 52;
+            int programHeaderSize = is64 ? 56 : 32;
+            int wordSize = is64 ? 8 : 4;
+            int programHeaderCount = 1 + (hasInterpreter ? 1 : 0) + (hasDynamic ? 1 : 0);
+
+            var interpreter = Encoding.ASCII.GetBytes(Interpreter + "\0");
+            var stringTable = new List<byte> { 0 };
+            var nameOffsets = new List<int>();
+            foreach (var name in needed)
+            {
+                nameOffsets.Add(stringTable.Count);
+                stringTable.AddRange(Encoding.ASCII.GetBytes(name + "\0"));
+            }
+
+            int interpreterOffset = headerSize + programHeaderSize * programHeaderCount;
+            int stringTableOffset = interpreterOffset + (hasInterpreter ? interpreter.Length : 0);
+            int dynamicOffset = (stringTableOffset + (hasDynamic ? stringTable.Count : 0) + 7) & ~7;
+            var dynamic = new List<(long tag, long value)>();
+            dynamic.AddRange(nameOffsets.Select(offset => (1L, (long)offset)));
+            dynamic.Add((5, BaseAddress + stringTableOffset));
+            dynamic.Add((10, stringTable.Count));
+            dynamic.Add((0, 0));
+            int dynamicSize = hasDynamic ? dynamic.Count * 2 * wordSize : 0;
+            int fileSize = dynamicOffset + dynamicSize;
+
+            var image = new byte[fileSize];
+            void Write(int offset, long value, int size)
+            {
+                for (int i = 0; i < size; i++)
+                {
+                    image[offset + (bigEndian ? size - 1 - i : i)] = (byte)(value >> (8 * i));
+                }
+            }
+
+            image[0] = 0x7F;
+            image[1] = (byte)'E';
+            image[2] = (byte)'L';
+            image[3] = (byte)'F';
+            image[4] = (byte)(is64 ? 2 : 1);
+            image[5] = (byte)(bigEndian ? 2 : 1);
+            image[6] = 1;
+            Write(16, 3, 2);                                            // e_type: ET_DYN
+            Write(18, is64 ? 62 : 3, 2);                                // e_machine
+            Write(20, 1, 4);                                            // e_version
+            Write(is64 ? 32 : 28, headerSize, wordSize);                // e_phoff
+            Write(is64 ? 52 : 40, headerSize, 2);                       // e_ehsize
+            Write(is64 ? 54 : 42, programHeaderSize, 2);                // e_phentsize
+            Write(is64 ? 56 : 44, programHeaderCount, 2);               // e_phnum
+
+            int header = headerSize;
+            void WriteProgramHeader(uint type, long offset, long size)
+            {
+                Write(header, type, 4);
+                Write(header + (is64 ? 8 : 4), offset, wordSize);           // p_offset
+                Write(header + (is64 ? 16 : 8), BaseAddress + offset, wordSize); // p_vaddr
+                Write(header + (is64 ? 32 : 16), size, wordSize);           // p_filesz
+                Write(header + (is64 ? 40 : 20), size, wordSize);           // p_memsz
+                header += programHeaderSize;
+            }
+
+            WriteProgramHeader(1, 0, fileSize);
+            if (hasInterpreter)
+            {
+                WriteProgramHeader(3, interpreterOffset, interpreter.Length);
+                interpreter.CopyTo(image, interpreterOffset);
+            }
+
+            if (hasDynamic)
+            {
+                WriteProgramHeader(2, dynamicOffset, dynamicSize);
+                stringTable.CopyTo(image, stringTableOffset);
+                for (int i = 0; i < dynamic.Count; i++)
+                {
+                    Write(dynamicOffset + i * 2 * wordSize, dynamic[i].tag, wordSize);
+                    Write(dynamicOffset + (i * 2 + 1) * wordSize, dynamic[i].value, wordSize);
+                }
+            }
+
+            return image;
+        }
+
+        private BinaryTraits Analyze(byte[] contents)
+        {
+            // The inode of a file deleted by a previous test can be reused, and timestamps are coarser than the time between two tests,
+            // so every file also gets a modification time of its own: the cached traits of a previous file never answer for this one
+            var path = GetFullPath($"binary{m_fileCount++}");
+            File.WriteAllBytes(path, contents);
+            File.SetLastWriteTimeUtc(path, new DateTime(2000, 1, 1, 0, 0, 0, DateTimeKind.Utc).AddSeconds(Interlocked.Increment(ref s_modificationTime)));
+            Assert.True(Instance.TryAnalyze(path, out var traits));
+            return traits;
+        }
+
+        [LinuxFact]
+        public void DynamicallyLinkedBinaries()
+        {
+            foreach (var (is64, bigEndian) in s_layouts)
+            {
+                var traits = Analyze(CreateElf(is64, bigEndian, hasInterpreter: true, "libpthread.so.0", "libc.so.6"));
+                Assert.Equal(BinaryTraits.Elf | BinaryTraits.HasInterpreter | BinaryTraits.NeedsLibc, traits);
+                Assert.False(IsStaticallyLinked(traits));
+                Assert.False(RequiresPTraceSandbox(traits));
+            }
+        }
+
+        [LinuxFact]
+        public void BinariesWithoutLibc()
+        {
+            foreach (var (is64, bigEndian) in s_layouts)
+            {
+                // Dynamic dependencies, but not on libc
+                var traits = Analyze(CreateElf(is64, bigEndian, hasInterpreter: true, "libm.so.6", "libcrypt.so.1"));
+                Assert.Equal(BinaryTraits.Elf | BinaryTraits.HasInterpreter, traits);
+                Assert.True(IsStaticallyLinked(traits));
+                Assert.True(RequiresPTraceSandbox(traits));
+
+                // No program interpreter and no dynamic section
+                traits = Analyze(CreateElf(is64, bigEndian, hasInterpreter: false));
+                Assert.Equal(BinaryTraits.Elf, traits);
+                Assert.True(IsStaticallyLinked(traits));
+            }
+        }
+
+        [LinuxFact]
+        public void TruncatedBinaries()
+        {
+            foreach (var (is64, bigEndian) in s_layouts)
+            {
+                var image = CreateElf(is64, bigEndian, hasInterpreter: true, "libc.so.6");
+                int headersSize = is64 ? 64 + 3 * 56 : 52 + 3 * 32;
+                for (int length = 0; length < image.Length; length++)
+                {
+                    // The dynamic section is last, so in any truncated image it ends past the end of the file
+                    var traits = Analyze(image.Take(length).ToArray());
+                    Assert.True((traits & BinaryTraits.NeedsLibc) == 0, $"{length} bytes of a {(is64 ? 64 : 32)}-bit image: {traits}");
+                    if (length < headersSize)
+                    {
+                        Assert.Equal(BinaryTraits.None, traits);
+                    }
+                }
+            }
+        }
+
+        [LinuxFact]
+        public void NonElfFiles()
+        {
+            var random = new Random(42);
+            var noise = new byte[4096];
+            random.NextBytes(noise);
+
+            var elfWithBadClass = CreateElf(true, false, hasInterpreter: true, "libc.so.6");
+            elfWithBadClass[4] = 3;
+
+            foreach (var contents in new[] { Array.Empty<byte>(), Encoding.ASCII.GetBytes("#!/bin/sh\necho libc.so.6\n"), noise, elfWithBadClass })
+            {
+                Assert.Equal(BinaryTraits.None, Analyze(contents));
+            }
+
+            // Not a regular file, or no file at all
+            Assert.False(Instance.TryAnalyze(TemporaryDirectory, out _));
+            Assert.False(Instance.TryAnalyze(GetFullPath("missing"), out _));
+            Assert.False(Instance.TryAnalyze(string.Empty, out _));
+        }
+
+        [LinuxFact]
+        public void BinariesReplacedInPlaceAreAnalyzedAgain()
+        {
+            var path = GetFullPath("replaced");
+            File.WriteAllBytes(path, CreateElf(true, false, hasInterpreter: true, "libc.so.6"));
+            Assert.False(Instance.IsBinaryStaticallyLinked(path));
+            var modified = File.GetLastWriteTimeUtc(path);
+
+            // Same inode and size, only the modification time tells the contents apart
+            using (var stream = new FileStream(path, FileMode.Open, FileAccess.Write))
+            {
+                var contents = CreateElf(true, false, hasInterpreter: true, "libm.so.6");
+                stream.Write(contents, 0, contents.Length);
+            }
+
+            File.SetLastWriteTimeUtc(path, modified.AddSeconds(1));
+            Assert.True(Instance.IsBinaryStaticallyLinked(path));
+        }
+    }
+}
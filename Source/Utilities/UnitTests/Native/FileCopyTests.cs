@@ -0,0 +1,217 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Threading;
+using System.Threading.Tasks;
+using BuildXL.Native.IO;
+using BuildXL.Native.IO.Unix;
+using Xunit;
+
+namespace Test.BuildXL.Native
+{
+    /// <summary>
+    /// Tests for the file copies of <see cref="FileUtilitiesUnix"/>, which copy in the kernel (FICLONE, copy_file_range, sendfile) when they can
+    /// and go through user space otherwise.
+    /// </summary>
+    public sealed class FileCopyTests : TemporaryDirectoryTestBase
+    {
+        private readonly FileUtilitiesUnix m_fileUtilities = new FileUtilitiesUnix();
+
+        private string WriteRandomFile(string relativePath, int size)
+        {
+            var contents = new byte[size];
+            new Random(size).NextBytes(contents);
+
+            string path = GetFullPath(relativePath);
+            File.WriteAllBytes(path, contents);
+            return path;
+        }
+
+        private static void AssertSameContents(string expectedPath, string actualPath)
+        {
+            Assert.True(File.ReadAllBytes(expectedPath).AsSpan().SequenceEqual(File.ReadAllBytes(actualPath)), $"'{actualPath}' differs from '{expectedPath}'");
+        }
+
+        [LinuxFact]
+        public async Task CopiesContentsAndMode()
+        {
+            foreach (int size in new[] { 0, 1, 4095, 4096, 3 << 20 })
+            {
+                string source = WriteRandomFile($"source{size}", size);
+                File.SetUnixFileMode(source, UnixFileMode.UserRead | UnixFileMode.UserWrite | UnixFileMode.UserExecute);
+                string destination = GetFullPath($"destination{size}");
+
+                Assert.True(await FileUtilities.CopyFileAsync(source, destination));
+
+                AssertSameContents(source, destination);
+                Assert.Equal(File.GetUnixFileMode(source), File.GetUnixFileMode(destination));
+            }
+        }
+
+        [LinuxFact]
+        public async Task ReplacesALongerDestination()
+        {
+            string source = WriteRandomFile("source", 100);
+            string destination = WriteRandomFile("destination", 10000);
+
+            Assert.True(await FileUtilities.CopyFileAsync(source, destination));
+
+            AssertSameContents(source, destination);
+        }
+
+        [LinuxFact]
+        public async Task CopiesProcFsFiles()
+        {
+            // procfs reports a size of 0 for files that have contents, which copy_file_range reads nothing from
+            string destination = GetFullPath("status");
+
+            Assert.True(await FileUtilities.CopyFileAsync("/proc/self/status", destination));
+
+            Assert.Contains("Name:", File.ReadAllText(destination));
+        }
+
+        [LinuxFact]
+        public async Task CopiesAcrossFileSystems()
+        {
+            if (!Directory.Exists("/dev/shm"))
+            {
+                return;
+            }
+
+            string source = WriteRandomFile("source", 1 << 20);
+            string destination = Path.Combine("/dev/shm", Guid.NewGuid().ToString());
+            try
+            {
+                Assert.True(await FileUtilities.CopyFileAsync(source, destination));
+                AssertSameContents(source, destination);
+            }
+            finally
+            {
+                File.Delete(destination);
+            }
+        }
+
+        [LinuxFact]
+        public async Task PredicateAndCompletion()
+        {
+            string source = WriteRandomFile("source", 100);
+            string destination = GetFullPath("destination");
+            File.WriteAllText(destination, "existing");
+
+            bool? destinationExisted = null;
+            Assert.False(await FileUtilities.CopyFileAsync(source, destination, predicate: (s, d) =>
+            {
+                destinationExisted = d != null;
+                return false;
+            }));
+            Assert.Equal(true, destinationExisted);
+            Assert.Equal("existing", File.ReadAllText(destination));
+
+            int completions = 0;
+            Assert.True(await FileUtilities.CopyFileAsync(source, destination, predicate: (s, d) => true, onCompletion: (s, d) => completions++));
+            Assert.Equal(1, completions);
+            AssertSameContents(source, destination);
+        }
+
+        [LinuxFact]
+        public void InKernelFileCopy()
+        {
+            foreach (int size in new[] { 0, 1, 4095, 3 << 20 })
+            {
+                string source = WriteRandomFile($"source{size}", size);
+                string destination = GetFullPath($"destination{size}");
+
+                var result = m_fileUtilities.InKernelFileCopy(source, destination, followSymlink: false);
+
+                Assert.True(result.Succeeded, result.Succeeded ? null : result.Failure.Describe());
+                AssertSameContents(source, destination);
+            }
+        }
+
+        [LinuxFact]
+        public void InKernelFileCopyOfProcFsFiles()
+        {
+            string destination = GetFullPath("status");
+
+            var result = m_fileUtilities.InKernelFileCopy("/proc/self/status", destination, followSymlink: false);
+
+            Assert.True(result.Succeeded, result.Succeeded ? null : result.Failure.Describe());
+            Assert.Contains("Name:", File.ReadAllText(destination));
+        }
+
+        [LinuxFact]
+        public void InKernelFileCopyOfAMissingSource()
+        {
+            var result = m_fileUtilities.InKernelFileCopy(GetFullPath("missing"), GetFullPath("destination"), followSymlink: false);
+
+            Assert.False(result.Succeeded);
+            Assert.False(File.Exists(GetFullPath("destination")));
+        }
+
+        [LinuxFact]
+        public void CloneFile()
+        {
+            string source = WriteRandomFile("source", 4095);
+            string destination = GetFullPath("destination");
+
+            // Only file systems that share extents (e.g., btrfs, xfs) can clone: elsewhere the destination must not be left behind
+            var result = m_fileUtilities.CloneFile(source, destination, followSymlink: false);
+            if (result.Succeeded)
+            {
+                AssertSameContents(source, destination);
+            }
+            else
+            {
+                Assert.False(File.Exists(destination));
+            }
+        }
+
+        [LinuxFact]
+        public async Task CopiesFilesConcurrently()
+        {
+            var copies = new List<(string source, string destination)>();
+            for (int i = 0; i < 100; i++)
+            {
+                WriteFile($"source{i}", new string('x', i * 100));
+                copies.Add((GetFullPath($"source{i}"), GetFullPath($"destination{i}")));
+            }
+
+            WriteFile("destination7", "existing");
+
+            int completions = 0;
+            bool[] copied = await FileUtilities.CopyFilesAsync(
+                copies,
+                predicate: (source, destination) => destination == null,
+                onCompletion: (source, destination) => Interlocked.Increment(ref completions),
+                maxConcurrentCopies: 8);
+
+            Assert.Equal(copies.Count, copied.Length);
+            Assert.Equal(Enumerable.Range(0, copies.Count).Select(i => i != 7).ToArray(), copied);
+            Assert.Equal(copies.Count - 1, completions);
+            Assert.Equal("existing", File.ReadAllText(GetFullPath("destination7")));
+            foreach (var (source, destination) in copies.Where((copy, i) => i != 7))
+            {
+                AssertSameContents(source, destination);
+            }
+        }
+
+        [LinuxFact]
+        public async Task CopyFilesCompletesOtherCopiesBeforeThrowing()
+        {
+            WriteFile("source", "x");
+
+            var exception = await Assert.ThrowsAsync<AggregateException>(() => FileUtilities.CopyFilesAsync(new[]
+            {
+                (GetFullPath("missing"), GetFullPath("destination0")),
+                (GetFullPath("source"), GetFullPath("destination1")),
+            }));
+
+            Assert.Single(exception.Flatten().InnerExceptions);
+            Assert.Equal("x", File.ReadAllText(GetFullPath("destination1")));
+        }
+    }
+}
@@ -0,0 +1,86 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System.IO;
+using BuildXL.Interop.Linux;
+using Xunit;
+
+namespace Test.BuildXL.Native
+{
+    /// <summary>
+    /// Tests for <see cref="IoUring"/>. Where the kernel or a seccomp profile doesn't allow io_uring, only the failure to create a ring is checked.
+    /// </summary>
+    public sealed class IoUringTests : TemporaryDirectoryTestBase
+    {
+        private const int EPERM = 1;
+
+        [LinuxFact]
+        public unsafe void ReadsAtOffsets()
+        {
+            string path = WriteFile("file", "0123456789");
+
+            int error = IoUring.Create(4, out IoUring ring);
+            if (error != 0)
+            {
+                Assert.Null(ring);
+                Assert.True(error == IoUring.ENOSYS || error == EPERM, $"Unexpected error creating an io_uring: {error}");
+                return;
+            }
+
+            using (ring)
+            using (var file = File.OpenHandle(path))
+            {
+                Assert.True(ring.SubmissionQueueSize >= 4);
+                Assert.Equal(2 * ring.SubmissionQueueSize, ring.CompletionQueueSize);
+
+                var first = new byte[4];
+                var second = new byte[4];
+                fixed (byte* firstBuffer = first)
+                fixed (byte* secondBuffer = second)
+                {
+                    int fd = file.DangerousGetHandle().ToInt32();
+                    Assert.Equal(0, ring.SubmitRead(fd, firstBuffer, 4, 2, userData: 1));
+                    Assert.Equal(0, ring.SubmitRead(fd, secondBuffer, 4, 8, userData: 2));
+
+                    int completed = 0;
+                    while (completed < 2)
+                    {
+                        Assert.Equal(0, ring.WaitForCompletions());
+                        while (ring.TryGetCompletion(out IoUring.Completion completion))
+                        {
+                            completed++;
+                            Assert.Equal(completion.UserData == 1 ? 4 : 2, completion.Result);
+                        }
+                    }
+                }
+
+                Assert.Equal("2345", System.Text.Encoding.ASCII.GetString(first));
+                Assert.Equal("89", System.Text.Encoding.ASCII.GetString(second, 0, 2));
+                Assert.False(ring.TryGetCompletion(out _));
+            }
+        }
+
+        [LinuxFact]
+        public unsafe void ReportsErrorsInCompletions()
+        {
+            if (IoUring.Create(4, out IoUring ring) != 0)
+            {
+                return;
+            }
+
+            using (ring)
+            {
+                var buffer = new byte[4];
+                fixed (byte* pinnedBuffer = buffer)
+                {
+                    // A descriptor that is not open: the failure is posted as -EBADF
+                    Assert.Equal(0, ring.SubmitRead(int.MaxValue, pinnedBuffer, 4, 0, userData: 7));
+                    Assert.Equal(0, ring.WaitForCompletions());
+                    Assert.True(ring.TryGetCompletion(out IoUring.Completion completion));
+                    Assert.Equal(7UL, completion.UserData);
+                    Assert.Equal(-9, completion.Result);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,23 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using BuildXL.Utilities.Core;
+using Xunit;
+
+namespace Test.BuildXL.Native
+{
+    /// <summary>
+    /// A test of code that only runs on Linux (procfs, cgroup v2, getdents64, io_uring...). It is skipped on other platforms.
+    /// </summary>
+    public sealed class LinuxFactAttribute : FactAttribute
+    {
+        /// <nodoc />
+        public LinuxFactAttribute()
+        {
+            if (!OperatingSystemHelper.IsLinuxOS)
+            {
+                Skip = "Requires Linux";
+            }
+        }
+    }
+}
@@ -0,0 +1,122 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using BuildXL.Interop.Linux;
+using Xunit;
+
+namespace Test.BuildXL.Native
+{
+    /// <summary>
+    /// Tests for the mountinfo parsing and the mount point matching of <see cref="MountTable"/>.
+    /// </summary>
+    public sealed class MountTableTests : TemporaryDirectoryTestBase
+    {
+        private const string MountInfo =
+            "22 1 8:1 / / rw,relatime shared:1 - ext4 /dev/sda1 rw\n" +
+            "23 22 0:21 / /proc rw,nosuid,nodev,noexec,relatime shared:12 - proc proc rw\n" +
+            "24 22 0:22 / /home rw,relatime - xfs /dev/sdb1 rw,attr2\n" +
+            "25 24 0:23 / /home/user/my\\040mount\\134dir rw,relatime shared:2 master:3 propagate_from:4 unbindable - tmpfs tmpfs rw\n" +
+            "26 22 0:24 / /tmp rw,relatime - tmpfs tmpfs rw\n" +
+            "27 22 0:25 / /tmp rw,relatime - overlay overlay rw";
+
+        private static MountTable.Snapshot Parse(string mountInfo, Dictionary<string, string> fileSystemTypes = null)
+            => MountTable.Parse(Encoding.UTF8.GetBytes(mountInfo), fileSystemTypes ?? new Dictionary<string, string>());
+
+        [Fact]
+        public void ParsesMountIds()
+        {
+            var snapshot = Parse(MountInfo);
+
+            Assert.Equal(6, snapshot.FileSystemTypeByMountId.Count);
+            Assert.Equal("ext4", snapshot.FileSystemTypeByMountId[22]);
+            Assert.Equal("proc", snapshot.FileSystemTypeByMountId[23]);
+            Assert.Equal("xfs", snapshot.FileSystemTypeByMountId[24]);
+            Assert.Equal("tmpfs", snapshot.FileSystemTypeByMountId[25]);
+            Assert.Equal("tmpfs", snapshot.FileSystemTypeByMountId[26]);
+
+            // The last line has no new line
+            Assert.Equal("overlay", snapshot.FileSystemTypeByMountId[27]);
+        }
+
+        [Fact]
+        public void ParsesMountPoints()
+        {
+            var snapshot = Parse(MountInfo);
+
+            Assert.Equal("ext4", snapshot.FileSystemTypeByMountPoint["/"]);
+            Assert.Equal("xfs", snapshot.FileSystemTypeByMountPoint["/home"]);
+
+            // Escaped space and backslash
+            Assert.Equal("tmpfs", snapshot.FileSystemTypeByMountPoint["/home/user/my mount\\dir"]);
+
+            // The later mount hides the earlier one
+            Assert.Equal("overlay", snapshot.FileSystemTypeByMountPoint["/tmp"]);
+        }
+
+        [Fact]
+        public void InternsFileSystemTypes()
+        {
+            var fileSystemTypes = new Dictionary<string, string>();
+            var first = Parse(MountInfo, fileSystemTypes);
+            var second = Parse(MountInfo, fileSystemTypes);
+
+            Assert.Same(first.FileSystemTypeByMountId[25], first.FileSystemTypeByMountId[26]);
+            Assert.Same(first.FileSystemTypeByMountId[22], second.FileSystemTypeByMountId[22]);
+        }
+
+        [Theory]
+        [InlineData("")]
+        [InlineData("\n\n")]
+        [InlineData("22 1 8:1 / / rw,relatime shared:1 ext4 /dev/sda1 rw")]
+        [InlineData("22 1 8:1 / / rw,relatime -")]
+        [InlineData("x22 1 8:1 / / rw,relatime - ext4 /dev/sda1 rw")]
+        [InlineData("22")]
+        public void SkipsMalformedLines(string line)
+        {
+            var snapshot = Parse(line + "\n24 22 0:22 / /home rw,relatime - xfs /dev/sdb1 rw\n");
+
+            Assert.Equal("xfs", Assert.Single(snapshot.FileSystemTypeByMountId).Value);
+            Assert.Equal("/home", Assert.Single(snapshot.FileSystemTypeByMountPoint).Key);
+        }
+
+        [Theory]
+        [InlineData("/", "ext4")]
+        [InlineData("/etc/hosts", "ext4")]
+        [InlineData("/home", "xfs")]
+        [InlineData("/home/user/file", "xfs")]
+        [InlineData("/homes/file", "ext4")]
+        [InlineData("/home/user/my mount\\dir/file", "tmpfs")]
+        [InlineData("/home/user/my mount", "xfs")]
+        [InlineData("/proc/self/status", "proc")]
+        public void MatchesLongestMountPoint(string path, string expectedType)
+        {
+            Assert.Equal(expectedType, MountTable.GetFileSystemTypeByPath(Parse(MountInfo), path));
+        }
+
+        [Fact]
+        public void NoMountPointMatches()
+        {
+            var snapshot = Parse("24 22 0:22 / /home rw,relatime - xfs /dev/sdb1 rw\n");
+            Assert.Equal(MountTable.UnknownFileSystemType, MountTable.GetFileSystemTypeByPath(snapshot, "/etc/hosts"));
+        }
+
+        [LinuxFact]
+        public void GetsFileSystemTypesOfOpenFiles()
+        {
+            using (var stream = new FileStream("/proc/self/status", FileMode.Open, FileAccess.Read))
+            {
+                Assert.Equal("proc", MountTable.Instance.GetFileSystemType(stream.SafeFileHandle));
+            }
+
+            using (var stream = new FileStream(WriteFile("file", "contents"), FileMode.Open, FileAccess.Read))
+            {
+                var type = MountTable.Instance.GetFileSystemType(stream.SafeFileHandle);
+                Assert.NotNull(type);
+                Assert.NotEqual(MountTable.UnknownFileSystemType, type);
+            }
+        }
+    }
+}
@@ -0,0 +1,155 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Generic;
+using System.Text;
+using BuildXL.Interop.Linux;
+using Xunit;
+using static BuildXL.Interop.Unix.Process;
+
+namespace Test.BuildXL.Native
+{
+    /// <summary>
+    /// Tests for the procfs parsers of <see cref="ProcFs"/>.
+    /// </summary>
+    public sealed class ProcFsTests
+    {
+        // Fields 3 to 22 (state to starttime) of proc(5), then the rest of the line
+        private const string StatFields = "S 1234 5678 5678 0 -1 4194304 1000 0 0 0 250 125 0 0 20 0 1 0 987654 12345678 500 18446744073709551615 1 1 0 0 0 0 0 4096 0 0 0 17 3 0 0 0 0 0\n";
+
+        private const string Io =
+            "rchar: 123456\n" +
+            "wchar: 654321\n" +
+            "syscr: 100\n" +
+            "syscw: 200\n" +
+            "read_bytes: 4096\n" +
+            "write_bytes: 8192\n" +
+            "cancelled_write_bytes: 0\n";
+
+        private const string Status =
+            "Name:\tbash\n" +
+            "State:\tS (sleeping)\n" +
+            "VmPeak:\t   10000 kB\n" +
+            "VmHWM:\t    4000 kB\n" +
+            "VmRSS:\t    3000 kB\n" +
+            "Threads:\t1\n";
+
+        private static byte[] Bytes(string text) => Encoding.ASCII.GetBytes(text);
+
+        [Theory]
+        [InlineData("bash")]
+        [InlineData("")]
+        [InlineData("my process")]
+        [InlineData("a) S 1 2 (b")]
+        [InlineData(")")]
+        public void ParsesStat(string name)
+        {
+            Assert.True(ProcFs.TryParseStat(Bytes("4321 (" + name + ") " + StatFields), out var info, out var parsedName));
+
+            Assert.Equal(name, Encoding.ASCII.GetString(parsedName.ToArray()));
+            Assert.Equal(1234, info.ParentProcessId);
+            Assert.Equal(250UL, info.UserTimeTicks);
+            Assert.Equal(125UL, info.SystemTimeTicks);
+            Assert.Equal(987654UL, info.StartTimeTicks);
+        }
+
+        [Fact]
+        public void ParsesStatEndingAtStartTime()
+        {
+            Assert.True(ProcFs.TryParseStat(Bytes("1 (init) S 0 1 1 0 -1 0 0 0 0 0 7 8 0 0 20 0 1 0 42"), out var info, out _));
+            Assert.Equal(0, info.ParentProcessId);
+            Assert.Equal(7UL, info.UserTimeTicks);
+            Assert.Equal(8UL, info.SystemTimeTicks);
+            Assert.Equal(42UL, info.StartTimeTicks);
+        }
+
+        [Theory]
+        [InlineData("")]
+        [InlineData("4321 bash S 1234")]
+        [InlineData("4321 (bash S 1234 5678")]
+        [InlineData("4321 (bash) S 1234 5678 5678 0 -1 4194304 1000 0 0 0 250 125 0 0 20 0 1 0")]
+        [InlineData("4321 (bash) S x 5678 5678 0 -1 4194304 1000 0 0 0 250 125 0 0 20 0 1 0 987654 1")]
+        [InlineData("4321 (bash) S 1234 5678 5678 0 -1 4194304 1000 0 0 0 -250 125 0 0 20 0 1 0 987654 1")]
+        [InlineData("4321 (bash) S 1234 5678 5678 0 -1 4194304 1000 0 0 0 250 125 0 0 20 0 1 0 98x654 1")]
+        public void RejectsMalformedStat(string stat)
+        {
+            Assert.False(ProcFs.TryParseStat(Bytes(stat), out _, out _));
+        }
+
+        [Fact]
+        public void ParsesIo()
+        {
+            var usage = default(ProcessResourceUsage);
+            Assert.True(ProcFs.TryParseIo(Bytes(Io), ref usage));
+
+            Assert.Equal(100UL, usage.DiskReadOps);
+            Assert.Equal(200UL, usage.DiskWriteOps);
+            Assert.Equal(4096UL, usage.DiskBytesRead);
+            Assert.Equal(8192UL, usage.DiskBytesWritten);
+        }
+
+        [Fact]
+        public void RejectsIncompleteIo()
+        {
+            // E.g., a file cut short, or denied fields
+            var usage = default(ProcessResourceUsage);
+            Assert.False(ProcFs.TryParseIo(Bytes(Io.Substring(0, Io.IndexOf("write_bytes", StringComparison.Ordinal))), ref usage));
+            Assert.False(ProcFs.TryParseIo(Bytes(Io.Replace("syscr: 100", "syscr: ")), ref usage));
+            Assert.False(ProcFs.TryParseIo(ReadOnlySpan<byte>.Empty, ref usage));
+        }
+
+        [Fact]
+        public void ParsesStatus()
+        {
+            var usage = default(ProcessResourceUsage);
+            ProcFs.ParseStatus(Bytes(Status), ref usage);
+
+            Assert.Equal(3000UL * 1024, usage.WorkingSetSize);
+            Assert.Equal(4000UL * 1024, usage.PeakWorkingSetSize);
+        }
+
+        [Fact]
+        public void StatusWithoutMemory()
+        {
+            // Zombies and kernel threads have no Vm* lines
+            var usage = new ProcessResourceUsage { WorkingSetSize = 1, PeakWorkingSetSize = 2 };
+            ProcFs.ParseStatus(Bytes("Name:\tkthreadd\nState:\tS (sleeping)\nThreads:\t1\n"), ref usage);
+
+            Assert.Equal(0UL, usage.WorkingSetSize);
+            Assert.Equal(0UL, usage.PeakWorkingSetSize);
+        }
+
+        [LinuxFact]
+        public void ReadsFilesOfThisProcess()
+        {
+            int pid = Environment.ProcessId;
+            Span<byte> buffer = stackalloc byte[ProcFs.BufferSize];
+
+            int length = ProcFs.ReadProcessFile(pid, ProcFs.ProcessFile.Stat, buffer);
+            Assert.True(length > 0);
+            Assert.True(ProcFs.TryParseStat(buffer.Slice(0, length), out var info, out _));
+            Assert.True(info.ParentProcessId > 0);
+            Assert.True(info.StartTimeTicks > 0);
+
+            length = ProcFs.ReadProcessFile(pid, ProcFs.ProcessFile.Status, buffer);
+            Assert.True(length > 0);
+            var usage = default(ProcessResourceUsage);
+            ProcFs.ParseStatus(buffer.Slice(0, length), ref usage);
+            Assert.True(usage.WorkingSetSize > 0);
+            Assert.True(usage.PeakWorkingSetSize >= usage.WorkingSetSize);
+
+            var pids = new List<int> { -1 };
+            Assert.True(ProcFs.ListProcessIds(pids));
+            Assert.Contains(pid, pids);
+            Assert.DoesNotContain(-1, pids);
+        }
+
+        [LinuxFact]
+        public void ReadingFilesOfAMissingProcessFails()
+        {
+            Span<byte> buffer = stackalloc byte[ProcFs.BufferSize];
+            Assert.Equal(-1, ProcFs.ReadProcessFile(int.MaxValue, ProcFs.ProcessFile.Stat, buffer));
+        }
+    }
+}
@@ -0,0 +1,55 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.IO;
+
+namespace Test.BuildXL.Native
+{
+    /// <summary>
+    /// Base class for tests that work in a directory of their own, created before each test and deleted after it.
+    /// </summary>
+    public abstract class TemporaryDirectoryTestBase : IDisposable
+    {
+        /// <nodoc />
+        protected TemporaryDirectoryTestBase()
+        {
+            TemporaryDirectory = Path.Combine(Path.GetTempPath(), "Test.BuildXL.Native", Guid.NewGuid().ToString("N"));
+            Directory.CreateDirectory(TemporaryDirectory);
+        }
+
+        /// <summary>
+        /// The directory of the running test.
+        /// </summary>
+        protected string TemporaryDirectory { get; }
+
+        /// <summary>
+        /// Path of <paramref name="relativePath"/> under <see cref="TemporaryDirectory"/>.
+        /// </summary>
+        protected string GetFullPath(string relativePath) => Path.Combine(TemporaryDirectory, relativePath);
+
+        /// <summary>
+        /// Writes <paramref name="contents"/> to <paramref name="relativePath"/>, creating its parent directories, and returns its full path.
+        /// </summary>
+        protected string WriteFile(string relativePath, string contents)
+        {
+            var path = GetFullPath(relativePath);
+            Directory.CreateDirectory(Path.GetDirectoryName(path));
+            File.WriteAllText(path, contents);
+            return path;
+        }
+
+        /// <nodoc />
+        public virtual void Dispose()
+        {
+            try
+            {
+                Directory.Delete(TemporaryDirectory, recursive: true);
+            }
+            catch (Exception e) when (e is IOException || e is UnauthorizedAccessException)
+            {
+                // Best effort: the directory is under the temp directory
+            }
+        }
+    }
+}
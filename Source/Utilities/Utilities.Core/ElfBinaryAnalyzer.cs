@@ -0,0 +1,423 @@
+﻿// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Buffers.Binary;
+using System.Collections.Concurrent;
+using System.IO;
+using BuildXL.Interop.Unix;
+using Microsoft.Win32.SafeHandles;
+
+namespace BuildXL.Utilities.Core;
+
+/// <summary>
+/// Classifies Linux binaries by reading their ELF program headers and extended attributes in-process, as a replacement for
+/// running objdump (<see cref="UnixObjectFileDumpUtils"/>) and getcap (<see cref="UnixGetCapUtils"/>) on them.
+/// </summary>
+/// <remarks>
+/// Results are cached by the identity of the file contents as the filesystem sees them (device, inode, modification time and size), so
+/// a binary replaced in place is analyzed again even if it keeps its timestamp (e.g. when it is deployed from cache).
+/// The cache is not persisted: a build analyzes each binary it launches at most once, and reading the headers costs a few reads.
+/// All operations are thread-safe.
+/// </remarks>
+public sealed class ElfBinaryAnalyzer
+{
+    /// <summary>
+    /// What the analysis of a binary found.
+    /// </summary>
+    [Flags]
+    public enum BinaryTraits : byte
+    {
+        /// <nodoc/>
+        None = 0,
+
+        /// <summary>The file is an ELF object that could be parsed.</summary>
+        Elf = 1 << 0,
+
+        /// <summary>The binary has a program interpreter (PT_INTERP), i.e., it is loaded by the dynamic linker.</summary>
+        HasInterpreter = 1 << 1,
+
+        /// <summary>The binary depends on libc dynamically (a DT_NEEDED entry for libc.so.*), so libc calls can be interposed with LD_PRELOAD.</summary>
+        NeedsLibc = 1 << 2,
+
+        /// <summary>The file has capabilities set (the 'security.capability' extended attribute), so the loader ignores LD_PRELOAD for it.</summary>
+        HasCapabilities = 1 << 3,
+    }
+
+    /// <summary>
+    /// Identity of the contents of a file.
+    /// </summary>
+    private readonly record struct FileIdentity(long Device, ulong Inode, long ModificationTime, long ModificationTimeNsec, long Size);
+
+    // ELF constants (see elf.h)
+    private const byte ElfClass32 = 1;
+    private const byte ElfClass64 = 2;
+    private const byte ElfDataBigEndian = 2;
+    private const uint PT_LOAD = 1;
+    private const uint PT_DYNAMIC = 2;
+    private const uint PT_INTERP = 3;
+    private const long DT_NULL = 0;
+    private const long DT_NEEDED = 1;
+    private const long DT_STRTAB = 5;
+    private const long DT_STRSZ = 10;
+
+    /// <summary>
+    /// Size of the smallest ELF header (32-bit).
+    /// </summary>
+    private const int MinimumElfHeaderSize = 52;
+
+    private const string CapabilityAttributeName = "security.capability";
+    private const string LibcNamePrefix = "libc.so.";
+
+    private const int ReadBufferSize = 4096;
+
+    private readonly ConcurrentDictionary<FileIdentity, BinaryTraits> m_cache = new();
+
+    /// <nodoc/>
+    public static ElfBinaryAnalyzer Instance { get; } = new();
+
+    private ElfBinaryAnalyzer()
+    {
+    }
+
+    /// <summary>
+    /// Number of binaries whose traits are cached.
+    /// </summary>
+    public int CachedCount => m_cache.Count;
+
+    /// <summary>
+    /// Whether a binary with the given traits links libc statically (or does not link it at all), so that libc calls can't be interposed.
+    /// </summary>
+    /// <remarks>
+    /// Matches what objdump based detection used to report: an ELF binary without a dynamic dependency on libc.
+    /// </remarks>
+    public static bool IsStaticallyLinked(BinaryTraits traits) => (traits & BinaryTraits.Elf) != 0 && (traits & BinaryTraits.NeedsLibc) == 0;
+
+    /// <summary>
+    /// Whether processes running a binary with the given traits can't be interposed with LD_PRELOAD.
+    /// </summary>
+    public static bool RequiresPTraceSandbox(BinaryTraits traits) => IsStaticallyLinked(traits) || (traits & BinaryTraits.HasCapabilities) != 0;
+
+    /// <summary>
+    /// Returns true if the provided binary statically links libc.
+    /// </summary>
+    public bool IsBinaryStaticallyLinked(string binaryPath) => TryAnalyze(binaryPath, out var traits) && IsStaticallyLinked(traits);
+
+    /// <summary>
+    /// Returns true if the provided binary has any capabilities set.
+    /// </summary>
+    public bool BinaryContainsCapabilities(string binaryPath) => TryAnalyze(binaryPath, out var traits) && (traits & BinaryTraits.HasCapabilities) != 0;
+
+    /// <summary>
+    /// Analyzes the regular file at <paramref name="binaryPath"/> (following symlinks), or returns its cached traits.
+    /// Returns false if the file can't be opened or is not a regular file, and always on platforms other than Linux.
+    /// </summary>
+    public bool TryAnalyze(string binaryPath, out BinaryTraits traits)
+    {
+        traits = BinaryTraits.None;
+        if (!OperatingSystemHelper.IsLinuxOS || string.IsNullOrEmpty(binaryPath))
+        {
+            return false;
+        }
+
+        using SafeFileHandle handle = IO.Open(binaryPath, IO.OpenFlags.O_RDONLY | IO.OpenFlags.O_CLOEXEC, 0);
+        if (handle.IsInvalid)
+        {
+            return false;
+        }
+
+        // Stat the open file rather than the path, so the identity is the one of the contents that get analyzed.
+        var stat = new IO.StatBuffer();
+        if (IO.StatFileDescriptor(handle, ref stat) != 0 || (stat.Mode & (ushort)IO.FilePermissions.S_IFMT) != (ushort)IO.FilePermissions.S_IFREG)
+        {
+            return false;
+        }
+
+        var identity = new FileIdentity(stat.DeviceID, stat.InodeNumber, stat.TimeLastModification, stat.TimeNSecLastModification, stat.Size);
+        if (m_cache.TryGetValue(identity, out traits))
+        {
+            return true;
+        }
+
+        traits = ReadElfTraits(handle, stat.Size);
+
+        // A negative result means the attribute is not there (ENODATA) or extended attributes are not supported by the filesystem.
+        if (IO.GetXattrSize(handle, CapabilityAttributeName) > 0)
+        {
+            traits |= BinaryTraits.HasCapabilities;
+        }
+
+        m_cache.TryAdd(identity, traits);
+        return true;
+    }
+
+    /// <summary>
+    /// Reads the program headers (and, for dynamically linked binaries, the dynamic section) of the file open as <paramref name="handle"/>.
+    /// </summary>
+    private static BinaryTraits ReadElfTraits(SafeFileHandle handle, long size)
+    {
+        if (size < MinimumElfHeaderSize)
+        {
+            return BinaryTraits.None;
+        }
+
+        try
+        {
+            // The stream must not close the handle: the caller still needs it.
+            // The file is read rather than mapped: a mapped file that gets truncated by another process faults (SIGBUS) instead of failing the read.
+            // The headers are usually within the first page, so the stream buffer serves most of the reads.
+            using var stream = new FileStream(new SafeFileHandle(handle.DangerousGetHandle(), ownsHandle: false), FileAccess.Read, bufferSize: ReadBufferSize);
+
+            return new ElfReader(stream, size).ReadTraits();
+        }
+        catch (Exception e) when (e is IOException || e is UnauthorizedAccessException)
+        {
+            // E.g. the file was truncated while being read (EndOfStreamException)
+            return BinaryTraits.None;
+        }
+    }
+
+    /// <summary>
+    /// Bounds-checked reads of the ELF structures of a file, in the byte order and word size of the file.
+    /// </summary>
+    private readonly struct ElfReader
+    {
+        private readonly FileStream m_stream;
+        private readonly byte[] m_scratch;
+        private readonly long m_size;
+        private readonly bool m_is64;
+        private readonly bool m_bigEndian;
+
+        public ElfReader(FileStream stream, long size)
+        {
+            m_stream = stream;
+            m_scratch = new byte[Math.Max(sizeof(ulong), LibcNamePrefix.Length)];
+            m_size = size;
+            m_is64 = false;
+            m_bigEndian = false;
+            m_is64 = ReadByte(4) == ElfClass64;
+            m_bigEndian = ReadByte(5) == ElfDataBigEndian;
+        }
+
+        /// <summary>
+        /// Reads <paramref name="count"/> bytes at <paramref name="offset"/> into the scratch buffer. Throws <see cref="EndOfStreamException"/> if the file
+        /// got shorter than <see cref="m_size"/>.
+        /// </summary>
+        private byte[] Read(long offset, int count)
+        {
+            m_stream.Position = offset;
+            int total = 0;
+            while (total < count)
+            {
+                int read = m_stream.Read(m_scratch, total, count - total);
+                if (read == 0)
+                {
+                    throw new EndOfStreamException();
+                }
+
+                total += read;
+            }
+
+            return m_scratch;
+        }
+
+        private byte ReadByte(long offset) => Read(offset, 1)[0];
+
+        private bool IsElf()
+        {
+            var ident = Read(0, 5);
+            return ident[0] == 0x7F && ident[1] == (byte)'E' && ident[2] == (byte)'L' && ident[3] == (byte)'F'
+                && (ident[4] == ElfClass32 || ident[4] == ElfClass64);
+        }
+
+        private bool InRange(long offset, long length) => offset >= 0 && length >= 0 && offset <= m_size && length <= m_size - offset;
+
+        private ushort U16(long offset)
+        {
+            var bytes = Read(offset, sizeof(ushort));
+            return m_bigEndian ? BinaryPrimitives.ReadUInt16BigEndian(bytes) : BinaryPrimitives.ReadUInt16LittleEndian(bytes);
+        }
+
+        private uint U32(long offset)
+        {
+            var bytes = Read(offset, sizeof(uint));
+            return m_bigEndian ? BinaryPrimitives.ReadUInt32BigEndian(bytes) : BinaryPrimitives.ReadUInt32LittleEndian(bytes);
+        }
+
+        private ulong U64(long offset)
+        {
+            var bytes = Read(offset, sizeof(ulong));
+            return m_bigEndian ? BinaryPrimitives.ReadUInt64BigEndian(bytes) : BinaryPrimitives.ReadUInt64LittleEndian(bytes);
+        }
+
+        /// <summary>
+        /// Reads an address, offset or size field (Elf32_Addr/Elf64_Addr and friends). Values that don't fit a long are returned as -1,
+        /// which fails every bounds check.
+        /// </summary>
+        private long Word(long offset)
+        {
+            if (!m_is64)
+            {
+                return U32(offset);
+            }
+
+            ulong value = U64(offset);
+            return value > long.MaxValue ? -1 : (long)value;
+        }
+
+        public BinaryTraits ReadTraits()
+        {
+            if (!IsElf())
+            {
+                return BinaryTraits.None;
+            }
+
+            // e_phoff, e_phentsize and e_phnum
+            long programHeadersOffset = Word(m_is64 ? 0x20 : 0x1C);
+            int programHeaderSize = U16(m_is64 ? 0x36 : 0x2A);
+            int programHeaderCount = U16(m_is64 ? 0x38 : 0x2C);
+            int minimumProgramHeaderSize = m_is64 ? 56 : 32;
+            if (programHeaderCount == 0)
+            {
+                // No segments to load: nothing the dynamic linker would handle
+                return BinaryTraits.Elf;
+            }
+
+            if (programHeaderSize < minimumProgramHeaderSize || !InRange(programHeadersOffset, (long)programHeaderSize * programHeaderCount))
+            {
+                // Malformed: not a binary that would run
+                return BinaryTraits.None;
+            }
+
+            var traits = BinaryTraits.Elf;
+            long dynamicOffset = -1;
+            long dynamicSize = 0;
+            for (int i = 0; i < programHeaderCount; i++)
+            {
+                long header = programHeadersOffset + (long)i * programHeaderSize;
+                uint type = U32(header);
+                if (type == PT_INTERP)
+                {
+                    traits |= BinaryTraits.HasInterpreter;
+                }
+                else if (type == PT_DYNAMIC)
+                {
+                    // p_offset and p_filesz
+                    dynamicOffset = Word(header + (m_is64 ? 8 : 4));
+                    dynamicSize = Word(header + (m_is64 ? 32 : 16));
+                }
+            }
+
+            if (dynamicOffset >= 0 && InRange(dynamicOffset, dynamicSize) && NeedsLibc(programHeadersOffset, programHeaderSize, programHeaderCount, dynamicOffset, dynamicSize))
+            {
+                traits |= BinaryTraits.NeedsLibc;
+            }
+
+            return traits;
+        }
+
+        /// <summary>
+        /// Whether the dynamic section has a DT_NEEDED entry naming libc.
+        /// </summary>
+        private bool NeedsLibc(long programHeadersOffset, int programHeaderSize, int programHeaderCount, long dynamicOffset, long dynamicSize)
+        {
+            int entrySize = m_is64 ? 16 : 8;
+            int tagSize = entrySize / 2;
+
+            // The names of the dependencies are offsets into the string table, which is only located after the whole section was read.
+            long stringTableAddress = -1;
+            long stringTableSize = -1;
+            int neededCount = 0;
+            for (long entry = dynamicOffset; entry + entrySize <= dynamicOffset + dynamicSize; entry += entrySize)
+            {
+                long tag = Word(entry);
+                if (tag == DT_NULL)
+                {
+                    break;
+                }
+
+                if (tag == DT_NEEDED)
+                {
+                    neededCount++;
+                }
+                else if (tag == DT_STRTAB)
+                {
+                    stringTableAddress = Word(entry + tagSize);
+                }
+                else if (tag == DT_STRSZ)
+                {
+                    stringTableSize = Word(entry + tagSize);
+                }
+            }
+
+            if (neededCount == 0 || stringTableAddress < 0)
+            {
+                return false;
+            }
+
+            // DT_STRTAB is a virtual address: find the file offset of the loadable segment that contains it
+            long stringTableOffset = -1;
+            for (int i = 0; i < programHeaderCount && stringTableOffset < 0; i++)
+            {
+                long header = programHeadersOffset + (long)i * programHeaderSize;
+                if (U32(header) != PT_LOAD)
+                {
+                    continue;
+                }
+
+                long segmentOffset = Word(header + (m_is64 ? 8 : 4));
+                long segmentAddress = Word(header + (m_is64 ? 16 : 8));
+                long segmentFileSize = Word(header + (m_is64 ? 32 : 16));
+                if (segmentAddress >= 0 && stringTableAddress >= segmentAddress && stringTableAddress - segmentAddress < segmentFileSize)
+                {
+                    stringTableOffset = segmentOffset + (stringTableAddress - segmentAddress);
+                }
+            }
+
+            if (stringTableOffset < 0 || !InRange(stringTableOffset, 0))
+            {
+                return false;
+            }
+
+            long stringTableEnd = stringTableSize >= 0 && InRange(stringTableOffset, stringTableSize) ? stringTableOffset + stringTableSize : m_size;
+            for (long entry = dynamicOffset; entry + entrySize <= dynamicOffset + dynamicSize; entry += entrySize)
+            {
+                long tag = Word(entry);
+                if (tag == DT_NULL)
+                {
+                    break;
+                }
+
+                if (tag == DT_NEEDED)
+                {
+                    long nameOffset = Word(entry + tagSize);
+                    if (nameOffset >= 0 && StartsWith(stringTableOffset + nameOffset, stringTableEnd, LibcNamePrefix))
+                    {
+                        return true;
+                    }
+                }
+            }
+
+            return false;
+        }
+
+        private bool StartsWith(long offset, long end, string prefix)
+        {
+            if (offset < 0 || offset + prefix.Length > end)
+            {
+                return false;
+            }
+
+            var bytes = Read(offset, prefix.Length);
+            for (int i = 0; i < prefix.Length; i++)
+            {
+                if (bytes[i] != (byte)prefix[i])
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+    }
+}
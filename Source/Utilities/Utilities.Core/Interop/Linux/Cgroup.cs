@@ -0,0 +1,278 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.IO;
+using System.Text;
+
+namespace BuildXL.Interop.Linux
+{
+    /// <summary>
+    /// Access to cgroup v2 (unified hierarchy) directories: creating them, moving processes into them and reading their resource counters.
+    /// </summary>
+    /// <remarks>
+    /// The counters of a cgroup are aggregated by the kernel over all the processes it ever contained, including those that already exited,
+    /// so reading them costs a few small reads regardless of the number of processes. The files are parsed in place, in a buffer provided by the caller.
+    /// </remarks>
+    public static class Cgroup
+    {
+        /// <summary>
+        /// Aggregate resource usage of a cgroup.
+        /// </summary>
+        public struct Usage
+        {
+            /// <summary>User time in microseconds ('user_usec' in cpu.stat).</summary>
+            public ulong UserTimeUs;
+
+            /// <summary>System time in microseconds ('system_usec' in cpu.stat).</summary>
+            public ulong SystemTimeUs;
+
+            /// <summary>
+            /// Memory mapped by the processes of the cgroup: anonymous memory plus mapped file pages ('anon' + 'file_mapped' in memory.stat).
+            /// </summary>
+            /// <remarks>
+            /// This is the closest to the working set of the processes. memory.current is not used as it also counts the page cache charged
+            /// to the cgroup (the files the processes read or wrote), which is reclaimable and typically much larger.
+            /// </remarks>
+            public ulong MemoryCurrentBytes;
+
+            /// <summary>
+            /// Highest <see cref="MemoryCurrentBytes"/> read so far. memory.peak is not used as it includes the page cache (see <see cref="MemoryCurrentBytes"/>),
+            /// so the peak is only as good as the sampling.
+            /// </summary>
+            public ulong MemoryPeakBytes;
+
+            /// <summary>Read operations, summed over devices ('rios' in io.stat).</summary>
+            public ulong ReadOps;
+
+            /// <summary>Bytes read, summed over devices ('rbytes' in io.stat).</summary>
+            public ulong ReadBytes;
+
+            /// <summary>Write operations, summed over devices ('wios' in io.stat).</summary>
+            public ulong WriteOps;
+
+            /// <summary>Bytes written, summed over devices ('wbytes' in io.stat).</summary>
+            public ulong WriteBytes;
+        }
+
+        /// <summary>
+        /// Buffer size that fits the files read by <see cref="TryReadUsage"/>.
+        /// </summary>
+        public const int UsageBufferSize = 16 * 1024;
+
+        private static readonly byte[] s_userUsec = Encoding.ASCII.GetBytes("user_usec");
+        private static readonly byte[] s_systemUsec = Encoding.ASCII.GetBytes("system_usec");
+        private static readonly byte[] s_anon = Encoding.ASCII.GetBytes("anon");
+        private static readonly byte[] s_fileMapped = Encoding.ASCII.GetBytes("file_mapped");
+        private static readonly byte[] s_rbytes = Encoding.ASCII.GetBytes("rbytes");
+        private static readonly byte[] s_wbytes = Encoding.ASCII.GetBytes("wbytes");
+        private static readonly byte[] s_rios = Encoding.ASCII.GetBytes("rios");
+        private static readonly byte[] s_wios = Encoding.ASCII.GetBytes("wios");
+
+        /// <summary>
+        /// Whether <paramref name="path"/> is a directory of a cgroup v2 hierarchy.
+        /// </summary>
+        public static bool IsCgroup2Directory(string path) => File.Exists(Path.Combine(path, "cgroup.controllers"));
+
+        /// <summary>
+        /// Enables <paramref name="controllers"/> for the children of cgroup <paramref name="path"/> (best effort), and returns the ones
+        /// that are enabled afterwards, as listed by 'cgroup.subtree_control'.
+        /// </summary>
+        /// <remarks>
+        /// Enabling a controller fails when the parent of <paramref name="path"/> does not have it enabled, or when the cgroup itself
+        /// contains processes (other than for the root cgroup).
+        /// </remarks>
+        public static string[] EnableControllers(string path, string[] controllers)
+        {
+            var subtreeControl = Path.Combine(path, "cgroup.subtree_control");
+            foreach (var controller in controllers)
+            {
+                try
+                {
+                    // One controller at a time: a single failing controller makes the whole write fail
+                    File.WriteAllText(subtreeControl, "+" + controller);
+                }
+                catch (Exception e) when (e is IOException || e is UnauthorizedAccessException)
+                {
+                    // Reported through the returned list
+                }
+            }
+
+            try
+            {
+                return File.ReadAllText(subtreeControl).Split(new[] { ' ', '\n' }, StringSplitOptions.RemoveEmptyEntries);
+            }
+            catch (Exception e) when (e is IOException || e is UnauthorizedAccessException)
+            {
+                return Array.Empty<string>();
+            }
+        }
+
+        /// <summary>
+        /// Moves process <paramref name="pid"/> (with all its threads) into cgroup <paramref name="path"/>. Processes it forks from then on
+        /// start in that cgroup.
+        /// </summary>
+        /// <returns>Whether the process was moved. The move fails if the process does not exist anymore, or if this process is not allowed to move it.</returns>
+        public static bool TryMoveProcess(string path, int pid)
+        {
+            try
+            {
+                File.WriteAllText(Path.Combine(path, "cgroup.procs"), pid.ToString());
+                return true;
+            }
+            catch (Exception e) when (e is IOException || e is UnauthorizedAccessException)
+            {
+                return false;
+            }
+        }
+
+        /// <summary>
+        /// Reads the counters of cgroup <paramref name="path"/> into <paramref name="usage"/>, using <paramref name="buffer"/> (see <see cref="UsageBufferSize"/>)
+        /// to read the files.
+        /// </summary>
+        /// <remarks>
+        /// Peak values are only ever raised, so that passing the result of the previous call keeps the highest values observed. Returns false, leaving <paramref name="usage"/> unchanged, if the cgroup does not exist anymore or lacks the 'memory'
+        /// or 'io' controller.
+        /// </remarks>
+        public static bool TryReadUsage(string path, byte[] buffer, ref Usage usage)
+        {
+            var result = usage;
+
+            int length = ReadFile(Path.Combine(path, "cpu.stat"), buffer);
+            if (length < 0
+                || !TryFindValue(buffer, length, s_userUsec, out result.UserTimeUs)
+                || !TryFindValue(buffer, length, s_systemUsec, out result.SystemTimeUs))
+            {
+                return false;
+            }
+
+            length = ReadFile(Path.Combine(path, "memory.stat"), buffer);
+            if (length < 0
+                || !TryFindValue(buffer, length, s_anon, out var anon)
+                || !TryFindValue(buffer, length, s_fileMapped, out var fileMapped))
+            {
+                return false;
+            }
+
+            result.MemoryCurrentBytes = anon + fileMapped;
+            result.MemoryPeakBytes = Math.Max(result.MemoryPeakBytes, result.MemoryCurrentBytes);
+
+            // io.stat has one line per device ("8:0 rbytes=.. wbytes=.. rios=.. wios=.. dbytes=.. dios=..") and is empty until the first I/O
+            length = ReadFile(Path.Combine(path, "io.stat"), buffer);
+            if (length < 0)
+            {
+                return false;
+            }
+
+            result.ReadBytes = SumValues(buffer, length, s_rbytes);
+            result.WriteBytes = SumValues(buffer, length, s_wbytes);
+            result.ReadOps = SumValues(buffer, length, s_rios);
+            result.WriteOps = SumValues(buffer, length, s_wios);
+
+            usage = result;
+            return true;
+        }
+
+        /// <summary>
+        /// Reads as much of the file as fits in <paramref name="buffer"/>, returning the number of bytes read or -1 if the file can't be read.
+        /// </summary>
+        private static int ReadFile(string path, byte[] buffer)
+        {
+            try
+            {
+                // No buffering: the file is read straight into the caller's buffer
+                using var stream = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.ReadWrite, bufferSize: 1);
+                int total = 0;
+                int read;
+                while (total < buffer.Length && (read = stream.Read(buffer, total, buffer.Length - total)) > 0)
+                {
+                    total += read;
+                }
+
+                return total;
+            }
+            catch (Exception e) when (e is IOException || e is UnauthorizedAccessException)
+            {
+                return -1;
+            }
+        }
+
+        /// <summary>
+        /// Parses the decimal number at <paramref name="start"/>, which must be followed by the end of the data or by whitespace.
+        /// </summary>
+        private static bool TryParseValue(byte[] buffer, int start, int length, out ulong value)
+        {
+            value = 0;
+            int i = start;
+            for (; i < length && buffer[i] >= '0' && buffer[i] <= '9'; i++)
+            {
+                value = unchecked(value * 10 + (ulong)(buffer[i] - '0'));
+            }
+
+            return i > start && (i == length || buffer[i] == '\n' || buffer[i] == ' ');
+        }
+
+        /// <summary>
+        /// Whether <paramref name="key"/> is found at <paramref name="position"/>, at the start of a word and followed by <paramref name="separator"/>.
+        /// </summary>
+        private static bool IsKeyAt(byte[] buffer, int length, int position, byte[] key, byte separator)
+        {
+            if (position + key.Length >= length || buffer[position + key.Length] != separator)
+            {
+                return false;
+            }
+
+            if (position > 0 && buffer[position - 1] != ' ' && buffer[position - 1] != '\n')
+            {
+                return false;
+            }
+
+            for (int i = 0; i < key.Length; i++)
+            {
+                if (buffer[position + i] != key[i])
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Finds the value of a "key value" line (the format of cpu.stat and memory.stat).
+        /// </summary>
+        private static bool TryFindValue(byte[] buffer, int length, byte[] key, out ulong value)
+        {
+            for (int lineStart = 0; lineStart < length;)
+            {
+                if (IsKeyAt(buffer, length, lineStart, key, (byte)' '))
+                {
+                    return TryParseValue(buffer, lineStart + key.Length + 1, length, out value);
+                }
+
+                int lineEnd = Array.IndexOf(buffer, (byte)'\n', lineStart, length - lineStart);
+                lineStart = lineEnd < 0 ? length : lineEnd + 1;
+            }
+
+            value = 0;
+            return false;
+        }
+
+        /// <summary>
+        /// Sums the values of all the "key=value" words (the format of io.stat).
+        /// </summary>
+        private static ulong SumValues(byte[] buffer, int length, byte[] key)
+        {
+            ulong sum = 0;
+            for (int i = 0; i < length; i++)
+            {
+                if (buffer[i] == key[0] && IsKeyAt(buffer, length, i, key, (byte)'=') && TryParseValue(buffer, i + key.Length + 1, length, out var value))
+                {
+                    sum += value;
+                }
+            }
+
+            return sum;
+        }
+    }
+}
@@ -0,0 +1,759 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Generic;
+using System.Runtime.ExceptionServices;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
+using Microsoft.Win32.SafeHandles;
+using static BuildXL.Interop.Dispatch;
+using static BuildXL.Interop.Unix.Impl_Linux;
+using static BuildXL.Interop.Unix.IO;
+
+namespace BuildXL.Interop.Linux
+{
+    /// <summary>
+    /// Directory enumeration with getdents64(2) on directory file descriptors.
+    /// </summary>
+    /// <remarks>
+    /// Entries are read in bulk into a caller-provided buffer and handed out as raw name bytes, together with the type the file system
+    /// reports in d_type, so that enumerating a directory costs no stat(2) per entry unless the file system leaves d_type unset.
+    /// Entries are looked up with statx(2), or with fstatat(2) where statx is not supported.
+    /// Subdirectories are opened relative to their parent with openat(2), so the kernel never walks a full path again.
+    /// </remarks>
+    public static class DirectoryEnumerator
+    {
+        /// <summary>
+        /// Type of a directory entry. The values are those of d_type (DT_*), which are also the S_IFMT bits of st_mode shifted right by 12.
+        /// </summary>
+        public enum EntryType : byte
+        {
+            /// <summary>The file system did not report the type.</summary>
+            Unknown = 0,
+
+            /// <nodoc />
+            Fifo = 1,
+
+            /// <nodoc />
+            CharacterDevice = 2,
+
+            /// <nodoc />
+            Directory = 4,
+
+            /// <nodoc />
+            BlockDevice = 6,
+
+            /// <nodoc />
+            RegularFile = 8,
+
+            /// <nodoc />
+            Symlink = 10,
+
+            /// <nodoc />
+            Socket = 12,
+        }
+
+        /// <summary>
+        /// Called with each entry of a directory (other than "." and ".."). <paramref name="name"/> is only valid during the call.
+        /// Returns false to stop the enumeration.
+        /// </summary>
+        public delegate bool EntryVisitor(ReadOnlySpan<byte> name, EntryType type);
+
+        /// <summary>
+        /// Called by <see cref="EnumerateParallel"/> with each entry of each directory, concurrently from several threads.
+        /// Returns whether the entry, when it is a directory, should be enumerated as well; the return value is ignored for other entries.
+        /// </summary>
+        public delegate bool ParallelEntryVisitor(string directoryPath, ReadOnlySpan<byte> name, EntryType type);
+
+        /// <summary>
+        /// Size of the buffer handed to getdents64 by default: a few hundred entries of typical name lengths.
+        /// </summary>
+        public const int DefaultBufferSize = 32 * 1024;
+
+        /// <summary>
+        /// Longest name of a directory entry (NAME_MAX).
+        /// </summary>
+        public const int MaxNameLength = 255;
+
+        private const int O_RDONLY = 0;
+        private const int O_NOFOLLOW = 0x20000;
+        private const int O_DIRECTORY = 0x10000;
+        private const int O_CLOEXEC = 0x80000;
+
+        private const int AT_FDCWD = -100;
+        private const int AT_SYMLINK_NOFOLLOW = 0x100;
+        private const int AT_REMOVEDIR = 0x200;
+        private const uint STATX_TYPE = 0x1;
+        private const uint STATX_MODE = 0x2;
+        private const uint STATX_UID = 0x8;
+        private const uint STATX_GID = 0x10;
+
+        private const int EINTR = 4;
+        private const int ENAMETOOLONG = 36;
+
+        // Layout of struct statx (which the kernel always fills in whole)
+        private const int StatxSize = 256;
+        private const int StatxUidOffset = 20;
+        private const int StatxGidOffset = 24;
+        private const int StatxModeOffset = 28;
+
+        // Layout of struct stat, which differs between x64 and the generic layout arm64 uses
+        private const int StatSize = 144;
+        private static readonly bool s_isGenericStatLayout = RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+        private static readonly int s_statModeOffset = s_isGenericStatLayout ? 16 : 24;
+        private static readonly int s_statUidOffset = s_isGenericStatLayout ? 24 : 28;
+        private static readonly int s_statGidOffset = s_isGenericStatLayout ? 28 : 32;
+
+        // Permission bits of st_mode
+        private const int S_IRUSR = 0x100;
+        private const int S_IWUSR = 0x80;
+        private const int S_IRGRP = 0x20;
+        private const int S_IWGRP = 0x10;
+        private const int S_IROTH = 0x4;
+        private const int S_IWOTH = 0x2;
+
+        // Layout of struct linux_dirent64: d_ino (8), d_off (8), d_reclen (2), d_type (1), d_name (NUL terminated)
+        private const int DirentRecordLengthOffset = 16;
+        private const int DirentTypeOffset = 18;
+        private const int DirentNameOffset = 19;
+
+        // glibc only exposes getdents64 since 2.30, so it is called through syscall(2)
+        private static readonly long s_getdents64 = RuntimeInformation.ProcessArchitecture == Architecture.Arm64 ? 61 : 217;
+
+        // Credentials against which TryGetEntryInfo checks permission bits. They are not expected to change during a build.
+        private static readonly uint s_effectiveUserId = IsMacOS ? 0 : geteuid();
+        private static readonly uint s_effectiveGroupId = IsMacOS ? 0 : getegid();
+        private static readonly Lazy<uint[]> s_supplementaryGroupIds = new Lazy<uint[]>(GetSupplementaryGroupIds);
+
+        /// <summary>
+        /// Opens the directory at <paramref name="path"/> for enumeration, following a symlink at the end of the path.
+        /// Returns 0 on success or the errno value of the failure, in which case <paramref name="directory"/> is null.
+        /// </summary>
+        public static unsafe int OpenDirectory(string path, out SafeFileHandle directory)
+        {
+            if (IsMacOS)
+            {
+                throw new NotImplementedException();
+            }
+
+            byte[] pathBytes = new byte[Encoding.UTF8.GetMaxByteCount(path.Length) + 1];
+            int length = Encoding.UTF8.GetBytes(path, 0, path.Length, pathBytes, 0);
+            pathBytes[length] = 0;
+
+            fixed (byte* pPath = pathBytes)
+            {
+                return OpenAt(AT_FDCWD, pPath, followSymlink: true, out directory);
+            }
+        }
+
+        /// <summary>
+        /// Opens the subdirectory <paramref name="name"/> of <paramref name="parent"/> for enumeration.
+        /// Returns 0 on success or the errno value of the failure, in which case <paramref name="directory"/> is null.
+        /// </summary>
+        public static unsafe int OpenDirectoryAt(SafeFileHandle parent, ReadOnlySpan<byte> name, bool followSymlink, out SafeFileHandle directory)
+        {
+            if (name.Length > MaxNameLength)
+            {
+                directory = null;
+                return ENAMETOOLONG;
+            }
+
+            byte* pName = stackalloc byte[MaxNameLength + 1];
+            name.CopyTo(new Span<byte>(pName, MaxNameLength));
+            pName[name.Length] = 0;
+
+            bool added = false;
+            try
+            {
+                parent.DangerousAddRef(ref added);
+                return OpenAt(ToInt(parent), pName, followSymlink, out directory);
+            }
+            finally
+            {
+                if (added)
+                {
+                    parent.DangerousRelease();
+                }
+            }
+        }
+
+        /// <summary>
+        /// Decodes the (UTF-8) name of an entry.
+        /// </summary>
+        public static unsafe string GetName(ReadOnlySpan<byte> name)
+        {
+            if (name.IsEmpty)
+            {
+                return string.Empty;
+            }
+
+            fixed (byte* pName = name)
+            {
+                return Encoding.UTF8.GetString(pName, name.Length);
+            }
+        }
+
+        /// <summary>
+        /// Returns the type of the entry <paramref name="name"/> of <paramref name="parent"/> with statx(2) (or fstatat(2)), or <see cref="EntryType.Unknown"/>
+        /// if it can't be determined (typically because the entry was removed). With <paramref name="followSymlink"/>, the type of the target of a symlink is returned.
+        /// </summary>
+        public static unsafe EntryType GetEntryType(SafeFileHandle parent, ReadOnlySpan<byte> name, bool followSymlink)
+        {
+            if (name.Length > MaxNameLength)
+            {
+                return EntryType.Unknown;
+            }
+
+            byte* pName = stackalloc byte[MaxNameLength + 1];
+            name.CopyTo(new Span<byte>(pName, MaxNameLength));
+            pName[name.Length] = 0;
+
+            bool added = false;
+            try
+            {
+                parent.DangerousAddRef(ref added);
+                return GetEntryType(ToInt(parent), pName, followSymlink);
+            }
+            finally
+            {
+                if (added)
+                {
+                    parent.DangerousRelease();
+                }
+            }
+        }
+
+        /// <summary>
+        /// Looks up the entry <paramref name="name"/> of <paramref name="parent"/> with a single statx(2) (or fstatat(2)), following a symlink at the end.
+        /// <paramref name="targetType"/> is the type of the entry, or of the target of a symlink. <paramref name="isReadOnly"/> is computed
+        /// as <see cref="System.IO.File.GetAttributes(string)"/> does on Unix: the permission bits that apply to the effective user
+        /// (those of the owner, of the group or of others) grant reading but not writing.
+        /// Returns false, with <see cref="EntryType.Unknown"/> and not read-only, if the entry (or the target of a symlink) can't be looked up.
+        /// </summary>
+        public static bool TryGetEntryInfo(SafeFileHandle parent, ReadOnlySpan<byte> name, out EntryType targetType, out bool isReadOnly)
+            => TryGetEntryInfo(parent, name, SupportsStatx, out targetType, out isReadOnly);
+
+        /// <summary>
+        /// Same as <see cref="TryGetEntryInfo(SafeFileHandle, ReadOnlySpan{byte}, out EntryType, out bool)"/>, with fstatat(2) unless <paramref name="useStatx"/>.
+        /// </summary>
+        internal static unsafe bool TryGetEntryInfo(SafeFileHandle parent, ReadOnlySpan<byte> name, bool useStatx, out EntryType targetType, out bool isReadOnly)
+        {
+            targetType = EntryType.Unknown;
+            isReadOnly = false;
+
+            if (name.Length > MaxNameLength)
+            {
+                return false;
+            }
+
+            byte* pName = stackalloc byte[MaxNameLength + 1];
+            name.CopyTo(new Span<byte>(pName, MaxNameLength));
+            pName[name.Length] = 0;
+
+            int mode;
+            uint uid;
+            uint gid;
+            bool added = false;
+            try
+            {
+                parent.DangerousAddRef(ref added);
+                if (!TryStat(ToInt(parent), pName, followSymlink: true, STATX_TYPE | STATX_MODE | STATX_UID | STATX_GID, useStatx, out mode, out uid, out gid))
+                {
+                    return false;
+                }
+            }
+            finally
+            {
+                if (added)
+                {
+                    parent.DangerousRelease();
+                }
+            }
+
+            targetType = (EntryType)(mode >> 12);
+            isReadOnly = uid == s_effectiveUserId
+                ? (mode & (S_IRUSR | S_IWUSR)) == S_IRUSR
+                : IsMemberOfGroup(gid)
+                    ? (mode & (S_IRGRP | S_IWGRP)) == S_IRGRP
+                    : (mode & (S_IROTH | S_IWOTH)) == S_IROTH;
+            return true;
+        }
+
+        /// <summary>
+        /// Removes the entry <paramref name="name"/> of <paramref name="parent"/> with unlinkat(2): an empty directory when <paramref name="isDirectory"/>,
+        /// or any other entry (a symlink itself, not its target). Returns 0 on success or the errno value of the failure.
+        /// </summary>
+        public static unsafe int RemoveEntryAt(SafeFileHandle parent, ReadOnlySpan<byte> name, bool isDirectory)
+        {
+            if (name.Length > MaxNameLength)
+            {
+                return ENAMETOOLONG;
+            }
+
+            byte* pName = stackalloc byte[MaxNameLength + 1];
+            name.CopyTo(new Span<byte>(pName, MaxNameLength));
+            pName[name.Length] = 0;
+
+            bool added = false;
+            try
+            {
+                parent.DangerousAddRef(ref added);
+                return unlinkat_raw(ToInt(parent), pName, isDirectory ? AT_REMOVEDIR : 0) == 0 ? 0 : Marshal.GetLastWin32Error();
+            }
+            finally
+            {
+                if (added)
+                {
+                    parent.DangerousRelease();
+                }
+            }
+        }
+
+        /// <summary>
+        /// Calls <paramref name="visitor"/> with every entry of <paramref name="directory"/>, in the order the file system returns them.
+        /// Entries whose type the file system does not report are looked up with statx(2), without following symlinks.
+        /// Returns 0 once all the entries were visited or the visitor stopped the enumeration, or the errno value of the failure.
+        /// </summary>
+        /// <remarks>
+        /// The directory is read from its current offset: a handle can only be enumerated once.
+        /// </remarks>
+        public static unsafe int Enumerate(SafeFileHandle directory, byte[] buffer, EntryVisitor visitor)
+        {
+            if (IsMacOS)
+            {
+                throw new NotImplementedException();
+            }
+
+            bool added = false;
+            try
+            {
+                directory.DangerousAddRef(ref added);
+                int fd = ToInt(directory);
+
+                fixed (byte* pBuffer = buffer)
+                {
+                    while (true)
+                    {
+                        long read = syscall_3(s_getdents64, fd, (long)pBuffer, buffer.Length);
+                        if (read < 0)
+                        {
+                            int error = Marshal.GetLastWin32Error();
+                            if (error == EINTR)
+                            {
+                                continue;
+                            }
+
+                            return error;
+                        }
+
+                        if (read == 0)
+                        {
+                            return 0;
+                        }
+
+                        for (long offset = 0; offset < read;)
+                        {
+                            byte* record = pBuffer + offset;
+                            offset += *(ushort*)(record + DirentRecordLengthOffset);
+
+                            byte* name = record + DirentNameOffset;
+                            int nameLength = 0;
+                            while (name[nameLength] != 0)
+                            {
+                                nameLength++;
+                            }
+
+                            if (name[0] == '.' && (nameLength == 1 || (nameLength == 2 && name[1] == '.')))
+                            {
+                                continue;
+                            }
+
+                            var type = (EntryType)record[DirentTypeOffset];
+                            if (type == EntryType.Unknown)
+                            {
+                                type = GetEntryType(fd, name, followSymlink: false);
+                            }
+
+                            if (!visitor(new ReadOnlySpan<byte>(name, nameLength), type))
+                            {
+                                return 0;
+                            }
+                        }
+                    }
+                }
+            }
+            finally
+            {
+                if (added)
+                {
+                    directory.DangerousRelease();
+                }
+            }
+        }
+
+        /// <summary>
+        /// Enumerates the tree rooted at <paramref name="rootPath"/> on <paramref name="degreeOfParallelism"/> threads (the calling thread being one of them).
+        /// </summary>
+        /// <remarks>
+        /// Every thread enumerates the directories it discovered itself, depth first, and steals the oldest pending directory of another thread
+        /// when it runs out: wide trees are spread over all the threads while each of them mostly stays in one part of the tree.
+        /// Symlinks are never followed. Returns 0 once the whole tree was visited, or the errno value of the first failure,
+        /// after which no more directories are enumerated; <paramref name="failedPath"/> is then set to the directory that failed.
+        /// An exception thrown by <paramref name="visitor"/> stops the enumeration as well and is rethrown on the calling thread.
+        /// </remarks>
+        public static int EnumerateParallel(string rootPath, int degreeOfParallelism, ParallelEntryVisitor visitor, out string failedPath)
+        {
+            int error = OpenDirectory(rootPath, out var root);
+            if (error != 0)
+            {
+                failedPath = rootPath;
+                return error;
+            }
+
+            var walk = new ParallelWalk(Math.Max(1, degreeOfParallelism), visitor);
+            walk.Run(root, rootPath);
+
+            failedPath = walk.FailedPath;
+            return walk.Error;
+        }
+
+        private static bool IsMemberOfGroup(uint gid)
+        {
+            if (gid == s_effectiveGroupId)
+            {
+                return true;
+            }
+
+            foreach (uint group in s_supplementaryGroupIds.Value)
+            {
+                if (group == gid)
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        private static uint[] GetSupplementaryGroupIds()
+        {
+            int count = getgroups(0, null);
+            if (count <= 0)
+            {
+                return Array.Empty<uint>();
+            }
+
+            var groups = new uint[count];
+            count = getgroups(count, groups);
+            return count <= 0 ? Array.Empty<uint>() : groups.AsSpan(0, count).ToArray();
+        }
+
+        private static unsafe int OpenAt(int dirfd, byte* name, bool followSymlink, out SafeFileHandle directory)
+        {
+            int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC | (followSymlink ? 0 : O_NOFOLLOW);
+
+            int fd;
+            while ((fd = openat_raw(dirfd, name, flags)) < 0)
+            {
+                int error = Marshal.GetLastWin32Error();
+                if (error != EINTR)
+                {
+                    directory = null;
+                    return error;
+                }
+            }
+
+            directory = new SafeFileHandle(new IntPtr(fd), ownsHandle: true);
+            return 0;
+        }
+
+        private static unsafe EntryType GetEntryType(int dirfd, byte* name, bool followSymlink)
+        {
+            return TryStat(dirfd, name, followSymlink, STATX_TYPE, SupportsStatx, out int mode, out _, out _)
+                ? (EntryType)(mode >> 12)
+                : EntryType.Unknown;
+        }
+
+        /// <summary>
+        /// Looks up <paramref name="name"/> relative to <paramref name="dirfd"/>: with statx(2), asking for the fields in <paramref name="mask"/>,
+        /// or with fstatat(2) unless <paramref name="useStatx"/> (i.e., where statx is not supported). Returns false if the entry can't be looked up.
+        /// </summary>
+        private static unsafe bool TryStat(int dirfd, byte* name, bool followSymlink, uint mask, bool useStatx, out int mode, out uint uid, out uint gid)
+        {
+            int flags = followSymlink ? 0 : AT_SYMLINK_NOFOLLOW;
+            if (useStatx)
+            {
+                byte* buffer = stackalloc byte[StatxSize];
+                if (statx_raw(dirfd, name, flags, mask, buffer) == 0)
+                {
+                    mode = *(ushort*)(buffer + StatxModeOffset);
+                    uid = *(uint*)(buffer + StatxUidOffset);
+                    gid = *(uint*)(buffer + StatxGidOffset);
+                    return true;
+                }
+            }
+            else
+            {
+                byte* buffer = stackalloc byte[StatSize];
+                if (fstatat_raw(dirfd, name, buffer, flags) == 0)
+                {
+                    mode = (int)*(uint*)(buffer + s_statModeOffset);
+                    uid = *(uint*)(buffer + s_statUidOffset);
+                    gid = *(uint*)(buffer + s_statGidOffset);
+                    return true;
+                }
+            }
+
+            mode = 0;
+            uid = 0;
+            gid = 0;
+            return false;
+        }
+
+        /// <summary>
+        /// A directory waiting to be enumerated: its name and the (shared) handle of its parent, kept open by a reference until the directory is opened.
+        /// </summary>
+        private sealed class PendingDirectory
+        {
+            internal SafeFileHandle Parent;
+            internal byte[] Name;
+            internal string Path;
+        }
+
+        /// <summary>
+        /// Double-ended queue of one thread: the owner pushes and pops at the tail, other threads steal from the head.
+        /// </summary>
+        /// <remarks>
+        /// Contention only happens on steals, which are rare compared to local operations once every thread has work,
+        /// so a lock per queue is cheaper than it looks.
+        /// </remarks>
+        private sealed class WorkQueue
+        {
+            private PendingDirectory[] m_items = new PendingDirectory[64];
+            private int m_head;
+            private int m_count;
+
+            internal void Push(PendingDirectory item)
+            {
+                lock (this)
+                {
+                    if (m_count == m_items.Length)
+                    {
+                        var items = new PendingDirectory[m_items.Length * 2];
+                        for (int i = 0; i < m_count; i++)
+                        {
+                            items[i] = m_items[(m_head + i) % m_items.Length];
+                        }
+
+                        m_items = items;
+                        m_head = 0;
+                    }
+
+                    m_items[(m_head + m_count) % m_items.Length] = item;
+                    m_count++;
+                }
+            }
+
+            internal PendingDirectory Pop()
+            {
+                lock (this)
+                {
+                    if (m_count == 0)
+                    {
+                        return null;
+                    }
+
+                    m_count--;
+                    int index = (m_head + m_count) % m_items.Length;
+                    var item = m_items[index];
+                    m_items[index] = null;
+                    return item;
+                }
+            }
+
+            internal PendingDirectory Steal()
+            {
+                lock (this)
+                {
+                    if (m_count == 0)
+                    {
+                        return null;
+                    }
+
+                    var item = m_items[m_head];
+                    m_items[m_head] = null;
+                    m_head = (m_head + 1) % m_items.Length;
+                    m_count--;
+                    return item;
+                }
+            }
+        }
+
+        private sealed class ParallelWalk
+        {
+            private readonly ParallelEntryVisitor m_visitor;
+            private readonly WorkQueue[] m_queues;
+
+            // Directories discovered but not enumerated yet, over all the queues: the walk is over when this drops to 0
+            private int m_pending;
+
+            private int m_error;
+            private ExceptionDispatchInfo m_exception;
+            private volatile bool m_stopped;
+
+            internal string FailedPath { get; private set; }
+
+            internal int Error => m_error;
+
+            internal ParallelWalk(int degreeOfParallelism, ParallelEntryVisitor visitor)
+            {
+                m_visitor = visitor;
+                m_queues = new WorkQueue[degreeOfParallelism];
+                for (int i = 0; i < m_queues.Length; i++)
+                {
+                    m_queues[i] = new WorkQueue();
+                }
+            }
+
+            internal void Run(SafeFileHandle root, string rootPath)
+            {
+                m_pending = 1;
+
+                var workers = new List<Task>(m_queues.Length - 1);
+                for (int i = 1; i < m_queues.Length; i++)
+                {
+                    int index = i;
+                    workers.Add(Task.Factory.StartNew(() => Work(index, null, null), TaskCreationOptions.LongRunning));
+                }
+
+                Work(0, root, rootPath);
+                Task.WaitAll(workers.ToArray());
+
+                m_exception?.Throw();
+            }
+
+            private void Work(int index, SafeFileHandle directory, string path)
+            {
+                var buffer = new byte[DefaultBufferSize];
+                var spinWait = new SpinWait();
+
+                if (directory != null)
+                {
+                    Process(index, directory, path, buffer);
+                }
+
+                while (Volatile.Read(ref m_pending) > 0)
+                {
+                    var next = m_queues[index].Pop() ?? Steal(index);
+                    if (next == null)
+                    {
+                        spinWait.SpinOnce();
+                        continue;
+                    }
+
+                    spinWait.Reset();
+
+                    int error = 0;
+                    SafeFileHandle handle = null;
+                    if (!m_stopped)
+                    {
+                        error = OpenDirectoryAt(next.Parent, next.Name, followSymlink: false, out handle);
+                    }
+
+                    next.Parent.DangerousRelease();
+
+                    if (error != 0)
+                    {
+                        Fail(error, next.Path);
+                        Interlocked.Decrement(ref m_pending);
+                    }
+                    else if (handle == null)
+                    {
+                        // Failed elsewhere: only drain the queues
+                        Interlocked.Decrement(ref m_pending);
+                    }
+                    else
+                    {
+                        Process(index, handle, next.Path, buffer);
+                    }
+                }
+            }
+
+            private PendingDirectory Steal(int index)
+            {
+                for (int i = 1; i < m_queues.Length; i++)
+                {
+                    var item = m_queues[(index + i) % m_queues.Length].Steal();
+                    if (item != null)
+                    {
+                        return item;
+                    }
+                }
+
+                return null;
+            }
+
+            /// <summary>
+            /// Enumerates <paramref name="directory"/>, queuing its subdirectories, then disposes it: the handle is closed once the last
+            /// of the queued subdirectories is opened.
+            /// </summary>
+            private void Process(int index, SafeFileHandle directory, string path, byte[] buffer)
+            {
+                try
+                {
+                    int error = Enumerate(directory, buffer, (name, type) =>
+                    {
+                        if (m_stopped)
+                        {
+                            return false;
+                        }
+
+                        if (m_visitor(path, name, type) && type == EntryType.Directory)
+                        {
+                            bool added = false;
+                            directory.DangerousAddRef(ref added);
+
+                            Interlocked.Increment(ref m_pending);
+                            m_queues[index].Push(new PendingDirectory
+                            {
+                                Parent = directory,
+                                Name = name.ToArray(),
+                                Path = path + "/" + GetName(name),
+                            });
+                        }
+
+                        return true;
+                    });
+
+                    if (error != 0)
+                    {
+                        Fail(error, path);
+                    }
+                }
+                catch (Exception ex)
+                {
+                    Interlocked.CompareExchange(ref m_exception, ExceptionDispatchInfo.Capture(ex), null);
+                    m_stopped = true;
+                }
+                finally
+                {
+                    directory.Dispose();
+                    Interlocked.Decrement(ref m_pending);
+                }
+            }
+
+            private void Fail(int error, string path)
+            {
+                if (Interlocked.CompareExchange(ref m_error, error, 0) == 0)
+                {
+                    FailedPath = path;
+                }
+
+                m_stopped = true;
+            }
+        }
+    }
+}
@@ -0,0 +1,183 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Runtime.InteropServices;
+using Microsoft.Win32.SafeHandles;
+using BuildXL.Interop.Unix;
+using static BuildXL.Interop.Dispatch;
+using static BuildXL.Interop.Unix.Impl_Linux;
+
+namespace BuildXL.Interop.Linux
+{
+    /// <summary>
+    /// Native Linux epoll functions.
+    /// </summary>
+    /// <remarks>
+    /// Functions return 0 on success or the errno value of the failure, like the ones in <see cref="Ipc"/>.
+    /// </remarks>
+    public static class Epoll
+    {
+        /// <summary>
+        /// Linux value of EAGAIN (<see cref="IO.Errno"/> carries the macOS values): a non-blocking read found no data.
+        /// </summary>
+        public const int EAGAIN = 11;
+
+        private const int EINTR = 4;
+        private const int EPOLL_CLOEXEC = 0x80000;
+
+        private const int EPOLL_CTL_ADD = 1;
+        private const int EPOLL_CTL_DEL = 2;
+
+        // Events received at most by one call to Wait on x86-64, where they are read into a stack buffer first
+        private const int MaxPackedEventsPerWait = 256;
+
+        // Whether the kernel lays out epoll_event packed (see PackedEpollEvent)
+        private static readonly bool s_isPacked = RuntimeInformation.ProcessArchitecture == Architecture.X64;
+
+        /// <summary>
+        /// Event flags for <see cref="EpollEvent"/>.
+        /// </summary>
+        [Flags]
+        public enum Events : uint
+        {
+            /// <summary>The file is available for reading.</summary>
+            EPOLLIN = 0x001,
+
+            /// <summary>An error condition happened on the file.</summary>
+            EPOLLERR = 0x008,
+
+            /// <summary>The other end of the file was closed.</summary>
+            EPOLLHUP = 0x010,
+        }
+
+        /// <summary>
+        /// struct epoll_event from sys/epoll.h, as laid out on architectures other than x86-64 (e.g. arm64), where it is naturally aligned.
+        /// </summary>
+        /// <remarks>
+        /// On x86-64 the kernel packs the struct, so <see cref="Add"/>, <see cref="Remove"/> and <see cref="Wait"/> go through <see cref="PackedEpollEvent"/> there.
+        /// </remarks>
+        [StructLayout(LayoutKind.Sequential)]
+        public struct EpollEvent
+        {
+            /// <summary>Events that are requested (epoll_ctl) or that happened (epoll_wait).</summary>
+            public Events Events;
+
+            /// <summary>Value registered with the file, handed back by epoll_wait.</summary>
+            public ulong Data;
+        }
+
+        /// <summary>
+        /// struct epoll_event from sys/epoll.h on x86-64, where it is packed (its size is 12 bytes).
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential, Pack = 1)]
+        internal struct PackedEpollEvent
+        {
+            public Events Events;
+            public ulong Data;
+        }
+
+        /// <summary>
+        /// Creates an epoll instance. The returned handle is invalid on failure.
+        /// </summary>
+        public static SafeFileHandle Create()
+        {
+            if (IsMacOS)
+            {
+                throw new NotImplementedException();
+            }
+
+            return new SafeFileHandle(new IntPtr(epoll_create1(EPOLL_CLOEXEC)), ownsHandle: true);
+        }
+
+        /// <summary>
+        /// Starts watching <paramref name="fd"/> for <paramref name="events"/>. <paramref name="data"/> is handed back with every event of the file.
+        /// </summary>
+        public static int Add(SafeFileHandle epoll, SafeFileHandle fd, Events events, ulong data)
+        {
+            if (IsMacOS)
+            {
+                throw new NotImplementedException();
+            }
+
+            return Control(epoll, EPOLL_CTL_ADD, fd, events, data);
+        }
+
+        /// <summary>
+        /// Stops watching <paramref name="fd"/>. Must be called before the file is closed if other descriptors may refer to the same file.
+        /// </summary>
+        public static int Remove(SafeFileHandle epoll, SafeFileHandle fd)
+        {
+            if (IsMacOS)
+            {
+                throw new NotImplementedException();
+            }
+
+            // Kernels before 2.6.9 require a non-null event even though it is ignored.
+            return Control(epoll, EPOLL_CTL_DEL, fd, events: 0, data: 0);
+        }
+
+        private unsafe static int Control(SafeFileHandle epoll, int op, SafeFileHandle fd, Events events, ulong data)
+        {
+            int error;
+            if (s_isPacked)
+            {
+                var ev = new PackedEpollEvent { Events = events, Data = data };
+                error = epoll_ctl(IO.ToInt(epoll), op, IO.ToInt(fd), &ev);
+            }
+            else
+            {
+                var ev = new EpollEvent { Events = events, Data = data };
+                error = epoll_ctl(IO.ToInt(epoll), op, IO.ToInt(fd), &ev);
+            }
+
+            if (error != 0)
+            {
+                error = Marshal.GetLastWin32Error();
+            }
+
+            return error;
+        }
+
+        /// <summary>
+        /// Waits for events, retrying on EINTR. A negative <paramref name="timeoutMs"/> waits indefinitely.
+        /// </summary>
+        /// <returns>The number of events stored at the start of <paramref name="events"/>, or -1 on error.</returns>
+        public unsafe static int Wait(SafeFileHandle epoll, EpollEvent[] events, int timeoutMs)
+        {
+            if (IsMacOS)
+            {
+                throw new NotImplementedException();
+            }
+
+            if (!s_isPacked)
+            {
+                fixed (EpollEvent* buf = &events[0])
+                {
+                    return WaitInto(epoll, buf, events.Length, timeoutMs);
+                }
+            }
+
+            int maxEvents = Math.Min(events.Length, MaxPackedEventsPerWait);
+            PackedEpollEvent* packed = stackalloc PackedEpollEvent[maxEvents];
+            int count = WaitInto(epoll, packed, maxEvents, timeoutMs);
+            for (int i = 0; i < count; i++)
+            {
+                events[i] = new EpollEvent { Events = packed[i].Events, Data = packed[i].Data };
+            }
+
+            return count;
+        }
+
+        private unsafe static int WaitInto(SafeFileHandle epoll, void* buffer, int maxEvents, int timeoutMs)
+        {
+            int result;
+            do
+            {
+                result = epoll_wait(IO.ToInt(epoll), buffer, maxEvents, timeoutMs);
+            }
+            while (result < 0 && Marshal.GetLastWin32Error() == EINTR);
+            return result;
+        }
+    }
+}
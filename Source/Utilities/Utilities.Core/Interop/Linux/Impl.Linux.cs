@@ -10,6 +10,7 @@ using System.IO;
 using System.Runtime.InteropServices;
 using System.Text;
 using System.Threading;
+using BuildXL.Interop.Linux;
 using Microsoft.Win32.SafeHandles;
 using static BuildXL.Interop.Libraries;
 using static BuildXL.Interop.Unix.Constants;
@@ -91,26 +92,16 @@ namespace BuildXL.Interop.Unix
         /// </summary>
         internal static int GetFileSystemType(SafeFileHandle fd, StringBuilder fsTypeName, long bufferSize)
         {
-            var path = ToPath(fd);
-            if (path == null)
+            // DriveInfo is not accurate because it uses statfs, which can't distinguish ext2/ext3/ext4.
+            // Instead, the file system type is looked up in the mount table ("UNKNOWN" for a mount that is not in it).
+            var fsType = MountTable.Instance.GetFileSystemType(fd);
+            if (fsType == null)
             {
                 return ERROR;
             }
 
-            // DriveInfo is not accurate because it uses statfs, which can't distinguish ext2/ext3/ext4.
-            // Instead of calling API, we read /proc/mounts file, sort the path based on length, find the closest match, then get the file system type.
-            return Try(() =>
-                {
-                    var mounts = File.ReadAllLines("/proc/mounts");
-                    var dirFsTypes = mounts
-                        .Select(l => l.Split(' '))
-                        .Select(s => (s[1], s[2])) // select mount point (s[1]) and file system type (s[2])
-                        .OrderByDescending(i => i.Item1.Length);
-                    var dirAndType = dirFsTypes.FirstOrDefault(d => path.StartsWith(d.Item1));
-                    fsTypeName.Append(dirAndType.Item1 == null ? "UNKNOWN" : dirAndType.Item2);
-                    return 0;
-                },
-                ERROR);
+            fsTypeName.Append(fsType);
+            return 0;
         }
 
         /// <summary>
@@ -382,48 +373,37 @@ namespace BuildXL.Interop.Unix
         }
 
         /// <summary>
-        /// Gets resource consumption data for a specific process, throws if the underlying ProcFS structures are not present or malformed.
+        /// Gets resource consumption data for a specific process, or null if the underlying ProcFS structures are not present or malformed.
         /// </summary>
         private static ProcessResourceUsage? CreateProcessResourceUsageForPid(int pid)
         {
-            try
+            Span<byte> buffer = stackalloc byte[ProcFs.BufferSize];
+            var usage = new ProcessResourceUsage() { ProcessId = pid };
+
+            int length = ProcFs.ReadProcessFile(pid, ProcFs.ProcessFile.Stat, buffer);
+            if (length < 0 || !ProcFs.TryParseStat(buffer.Slice(0, length), out var stat, out var name))
             {
-                var firstLine = File.ReadAllLines($"{ProcPath}/{pid}/{ProcStatPath}").FirstOrDefault();
-                var splits = firstLine.Split(new[] { ' ' }).ToArray();
-                var utimeMs = ((ulong)TicksToTimeSpan(double.Parse(splits[13])).TotalMilliseconds);
-                var stimeMs = ((ulong)TicksToTimeSpan(double.Parse(splits[14])).TotalMilliseconds);
-
-                string[] lines = System.IO.File.ReadAllLines($"{ProcPath}/{pid}/{ProcIoPath}");
-                string readOps = lines.FirstOrDefault(line => line.StartsWith("syscr:"));
-                string bytesRead = lines.FirstOrDefault(line => line.StartsWith("read_bytes:"));
-                string writeOps = lines.FirstOrDefault(line => line.StartsWith("syscw:"));
-                string bytesWritten = lines.FirstOrDefault(line => line.StartsWith("write_bytes:"));
-
-                lines = System.IO.File.ReadAllLines($"{ProcPath}/{pid}/{ProcStatusPath}");
-                string workingSetSize = lines.FirstOrDefault(line => line.StartsWith("VmRSS:"));
-                string peakWorkingSetSize = lines.FirstOrDefault(line => line.StartsWith("VmHWM:"));
-                string name = lines.FirstOrDefault(line => line.StartsWith("Name:"));
-
-                return new ProcessResourceUsage()
-                {
-                    UserTimeMs = utimeMs,
-                    SystemTimeMs = stimeMs,
-                    DiskReadOps = ExtractValueFromProcLine(readOps),
-                    DiskBytesRead = ExtractValueFromProcLine(bytesRead),
-                    DiskWriteOps = ExtractValueFromProcLine(writeOps),
-                    DiskBytesWritten = ExtractValueFromProcLine(bytesWritten),
-                    WorkingSetSize = ExtractValueFromProcLine(workingSetSize) * 1024,
-                    PeakWorkingSetSize = ExtractValueFromProcLine(peakWorkingSetSize) * 1024,
-                    ProcessId = pid,
-                    Name = name.Split(new[] { '\t' }, StringSplitOptions.RemoveEmptyEntries)[1],
-                };
+                return null;
             }
-#pragma warning disable
-            catch (Exception)
+
+            usage.UserTimeMs = ProcFs.ClockTicksToMilliseconds(stat.UserTimeTicks);
+            usage.SystemTimeMs = ProcFs.ClockTicksToMilliseconds(stat.SystemTimeTicks);
+            usage.Name = Encoding.UTF8.GetString(name.ToArray());
+
+            length = ProcFs.ReadProcessFile(pid, ProcFs.ProcessFile.Io, buffer);
+            if (length < 0 || !ProcFs.TryParseIo(buffer.Slice(0, length), ref usage))
             {
                 return null;
             }
-#pragma warning restore
+
+            length = ProcFs.ReadProcessFile(pid, ProcFs.ProcessFile.Status, buffer);
+            if (length < 0)
+            {
+                return null;
+            }
+
+            ProcFs.ParseStatus(buffer.Slice(0, length), ref usage);
+            return usage;
         }
 
         internal static IEnumerable<ProcessResourceUsage?> GetResourceUsageForProcessTree(int processId, bool includeChildren)
@@ -540,7 +520,7 @@ namespace BuildXL.Interop.Unix
                 (buf.st_mode & (uint)FilePermissions.S_IFMT) == (uint)FilePermissions.S_IFLNK;
         }
 
-        private static string ToPath(SafeFileHandle fd)
+        internal static string ToPath(SafeFileHandle fd)
         {
             var path = new StringBuilder(MaxPathLength);
             return SafeReadLink($"{ProcPath}/self/fd/{ToInt(fd)}", path, path.Capacity) >= 0
@@ -827,9 +807,87 @@ namespace BuildXL.Interop.Unix
             ulong size,
             int flags);
 
+        [DllImport(LibC, SetLastError = true)]
+        internal static extern long fgetxattr(
+            int fd,
+            [MarshalAs(UnmanagedType.LPStr)] string name,
+            IntPtr value,
+            ulong size);
+
         [DllImport(LibC, SetLastError = true)]
         internal static extern IntPtr realpath(string path, StringBuilder resolved_path);
 
+        [DllImport(LibC, SetLastError = true)]
+        internal static extern int epoll_create1(int flags);
+
+        [DllImport(LibC, SetLastError = true)]
+        unsafe internal static extern int epoll_ctl(int epfd, int op, int fd, void* ev);
+
+        [DllImport(LibC, SetLastError = true)]
+        unsafe internal static extern int epoll_wait(int epfd, void* events, int maxevents, int timeout);
+
+        [DllImport(LibC, EntryPoint = "syscall", SetLastError = true)]
+        internal static extern long syscall_2(long number, long arg1, long arg2);
+
+        [DllImport(LibC, EntryPoint = "open", SetLastError = true)]
+        unsafe internal static extern int open_raw(byte* pathname, int flags);
+
+        [DllImport(LibC, EntryPoint = "openat", SetLastError = true)]
+        unsafe internal static extern int openat_raw(int dirfd, byte* pathname, int flags);
+
+        [DllImport(LibC, SetLastError = true)]
+        internal static extern int ioctl(int fd, ulong request, int arg);
+
+        [DllImport(LibC, SetLastError = true)]
+        internal static extern uint geteuid();
+
+        [DllImport(LibC, SetLastError = true)]
+        internal static extern uint getegid();
+
+        [DllImport(LibC, SetLastError = true)]
+        internal static extern int getgroups(int size, uint[] list);
+
+        [DllImport(LibC, EntryPoint = "unlinkat", SetLastError = true)]
+        unsafe internal static extern int unlinkat_raw(int dirfd, byte* pathname, int flags);
+
+        [DllImport(LibC, EntryPoint = "syscall", SetLastError = true)]
+        internal static extern long syscall_3(long number, long arg1, long arg2, long arg3);
+
+        [DllImport(LibC, EntryPoint = "syscall", SetLastError = true)]
+        internal static extern long syscall_6(long number, long arg1, long arg2, long arg3, long arg4, long arg5, long arg6);
+
+        [DllImport(LibC, SetLastError = true)]
+        unsafe internal static extern void* mmap(void* addr, ulong length, int prot, int flags, int fd, long offset);
+
+        [DllImport(LibC, SetLastError = true)]
+        unsafe internal static extern int munmap(void* addr, ulong length);
+
+        [DllImport(LibC, SetLastError = true)]
+        internal static extern int close(int fd);
+
+        [DllImport(LibC, SetLastError = true)]
+        internal static extern IntPtr opendir([MarshalAs(UnmanagedType.LPStr)] string name);
+
+        [DllImport(LibC, SetLastError = true)]
+        internal static extern IntPtr readdir(IntPtr dirp);
+
+        [DllImport(LibC, SetLastError = true)]
+        internal static extern int closedir(IntPtr dirp);
+
+        [DllImport(LibC, SetLastError = true)]
+        unsafe internal static extern int poll(BuildXL.Interop.Linux.MountTable.PollFd* fds, ulong nfds, int timeout);
+
+        [DllImport(LibC, EntryPoint = "statx", SetLastError = true)]
+        unsafe internal static extern int statx_raw(int dirfd, byte* pathname, int flags, uint mask, byte* statxbuf);
+
+        [DllImport(LibC, EntryPoint = "__fxstatat", SetLastError = true)]
+        unsafe private static extern int fxstatat_raw(int __ver, int dirfd, byte* pathname, byte* statbuf, int flags);
+
+        /// <summary>
+        /// fstatat(2) into a raw struct stat, for where statx is not supported (see <see cref="SupportsStatx"/>).
+        /// </summary>
+        unsafe internal static int fstatat_raw(int dirfd, byte* pathname, byte* statbuf, int flags) => fxstatat_raw(__Ver, dirfd, pathname, statbuf, flags);
+
         [DllImport(LibC, SetLastError = true, CharSet = CharSet.Ansi, EntryPoint = "sem_open")]
         public static extern IntPtr sem_open_libc([MarshalAs(UnmanagedType.LPStr)] string name, int oflag, int mode, uint value);
 
@@ -0,0 +1,372 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Runtime.InteropServices;
+using System.Threading;
+using Microsoft.Win32.SafeHandles;
+using static BuildXL.Interop.Dispatch;
+using static BuildXL.Interop.Unix.Impl_Linux;
+
+namespace BuildXL.Interop.Linux
+{
+    /// <summary>
+    /// A native Linux io_uring instance (kernel 5.6 and later), used to issue reads without blocking a thread on each of them.
+    /// </summary>
+    /// <remarks>
+    /// Requests are written to a submission queue shared with the kernel and handed to it with io_uring_enter; their results are posted
+    /// to a completion queue, also shared with the kernel, tagged with the user data of the request.
+    ///
+    /// The submission side (<see cref="SubmitRead"/>) must be called by one thread at a time, and so must the completion side
+    /// (<see cref="WaitForCompletions"/> and <see cref="TryGetCompletion"/>); the two sides can run concurrently.
+    /// Functions return 0 on success or the errno value of the failure, like the ones in <see cref="Epoll"/>.
+    /// </remarks>
+    public sealed unsafe class IoUring : IDisposable
+    {
+        /// <summary>
+        /// Linux value of ENOSYS: the kernel does not support io_uring, or lacks a feature used here.
+        /// </summary>
+        public const int ENOSYS = 38;
+
+        /// <summary>
+        /// Linux value of EBUSY: the submission queue is full.
+        /// </summary>
+        public const int EBUSY = 16;
+
+        private const int EINTR = 4;
+        private const int EAGAIN = 11;
+
+        // The numbers are the same on all architectures
+        private const long SYS_io_uring_setup = 425;
+        private const long SYS_io_uring_enter = 426;
+
+        private const uint IORING_ENTER_GETEVENTS = 1;
+
+        // One mmap for both rings (5.4), completions are not dropped when the completion queue is full (5.5),
+        // and an offset of -1 reads at the current file position (5.6, along with IORING_OP_READ)
+        private const uint IORING_FEAT_SINGLE_MMAP = 1 << 0;
+        private const uint IORING_FEAT_NODROP = 1 << 1;
+        private const uint IORING_FEAT_RW_CUR_POS = 1 << 3;
+        private const uint RequiredFeatures = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_RW_CUR_POS;
+
+        private const byte IORING_OP_READ = 22;
+
+        private const long IORING_OFF_SQ_RING = 0;
+        private const long IORING_OFF_SQES = 0x10000000;
+
+        private const int PROT_READ = 0x1;
+        private const int PROT_WRITE = 0x2;
+        private const int MAP_SHARED = 0x01;
+        private const int MAP_POPULATE = 0x8000;
+
+        /// <summary>
+        /// struct io_sqring_offsets from linux/io_uring.h
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential)]
+        private struct SubmissionRingOffsets
+        {
+            public uint Head;
+            public uint Tail;
+            public uint RingMask;
+            public uint RingEntries;
+            public uint Flags;
+            public uint Dropped;
+            public uint Array;
+            public uint Reserved1;
+            public ulong UserAddress;
+        }
+
+        /// <summary>
+        /// struct io_cqring_offsets from linux/io_uring.h
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential)]
+        private struct CompletionRingOffsets
+        {
+            public uint Head;
+            public uint Tail;
+            public uint RingMask;
+            public uint RingEntries;
+            public uint Overflow;
+            public uint Cqes;
+            public uint Flags;
+            public uint Reserved1;
+            public ulong UserAddress;
+        }
+
+        /// <summary>
+        /// struct io_uring_params from linux/io_uring.h
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential)]
+        private struct Parameters
+        {
+            public uint SqEntries;
+            public uint CqEntries;
+            public uint Flags;
+            public uint SqThreadCpu;
+            public uint SqThreadIdle;
+            public uint Features;
+            public uint WqFd;
+            public fixed uint Reserved[3];
+            public SubmissionRingOffsets SqOff;
+            public CompletionRingOffsets CqOff;
+        }
+
+        /// <summary>
+        /// struct io_uring_sqe from linux/io_uring.h (64 bytes), with the fields used for reads.
+        /// </summary>
+        [StructLayout(LayoutKind.Explicit, Size = 64)]
+        private struct SubmissionEntry
+        {
+            [FieldOffset(0)]
+            public byte Opcode;
+
+            [FieldOffset(1)]
+            public byte Flags;
+
+            [FieldOffset(2)]
+            public ushort IoPriority;
+
+            [FieldOffset(4)]
+            public int Fd;
+
+            [FieldOffset(8)]
+            public ulong Offset;
+
+            [FieldOffset(16)]
+            public ulong Address;
+
+            [FieldOffset(24)]
+            public uint Length;
+
+            [FieldOffset(28)]
+            public uint OperationFlags;
+
+            [FieldOffset(32)]
+            public ulong UserData;
+
+            [FieldOffset(40)]
+            public ulong BufferIndexAndPersonality;
+
+            [FieldOffset(48)]
+            public ulong Address3;
+
+            [FieldOffset(56)]
+            public ulong Padding;
+        }
+
+        /// <summary>
+        /// struct io_uring_cqe from linux/io_uring.h
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential)]
+        public struct Completion
+        {
+            /// <summary>User data of the request.</summary>
+            public ulong UserData;
+
+            /// <summary>Result of the request: what the equivalent syscall returns on success (e.g., the number of bytes read), or -errno.</summary>
+            public int Result;
+
+            /// <summary>Completion flags.</summary>
+            public uint Flags;
+        }
+
+        private readonly SafeFileHandle m_ring;
+        private readonly byte* m_rings;
+        private readonly ulong m_ringsSize;
+        private readonly SubmissionEntry* m_entries;
+        private readonly ulong m_entriesSize;
+
+        private readonly uint* m_sqHead;
+        private readonly uint* m_sqTail;
+        private readonly uint m_sqMask;
+
+        private readonly uint* m_cqHead;
+        private readonly uint* m_cqTail;
+        private readonly uint m_cqMask;
+        private readonly Completion* m_cqes;
+
+        /// <summary>
+        /// Number of entries of the submission queue.
+        /// </summary>
+        public uint SubmissionQueueSize { get; }
+
+        /// <summary>
+        /// Number of entries of the completion queue.
+        /// </summary>
+        public uint CompletionQueueSize { get; }
+
+        private IoUring(SafeFileHandle ring, in Parameters parameters, byte* rings, ulong ringsSize, SubmissionEntry* entries, ulong entriesSize)
+        {
+            m_ring = ring;
+            m_rings = rings;
+            m_ringsSize = ringsSize;
+            m_entries = entries;
+            m_entriesSize = entriesSize;
+
+            SubmissionQueueSize = parameters.SqEntries;
+            m_sqHead = (uint*)(rings + parameters.SqOff.Head);
+            m_sqTail = (uint*)(rings + parameters.SqOff.Tail);
+            m_sqMask = *(uint*)(rings + parameters.SqOff.RingMask);
+
+            CompletionQueueSize = parameters.CqEntries;
+            m_cqHead = (uint*)(rings + parameters.CqOff.Head);
+            m_cqTail = (uint*)(rings + parameters.CqOff.Tail);
+            m_cqMask = *(uint*)(rings + parameters.CqOff.RingMask);
+            m_cqes = (Completion*)(rings + parameters.CqOff.Cqes);
+
+            // The submission queue is an array of indices into the entries: entry i always goes through slot i
+            uint* array = (uint*)(rings + parameters.SqOff.Array);
+            for (uint i = 0; i < parameters.SqEntries; i++)
+            {
+                array[i] = i;
+            }
+        }
+
+        /// <summary>
+        /// Creates an io_uring instance with (at least) <paramref name="entries"/> submission entries, and twice as many completion entries.
+        /// Returns 0 on success or the errno value of the failure, in which case <paramref name="ring"/> is null.
+        /// </summary>
+        /// <remarks>
+        /// Fails with <see cref="ENOSYS"/> on kernels older than 5.6, and typically with EPERM where io_uring is disabled (e.g., by a seccomp
+        /// profile of a container runtime, or by the kernel.io_uring_disabled sysctl).
+        /// </remarks>
+        public static int Create(uint entries, out IoUring ring)
+        {
+            if (IsMacOS)
+            {
+                throw new NotImplementedException();
+            }
+
+            ring = null;
+
+            var parameters = new Parameters();
+            long fd = syscall_2(SYS_io_uring_setup, entries, (long)&parameters);
+            if (fd < 0)
+            {
+                return Marshal.GetLastWin32Error();
+            }
+
+            var handle = new SafeFileHandle(new IntPtr(fd), ownsHandle: true);
+            if ((parameters.Features & RequiredFeatures) != RequiredFeatures)
+            {
+                handle.Dispose();
+                return ENOSYS;
+            }
+
+            ulong ringsSize = Math.Max(
+                parameters.SqOff.Array + parameters.SqEntries * sizeof(uint),
+                parameters.CqOff.Cqes + parameters.CqEntries * (ulong)sizeof(Completion));
+            void* rings = mmap(null, ringsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, (int)fd, IORING_OFF_SQ_RING);
+            if (rings == (void*)-1)
+            {
+                int error = Marshal.GetLastWin32Error();
+                handle.Dispose();
+                return error;
+            }
+
+            ulong entriesSize = parameters.SqEntries * (ulong)sizeof(SubmissionEntry);
+            void* sqes = mmap(null, entriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, (int)fd, IORING_OFF_SQES);
+            if (sqes == (void*)-1)
+            {
+                int error = Marshal.GetLastWin32Error();
+                munmap(rings, ringsSize);
+                handle.Dispose();
+                return error;
+            }
+
+            ring = new IoUring(handle, parameters, (byte*)rings, ringsSize, (SubmissionEntry*)sqes, entriesSize);
+            return 0;
+        }
+
+        /// <summary>
+        /// Submits a read of up to <paramref name="length"/> bytes of <paramref name="fd"/> at <paramref name="fileOffset"/> (-1 for the current
+        /// position of the file, for files that can't seek) into <paramref name="buffer"/>, whose result is posted with <paramref name="userData"/>.
+        /// </summary>
+        /// <remarks>
+        /// <paramref name="buffer"/> must stay valid, and <paramref name="fd"/> open, until the completion is posted.
+        /// Returns <see cref="EBUSY"/> when the submission queue is full. When this returns an error, the read was not submitted.
+        /// </remarks>
+        public int SubmitRead(int fd, byte* buffer, uint length, long fileOffset, ulong userData)
+        {
+            uint tail = *m_sqTail;
+            if (tail - Volatile.Read(ref *m_sqHead) >= SubmissionQueueSize)
+            {
+                return EBUSY;
+            }
+
+            SubmissionEntry* entry = &m_entries[tail & m_sqMask];
+            *entry = default;
+            entry->Opcode = IORING_OP_READ;
+            entry->Fd = fd;
+            entry->Offset = unchecked((ulong)fileOffset);
+            entry->Address = (ulong)buffer;
+            entry->Length = length;
+            entry->UserData = userData;
+
+            // Publishes the entry: the kernel reads it when the tail covers it
+            Volatile.Write(ref *m_sqTail, tail + 1);
+
+            while (true)
+            {
+                long submitted = syscall_6(SYS_io_uring_enter, m_ring.DangerousGetHandle().ToInt64(), 1, 0, 0, 0, 0);
+                if (submitted == 1)
+                {
+                    return 0;
+                }
+
+                int error = submitted < 0 ? Marshal.GetLastWin32Error() : EAGAIN;
+                if (error == EINTR)
+                {
+                    continue;
+                }
+
+                if (error == EAGAIN || error == EBUSY)
+                {
+                    // Out of resources for now, or completions waiting to be reaped: those are taken by the completion side
+                    Thread.Yield();
+                    continue;
+                }
+
+                // The kernel did not take the entry: take it back, so it is not submitted along with the next one
+                Volatile.Write(ref *m_sqTail, tail);
+                return error;
+            }
+        }
+
+        /// <summary>
+        /// Blocks until at least one completion is available. Returns 0 or the errno value of the failure (EINTR when interrupted by a signal).
+        /// </summary>
+        public int WaitForCompletions()
+        {
+            long result = syscall_6(SYS_io_uring_enter, m_ring.DangerousGetHandle().ToInt64(), 0, 1, IORING_ENTER_GETEVENTS, 0, 0);
+            return result < 0 ? Marshal.GetLastWin32Error() : 0;
+        }
+
+        /// <summary>
+        /// Takes the next completion off the completion queue, if any.
+        /// </summary>
+        public bool TryGetCompletion(out Completion completion)
+        {
+            uint head = *m_cqHead;
+            if (head == Volatile.Read(ref *m_cqTail))
+            {
+                completion = default;
+                return false;
+            }
+
+            completion = m_cqes[head & m_cqMask];
+
+            // Hands the slot back to the kernel
+            Volatile.Write(ref *m_cqHead, head + 1);
+            return true;
+        }
+
+        /// <inheritdoc />
+        public void Dispose()
+        {
+            munmap(m_entries, m_entriesSize);
+            munmap(m_rings, m_ringsSize);
+            m_ring.Dispose();
+        }
+    }
+}
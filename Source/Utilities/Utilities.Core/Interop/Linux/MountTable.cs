@@ -0,0 +1,335 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading;
+using Microsoft.Win32.SafeHandles;
+using static BuildXL.Interop.Dispatch;
+using static BuildXL.Interop.Unix.Impl_Common;
+using static BuildXL.Interop.Unix.Impl_Linux;
+using static BuildXL.Interop.Unix.IO;
+
+namespace BuildXL.Interop.Linux
+{
+    /// <summary>
+    /// The mount table of this process (/proc/self/mountinfo), parsed once and kept up to date.
+    /// </summary>
+    /// <remarks>
+    /// The table is only parsed again when poll(2) on the open mountinfo file reports that the mount namespace changed, so
+    /// looking up the file system of a file descriptor costs a poll and a statx(2): the mount id of the file is looked up in the table,
+    /// without allocating. A mount that is not in the table is reported as <see cref="UnknownFileSystemType"/>: the table is not parsed
+    /// again for it, as a mount made before the file was opened has already been reported by poll. Kernels before 5.8 don't report mount ids,
+    /// and those before 4.11 have no statx at all: then the path of the file descriptor is matched against the mount points instead, one path
+    /// component at a time.
+    /// </remarks>
+    public sealed class MountTable
+    {
+        /// <summary>
+        /// struct pollfd
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential)]
+        public struct PollFd
+        {
+            /// <nodoc />
+            public int Fd;
+
+            /// <nodoc />
+            public short Events;
+
+            /// <nodoc />
+            public short Revents;
+        }
+
+        private const short POLLERR = 0x008;
+        private const short POLLPRI = 0x002;
+
+        private const int AT_EMPTY_PATH = 0x1000;
+        private const uint STATX_MNT_ID = 0x1000;
+
+        // Layout of struct statx (which the kernel always fills in whole)
+        private const int StatxSize = 256;
+        private const int StatxMaskOffset = 0;
+        private const int StatxMountIdOffset = 144;
+
+        private const string MountInfoPath = "/proc/self/mountinfo";
+
+        /// <summary>
+        /// The type reported for a file whose mount is not in the table.
+        /// </summary>
+        public const string UnknownFileSystemType = "UNKNOWN";
+
+        private static readonly Lazy<MountTable> s_instance = new Lazy<MountTable>(() => new MountTable(), LazyThreadSafetyMode.ExecutionAndPublication);
+
+        /// <summary>
+        /// The mount table of this process.
+        /// </summary>
+        public static MountTable Instance => s_instance.Value;
+
+        /// <summary>
+        /// A parsed mount table.
+        /// </summary>
+        internal sealed class Snapshot
+        {
+            internal readonly Dictionary<long, string> FileSystemTypeByMountId = new Dictionary<long, string>();
+            internal readonly Dictionary<string, string> FileSystemTypeByMountPoint = new Dictionary<string, string>(StringComparer.Ordinal);
+        }
+
+        private readonly object m_refreshLock = new object();
+        private readonly SafeFileHandle m_mountInfo;
+        private byte[] m_buffer = new byte[64 * 1024];
+        private volatile Snapshot m_snapshot;
+
+        // Interned file system type names, so that all the mounts of the same type share one string
+        private readonly Dictionary<string, string> m_fileSystemTypes = new Dictionary<string, string>(StringComparer.Ordinal);
+
+        private MountTable()
+        {
+            m_mountInfo = Unix.IO.Open(MountInfoPath, Unix.IO.OpenFlags.O_RDONLY | Unix.IO.OpenFlags.O_CLOEXEC, 0);
+            m_snapshot = ReadSnapshot();
+        }
+
+        /// <summary>
+        /// Returns the type of the file system (as named in the mount table, e.g. "ext4") of the file open as <paramref name="fd"/>,
+        /// <see cref="UnknownFileSystemType"/> if its mount is not in the table, or null if the path of the file is needed and can't be determined.
+        /// </summary>
+        public string GetFileSystemType(SafeFileHandle fd)
+        {
+            if (IsMacOS)
+            {
+                throw new NotImplementedException();
+            }
+
+            RefreshIfChanged();
+
+            if (TryGetMountId(fd, out long mountId))
+            {
+                return m_snapshot.FileSystemTypeByMountId.TryGetValue(mountId, out var type) ? type : UnknownFileSystemType;
+            }
+
+            var path = ToPath(fd);
+            return path == null ? null : GetFileSystemTypeByPath(m_snapshot, path);
+        }
+
+        /// <summary>
+        /// Matches the longest mount point that contains <paramref name="path"/>, trying the path and then each of its parents.
+        /// </summary>
+        internal static string GetFileSystemTypeByPath(Snapshot snapshot, string path)
+        {
+            for (int length = path.Length; length > 0; length = path.LastIndexOf('/', length - 1))
+            {
+                if (snapshot.FileSystemTypeByMountPoint.TryGetValue(path.Substring(0, length), out var type))
+                {
+                    return type;
+                }
+            }
+
+            return snapshot.FileSystemTypeByMountPoint.TryGetValue("/", out var rootType) ? rootType : UnknownFileSystemType;
+        }
+
+        private static unsafe bool TryGetMountId(SafeFileHandle fd, out long mountId)
+        {
+            // Without statx (kernels before 4.11, or a glibc without it), mounts are matched by path
+            if (!SupportsStatx)
+            {
+                mountId = 0;
+                return false;
+            }
+
+            byte* buffer = stackalloc byte[StatxSize];
+            byte emptyPath = 0;
+            if (statx_raw(ToInt(fd), &emptyPath, AT_EMPTY_PATH, STATX_MNT_ID, buffer) == 0
+                && (*(uint*)(buffer + StatxMaskOffset) & STATX_MNT_ID) != 0)
+            {
+                mountId = *(long*)(buffer + StatxMountIdOffset);
+                return true;
+            }
+
+            mountId = 0;
+            return false;
+        }
+
+        private unsafe void RefreshIfChanged()
+        {
+            if (m_mountInfo.IsInvalid)
+            {
+                return;
+            }
+
+            // The mount namespace reports a change to each open mountinfo file once, as POLLERR | POLLPRI, so the poll and the refresh it calls for
+            // go together under the lock: a thread that finds the lock taken waits for the snapshot that may include the mount of its file.
+            if (!Monitor.TryEnter(m_refreshLock))
+            {
+                lock (m_refreshLock)
+                {
+                    return;
+                }
+            }
+
+            try
+            {
+                var pollFd = new PollFd { Fd = ToInt(m_mountInfo), Events = POLLPRI };
+                if (poll(&pollFd, 1, 0) > 0 && (pollFd.Revents & (POLLERR | POLLPRI)) != 0)
+                {
+                    m_snapshot = ReadSnapshot();
+                }
+            }
+            finally
+            {
+                Monitor.Exit(m_refreshLock);
+            }
+        }
+
+        /// <summary>
+        /// Reads and parses the whole mount table. Called under <see cref="m_refreshLock"/> (or from the constructor).
+        /// </summary>
+        private Snapshot ReadSnapshot()
+        {
+            int length = ReadMountInfo();
+            return Parse(new ReadOnlySpan<byte>(m_buffer, 0, length), m_fileSystemTypes);
+        }
+
+        /// <summary>
+        /// Parses the contents of a mountinfo file. Lines that can't be parsed are skipped. <paramref name="fileSystemTypes"/> interns
+        /// the names of the file system types, across calls.
+        /// </summary>
+        internal static Snapshot Parse(ReadOnlySpan<byte> mountInfo, Dictionary<string, string> fileSystemTypes)
+        {
+            var snapshot = new Snapshot();
+            while (!mountInfo.IsEmpty)
+            {
+                int lineEnd = mountInfo.IndexOf((byte)'\n');
+                ParseLine(snapshot, lineEnd < 0 ? mountInfo : mountInfo.Slice(0, lineEnd), fileSystemTypes);
+                mountInfo = lineEnd < 0 ? ReadOnlySpan<byte>.Empty : mountInfo.Slice(lineEnd + 1);
+            }
+
+            return snapshot;
+        }
+
+        private unsafe int ReadMountInfo()
+        {
+            if (m_mountInfo.IsInvalid)
+            {
+                return 0;
+            }
+
+            int fd = ToInt(m_mountInfo);
+            int total = 0;
+            while (true)
+            {
+                if (total == m_buffer.Length)
+                {
+                    Array.Resize(ref m_buffer, m_buffer.Length * 2);
+                }
+
+                long read;
+                fixed (byte* buffer = m_buffer)
+                {
+                    read = pread(fd, buffer + total, (ulong)(m_buffer.Length - total), total);
+                }
+
+                if (read <= 0)
+                {
+                    return total;
+                }
+
+                total += (int)read;
+            }
+        }
+
+        /// <summary>
+        /// Parses one line of mountinfo (see proc(5)):
+        /// "36 35 98:0 /mnt1 /mnt/parent rw,noatime master:1 - ext3 /dev/root rw,errors=continue"
+        /// i.e. mount id, parent id, device, root, mount point, options, optional fields, "-", file system type, source and super block options.
+        /// </summary>
+        private static void ParseLine(Snapshot snapshot, ReadOnlySpan<byte> line, Dictionary<string, string> fileSystemTypes)
+        {
+            var mountIdField = NextField(ref line);
+            NextField(ref line); // parent id
+            NextField(ref line); // major:minor
+            NextField(ref line); // root
+            var mountPointField = NextField(ref line);
+
+            // Skip the options and the optional fields up to the separator
+            var field = NextField(ref line);
+            while (!field.IsEmpty && !(field.Length == 1 && field[0] == '-'))
+            {
+                field = NextField(ref line);
+            }
+
+            var typeField = NextField(ref line);
+            if (typeField.IsEmpty || !TryParseDecimal(mountIdField, out long mountId))
+            {
+                return;
+            }
+
+            string type = InternFileSystemType(typeField, fileSystemTypes);
+            snapshot.FileSystemTypeByMountId[mountId] = type;
+
+            // Mounts are listed in mount order, so a later mount on the same mount point hides the earlier ones
+            snapshot.FileSystemTypeByMountPoint[Unescape(mountPointField)] = type;
+        }
+
+        private static ReadOnlySpan<byte> NextField(ref ReadOnlySpan<byte> line)
+        {
+            int end = line.IndexOf((byte)' ');
+            var field = end < 0 ? line : line.Slice(0, end);
+            line = end < 0 ? ReadOnlySpan<byte>.Empty : line.Slice(end + 1);
+            return field;
+        }
+
+        private static bool TryParseDecimal(ReadOnlySpan<byte> digits, out long value)
+        {
+            value = 0;
+            foreach (byte b in digits)
+            {
+                if (b < '0' || b > '9')
+                {
+                    return false;
+                }
+
+                value = value * 10 + (b - '0');
+            }
+
+            return !digits.IsEmpty;
+        }
+
+        private static string InternFileSystemType(ReadOnlySpan<byte> type, Dictionary<string, string> fileSystemTypes)
+        {
+            string name = Encoding.UTF8.GetString(type.ToArray());
+            if (!fileSystemTypes.TryGetValue(name, out var interned))
+            {
+                fileSystemTypes[name] = interned = name;
+            }
+
+            return interned;
+        }
+
+        /// <summary>
+        /// Mount points have spaces, tabs, newlines and backslashes escaped as octal sequences (e.g. "\040").
+        /// </summary>
+        private static string Unescape(ReadOnlySpan<byte> escaped)
+        {
+            var bytes = new byte[escaped.Length];
+            int length = 0;
+            for (int i = 0; i < escaped.Length; i++)
+            {
+                if (escaped[i] == '\\' && i + 3 < escaped.Length && IsOctal(escaped[i + 1]) && IsOctal(escaped[i + 2]) && IsOctal(escaped[i + 3]))
+                {
+                    bytes[length++] = (byte)(((escaped[i + 1] - '0') << 6) | ((escaped[i + 2] - '0') << 3) | (escaped[i + 3] - '0'));
+                    i += 3;
+                }
+                else
+                {
+                    bytes[length++] = escaped[i];
+                }
+            }
+
+            return Encoding.UTF8.GetString(bytes, 0, length);
+        }
+
+        private static bool IsOctal(byte b) => b >= '0' && b <= '7';
+    }
+}
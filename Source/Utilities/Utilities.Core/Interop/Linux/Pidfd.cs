@@ -0,0 +1,56 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Runtime.InteropServices;
+using Microsoft.Win32.SafeHandles;
+using static BuildXL.Interop.Dispatch;
+using static BuildXL.Interop.Unix.Impl_Linux;
+
+namespace BuildXL.Interop.Linux
+{
+    /// <summary>
+    /// Native Linux process file descriptors (pidfd, kernel 5.3 and later).
+    /// </summary>
+    /// <remarks>
+    /// A pidfd refers to one specific process, so unlike its pid it can't end up referring to another process once the pid is reused.
+    /// It becomes readable (see <see cref="Epoll"/>) when the process terminates.
+    /// </remarks>
+    public static class Pidfd
+    {
+        /// <summary>
+        /// Linux value of ESRCH: the process does not exist (anymore).
+        /// </summary>
+        public const int ESRCH = 3;
+
+        /// <summary>
+        /// Linux value of ENOSYS: the kernel does not support pidfds.
+        /// </summary>
+        public const int ENOSYS = 38;
+
+        // glibc only exposes pidfd_open since 2.36, so it is called through syscall(2). The number is the same on all architectures.
+        private const long SYS_pidfd_open = 434;
+
+        /// <summary>
+        /// Opens a pidfd for process <paramref name="pid"/>, which must be a thread group leader.
+        /// Returns 0 on success or the errno value of the failure, in which case <paramref name="pidfd"/> is null.
+        /// </summary>
+        public static int Open(int pid, out SafeFileHandle pidfd)
+        {
+            if (IsMacOS)
+            {
+                throw new NotImplementedException();
+            }
+
+            long fd = syscall_2(SYS_pidfd_open, pid, 0);
+            if (fd < 0)
+            {
+                pidfd = null;
+                return Marshal.GetLastWin32Error();
+            }
+
+            pidfd = new SafeFileHandle(new IntPtr(fd), ownsHandle: true);
+            return 0;
+        }
+    }
+}
@@ -0,0 +1,333 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+using System;
+using System.Collections.Generic;
+using System.Text;
+using System.Threading;
+using static BuildXL.Interop.Unix.Impl_Common;
+using static BuildXL.Interop.Unix.Impl_Linux;
+using static BuildXL.Interop.Unix.Process;
+
+namespace BuildXL.Interop.Linux
+{
+    /// <summary>
+    /// Allocation-free readers for the per-process files of procfs.
+    /// </summary>
+    /// <remarks>
+    /// Files are read with a single read(2) into a buffer owned by the caller (typically on the stack) and parsed in place,
+    /// so that sampling many processes often produces no garbage.
+    /// </remarks>
+    public static class ProcFs
+    {
+        /// <summary>
+        /// The per-process files that can be read with <see cref="ReadProcessFile"/>.
+        /// </summary>
+        public enum ProcessFile
+        {
+            /// <summary>/proc/[pid]/stat, see <see cref="TryParseStat"/>.</summary>
+            Stat,
+
+            /// <summary>/proc/[pid]/io, see <see cref="TryParseIo"/>.</summary>
+            Io,
+
+            /// <summary>/proc/[pid]/status, see <see cref="ParseStatus"/>.</summary>
+            Status,
+        }
+
+        /// <summary>
+        /// Fields of /proc/[pid]/stat.
+        /// </summary>
+        public struct StatInfo
+        {
+            /// <nodoc />
+            public int ParentProcessId;
+
+            /// <summary>User time, in clock ticks (see <see cref="ClockTicksToMilliseconds"/>).</summary>
+            public ulong UserTimeTicks;
+
+            /// <summary>System time, in clock ticks.</summary>
+            public ulong SystemTimeTicks;
+
+            /// <summary>Time the process started after system boot, in clock ticks. Tells apart processes that had the same pid.</summary>
+            public ulong StartTimeTicks;
+        }
+
+        /// <summary>
+        /// Buffer size that fits any of the <see cref="ProcessFile"/> files (status, the largest, is around 1.5KB).
+        /// </summary>
+        public const int BufferSize = 4096;
+
+        private const int O_RDONLY = 0;
+        private const int O_CLOEXEC = 0x80000;
+
+        // Offset of d_name in the struct dirent returned by readdir on 64-bit Linux (after d_ino, d_off, d_reclen and d_type)
+        private const int DirentNameOffset = 19;
+
+        private static readonly byte[] s_statFileName = Encoding.ASCII.GetBytes("stat");
+        private static readonly byte[] s_ioFileName = Encoding.ASCII.GetBytes("io");
+        private static readonly byte[] s_statusFileName = Encoding.ASCII.GetBytes("status");
+
+        private static readonly byte[] s_syscr = Encoding.ASCII.GetBytes("syscr:");
+        private static readonly byte[] s_syscw = Encoding.ASCII.GetBytes("syscw:");
+        private static readonly byte[] s_readBytes = Encoding.ASCII.GetBytes("read_bytes:");
+        private static readonly byte[] s_writeBytes = Encoding.ASCII.GetBytes("write_bytes:");
+        private static readonly byte[] s_vmRss = Encoding.ASCII.GetBytes("VmRSS:");
+        private static readonly byte[] s_vmHwm = Encoding.ASCII.GetBytes("VmHWM:");
+
+        private static long s_clockTicksPerSecond;
+
+        /// <summary>
+        /// Converts clock ticks (the unit of the times in /proc/[pid]/stat) to milliseconds.
+        /// </summary>
+        public static ulong ClockTicksToMilliseconds(ulong ticks)
+        {
+            long ticksPerSecond = Volatile.Read(ref s_clockTicksPerSecond);
+            if (ticksPerSecond <= 0)
+            {
+                ticksPerSecond = Unix.Impl_Linux.sysconf((int)Sysconf_Flags._SC_CLK_TCK);
+                Volatile.Write(ref s_clockTicksPerSecond, ticksPerSecond);
+            }
+
+            return ticks * 1000 / (ulong)ticksPerSecond;
+        }
+
+        /// <summary>
+        /// Reads /proc/[<paramref name="pid"/>]/<paramref name="file"/> into <paramref name="buffer"/> with a single read.
+        /// Returns the number of bytes read, or -1 if the file can't be read (typically because the process exited).
+        /// </summary>
+        public static unsafe int ReadProcessFile(int pid, ProcessFile file, Span<byte> buffer)
+        {
+            byte[] fileName = file switch
+            {
+                ProcessFile.Stat => s_statFileName,
+                ProcessFile.Io => s_ioFileName,
+                _ => s_statusFileName,
+            };
+
+            // "/proc/" + pid + "/" + name + NUL
+            byte* path = stackalloc byte[64];
+            int length = 0;
+            foreach (char c in "/proc/")
+            {
+                path[length++] = (byte)c;
+            }
+
+            length += FormatDecimal((uint)pid, path + length);
+            path[length++] = (byte)'/';
+            foreach (byte b in fileName)
+            {
+                path[length++] = b;
+            }
+
+            path[length] = 0;
+
+            int fd = open_raw(path, O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                return -1;
+            }
+
+            int read;
+            fixed (byte* pBuffer = buffer)
+            {
+                read = Unix.Impl_Common.read(fd, pBuffer, buffer.Length);
+            }
+
+            close(fd);
+            return read;
+        }
+
+        /// <summary>
+        /// Parses the contents of /proc/[pid]/stat. <paramref name="name"/> is set to the process name (comm), which is truncated to 15 bytes by the kernel.
+        /// </summary>
+        public static bool TryParseStat(ReadOnlySpan<byte> data, out StatInfo info, out ReadOnlySpan<byte> name)
+        {
+            info = default;
+            name = default;
+
+            // The name is in parentheses and may contain anything, including spaces and parentheses: it ends at the last ')'
+            int nameStart = data.IndexOf((byte)'(');
+            int nameEnd = data.LastIndexOf((byte)')');
+            if (nameStart < 0 || nameEnd < nameStart)
+            {
+                return false;
+            }
+
+            name = data.Slice(nameStart + 1, nameEnd - nameStart - 1);
+
+            // Fields after the name, starting with the state (field 3 in proc(5))
+            var fields = data.Slice(nameEnd + 1);
+            ulong ppid = 0;
+            for (int field = 3; field <= 22; field++)
+            {
+                fields = fields.TrimStart((byte)' ');
+                int end = fields.IndexOf((byte)' ');
+                var value = end < 0 ? fields : fields.Slice(0, end);
+                switch (field)
+                {
+                    case 4:
+                        if (!TryParseDecimal(value, out ppid))
+                        {
+                            return false;
+                        }
+
+                        break;
+                    case 14:
+                        if (!TryParseDecimal(value, out info.UserTimeTicks))
+                        {
+                            return false;
+                        }
+
+                        break;
+                    case 15:
+                        if (!TryParseDecimal(value, out info.SystemTimeTicks))
+                        {
+                            return false;
+                        }
+
+                        break;
+                    case 22:
+                        if (!TryParseDecimal(value, out info.StartTimeTicks))
+                        {
+                            return false;
+                        }
+
+                        info.ParentProcessId = (int)ppid;
+                        return true;
+                }
+
+                if (end < 0)
+                {
+                    return false;
+                }
+
+                fields = fields.Slice(end);
+            }
+
+            return false;
+        }
+
+        /// <summary>
+        /// Parses the contents of /proc/[pid]/io into the disk counters of <paramref name="usage"/>.
+        /// </summary>
+        public static bool TryParseIo(ReadOnlySpan<byte> data, ref ProcessResourceUsage usage)
+        {
+            return TryFindValue(data, s_syscr, out usage.DiskReadOps)
+                && TryFindValue(data, s_readBytes, out usage.DiskBytesRead)
+                && TryFindValue(data, s_syscw, out usage.DiskWriteOps)
+                && TryFindValue(data, s_writeBytes, out usage.DiskBytesWritten);
+        }
+
+        /// <summary>
+        /// Parses the contents of /proc/[pid]/status into the memory counters of <paramref name="usage"/>. They are left at 0 for processes
+        /// that have no memory (zombies and kernel threads).
+        /// </summary>
+        public static void ParseStatus(ReadOnlySpan<byte> data, ref ProcessResourceUsage usage)
+        {
+            usage.WorkingSetSize = TryFindValue(data, s_vmRss, out var rssKb) ? rssKb * 1024 : 0;
+            usage.PeakWorkingSetSize = TryFindValue(data, s_vmHwm, out var hwmKb) ? hwmKb * 1024 : 0;
+        }
+
+        /// <summary>
+        /// Fills <paramref name="pids"/> with the ids of all the processes in /proc. Returns false if /proc can't be read.
+        /// </summary>
+        public static unsafe bool ListProcessIds(List<int> pids)
+        {
+            pids.Clear();
+
+            IntPtr dir = opendir("/proc");
+            if (dir == IntPtr.Zero)
+            {
+                return false;
+            }
+
+            try
+            {
+                IntPtr entry;
+                while ((entry = readdir(dir)) != IntPtr.Zero)
+                {
+                    // Process directories are the ones with a numeric name
+                    byte* name = (byte*)entry + DirentNameOffset;
+                    int pid = 0;
+                    int i = 0;
+                    for (; name[i] >= '0' && name[i] <= '9'; i++)
+                    {
+                        pid = pid * 10 + (name[i] - '0');
+                    }
+
+                    if (i > 0 && name[i] == 0)
+                    {
+                        pids.Add(pid);
+                    }
+                }
+            }
+            finally
+            {
+                closedir(dir);
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Finds the value of a "key: value" line (the format of the io and status files). Values may be followed by a unit.
+        /// </summary>
+        private static bool TryFindValue(ReadOnlySpan<byte> data, byte[] key, out ulong value)
+        {
+            value = 0;
+            while (!data.IsEmpty)
+            {
+                int lineEnd = data.IndexOf((byte)'\n');
+                var line = lineEnd < 0 ? data : data.Slice(0, lineEnd);
+                if (line.StartsWith(key))
+                {
+                    var digits = line.Slice(key.Length).TrimStart((byte)' ').TrimStart((byte)'\t').TrimStart((byte)' ');
+                    int end = digits.IndexOf((byte)' ');
+                    return TryParseDecimal(end < 0 ? digits : digits.Slice(0, end), out value);
+                }
+
+                data = lineEnd < 0 ? ReadOnlySpan<byte>.Empty : data.Slice(lineEnd + 1);
+            }
+
+            return false;
+        }
+
+        private static bool TryParseDecimal(ReadOnlySpan<byte> digits, out ulong value)
+        {
+            value = 0;
+            foreach (byte b in digits)
+            {
+                if (b < '0' || b > '9')
+                {
+                    return false;
+                }
+
+                value = unchecked(value * 10 + (ulong)(b - '0'));
+            }
+
+            return !digits.IsEmpty;
+        }
+
+        private static unsafe int FormatDecimal(uint value, byte* destination)
+        {
+            int length = 0;
+            do
+            {
+                destination[length++] = (byte)('0' + value % 10);
+                value /= 10;
+            }
+            while (value != 0);
+
+            // Digits were written least significant first
+            for (int i = 0, j = length - 1; i < j; i++, j--)
+            {
+                byte b = destination[i];
+                destination[i] = destination[j];
+                destination[j] = b;
+            }
+
+            return length;
+        }
+    }
+}
@@ -322,6 +322,30 @@ namespace BuildXL.Interop.Unix
             }
         }
 
+        /// <summary>
+        /// Invokes the 'pread' syscall (or 'read' when <paramref name="fileOffset"/> is negative, for files that can't seek),
+        /// retrying on <see cref="Errno.EINTR"/>.
+        /// </summary>
+        /// <param name="handle">File descriptor</param>
+        /// <param name="buffer">Buffer to which to read</param>
+        /// <param name="length">Max number of bytes to read</param>
+        /// <param name="fileOffset">Offset in the file at which to read; the file offset of <paramref name="handle"/> is not changed</param>
+        /// <returns>
+        /// 0 on EOF, -1 on error, or number of bytes read otherwise.
+        /// </returns>
+        public unsafe static long PRead(SafeFileHandle handle, byte* buffer, int length, long fileOffset)
+        {
+            long result;
+            do
+            {
+                result = fileOffset < 0
+                    ? Impl_Common.read(ToInt(handle), buffer, length)
+                    : Impl_Common.pread(ToInt(handle), buffer, (ulong)length, fileOffset);
+            }
+            while (result < 0 && Marshal.GetLastWin32Error() == (int)Errno.EINTR);
+            return result;
+        }
+
         /// <summary>
         /// Invokes the 'write' syscall, retrying on <see cref="Errno.EINTR"/>.
         /// </summary>
@@ -409,6 +433,25 @@ namespace BuildXL.Interop.Unix
         [DllImport(Libraries.LibC, SetLastError = true, EntryPoint = "clonefile")]
         public static extern int CloneFile(string source, string destination, CloneFileFlags flags);
 
+        /// <summary>
+        /// Returns the size of the value of the extended attribute <paramref name="name"/> (including its namespace, e.g. "security.capability")
+        /// of the file open as <paramref name="fd"/>, or -1 on error. The error is ENODATA if the file does not have the attribute.
+        /// </summary>
+        public static long GetXattrSize(SafeFileHandle fd, string name) => IsMacOS
+            ? throw new NotImplementedException()
+            : Impl_Linux.fgetxattr(ToInt(fd), name, IntPtr.Zero, 0);
+
+        // _IOW(0x94, 9, int)
+        private const ulong FICLONE = 0x40049409;
+
+        /// <summary>
+        /// Makes the file open as <paramref name="destination"/> share the contents of <paramref name="source"/> (a reflink, with ioctl FICLONE),
+        /// on file systems that support it (e.g. btrfs and xfs). Returns 0 on success, or -1 with EOPNOTSUPP or EXDEV as the error when the files can't share extents.
+        /// </summary>
+        public static int CloneFileContents(SafeFileHandle source, SafeFileHandle destination) => IsMacOS
+            ? throw new NotImplementedException()
+            : Impl_Linux.ioctl(ToInt(destination), FICLONE, ToInt(source));
+
         /// <summary>
         /// Copies a file using 'copy_file_range' using in-kernel file descriptors.
         /// </summary>
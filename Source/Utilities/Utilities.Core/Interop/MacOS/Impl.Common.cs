@@ -25,6 +25,9 @@ namespace BuildXL.Interop.Unix
         [DllImport(LibC, SetLastError = true)]
         unsafe internal static extern int write(int fd, byte* buf, int bufsiz);
 
+        [DllImport(LibC, SetLastError = true)]
+        unsafe internal static extern long pread(int fd, byte* buf, ulong count, long offset);
+
         [DllImport(LibC, SetLastError = true)]
         internal static extern int read(int fd, byte[] buf, int bufsiz);
 